@@ -1051,6 +1051,7 @@ void device_del(struct device *dev)
 	device_remove_file(dev, &uevent_attr);
 	device_remove_attrs(dev);
 	bus_remove_device(dev);
+	pm_runtime_remove(dev);
 
 	/*
 	 * Some platform devices are driven without driver attached
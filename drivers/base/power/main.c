@@ -19,10 +19,22 @@
 
 #include <linux/device.h>
 #include <linux/kallsyms.h>
+#include <linux/kthread.h>
 #include <linux/mutex.h>
 #include <linux/pm.h>
+#include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
 #include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/slab.h>
 
 #include "../base.h"
 #include "power.h"
@@ -47,6 +59,56 @@ static DEFINE_MUTEX(dpm_list_mtx);
  */
 static bool transition_started;
 
+/*
+ * The slowest device callbacks of the current transition, reset when a new
+ * one is started by dpm_prepare(), for finding the driver to blame when
+ * suspend or resume gets slower.  Booting with initcall_debug also logs the
+ * time taken by every device.
+ */
+#define DPM_SLOWEST_DEVICES	16
+
+enum dpm_phase {
+	DPM_PHASE_PREPARE,
+	DPM_PHASE_SUSPEND,
+	DPM_PHASE_SUSPEND_NOIRQ,
+	DPM_PHASE_RESUME_NOIRQ,
+	DPM_PHASE_RESUME,
+	DPM_PHASE_COMPLETE,
+};
+
+static const char *dpm_phase_names[] = {
+	[DPM_PHASE_PREPARE]		= "prepare",
+	[DPM_PHASE_SUSPEND]		= "suspend",
+	[DPM_PHASE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[DPM_PHASE_RESUME_NOIRQ]	= "resume_noirq",
+	[DPM_PHASE_RESUME]		= "resume",
+	[DPM_PHASE_COMPLETE]		= "complete",
+};
+
+struct dpm_timing {
+	s64 usecs;
+	enum dpm_phase phase;
+	int event;
+	char driver[BUS_ID_SIZE];
+	char name[BUS_ID_SIZE];
+};
+
+static struct dpm_timing dpm_slowest[DPM_SLOWEST_DEVICES];
+static DEFINE_SPINLOCK(dpm_timing_lock);
+
+/*
+ * Devices with power.async_suspend set are suspended and resumed by threads
+ * of their own, in parallel with the rest of the list.  The ordering between
+ * parents and children is kept by each device's power.completion: a device
+ * waits for its parent to complete before resuming and for all its children
+ * to complete before suspending.  Devices handled synchronously only wait for
+ * asynchronous ones, the list order takes care of the rest.
+ */
+static pm_message_t async_state;
+static int async_error;
+static atomic_t async_pending = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(async_wait);
+
 /**
  *	device_pm_lock - lock the list of active devices used by the PM core
  */
@@ -266,6 +328,116 @@ static void pm_dev_err(struct device *dev, pm_message_t state, char *info,
 		kobject_name(&dev->kobj), pm_verb(state.event), info, error);
 }
 
+static void dpm_reset_times(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	memset(dpm_slowest, 0, sizeof(dpm_slowest));
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ *	dpm_record_time - account the time taken by a device callback
+ *	@dev:	Device.
+ *	@state: PM transition of the system being carried out.
+ *	@phase: The phase of the transition the callback was for.
+ *	@start: ktime_get() from before the callback was called.
+ */
+static void dpm_record_time(struct device *dev, pm_message_t state,
+			    enum dpm_phase phase, ktime_t start)
+{
+	struct dpm_timing *slot = NULL;
+	unsigned long flags;
+	s64 usecs;
+	int i;
+
+	usecs = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	if (initcall_debug)
+		printk(KERN_INFO "PM: %s %s: %s (%s) took %lld usecs\n",
+		       dev_driver_string(dev), kobject_name(&dev->kobj),
+		       dpm_phase_names[phase], pm_verb(state.event), usecs);
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	for (i = 0; i < DPM_SLOWEST_DEVICES; i++)
+		if (!slot || dpm_slowest[i].usecs < slot->usecs)
+			slot = &dpm_slowest[i];
+	if (usecs > slot->usecs) {
+		slot->usecs = usecs;
+		slot->phase = phase;
+		slot->event = state.event;
+		strlcpy(slot->driver, dev_driver_string(dev),
+			sizeof(slot->driver));
+		strlcpy(slot->name, kobject_name(&dev->kobj),
+			sizeof(slot->name));
+	}
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ *	dpm_wait - wait for a device to finish its part of the PM transition
+ *	@dev:	Device to wait for, may be NULL.
+ *	@async: If set, wait even if @dev is handled synchronously.
+ */
+static void dpm_wait(struct device *dev, bool async)
+{
+	if (!dev)
+		return;
+
+	if (async || dev->power.async_suspend)
+		wait_for_completion(&dev->power.completion);
+}
+
+static int dpm_wait_fn(struct device *dev, void *async_ptr)
+{
+	dpm_wait(dev, *((bool *)async_ptr));
+	return 0;
+}
+
+static void dpm_wait_for_children(struct device *dev, bool async)
+{
+	device_for_each_child(dev, &async, dpm_wait_fn);
+}
+
+/**
+ *	dpm_async_run - run a PM callback for a device in a thread of its own
+ *	@dev:	Device.
+ *	@fn:	Thread function, must call dpm_async_done() when finished.
+ *
+ *	Returns 0 if the thread was started, with a reference to @dev held for
+ *	it, or an error if the caller needs to handle the device itself.
+ */
+static int dpm_async_run(struct device *dev, int (*fn)(void *))
+{
+	struct task_struct *task;
+
+	get_device(dev);
+	atomic_inc(&async_pending);
+
+	task = kthread_run(fn, dev, "kpmasync");
+	if (IS_ERR(task)) {
+		atomic_dec(&async_pending);
+		put_device(dev);
+		return PTR_ERR(task);
+	}
+
+	return 0;
+}
+
+static void dpm_async_done(struct device *dev)
+{
+	put_device(dev);
+	if (atomic_dec_and_test(&async_pending))
+		wake_up(&async_wait);
+}
+
+/* wait for all the threads started by dpm_async_run() to finish */
+static void dpm_async_synchronize(void)
+{
+	wait_event(async_wait, !atomic_read(&async_pending));
+}
+
 /*------------------------- Resume routines -------------------------*/
 
 /**
@@ -277,6 +449,7 @@ static void pm_dev_err(struct device *dev, pm_message_t state, char *info,
  */
 static int resume_device_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -292,6 +465,7 @@ static int resume_device_noirq(struct device *dev, pm_message_t state)
 		pm_dev_dbg(dev, state, "legacy EARLY ");
 		error = dev->bus->resume_early(dev);
 	}
+	dpm_record_time(dev, state, DPM_PHASE_RESUME_NOIRQ, start);
  End:
 	TRACE_RESUME(error);
 	return error;
@@ -342,13 +516,16 @@ EXPORT_SYMBOL_GPL(device_power_up);
  *	@dev:	Device.
  *	@state: PM transition of the system being carried out.
  */
-static int resume_device(struct device *dev, pm_message_t state)
+static int resume_device(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
+	dpm_wait(dev->parent, async);
+	start = ktime_get();
 	down(&dev->sem);
 
 	if (dev->bus) {
@@ -386,11 +563,71 @@ static int resume_device(struct device *dev, pm_message_t state)
 	}
  End:
 	up(&dev->sem);
+	dpm_record_time(dev, state, DPM_PHASE_RESUME, start);
+	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
 	return error;
 }
 
+static int async_resume(void *data)
+{
+	struct device *dev = data;
+	int error;
+
+	error = resume_device(dev, async_state, true);
+	if (error)
+		pm_dev_err(dev, async_state, " async", error);
+	dpm_async_done(dev);
+	return 0;
+}
+
+/* the topmost device on the way up from @dev still waiting to resume */
+static struct device *dpm_first_pending(struct device *dev)
+{
+	while (dev->parent && dev->parent->power.status >= DPM_OFF)
+		dev = dev->parent;
+	return dev;
+}
+
+/**
+ *	dpm_resume_first - Resume the devices which others need running.
+ *	@state: PM transition of the system being carried out.
+ *
+ *	Devices marked with device_enable_resume_first() are resumed one
+ *	after the other, each after its parents, before anything else so
+ *	that the supplies of every other device are back when it resumes.
+ *	The list is searched again from the start after each device as it
+ *	may change while the lock is dropped.
+ *
+ *	Must be called with dpm_list_mtx held.
+ */
+static void dpm_resume_first(pm_message_t state)
+{
+	struct device *dev;
+	int error;
+
+ Again:
+	list_for_each_entry(dev, &dpm_list, power.entry) {
+		if (!dev->power.resume_first || dev->power.status < DPM_OFF)
+			continue;
+
+		dev = dpm_first_pending(dev);
+		get_device(dev);
+		INIT_COMPLETION(dev->power.completion);
+		dev->power.status = DPM_RESUMING;
+		mutex_unlock(&dpm_list_mtx);
+
+		error = resume_device(dev, state, false);
+		if (error)
+			pm_dev_err(dev, state, " priority", error);
+
+		mutex_lock(&dpm_list_mtx);
+		put_device(dev);
+		goto Again;
+	}
+}
+
 /**
  *	dpm_resume - Resume every device.
  *	@state: PM transition of the system being carried out.
@@ -401,12 +638,28 @@ static int resume_device(struct device *dev, pm_message_t state)
 static void dpm_resume(pm_message_t state)
 {
 	struct list_head list;
+	struct device *dev;
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
 	transition_started = false;
+	async_state = state;
+
+	dpm_resume_first(state);
+
+	/* start the asynchronous devices off first */
+	list_for_each_entry(dev, &dpm_list, power.entry) {
+		if (dev->power.status < DPM_OFF)
+			continue;
+
+		INIT_COMPLETION(dev->power.completion);
+		if (dev->power.async_suspend &&
+		    !dpm_async_run(dev, async_resume))
+			dev->power.status = DPM_RESUMING;
+	}
+
 	while (!list_empty(&dpm_list)) {
-		struct device *dev = to_device(dpm_list.next);
+		dev = to_device(dpm_list.next);
 
 		get_device(dev);
 		if (dev->power.status >= DPM_OFF) {
@@ -415,7 +668,7 @@ static void dpm_resume(pm_message_t state)
 			dev->power.status = DPM_RESUMING;
 			mutex_unlock(&dpm_list_mtx);
 
-			error = resume_device(dev, state);
+			error = resume_device(dev, state, false);
 
 			mutex_lock(&dpm_list_mtx);
 			if (error)
@@ -430,6 +683,7 @@ static void dpm_resume(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	dpm_async_synchronize();
 }
 
 /**
@@ -439,6 +693,8 @@ static void dpm_resume(pm_message_t state)
  */
 static void complete_device(struct device *dev, pm_message_t state)
 {
+	ktime_t start = ktime_get();
+
 	down(&dev->sem);
 
 	if (dev->class && dev->class->pm && dev->class->pm->complete) {
@@ -457,6 +713,7 @@ static void complete_device(struct device *dev, pm_message_t state)
 	}
 
 	up(&dev->sem);
+	dpm_record_time(dev, state, DPM_PHASE_COMPLETE, start);
 }
 
 /**
@@ -481,6 +738,7 @@ static void dpm_complete(pm_message_t state)
 			mutex_unlock(&dpm_list_mtx);
 
 			complete_device(dev, state);
+			pm_runtime_put(dev);
 
 			mutex_lock(&dpm_list_mtx);
 		}
@@ -538,6 +796,7 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  */
 static int suspend_device_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	if (!dev->bus)
@@ -551,6 +810,7 @@ static int suspend_device_noirq(struct device *dev, pm_message_t state)
 		error = dev->bus->suspend_late(dev, state);
 		suspend_report_result(dev->bus->suspend_late, error);
 	}
+	dpm_record_time(dev, state, DPM_PHASE_SUSPEND_NOIRQ, start);
 	return error;
 }
 
@@ -589,10 +849,18 @@ EXPORT_SYMBOL_GPL(device_power_down);
  *	@dev:	Device.
  *	@state: PM transition of the system being carried out.
  */
-static int suspend_device(struct device *dev, pm_message_t state)
+static int suspend_device(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start;
 	int error = 0;
 
+	dpm_wait_for_children(dev, async);
+
+	/* don't go any further down once a device has failed */
+	if (async_error)
+		goto Complete;
+
+	start = ktime_get();
 	down(&dev->sem);
 
 	if (dev->class) {
@@ -633,10 +901,30 @@ static int suspend_device(struct device *dev, pm_message_t state)
 	}
  End:
 	up(&dev->sem);
+	dpm_record_time(dev, state, DPM_PHASE_SUSPEND, start);
+
+	if (!error)
+		dev->power.status = DPM_OFF;
+ Complete:
+	complete_all(&dev->power.completion);
 
 	return error;
 }
 
+static int async_suspend(void *data)
+{
+	struct device *dev = data;
+	int error;
+
+	error = suspend_device(dev, async_state, true);
+	if (error) {
+		pm_dev_err(dev, async_state, " async", error);
+		async_error = error;
+	}
+	dpm_async_done(dev);
+	return 0;
+}
+
 /**
  *	dpm_suspend - Suspend every device.
  *	@state: PM transition of the system being carried out.
@@ -650,13 +938,18 @@ static int dpm_suspend(pm_message_t state)
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
+	async_state = state;
+	async_error = 0;
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.prev);
 
 		get_device(dev);
+		INIT_COMPLETION(dev->power.completion);
 		mutex_unlock(&dpm_list_mtx);
 
-		error = suspend_device(dev, state);
+		if (!dev->power.async_suspend ||
+		    dpm_async_run(dev, async_suspend))
+			error = suspend_device(dev, state, false);
 
 		mutex_lock(&dpm_list_mtx);
 		if (error) {
@@ -664,13 +957,17 @@ static int dpm_suspend(pm_message_t state)
 			put_device(dev);
 			break;
 		}
-		dev->power.status = DPM_OFF;
 		if (!list_empty(&dev->power.entry))
 			list_move(&dev->power.entry, &list);
 		put_device(dev);
+		if (async_error)
+			break;
 	}
 	list_splice(&list, dpm_list.prev);
 	mutex_unlock(&dpm_list_mtx);
+	dpm_async_synchronize();
+	if (!error)
+		error = async_error;
 	return error;
 }
 
@@ -681,6 +978,7 @@ static int dpm_suspend(pm_message_t state)
  */
 static int prepare_device(struct device *dev, pm_message_t state)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	down(&dev->sem);
@@ -708,6 +1006,7 @@ static int prepare_device(struct device *dev, pm_message_t state)
 	}
  End:
 	up(&dev->sem);
+	dpm_record_time(dev, state, DPM_PHASE_PREPARE, start);
 
 	return error;
 }
@@ -723,6 +1022,8 @@ static int dpm_prepare(pm_message_t state)
 	struct list_head list;
 	int error = 0;
 
+	dpm_reset_times();
+
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
 	transition_started = true;
@@ -733,10 +1034,13 @@ static int dpm_prepare(pm_message_t state)
 		dev->power.status = DPM_PREPARING;
 		mutex_unlock(&dpm_list_mtx);
 
+		/* no run-time suspend until the transition is complete */
+		pm_runtime_get_noresume(dev);
 		error = prepare_device(dev, state);
 
 		mutex_lock(&dpm_list_mtx);
 		if (error) {
+			pm_runtime_put(dev);
 			dev->power.status = DPM_ON;
 			if (error == -EAGAIN) {
 				put_device(dev);
@@ -782,3 +1086,62 @@ void __suspend_report_result(const char *function, void *fn, int ret)
 		printk(KERN_ERR "%s(): %pF returns %d\n", function, fn, ret);
 }
 EXPORT_SYMBOL_GPL(__suspend_report_result);
+
+#ifdef CONFIG_DEBUG_FS
+static int dpm_times_cmp(const void *a, const void *b)
+{
+	const struct dpm_timing *x = a, *y = b;
+
+	if (x->usecs == y->usecs)
+		return 0;
+	return x->usecs > y->usecs ? -1 : 1;
+}
+
+static int dpm_times_show(struct seq_file *s, void *unused)
+{
+	struct dpm_timing *times;
+	unsigned long flags;
+	int i;
+
+	times = kmalloc(sizeof(dpm_slowest), GFP_KERNEL);
+	if (!times)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	memcpy(times, dpm_slowest, sizeof(dpm_slowest));
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+
+	sort(times, DPM_SLOWEST_DEVICES, sizeof(*times), dpm_times_cmp, NULL);
+
+	seq_printf(s, "%10s %-13s %-10s %-20s %s\n",
+		   "usecs", "phase", "event", "driver", "device");
+	for (i = 0; i < DPM_SLOWEST_DEVICES && times[i].usecs; i++)
+		seq_printf(s, "%10lld %-13s %-10s %-20s %s\n",
+			   times[i].usecs, dpm_phase_names[times[i].phase],
+			   pm_verb(times[i].event), times[i].driver,
+			   times[i].name);
+
+	kfree(times);
+	return 0;
+}
+
+static int dpm_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_times_show, inode->i_private);
+}
+
+static const struct file_operations dpm_times_fops = {
+	.open		= dpm_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_debugfs_init(void)
+{
+	debugfs_create_file("pm_device_times", S_IRUGO, NULL, NULL,
+			    &dpm_times_fops);
+	return 0;
+}
+late_initcall(dpm_debugfs_init);
+#endif
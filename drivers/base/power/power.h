@@ -1,6 +1,27 @@
+#ifdef CONFIG_PM_RUNTIME
+
+/*
+ * runtime.c
+ */
+
+extern void pm_runtime_init(struct device *dev);
+extern void pm_runtime_remove(struct device *dev);
+
+#else /* CONFIG_PM_RUNTIME */
+
+static inline void pm_runtime_init(struct device *dev) {}
+static inline void pm_runtime_remove(struct device *dev) {}
+
+#endif
+
 static inline void device_pm_init(struct device *dev)
 {
 	dev->power.status = DPM_ON;
+#ifdef CONFIG_PM_SLEEP
+	init_completion(&dev->power.completion);
+	complete_all(&dev->power.completion);
+#endif
+	pm_runtime_init(dev);
 }
 
 #ifdef CONFIG_PM_SLEEP
@@ -0,0 +1,412 @@
+/*
+ * drivers/base/power/runtime.c - Run-time power management of devices
+ *
+ * This file is released under the GPLv2.
+ *
+ * Devices start out RPM_SUSPENDED with run-time PM disabled.  A driver
+ * which supports it calls pm_runtime_set_active() if the device is
+ * powered, then pm_runtime_enable().  From then on the device is kept
+ * active while its usage count is non-zero, and is suspended once the
+ * count has dropped to zero and the device has not been used for its
+ * autosuspend delay.  An active device holds a usage reference to its
+ * parent, so parents are only suspended after all of their children.
+ *
+ * Transitions of each device are serialised by its runtime_mutex; the
+ * callbacks are run with it held and may sleep.  The runtime notifiers are
+ * told about every change of status, including those made with
+ * pm_runtime_set_active() and pm_runtime_set_suspended().
+ */
+
+#include <linux/device.h>
+#include <linux/pm_runtime.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/init.h>
+#include "power.h"
+
+/*
+ * Freezeable, so that run-time transitions don't race with the system
+ * suspend and resume of devices.
+ */
+static struct workqueue_struct *pm_wq;
+
+static int rpm_callback(struct device *dev, bool suspend)
+{
+	int (*cb)(struct device *) = NULL;
+
+	/* the bus, type or class may implement it, or leave it to the driver */
+	if (dev->bus && dev->bus->pm)
+		cb = suspend ? dev->bus->pm->base.runtime_suspend :
+			dev->bus->pm->base.runtime_resume;
+	if (!cb && dev->type && dev->type->pm)
+		cb = suspend ? dev->type->pm->runtime_suspend :
+			dev->type->pm->runtime_resume;
+	if (!cb && dev->class && dev->class->pm)
+		cb = suspend ? dev->class->pm->runtime_suspend :
+			dev->class->pm->runtime_resume;
+	if (!cb && dev->driver && dev->driver->pm)
+		cb = suspend ? dev->driver->pm->runtime_suspend :
+			dev->driver->pm->runtime_resume;
+
+	return cb ? cb(dev) : 0;
+}
+
+/* runtime_mutex held by caller */
+static int rpm_suspend(struct device *dev)
+{
+	int error;
+
+	if (dev->power.runtime_status == RPM_SUSPENDED)
+		return 0;
+	if (dev->power.disable_depth > 0)
+		return -EAGAIN;
+	if (atomic_read(&dev->power.usage_count) > 0)
+		return -EBUSY;
+
+	error = rpm_callback(dev, true);
+	if (error) {
+		if (error != -EBUSY && error != -EAGAIN)
+			dev_err(dev, "runtime suspend failed: %d\n", error);
+		return error;
+	}
+
+	dev->power.runtime_status = RPM_SUSPENDED;
+	blocking_notifier_call_chain(&dev->power.runtime_notifier,
+				     RPM_NOTIFY_SUSPENDED, dev);
+
+	if (dev->parent)
+		pm_runtime_put(dev->parent);
+	return 0;
+}
+
+static int rpm_resume(struct device *dev)
+{
+	struct device *parent = dev->parent;
+	int error = 0;
+
+	/*
+	 * Resume the parent first, without holding our lock.  Parents not
+	 * using run-time PM are taken to be active.
+	 */
+	if (parent) {
+		error = pm_runtime_get_sync(parent);
+		if (error == -EAGAIN)
+			error = 0;
+		if (error) {
+			pm_runtime_put(parent);
+			return error;
+		}
+	}
+
+	mutex_lock(&dev->power.runtime_mutex);
+	if (dev->power.runtime_status == RPM_ACTIVE)
+		goto out;
+	if (dev->power.disable_depth > 0) {
+		error = -EAGAIN;
+		goto out;
+	}
+
+	error = blocking_notifier_call_chain(&dev->power.runtime_notifier,
+					     RPM_NOTIFY_RESUMING, dev);
+	error = notifier_to_errno(error);
+	if (!error)
+		error = rpm_callback(dev, false);
+	if (error) {
+		dev_err(dev, "runtime resume failed: %d\n", error);
+		goto out;
+	}
+
+	dev->power.runtime_status = RPM_ACTIVE;
+	dev->power.last_busy = jiffies;
+	parent = NULL;		/* the parent reference is ours now */
+ out:
+	mutex_unlock(&dev->power.runtime_mutex);
+	if (parent)
+		pm_runtime_put(parent);
+	return error;
+}
+
+static void rpm_queue_suspend(struct device *dev, unsigned long delay)
+{
+	queue_delayed_work(pm_wq, &dev->power.suspend_work, delay);
+}
+
+static void pm_runtime_work(struct work_struct *work)
+{
+	struct device *dev = container_of(work, struct device,
+					  power.suspend_work.work);
+	unsigned long expires;
+
+	mutex_lock(&dev->power.runtime_mutex);
+	expires = dev->power.last_busy +
+		msecs_to_jiffies(dev->power.autosuspend_delay);
+	/* used again since we were queued, wait for it to go idle again */
+	if (time_before(jiffies, expires))
+		rpm_queue_suspend(dev, expires - jiffies);
+	else
+		rpm_suspend(dev);
+	mutex_unlock(&dev->power.runtime_mutex);
+}
+
+/**
+ * pm_runtime_get_sync - take a usage reference and resume a device
+ * @dev: device
+ *
+ * The device is resumed synchronously, with its parent, if it is
+ * suspended.  The usage reference is held even if resuming fails and has
+ * to be dropped with pm_runtime_put() either way.  Returns -EAGAIN if
+ * run-time PM is disabled and the device isn't active.
+ */
+int pm_runtime_get_sync(struct device *dev)
+{
+	atomic_inc(&dev->power.usage_count);
+	return rpm_resume(dev);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_get_sync);
+
+/**
+ * pm_runtime_put - drop a usage reference
+ * @dev: device
+ *
+ * When the last reference goes the device is suspended once it has been
+ * idle for its autosuspend delay.  This may be called in atomic context.
+ */
+void pm_runtime_put(struct device *dev)
+{
+	if (!atomic_dec_and_test(&dev->power.usage_count))
+		return;
+
+	dev->power.last_busy = jiffies;
+	if (!dev->power.disable_depth)
+		rpm_queue_suspend(dev,
+			msecs_to_jiffies(dev->power.autosuspend_delay));
+}
+EXPORT_SYMBOL_GPL(pm_runtime_put);
+
+/**
+ * pm_runtime_put_sync - drop a usage reference and suspend now if idle
+ * @dev: device
+ *
+ * Unlike pm_runtime_put() the autosuspend delay is not applied.  Returns
+ * the error from suspending the device, if it was attempted.
+ */
+int pm_runtime_put_sync(struct device *dev)
+{
+	int error;
+
+	if (!atomic_dec_and_test(&dev->power.usage_count))
+		return 0;
+
+	mutex_lock(&dev->power.runtime_mutex);
+	error = rpm_suspend(dev);
+	mutex_unlock(&dev->power.runtime_mutex);
+	return error;
+}
+EXPORT_SYMBOL_GPL(pm_runtime_put_sync);
+
+/**
+ * pm_runtime_suspend - suspend a device now if it is unused
+ * @dev: device
+ *
+ * Returns -EBUSY if the device is in use.
+ */
+int pm_runtime_suspend(struct device *dev)
+{
+	int error;
+
+	mutex_lock(&dev->power.runtime_mutex);
+	error = rpm_suspend(dev);
+	mutex_unlock(&dev->power.runtime_mutex);
+	return error;
+}
+EXPORT_SYMBOL_GPL(pm_runtime_suspend);
+
+/**
+ * pm_runtime_resume - resume a device without taking a usage reference
+ * @dev: device
+ *
+ * The device is suspended again after its autosuspend delay unless it
+ * is used meanwhile.
+ */
+int pm_runtime_resume(struct device *dev)
+{
+	int error;
+
+	error = rpm_resume(dev);
+	if (!error && !atomic_read(&dev->power.usage_count))
+		rpm_queue_suspend(dev,
+			msecs_to_jiffies(dev->power.autosuspend_delay));
+	return error;
+}
+EXPORT_SYMBOL_GPL(pm_runtime_resume);
+
+/**
+ * pm_runtime_enable - allow run-time transitions of a device
+ * @dev: device
+ *
+ * Balances pm_runtime_disable() and the disabled state devices start in.
+ */
+void pm_runtime_enable(struct device *dev)
+{
+	mutex_lock(&dev->power.runtime_mutex);
+	if (dev->power.disable_depth > 0)
+		dev->power.disable_depth--;
+	else
+		dev_warn(dev, "unbalanced %s\n", __func__);
+
+	if (!dev->power.disable_depth &&
+	    dev->power.runtime_status == RPM_ACTIVE &&
+	    !atomic_read(&dev->power.usage_count)) {
+		dev->power.last_busy = jiffies;
+		rpm_queue_suspend(dev,
+			msecs_to_jiffies(dev->power.autosuspend_delay));
+	}
+	mutex_unlock(&dev->power.runtime_mutex);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_enable);
+
+/**
+ * pm_runtime_disable - stop run-time transitions of a device
+ * @dev: device
+ *
+ * Waits for a pending transition to finish.  The device is left in the
+ * state it is in.  Calls nest.
+ */
+void pm_runtime_disable(struct device *dev)
+{
+	mutex_lock(&dev->power.runtime_mutex);
+	dev->power.disable_depth++;
+	mutex_unlock(&dev->power.runtime_mutex);
+
+	cancel_delayed_work_sync(&dev->power.suspend_work);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_disable);
+
+/**
+ * pm_runtime_set_active - tell the core a device with run-time PM
+ * disabled is active
+ * @dev: device
+ *
+ * Returns -EAGAIN if run-time PM is enabled for the device, or the error
+ * from a runtime notifier refusing the change.
+ */
+int pm_runtime_set_active(struct device *dev)
+{
+	int error = 0;
+
+	mutex_lock(&dev->power.runtime_mutex);
+	if (!dev->power.disable_depth) {
+		error = -EAGAIN;
+		goto out;
+	}
+	if (dev->power.runtime_status == RPM_ACTIVE)
+		goto out;
+
+	error = blocking_notifier_call_chain(&dev->power.runtime_notifier,
+					     RPM_NOTIFY_RESUMING, dev);
+	error = notifier_to_errno(error);
+	if (error)
+		goto out;
+
+	dev->power.runtime_status = RPM_ACTIVE;
+	if (dev->parent)
+		pm_runtime_get_noresume(dev->parent);
+ out:
+	mutex_unlock(&dev->power.runtime_mutex);
+	return error;
+}
+EXPORT_SYMBOL_GPL(pm_runtime_set_active);
+
+/**
+ * pm_runtime_set_suspended - tell the core a device with run-time PM
+ * disabled is suspended
+ * @dev: device
+ *
+ * Returns -EAGAIN if run-time PM is enabled for the device.
+ */
+int pm_runtime_set_suspended(struct device *dev)
+{
+	int error = 0;
+
+	mutex_lock(&dev->power.runtime_mutex);
+	if (!dev->power.disable_depth) {
+		error = -EAGAIN;
+	} else if (dev->power.runtime_status != RPM_SUSPENDED) {
+		dev->power.runtime_status = RPM_SUSPENDED;
+		blocking_notifier_call_chain(&dev->power.runtime_notifier,
+					     RPM_NOTIFY_SUSPENDED, dev);
+		if (dev->parent)
+			pm_runtime_put(dev->parent);
+	}
+	mutex_unlock(&dev->power.runtime_mutex);
+	return error;
+}
+EXPORT_SYMBOL_GPL(pm_runtime_set_suspended);
+
+/**
+ * pm_runtime_set_autosuspend_delay - set how long a device stays idle
+ * before it is suspended
+ * @dev: device
+ * @delay: delay in milliseconds
+ */
+void pm_runtime_set_autosuspend_delay(struct device *dev, int delay)
+{
+	mutex_lock(&dev->power.runtime_mutex);
+	dev->power.autosuspend_delay = max(delay, 0);
+	mutex_unlock(&dev->power.runtime_mutex);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_set_autosuspend_delay);
+
+/**
+ * pm_runtime_register_notifier - be told about run-time transitions
+ * @dev: device
+ * @nb: notifier block
+ *
+ * @nb is called with RPM_NOTIFY_SUSPENDED after the device has been
+ * suspended and with RPM_NOTIFY_RESUMING before it is resumed; returning
+ * an error for the latter fails the resume.  Intended for resources
+ * which follow the device, such as its supplies.  Use
+ * pm_runtime_status_suspended() from within pm_runtime_disable() and
+ * pm_runtime_enable() to find out the state the notifier starts from.
+ */
+int pm_runtime_register_notifier(struct device *dev,
+				 struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&dev->power.runtime_notifier,
+						nb);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_register_notifier);
+
+int pm_runtime_unregister_notifier(struct device *dev,
+				   struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&dev->power.runtime_notifier,
+						  nb);
+}
+EXPORT_SYMBOL_GPL(pm_runtime_unregister_notifier);
+
+void pm_runtime_init(struct device *dev)
+{
+	mutex_init(&dev->power.runtime_mutex);
+	INIT_DELAYED_WORK(&dev->power.suspend_work, pm_runtime_work);
+	atomic_set(&dev->power.usage_count, 0);
+	dev->power.disable_depth = 1;
+	dev->power.runtime_status = RPM_SUSPENDED;
+	dev->power.autosuspend_delay = 0;
+	dev->power.last_busy = jiffies;
+	BLOCKING_INIT_NOTIFIER_HEAD(&dev->power.runtime_notifier);
+}
+
+/* called as the device is deleted, leaves it disabled and suspended */
+void pm_runtime_remove(struct device *dev)
+{
+	pm_runtime_disable(dev);
+	pm_runtime_set_suspended(dev);
+}
+
+static int __init pm_runtime_wq_init(void)
+{
+	pm_wq = create_freezeable_workqueue("pm");
+	return pm_wq ? 0 : -ENOMEM;
+}
+core_initcall(pm_runtime_wq_init);
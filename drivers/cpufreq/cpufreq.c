@@ -109,19 +109,24 @@ static unsigned int __cpufreq_get(unsigned int cpu);
 static void handle_update(struct work_struct *work);
 
 /**
- * Two notifier lists: the "policy" list is involved in the
+ * Three notifier lists: the "policy" list is involved in the
  * validation process for a new CPU frequency policy; the
  * "transition" list for kernel code that needs to handle
- * changes to devices when the CPU clock speed changes.
- * The mutex locks both lists.
+ * changes to devices when the CPU clock speed changes, called
+ * for each CPU; the "policy transition" list for code which only
+ * cares about the clock of a policy as a whole, such as its supply
+ * voltage, called once however many CPUs share that clock.
+ * The mutex locks all the lists.
  */
 static BLOCKING_NOTIFIER_HEAD(cpufreq_policy_notifier_list);
 static struct srcu_notifier_head cpufreq_transition_notifier_list;
+static struct srcu_notifier_head cpufreq_policy_transition_notifier_list;
 
 static bool init_cpufreq_transition_notifier_list_called;
 static int __init init_cpufreq_transition_notifier_list(void)
 {
 	srcu_init_notifier_head(&cpufreq_transition_notifier_list);
+	srcu_init_notifier_head(&cpufreq_policy_transition_notifier_list);
 	init_cpufreq_transition_notifier_list_called = true;
 	return 0;
 }
@@ -309,6 +314,23 @@ static inline void adjust_jiffies(unsigned long val, struct cpufreq_freqs *ci)
 #endif
 
 
+/* call the policy transition chain on behalf of every CPU in the policy */
+static void cpufreq_notify_policy(struct cpufreq_policy *policy,
+				  struct cpufreq_freqs *freqs,
+				  unsigned int state)
+{
+	struct cpufreq_policy_freqs pfreqs = {
+		.policy = policy,
+		.cpus = &policy->cpus,
+		.old = freqs->old,
+		.new = freqs->new,
+		.flags = freqs->flags,
+	};
+
+	srcu_notifier_call_chain(&cpufreq_policy_transition_notifier_list,
+				 state, &pfreqs);
+}
+
 /**
  * cpufreq_notify_transition - call notifier chain and adjust_jiffies
  * on frequency transition.
@@ -316,6 +338,10 @@ static inline void adjust_jiffies(unsigned long val, struct cpufreq_freqs *ci)
  * This function calls the transition notifiers and the "adjust_jiffies"
  * function. It is called twice on all CPU frequency changes that have
  * external effects.
+ *
+ * Drivers call this for each CPU of a policy.  The policy transition
+ * notifiers are called along with the transition notifiers of the
+ * policy's own CPU, so are called once per policy transition.
  */
 void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 {
@@ -346,6 +372,8 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 		}
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_PRECHANGE, freqs);
+		if (likely(policy) && likely(policy->cpu == freqs->cpu))
+			cpufreq_notify_policy(policy, freqs, CPUFREQ_PRECHANGE);
 		adjust_jiffies(CPUFREQ_PRECHANGE, freqs);
 		break;
 
@@ -353,8 +381,11 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 		adjust_jiffies(CPUFREQ_POSTCHANGE, freqs);
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_POSTCHANGE, freqs);
-		if (likely(policy) && likely(policy->cpu == freqs->cpu))
+		if (likely(policy) && likely(policy->cpu == freqs->cpu)) {
+			cpufreq_notify_policy(policy, freqs,
+					      CPUFREQ_POSTCHANGE);
 			policy->cur = freqs->new;
+		}
 		break;
 	}
 }
@@ -1268,8 +1299,12 @@ static int cpufreq_suspend(struct sys_device *sysdev, pm_message_t pmsg)
 		freqs.old = cpu_policy->cur;
 		freqs.new = cur_freq;
 
+		freqs.flags = cpufreq_driver->flags;
+
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				    CPUFREQ_SUSPENDCHANGE, &freqs);
+		cpufreq_notify_policy(cpu_policy, &freqs,
+				      CPUFREQ_SUSPENDCHANGE);
 		adjust_jiffies(CPUFREQ_SUSPENDCHANGE, &freqs);
 
 		cpu_policy->cur = cur_freq;
@@ -1346,9 +1381,13 @@ static int cpufreq_resume(struct sys_device *sysdev)
 			freqs.old = cpu_policy->cur;
 			freqs.new = cur_freq;
 
+			freqs.flags = cpufreq_driver->flags;
+
 			srcu_notifier_call_chain(
 					&cpufreq_transition_notifier_list,
 					CPUFREQ_RESUMECHANGE, &freqs);
+			cpufreq_notify_policy(cpu_policy, &freqs,
+					      CPUFREQ_RESUMECHANGE);
 			adjust_jiffies(CPUFREQ_RESUMECHANGE, &freqs);
 
 			cpu_policy->cur = cur_freq;
@@ -1377,12 +1416,13 @@ static struct sysdev_driver cpufreq_sysdev_driver = {
 /**
  *	cpufreq_register_notifier - register a driver with cpufreq
  *	@nb: notifier function to register
- *      @list: CPUFREQ_TRANSITION_NOTIFIER or CPUFREQ_POLICY_NOTIFIER
+ *      @list: CPUFREQ_TRANSITION_NOTIFIER, CPUFREQ_POLICY_NOTIFIER or
+ *             CPUFREQ_POLICY_TRANSITION_NOTIFIER
  *
- *	Add a driver to one of two lists: either a list of drivers that
+ *	Add a driver to one of three lists: either a list of drivers that
  *      are notified about clock rate changes (once before and once after
- *      the transition), or a list of drivers that are notified about
- *      changes in cpufreq policy.
+ *      the transition), of each CPU or of each policy, or a list of
+ *      drivers that are notified about changes in cpufreq policy.
  *
  *	This function may sleep, and has the same return conditions as
  *	blocking_notifier_chain_register.
@@ -1398,6 +1438,10 @@ int cpufreq_register_notifier(struct notifier_block *nb, unsigned int list)
 		ret = srcu_notifier_chain_register(
 				&cpufreq_transition_notifier_list, nb);
 		break;
+	case CPUFREQ_POLICY_TRANSITION_NOTIFIER:
+		ret = srcu_notifier_chain_register(
+				&cpufreq_policy_transition_notifier_list, nb);
+		break;
 	case CPUFREQ_POLICY_NOTIFIER:
 		ret = blocking_notifier_chain_register(
 				&cpufreq_policy_notifier_list, nb);
@@ -1414,7 +1458,8 @@ EXPORT_SYMBOL(cpufreq_register_notifier);
 /**
  *	cpufreq_unregister_notifier - unregister a driver with cpufreq
  *	@nb: notifier block to be unregistered
- *      @list: CPUFREQ_TRANSITION_NOTIFIER or CPUFREQ_POLICY_NOTIFIER
+ *      @list: CPUFREQ_TRANSITION_NOTIFIER, CPUFREQ_POLICY_NOTIFIER or
+ *             CPUFREQ_POLICY_TRANSITION_NOTIFIER
  *
  *	Remove a driver from the CPU frequency notifier list.
  *
@@ -1430,6 +1475,10 @@ int cpufreq_unregister_notifier(struct notifier_block *nb, unsigned int list)
 		ret = srcu_notifier_chain_unregister(
 				&cpufreq_transition_notifier_list, nb);
 		break;
+	case CPUFREQ_POLICY_TRANSITION_NOTIFIER:
+		ret = srcu_notifier_chain_unregister(
+				&cpufreq_policy_transition_notifier_list, nb);
+		break;
 	case CPUFREQ_POLICY_NOTIFIER:
 		ret = blocking_notifier_chain_unregister(
 				&cpufreq_policy_notifier_list, nb);
@@ -1503,6 +1552,28 @@ int __cpufreq_driver_getavg(struct cpufreq_policy *policy, unsigned int cpu)
 }
 EXPORT_SYMBOL_GPL(__cpufreq_driver_getavg);
 
+/**
+ * __cpufreq_driver_transition_cost - how long a frequency change takes
+ * @policy: the policy being governed
+ * @old_freq: frequency in kHz to change from
+ * @new_freq: frequency in kHz to change to
+ *
+ * Returns the time in uS the driver expects the transition to take,
+ * including any change in supply voltage, or 0 if the driver doesn't
+ * know.  Governors can use this to avoid trading expensive transitions
+ * back and forth.
+ */
+unsigned int __cpufreq_driver_transition_cost(struct cpufreq_policy *policy,
+					      unsigned int old_freq,
+					      unsigned int new_freq)
+{
+	if (old_freq == new_freq || !cpufreq_driver->transition_cost)
+		return 0;
+
+	return cpufreq_driver->transition_cost(policy, old_freq, new_freq);
+}
+EXPORT_SYMBOL_GPL(__cpufreq_driver_transition_cost);
+
 /*
  * when "event" is CPUFREQ_GOV_LIMITS
  */
@@ -66,6 +66,7 @@ struct cpu_dbs_info_s {
 	struct cpufreq_policy *cur_policy;
 	unsigned int prev_cpu_idle_up;
 	unsigned int prev_cpu_idle_down;
+	unsigned long prev_sample;	/* jiffies at the last sample */
 	unsigned int enable;
 	unsigned int down_skip;
 	unsigned int requested_freq;
@@ -83,7 +84,7 @@ static unsigned int dbs_enable;	/* number of CPUs using this policy */
  * is recursive for the same process. -Venki
  */
 static DEFINE_MUTEX (dbs_mutex);
-static DECLARE_DELAYED_WORK(dbs_work, do_dbs_timer);
+static struct delayed_work dbs_work;
 
 struct dbs_tuners {
 	unsigned int sampling_rate;
@@ -335,6 +336,7 @@ static void dbs_check_cpu(int cpu)
 	unsigned int tmp_idle_ticks, total_idle_ticks;
 	unsigned int freq_target;
 	unsigned int freq_down_sampling_rate;
+	unsigned long elapsed;
 	struct cpu_dbs_info_s *this_dbs_info = &per_cpu(cpu_dbs_info, cpu);
 	struct cpufreq_policy *policy;
 
@@ -343,6 +345,9 @@ static void dbs_check_cpu(int cpu)
 
 	policy = this_dbs_info->cur_policy;
 
+	elapsed = jiffies - this_dbs_info->prev_sample;
+	this_dbs_info->prev_sample = jiffies;
+
 	/*
 	 * The default safe range is 20% to 80%
 	 * Every sampling_rate, we check
@@ -369,6 +374,19 @@ static void dbs_check_cpu(int cpu)
 	if (tmp_idle_ticks < idle_ticks)
 		idle_ticks = tmp_idle_ticks;
 
+	/*
+	 * Nothing to do for a CPU which has been idle for the whole period
+	 * and is already as slow as it can go; restart the down sampling
+	 * window so it doesn't cover the idle time.
+	 */
+	if (idle_ticks >= elapsed &&
+	    this_dbs_info->requested_freq == policy->min) {
+		this_dbs_info->down_skip = 0;
+		this_dbs_info->prev_cpu_idle_down =
+			this_dbs_info->prev_cpu_idle_up;
+		return;
+	}
+
 	/* Scale idle ticks by 100 and compare with up and down ticks */
 	idle_ticks *= 100;
 	up_idle_ticks = (100 - dbs_tuners_ins.up_threshold) *
@@ -447,22 +465,28 @@ static void dbs_check_cpu(int cpu)
 	}
 }
 
+/* sample on the same jiffy as other CPUs and governors where possible */
+static int dbs_timer_delay(void)
+{
+	int delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
+
+	return delay - jiffies % delay;
+}
+
 static void do_dbs_timer(struct work_struct *work)
 {
 	int i;
 	mutex_lock(&dbs_mutex);
 	for_each_online_cpu(i)
 		dbs_check_cpu(i);
-	schedule_delayed_work(&dbs_work,
-			usecs_to_jiffies(dbs_tuners_ins.sampling_rate));
+	schedule_delayed_work(&dbs_work, dbs_timer_delay());
 	mutex_unlock(&dbs_mutex);
 }
 
 static inline void dbs_timer_init(void)
 {
-	init_timer_deferrable(&dbs_work.timer);
-	schedule_delayed_work(&dbs_work,
-			usecs_to_jiffies(dbs_tuners_ins.sampling_rate));
+	INIT_DELAYED_WORK_DEFERRABLE(&dbs_work, do_dbs_timer);
+	schedule_delayed_work(&dbs_work, dbs_timer_delay());
 	return;
 }
 
@@ -509,6 +533,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		}
 		this_dbs_info->enable = 1;
 		this_dbs_info->down_skip = 0;
+		this_dbs_info->prev_sample = jiffies;
 		this_dbs_info->requested_freq = policy->cur;
 
 		dbs_enable++;
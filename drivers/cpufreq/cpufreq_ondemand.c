@@ -34,6 +34,17 @@
 #define MIN_FREQUENCY_UP_THRESHOLD		(11)
 #define MAX_FREQUENCY_UP_THRESHOLD		(100)
 
+/*
+ * Transitions the driver reports as slow, usually because the CPU supply
+ * voltage has to change, are only made once the load has asked for them
+ * for cost_weight times the transition cost.  With the default a 500uS
+ * voltage ramp and a 20mS sampling rate hold the change off for one
+ * sample, so brief bursts don't swing the supply back and forth.
+ */
+#define DEF_COST_WEIGHT				(40)
+#define MAX_COST_WEIGHT				(1000)
+#define MAX_COST_SAMPLES			(10)
+
 /*
  * The polling frequency of this governor depends on the capability of
  * the processor. Default polling frequency is 1000 times the transition
@@ -70,6 +81,8 @@ struct cpu_dbs_info_s {
 	unsigned int freq_lo;
 	unsigned int freq_lo_jiffies;
 	unsigned int freq_hi_jiffies;
+	unsigned int up_samples;	/* consecutive samples wanting more */
+	unsigned int down_samples;	/* consecutive samples wanting less */
 	int cpu;
 	unsigned int enable:1,
 	             sample_type:1;
@@ -96,11 +109,13 @@ static struct dbs_tuners {
 	unsigned int down_differential;
 	unsigned int ignore_nice;
 	unsigned int powersave_bias;
+	unsigned int cost_weight;
 } dbs_tuners_ins = {
 	.up_threshold = DEF_FREQUENCY_UP_THRESHOLD,
 	.down_differential = DEF_FREQUENCY_DOWN_DIFFERENTIAL,
 	.ignore_nice = 0,
 	.powersave_bias = 0,
+	.cost_weight = DEF_COST_WEIGHT,
 };
 
 static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu,
@@ -211,6 +226,28 @@ static unsigned int powersave_bias_target(struct cpufreq_policy *policy,
 	return freq_hi;
 }
 
+/*
+ * Number of extra samples a change to freq must be asked for before it
+ * is made, in proportion to how long the driver says it takes.
+ */
+static unsigned int dbs_cost_samples(struct cpufreq_policy *policy,
+				     unsigned int freq)
+{
+	unsigned int cost, samples;
+
+	if (!dbs_tuners_ins.cost_weight)
+		return 0;
+
+	cost = __cpufreq_driver_transition_cost(policy, policy->cur, freq);
+	if (!cost)
+		return 0;
+
+	samples = cost * dbs_tuners_ins.cost_weight /
+		  dbs_tuners_ins.sampling_rate;
+
+	return min_t(unsigned int, samples, MAX_COST_SAMPLES);
+}
+
 static void ondemand_powersave_bias_init(void)
 {
 	int i;
@@ -250,6 +287,7 @@ show_one(sampling_rate, sampling_rate);
 show_one(up_threshold, up_threshold);
 show_one(ignore_nice_load, ignore_nice);
 show_one(powersave_bias, powersave_bias);
+show_one(cost_weight, cost_weight);
 
 static ssize_t store_sampling_rate(struct cpufreq_policy *unused,
 		const char *buf, size_t count)
@@ -346,6 +384,26 @@ static ssize_t store_powersave_bias(struct cpufreq_policy *unused,
 	return count;
 }
 
+static ssize_t store_cost_weight(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1)
+		return -EINVAL;
+
+	if (input > MAX_COST_WEIGHT)
+		input = MAX_COST_WEIGHT;
+
+	mutex_lock(&dbs_mutex);
+	dbs_tuners_ins.cost_weight = input;
+	mutex_unlock(&dbs_mutex);
+
+	return count;
+}
+
 #define define_one_rw(_name) \
 static struct freq_attr _name = \
 __ATTR(_name, 0644, show_##_name, store_##_name)
@@ -354,6 +412,7 @@ define_one_rw(sampling_rate);
 define_one_rw(up_threshold);
 define_one_rw(ignore_nice_load);
 define_one_rw(powersave_bias);
+define_one_rw(cost_weight);
 
 static struct attribute * dbs_attributes[] = {
 	&sampling_rate_max.attr,
@@ -362,6 +421,7 @@ static struct attribute * dbs_attributes[] = {
 	&up_threshold.attr,
 	&ignore_nice_load.attr,
 	&powersave_bias.attr,
+	&cost_weight.attr,
 	NULL
 };
 
@@ -395,6 +455,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	 * Any frequency increase takes it to the maximum frequency.
 	 * Frequency reduction happens at minimum steps of
 	 * 5% (default) of current frequency
+	 *
+	 * Either change is held off while the driver reports it as costly
+	 * until enough consecutive samples have asked for it, see
+	 * dbs_cost_samples().
 	 */
 
 	/* Get Absolute Load - in terms of freq */
@@ -422,6 +486,14 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (unlikely(!wall_time || wall_time < idle_time))
 			continue;
 
+		/*
+		 * A CPU idle for the whole period adds no load, so don't
+		 * ask the driver for its average frequency, which may mean
+		 * waking it up to read its counters.
+		 */
+		if (wall_time == idle_time)
+			continue;
+
 		load = 100 * (wall_time - idle_time) / wall_time;
 
 		freq_avg = __cpufreq_driver_getavg(policy, j);
@@ -435,26 +507,43 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 
 	/* Check for frequency increase */
 	if (max_load_freq > dbs_tuners_ins.up_threshold * policy->cur) {
+		this_dbs_info->down_samples = 0;
+
 		/* if we are already at full speed then break out early */
 		if (!dbs_tuners_ins.powersave_bias) {
 			if (policy->cur == policy->max)
 				return;
 
+			if (this_dbs_info->up_samples++ <
+			    dbs_cost_samples(policy, policy->max))
+				return;
+
 			__cpufreq_driver_target(policy, policy->max,
 				CPUFREQ_RELATION_H);
 		} else {
 			int freq = powersave_bias_target(policy, policy->max,
 					CPUFREQ_RELATION_H);
+
+			if (this_dbs_info->up_samples++ <
+			    dbs_cost_samples(policy, freq)) {
+				this_dbs_info->freq_lo = 0;
+				return;
+			}
+
 			__cpufreq_driver_target(policy, freq,
 				CPUFREQ_RELATION_L);
 		}
+		this_dbs_info->up_samples = 0;
 		return;
 	}
+	this_dbs_info->up_samples = 0;
 
 	/* Check for frequency decrease */
 	/* if we cannot reduce the frequency anymore, break out early */
-	if (policy->cur == policy->min)
+	if (policy->cur == policy->min) {
+		this_dbs_info->down_samples = 0;
 		return;
+	}
 
 	/*
 	 * The optimal frequency is the frequency that is the lowest that
@@ -470,14 +559,28 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 				 dbs_tuners_ins.down_differential);
 
 		if (!dbs_tuners_ins.powersave_bias) {
+			if (this_dbs_info->down_samples++ <
+			    dbs_cost_samples(policy, freq_next))
+				return;
+
 			__cpufreq_driver_target(policy, freq_next,
 					CPUFREQ_RELATION_L);
 		} else {
 			int freq = powersave_bias_target(policy, freq_next,
 					CPUFREQ_RELATION_L);
+
+			if (this_dbs_info->down_samples++ <
+			    dbs_cost_samples(policy, freq)) {
+				this_dbs_info->freq_lo = 0;
+				return;
+			}
+
 			__cpufreq_driver_target(policy, freq,
 				CPUFREQ_RELATION_L);
 		}
+		this_dbs_info->down_samples = 0;
+	} else {
+		this_dbs_info->down_samples = 0;
 	}
 }
 
@@ -527,6 +630,8 @@ static inline void dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
 	delay -= jiffies % delay;
 
 	dbs_info->enable = 1;
+	dbs_info->up_samples = 0;
+	dbs_info->down_samples = 0;
 	ondemand_powersave_bias_init();
 	dbs_info->sample_type = DBS_NORMAL_SAMPLE;
 	INIT_DELAYED_WORK_DEFERRABLE(&dbs_info->work, do_dbs_timer);
@@ -0,0 +1,337 @@
+/*
+ * linux/drivers/cpufreq/cpufreq_regulator.c
+ *
+ * Regulator based CPU voltage scaling helpers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/cpufreq.h>
+#include <linux/regulator/consumer.h>
+
+#define dprintk(msg...) \
+	cpufreq_debug_printk(CPUFREQ_DEBUG_DRIVER, "freq-regulator", msg)
+
+struct cpufreq_regulator {
+	struct regulator *regulator;
+	const struct cpufreq_opp *opp;
+	const struct cpufreq_opp *cur;	/* last voltage applied, NULL if none */
+
+	/* board specific switch, eg driving a PMIC DVS input */
+	int (*fast_switch)(void *data, const struct cpufreq_opp *opp);
+	void *fast_switch_data;
+
+	/* transition listener, see cpufreq_regulator_listen() */
+	struct notifier_block nb;
+	unsigned int cpu;
+	int listening;
+	int resync;	/* voltage unknown after a suspend or resume change */
+};
+
+/*********************************************************************
+ *                   REGULATOR VOLTAGE SCALING HELPERS               *
+ *********************************************************************/
+
+/* the slowest operating point able to run at freq */
+static const struct cpufreq_opp *
+cpufreq_opp_find(const struct cpufreq_opp *opp, unsigned int freq)
+{
+	const struct cpufreq_opp *best = NULL;
+	unsigned int i;
+
+	for (i = 0; opp[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (opp[i].frequency == CPUFREQ_ENTRY_INVALID ||
+		    opp[i].frequency < freq)
+			continue;
+		if (!best || opp[i].frequency < best->frequency)
+			best = &opp[i];
+	}
+
+	return best;
+}
+
+static int cpufreq_regulator_set(struct cpufreq_regulator *creg,
+				 unsigned int freq)
+{
+	const struct cpufreq_opp *opp;
+	int ret;
+
+	opp = cpufreq_opp_find(creg->opp, freq);
+	if (!opp) {
+		printk(KERN_ERR "%s: no operating point for %u kHz\n",
+		       __func__, freq);
+		return -EINVAL;
+	}
+
+	/* frequencies sharing a voltage range don't need to touch the
+	 * regulator, which may well be on a slow bus */
+	if (creg->cur && creg->cur->min_uV == opp->min_uV &&
+	    creg->cur->max_uV == opp->max_uV) {
+		creg->cur = opp;
+		return 0;
+	}
+
+	dprintk("%u kHz needs %d-%d uV\n", freq, opp->min_uV, opp->max_uV);
+
+	if (creg->fast_switch &&
+	    creg->fast_switch(creg->fast_switch_data, opp) == 0) {
+		creg->cur = opp;
+		return 0;
+	}
+
+	ret = regulator_set_voltage(creg->regulator, opp->min_uV, opp->max_uV);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to set %d-%d uV for %u kHz: %d\n",
+		       __func__, opp->min_uV, opp->max_uV, freq, ret);
+		return ret;
+	}
+
+	/* governors often step back to where they came from, so get
+	 * that voltage ready to switch to if the regulator can */
+	if (creg->cur)
+		regulator_preload_voltage(creg->regulator, creg->cur->min_uV,
+					  creg->cur->max_uV);
+
+	creg->cur = opp;
+	return 0;
+}
+
+/**
+ * cpufreq_regulator_get - get the CPU supply for voltage scaling
+ * @dev: device for the "vcc_cpu" supply, may be NULL
+ * @opp: operating points for the CPU, terminated by an entry with a
+ *       frequency of CPUFREQ_TABLE_END
+ *
+ * Returns a handle to pass to the other cpufreq_regulator helpers or
+ * an ERR_PTR() on failure.  The operating point table must stay valid
+ * until cpufreq_regulator_put() is called.
+ */
+struct cpufreq_regulator *cpufreq_regulator_get(struct device *dev,
+						const struct cpufreq_opp *opp)
+{
+	struct cpufreq_regulator *creg;
+
+	creg = kzalloc(sizeof(*creg), GFP_KERNEL);
+	if (creg == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	creg->opp = opp;
+	creg->regulator = regulator_get(dev, "vcc_cpu");
+	if (IS_ERR(creg->regulator)) {
+		struct regulator *regulator = creg->regulator;
+
+		kfree(creg);
+		return ERR_CAST(regulator);
+	}
+
+	return creg;
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_get);
+
+/**
+ * cpufreq_regulator_put - release the CPU supply
+ * @creg: handle from cpufreq_regulator_get()
+ */
+void cpufreq_regulator_put(struct cpufreq_regulator *creg)
+{
+	if (creg == NULL || IS_ERR(creg))
+		return;
+
+	cpufreq_regulator_unlisten(creg);
+	regulator_put(creg->regulator);
+	kfree(creg);
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_put);
+
+/**
+ * cpufreq_regulator_prechange - raise the CPU voltage before a transition
+ * @creg: handle from cpufreq_regulator_get()
+ * @freqs: the transition about to be made
+ *
+ * Call from ->target() before changing the CPU clock.  If the new
+ * frequency is higher than the old one the voltage it needs is applied
+ * here; the driver should abandon the transition if this fails.
+ */
+int cpufreq_regulator_prechange(struct cpufreq_regulator *creg,
+				struct cpufreq_freqs *freqs)
+{
+	if (freqs->new <= freqs->old)
+		return 0;
+
+	return cpufreq_regulator_set(creg, freqs->new);
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_prechange);
+
+/**
+ * cpufreq_regulator_postchange - lower the CPU voltage after a transition
+ * @creg: handle from cpufreq_regulator_get()
+ * @freqs: the transition just made
+ *
+ * Call from ->target() once the CPU clock has been changed.  If the new
+ * frequency is lower than the old one the voltage is reduced here.  A
+ * failure leaves the CPU running safely at the higher voltage.
+ */
+int cpufreq_regulator_postchange(struct cpufreq_regulator *creg,
+				 struct cpufreq_freqs *freqs)
+{
+	if (freqs->new >= freqs->old)
+		return 0;
+
+	return cpufreq_regulator_set(creg, freqs->new);
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_postchange);
+
+/**
+ * cpufreq_regulator_transition_cost - time taken to move the CPU supply
+ * @creg: handle from cpufreq_regulator_get()
+ * @old_freq: frequency in kHz to change from
+ * @new_freq: frequency in kHz to change to
+ *
+ * Returns the time in uS the supply takes to slew between the voltages
+ * needed by the two frequencies, or 0 if they share a voltage range or
+ * the regulator doesn't know its slew rate.  Suitable for use from the
+ * driver's ->transition_cost() operation.
+ */
+unsigned int cpufreq_regulator_transition_cost(struct cpufreq_regulator *creg,
+					       unsigned int old_freq,
+					       unsigned int new_freq)
+{
+	const struct cpufreq_opp *old, *new;
+	int ret;
+
+	old = cpufreq_opp_find(creg->opp, old_freq);
+	new = cpufreq_opp_find(creg->opp, new_freq);
+	if (!old || !new)
+		return 0;
+
+	if (old->min_uV == new->min_uV && old->max_uV == new->max_uV)
+		return 0;
+
+	ret = regulator_set_voltage_time(creg->regulator, old->min_uV,
+					 new->min_uV);
+	if (ret < 0)
+		return 0;
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_transition_cost);
+
+/**
+ * cpufreq_regulator_set_fast_switch - provide a faster way to switch
+ * @creg: handle from cpufreq_regulator_get()
+ * @fast_switch: called with each operating point to move to, returning
+ *               zero if it applied the voltage itself or an error to
+ *               have the regulator API used instead; NULL to remove
+ * @data: passed to @fast_switch
+ *
+ * For boards which can switch the CPU supply without going through
+ * the regulator API, such as by driving a GPIO wired to a WM8350 DVS
+ * input.  Regulators able to preload a voltage, like the DA9034 DVCs,
+ * are used at their fastest without this.
+ */
+void cpufreq_regulator_set_fast_switch(struct cpufreq_regulator *creg,
+	int (*fast_switch)(void *data, const struct cpufreq_opp *opp),
+	void *data)
+{
+	creg->fast_switch_data = data;
+	creg->fast_switch = fast_switch;
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_set_fast_switch);
+
+static int cpufreq_regulator_notify(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	struct cpufreq_regulator *creg =
+		container_of(nb, struct cpufreq_regulator, nb);
+	struct cpufreq_policy_freqs *freqs = data;
+
+	if (!cpu_isset(creg->cpu, *freqs->cpus))
+		return NOTIFY_DONE;
+
+	switch (val) {
+	case CPUFREQ_PRECHANGE:
+		/* after a resync the voltage must suit both frequencies */
+		if (creg->resync) {
+			creg->resync = 0;
+			cpufreq_regulator_set(creg, max(freqs->old, freqs->new));
+		} else if (freqs->new > freqs->old) {
+			cpufreq_regulator_set(creg, freqs->new);
+		}
+		break;
+	case CPUFREQ_POSTCHANGE:
+		if (freqs->new < freqs->old)
+			cpufreq_regulator_set(creg, freqs->new);
+		break;
+	case CPUFREQ_SUSPENDCHANGE:
+	case CPUFREQ_RESUMECHANGE:
+		/* The frequency changed behind our back, but these come
+		 * from sysdev suspend and resume with interrupts off and
+		 * the regulator's bus suspended, so the supply can't be
+		 * touched.  Forget what was applied and put it right on
+		 * the next transition.
+		 */
+		creg->cur = NULL;
+		creg->resync = 1;
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+/**
+ * cpufreq_regulator_listen - scale the CPU supply on every transition
+ * @creg: handle from cpufreq_regulator_get()
+ * @cpu: the CPU whose transitions the supply follows
+ *
+ * Registers a policy transition notifier which does the work of the
+ * prechange and postchange helpers for each frequency change of the
+ * policy covering @cpu, so cpufreq drivers need not do it themselves.
+ * The supply is moved once per transition however many CPUs share
+ * the clock.  Transition notifiers can't veto
+ * a change, so a driver which must not raise the frequency without
+ * the voltage should call the helpers from ->target() instead.
+ * Stopped by cpufreq_regulator_unlisten() or cpufreq_regulator_put().
+ */
+int cpufreq_regulator_listen(struct cpufreq_regulator *creg, unsigned int cpu)
+{
+	int ret;
+
+	if (creg->listening)
+		return -EBUSY;
+
+	creg->cpu = cpu;
+	creg->nb.notifier_call = cpufreq_regulator_notify;
+
+	ret = cpufreq_register_notifier(&creg->nb,
+					CPUFREQ_POLICY_TRANSITION_NOTIFIER);
+	if (ret == 0)
+		creg->listening = 1;
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_listen);
+
+/**
+ * cpufreq_regulator_unlisten - stop following CPU transitions
+ * @creg: handle from cpufreq_regulator_get()
+ */
+void cpufreq_regulator_unlisten(struct cpufreq_regulator *creg)
+{
+	if (!creg->listening)
+		return;
+
+	cpufreq_unregister_notifier(&creg->nb,
+				    CPUFREQ_POLICY_TRANSITION_NOTIFIER);
+	creg->listening = 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_regulator_unlisten);
+
+MODULE_DESCRIPTION ("CPUfreq regulator voltage scaling helpers");
+MODULE_LICENSE ("GPL");
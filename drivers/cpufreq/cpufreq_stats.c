@@ -15,13 +15,12 @@
 #include <linux/sysfs.h>
 #include <linux/cpufreq.h>
 #include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/hrtimer.h>
 #include <linux/percpu.h>
 #include <linux/kobject.h>
-#include <linux/spinlock.h>
+#include <linux/seqlock.h>
 #include <linux/notifier.h>
-#include <asm/cputime.h>
-
-static spinlock_t cpufreq_stats_lock;
 
 #define CPUFREQ_STATDEVICE_ATTR(_name,_mode,_show) \
 static struct freq_attr _attr_##_name = {\
@@ -29,14 +28,23 @@ static struct freq_attr _attr_##_name = {\
 	.show = _show,\
 };
 
+/*
+ * Statistics are kept for each policy, on its own CPU, and are only
+ * written by the policy transition notifier under a lock of their own,
+ * so policies changing frequency don't contend.
+ * Readers don't write anything back; they retry if a transition lands
+ * while they are reading and fold the time spent in the current state
+ * in themselves.  Times are kept in nanoseconds.
+ */
 struct cpufreq_stats {
 	unsigned int cpu;
+	seqlock_t lock;
 	unsigned int total_trans;
-	unsigned long long  last_time;
+	u64 last_time;
 	unsigned int max_state;
 	unsigned int state_num;
-	unsigned int last_index;
-	cputime64_t *time_in_state;
+	int last_index;
+	u64 *time_in_state;
 	unsigned int *freq_table;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
@@ -50,22 +58,19 @@ struct cpufreq_stats_attribute {
 	ssize_t(*show) (struct cpufreq_stats *, char *);
 };
 
-static int
-cpufreq_stats_update (unsigned int cpu)
+static inline u64 cpufreq_stats_now(void)
 {
-	struct cpufreq_stats *stat;
-	unsigned long long cur_time;
-
-	cur_time = get_jiffies_64();
-	spin_lock(&cpufreq_stats_lock);
-	stat = per_cpu(cpufreq_stats_table, cpu);
-	if (stat->time_in_state)
-		stat->time_in_state[stat->last_index] =
-			cputime64_add(stat->time_in_state[stat->last_index],
-				      cputime_sub(cur_time, stat->last_time));
+	return ktime_to_ns(ktime_get());
+}
+
+/* called with the stat lock held for writing */
+static void
+cpufreq_stats_update (struct cpufreq_stats *stat, u64 cur_time)
+{
+	if (stat->last_index >= 0)
+		stat->time_in_state[stat->last_index] +=
+			cur_time - stat->last_time;
 	stat->last_time = cur_time;
-	spin_unlock(&cpufreq_stats_lock);
-	return 0;
 }
 
 static ssize_t
@@ -74,37 +79,44 @@ show_total_trans(struct cpufreq_policy *policy, char *buf)
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	return sprintf(buf, "%d\n",
-			per_cpu(cpufreq_stats_table, stat->cpu)->total_trans);
+	return sprintf(buf, "%d\n", stat->total_trans);
 }
 
 static ssize_t
 show_time_in_state(struct cpufreq_policy *policy, char *buf)
 {
-	ssize_t len = 0;
+	ssize_t len;
 	int i;
+	unsigned seq;
+	u64 time, now;
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	cpufreq_stats_update(stat->cpu);
-	for (i = 0; i < stat->state_num; i++) {
-		len += sprintf(buf + len, "%u %llu\n", stat->freq_table[i],
-			(unsigned long long)cputime64_to_clock_t(stat->time_in_state[i]));
-	}
+	do {
+		seq = read_seqbegin(&stat->lock);
+		now = cpufreq_stats_now();
+		len = 0;
+		for (i = 0; i < stat->state_num; i++) {
+			time = stat->time_in_state[i];
+			if (i == stat->last_index)
+				time += now - stat->last_time;
+			/* nsec_to_clock_t() isn't exported to modules */
+			len += sprintf(buf + len, "%u %llu\n",
+				stat->freq_table[i],
+				(unsigned long long)div_u64(time,
+					NSEC_PER_SEC / USER_HZ));
+		}
+	} while (read_seqretry(&stat->lock, seq));
 	return len;
 }
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t
-show_trans_table(struct cpufreq_policy *policy, char *buf)
+cpufreq_stats_show_trans(struct cpufreq_stats *stat, char *buf)
 {
 	ssize_t len = 0;
 	int i, j;
 
-	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
-	if (!stat)
-		return 0;
-	cpufreq_stats_update(stat->cpu);
 	len += snprintf(buf + len, PAGE_SIZE - len, "   From  :    To\n");
 	len += snprintf(buf + len, PAGE_SIZE - len, "         : ");
 	for (i = 0; i < stat->state_num; i++) {
@@ -139,6 +151,22 @@ show_trans_table(struct cpufreq_policy *policy, char *buf)
 		return PAGE_SIZE;
 	return len;
 }
+
+static ssize_t
+show_trans_table(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len;
+	unsigned seq;
+
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	do {
+		seq = read_seqbegin(&stat->lock);
+		len = cpufreq_stats_show_trans(stat, buf);
+	} while (read_seqretry(&stat->lock, seq));
+	return len;
+}
 CPUFREQ_STATDEVICE_ATTR(trans_table,0444,show_trans_table);
 #endif
 
@@ -207,6 +235,7 @@ cpufreq_stats_create_table (struct cpufreq_policy *policy,
 		goto error_out;
 
 	stat->cpu = cpu;
+	seqlock_init(&stat->lock);
 	per_cpu(cpufreq_stats_table, cpu) = stat;
 
 	for (i=0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -216,7 +245,7 @@ cpufreq_stats_create_table (struct cpufreq_policy *policy,
 		count++;
 	}
 
-	alloc_size = count * sizeof(int) + count * sizeof(cputime64_t);
+	alloc_size = count * sizeof(int) + count * sizeof(u64);
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
@@ -241,10 +270,10 @@ cpufreq_stats_create_table (struct cpufreq_policy *policy,
 			stat->freq_table[j++] = freq;
 	}
 	stat->state_num = j;
-	spin_lock(&cpufreq_stats_lock);
-	stat->last_time = get_jiffies_64();
+	write_seqlock(&stat->lock);
+	stat->last_time = cpufreq_stats_now();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
-	spin_unlock(&cpufreq_stats_lock);
+	write_sequnlock(&stat->lock);
 	cpufreq_cpu_put(data);
 	return 0;
 error_out:
@@ -277,34 +306,32 @@ static int
 cpufreq_stat_notifier_trans (struct notifier_block *nb, unsigned long val,
 		void *data)
 {
-	struct cpufreq_freqs *freq = data;
+	struct cpufreq_policy_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	u64 now;
 
 	if (val != CPUFREQ_POSTCHANGE)
 		return 0;
 
-	stat = per_cpu(cpufreq_stats_table, freq->cpu);
+	stat = per_cpu(cpufreq_stats_table, freq->policy->cpu);
 	if (!stat)
 		return 0;
 
-	old_index = stat->last_index;
+	now = cpufreq_stats_now();
 	new_index = freq_table_get_index(stat, freq->new);
 
-	cpufreq_stats_update(freq->cpu);
-	if (old_index == new_index)
-		return 0;
-
-	if (old_index == -1 || new_index == -1)
-		return 0;
-
-	spin_lock(&cpufreq_stats_lock);
-	stat->last_index = new_index;
+	write_seqlock(&stat->lock);
+	old_index = stat->last_index;
+	cpufreq_stats_update(stat, now);
+	if (old_index != new_index && old_index != -1 && new_index != -1) {
+		stat->last_index = new_index;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table[old_index * stat->max_state + new_index]++;
+		stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
-	stat->total_trans++;
-	spin_unlock(&cpufreq_stats_lock);
+		stat->total_trans++;
+	}
+	write_sequnlock(&stat->lock);
 	return 0;
 }
 
@@ -346,13 +373,12 @@ __init cpufreq_stats_init(void)
 	int ret;
 	unsigned int cpu;
 
-	spin_lock_init(&cpufreq_stats_lock);
 	if ((ret = cpufreq_register_notifier(&notifier_policy_block,
 				CPUFREQ_POLICY_NOTIFIER)))
 		return ret;
 
 	if ((ret = cpufreq_register_notifier(&notifier_trans_block,
-				CPUFREQ_TRANSITION_NOTIFIER))) {
+				CPUFREQ_POLICY_TRANSITION_NOTIFIER))) {
 		cpufreq_unregister_notifier(&notifier_policy_block,
 				CPUFREQ_POLICY_NOTIFIER);
 		return ret;
@@ -372,7 +398,7 @@ __exit cpufreq_stats_exit(void)
 	cpufreq_unregister_notifier(&notifier_policy_block,
 			CPUFREQ_POLICY_NOTIFIER);
 	cpufreq_unregister_notifier(&notifier_trans_block,
-			CPUFREQ_TRANSITION_NOTIFIER);
+			CPUFREQ_POLICY_TRANSITION_NOTIFIER);
 	unregister_hotcpu_notifier(&cpufreq_stat_cpu_notifier);
 	for_each_online_cpu(cpu) {
 		cpufreq_stats_free_table(cpu);
@@ -13,6 +13,8 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/cpufreq.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 
 #define dprintk(msg...) \
 	cpufreq_debug_printk(CPUFREQ_DEBUG_CORE, "freq-table", msg)
@@ -21,6 +23,143 @@
  *                     FREQUENCY TABLE HELPERS                       *
  *********************************************************************/
 
+/*
+ * The valid entries of a table sorted by frequency, built when the table
+ * is registered with cpufreq_frequency_table_cpuinfo() so that the lookup
+ * done by cpufreq_frequency_table_target() on every governor decision
+ * can be a binary search rather than a scan of the whole table.
+ */
+struct cpufreq_sorted_entry {
+	unsigned int	frequency;
+	unsigned int	pos;		/* position in the driver's table */
+};
+
+struct cpufreq_table_index {
+	struct cpufreq_frequency_table *table;
+	unsigned int count;
+	struct cpufreq_sorted_entry entries[0];
+};
+
+static DEFINE_PER_CPU(struct cpufreq_table_index *, table_index);
+
+static int cpufreq_sorted_cmp(const void *a, const void *b)
+{
+	const struct cpufreq_sorted_entry *x = a, *y = b;
+
+	if (x->frequency != y->frequency)
+		return x->frequency < y->frequency ? -1 : 1;
+	return x->pos < y->pos ? -1 : x->pos > y->pos;
+}
+
+static void cpufreq_table_index_free(unsigned int cpu)
+{
+	kfree(per_cpu(table_index, cpu));
+	per_cpu(table_index, cpu) = NULL;
+}
+
+static void cpufreq_table_index_build(unsigned int cpu,
+				      struct cpufreq_frequency_table *table)
+{
+	struct cpufreq_table_index *idx;
+	unsigned int i, count = 0;
+
+	cpufreq_table_index_free(cpu);
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++)
+		if (table[i].frequency != CPUFREQ_ENTRY_INVALID)
+			count++;
+
+	/* lookups fall back to scanning the table if this fails */
+	idx = kmalloc(sizeof(*idx) + count * sizeof(idx->entries[0]),
+		      GFP_KERNEL);
+	if (!idx)
+		return;
+
+	idx->table = table;
+	idx->count = 0;
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+		idx->entries[idx->count].frequency = table[i].frequency;
+		idx->entries[idx->count].pos = i;
+		idx->count++;
+	}
+
+	sort(idx->entries, idx->count, sizeof(idx->entries[0]),
+	     cpufreq_sorted_cmp, NULL);
+
+	per_cpu(table_index, cpu) = idx;
+}
+
+/* number of sorted entries at or below freq */
+static unsigned int cpufreq_sorted_count_le(struct cpufreq_table_index *idx,
+					    unsigned int freq)
+{
+	unsigned int lo = 0, hi = idx->count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (idx->entries[mid].frequency <= freq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* number of sorted entries below freq */
+static unsigned int cpufreq_sorted_count_lt(struct cpufreq_table_index *idx,
+					    unsigned int freq)
+{
+	return freq ? cpufreq_sorted_count_le(idx, freq - 1) : 0;
+}
+
+/*
+ * Same choice as the scan in cpufreq_frequency_table_target(), including
+ * taking the last of any entries with the same frequency.
+ */
+static int cpufreq_sorted_target(struct cpufreq_policy *policy,
+				 struct cpufreq_table_index *idx,
+				 unsigned int target_freq,
+				 unsigned int relation,
+				 unsigned int *index)
+{
+	unsigned int lo, hi, n, freq;
+
+	/* entries [lo, hi) are within the policy limits */
+	lo = cpufreq_sorted_count_lt(idx, policy->min);
+	hi = cpufreq_sorted_count_le(idx, policy->max);
+	if (lo >= hi)
+		return -EINVAL;
+
+	switch (relation) {
+	case CPUFREQ_RELATION_H:
+		n = clamp(cpufreq_sorted_count_le(idx, target_freq), lo, hi);
+		if (n > lo) {
+			*index = idx->entries[n - 1].pos;
+			return 0;
+		}
+		/* nothing at or below the target, use the lowest above */
+		freq = idx->entries[lo].frequency;
+		break;
+	case CPUFREQ_RELATION_L:
+		n = clamp(cpufreq_sorted_count_lt(idx, target_freq), lo, hi);
+		if (n < hi) {
+			freq = idx->entries[n].frequency;
+			break;
+		}
+		/* nothing at or above the target, use the highest below */
+		*index = idx->entries[hi - 1].pos;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+
+	*index = idx->entries[cpufreq_sorted_count_le(idx, freq) - 1].pos;
+	return 0;
+}
+
 int cpufreq_frequency_table_cpuinfo(struct cpufreq_policy *policy,
 				    struct cpufreq_frequency_table *table)
 {
@@ -48,8 +187,10 @@ int cpufreq_frequency_table_cpuinfo(struct cpufreq_policy *policy,
 
 	if (policy->min == ~0)
 		return -EINVAL;
-	else
-		return 0;
+
+	cpufreq_table_index_build(policy->cpu, table);
+
+	return 0;
 }
 EXPORT_SYMBOL_GPL(cpufreq_frequency_table_cpuinfo);
 
@@ -108,11 +249,23 @@ int cpufreq_frequency_table_target(struct cpufreq_policy *policy,
 		.index = ~0,
 		.frequency = 0,
 	};
+	struct cpufreq_table_index *idx;
 	unsigned int i;
 
 	dprintk("request for target %u kHz (relation: %u) for cpu %u\n",
 					target_freq, relation, policy->cpu);
 
+	if (!cpu_online(policy->cpu))
+		return -EINVAL;
+
+	idx = per_cpu(table_index, policy->cpu);
+	if (idx && idx->table == table) {
+		if (cpufreq_sorted_target(policy, idx, target_freq, relation,
+					  index))
+			return -EINVAL;
+		goto found;
+	}
+
 	switch (relation) {
 	case CPUFREQ_RELATION_H:
 		suboptimal.frequency = ~0;
@@ -122,9 +275,6 @@ int cpufreq_frequency_table_target(struct cpufreq_policy *policy,
 		break;
 	}
 
-	if (!cpu_online(policy->cpu))
-		return -EINVAL;
-
 	for (i=0; (table[i].frequency != CPUFREQ_TABLE_END); i++) {
 		unsigned int freq = table[i].frequency;
 		if (freq == CPUFREQ_ENTRY_INVALID)
@@ -167,6 +317,7 @@ int cpufreq_frequency_table_target(struct cpufreq_policy *policy,
 	} else
 		*index = optimal.index;
 
+found:
 	dprintk("target is %u (%u kHz, %u)\n", *index, table[*index].frequency,
 		table[*index].index);
 
@@ -225,6 +376,7 @@ void cpufreq_frequency_table_put_attr(unsigned int cpu)
 {
 	dprintk("clearing show_table for cpu %u\n", cpu);
 	per_cpu(show_table, cpu) = NULL;
+	cpufreq_table_index_free(cpu);
 }
 EXPORT_SYMBOL_GPL(cpufreq_frequency_table_put_attr);
 
@@ -74,6 +74,7 @@ static void cpuidle_idle_call(void)
 	hrtimer_peek_ahead_timers();
 #endif
 	/* ask the governor for the next state */
+	dev->regulator_mode = 0;
 	next_state = cpuidle_curr_governor->select(dev);
 	if (need_resched())
 		return;
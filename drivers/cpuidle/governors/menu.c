@@ -27,6 +27,22 @@ struct menu_device {
 
 static DEFINE_PER_CPU(struct menu_device, menu_devices);
 
+/*
+ * Only drop the CPU rail into its low power mode when we expect to stay
+ * idle for long enough to recover the cost of switching it, and the
+ * extra wakeup latency is acceptable.
+ */
+static int menu_regulator_worthwhile(struct menu_device *data,
+				     struct cpuidle_state *s, int latency_req)
+{
+	if (!s->regulator_mode)
+		return 0;
+
+	return s->regulator_residency <= data->expected_us &&
+		s->regulator_residency <= data->predicted_us &&
+		s->exit_latency + s->regulator_latency <= latency_req;
+}
+
 /**
  * menu_select - selects the next idle state to enter
  * @dev: the CPU
@@ -60,6 +76,9 @@ static int menu_select(struct cpuidle_device *dev)
 	}
 
 	data->last_state_idx = i - 1;
+	if (menu_regulator_worthwhile(data, &dev->states[i - 1], latency_req))
+		dev->regulator_mode = dev->states[i - 1].regulator_mode;
+
 	return i - 1;
 }
 
@@ -76,8 +95,12 @@ static void menu_reflect(struct cpuidle_device *dev)
 	int last_idx = data->last_state_idx;
 	unsigned int last_idle_us = cpuidle_get_last_residency(dev);
 	struct cpuidle_state *target = &dev->states[last_idx];
+	unsigned int exit_latency = target->exit_latency;
 	unsigned int measured_us;
 
+	if (dev->regulator_mode)
+		exit_latency += target->regulator_latency;
+
 	/*
 	 * Ugh, this idle state doesn't support residency measurements, so we
 	 * are basically lost in the dark.  As a compromise, assume we slept
@@ -100,7 +123,7 @@ static void menu_reflect(struct cpuidle_device *dev)
 	data->predicted_us = max(measured_us, data->last_measured_us);
 
 	if (last_idle_us + BREAK_FUZZ <
-	    data->expected_us - target->exit_latency) {
+	    data->expected_us - exit_latency) {
 		data->last_measured_us = measured_us;
 		data->elapsed_us = 0;
 	} else {
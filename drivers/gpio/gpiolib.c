@@ -2,6 +2,7 @@
 #include <linux/module.h>
 #include <linux/irq.h>
 #include <linux/spinlock.h>
+#include <linux/bitmap.h>
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/debugfs.h>
@@ -1120,6 +1121,107 @@ void gpio_set_value_cansleep(unsigned gpio, int value)
 EXPORT_SYMBOL_GPL(gpio_set_value_cansleep);
 
 
+/* Batched access lets expanders read or write all the affected pins in
+ * one bus transaction, instead of one per pin.  Runs of consecutive
+ * entries on the same chip are handed to the chip as a single batch,
+ * so callers should group their GPIOs by chip.
+ */
+
+/* fills mask (and bits, from values) for the run starting at gpios[i] */
+static unsigned gpio_batch(struct gpio_chip *chip, unsigned i, unsigned ngpio,
+			   const unsigned *gpios, const int *values,
+			   unsigned long *mask, unsigned long *bits)
+{
+	bitmap_zero(mask, chip->ngpio);
+	bitmap_zero(bits, chip->ngpio);
+
+	for (; i < ngpio && gpio_to_chip(gpios[i]) == chip; i++) {
+		unsigned offset = gpios[i] - chip->base;
+
+		__set_bit(offset, mask);
+		if (values && values[i])
+			__set_bit(offset, bits);
+	}
+
+	return i;
+}
+
+/**
+ * gpio_get_multiple_cansleep() - read several gpios
+ * @ngpio: number of gpios
+ * @gpios: the gpios to read (already requested)
+ * @values: filled in with zero or nonzero for each of @gpios
+ * Context: may sleep
+ *
+ * Returns zero, or a negative errno if a chip reported a failure.
+ */
+int gpio_get_multiple_cansleep(unsigned ngpio, const unsigned *gpios,
+			       int *values)
+{
+	DECLARE_BITMAP(mask, ARCH_NR_GPIOS);
+	DECLARE_BITMAP(bits, ARCH_NR_GPIOS);
+	struct gpio_chip	*chip;
+	unsigned		i, j, end;
+	int			status;
+
+	might_sleep_if(extra_checks);
+
+	for (i = 0; i < ngpio; i = end) {
+		chip = gpio_to_chip(gpios[i]);
+		end = gpio_batch(chip, i, ngpio, gpios, NULL, mask, bits);
+
+		if (chip->get_multiple) {
+			status = chip->get_multiple(chip, mask, bits);
+			if (status < 0)
+				return status;
+			for (j = i; j < end; j++)
+				values[j] = test_bit(gpios[j] - chip->base,
+						     bits);
+			continue;
+		}
+
+		for (j = i; j < end; j++)
+			values[j] = chip->get
+				? chip->get(chip, gpios[j] - chip->base) : 0;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpio_get_multiple_cansleep);
+
+/**
+ * gpio_set_multiple_cansleep() - assign values to several gpios
+ * @ngpio: number of gpios
+ * @gpios: the gpios to assign (already requested as outputs)
+ * @values: the value to assign to each of @gpios
+ * Context: may sleep
+ */
+void gpio_set_multiple_cansleep(unsigned ngpio, const unsigned *gpios,
+				const int *values)
+{
+	DECLARE_BITMAP(mask, ARCH_NR_GPIOS);
+	DECLARE_BITMAP(bits, ARCH_NR_GPIOS);
+	struct gpio_chip	*chip;
+	unsigned		i, j, end;
+
+	might_sleep_if(extra_checks);
+
+	for (i = 0; i < ngpio; i = end) {
+		chip = gpio_to_chip(gpios[i]);
+		end = gpio_batch(chip, i, ngpio, gpios, values, mask, bits);
+
+		if (chip->set_multiple) {
+			chip->set_multiple(chip, mask, bits);
+			continue;
+		}
+
+		for (j = i; j < end; j++)
+			chip->set(chip, gpios[j] - chip->base, values[j]);
+	}
+}
+EXPORT_SYMBOL_GPL(gpio_set_multiple_cansleep);
+
+
 #ifdef CONFIG_DEBUG_FS
 
 static void gpiolib_dbg_show(struct seq_file *s, struct gpio_chip *chip)
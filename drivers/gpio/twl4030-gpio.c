@@ -151,22 +151,10 @@ static int twl4030_set_gpio_direction(int gpio, int is_input)
 {
 	u8 d_bnk = gpio >> 3;
 	u8 d_msk = BIT(gpio & 0x7);
-	u8 reg = 0;
 	u8 base = REG_GPIODATADIR1 + d_bnk;
-	int ret = 0;
-
-	mutex_lock(&gpio_lock);
-	ret = gpio_twl4030_read(base);
-	if (ret >= 0) {
-		if (is_input)
-			reg = ret & ~d_msk;
-		else
-			reg = ret | d_msk;
 
-		ret = gpio_twl4030_write(base, reg);
-	}
-	mutex_unlock(&gpio_lock);
-	return ret;
+	return twl4030_i2c_update_bits(TWL4030_MODULE_GPIO, d_msk,
+			is_input ? 0 : d_msk, base);
 }
 
 static int twl4030_set_gpio_dataout(int gpio, int enable)
@@ -209,27 +197,15 @@ int twl4030_set_gpio_debounce(int gpio, int enable)
 {
 	u8 d_bnk = gpio >> 3;
 	u8 d_msk = BIT(gpio & 0x7);
-	u8 reg = 0;
 	u8 base = 0;
-	int ret = 0;
 
 	if (unlikely((gpio >= TWL4030_GPIO_MAX)
 		|| !(gpio_usage_count & BIT(gpio))))
 		return -EPERM;
 
 	base = REG_GPIO_DEBEN1 + d_bnk;
-	mutex_lock(&gpio_lock);
-	ret = gpio_twl4030_read(base);
-	if (ret >= 0) {
-		if (enable)
-			reg = ret | d_msk;
-		else
-			reg = ret & ~d_msk;
-
-		ret = gpio_twl4030_write(base, reg);
-	}
-	mutex_unlock(&gpio_lock);
-	return ret;
+	return twl4030_i2c_update_bits(TWL4030_MODULE_GPIO, d_msk,
+			enable ? d_msk : 0, base);
 }
 EXPORT_SYMBOL(twl4030_set_gpio_debounce);
 
@@ -358,6 +334,57 @@ static void twl_set(struct gpio_chip *chip, unsigned offset, int value)
 		twl4030_led_set_value(offset - TWL4030_GPIO_MAX, value);
 }
 
+/* all the GPIO data registers of a kind are read or written in one go */
+static int twl_get_multiple(struct gpio_chip *chip, unsigned long *mask,
+		unsigned long *bits)
+{
+	u32 gpios = *mask & GPIO_32_MASK;
+	u8 data[3];
+	int status;
+
+	*bits = 0;
+	if (gpios) {
+		status = twl4030_i2c_read(TWL4030_MODULE_GPIO, data,
+				REG_GPIODATAIN1, sizeof data);
+		if (status < 0)
+			return status;
+		*bits = (data[0] | (data[1] << 8) | (data[2] << 16)) & gpios;
+	}
+
+	if (test_bit(TWL4030_GPIO_MAX, mask) && (cached_leden & LEDEN_LEDAON))
+		__set_bit(TWL4030_GPIO_MAX, bits);
+	if (test_bit(TWL4030_GPIO_MAX + 1, mask)
+			&& (cached_leden & LEDEN_LEDBON))
+		__set_bit(TWL4030_GPIO_MAX + 1, bits);
+
+	return 0;
+}
+
+static void twl_write_dataout(u8 base, u32 gpios)
+{
+	/* offset 0 is used by i2c_write; zero bits leave the pin alone */
+	u8 data[4] = { 0, gpios, gpios >> 8, gpios >> 16 };
+
+	twl4030_i2c_write(TWL4030_MODULE_GPIO, data, base, 3);
+}
+
+static void twl_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+		unsigned long *bits)
+{
+	u32 gpios = *mask & GPIO_32_MASK;
+	int led;
+
+	if (gpios & *bits)
+		twl_write_dataout(REG_SETGPIODATAOUT1, gpios & *bits);
+	if (gpios & ~*bits)
+		twl_write_dataout(REG_CLEARGPIODATAOUT1, gpios & ~*bits);
+
+	for (led = 0; led < 2; led++)
+		if (test_bit(TWL4030_GPIO_MAX + led, mask))
+			twl4030_led_set_value(led,
+				test_bit(TWL4030_GPIO_MAX + led, bits));
+}
+
 static int twl_to_irq(struct gpio_chip *chip, unsigned offset)
 {
 	return (twl4030_gpio_irq_base && (offset < TWL4030_GPIO_MAX))
@@ -374,6 +401,8 @@ static struct gpio_chip twl_gpiochip = {
 	.get			= twl_get,
 	.direction_output	= twl_direction_out,
 	.set			= twl_set,
+	.get_multiple		= twl_get_multiple,
+	.set_multiple		= twl_set_multiple,
 	.to_irq			= twl_to_irq,
 	.can_sleep		= 1,
 };
@@ -405,6 +434,40 @@ static int __devinit gpio_twl4030_pulls(u32 ups, u32 downs)
 				REG_GPIOPUPDCTR1, 5);
 }
 
+/*
+ * Registers the chip changes on its own: the input levels, the output
+ * levels (the SET/CLEAR strobes update them) and the interrupt status.
+ * Everything else in the block is configuration the host owns, so the
+ * core can cache it and skip the read half of direction, debounce and
+ * IRQ mask updates.
+ */
+static const u8 gpio_twl4030_volatile_regs[] = {
+	REG_GPIODATAIN1, REG_GPIODATAIN2, REG_GPIODATAIN3,
+	REG_GPIODATAOUT1, REG_GPIODATAOUT2, REG_GPIODATAOUT3,
+	REG_CLEARGPIODATAOUT1, REG_CLEARGPIODATAOUT2, REG_CLEARGPIODATAOUT3,
+	REG_SETGPIODATAOUT1, REG_SETGPIODATAOUT2, REG_SETGPIODATAOUT3,
+	REG_GPIO_ISR1A, REG_GPIO_ISR2A, REG_GPIO_ISR3A,
+	REG_GPIO_ISR1B, REG_GPIO_ISR2B, REG_GPIO_ISR3B,
+};
+
+#define GPIO_NUM_REGS	(REG_GPIO_SIH_CTRL + 1)
+
+static DECLARE_BITMAP(gpio_volatile, GPIO_NUM_REGS);
+
+static void gpio_twl4030_cache_init(struct device *dev)
+{
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(gpio_twl4030_volatile_regs); i++)
+		__set_bit(gpio_twl4030_volatile_regs[i], gpio_volatile);
+
+	/* everything still works without the cache, just more slowly */
+	ret = twl4030_i2c_cache_init(TWL4030_MODULE_GPIO, GPIO_NUM_REGS,
+			gpio_volatile);
+	if (ret < 0)
+		dev_dbg(dev, "no register cache, %d\n", ret);
+}
+
 static int gpio_twl4030_remove(struct platform_device *pdev);
 
 static int __devinit gpio_twl4030_probe(struct platform_device *pdev)
@@ -412,6 +475,8 @@ static int __devinit gpio_twl4030_probe(struct platform_device *pdev)
 	struct twl4030_gpio_platform_data *pdata = pdev->dev.platform_data;
 	int ret;
 
+	gpio_twl4030_cache_init(&pdev->dev);
+
 	/* maybe setup IRQs */
 	if (pdata->irq_base) {
 		if (is_module()) {
@@ -486,8 +551,10 @@ static int __devexit gpio_twl4030_remove(struct platform_device *pdev)
 	if (status < 0)
 		return status;
 
-	if (is_module())
+	if (is_module()) {
+		twl4030_i2c_cache_exit(TWL4030_MODULE_GPIO);
 		return 0;
+	}
 
 	/* REVISIT no support yet for deregistering all the IRQs */
 	WARN_ON(1);
@@ -118,6 +118,13 @@ struct pxa_i2c {
  */
 #define I2C_PXA_SLAVE_ADDR      0x1
 
+/*
+ * The bus is normally free again within a few microseconds of the STOP
+ * ending the previous transfer, so poll for this long before sleeping
+ * rather than losing a whole tick on each of a run of short transfers.
+ */
+#define I2C_PXA_SPIN_US		200
+
 #ifdef DEBUG
 
 struct bits {
@@ -255,6 +262,10 @@ static void i2c_pxa_abort(struct pxa_i2c *i2c)
 static int i2c_pxa_wait_bus_not_busy(struct pxa_i2c *i2c)
 {
 	int timeout = DEF_TIMEOUT;
+	int spin = I2C_PXA_SPIN_US;
+
+	while (spin-- && readl(_ISR(i2c)) & (ISR_IBB | ISR_UB))
+		udelay(1);
 
 	while (timeout-- && readl(_ISR(i2c)) & (ISR_IBB | ISR_UB)) {
 		if ((readl(_ISR(i2c)) & ISR_SAD) != 0)
@@ -273,6 +284,12 @@ static int i2c_pxa_wait_bus_not_busy(struct pxa_i2c *i2c)
 static int i2c_pxa_wait_master(struct pxa_i2c *i2c)
 {
 	unsigned long timeout = jiffies + HZ*4;
+	int spin = I2C_PXA_SPIN_US;
+
+	while (spin-- && !(readl(_ISR(i2c)) & ISR_SAD) &&
+	       ((readl(_ISR(i2c)) & (ISR_UB | ISR_IBB)) ||
+		readl(_IBMR(i2c)) != 3))
+		udelay(1);
 
 	while (time_before(jiffies, timeout)) {
 		if (i2c_debug > 1)
@@ -34,6 +34,9 @@
 #include <linux/completion.h>
 #include <linux/hardirq.h>
 #include <linux/irqflags.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/uaccess.h>
 
 #include "i2c-core.h"
@@ -42,6 +45,9 @@
 static DEFINE_MUTEX(core_lock);
 static DEFINE_IDR(i2c_adapter_idr);
 
+/* runs i2c_transfer_async() transactions for all adapters */
+static struct workqueue_struct *i2c_async_wq;
+
 #define is_newstyle_driver(d) ((d)->probe || (d)->remove || (d)->detect)
 
 static int i2c_detect(struct i2c_adapter *adapter, struct i2c_driver *driver);
@@ -436,6 +442,270 @@ static int i2c_do_add_adapter(struct device_driver *d, void *data)
 	return 0;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Transfer statistics, updated with the bus locked */
+
+#ifdef CONFIG_I2C_STATS
+
+/* master_xfer() durations: bucket n counts those under 2^n us */
+#define I2C_STATS_BUCKETS	16
+
+struct i2c_addr_stats {
+	unsigned long	messages;
+	unsigned long	bytes;
+	unsigned long	errors;
+	unsigned long	naks;
+};
+
+struct i2c_adapter_stats {
+	unsigned long	transfers;
+	unsigned long	messages;
+	unsigned long	bytes;
+	unsigned long	errors;
+	unsigned long	naks;
+	u64		lock_wait_ns;
+	u64		xfer_ns;
+	unsigned long	xfer_hist[I2C_STATS_BUCKETS];
+
+	/* per client, by 7-bit address */
+	struct i2c_addr_stats addr[128];
+
+	struct dentry	*debugfs;
+};
+
+static struct dentry *i2c_debugfs_root;
+
+static void i2c_bus_lock(struct i2c_adapter *adap)
+{
+	ktime_t start = ktime_get();
+
+	mutex_lock_nested(&adap->bus_lock, adap->level);
+
+	if (adap->stats)
+		adap->stats->lock_wait_ns +=
+			ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static void i2c_stats_account(struct i2c_adapter *adap, struct i2c_msg *msgs,
+			      int num, int ret, s64 ns)
+{
+	struct i2c_adapter_stats *stats = adap->stats;
+	struct i2c_addr_stats *addr;
+	unsigned long us;
+	int i;
+
+	stats->transfers++;
+	stats->xfer_ns += ns;
+
+	us = div_u64(ns, NSEC_PER_USEC);
+	stats->xfer_hist[min_t(int, fls_long(us), I2C_STATS_BUCKETS - 1)]++;
+
+	for (i = 0; i < num; i++) {
+		stats->messages++;
+		stats->bytes += msgs[i].len;
+
+		if (msgs[i].flags & I2C_M_TEN || msgs[i].addr >= 128)
+			continue;
+		addr = &stats->addr[msgs[i].addr];
+		addr->messages++;
+		addr->bytes += msgs[i].len;
+	}
+
+	if (ret >= 0)
+		return;
+
+	/* blame the first address for the whole transfer */
+	addr = NULL;
+	if (!(msgs[0].flags & I2C_M_TEN) && msgs[0].addr < 128)
+		addr = &stats->addr[msgs[0].addr];
+
+	stats->errors++;
+	if (addr)
+		addr->errors++;
+	if (ret == -ENXIO) {
+		stats->naks++;
+		if (addr)
+			addr->naks++;
+	}
+}
+
+static int i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
+			   int num)
+{
+	ktime_t start;
+	int ret;
+
+	if (!adap->stats)
+		return adap->algo->master_xfer(adap, msgs, num);
+
+	start = ktime_get();
+	ret = adap->algo->master_xfer(adap, msgs, num);
+	i2c_stats_account(adap, msgs, num, ret,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	return ret;
+}
+
+static int i2c_stats_show(struct seq_file *s, void *data)
+{
+	struct i2c_adapter *adap = s->private;
+	struct i2c_adapter_stats *stats = adap->stats;
+	struct i2c_client *client;
+	int i;
+
+	seq_printf(s, "transfers: %lu\n", stats->transfers);
+	seq_printf(s, "messages: %lu\n", stats->messages);
+	seq_printf(s, "bytes: %lu\n", stats->bytes);
+	seq_printf(s, "errors: %lu\n", stats->errors);
+	seq_printf(s, "naks: %lu\n", stats->naks);
+	seq_printf(s, "lock wait: %llu us\n",
+		   div_u64(stats->lock_wait_ns, NSEC_PER_USEC));
+	seq_printf(s, "transfer time: %llu us\n",
+		   div_u64(stats->xfer_ns, NSEC_PER_USEC));
+
+	for (i = 0; i < I2C_STATS_BUCKETS; i++) {
+		if (!stats->xfer_hist[i])
+			continue;
+		if (i < I2C_STATS_BUCKETS - 1)
+			seq_printf(s, "  < %5lu us: %lu\n", 1UL << i,
+				   stats->xfer_hist[i]);
+		else
+			seq_printf(s, " >= %5lu us: %lu\n", 1UL << (i - 1),
+				   stats->xfer_hist[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(stats->addr); i++) {
+		struct i2c_addr_stats *addr = &stats->addr[i];
+		const char *name = "";
+
+		if (!addr->messages)
+			continue;
+
+		mutex_lock(&adap->clist_lock);
+		list_for_each_entry(client, &adap->clients, list) {
+			if (client->addr == i &&
+			    !(client->flags & I2C_CLIENT_TEN)) {
+				name = client->name;
+				break;
+			}
+		}
+		seq_printf(s, "0x%02x %-20s messages %lu bytes %lu "
+			   "errors %lu naks %lu\n", i, name, addr->messages,
+			   addr->bytes, addr->errors, addr->naks);
+		mutex_unlock(&adap->clist_lock);
+	}
+
+	return 0;
+}
+
+static int i2c_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, i2c_stats_show, inode->i_private);
+}
+
+static const struct file_operations i2c_stats_fops = {
+	.open		= i2c_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* statistics are a debugging aid, so failing to set them up isn't fatal */
+static void i2c_stats_init(struct i2c_adapter *adap)
+{
+	adap->stats = kzalloc(sizeof(*adap->stats), GFP_KERNEL);
+	if (!adap->stats)
+		return;
+
+	if (i2c_debugfs_root)
+		adap->stats->debugfs = debugfs_create_file(adap->dev.bus_id,
+				S_IRUGO, i2c_debugfs_root, adap,
+				&i2c_stats_fops);
+}
+
+static void i2c_stats_exit(struct i2c_adapter *adap)
+{
+	if (!adap->stats)
+		return;
+
+	debugfs_remove(adap->stats->debugfs);
+	kfree(adap->stats);
+	adap->stats = NULL;
+}
+
+static void i2c_stats_init_debugfs(void)
+{
+	i2c_debugfs_root = debugfs_create_dir("i2c", NULL);
+	if (IS_ERR(i2c_debugfs_root))
+		i2c_debugfs_root = NULL;
+}
+
+static void i2c_stats_exit_debugfs(void)
+{
+	debugfs_remove(i2c_debugfs_root);
+}
+
+#else
+
+static inline void i2c_bus_lock(struct i2c_adapter *adap)
+{
+	mutex_lock_nested(&adap->bus_lock, adap->level);
+}
+
+static inline int i2c_master_xfer(struct i2c_adapter *adap,
+				  struct i2c_msg *msgs, int num)
+{
+	return adap->algo->master_xfer(adap, msgs, num);
+}
+
+static inline void i2c_stats_init(struct i2c_adapter *adap)
+{
+}
+
+static inline void i2c_stats_exit(struct i2c_adapter *adap)
+{
+}
+
+static inline void i2c_stats_init_debugfs(void)
+{
+}
+
+static inline void i2c_stats_exit_debugfs(void)
+{
+}
+
+#endif
+
+/* runs the transactions queued by i2c_transfer_async() */
+static void i2c_async_work(struct work_struct *work)
+{
+	struct i2c_adapter *adap = container_of(work, struct i2c_adapter,
+						async_work);
+	struct i2c_transaction *t, *next;
+	LIST_HEAD(done);
+
+	i2c_bus_lock(adap);
+	spin_lock_irq(&adap->async_lock);
+	while (!list_empty(&adap->async_queue)) {
+		t = list_first_entry(&adap->async_queue,
+				     struct i2c_transaction, queue);
+		list_move_tail(&t->queue, &done);
+		spin_unlock_irq(&adap->async_lock);
+
+		t->status = i2c_master_xfer(adap, t->msgs, t->num);
+
+		spin_lock_irq(&adap->async_lock);
+	}
+	spin_unlock_irq(&adap->async_lock);
+	mutex_unlock(&adap->bus_lock);
+
+	list_for_each_entry_safe(t, next, &done, queue) {
+		list_del(&t->queue);
+		t->complete(t->context);
+	}
+}
+
 static int i2c_register_adapter(struct i2c_adapter *adap)
 {
 	int res = 0, dummy;
@@ -448,6 +718,10 @@ static int i2c_register_adapter(struct i2c_adapter *adap)
 	mutex_init(&adap->clist_lock);
 	INIT_LIST_HEAD(&adap->clients);
 
+	spin_lock_init(&adap->async_lock);
+	INIT_LIST_HEAD(&adap->async_queue);
+	INIT_WORK(&adap->async_work, i2c_async_work);
+
 	mutex_lock(&core_lock);
 
 	/* Add the adapter to the driver core.
@@ -468,6 +742,8 @@ static int i2c_register_adapter(struct i2c_adapter *adap)
 
 	dev_dbg(&adap->dev, "adapter [%s] registered\n", adap->name);
 
+	i2c_stats_init(adap);
+
 	/* create pre-declared device nodes for new-style drivers */
 	if (adap->nr < __i2c_first_dynamic_bus_num)
 		i2c_scan_static_board_info(adap);
@@ -651,6 +927,9 @@ int i2c_del_adapter(struct i2c_adapter *adap)
 		}
 	}
 
+	/* the clients are gone, so this finishes any queued transfers */
+	flush_workqueue(i2c_async_wq);
+
 	/* clean up the sysfs representation */
 	init_completion(&adap->dev_released);
 	device_unregister(&adap->dev);
@@ -658,6 +937,8 @@ int i2c_del_adapter(struct i2c_adapter *adap)
 	/* wait for sysfs to drop all references */
 	wait_for_completion(&adap->dev_released);
 
+	i2c_stats_exit(adap);
+
 	/* free bus id */
 	idr_remove(&i2c_adapter_idr, adap->nr);
 
@@ -964,29 +1245,39 @@ static int __init i2c_init(void)
 {
 	int retval;
 
+	i2c_async_wq = create_singlethread_workqueue("i2c-async");
+	if (!i2c_async_wq)
+		return -ENOMEM;
+
 	retval = bus_register(&i2c_bus_type);
 	if (retval)
-		return retval;
+		goto wq_err;
 	retval = class_register(&i2c_adapter_class);
 	if (retval)
 		goto bus_err;
+	i2c_stats_init_debugfs();
 	retval = i2c_add_driver(&dummy_driver);
 	if (retval)
 		goto class_err;
 	return 0;
 
 class_err:
+	i2c_stats_exit_debugfs();
 	class_unregister(&i2c_adapter_class);
 bus_err:
 	bus_unregister(&i2c_bus_type);
+wq_err:
+	destroy_workqueue(i2c_async_wq);
 	return retval;
 }
 
 static void __exit i2c_exit(void)
 {
 	i2c_del_driver(&dummy_driver);
+	i2c_stats_exit_debugfs();
 	class_unregister(&i2c_adapter_class);
 	bus_unregister(&i2c_bus_type);
+	destroy_workqueue(i2c_async_wq);
 }
 
 /* We must initialize early, because some subsystems register i2c drivers
@@ -1049,10 +1340,10 @@ int i2c_transfer(struct i2c_adapter * adap, struct i2c_msg *msgs, int num)
 				/* I2C activity is ongoing. */
 				return -EAGAIN;
 		} else {
-			mutex_lock_nested(&adap->bus_lock, adap->level);
+			i2c_bus_lock(adap);
 		}
 
-		ret = adap->algo->master_xfer(adap,msgs,num);
+		ret = i2c_master_xfer(adap, msgs, num);
 		mutex_unlock(&adap->bus_lock);
 
 		return ret;
@@ -1063,6 +1354,49 @@ int i2c_transfer(struct i2c_adapter * adap, struct i2c_msg *msgs, int num)
 }
 EXPORT_SYMBOL(i2c_transfer);
 
+/**
+ * i2c_transfer_async - queue a combined I2C transfer
+ * @adap: the adapter to use
+ * @t: the messages to transfer and the callback for when they're done
+ *
+ * Unlike i2c_transfer(), this may be called from any context, including
+ * with interrupts disabled.  Transactions are run in the order they
+ * were queued.  Everything queued by the time the bus is free is sent
+ * back to back, only taking the bus lock once, so a driver that keeps
+ * several transactions queued keeps the bus busy.
+ *
+ * The callback is made in task context after the bus has been released,
+ * so it may sleep, queue further transactions or use i2c_transfer().
+ * Until then @t and its messages must not be touched.
+ *
+ * Returns zero if the transaction was queued, in which case t->status
+ * reports the result of the transfer as i2c_transfer() would have, or
+ * a negative errno.
+ */
+int i2c_transfer_async(struct i2c_adapter *adap, struct i2c_transaction *t)
+{
+	unsigned long flags;
+
+	if (!adap->algo->master_xfer) {
+		dev_dbg(&adap->dev, "I2C level transfers not supported\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (!t->complete || t->num <= 0)
+		return -EINVAL;
+
+	t->status = -EINPROGRESS;
+
+	spin_lock_irqsave(&adap->async_lock, flags);
+	list_add_tail(&t->queue, &adap->async_queue);
+	spin_unlock_irqrestore(&adap->async_lock, flags);
+
+	queue_work(i2c_async_wq, &adap->async_work);
+
+	return 0;
+}
+EXPORT_SYMBOL(i2c_transfer_async);
+
 /**
  * i2c_master_send - issue a single I2C message in master transmit mode
  * @client: Handle to slave device
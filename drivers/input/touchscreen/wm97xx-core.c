@@ -46,6 +46,7 @@
 #include <linux/bitops.h>
 #include <linux/workqueue.h>
 #include <linux/wm97xx.h>
+#include <linux/regulator/consumer.h>
 #include <linux/uaccess.h>
 #include <linux/io.h>
 
@@ -81,6 +82,18 @@ static int abs_p[3] = {0, 150, 4};
 module_param_array(abs_p, int, NULL, 0);
 MODULE_PARM_DESC(abs_p, "Touchscreen absolute Pressure min, max, fuzz");
 
+/*
+ * Touchscreen supply idle time.
+ *
+ * When the machine provides a "vtouch" supply and a pen down interrupt
+ * the supply is only powered while the pen is down.  It is turned off
+ * this many milliseconds after the pen is lifted so that taps in quick
+ * succession don't cycle the regulator.
+ */
+static int idle_off_ms = 500;
+module_param(idle_off_ms, int, 0644);
+MODULE_PARM_DESC(idle_off_ms, "Delay before touch supply is cut after pen up");
+
 /*
  * wm97xx IO access, all IO locking done by AC97 layer
  */
@@ -113,16 +126,21 @@ void wm97xx_reg_write(struct wm97xx *wm, u16 reg, u16 val)
 EXPORT_SYMBOL_GPL(wm97xx_reg_write);
 
 /**
- * wm97xx_read_aux_adc - Read the aux adc.
+ * wm97xx_read_aux_adcs - Read several aux adcs together.
  * @wm: wm97xx device.
- * @adcsel: codec ADC to be read
+ * @adcsel: codec ADCs to be read
+ * @vals: the readings, one for each of @adcsel
+ * @num: number of ADCs to read
  *
- * Reads the selected AUX ADC.
+ * Reads the selected AUX ADCs with a single power up and preparation
+ * of the ADC, in one gap between touch samples, rather than one for
+ * each.  Users reading a battery voltage and temperature should read
+ * both here.
  */
-
-int wm97xx_read_aux_adc(struct wm97xx *wm, u16 adcsel)
+void wm97xx_read_aux_adcs(struct wm97xx *wm, const u16 *adcsel, int *vals,
+			  int num)
 {
-	int power_adc = 0, auxval;
+	int power_adc = 0, auxval, i;
 	u16 power = 0;
 
 	/* get codec */
@@ -142,7 +160,10 @@ int wm97xx_read_aux_adc(struct wm97xx *wm, u16 adcsel)
 
 	/* Turn polling mode on to read AUX ADC */
 	wm->pen_probably_down = 1;
-	wm->codec->poll_sample(wm, adcsel, &auxval);
+	for (i = 0; i < num; i++) {
+		wm->codec->poll_sample(wm, adcsel[i], &auxval);
+		vals[i] = auxval & 0xfff;
+	}
 
 	if (power_adc)
 		wm97xx_reg_write(wm, AC97_EXTENDED_MID, power | 0x8000);
@@ -152,7 +173,24 @@ int wm97xx_read_aux_adc(struct wm97xx *wm, u16 adcsel)
 	wm->pen_probably_down = 0;
 
 	mutex_unlock(&wm->codec_mutex);
-	return auxval & 0xfff;
+}
+EXPORT_SYMBOL_GPL(wm97xx_read_aux_adcs);
+
+/**
+ * wm97xx_read_aux_adc - Read the aux adc.
+ * @wm: wm97xx device.
+ * @adcsel: codec ADC to be read
+ *
+ * Reads the selected AUX ADC.
+ */
+
+int wm97xx_read_aux_adc(struct wm97xx *wm, u16 adcsel)
+{
+	int auxval;
+
+	wm97xx_read_aux_adcs(wm, &adcsel, &auxval, 1);
+
+	return auxval;
 }
 EXPORT_SYMBOL_GPL(wm97xx_read_aux_adc);
 
@@ -276,6 +314,30 @@ void wm97xx_set_suspend_mode(struct wm97xx *wm, u16 mode)
 }
 EXPORT_SYMBOL_GPL(wm97xx_set_suspend_mode);
 
+/*
+ * Switch the optional touch panel supply.  Only called from the touch
+ * workqueue or with it stopped so needs no locking of its own.
+ */
+static void wm97xx_ts_supply(struct wm97xx *wm, int on)
+{
+	int ret;
+
+	if (!wm->vtouch || wm->vtouch_on == on)
+		return;
+
+	if (on) {
+		ret = regulator_enable(wm->vtouch);
+		if (ret != 0) {
+			dev_err(wm->dev, "Failed to enable vtouch: %d\n", ret);
+			return;
+		}
+	} else {
+		regulator_disable_deferred(wm->vtouch, idle_off_ms);
+	}
+
+	wm->vtouch_on = on;
+}
+
 /*
  * Handle a pen down interrupt.
  */
@@ -316,6 +378,10 @@ static void wm97xx_pen_irq_worker(struct work_struct *work)
 		mutex_unlock(&wm->codec_mutex);
 	}
 
+	/* power the panel before anything tries to sample it */
+	if (wm->pen_is_down && !pen_was_down)
+		wm97xx_ts_supply(wm, 1);
+
 	/* If the system is not using continuous mode or it provides a
 	 * pen down operation then we need to schedule polls while the
 	 * pen is down.  Otherwise the machine driver is responsible
@@ -332,8 +398,10 @@ static void wm97xx_pen_irq_worker(struct work_struct *work)
 			wm->pen_is_down = 1;
 	}
 
-	if (!wm->pen_is_down && wm->mach_ops->acc_enabled)
+	if (!wm->pen_is_down && wm->mach_ops->acc_enabled) {
 		wm->mach_ops->acc_pen_up(wm);
+		wm97xx_ts_supply(wm, 0);
+	}
 
 	wm->mach_ops->irq_enable(wm, 1);
 }
@@ -463,6 +531,9 @@ static void wm97xx_ts_reader(struct work_struct *work)
 	if (wm->pen_is_down || !wm->pen_irq)
 		queue_delayed_work(wm->ts_workq, &wm->ts_reader,
 				   wm->ts_reader_interval);
+	else
+		/* pen up reported, idle until the next pen down IRQ */
+		wm97xx_ts_supply(wm, 0);
 }
 
 /**
@@ -470,7 +541,8 @@ static void wm97xx_ts_reader(struct work_struct *work)
  * @idev:	Input device to be opened.
  *
  * Called by the input sub system to open a wm97xx touchscreen device.
- * Starts the touchscreen thread and touch digitiser.
+ * Starts the touchscreen thread and touch digitiser.  If there is a pen
+ * down interrupt the vtouch supply is left off until the first touch.
  */
 static int wm97xx_ts_input_open(struct input_dev *idev)
 {
@@ -505,9 +577,11 @@ static int wm97xx_ts_input_open(struct input_dev *idev)
 	/* If we either don't have an interrupt for pen down events or
 	 * failed to acquire it then we need to poll.
 	 */
-	if (wm->pen_irq == 0)
+	if (wm->pen_irq == 0) {
+		wm97xx_ts_supply(wm, 1);
 		queue_delayed_work(wm->ts_workq, &wm->ts_reader,
 				   wm->ts_reader_interval);
+	}
 
 	return 0;
 }
@@ -555,6 +629,14 @@ static void wm97xx_ts_input_close(struct input_dev *idev)
 	wm->codec->dig_enable(wm, 0);
 	if (wm->mach_ops && wm->mach_ops->acc_enabled)
 		wm->codec->acc_enable(wm, 0);
+
+	/* nothing more will sample the panel, don't wait to power it off */
+	if (wm->vtouch_on) {
+		regulator_disable(wm->vtouch);
+		wm->vtouch_on = 0;
+	} else if (wm->vtouch) {
+		regulator_disable_flush(wm->vtouch);
+	}
 }
 
 static int wm97xx_probe(struct device *dev)
@@ -606,6 +688,11 @@ static int wm97xx_probe(struct device *dev)
 		goto alloc_err;
 	}
 
+	/* the touch panel supply is optional */
+	wm->vtouch = regulator_get(dev, "vtouch");
+	if (IS_ERR(wm->vtouch))
+		wm->vtouch = NULL;
+
 	/* set up physical characteristics */
 	wm->codec->phy_init(wm);
 
@@ -620,7 +707,7 @@ static int wm97xx_probe(struct device *dev)
 	wm->input_dev = input_allocate_device();
 	if (wm->input_dev == NULL) {
 		ret = -ENOMEM;
-		goto alloc_err;
+		goto input_err;
 	}
 
 	/* set up touch configuration */
@@ -683,6 +770,8 @@ static int wm97xx_probe(struct device *dev)
 	wm->input_dev = NULL;
  dev_alloc_err:
 	input_free_device(wm->input_dev);
+ input_err:
+	regulator_put(wm->vtouch);
  alloc_err:
 	kfree(wm);
 
@@ -696,8 +785,8 @@ static int wm97xx_remove(struct device *dev)
 	platform_device_unregister(wm->battery_dev);
 	platform_device_unregister(wm->touch_dev);
 	input_unregister_device(wm->input_dev);
+	regulator_put(wm->vtouch);
 	kfree(wm);
-
 	return 0;
 }
 
@@ -716,6 +805,14 @@ static int wm97xx_suspend(struct device *dev, pm_message_t state)
 	if (wm->input_dev->users)
 		cancel_delayed_work_sync(&wm->ts_reader);
 
+	/* power the panel off now, even after pen up left it to idle off */
+	if (wm->vtouch_on) {
+		regulator_disable(wm->vtouch);
+		wm->vtouch_on = 0;
+	} else if (wm->vtouch) {
+		regulator_disable_flush(wm->vtouch);
+	}
+
 	/* Power down the digitiser (bypassing the cache for resume) */
 	reg = wm97xx_reg_read(wm, AC97_WM97XX_DIGITISER2);
 	reg &= ~WM97XX_PRP_DET_DIG;
@@ -759,7 +856,8 @@ static int wm97xx_resume(struct device *dev)
 	wm97xx_reg_write(wm, AC97_GPIO_STATUS, wm->gpio[4]);
 	wm97xx_reg_write(wm, AC97_MISC_AFE, wm->gpio[5]);
 
-	if (wm->input_dev->users && !wm->pen_irq) {
+	if (wm->input_dev->users && (!wm->pen_irq || wm->pen_is_down)) {
+		wm97xx_ts_supply(wm, 1);
 		wm->ts_reader_interval = wm->ts_reader_min_interval;
 		queue_delayed_work(wm->ts_workq, &wm->ts_reader,
 				   wm->ts_reader_interval);
@@ -0,0 +1,177 @@
+/*
+ * LEDs driven by a regulator current sink
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Triggers such as timer and heartbeat set the brightness from timer
+ * context and at a high rate, while the sinks sit behind I2C or SPI.
+ * The brightness is latched and applied from a work item, so sets made
+ * before it runs collapse into one, and only the regulator operations
+ * which actually change something are made: a blinking LED is only
+ * enabled and disabled, its current limit being written just once.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/leds.h>
+#include <linux/workqueue.h>
+#include <linux/err.h>
+#include <linux/regulator/consumer.h>
+#include <linux/leds-regulator.h>
+
+struct regulator_led {
+	struct led_classdev	cdev;
+	struct work_struct	work;
+	struct regulator	*isink;
+	unsigned int		max_uA;
+	enum led_brightness	new_brightness;	/* latched by brightness_set */
+	int			cur_uA;		/* last current limit set */
+	int			enabled;	/* we hold an enable */
+};
+
+static void regulator_led_work(struct work_struct *work)
+{
+	struct regulator_led *led =
+		container_of(work, struct regulator_led, work);
+	enum led_brightness value = led->new_brightness;
+	int uA, ret;
+
+	if (value == LED_OFF) {
+		if (led->enabled) {
+			ret = regulator_disable(led->isink);
+			if (ret < 0)
+				dev_err(led->cdev.dev,
+					"failed to disable: %d\n", ret);
+			else
+				led->enabled = 0;
+		}
+		return;
+	}
+
+	/* the current is left as it is while off, ready for the next on */
+	if (led->max_uA) {
+		uA = led->max_uA * value / LED_FULL;
+		if (uA != led->cur_uA) {
+			ret = regulator_set_current_limit(led->isink, 0, uA);
+			if (ret < 0) {
+				dev_err(led->cdev.dev,
+					"failed to set current: %d\n", ret);
+				return;
+			}
+			led->cur_uA = uA;
+		}
+	}
+
+	if (!led->enabled) {
+		ret = regulator_enable(led->isink);
+		if (ret < 0)
+			dev_err(led->cdev.dev, "failed to enable: %d\n", ret);
+		else
+			led->enabled = 1;
+	}
+}
+
+/* may be called from atomic context by triggers */
+static void regulator_led_set(struct led_classdev *led_cdev,
+			      enum led_brightness value)
+{
+	struct regulator_led *led =
+		container_of(led_cdev, struct regulator_led, cdev);
+
+	led->new_brightness = value;
+	schedule_work(&led->work);
+}
+
+static int __devinit regulator_led_probe(struct platform_device *pdev)
+{
+	struct led_regulator_platform_data *pdata = pdev->dev.platform_data;
+	struct regulator_led *led;
+	int ret;
+
+	if (pdata == NULL || pdata->supply == NULL) {
+		dev_err(&pdev->dev, "no platform data\n");
+		return -EINVAL;
+	}
+
+	led = kzalloc(sizeof(struct regulator_led), GFP_KERNEL);
+	if (led == NULL) {
+		dev_err(&pdev->dev, "failed to alloc memory\n");
+		return -ENOMEM;
+	}
+
+	led->isink = regulator_get(&pdev->dev, pdata->supply);
+	if (IS_ERR(led->isink)) {
+		dev_err(&pdev->dev, "unable to get %s supply\n",
+			pdata->supply);
+		ret = PTR_ERR(led->isink);
+		goto err_regulator;
+	}
+
+	led->cdev.name = pdata->name;
+	led->cdev.default_trigger = pdata->default_trigger;
+	led->cdev.brightness_set = regulator_led_set;
+	led->cdev.brightness = LED_OFF;
+
+	led->max_uA = pdata->max_uA;
+	led->cur_uA = -1;
+	led->new_brightness = LED_OFF;
+
+	INIT_WORK(&led->work, regulator_led_work);
+
+	ret = led_classdev_register(&pdev->dev, &led->cdev);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register LED: %d\n", ret);
+		goto err_led;
+	}
+
+	platform_set_drvdata(pdev, led);
+	return 0;
+
+err_led:
+	regulator_put(led->isink);
+err_regulator:
+	kfree(led);
+	return ret;
+}
+
+static int __devexit regulator_led_remove(struct platform_device *pdev)
+{
+	struct regulator_led *led = platform_get_drvdata(pdev);
+
+	led_classdev_unregister(&led->cdev);
+	cancel_work_sync(&led->work);
+	if (led->enabled)
+		regulator_disable(led->isink);
+	regulator_put(led->isink);
+	kfree(led);
+	return 0;
+}
+
+static struct platform_driver regulator_led_driver = {
+	.driver	= {
+		.name	= "leds-regulator",
+		.owner	= THIS_MODULE,
+	},
+	.probe		= regulator_led_probe,
+	.remove		= __devexit_p(regulator_led_remove),
+};
+
+static int __init regulator_led_init(void)
+{
+	return platform_driver_register(&regulator_led_driver);
+}
+module_init(regulator_led_init);
+
+static void __exit regulator_led_exit(void)
+{
+	platform_driver_unregister(&regulator_led_driver);
+}
+module_exit(regulator_led_exit);
+
+MODULE_DESCRIPTION("LEDs driven by regulator current sinks");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:leds-regulator");
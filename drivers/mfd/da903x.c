@@ -15,9 +15,14 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 #include <linux/platform_device.h>
 #include <linux/i2c.h>
+#include <linux/rwsem.h>
+#include <linux/slab.h>
 #include <linux/mfd/da903x.h>
+#include <linux/mfd/regcache.h>
+#include <trace/mfd.h>
 
 #define DA9030_CHIP_ID		0x00
 #define DA9030_EVENT_A		0x01
@@ -46,6 +51,18 @@
 #define DA9034_SYS_CTRL_B	0x0c
 #define DA9034_FAULT_LOG	0x0d
 
+#define DA9030_ADC_RES_FIRST	0x40
+#define DA9030_ADC_RES_LAST	0x4f
+#define DA9030_LDO15		0x11
+#define DA9030_LDO1		0x90
+
+#define DA9034_VCC1		0x20
+#define DA9034_ADC_FIRST	0x50
+#define DA9034_ADC_LAST		0x6f
+
+#define DA903X_NUM_REGS		256
+#define DA903X_NUM_EVENTS	32
+
 struct da903x_chip;
 
 struct da903x_chip_ops {
@@ -54,6 +71,8 @@ struct da903x_chip_ops {
 	int	(*mask_events)(struct da903x_chip *, unsigned int events);
 	int	(*read_events)(struct da903x_chip *, unsigned int *events);
 	int	(*read_status)(struct da903x_chip *, unsigned int *status);
+	int	(*is_volatile)(int reg);
+	int	(*clears_on_read)(int reg);
 };
 
 struct da903x_chip {
@@ -67,12 +86,55 @@ struct da903x_chip {
 	struct mutex		lock;
 	struct work_struct	irq_work;
 
-	struct blocking_notifier_head notifier_list;
+	spinlock_t		irq_lock;	/* irq_suspended, irq_deferred */
+	int			irq_suspended;	/* hold events back for resume */
+	int			irq_deferred;	/* an event came in meanwhile */
+
+	/* subscribers, and how many there are for each event */
+	struct rw_semaphore	notifier_rwsem;
+	struct list_head	notifier_list;
+	int			event_users[DA903X_NUM_EVENTS];
+
+	/* non-volatile registers are cached as they are first accessed */
+	int			cache_regs;
+	uint8_t			reg_cache[DA903X_NUM_REGS];
+	DECLARE_BITMAP(reg_cached, DA903X_NUM_REGS);
+
+	struct mfd_regdump	regdump;	/* debugfs register snapshot */
 };
 
+static inline ktime_t __da903x_trace_start(void)
+{
+	return mfd_reg_trace_enabled() ? ktime_get() : ktime_set(0, 0);
+}
+
+static void __da903x_trace(struct i2c_client *client, int write, int reg,
+			   int len, const uint8_t *val, int cached,
+			   ktime_t start)
+{
+	s64 ns = 0;
+	int i;
+
+	if (!mfd_reg_trace_enabled())
+		return;
+
+	if (ktime_to_ns(start))
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (i = 0; i < len; i++) {
+		if (write)
+			trace_mfd_reg_write(&client->dev, reg + i, val[i],
+					    cached, ns);
+		else
+			trace_mfd_reg_read(&client->dev, reg + i, val[i],
+					   cached, ns);
+	}
+}
+
 static inline int __da903x_read(struct i2c_client *client,
 				int reg, uint8_t *val)
 {
+	ktime_t start = __da903x_trace_start();
 	int ret;
 
 	ret = i2c_smbus_read_byte_data(client, reg);
@@ -82,12 +144,14 @@ static inline int __da903x_read(struct i2c_client *client,
 	}
 
 	*val = (uint8_t)ret;
+	__da903x_trace(client, 0, reg, 1, val, 0, start);
 	return 0;
 }
 
 static inline int __da903x_reads(struct i2c_client *client, int reg,
 				 int len, uint8_t *val)
 {
+	ktime_t start = __da903x_trace_start();
 	int ret;
 
 	ret = i2c_smbus_read_i2c_block_data(client, reg, len, val);
@@ -95,12 +159,14 @@ static inline int __da903x_reads(struct i2c_client *client, int reg,
 		dev_err(&client->dev, "failed reading from 0x%02x\n", reg);
 		return ret;
 	}
+	__da903x_trace(client, 0, reg, len, val, 0, start);
 	return 0;
 }
 
 static inline int __da903x_write(struct i2c_client *client,
 				 int reg, uint8_t val)
 {
+	ktime_t start = __da903x_trace_start();
 	int ret;
 
 	ret = i2c_smbus_write_byte_data(client, reg, val);
@@ -109,12 +175,14 @@ static inline int __da903x_write(struct i2c_client *client,
 				val, reg);
 		return ret;
 	}
+	__da903x_trace(client, 1, reg, 1, &val, 0, start);
 	return 0;
 }
 
 static inline int __da903x_writes(struct i2c_client *client, int reg,
 				  int len, uint8_t *val)
 {
+	ktime_t start = __da903x_trace_start();
 	int ret;
 
 	ret = i2c_smbus_write_i2c_block_data(client, reg, len, val);
@@ -122,38 +190,189 @@ static inline int __da903x_writes(struct i2c_client *client, int reg,
 		dev_err(&client->dev, "failed writings to 0x%02x\n", reg);
 		return ret;
 	}
+	__da903x_trace(client, 1, reg, len, val, 0, start);
+	return 0;
+}
+
+/*
+ * The register cache helpers must be called with chip->lock held.
+ * Volatile registers, and every register while the cache is off, go
+ * straight to the hardware.
+ */
+static inline int da903x_reg_cacheable(struct da903x_chip *chip, int reg)
+{
+	return chip->cache_regs && !chip->ops->is_volatile(reg);
+}
+
+static int da903x_cache_read(struct da903x_chip *chip, int reg, uint8_t *val)
+{
+	int cacheable = da903x_reg_cacheable(chip, reg);
+	int ret;
+
+	if (cacheable && test_bit(reg, chip->reg_cached)) {
+		*val = chip->reg_cache[reg];
+		__da903x_trace(chip->client, 0, reg, 1, val, 1,
+			       ktime_set(0, 0));
+		return 0;
+	}
+
+	ret = __da903x_read(chip->client, reg, val);
+	if (ret)
+		return ret;
+
+	if (cacheable) {
+		chip->reg_cache[reg] = *val;
+		set_bit(reg, chip->reg_cached);
+	}
+	return 0;
+}
+
+static int da903x_cache_write(struct da903x_chip *chip, int reg, uint8_t val)
+{
+	int ret;
+
+	if (!da903x_reg_cacheable(chip, reg))
+		return __da903x_write(chip->client, reg, val);
+
+	if (test_bit(reg, chip->reg_cached) && chip->reg_cache[reg] == val) {
+		__da903x_trace(chip->client, 1, reg, 1, &val, 1,
+			       ktime_set(0, 0));
+		return 0;
+	}
+
+	ret = __da903x_write(chip->client, reg, val);
+	if (ret) {
+		/* we no longer know what the register holds */
+		clear_bit(reg, chip->reg_cached);
+		return ret;
+	}
+
+	chip->reg_cache[reg] = val;
+	set_bit(reg, chip->reg_cached);
 	return 0;
 }
 
+struct da903x_subscriber {
+	struct list_head	list;
+	struct notifier_block	*nb;
+	unsigned int		events;
+};
+
+/**
+ * da903x_register_notifier - subscribe to chip events
+ * @dev: the da903x device
+ * @nb: notifier called with the events which occurred as its action
+ * @events: DA9030_EVENT_* or DA9034_EVENT_* bits to subscribe to
+ *
+ * @nb is only called when one of @events occurs, and is only passed
+ * those of @events which did.  Events are unmasked in the chip while
+ * they have at least one subscriber, so nobody else's events raise
+ * interrupts.
+ */
 int da903x_register_notifier(struct device *dev, struct notifier_block *nb,
 				unsigned int events)
 {
 	struct da903x_chip *chip = dev_get_drvdata(dev);
+	struct da903x_subscriber *sub;
+	unsigned int unmask = 0;
+	int i, ret;
 
-	chip->ops->unmask_events(chip, events);
-	return blocking_notifier_chain_register(&chip->notifier_list, nb);
+	sub = kmalloc(sizeof(*sub), GFP_KERNEL);
+	if (sub == NULL)
+		return -ENOMEM;
+
+	sub->nb = nb;
+	sub->events = events;
+
+	down_write(&chip->notifier_rwsem);
+
+	for (i = 0; i < DA903X_NUM_EVENTS; i++)
+		if ((events & (1U << i)) && chip->event_users[i]++ == 0)
+			unmask |= 1U << i;
+
+	if (unmask) {
+		ret = chip->ops->unmask_events(chip, unmask);
+		if (ret) {
+			for (i = 0; i < DA903X_NUM_EVENTS; i++)
+				if (events & (1U << i))
+					chip->event_users[i]--;
+			up_write(&chip->notifier_rwsem);
+			kfree(sub);
+			return ret;
+		}
+	}
+
+	list_add_tail(&sub->list, &chip->notifier_list);
+
+	up_write(&chip->notifier_rwsem);
+	return 0;
 }
 EXPORT_SYMBOL_GPL(da903x_register_notifier);
 
+/**
+ * da903x_unregister_notifier - cancel a da903x_register_notifier()
+ * @dev: the da903x device
+ * @nb: notifier given when subscribing
+ * @events: events given when subscribing
+ *
+ * Events left with no subscribers are masked again.
+ */
 int da903x_unregister_notifier(struct device *dev, struct notifier_block *nb,
 				unsigned int events)
 {
 	struct da903x_chip *chip = dev_get_drvdata(dev);
+	struct da903x_subscriber *sub;
+	unsigned int mask = 0;
+	int i;
+
+	down_write(&chip->notifier_rwsem);
+
+	list_for_each_entry(sub, &chip->notifier_list, list)
+		if (sub->nb == nb && sub->events == events)
+			goto found;
+
+	up_write(&chip->notifier_rwsem);
+	return -ENOENT;
+
+found:
+	list_del(&sub->list);
+	kfree(sub);
 
-	chip->ops->mask_events(chip, events);
-	return blocking_notifier_chain_unregister(&chip->notifier_list, nb);
+	for (i = 0; i < DA903X_NUM_EVENTS; i++)
+		if ((events & (1U << i)) && --chip->event_users[i] == 0)
+			mask |= 1U << i;
+
+	if (mask)
+		chip->ops->mask_events(chip, mask);
+
+	up_write(&chip->notifier_rwsem);
+	return 0;
 }
 EXPORT_SYMBOL_GPL(da903x_unregister_notifier);
 
 int da903x_write(struct device *dev, int reg, uint8_t val)
 {
-	return __da903x_write(to_i2c_client(dev), reg, val);
+	struct da903x_chip *chip = dev_get_drvdata(dev);
+	int ret;
+
+	mutex_lock(&chip->lock);
+	ret = da903x_cache_write(chip, reg, val);
+	mutex_unlock(&chip->lock);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(da903x_write);
 
 int da903x_read(struct device *dev, int reg, uint8_t *val)
 {
-	return __da903x_read(to_i2c_client(dev), reg, val);
+	struct da903x_chip *chip = dev_get_drvdata(dev);
+	int ret;
+
+	mutex_lock(&chip->lock);
+	ret = da903x_cache_read(chip, reg, val);
+	mutex_unlock(&chip->lock);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(da903x_read);
 
@@ -165,13 +384,13 @@ int da903x_set_bits(struct device *dev, int reg, uint8_t bit_mask)
 
 	mutex_lock(&chip->lock);
 
-	ret = __da903x_read(chip->client, reg, &reg_val);
+	ret = da903x_cache_read(chip, reg, &reg_val);
 	if (ret)
 		goto out;
 
 	if ((reg_val & bit_mask) == 0) {
 		reg_val |= bit_mask;
-		ret = __da903x_write(chip->client, reg, reg_val);
+		ret = da903x_cache_write(chip, reg, reg_val);
 	}
 out:
 	mutex_unlock(&chip->lock);
@@ -187,13 +406,13 @@ int da903x_clr_bits(struct device *dev, int reg, uint8_t bit_mask)
 
 	mutex_lock(&chip->lock);
 
-	ret = __da903x_read(chip->client, reg, &reg_val);
+	ret = da903x_cache_read(chip, reg, &reg_val);
 	if (ret)
 		goto out;
 
 	if (reg_val & bit_mask) {
 		reg_val &= ~bit_mask;
-		ret = __da903x_write(chip->client, reg, reg_val);
+		ret = da903x_cache_write(chip, reg, reg_val);
 	}
 out:
 	mutex_unlock(&chip->lock);
@@ -209,13 +428,13 @@ int da903x_update(struct device *dev, int reg, uint8_t val, uint8_t mask)
 
 	mutex_lock(&chip->lock);
 
-	ret = __da903x_read(chip->client, reg, &reg_val);
+	ret = da903x_cache_read(chip, reg, &reg_val);
 	if (ret)
 		goto out;
 
 	if ((reg_val & mask) != val) {
 		reg_val = (reg_val & ~mask) | val;
-		ret = __da903x_write(chip->client, reg, reg_val);
+		ret = da903x_cache_write(chip, reg, reg_val);
 	}
 out:
 	mutex_unlock(&chip->lock);
@@ -294,6 +513,24 @@ static int da9030_read_status(struct da903x_chip *chip, unsigned int *status)
 	return __da903x_read(chip->client, DA9030_STATUS, (uint8_t *)status);
 }
 
+/* the interrupt and system control registers are only accessed directly */
+static int da9030_is_volatile(int reg)
+{
+	if (reg <= DA9030_FAULT_LOG)
+		return 1;
+
+	/* the LDO unlock sequence must always be written */
+	if (reg == DA9030_LDO15 || reg == DA9030_LDO1)
+		return 1;
+
+	return reg >= DA9030_ADC_RES_FIRST && reg <= DA9030_ADC_RES_LAST;
+}
+
+static int da9030_clears_on_read(int reg)
+{
+	return reg >= DA9030_EVENT_A && reg <= DA9030_EVENT_C;
+}
+
 static int da9034_init_chip(struct da903x_chip *chip)
 {
 	uint8_t chip_id;
@@ -381,10 +618,30 @@ static int da9034_read_status(struct da903x_chip *chip, unsigned int *status)
 	return 0;
 }
 
+static int da9034_is_volatile(int reg)
+{
+	if (reg <= DA9034_FAULT_LOG)
+		return 1;
+
+	/* holds the self clearing DVC GO bits */
+	if (reg == DA9034_VCC1)
+		return 1;
+
+	/* ADC and touchscreen results */
+	return reg >= DA9034_ADC_FIRST && reg <= DA9034_ADC_LAST;
+}
+
+static int da9034_clears_on_read(int reg)
+{
+	return reg >= DA9034_EVENT_A && reg <= DA9034_EVENT_D;
+}
+
+/* each subscriber is only called for, and told about, its own events */
 static void da903x_irq_work(struct work_struct *work)
 {
 	struct da903x_chip *chip =
 		container_of(work, struct da903x_chip, irq_work);
+	struct da903x_subscriber *sub;
 	unsigned int events = 0;
 
 	while (1) {
@@ -395,22 +652,85 @@ static void da903x_irq_work(struct work_struct *work)
 		if (events == 0)
 			break;
 
-		blocking_notifier_call_chain(
-				&chip->notifier_list, events, NULL);
+		down_read(&chip->notifier_rwsem);
+		list_for_each_entry(sub, &chip->notifier_list, list)
+			if (events & sub->events)
+				sub->nb->notifier_call(sub->nb,
+						       events & sub->events,
+						       NULL);
+		up_read(&chip->notifier_rwsem);
 	}
 	enable_irq(chip->client->irq);
 }
 
+/* while suspended the events are left latched in the chip, with the
+ * line disabled, and all handled in one pass on resume */
 static int da903x_irq_handler(int irq, void *data)
 {
 	struct da903x_chip *chip = data;
 
 	disable_irq_nosync(irq);
-	(void)schedule_work(&chip->irq_work);
+
+	spin_lock(&chip->irq_lock);
+	if (chip->irq_suspended)
+		chip->irq_deferred = 1;
+	else
+		(void)schedule_work(&chip->irq_work);
+	spin_unlock(&chip->irq_lock);
 
 	return IRQ_HANDLED;
 }
 
+/* debugfs register snapshot, leaving out the event registers */
+static int da903x_dump_readable(void *data, unsigned int reg)
+{
+	struct da903x_chip *chip = data;
+
+	return !chip->ops->clears_on_read(reg);
+}
+
+static int da903x_dump_cached(void *data, unsigned int reg, unsigned int *val)
+{
+	struct da903x_chip *chip = data;
+
+	if (!da903x_reg_cacheable(chip, reg) || !test_bit(reg, chip->reg_cached))
+		return 0;
+
+	*val = chip->reg_cache[reg];
+	return 1;
+}
+
+static int da903x_dump_read(void *data, unsigned int reg, unsigned int count,
+			    unsigned int *vals)
+{
+	struct da903x_chip *chip = data;
+	uint8_t buf[I2C_SMBUS_BLOCK_MAX];
+	int i, ret;
+
+	ret = __da903x_reads(chip->client, reg, count, buf);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < count; i++)
+		vals[i] = buf[i];
+
+	return 0;
+}
+
+static void da903x_dump_lock(void *data)
+{
+	struct da903x_chip *chip = data;
+
+	mutex_lock(&chip->lock);
+}
+
+static void da903x_dump_unlock(void *data)
+{
+	struct da903x_chip *chip = data;
+
+	mutex_unlock(&chip->lock);
+}
+
 static struct da903x_chip_ops da903x_ops[] = {
 	[0] = {
 		.init_chip	= da9030_init_chip,
@@ -418,6 +738,8 @@ static struct da903x_chip_ops da903x_ops[] = {
 		.mask_events	= da9030_mask_events,
 		.read_events	= da9030_read_events,
 		.read_status	= da9030_read_status,
+		.is_volatile	= da9030_is_volatile,
+		.clears_on_read	= da9030_clears_on_read,
 	},
 	[1] = {
 		.init_chip	= da9034_init_chip,
@@ -425,6 +747,8 @@ static struct da903x_chip_ops da903x_ops[] = {
 		.mask_events	= da9034_mask_events,
 		.read_events	= da9034_read_events,
 		.read_status	= da9034_read_status,
+		.is_volatile	= da9034_is_volatile,
+		.clears_on_read	= da9034_clears_on_read,
 	}
 };
 
@@ -487,10 +811,13 @@ static int __devinit da903x_probe(struct i2c_client *client,
 	chip->client = client;
 	chip->dev = &client->dev;
 	chip->ops = &da903x_ops[id->driver_data];
+	chip->cache_regs = pdata->cache_regs;
 
 	mutex_init(&chip->lock);
+	spin_lock_init(&chip->irq_lock);
 	INIT_WORK(&chip->irq_work, da903x_irq_work);
-	BLOCKING_INIT_NOTIFIER_HEAD(&chip->notifier_list);
+	init_rwsem(&chip->notifier_rwsem);
+	INIT_LIST_HEAD(&chip->notifier_list);
 
 	i2c_set_clientdata(client, chip);
 
@@ -516,6 +843,20 @@ static int __devinit da903x_probe(struct i2c_client *client,
 	if (ret)
 		goto out_free_irq;
 
+	chip->regdump.num_regs = DA903X_NUM_REGS;
+	chip->regdump.max_block = I2C_SMBUS_BLOCK_MAX;
+	chip->regdump.reg_digits = 2;
+	chip->regdump.val_digits = 2;
+	chip->regdump.readable = da903x_dump_readable;
+	chip->regdump.cached = da903x_dump_cached;
+	chip->regdump.read = da903x_dump_read;
+	chip->regdump.lock = da903x_dump_lock;
+	chip->regdump.unlock = da903x_dump_unlock;
+	chip->regdump.data = chip;
+	mfd_regdump_add(&chip->regdump, chip->dev);
+
+	/* the rest of the system needs our supplies to resume */
+	device_enable_resume_first(&client->dev);
 	return 0;
 
 out_free_irq:
@@ -530,11 +871,50 @@ static int __devexit da903x_remove(struct i2c_client *client)
 {
 	struct da903x_chip *chip = i2c_get_clientdata(client);
 
+	mfd_regdump_remove(&chip->regdump);
 	da903x_remove_subdevs(chip);
 	kfree(chip);
 	return 0;
 }
 
+#ifdef CONFIG_PM
+/* don't let event handling race with the bus suspending under it */
+static int da903x_suspend(struct i2c_client *client, pm_message_t state)
+{
+	struct da903x_chip *chip = i2c_get_clientdata(client);
+
+	spin_lock_irq(&chip->irq_lock);
+	chip->irq_suspended = 1;
+	spin_unlock_irq(&chip->irq_lock);
+
+	flush_work(&chip->irq_work);
+	return 0;
+}
+
+/* the chip may have been changed while we slept, read it afresh */
+static int da903x_resume(struct i2c_client *client)
+{
+	struct da903x_chip *chip = i2c_get_clientdata(client);
+
+	mutex_lock(&chip->lock);
+	bitmap_zero(chip->reg_cached, DA903X_NUM_REGS);
+	mutex_unlock(&chip->lock);
+
+	spin_lock_irq(&chip->irq_lock);
+	chip->irq_suspended = 0;
+	if (chip->irq_deferred) {
+		chip->irq_deferred = 0;
+		(void)schedule_work(&chip->irq_work);
+	}
+	spin_unlock_irq(&chip->irq_lock);
+
+	return 0;
+}
+#else
+#define da903x_suspend NULL
+#define da903x_resume NULL
+#endif
+
 static struct i2c_driver da903x_driver = {
 	.driver	= {
 		.name	= "da903x",
@@ -542,6 +922,8 @@ static struct i2c_driver da903x_driver = {
 	},
 	.probe		= da903x_probe,
 	.remove		= __devexit_p(da903x_remove),
+	.suspend	= da903x_suspend,
+	.resume		= da903x_resume,
 	.id_table	= da903x_id_table,
 };
 
@@ -20,7 +20,7 @@
 
 struct egpio_chip {
 	int              reg_start;
-	int              cached_values;
+	unsigned long    cached_values;
 	unsigned long    is_out;
 	struct device    *dev;
 	struct gpio_chip chip;
@@ -179,38 +179,61 @@ static int egpio_direction_input(struct gpio_chip *chip, unsigned offset)
  * Output pins
  */
 
-static void egpio_set(struct gpio_chip *chip, unsigned offset, int value)
+/*
+ * Assign the pins in mask from bits in the cache, then write back
+ * only the registers whose contents changed.  Each write is a slow
+ * CPLD bus cycle so pins sharing a register are updated together.
+ */
+static void egpio_update(struct gpio_chip *chip, unsigned long mask,
+			 unsigned long bits)
 {
 	unsigned long     flag;
 	struct egpio_chip *egpio;
 	struct egpio_info *ei;
-	unsigned          bit;
-	int               pos;
+	unsigned long     changed;
 	int               reg;
 	int               shift;
 
-	pr_debug("egpio_set(%s, %d(%d), %d)\n",
-			chip->label, offset, offset+chip->base, value);
-
 	egpio = container_of(chip, struct egpio_chip, chip);
 	ei    = dev_get_drvdata(egpio->dev);
-	bit   = egpio_bit(ei, offset);
-	pos   = egpio_pos(ei, offset);
-	reg   = egpio->reg_start + pos;
-	shift = pos << ei->reg_shift;
-
-	pr_debug("egpio %s: reg %d = 0x%04x\n", value ? "set" : "clear",
-			reg, (egpio->cached_values >> shift) & ei->reg_mask);
 
 	spin_lock_irqsave(&ei->lock, flag);
-	if (value)
-		egpio->cached_values |= (1 << offset);
-	else
-		egpio->cached_values &= ~(1 << offset);
-	egpio_writew((egpio->cached_values >> shift) & ei->reg_mask, ei, reg);
+	changed = egpio->cached_values;
+	egpio->cached_values &= ~mask;
+	egpio->cached_values |= bits & mask;
+	changed ^= egpio->cached_values;
+
+	for (shift = 0; changed && shift < chip->ngpio;
+			shift += (1 << ei->reg_shift)) {
+		if (!((changed >> shift) & ei->reg_mask))
+			continue;
+
+		reg = egpio->reg_start + egpio_pos(ei, shift);
+		pr_debug("egpio: reg %d = 0x%04lx\n", reg,
+			 (egpio->cached_values >> shift) & ei->reg_mask);
+
+		egpio_writew((egpio->cached_values >> shift) & ei->reg_mask,
+			     ei, reg);
+		changed &= ~((unsigned long)ei->reg_mask << shift);
+	}
 	spin_unlock_irqrestore(&ei->lock, flag);
 }
 
+static void egpio_set(struct gpio_chip *chip, unsigned offset, int value)
+{
+	pr_debug("egpio_set(%s, %d(%d), %d)\n",
+			chip->label, offset, offset+chip->base, value);
+
+	egpio_update(chip, 1UL << offset, value ? ~0UL : 0);
+}
+
+static void egpio_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+			       unsigned long *bits)
+{
+	/* num_gpios is at most BITS_PER_LONG */
+	egpio_update(chip, mask[0], bits[0]);
+}
+
 static int egpio_direction_output(struct gpio_chip *chip,
 					unsigned offset, int value)
 {
@@ -244,7 +267,7 @@ static void egpio_write_cache(struct egpio_info *ei)
 			if (!((egpio->is_out >> shift) & ei->reg_mask))
 				continue;
 
-			pr_debug("EGPIO: setting %x to %x, was %x\n", reg,
+			pr_debug("EGPIO: setting %x to %lx, was %x\n", reg,
 				(egpio->cached_values >> shift) & ei->reg_mask,
 				egpio_readw(ei, reg));
 
@@ -322,6 +345,7 @@ static int __init egpio_probe(struct platform_device *pdev)
 		chip->owner           = THIS_MODULE;
 		chip->get             = egpio_get;
 		chip->set             = egpio_set;
+		chip->set_multiple    = egpio_set_multiple;
 		chip->direction_input = egpio_direction_input;
 		chip->direction_output = egpio_direction_output;
 		chip->base            = pdata->chip[i].gpio_base;
@@ -13,7 +13,14 @@
 
 #include <linux/kernel.h>
 #include <linux/platform_device.h>
+#include <linux/kthread.h>
 #include <linux/mfd/core.h>
+#include <trace/mfd.h>
+
+DEFINE_TRACE(mfd_reg_read);
+EXPORT_TRACEPOINT_SYMBOL_GPL(mfd_reg_read);
+DEFINE_TRACE(mfd_reg_write);
+EXPORT_TRACEPOINT_SYMBOL_GPL(mfd_reg_write);
 
 static int mfd_add_device(struct device *parent, int id,
 			  const struct mfd_cell *cell,
@@ -115,5 +122,98 @@ void mfd_remove_devices(struct device *parent)
 }
 EXPORT_SYMBOL(mfd_remove_devices);
 
+struct mfd_async_dev {
+	struct mfd_async *async;
+	struct platform_device **pdev;
+};
+
+static void mfd_async_add(struct mfd_async *async,
+			  struct platform_device **pdev)
+{
+	int ret;
+
+	ret = platform_device_add(*pdev);
+	if (ret != 0) {
+		dev_err((*pdev)->dev.parent, "Failed to register %s: %d\n",
+			(*pdev)->name, ret);
+		platform_device_put(*pdev);
+		*pdev = NULL;
+	}
+
+	if (atomic_dec_and_test(&async->pending))
+		wake_up(&async->wait);
+}
+
+static int mfd_async_add_fn(void *data)
+{
+	struct mfd_async_dev *adev = data;
+
+	mfd_async_add(adev->async, adev->pdev);
+	kfree(adev);
+
+	return 0;
+}
+
+/**
+ * mfd_async_init - initialise an asynchronous registration domain
+ * @async: domain, normally embedded in the parent's driver data
+ */
+void mfd_async_init(struct mfd_async *async)
+{
+	atomic_set(&async->pending, 0);
+	init_waitqueue_head(&async->wait);
+}
+EXPORT_SYMBOL(mfd_async_init);
+
+/**
+ * mfd_platform_device_add_async - register a child device in the background
+ * @async: domain the registration is accounted against
+ * @pdev: allocated and configured platform device to register
+ *
+ * Registers *@pdev from a separate thread so that its driver can probe
+ * concurrently with other children and with the rest of the parent's
+ * probe.  Children registered this way must not depend on each other.
+ * If registration fails the device is released and *@pdev is set to
+ * NULL, so the caller must not look at *@pdev until after calling
+ * mfd_async_synchronize().
+ */
+void mfd_platform_device_add_async(struct mfd_async *async,
+				   struct platform_device **pdev)
+{
+	struct mfd_async_dev *adev;
+	struct task_struct *task;
+
+	atomic_inc(&async->pending);
+
+	adev = kmalloc(sizeof(*adev), GFP_KERNEL);
+	if (adev) {
+		adev->async = async;
+		adev->pdev = pdev;
+
+		task = kthread_run(mfd_async_add_fn, adev, "mfd-probe/%s",
+				   (*pdev)->name);
+		if (!IS_ERR(task))
+			return;
+	}
+
+	/* Couldn't start a thread so register synchronously instead */
+	kfree(adev);
+	mfd_async_add(async, pdev);
+}
+EXPORT_SYMBOL(mfd_platform_device_add_async);
+
+/**
+ * mfd_async_synchronize - wait for asynchronous child registrations
+ * @async: domain to wait for
+ *
+ * Waits until every registration started against @async has completed,
+ * including the probe of any driver bound to the device.
+ */
+void mfd_async_synchronize(struct mfd_async *async)
+{
+	wait_event(async->wait, atomic_read(&async->pending) == 0);
+}
+EXPORT_SYMBOL(mfd_async_synchronize);
+
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Ian Molton, Dmitry Baryshkov");
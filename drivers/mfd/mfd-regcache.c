@@ -0,0 +1,280 @@
+/*
+ * drivers/mfd/mfd-regcache.c
+ *
+ * Register cache helpers shared by MFD core drivers: writing back a
+ * dirty cache in blocks and a debugfs dump of the register map.  The
+ * drivers keep their own bus I/O and cache and are called back for it.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bitops.h>
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/mfd/regcache.h>
+
+/**
+ * mfd_regcache_sync - write back dirty registers in blocks
+ * @dirty: bitmap of registers changed in the cache only
+ * @num_regs: size of the register map
+ * @max_block: most registers @write can take at once
+ * @write: write @count registers starting at @reg back from the cache
+ * @data: passed to @write
+ *
+ * Each run of adjacent dirty registers is written with as few calls to
+ * @write as @max_block allows, clearing the dirty bits as it goes.  On
+ * error the registers not yet written stay dirty for a later sync.
+ * The caller is responsible for locking the cache and bitmap.
+ */
+int mfd_regcache_sync(unsigned long *dirty, unsigned int num_regs,
+		      unsigned int max_block,
+		      int (*write)(void *data, unsigned int reg,
+				   unsigned int count),
+		      void *data)
+{
+	unsigned int start, end, n, i;
+	int ret;
+
+	start = find_first_bit(dirty, num_regs);
+	while (start < num_regs) {
+		end = find_next_zero_bit(dirty, num_regs, start);
+
+		for (; start < end; start += n) {
+			n = min(end - start, max_block);
+
+			ret = write(data, start, n);
+			if (ret != 0)
+				return ret;
+
+			for (i = start; i < start + n; i++)
+				clear_bit(i, dirty);
+		}
+
+		start = find_next_bit(dirty, num_regs, end);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mfd_regcache_sync);
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *mfd_debugfs_root;
+
+#define MFD_REGDUMP_SHOWN	0x1
+#define MFD_REGDUMP_CACHED	0x2
+#define MFD_REGDUMP_CHIP	0x4
+
+struct mfd_regdump_text {
+	size_t len;
+	char buf[0];
+};
+
+/*
+ * Take every value shown in a single pass with the map locked.
+ * Whatever the cache can't answer, everything with the cache bypassed,
+ * is then read from the chip with one block read per run of readable
+ * registers.  Cached registers inside a run are read through rather
+ * than splitting it, another transfer costs more than a few words.
+ */
+static int mfd_regdump_snapshot(struct mfd_regdump *dump, unsigned int *cache,
+				unsigned int *chip, u8 *flags)
+{
+	unsigned int reg, start, last;
+	int ret = 0;
+
+	dump->lock(dump->data);
+
+	for (reg = 0; reg < dump->num_regs; reg++) {
+		flags[reg] = 0;
+		if (!dump->readable(dump->data, reg))
+			continue;
+
+		flags[reg] = MFD_REGDUMP_SHOWN;
+		if (dump->cached && dump->cached(dump->data, reg, &cache[reg])) {
+			flags[reg] |= MFD_REGDUMP_CACHED;
+			if (!dump->bypass)
+				continue;
+		}
+		flags[reg] |= MFD_REGDUMP_CHIP;
+	}
+
+	reg = 0;
+	while (reg < dump->num_regs) {
+		if (!(flags[reg] & MFD_REGDUMP_CHIP)) {
+			reg++;
+			continue;
+		}
+
+		start = reg;
+		last = reg;
+		for (reg++; reg < dump->num_regs &&
+			     reg - start < dump->max_block &&
+			     (flags[reg] & MFD_REGDUMP_SHOWN); reg++)
+			if (flags[reg] & MFD_REGDUMP_CHIP)
+				last = reg;
+
+		ret = dump->read(dump->data, start, last - start + 1,
+				 &chip[start]);
+		if (ret < 0)
+			break;
+
+		reg = last + 1;
+	}
+
+	dump->unlock(dump->data);
+
+	return ret;
+}
+
+/*
+ * One line per register: the value followed by 'c' if it came from
+ * the cache, 'v' if from the chip.  With the cache bypassed registers
+ * whose cached value differs from the chip are marked '!'.
+ */
+static int mfd_regdump_open(struct inode *inode, struct file *file)
+{
+	struct mfd_regdump *dump = inode->i_private;
+	struct mfd_regdump_text *text;
+	unsigned int *cache, *chip;
+	unsigned int reg;
+	size_t size;
+	u8 *flags;
+	char mark;
+	int ret;
+
+	cache = kcalloc(dump->num_regs, 2 * sizeof(*cache) + 1, GFP_KERNEL);
+	if (cache == NULL)
+		return -ENOMEM;
+	chip = cache + dump->num_regs;
+	flags = (u8 *)(chip + dump->num_regs);
+
+	ret = mfd_regdump_snapshot(dump, cache, chip, flags);
+	if (ret < 0)
+		goto out;
+
+	/* "reg: val m\n" with both numbers at least as wide as asked */
+	size = dump->num_regs * (max(dump->reg_digits, 8) +
+				 max(dump->val_digits, 8) + 5) + 1;
+	text = kmalloc(sizeof(*text) + size, GFP_KERNEL);
+	if (text == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	text->len = 0;
+	for (reg = 0; reg < dump->num_regs; reg++) {
+		if (!(flags[reg] & MFD_REGDUMP_SHOWN))
+			continue;
+
+		if (!(flags[reg] & MFD_REGDUMP_CHIP)) {
+			mark = 'c';
+		} else {
+			mark = 'v';
+			if ((flags[reg] & MFD_REGDUMP_CACHED) &&
+			    cache[reg] != chip[reg])
+				mark = '!';
+			cache[reg] = chip[reg];
+		}
+
+		text->len += scnprintf(text->buf + text->len, size - text->len,
+				      "%.*x: %.*x %c\n",
+				      dump->reg_digits, reg,
+				      dump->val_digits, cache[reg], mark);
+	}
+
+	file->private_data = text;
+out:
+	kfree(cache);
+	return ret;
+}
+
+static ssize_t mfd_regdump_read(struct file *file, char __user *user_buf,
+				size_t count, loff_t *ppos)
+{
+	struct mfd_regdump_text *text = file->private_data;
+
+	return simple_read_from_buffer(user_buf, count, ppos,
+				       text->buf, text->len);
+}
+
+static int mfd_regdump_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations mfd_regdump_fops = {
+	.open		= mfd_regdump_open,
+	.read		= mfd_regdump_read,
+	.release	= mfd_regdump_release,
+	.owner		= THIS_MODULE,
+};
+
+/**
+ * mfd_regdump_add - provide a debugfs snapshot of a register map
+ * @dump: description of the map, must stay around until removed
+ * @dev: device the map belongs to
+ *
+ * Creates mfd/<device>/registers, each open of which takes a point in
+ * time copy of every readable register, and mfd/<device>/cache_bypass
+ * which makes snapshots read the chip even for cached registers.
+ * Failing to create the files is not fatal to the driver so this only
+ * returns an error when @dump is unusable.
+ */
+int mfd_regdump_add(struct mfd_regdump *dump, struct device *dev)
+{
+	if (!dump->num_regs || !dump->max_block || !dump->readable ||
+	    !dump->read || !dump->lock || !dump->unlock)
+		return -EINVAL;
+
+	dump->bypass = 0;
+	dump->dir = NULL;
+	if (mfd_debugfs_root == NULL)
+		return 0;
+
+	dump->dir = debugfs_create_dir(dev_name(dev), mfd_debugfs_root);
+	if (dump->dir == NULL)
+		return 0;
+
+	debugfs_create_file("registers", 0400, dump->dir, dump,
+			    &mfd_regdump_fops);
+	debugfs_create_bool("cache_bypass", 0600, dump->dir, &dump->bypass);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mfd_regdump_add);
+
+/**
+ * mfd_regdump_remove - remove the files added by mfd_regdump_add()
+ * @dump: map to remove
+ */
+void mfd_regdump_remove(struct mfd_regdump *dump)
+{
+	debugfs_remove_recursive(dump->dir);
+	dump->dir = NULL;
+}
+EXPORT_SYMBOL_GPL(mfd_regdump_remove);
+
+static int __init mfd_regcache_init(void)
+{
+	mfd_debugfs_root = debugfs_create_dir("mfd", NULL);
+	return 0;
+}
+/* the MFD core drivers come up at subsys_initcall */
+arch_initcall(mfd_regcache_init);
+
+static void __exit mfd_regcache_exit(void)
+{
+	debugfs_remove(mfd_debugfs_root);
+}
+module_exit(mfd_regcache_exit);
+#endif
+
+MODULE_DESCRIPTION("MFD register cache helpers");
+MODULE_LICENSE("GPL");
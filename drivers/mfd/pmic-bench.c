@@ -0,0 +1,596 @@
+/*
+ * pmic-bench.c -- benchmarks for PMIC register access
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Loading this module times the register access functions of a live
+ * WM8350, WM8400 or DA903x, given by the bus and device parameters
+ * (for example bus=i2c device=0-001a), printing one line for each:
+ *
+ *	cached_read	single reads of reg, normally from the cache
+ *	volatile_read	single reads of volatile_reg, always from the chip
+ *	write		writes to write_reg of the value it already holds
+ *	update_bits	read-modify-write of write_reg leaving it unchanged
+ *	block_read	reads of count registers from reg
+ *	block_write	writes of count registers from write_reg with the
+ *			values they already hold
+ *
+ * The lines have the form
+ *
+ *	pmic-bench: <test> ops <n> errors <n> p50_ns <n> p90_ns <n>
+ *	p99_ns <n> max_ns <n> busy_pct <n>
+ *
+ * where busy_pct is the share of the run spent inside the access
+ * functions, which with gap_us between accesses approximates the bus
+ * utilisation such traffic would cause.  Tests a chip has no function
+ * for are skipped; the WM8400 has no write which is not skipped when
+ * the value is unchanged, so it gets no write or block_write lines.
+ * update_bits of an unchanged value measures the read-modify-write
+ * path of the core, which for a cached register doesn't reach the bus
+ * at all on chips that skip no-op writes.
+ *
+ * Nothing is written which changes a register, and writes are only
+ * made to registers on a list for each chip which holds no regulator,
+ * power management or interrupt status bits.  Registers which are
+ * cleared by reading them are never read either.  Load the module
+ * again to repeat the benchmarks.
+ */
+
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/err.h>
+#include <linux/i2c.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spi/spi.h>
+#include <linux/mfd/da903x.h>
+#include <linux/mfd/wm8350/core.h>
+#include <linux/mfd/wm8400-private.h>
+
+static char *bus = "i2c";
+module_param(bus, charp, 0444);
+MODULE_PARM_DESC(bus, "Bus the PMIC is on, i2c or spi");
+
+static char *device;
+module_param(device, charp, 0444);
+MODULE_PARM_DESC(device, "Name of the PMIC device on the bus");
+
+static int reg = -1;
+module_param(reg, int, 0444);
+MODULE_PARM_DESC(reg, "Register to read, defaults to one for the chip");
+
+static int volatile_reg = -1;
+module_param(volatile_reg, int, 0444);
+MODULE_PARM_DESC(volatile_reg, "Volatile register to read");
+
+static int write_reg = -1;
+module_param(write_reg, int, 0444);
+MODULE_PARM_DESC(write_reg, "Register to write, must be one the chip allows");
+
+static int count = 4;
+module_param(count, int, 0444);
+MODULE_PARM_DESC(count, "Number of registers in each block access");
+
+static int iterations = 1000;
+module_param(iterations, int, 0444);
+MODULE_PARM_DESC(iterations, "Number of times each access is repeated");
+
+static int gap_us;
+module_param(gap_us, int, 0444);
+MODULE_PARM_DESC(gap_us, "Delay between accesses");
+
+#define BENCH_MAX_BLOCK		16
+
+struct bench_range {
+	int first;
+	int last;
+};
+
+struct bench_chip {
+	const char *driver;	/* name of the MFD driver */
+	const char *id;		/* I2C device id if it matters, or NULL */
+
+	int reg;		/* defaults for the parameters */
+	int volatile_reg;
+	int write_reg;
+	/* nothing which could upset the system if rewritten */
+	const struct bench_range *writable;
+	int num_writable;
+	/* cleared by reading, so reads would lose interrupts */
+	const struct bench_range *unreadable;
+	int num_unreadable;
+
+	int (*read)(struct device *dev, int reg, unsigned int *val);
+	int (*write)(struct device *dev, int reg, unsigned int val);
+	int (*update_bits)(struct device *dev, int reg, unsigned int mask,
+			   unsigned int val);
+	int (*block_read)(struct device *dev, int reg, int n,
+			  unsigned int *vals);
+	int (*block_write)(struct device *dev, int reg, int n,
+			   const unsigned int *vals);
+};
+
+#if defined(CONFIG_MFD_WM8350) || defined(CONFIG_MFD_WM8350_MODULE)
+static int bench_wm8350_read(struct device *dev, int reg, unsigned int *val)
+{
+	*val = wm8350_reg_read(dev_get_drvdata(dev), reg);
+	return 0;
+}
+
+static int bench_wm8350_write(struct device *dev, int reg, unsigned int val)
+{
+	return wm8350_reg_write(dev_get_drvdata(dev), reg, val);
+}
+
+static int bench_wm8350_update_bits(struct device *dev, int reg,
+				    unsigned int mask, unsigned int val)
+{
+	return wm8350_reg_update_bits(dev_get_drvdata(dev), reg, mask, val);
+}
+
+static int bench_wm8350_block_read(struct device *dev, int reg, int n,
+				   unsigned int *vals)
+{
+	u16 buf[BENCH_MAX_BLOCK];
+	int i, ret;
+
+	ret = wm8350_block_read(dev_get_drvdata(dev), reg, n, buf);
+	for (i = 0; i < n; i++)
+		vals[i] = buf[i];
+
+	return ret;
+}
+
+static int bench_wm8350_block_write(struct device *dev, int reg, int n,
+				    const unsigned int *vals)
+{
+	u16 buf[BENCH_MAX_BLOCK];
+	int i;
+
+	for (i = 0; i < n; i++)
+		buf[i] = vals[i];
+
+	return wm8350_block_write(dev_get_drvdata(dev), reg, n, buf);
+}
+
+/* the headphone and line output volumes */
+static const struct bench_range bench_wm8350_writable[] = {
+	{ WM8350_LOUT1_VOLUME, WM8350_ROUT2_VOLUME },
+};
+
+static const struct bench_range bench_wm8350_unreadable[] = {
+	{ WM8350_INT_STATUS_1, WM8350_COMPARATOR_INT_STATUS },
+};
+#endif
+
+#if defined(CONFIG_MFD_WM8400) || defined(CONFIG_MFD_WM8400_MODULE)
+static int bench_wm8400_read(struct device *dev, int reg, unsigned int *val)
+{
+	*val = wm8400_reg_read(dev_get_drvdata(dev), reg);
+	return 0;
+}
+
+static int bench_wm8400_update_bits(struct device *dev, int reg,
+				    unsigned int mask, unsigned int val)
+{
+	return wm8400_set_bits(dev_get_drvdata(dev), reg, mask, val);
+}
+
+static int bench_wm8400_block_read(struct device *dev, int reg, int n,
+				   unsigned int *vals)
+{
+	u16 buf[BENCH_MAX_BLOCK];
+	int i, ret;
+
+	ret = wm8400_block_read(dev_get_drvdata(dev), reg, n, buf);
+	for (i = 0; i < n; i++)
+		vals[i] = buf[i];
+
+	return ret;
+}
+
+/* the output PGA volumes */
+static const struct bench_range bench_wm8400_writable[] = {
+	{ WM8400_LEFT_OUTPUT_VOLUME, WM8400_OUT3_4_VOLUME },
+};
+
+static const struct bench_range bench_wm8400_unreadable[] = {
+	{ WM8400_INTERRUPT_STATUS_1, WM8400_INTERRUPT_STATUS_1 },
+};
+#endif
+
+#ifdef CONFIG_PMIC_DA903X
+static int bench_da903x_read(struct device *dev, int reg, unsigned int *val)
+{
+	uint8_t v;
+	int ret;
+
+	ret = da903x_read(dev, reg, &v);
+	*val = v;
+
+	return ret;
+}
+
+static int bench_da903x_write(struct device *dev, int reg, unsigned int val)
+{
+	return da903x_write(dev, reg, val);
+}
+
+static int bench_da903x_update_bits(struct device *dev, int reg,
+				    unsigned int mask, unsigned int val)
+{
+	return da903x_update(dev, reg, val, mask);
+}
+
+/* nearly every register controls a rail, only the interrupt masks
+ * can be rewritten safely */
+static const struct bench_range bench_da9030_writable[] = {
+	{ 0x05, 0x07 },
+};
+
+static const struct bench_range bench_da9034_writable[] = {
+	{ 0x07, 0x0a },
+};
+
+/* the event registers */
+static const struct bench_range bench_da9030_unreadable[] = {
+	{ 0x01, 0x03 },
+};
+
+static const struct bench_range bench_da9034_unreadable[] = {
+	{ 0x01, 0x04 },
+};
+#endif
+
+static const struct bench_chip bench_chips[] = {
+#if defined(CONFIG_MFD_WM8350) || defined(CONFIG_MFD_WM8350_MODULE)
+	{
+		.driver = "wm8350",
+		.reg = WM8350_LOUT1_VOLUME,
+		.volatile_reg = WM8350_RESET_ID,
+		.write_reg = WM8350_LOUT1_VOLUME,
+		.writable = bench_wm8350_writable,
+		.num_writable = ARRAY_SIZE(bench_wm8350_writable),
+		.unreadable = bench_wm8350_unreadable,
+		.num_unreadable = ARRAY_SIZE(bench_wm8350_unreadable),
+		.read = bench_wm8350_read,
+		.write = bench_wm8350_write,
+		.update_bits = bench_wm8350_update_bits,
+		.block_read = bench_wm8350_block_read,
+		.block_write = bench_wm8350_block_write,
+	},
+#endif
+#if defined(CONFIG_MFD_WM8400) || defined(CONFIG_MFD_WM8400_MODULE)
+	{
+		.driver = "WM8400",
+		.reg = WM8400_LEFT_OUTPUT_VOLUME,
+		.volatile_reg = WM8400_ID,
+		.write_reg = WM8400_LEFT_OUTPUT_VOLUME,
+		.writable = bench_wm8400_writable,
+		.num_writable = ARRAY_SIZE(bench_wm8400_writable),
+		.unreadable = bench_wm8400_unreadable,
+		.num_unreadable = ARRAY_SIZE(bench_wm8400_unreadable),
+		.read = bench_wm8400_read,
+		.update_bits = bench_wm8400_update_bits,
+		.block_read = bench_wm8400_block_read,
+	},
+#endif
+#ifdef CONFIG_PMIC_DA903X
+	{
+		.driver = "da903x",
+		.id = "da9030",
+		.reg = 0x10,
+		.volatile_reg = 0x00,
+		.write_reg = 0x05,
+		.writable = bench_da9030_writable,
+		.num_writable = ARRAY_SIZE(bench_da9030_writable),
+		.unreadable = bench_da9030_unreadable,
+		.num_unreadable = ARRAY_SIZE(bench_da9030_unreadable),
+		.read = bench_da903x_read,
+		.write = bench_da903x_write,
+		.update_bits = bench_da903x_update_bits,
+	},
+	{
+		.driver = "da903x",
+		.id = "da9034",
+		.reg = 0x10,
+		.volatile_reg = 0x00,
+		.write_reg = 0x07,
+		.writable = bench_da9034_writable,
+		.num_writable = ARRAY_SIZE(bench_da9034_writable),
+		.unreadable = bench_da9034_unreadable,
+		.num_unreadable = ARRAY_SIZE(bench_da9034_unreadable),
+		.read = bench_da903x_read,
+		.write = bench_da903x_write,
+		.update_bits = bench_da903x_update_bits,
+	},
+#endif
+};
+
+struct bench_stat {
+	unsigned int errors;
+	u64 busy_ns;
+	s64 start_ns;
+	u64 *ns;	/* latency of each access */
+	int ops;
+};
+
+static void bench_start(struct bench_stat *stat)
+{
+	stat->errors = 0;
+	stat->busy_ns = 0;
+	stat->ops = 0;
+	stat->start_ns = ktime_to_ns(ktime_get());
+}
+
+static void bench_time(struct bench_stat *stat, ktime_t start, int ret)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (ret < 0)
+		stat->errors++;
+	stat->busy_ns += ns;
+	stat->ns[stat->ops++] = ns;
+
+	if (gap_us)
+		udelay(gap_us);
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u64 bench_percentile(struct bench_stat *stat, int pct)
+{
+	return stat->ns[(stat->ops - 1) * pct / 100];
+}
+
+static void bench_report(const char *name, struct bench_stat *stat)
+{
+	u64 wall_ns = ktime_to_ns(ktime_get()) - stat->start_ns;
+
+	if (!stat->ops)
+		return;
+
+	sort(stat->ns, stat->ops, sizeof(*stat->ns), bench_cmp, NULL);
+
+	printk(KERN_INFO "pmic-bench: %s ops %d errors %u p50_ns %llu "
+	       "p90_ns %llu p99_ns %llu max_ns %llu busy_pct %llu\n",
+	       name, stat->ops, stat->errors,
+	       bench_percentile(stat, 50), bench_percentile(stat, 90),
+	       bench_percentile(stat, 99), stat->ns[stat->ops - 1],
+	       wall_ns ? div64_u64(stat->busy_ns * 100, wall_ns) : 0);
+}
+
+/* is the whole of first to first + n - 1 inside one of the ranges? */
+static int bench_inside(const struct bench_range *r, int num, int first, int n)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (first >= r[i].first && first + n - 1 <= r[i].last)
+			return 1;
+
+	return 0;
+}
+
+/* does any of first to first + n - 1 overlap one of the ranges? */
+static int bench_overlaps(const struct bench_range *r, int num, int first,
+			  int n)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (first <= r[i].last && first + n - 1 >= r[i].first)
+			return 1;
+
+	return 0;
+}
+
+static void bench_run(const struct bench_chip *chip, struct device *dev,
+		      struct bench_stat *stat)
+{
+	unsigned int vals[BENCH_MAX_BLOCK];
+	unsigned int val;
+	ktime_t start;
+	int n, ret;
+
+	bench_start(stat);
+	for (n = 0; n < iterations; n++) {
+		start = ktime_get();
+		ret = chip->read(dev, reg, &val);
+		bench_time(stat, start, ret);
+	}
+	bench_report("cached_read", stat);
+
+	bench_start(stat);
+	for (n = 0; n < iterations; n++) {
+		start = ktime_get();
+		ret = chip->read(dev, volatile_reg, &val);
+		bench_time(stat, start, ret);
+	}
+	bench_report("volatile_read", stat);
+
+	ret = chip->read(dev, write_reg, &val);
+	if (ret < 0) {
+		printk(KERN_ERR "pmic-bench: failed to read R%d: %d\n",
+		       write_reg, ret);
+		return;
+	}
+
+	if (chip->write) {
+		bench_start(stat);
+		for (n = 0; n < iterations; n++) {
+			start = ktime_get();
+			ret = chip->write(dev, write_reg, val);
+			bench_time(stat, start, ret);
+		}
+		bench_report("write", stat);
+	}
+
+	bench_start(stat);
+	for (n = 0; n < iterations; n++) {
+		start = ktime_get();
+		ret = chip->update_bits(dev, write_reg, 0xff, val & 0xff);
+		bench_time(stat, start, ret);
+	}
+	bench_report("update_bits", stat);
+
+	if (chip->block_read) {
+		bench_start(stat);
+		for (n = 0; n < iterations; n++) {
+			start = ktime_get();
+			ret = chip->block_read(dev, reg, count, vals);
+			bench_time(stat, start, ret);
+		}
+		bench_report("block_read", stat);
+	}
+
+	if (chip->block_read && chip->block_write) {
+		ret = chip->block_read(dev, write_reg, count, vals);
+		if (ret < 0) {
+			printk(KERN_ERR "pmic-bench: failed to read R%d: %d\n",
+			       write_reg, ret);
+			return;
+		}
+
+		bench_start(stat);
+		for (n = 0; n < iterations; n++) {
+			start = ktime_get();
+			ret = chip->block_write(dev, write_reg, count, vals);
+			bench_time(stat, start, ret);
+		}
+		bench_report("block_write", stat);
+	}
+}
+
+static const struct bench_chip *bench_find_chip(struct device *dev)
+{
+	int i;
+
+	if (!dev->driver)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(bench_chips); i++) {
+		if (strcmp(dev->driver->name, bench_chips[i].driver))
+			continue;
+		if (bench_chips[i].id &&
+		    strcmp(to_i2c_client(dev)->name, bench_chips[i].id))
+			continue;
+		return &bench_chips[i];
+	}
+
+	return NULL;
+}
+
+static int __init bench_init(void)
+{
+	const struct bench_chip *chip;
+	struct bus_type *bus_type;
+	struct bench_stat stat;
+	struct device *dev;
+	int ret;
+
+	if (!device) {
+		printk(KERN_ERR "pmic-bench: no device given\n");
+		return -EINVAL;
+	}
+
+	if (iterations <= 0 || count <= 0 || count > BENCH_MAX_BLOCK)
+		return -EINVAL;
+
+	if (strcmp(bus, "i2c") == 0)
+		bus_type = &i2c_bus_type;
+#ifdef CONFIG_SPI_MASTER
+	else if (strcmp(bus, "spi") == 0)
+		bus_type = &spi_bus_type;
+#endif
+	else
+		return -EINVAL;
+
+	dev = bus_find_device_by_name(bus_type, NULL, device);
+	if (!dev) {
+		printk(KERN_ERR "pmic-bench: %s not found on %s\n",
+		       device, bus);
+		return -ENODEV;
+	}
+
+	stat.ns = kmalloc(iterations * sizeof(*stat.ns), GFP_KERNEL);
+	if (!stat.ns) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* keep the driver bound while we use it */
+	down(&dev->sem);
+
+	chip = bench_find_chip(dev);
+	if (!chip) {
+		printk(KERN_ERR "pmic-bench: %s is not a supported PMIC\n",
+		       device);
+		ret = -ENODEV;
+		goto out_unlock;
+	}
+
+	if (reg < 0)
+		reg = chip->reg;
+	if (volatile_reg < 0)
+		volatile_reg = chip->volatile_reg;
+	if (write_reg < 0)
+		write_reg = chip->write_reg;
+
+	if (!bench_inside(chip->writable, chip->num_writable, write_reg,
+			  chip->block_write ? count : 1)) {
+		printk(KERN_ERR "pmic-bench: R%d may not be written\n",
+		       write_reg);
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	if (bench_overlaps(chip->unreadable, chip->num_unreadable, reg,
+			   chip->block_read ? count : 1) ||
+	    bench_overlaps(chip->unreadable, chip->num_unreadable,
+			   volatile_reg, 1)) {
+		printk(KERN_ERR "pmic-bench: reading R%d or R%d would "
+		       "clear interrupts\n", reg, volatile_reg);
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	printk(KERN_INFO "pmic-bench: %s %s reg %d volatile_reg %d "
+	       "write_reg %d count %d iterations %d gap_us %d\n",
+	       dev->driver->name, device, reg, volatile_reg, write_reg,
+	       count, iterations, gap_us);
+
+	bench_run(chip, dev, &stat);
+	ret = 0;
+
+out_unlock:
+	up(&dev->sem);
+	kfree(stat.ns);
+out:
+	put_device(dev);
+
+	return ret;
+}
+module_init(bench_init);
+
+static void __exit bench_exit(void)
+{
+}
+module_exit(bench_exit);
+
+MODULE_DESCRIPTION("PMIC register access benchmarks");
+MODULE_LICENSE("GPL");
@@ -75,6 +75,7 @@ struct sm501_devdata {
 	unsigned long			 pm_misc;
 
 	int				 unit_power[20];
+	unsigned long			 power_gate;	/* last gate seen */
 	unsigned int			 pdev_id;
 	unsigned int			 irq;
 	void __iomem			*regs;
@@ -309,6 +310,10 @@ EXPORT_SYMBOL_GPL(sm501_modify_reg);
 /* sm501_unit_power
  *
  * alters the power active gate to set specific units on or off
+ *
+ * Each unit is reference counted, the gate is only touched when the
+ * count changes to or from zero so that the power mode switch and
+ * its delay are skipped for units which are already in use.
  */
 
 int sm501_unit_power(struct device *dev, unsigned int unit, unsigned int to)
@@ -320,11 +325,7 @@ int sm501_unit_power(struct device *dev, unsigned int unit, unsigned int to)
 
 	mutex_lock(&sm->clock_lock);
 
-	mode = readl(sm->regs + SM501_POWER_MODE_CONTROL);
-	gate = readl(sm->regs + SM501_CURRENT_GATE);
-	clock = readl(sm->regs + SM501_CURRENT_CLOCK);
-
-	mode &= 3;		/* get current power mode */
+	gate = sm->power_gate;
 
 	if (unit >= ARRAY_SIZE(sm->unit_power)) {
 		dev_err(dev, "%s: bad unit %d\n", __func__, unit);
@@ -340,7 +341,18 @@ int sm501_unit_power(struct device *dev, unsigned int unit, unsigned int to)
 	}
 
 	sm->unit_power[unit] += to ? 1 : -1;
-	to = sm->unit_power[unit] ? 1 : 0;
+
+	/* only the first user powering up and the last one powering
+	 * down change the effective state of the unit */
+	if (sm->unit_power[unit] != (to ? 1 : 0))
+		goto already;
+
+	mode = readl(sm->regs + SM501_POWER_MODE_CONTROL);
+	gate = readl(sm->regs + SM501_CURRENT_GATE);
+	clock = readl(sm->regs + SM501_CURRENT_CLOCK);
+
+	mode &= 3;		/* get current power mode */
+	sm->power_gate = gate;
 
 	if (to) {
 		if (gate & (1 << unit))
@@ -366,11 +378,13 @@ int sm501_unit_power(struct device *dev, unsigned int unit, unsigned int to)
 		break;
 
 	default:
-		return -1;
+		gate = -1;
+		goto already;
 	}
 
 	writel(mode, sm->regs + SM501_POWER_MODE_CONTROL);
 	sm501_sync_regs(sm);
+	sm->power_gate = gate;
 
 	dev_dbg(sm->dev, "gate %08lx, clock %08lx, mode %08lx\n",
 		gate, clock, mode);
@@ -598,6 +612,15 @@ unsigned long sm501_set_clock(struct device *dev,
 
 	mode &= 3;	/* find current mode */
 
+	/* nothing to do if the clock is already running at this rate,
+	 * avoiding the power mode switch and its delay */
+	if (clock == readl(sm->regs + SM501_CURRENT_CLOCK) &&
+	    (!pll_reg ||
+	     pll_reg == readl(sm->regs + SM501_PROGRAMMABLE_PLL_CONTROL))) {
+		mutex_unlock(&sm->clock_lock);
+		return sm501_freq;
+	}
+
 	switch (mode) {
 	case 1:
 		writel(gate, sm->regs + SM501_POWER_MODE_0_GATE);
@@ -622,6 +645,7 @@ unsigned long sm501_set_clock(struct device *dev,
 		writel(pll_reg, sm->regs + SM501_PROGRAMMABLE_PLL_CONTROL);
 
 	sm501_sync_regs(sm);
+	sm->power_gate = gate;
 
 	dev_dbg(sm->dev, "gate %08lx, clock %08lx, mode %08lx\n",
 		gate, clock, mode);
@@ -1326,6 +1350,7 @@ static int sm501_init_dev(struct sm501_devdata *sm)
 		 sm->regs, devid, (unsigned long)mem_avail >> 20, sm->irq);
 
 	sm->rev = devid & SM501_DEVICEID_REVMASK;
+	sm->power_gate = readl(sm->regs + SM501_CURRENT_GATE);
 
 	sm501_dump_gate(sm);
 
@@ -29,12 +29,14 @@
 
 #include <linux/init.h>
 #include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/err.h>
 
 #include <linux/i2c.h>
 #include <linux/i2c/twl4030.h>
+#include <linux/mfd/regcache.h>
 
 
 /*
@@ -211,39 +213,54 @@ static struct twl4030mapping twl4030_map[TWL4030_MODULE_LAST + 1] = {
 
 /*----------------------------------------------------------------------*/
 
-/* Exported Functions */
-
-/**
- * twl4030_i2c_write - Writes a n bit register in TWL4030
- * @mod_no: module number
- * @value: an array of num_bytes+1 containing data to write
- * @reg: register address (just offset will do)
- * @num_bytes: number of bytes to transfer
- *
- * IMPORTANT: for 'value' parameter: Allocate value num_bytes+1 and
- * valid data starts at Offset 1.
- *
- * Returns the result of operation - 0 is success
+/*
+ * Optional register cache for a module, allocated by its driver once it
+ * knows which registers are safe to cache.  Entries fill in as registers
+ * are written or read; the whole thing is protected by the xfer_lock of
+ * the slave the module lives on.
  */
-int twl4030_i2c_write(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
+struct twl4030_cache {
+	unsigned num_regs;
+	const unsigned long *volatile_regs;
+	unsigned long *valid;
+	u8 *regs;
+};
+
+static struct twl4030_cache *twl4030_cache[TWL4030_MODULE_LAST + 1];
+
+static inline bool twl4030_cacheable(struct twl4030_cache *cache,
+				     unsigned reg)
+{
+	return cache && reg < cache->num_regs &&
+		!(cache->volatile_regs && test_bit(reg, cache->volatile_regs));
+}
+
+static struct twl4030_client *twl4030_get_client(u8 mod_no)
 {
-	int ret;
 	int sid;
-	struct twl4030_client *twl;
-	struct i2c_msg *msg;
 
 	if (unlikely(mod_no > TWL4030_MODULE_LAST)) {
 		pr_err("%s: invalid module number %d\n", DRIVER_NAME, mod_no);
-		return -EPERM;
+		return NULL;
 	}
 	sid = twl4030_map[mod_no].sid;
-	twl = &twl4030_modules[sid];
 
 	if (unlikely(!inuse)) {
 		pr_err("%s: client %d is not initialized\n", DRIVER_NAME, sid);
-		return -EPERM;
+		return NULL;
 	}
-	mutex_lock(&twl->xfer_lock);
+	return &twl4030_modules[sid];
+}
+
+/* called with twl->xfer_lock held */
+static int twl4030_xfer_write(struct twl4030_client *twl, u8 mod_no,
+			      u8 *value, u8 reg, u8 num_bytes)
+{
+	struct twl4030_cache *cache = twl4030_cache[mod_no];
+	struct i2c_msg *msg;
+	unsigned i;
+	int ret;
+
 	/*
 	 * [MSG1]: fill the register address data
 	 * fill the data Tx buffer
@@ -256,44 +273,40 @@ int twl4030_i2c_write(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
 	/* over write the first byte of buffer with the register address */
 	*value = twl4030_map[mod_no].base + reg;
 	ret = i2c_transfer(twl->client->adapter, twl->xfer_msg, 1);
-	mutex_unlock(&twl->xfer_lock);
 
 	/* i2cTransfer returns num messages.translate it pls.. */
-	if (ret >= 0)
-		ret = 0;
-	return ret;
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < num_bytes; i++) {
+		if (!twl4030_cacheable(cache, reg + i))
+			continue;
+		cache->regs[reg + i] = value[i + 1];
+		__set_bit(reg + i, cache->valid);
+	}
+	return 0;
 }
-EXPORT_SYMBOL(twl4030_i2c_write);
 
-/**
- * twl4030_i2c_read - Reads a n bit register in TWL4030
- * @mod_no: module number
- * @value: an array of num_bytes containing data to be read
- * @reg: register address (just offset will do)
- * @num_bytes: number of bytes to transfer
- *
- * Returns result of operation - num_bytes is success else failure.
- */
-int twl4030_i2c_read(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
+/* called with twl->xfer_lock held */
+static int twl4030_xfer_read(struct twl4030_client *twl, u8 mod_no,
+			     u8 *value, u8 reg, u8 num_bytes)
 {
-	int ret;
-	u8 val;
-	int sid;
-	struct twl4030_client *twl;
+	struct twl4030_cache *cache = twl4030_cache[mod_no];
 	struct i2c_msg *msg;
+	unsigned i;
+	u8 val;
+	int ret;
 
-	if (unlikely(mod_no > TWL4030_MODULE_LAST)) {
-		pr_err("%s: invalid module number %d\n", DRIVER_NAME, mod_no);
-		return -EPERM;
+	/* only go to the chip if something isn't cached */
+	for (i = 0; i < num_bytes; i++)
+		if (!twl4030_cacheable(cache, reg + i) ||
+		    !test_bit(reg + i, cache->valid))
+			break;
+	if (i == num_bytes) {
+		memcpy(value, &cache->regs[reg], num_bytes);
+		return 0;
 	}
-	sid = twl4030_map[mod_no].sid;
-	twl = &twl4030_modules[sid];
 
-	if (unlikely(!inuse)) {
-		pr_err("%s: client %d is not initialized\n", DRIVER_NAME, sid);
-		return -EPERM;
-	}
-	mutex_lock(&twl->xfer_lock);
 	/* [MSG1] fill the register address data */
 	msg = &twl->xfer_msg[0];
 	msg->addr = twl->address;
@@ -308,11 +321,77 @@ int twl4030_i2c_read(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
 	msg->len = num_bytes;	/* only n bytes */
 	msg->buf = value;
 	ret = i2c_transfer(twl->client->adapter, twl->xfer_msg, 2);
-	mutex_unlock(&twl->xfer_lock);
 
 	/* i2cTransfer returns num messages.translate it pls.. */
-	if (ret >= 0)
-		ret = 0;
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < num_bytes; i++) {
+		if (!twl4030_cacheable(cache, reg + i))
+			continue;
+		cache->regs[reg + i] = value[i];
+		__set_bit(reg + i, cache->valid);
+	}
+	return 0;
+}
+
+/*----------------------------------------------------------------------*/
+
+/* Exported Functions */
+
+/**
+ * twl4030_i2c_write - Writes a n bit register in TWL4030
+ * @mod_no: module number
+ * @value: an array of num_bytes+1 containing data to write
+ * @reg: register address (just offset will do)
+ * @num_bytes: number of bytes to transfer
+ *
+ * IMPORTANT: for 'value' parameter: Allocate value num_bytes+1 and
+ * valid data starts at Offset 1.
+ *
+ * Returns the result of operation - 0 is success
+ */
+int twl4030_i2c_write(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
+{
+	struct twl4030_client *twl;
+	int ret;
+
+	twl = twl4030_get_client(mod_no);
+	if (!twl)
+		return -EPERM;
+
+	mutex_lock(&twl->xfer_lock);
+	ret = twl4030_xfer_write(twl, mod_no, value, reg, num_bytes);
+	mutex_unlock(&twl->xfer_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(twl4030_i2c_write);
+
+/**
+ * twl4030_i2c_read - Reads a n bit register in TWL4030
+ * @mod_no: module number
+ * @value: an array of num_bytes containing data to be read
+ * @reg: register address (just offset will do)
+ * @num_bytes: number of bytes to transfer
+ *
+ * Cached registers are returned without going to the chip.
+ *
+ * Returns result of operation - 0 is success
+ */
+int twl4030_i2c_read(u8 mod_no, u8 *value, u8 reg, u8 num_bytes)
+{
+	struct twl4030_client *twl;
+	int ret;
+
+	twl = twl4030_get_client(mod_no);
+	if (!twl)
+		return -EPERM;
+
+	mutex_lock(&twl->xfer_lock);
+	ret = twl4030_xfer_read(twl, mod_no, value, reg, num_bytes);
+	mutex_unlock(&twl->xfer_lock);
+
 	return ret;
 }
 EXPORT_SYMBOL(twl4030_i2c_read);
@@ -350,6 +429,266 @@ int twl4030_i2c_read_u8(u8 mod_no, u8 *value, u8 reg)
 }
 EXPORT_SYMBOL(twl4030_i2c_read_u8);
 
+/**
+ * twl4030_i2c_update_regs - Read-modify-write several TWL4030 registers
+ * @mod_no: module number
+ * @upd: the registers to update, each with the bits to change and
+ *	their new value
+ * @num_updates: number of entries in @upd
+ *
+ * The updates are applied in order with the slave locked, so nothing
+ * else can touch the registers between the read and the write.
+ * Registers whose value would not change are not written.
+ *
+ * Returns result of operation - 0 is success
+ */
+int twl4030_i2c_update_regs(u8 mod_no, const struct twl4030_reg_update *upd,
+			    unsigned num_updates)
+{
+	struct twl4030_client *twl;
+	unsigned i;
+	u8 buf[2];
+	u8 val;
+	int ret = 0;
+
+	twl = twl4030_get_client(mod_no);
+	if (!twl)
+		return -EPERM;
+
+	mutex_lock(&twl->xfer_lock);
+	for (i = 0; i < num_updates; i++) {
+		ret = twl4030_xfer_read(twl, mod_no, &buf[1], upd[i].reg, 1);
+		if (ret < 0)
+			break;
+
+		val = (buf[1] & ~upd[i].mask) | (upd[i].value & upd[i].mask);
+		if (val == buf[1])
+			continue;
+
+		buf[1] = val;
+		ret = twl4030_xfer_write(twl, mod_no, buf, upd[i].reg, 1);
+		if (ret < 0)
+			break;
+	}
+	mutex_unlock(&twl->xfer_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(twl4030_i2c_update_regs);
+
+/**
+ * twl4030_i2c_update_bits - Read-modify-write a 8 bit register in TWL4030
+ * @mod_no: module number
+ * @mask: the bits to change
+ * @value: the new value for the bits in @mask
+ * @reg: register address (just offset will do)
+ *
+ * Returns result of operation - 0 is success
+ */
+int twl4030_i2c_update_bits(u8 mod_no, u8 mask, u8 value, u8 reg)
+{
+	struct twl4030_reg_update upd = {
+		.reg = reg,
+		.mask = mask,
+		.value = value,
+	};
+
+	return twl4030_i2c_update_regs(mod_no, &upd, 1);
+}
+EXPORT_SYMBOL(twl4030_i2c_update_bits);
+
+/**
+ * twl4030_i2c_cache_init - Cache the registers of a TWL4030 module
+ * @mod_no: module number
+ * @num_regs: number of registers to cache, starting at offset 0
+ * @volatile_regs: bitmap of registers which must always be read from
+ *	the chip, or NULL if there are none
+ *
+ * Only the module's driver knows which of its registers change behind
+ * the host's back (status, input and clear-on-read registers), so it
+ * must describe them in @volatile_regs.  That bitmap is not copied.
+ * The cache starts out empty and fills in as registers are accessed.
+ *
+ * Returns result of operation - 0 is success
+ */
+int twl4030_i2c_cache_init(u8 mod_no, unsigned num_regs,
+			   const unsigned long *volatile_regs)
+{
+	struct twl4030_client *twl;
+	struct twl4030_cache *cache;
+	int ret = 0;
+
+	twl = twl4030_get_client(mod_no);
+	if (!twl)
+		return -EPERM;
+
+	if (!num_regs || twl4030_map[mod_no].base + num_regs > 0x100)
+		return -EINVAL;
+
+	cache = kzalloc(sizeof(*cache) +
+			BITS_TO_LONGS(num_regs) * sizeof(long) + num_regs,
+			GFP_KERNEL);
+	if (!cache)
+		return -ENOMEM;
+
+	cache->num_regs = num_regs;
+	cache->volatile_regs = volatile_regs;
+	cache->valid = (unsigned long *)(cache + 1);
+	cache->regs = (u8 *)(cache->valid + BITS_TO_LONGS(num_regs));
+
+	mutex_lock(&twl->xfer_lock);
+	if (twl4030_cache[mod_no])
+		ret = -EBUSY;
+	else
+		twl4030_cache[mod_no] = cache;
+	mutex_unlock(&twl->xfer_lock);
+
+	if (ret < 0)
+		kfree(cache);
+	return ret;
+}
+EXPORT_SYMBOL(twl4030_i2c_cache_init);
+
+/**
+ * twl4030_i2c_cache_exit - Stop caching the registers of a TWL4030 module
+ * @mod_no: module number
+ */
+void twl4030_i2c_cache_exit(u8 mod_no)
+{
+	struct twl4030_client *twl;
+	struct twl4030_cache *cache;
+
+	twl = twl4030_get_client(mod_no);
+	if (!twl)
+		return;
+
+	mutex_lock(&twl->xfer_lock);
+	cache = twl4030_cache[mod_no];
+	twl4030_cache[mod_no] = NULL;
+	mutex_unlock(&twl->xfer_lock);
+
+	kfree(cache);
+}
+EXPORT_SYMBOL(twl4030_i2c_cache_exit);
+
+/*----------------------------------------------------------------------*/
+
+/*
+ * debugfs register snapshot.  Registers are numbered (slave << 8) |
+ * address.  Only the modules whose drivers have set up a cache have a
+ * known extent, and of those only the cacheable registers are shown
+ * since the volatile ones may clear on read.
+ */
+static struct twl4030_cache *twl4030_dump_cache(unsigned int reg,
+						unsigned *offset)
+{
+	unsigned sid = reg >> 8;
+	unsigned addr = reg & 0xff;
+	struct twl4030_cache *cache;
+	unsigned i;
+
+	for (i = 0; i <= TWL4030_MODULE_LAST; i++) {
+		cache = twl4030_cache[i];
+		if (!cache || twl4030_map[i].sid != sid ||
+		    addr < twl4030_map[i].base)
+			continue;
+
+		*offset = addr - twl4030_map[i].base;
+		if (twl4030_cacheable(cache, *offset))
+			return cache;
+	}
+
+	return NULL;
+}
+
+static int twl4030_dump_readable(void *data, unsigned int reg)
+{
+	unsigned offset;
+
+	return twl4030_dump_cache(reg, &offset) != NULL;
+}
+
+static int twl4030_dump_cached(void *data, unsigned int reg,
+			       unsigned int *val)
+{
+	struct twl4030_cache *cache;
+	unsigned offset;
+
+	cache = twl4030_dump_cache(reg, &offset);
+	if (!cache || !test_bit(offset, cache->valid))
+		return 0;
+
+	*val = cache->regs[offset];
+	return 1;
+}
+
+static int twl4030_dump_read(void *data, unsigned int reg, unsigned int count,
+			     unsigned int *vals)
+{
+	struct twl4030_client *twl;
+	struct i2c_msg xfer[2];
+	u8 buf[0x100];
+	u8 addr;
+	unsigned n, i;
+	int ret;
+
+	/* a run may carry on from one slave into the next */
+	while (count) {
+		twl = &twl4030_modules[reg >> 8];
+		addr = reg & 0xff;
+		n = min_t(unsigned, count, 0x100 - addr);
+
+		xfer[0].addr = twl->address;
+		xfer[0].flags = 0;
+		xfer[0].len = 1;
+		xfer[0].buf = &addr;
+		xfer[1].addr = twl->address;
+		xfer[1].flags = I2C_M_RD;
+		xfer[1].len = n;
+		xfer[1].buf = buf;
+		ret = i2c_transfer(twl->client->adapter, xfer, 2);
+		if (ret < 0)
+			return ret;
+
+		for (i = 0; i < n; i++)
+			vals[i] = buf[i];
+
+		vals += n;
+		reg += n;
+		count -= n;
+	}
+
+	return 0;
+}
+
+static void twl4030_dump_lock(void *data)
+{
+	unsigned i;
+
+	for (i = 0; i < TWL4030_NUM_SLAVES; i++)
+		mutex_lock_nested(&twl4030_modules[i].xfer_lock, i);
+}
+
+static void twl4030_dump_unlock(void *data)
+{
+	unsigned i;
+
+	for (i = TWL4030_NUM_SLAVES; i > 0; i--)
+		mutex_unlock(&twl4030_modules[i - 1].xfer_lock);
+}
+
+static struct mfd_regdump twl4030_regdump = {
+	.num_regs	= TWL4030_NUM_SLAVES << 8,
+	.max_block	= 0x100,
+	.reg_digits	= 3,
+	.val_digits	= 2,
+	.readable	= twl4030_dump_readable,
+	.cached		= twl4030_dump_cached,
+	.read		= twl4030_dump_read,
+	.lock		= twl4030_dump_lock,
+	.unlock		= twl4030_dump_unlock,
+};
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -696,6 +1035,8 @@ static int twl4030_remove(struct i2c_client *client)
 	if (status < 0)
 		return status;
 
+	mfd_regdump_remove(&twl4030_regdump);
+
 	for (i = 0; i < TWL4030_NUM_SLAVES; i++) {
 		struct twl4030_client	*twl = &twl4030_modules[i];
 
@@ -703,6 +1044,11 @@ static int twl4030_remove(struct i2c_client *client)
 			i2c_unregister_device(twl->client);
 		twl4030_modules[i].client = NULL;
 	}
+
+	for (i = 0; i <= TWL4030_MODULE_LAST; i++) {
+		kfree(twl4030_cache[i]);
+		twl4030_cache[i] = NULL;
+	}
 	inuse = false;
 	return 0;
 }
@@ -764,6 +1110,11 @@ twl4030_probe(struct i2c_client *client, const struct i2c_device_id *id)
 			goto fail;
 	}
 
+	/* the rest of the system needs our supplies to resume */
+	device_enable_resume_first(&client->dev);
+
+	mfd_regdump_add(&twl4030_regdump, &client->dev);
+
 	status = add_children(pdata);
 fail:
 	if (status < 0)
@@ -31,6 +31,10 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/kthread.h>
+#include <linux/kernel_stat.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/i2c/twl4030.h>
 
@@ -174,95 +178,6 @@ static unsigned twl4030_irq_base;
 
 static struct completion irq_event;
 
-/*
- * This thread processes interrupts reported by the Primary Interrupt Handler.
- */
-static int twl4030_irq_thread(void *data)
-{
-	long irq = (long)data;
-	irq_desc_t *desc = irq_desc + irq;
-	static unsigned i2c_errors;
-	const static unsigned max_i2c_errors = 100;
-
-	current->flags |= PF_NOFREEZE;
-
-	while (!kthread_should_stop()) {
-		int ret;
-		int module_irq;
-		u8 pih_isr;
-
-		/* Wait for IRQ, then read PIH irq status (also blocking) */
-		wait_for_completion_interruptible(&irq_event);
-
-		ret = twl4030_i2c_read_u8(TWL4030_MODULE_PIH, &pih_isr,
-					  REG_PIH_ISR_P1);
-		if (ret) {
-			pr_warning("twl4030: I2C error %d reading PIH ISR\n",
-					ret);
-			if (++i2c_errors >= max_i2c_errors) {
-				printk(KERN_ERR "Maximum I2C error count"
-						" exceeded.  Terminating %s.\n",
-						__func__);
-				break;
-			}
-			complete(&irq_event);
-			continue;
-		}
-
-		/* these handlers deal with the relevant SIH irq status */
-		local_irq_disable();
-		for (module_irq = twl4030_irq_base;
-				pih_isr;
-				pih_isr >>= 1, module_irq++) {
-			if (pih_isr & 0x1) {
-				irq_desc_t *d = irq_desc + module_irq;
-
-				/* These can't be masked ... always warn
-				 * if we get any surprises.
-				 */
-				if (d->status & IRQ_DISABLED)
-					note_interrupt(module_irq, d,
-							IRQ_NONE);
-				else
-					d->handle_irq(module_irq, d);
-			}
-		}
-		local_irq_enable();
-
-		desc->chip->unmask(irq);
-	}
-
-	return 0;
-}
-
-/*
- * handle_twl4030_pih() is the desc->handle method for the twl4030 interrupt.
- * This is a chained interrupt, so there is no desc->action method for it.
- * Now we need to query the interrupt controller in the twl4030 to determine
- * which module is generating the interrupt request.  However, we can't do i2c
- * transactions in interrupt context, so we must defer that work to a kernel
- * thread.  All we do here is acknowledge and mask the interrupt and wakeup
- * the kernel thread.
- */
-static void handle_twl4030_pih(unsigned int irq, irq_desc_t *desc)
-{
-	/* Acknowledge, clear *AND* mask the interrupt... */
-	desc->chip->ack(irq);
-	complete(&irq_event);
-}
-
-static struct task_struct *start_twl4030_irq_thread(long irq)
-{
-	struct task_struct *thread;
-
-	init_completion(&irq_event);
-	thread = kthread_run(twl4030_irq_thread, (void *)irq, "twl4030-irq");
-	if (!thread)
-		pr_err("twl4030: could not create irq %ld thread!\n", irq);
-
-	return thread;
-}
-
 /*----------------------------------------------------------------------*/
 
 /*
@@ -382,6 +297,9 @@ struct sih_agent {
 
 	u32			edge_change;
 	struct work_struct	edge_work;
+
+	u32			replay;		/* for twl4030_irq_thread() */
+	struct twl4030_irq_stat	*stats;
 };
 
 static void twl4030_sih_do_mask(struct work_struct *work)
@@ -529,11 +447,26 @@ static int twl4030_sih_set_type(unsigned irq, unsigned trigger)
 	return 0;
 }
 
+/* IRQs which came in while disabled are replayed by the IRQ thread */
+static int twl4030_sih_retrigger(unsigned irq)
+{
+	struct sih_agent *sih = get_irq_chip_data(irq);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sih_agent_lock, flags);
+	sih->replay |= BIT(irq - sih->irq_base);
+	spin_unlock_irqrestore(&sih_agent_lock, flags);
+
+	complete(&irq_event);
+	return 1;
+}
+
 static struct irq_chip twl4030_sih_irq_chip = {
 	.name		= "twl4030",
 	.mask		= twl4030_sih_mask,
 	.unmask		= twl4030_sih_unmask,
 	.set_type	= twl4030_sih_set_type,
+	.retrigger	= twl4030_sih_retrigger,
 };
 
 /*----------------------------------------------------------------------*/
@@ -556,40 +489,296 @@ static inline int sih_read_isr(const struct sih *sih)
 }
 
 /*
- * Generic handler for SIH interrupts ... we "know" this is called
- * in task context, with IRQs enabled.
+ * Dispatch runs entirely in twl4030_irq_thread(), with IRQs enabled:
+ * the handlers of these interrupts may (and almost always do) need to
+ * sleep on I2C.  Each pass first reads the PIH status and then every
+ * flagged SIH status back to back; those reads ack the chip, so the
+ * host IRQ can be unmasked again before any handler runs.
  */
-static void handle_twl4030_sih(unsigned irq, struct irq_desc *desc)
+
+/* when the host IRQ last fired, used for the latency statistics */
+static ktime_t twl4030_irq_stamp;
+
+/* per IRQ dispatch latency, host IRQ to the start of the handler */
+struct twl4030_irq_stat {
+	unsigned long	count;
+	u64		total_ns;
+	u64		max_ns;
+};
+
+static struct twl4030_irq_stat pih_stats[8];
+
+/* indexed like sih_modules, set up by twl4030_sih_setup() */
+static struct sih_agent *sih_agents[ARRAY_SIZE(sih_modules)];
+
+static void twl4030_irq_account(struct twl4030_irq_stat *stat, ktime_t stamp)
 {
-	struct sih_agent *agent = get_irq_data(irq);
-	const struct sih *sih = agent->sih;
-	int isr;
+	u64 ns;
 
-	/* reading ISR acks the IRQs, using clear-on-read mode */
-	local_irq_enable();
-	isr = sih_read_isr(sih);
-	local_irq_disable();
+	if (!stat)
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), stamp));
+	stat->count++;
+	stat->total_ns += ns;
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
+}
 
-	if (isr < 0) {
-		pr_err("twl4030: %s SIH, read ISR error %d\n",
-			sih->name, isr);
-		/* REVISIT:  recover; eventually mask it all, etc */
+/*
+ * Run the handlers for one of our IRQs.  This is handle_simple_irq()
+ * for a caller in task context; SIH interrupts which arrive while
+ * disabled are masked and later replayed by twl4030_sih_retrigger().
+ */
+static void twl4030_handle_nested(unsigned irq, bool replay,
+				  struct twl4030_irq_stat *stat, ktime_t stamp)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irqaction *action;
+	irqreturn_t ret = IRQ_NONE;
+
+	spin_lock_irq(&desc->lock);
+	kstat_incr_irqs_this_cpu(irq, desc);
+	desc->status &= ~(IRQ_REPLAY | IRQ_WAITING);
+
+	action = desc->action;
+	if (unlikely(!action || (desc->status & IRQ_DISABLED))) {
+		if (replay) {
+			desc->status |= IRQ_PENDING | IRQ_MASKED;
+			desc->chip->mask(irq);
+			spin_unlock_irq(&desc->lock);
+			return;
+		}
+		spin_unlock_irq(&desc->lock);
+
+		/* These can't be masked ... always warn
+		 * if we get any surprises.
+		 */
+		if (action)
+			goto out;
 		return;
 	}
+	desc->status |= IRQ_INPROGRESS;
+	spin_unlock_irq(&desc->lock);
+
+	twl4030_irq_account(stat, stamp);
+
+	do {
+		ret |= action->handler(irq, action->dev_id);
+		action = action->next;
+	} while (action);
 
-	while (isr) {
-		irq = fls(isr);
-		irq--;
-		isr &= ~BIT(irq);
+	spin_lock_irq(&desc->lock);
+	desc->status &= ~IRQ_INPROGRESS;
+	spin_unlock_irq(&desc->lock);
 
-		if (irq < sih->bits)
-			generic_handle_irq(agent->irq_base + irq);
-		else
-			pr_err("twl4030: %s SIH, invalid ISR bit %d\n",
-				sih->name, irq);
+out:
+	/* the spurious IRQ detector expects to be called from hardirq */
+	local_irq_disable();
+	note_interrupt(irq, desc, ret);
+	local_irq_enable();
+}
+
+/*
+ * This thread processes interrupts reported by the Primary Interrupt Handler.
+ */
+static int twl4030_irq_thread(void *data)
+{
+	long irq = (long)data;
+	irq_desc_t *desc = irq_desc + irq;
+	static unsigned i2c_errors;
+	const static unsigned max_i2c_errors = 100;
+
+	current->flags |= PF_NOFREEZE;
+
+	while (!kthread_should_stop()) {
+		int ret;
+		int i;
+		u8 pih_isr;
+		u32 sih_isr[ARRAY_SIZE(sih_modules)];
+		u32 replay[ARRAY_SIZE(sih_modules)];
+		ktime_t stamp;
+
+		/* Wait for IRQ, then read PIH irq status (also blocking) */
+		wait_for_completion_interruptible(&irq_event);
+		stamp = twl4030_irq_stamp;
+
+		ret = twl4030_i2c_read_u8(TWL4030_MODULE_PIH, &pih_isr,
+					  REG_PIH_ISR_P1);
+		if (ret) {
+			pr_warning("twl4030: I2C error %d reading PIH ISR\n",
+					ret);
+			if (++i2c_errors >= max_i2c_errors) {
+				printk(KERN_ERR "Maximum I2C error count"
+						" exceeded.  Terminating %s.\n",
+						__func__);
+				break;
+			}
+			complete(&irq_event);
+			continue;
+		}
+
+		/* reading each ISR acks the IRQs, using clear-on-read mode */
+		for (i = 0; i < ARRAY_SIZE(sih_modules); i++) {
+			struct sih_agent *agent = sih_agents[i];
+
+			sih_isr[i] = 0;
+			replay[i] = 0;
+			if (!agent)
+				continue;
+
+			if (pih_isr & BIT(i)) {
+				ret = sih_read_isr(agent->sih);
+				if (ret < 0)
+					/* REVISIT:  recover; eventually
+					 * mask it all, etc
+					 */
+					pr_err("twl4030: %s SIH, read ISR "
+						"error %d\n",
+						agent->sih->name, ret);
+				else
+					sih_isr[i] = ret;
+			}
+
+			spin_lock_irq(&sih_agent_lock);
+			replay[i] = agent->replay;
+			agent->replay = 0;
+			spin_unlock_irq(&sih_agent_lock);
+		}
+
+		/* nothing is latched now, so let the next IRQ come in */
+		desc->chip->unmask(irq);
+
+		for (i = 0; i < ARRAY_SIZE(sih_modules); i++) {
+			struct sih_agent *agent = sih_agents[i];
+			u32 isr = sih_isr[i] | replay[i];
+			int bit;
+
+			if (!agent) {
+				if (pih_isr & BIT(i))
+					twl4030_handle_nested(
+						twl4030_irq_base + i, false,
+						&pih_stats[i], stamp);
+				continue;
+			}
+
+			while (isr) {
+				bit = fls(isr) - 1;
+				isr &= ~BIT(bit);
+
+				if (bit >= agent->sih->bits) {
+					pr_err("twl4030: %s SIH, invalid "
+						"ISR bit %d\n",
+						agent->sih->name, bit);
+					continue;
+				}
+
+				/* replays have no meaningful latency */
+				twl4030_handle_nested(agent->irq_base + bit,
+					true,
+					(sih_isr[i] & BIT(bit)) ?
+						&agent->stats[bit] : NULL,
+					stamp);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * handle_twl4030_pih() is the desc->handle method for the twl4030 interrupt.
+ * This is a chained interrupt, so there is no desc->action method for it.
+ * Now we need to query the interrupt controller in the twl4030 to determine
+ * which module is generating the interrupt request.  However, we can't do i2c
+ * transactions in interrupt context, so we must defer that work to a kernel
+ * thread.  All we do here is acknowledge and mask the interrupt and wakeup
+ * the kernel thread.
+ */
+static void handle_twl4030_pih(unsigned int irq, irq_desc_t *desc)
+{
+	/* Acknowledge, clear *AND* mask the interrupt... */
+	desc->chip->ack(irq);
+	twl4030_irq_stamp = ktime_get();
+	complete(&irq_event);
+}
+
+static struct task_struct *start_twl4030_irq_thread(long irq)
+{
+	struct task_struct *thread;
+
+	init_completion(&irq_event);
+	thread = kthread_run(twl4030_irq_thread, (void *)irq, "twl4030-irq");
+	if (!thread)
+		pr_err("twl4030: could not create irq %ld thread!\n", irq);
+
+	return thread;
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static void twl4030_irq_stat_show(struct seq_file *s, unsigned irq,
+				  const struct twl4030_irq_stat *stat)
+{
+	if (!stat->count)
+		return;
+
+	seq_printf(s, "%4u: %8lu %8llu %8llu\n", irq, stat->count,
+		   div_u64(stat->total_ns, stat->count) / NSEC_PER_USEC,
+		   div_u64(stat->max_ns, NSEC_PER_USEC));
+}
+
+static int twl4030_irq_stats_show(struct seq_file *s, void *data)
+{
+	int i, j;
+
+	seq_printf(s, " irq:    count   avg/us   max/us\n");
+
+	for (i = 0; i < ARRAY_SIZE(sih_modules); i++) {
+		struct sih_agent *agent = sih_agents[i];
+
+		if (!agent) {
+			twl4030_irq_stat_show(s, twl4030_irq_base + i,
+					      &pih_stats[i]);
+			continue;
+		}
+
+		for (j = 0; j < agent->sih->bits; j++)
+			twl4030_irq_stat_show(s, agent->irq_base + j,
+					      &agent->stats[j]);
 	}
+
+	return 0;
+}
+
+static int twl4030_irq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, twl4030_irq_stats_show, NULL);
 }
 
+static const struct file_operations twl4030_irq_stats_fops = {
+	.open		= twl4030_irq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void twl4030_irq_init_debugfs(void)
+{
+	debugfs_create_file("twl4030-irq", 0444, NULL, NULL,
+			    &twl4030_irq_stats_fops);
+}
+
+#else
+
+static inline void twl4030_irq_init_debugfs(void)
+{
+}
+
+#endif
+
+/*----------------------------------------------------------------------*/
+
 static unsigned twl4030_irq_next;
 
 /* returns the first IRQ used by this SIH bank,
@@ -624,6 +813,12 @@ int twl4030_sih_setup(int module)
 	if (!agent)
 		return -ENOMEM;
 
+	agent->stats = kcalloc(sih->bits, sizeof *agent->stats, GFP_KERNEL);
+	if (!agent->stats) {
+		kfree(agent);
+		return -ENOMEM;
+	}
+
 	status = 0;
 
 	agent->irq_base = irq_base;
@@ -644,10 +839,13 @@ int twl4030_sih_setup(int module)
 	status = irq_base;
 	twl4030_irq_next += i;
 
-	/* replace generic PIH handler (handle_simple_irq) */
+	/* replace generic PIH handler (handle_simple_irq); the IRQ
+	 * thread demultiplexes this one itself
+	 */
 	irq = sih_mod + twl4030_irq_base;
 	set_irq_data(irq, agent);
-	set_irq_chained_handler(irq, handle_twl4030_sih);
+	set_irq_chained_handler(irq, handle_bad_irq);
+	sih_agents[sih_mod] = agent;
 
 	pr_info("twl4030: %s (irq %d) chaining IRQs %d..%d\n", sih->name,
 			irq, irq_base, twl4030_irq_next - 1);
@@ -722,6 +920,8 @@ int twl_init_irq(int irq_num, unsigned irq_base, unsigned irq_end)
 	set_irq_data(irq_num, task);
 	set_irq_chained_handler(irq_num, handle_twl4030_pih);
 
+	twl4030_irq_init_debugfs();
+
 	return status;
 
 fail:
@@ -24,11 +24,17 @@ static ssize_t name##_show(struct device *dev, struct device_attribute *attr, \
 			   char *buf)	\
 {								\
 	struct ucb1x00 *ucb = classdev_to_ucb1x00(dev);		\
-	int val;						\
-	ucb1x00_adc_enable(ucb);				\
-	val = ucb1x00_adc_read(ucb, input, UCB_NOSYNC);		\
-	ucb1x00_adc_disable(ucb);				\
-	return sprintf(buf, "%d\n", val);			\
+	struct ucb1x00_adc_transfer xfer = {			\
+		.channel = input,				\
+	};							\
+	struct ucb1x00_adc_message msg = {			\
+		.transfers = &xfer,				\
+		.num_transfers = 1,				\
+	};							\
+	int ret = ucb1x00_adc_sync(ucb, &msg);			\
+	if (ret < 0)						\
+		return ret;					\
+	return sprintf(buf, "%d\n", xfer.value);		\
 }								\
 static DEVICE_ATTR(name,0444,name##_show,NULL)
 
@@ -22,6 +22,7 @@
 #include <linux/init.h>
 #include <linux/errno.h>
 #include <linux/interrupt.h>
+#include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/mutex.h>
 
@@ -114,7 +115,144 @@ unsigned int ucb1x00_io_read(struct ucb1x00 *ucb)
  *  3. start conversion	=> 102*tsibclk => 8.5us
  * (tsibclk = 1/11981000)
  * Period between SIB 128-bit frames = 10.7us
+ *
+ * The ADC is either claimed by a process with ucb1x00_adc_enable(),
+ * or converting a queued message, or free.  Queued messages are run
+ * from the ADC interrupt, processes waiting to claim the ADC are let
+ * in between messages.  A transfer whose interrupt goes missing is
+ * picked up by polling every UCB_ADC_POLL, and the message fails with
+ * -ETIMEDOUT if a conversion hasn't finished after UCB_ADC_TIMEOUT.
  */
+#define UCB_ADC_POLL		1
+#define UCB_ADC_TIMEOUT		(HZ / 10)
+
+/* start the current transfer of ucb->adc_msg, adc_lock held */
+static void ucb1x00_adc_start_xfer(struct ucb1x00 *ucb)
+{
+	struct ucb1x00_adc_transfer *xfer;
+	unsigned int cr;
+
+	xfer = &ucb->adc_msg->transfers[ucb->adc_xfer];
+
+	if (xfer->set_ts_cr) {
+		ucb1x00_reg_write(ucb, UCB_TS_CR, xfer->ts_cr);
+		if (xfer->delay_us)
+			udelay(xfer->delay_us);
+	}
+
+	cr = ucb->adc_cr | xfer->channel;
+	if (xfer->sync)
+		cr |= UCB_ADC_SYNC_ENA;
+
+	ucb1x00_reg_write(ucb, UCB_ADC_CR, cr);
+	ucb1x00_reg_write(ucb, UCB_ADC_CR, cr | UCB_ADC_START);
+
+	ucb->adc_started = jiffies;
+	mod_timer(&ucb->adc_timer, jiffies + UCB_ADC_POLL);
+}
+
+/* start the next queued message if the ADC is free, adc_lock held */
+static void ucb1x00_adc_next(struct ucb1x00 *ucb)
+{
+	if (ucb->adc_owned || ucb->adc_msg || list_empty(&ucb->adc_queue))
+		return;
+
+	ucb->adc_msg = list_first_entry(&ucb->adc_queue,
+					struct ucb1x00_adc_message, queue);
+	list_del(&ucb->adc_msg->queue);
+	ucb->adc_xfer = 0;
+
+	ucb->adc_cr |= UCB_ADC_ENA;
+
+	ucb1x00_enable(ucb);
+	ucb1x00_reg_write(ucb, UCB_ADC_CR, ucb->adc_cr);
+	ucb1x00_adc_start_xfer(ucb);
+}
+
+/*
+ * ADC conversion complete, or the poll timer is checking whether it is.
+ * Either collect the result for the current message and carry on with
+ * it, or wake the process converting.
+ */
+static void ucb1x00_adc_check(struct ucb1x00 *ucb)
+{
+	struct ucb1x00_adc_message *msg;
+	unsigned long flags;
+	unsigned int val;
+	int waiters = 0;
+	int status;
+
+	spin_lock_irqsave(&ucb->adc_lock, flags);
+
+	msg = ucb->adc_msg;
+	if (!msg) {
+		complete(&ucb->adc_done);
+		goto out;
+	}
+
+	val = ucb1x00_reg_read(ucb, UCB_ADC_DATA);
+	if (!(val & UCB_ADC_DAT_VAL)) {
+		if (time_after(jiffies, ucb->adc_started + UCB_ADC_TIMEOUT)) {
+			status = -ETIMEDOUT;
+			goto done;
+		}
+		mod_timer(&ucb->adc_timer, jiffies + UCB_ADC_POLL);
+		goto out;
+	}
+
+	msg->transfers[ucb->adc_xfer].value = UCB_ADC_DAT(val);
+	if (++ucb->adc_xfer < msg->num_transfers) {
+		ucb1x00_adc_start_xfer(ucb);
+		goto out;
+	}
+	status = 0;
+
+ done:
+	del_timer(&ucb->adc_timer);
+	ucb->adc_msg = NULL;
+	ucb->adc_cr &= ~UCB_ADC_ENA;
+	ucb1x00_reg_write(ucb, UCB_ADC_CR, ucb->adc_cr);
+	ucb1x00_disable(ucb);
+
+	waiters = waitqueue_active(&ucb->adc_wait);
+	if (!waiters)
+		ucb1x00_adc_next(ucb);
+	spin_unlock_irqrestore(&ucb->adc_lock, flags);
+
+	if (waiters)
+		wake_up(&ucb->adc_wait);
+
+	msg->status = status;
+	msg->complete(msg->context);
+	return;
+
+ out:
+	spin_unlock_irqrestore(&ucb->adc_lock, flags);
+}
+
+static void ucb1x00_adc_irq(int idx, void *id)
+{
+	ucb1x00_adc_check(id);
+}
+
+static void ucb1x00_adc_timer(unsigned long data)
+{
+	ucb1x00_adc_check((struct ucb1x00 *)data);
+}
+
+static int ucb1x00_adc_claim(struct ucb1x00 *ucb)
+{
+	unsigned long flags;
+	int claimed;
+
+	spin_lock_irqsave(&ucb->adc_lock, flags);
+	claimed = !ucb->adc_owned && !ucb->adc_msg;
+	if (claimed)
+		ucb->adc_owned = 1;
+	spin_unlock_irqrestore(&ucb->adc_lock, flags);
+
+	return claimed;
+}
 
 /**
  *	ucb1x00_adc_enable - enable the ADC converter
@@ -124,17 +262,17 @@ unsigned int ucb1x00_io_read(struct ucb1x00 *ucb)
  *	Any code wishing to use the ADC converter must call this
  *	function prior to using it.
  *
- *	This function takes the ADC semaphore to prevent two or more
- *	concurrent uses, and therefore may sleep.  As a result, it
- *	can only be called from process context, not interrupt
- *	context.
+ *	This function claims the ADC to prevent two or more concurrent
+ *	uses, waiting for any queued message being converted, and
+ *	therefore may sleep.  As a result, it can only be called from
+ *	process context, not interrupt context.
  *
  *	You should release the ADC as soon as possible using
  *	ucb1x00_adc_disable.
  */
 void ucb1x00_adc_enable(struct ucb1x00 *ucb)
 {
-	down(&ucb->adc_sem);
+	wait_event(ucb->adc_wait, ucb1x00_adc_claim(ucb));
 
 	ucb->adc_cr |= UCB_ADC_ENA;
 
@@ -152,11 +290,10 @@ void ucb1x00_adc_enable(struct ucb1x00 *ucb)
  *	synchronised ADC conversions (via the ADCSYNC pin) must wait
  *	until the trigger is asserted and the conversion is finished.
  *
- *	This function currently spins waiting for the conversion to
- *	complete (2 frames max without sync).
- *
- *	If called for a synchronised ADC conversion, it may sleep
- *	with the ADC semaphore held.
+ *	This function sleeps until the ADC interrupt signals that the
+ *	conversion is complete (2 frames max without sync), rechecking
+ *	every jiffy in case the interrupt is missed.  The ADC must have
+ *	been claimed with ucb1x00_adc_enable.
  */
 unsigned int ucb1x00_adc_read(struct ucb1x00 *ucb, int adc_channel, int sync)
 {
@@ -165,6 +302,8 @@ unsigned int ucb1x00_adc_read(struct ucb1x00 *ucb, int adc_channel, int sync)
 	if (sync)
 		adc_channel |= UCB_ADC_SYNC_ENA;
 
+	INIT_COMPLETION(ucb->adc_done);
+
 	ucb1x00_reg_write(ucb, UCB_ADC_CR, ucb->adc_cr | adc_channel);
 	ucb1x00_reg_write(ucb, UCB_ADC_CR, ucb->adc_cr | adc_channel | UCB_ADC_START);
 
@@ -172,9 +311,7 @@ unsigned int ucb1x00_adc_read(struct ucb1x00 *ucb, int adc_channel, int sync)
 		val = ucb1x00_reg_read(ucb, UCB_ADC_DATA);
 		if (val & UCB_ADC_DAT_VAL)
 			break;
-		/* yield to other processes */
-		set_current_state(TASK_INTERRUPTIBLE);
-		schedule_timeout(1);
+		wait_for_completion_timeout(&ucb->adc_done, 1);
 	}
 
 	return UCB_ADC_DAT(val);
@@ -184,15 +321,87 @@ unsigned int ucb1x00_adc_read(struct ucb1x00 *ucb, int adc_channel, int sync)
  *	ucb1x00_adc_disable - disable the ADC converter
  *	@ucb: UCB1x00 structure describing chip
  *
- *	Disable the ADC converter and release the ADC semaphore.
+ *	Disable the ADC converter and release the ADC, starting any
+ *	messages queued meanwhile.
  */
 void ucb1x00_adc_disable(struct ucb1x00 *ucb)
 {
+	unsigned long flags;
+
 	ucb->adc_cr &= ~UCB_ADC_ENA;
 	ucb1x00_reg_write(ucb, UCB_ADC_CR, ucb->adc_cr);
 	ucb1x00_disable(ucb);
 
-	up(&ucb->adc_sem);
+	spin_lock_irqsave(&ucb->adc_lock, flags);
+	ucb->adc_owned = 0;
+	ucb1x00_adc_next(ucb);
+	spin_unlock_irqrestore(&ucb->adc_lock, flags);
+
+	wake_up(&ucb->adc_wait);
+}
+
+/**
+ *	ucb1x00_adc_async - queue a sequence of ADC conversions
+ *	@ucb: UCB1x00 structure describing chip
+ *	@msg: conversions to perform
+ *
+ *	Queue the transfers of @msg to be converted in order as soon
+ *	as the ADC is free, without waiting.  The results are stored
+ *	in the transfers and @msg->complete called, from interrupt
+ *	context, when the last has finished or a conversion has
+ *	timed out, with @msg->status set to 0 or -ETIMEDOUT.  @msg
+ *	must not be touched until then.
+ *
+ *	This function may be called from interrupt context.
+ */
+int ucb1x00_adc_async(struct ucb1x00 *ucb, struct ucb1x00_adc_message *msg)
+{
+	unsigned long flags;
+
+	if (!msg->num_transfers || !msg->complete)
+		return -EINVAL;
+
+	msg->status = -EINPROGRESS;
+
+	spin_lock_irqsave(&ucb->adc_lock, flags);
+	list_add_tail(&msg->queue, &ucb->adc_queue);
+	ucb1x00_adc_next(ucb);
+	spin_unlock_irqrestore(&ucb->adc_lock, flags);
+
+	return 0;
+}
+
+static void ucb1x00_adc_sync_complete(void *context)
+{
+	complete(context);
+}
+
+/**
+ *	ucb1x00_adc_sync - perform a sequence of ADC conversions
+ *	@ucb: UCB1x00 structure describing chip
+ *	@msg: conversions to perform
+ *
+ *	Queue @msg as for ucb1x00_adc_async and sleep until the
+ *	results are available.  The complete and context fields of
+ *	@msg are overwritten.
+ *
+ *	Returns zero on success or a negative error code.
+ */
+int ucb1x00_adc_sync(struct ucb1x00 *ucb, struct ucb1x00_adc_message *msg)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	int ret;
+
+	msg->complete = ucb1x00_adc_sync_complete;
+	msg->context = &done;
+
+	ret = ucb1x00_adc_async(ucb, msg);
+	if (ret == 0) {
+		wait_for_completion(&done);
+		ret = msg->status;
+	}
+
+	return ret;
 }
 
 /*
@@ -496,7 +705,11 @@ static int ucb1x00_probe(struct mcp *mcp)
 
 	spin_lock_init(&ucb->lock);
 	spin_lock_init(&ucb->io_lock);
-	sema_init(&ucb->adc_sem, 1);
+	spin_lock_init(&ucb->adc_lock);
+	init_waitqueue_head(&ucb->adc_wait);
+	init_completion(&ucb->adc_done);
+	INIT_LIST_HEAD(&ucb->adc_queue);
+	setup_timer(&ucb->adc_timer, ucb1x00_adc_timer, (unsigned long)ucb);
 
 	ucb->id  = id;
 	ucb->mcp = mcp;
@@ -517,6 +730,9 @@ static int ucb1x00_probe(struct mcp *mcp)
 
 	mcp_set_drvdata(mcp, ucb);
 
+	ucb1x00_hook_irq(ucb, UCB_IRQ_ADC, ucb1x00_adc_irq, ucb);
+	ucb1x00_enable_irq(ucb, UCB_IRQ_ADC, UCB_RISING);
+
 	ret = device_register(&ucb->dev);
 	if (ret)
 		goto err_irq;
@@ -531,6 +747,7 @@ static int ucb1x00_probe(struct mcp *mcp)
 	goto out;
 
  err_irq:
+	ucb1x00_free_irq(ucb, UCB_IRQ_ADC, ucb);
 	free_irq(ucb->irq, ucb);
  err_free:
 	kfree(ucb);
@@ -553,7 +770,9 @@ static void ucb1x00_remove(struct mcp *mcp)
 	}
 	mutex_unlock(&ucb1x00_mutex);
 
+	ucb1x00_free_irq(ucb, UCB_IRQ_ADC, ucb);
 	free_irq(ucb->irq, ucb);
+	del_timer_sync(&ucb->adc_timer);
 	device_unregister(&ucb->dev);
 }
 
@@ -649,6 +868,8 @@ EXPORT_SYMBOL(ucb1x00_io_read);
 EXPORT_SYMBOL(ucb1x00_adc_enable);
 EXPORT_SYMBOL(ucb1x00_adc_read);
 EXPORT_SYMBOL(ucb1x00_adc_disable);
+EXPORT_SYMBOL(ucb1x00_adc_async);
+EXPORT_SYMBOL(ucb1x00_adc_sync);
 
 EXPORT_SYMBOL(ucb1x00_hook_irq);
 EXPORT_SYMBOL(ucb1x00_free_irq);
@@ -34,6 +34,7 @@
 #define UCB_IE_TCLIP		(1 << 14)
 #define UCB_IE_ACLIP		(1 << 15)
 
+#define UCB_IRQ_ADC		11
 #define UCB_IRQ_TSPX		12
 
 #define UCB_TC_A	0x05
@@ -100,6 +101,11 @@
 #define UCB_MODE_DYN_VFLAG_ENA	(1 << 12)
 #define UCB_MODE_AUD_OFF_CAN	(1 << 13)
 
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/timer.h>
+
 #include "mcp.h"
 
 struct ucb1x00_irq {
@@ -107,11 +113,47 @@ struct ucb1x00_irq {
 	void (*fn)(int, void *);
 };
 
+/*
+ * One conversion of a queued ADC message.  If set_ts_cr is set the
+ * touchscreen control register is written with ts_cr and delay_us
+ * allowed for the inputs to settle before the conversion starts.
+ */
+struct ucb1x00_adc_transfer {
+	unsigned int		channel;	/* UCB_ADC_INP_* */
+	unsigned int		sync:1;		/* wait for ADCSYNC */
+	unsigned int		set_ts_cr:1;
+	u16			ts_cr;
+	unsigned int		delay_us;
+	unsigned int		value;		/* result */
+};
+
+/*
+ * A sequence of conversions performed back to back, each started from
+ * the ADC interrupt of the one before.  complete() is called with
+ * context once they are all finished, from interrupt context.
+ */
+struct ucb1x00_adc_message {
+	struct list_head	queue;
+	struct ucb1x00_adc_transfer *transfers;
+	unsigned int		num_transfers;
+	void			(*complete)(void *context);
+	void			*context;
+	int			status;
+};
+
 struct ucb1x00 {
 	spinlock_t		lock;
 	struct mcp		*mcp;
 	unsigned int		irq;
-	struct semaphore	adc_sem;
+	spinlock_t		adc_lock;
+	int			adc_owned;
+	wait_queue_head_t	adc_wait;
+	struct completion	adc_done;
+	struct list_head	adc_queue;
+	struct ucb1x00_adc_message *adc_msg;
+	unsigned int		adc_xfer;
+	struct timer_list	adc_timer;	/* polls the current transfer */
+	unsigned long		adc_started;	/* jiffies it was started */
 	spinlock_t		io_lock;
 	u16			id;
 	u16			io_dir;
@@ -241,6 +283,9 @@ unsigned int ucb1x00_adc_read(struct ucb1x00 *ucb, int adc_channel, int sync);
 void ucb1x00_adc_enable(struct ucb1x00 *ucb);
 void ucb1x00_adc_disable(struct ucb1x00 *ucb);
 
+int ucb1x00_adc_async(struct ucb1x00 *ucb, struct ucb1x00_adc_message *msg);
+int ucb1x00_adc_sync(struct ucb1x00 *ucb, struct ucb1x00_adc_message *msg);
+
 /*
  * Which edges of the IRQ do you want to control today?
  */
@@ -20,7 +20,11 @@
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <linux/hrtimer.h>
 
+#include <linux/mfd/regcache.h>
 #include <linux/mfd/wm8350/core.h>
 #include <linux/mfd/wm8350/audio.h>
 #include <linux/mfd/wm8350/comparator.h>
@@ -29,6 +33,7 @@
 #include <linux/mfd/wm8350/rtc.h>
 #include <linux/mfd/wm8350/supply.h>
 #include <linux/mfd/wm8350/wdt.h>
+#include <trace/mfd.h>
 
 #define WM8350_UNLOCK_KEY		0x0013
 #define WM8350_LOCK_KEY			0x0000
@@ -38,18 +43,6 @@
 
 /* debug */
 #define WM8350_BUS_DEBUG 0
-#if WM8350_BUS_DEBUG
-#define dump(regs, src) do { \
-	int i_; \
-	u16 *src_ = src; \
-	printk(KERN_DEBUG); \
-	for (i_ = 0; i_ < regs; i_++) \
-		printk(" 0x%4.4x", *src_++); \
-	printk("\n"); \
-} while (0);
-#else
-#define dump(bytes, src)
-#endif
 
 #define WM8350_LOCK_DEBUG 0
 #if WM8350_LOCK_DEBUG
@@ -61,9 +54,44 @@
 /*
  * WM8350 Device IO
  */
-static DEFINE_MUTEX(io_mutex);
-static DEFINE_MUTEX(reg_lock_mutex);
-static DEFINE_MUTEX(auxadc_mutex);
+
+static inline ktime_t wm8350_trace_start(void)
+{
+	return mfd_reg_trace_enabled() ? ktime_get() : ktime_set(0, 0);
+}
+
+/* registers without volatile bits are always served from the cache */
+static void wm8350_trace_read(struct wm8350 *wm8350, u8 reg, int num_regs,
+			      const u16 *dest, ktime_t start)
+{
+	s64 ns;
+	int i;
+
+	if (!mfd_reg_trace_enabled() || !ktime_to_ns(start))
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	for (i = 0; i < num_regs; i++)
+		trace_mfd_reg_read(wm8350->dev, reg + i, dest[i],
+				   wm8350->cache_only ||
+				   !wm8350_reg_io_map[reg + i].vol, ns);
+}
+
+/* src is in device (big endian) byte order */
+static void wm8350_trace_write(struct wm8350 *wm8350, u8 reg, int num_regs,
+			       const u16 *src, int cached, ktime_t start)
+{
+	s64 ns;
+	int i;
+
+	if (!mfd_reg_trace_enabled() || !ktime_to_ns(start))
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	for (i = 0; i < num_regs; i++)
+		trace_mfd_reg_write(wm8350->dev, reg + i,
+				    be16_to_cpu(src[i]), cached, ns);
+}
 
 /* Perform a physical read from the device.
  */
@@ -88,17 +116,19 @@ static int wm8350_phys_read(struct wm8350 *wm8350, u8 reg, int num_regs,
 		dest[i - reg] &= wm8350_reg_io_map[i].readable;
 	}
 
-	dump(num_regs, dest);
-
 	return ret;
 }
 
+/* cached registers worth reading through to join two volatile runs */
+#define WM8350_READ_GAP 2
+
 static int wm8350_read(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *dest)
 {
 	int i;
 	int end = reg + num_regs;
 	int ret = 0;
 	int bytes = num_regs * 2;
+	ktime_t start;
 
 	if (wm8350->read_dev == NULL)
 		return -ENODEV;
@@ -121,16 +151,56 @@ static int wm8350_read(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *dest)
 	}
 #endif
 
-	/* if any volatile registers are required, then read back all */
-	for (i = reg; i < end; i++)
-		if (wm8350_reg_io_map[i].vol)
-			return wm8350_phys_read(wm8350, reg, num_regs, dest);
-
-	/* no volatiles, then cache is good */
+	/* Serve everything from the cache, then go to the device for runs
+	 * of volatile registers.  Runs separated by only a few cached
+	 * registers are read as one transfer since a new transfer costs
+	 * more than the extra words.
+	 */
 	dev_dbg(wm8350->dev, "cache read\n");
+	start = wm8350_trace_start();
 	memcpy(dest, &wm8350->reg_cache[reg], bytes);
-	dump(num_regs, dest);
-	return ret;
+
+	/* with the bus off limits volatile bits read back as zero */
+	if (wm8350->cache_only)
+		goto out;
+
+	i = reg;
+	while (i < end) {
+		int run_start, run_last;
+
+		if (!wm8350_reg_io_map[i].vol) {
+			i++;
+			continue;
+		}
+
+		run_start = i;
+		run_last = i;
+		for (i++; i < end && i - run_last <= WM8350_READ_GAP + 1; i++)
+			if (wm8350_reg_io_map[i].vol)
+				run_last = i;
+
+		ret = wm8350_phys_read(wm8350, run_start,
+				       run_last - run_start + 1,
+				       &dest[run_start - reg]);
+		if (ret < 0)
+			return ret;
+
+		i = run_last + 1;
+	}
+
+out:
+	wm8350_trace_read(wm8350, reg, num_regs, dest, start);
+	return 0;
+}
+
+/* registers which can only be written with the security key set */
+static inline int is_reg_lockable(int reg)
+{
+	return reg == WM8350_GPIO_CONFIGURATION_I_O ||
+		(reg >= WM8350_GPIO_FUNCTION_SELECT_1 &&
+		 reg <= WM8350_GPIO_FUNCTION_SELECT_4) ||
+		(reg >= WM8350_BATTERY_CHARGER_CONTROL_1 &&
+		 reg <= WM8350_BATTERY_CHARGER_CONTROL_3);
 }
 
 static inline int is_reg_locked(struct wm8350 *wm8350, u8 reg)
@@ -139,20 +209,48 @@ static inline int is_reg_locked(struct wm8350 *wm8350, u8 reg)
 	    wm8350->reg_cache[WM8350_SECURITY] == WM8350_UNLOCK_KEY)
 		return 0;
 
-	if ((reg == WM8350_GPIO_CONFIGURATION_I_O) ||
-	    (reg >= WM8350_GPIO_FUNCTION_SELECT_1 &&
-	     reg <= WM8350_GPIO_FUNCTION_SELECT_4) ||
-	    (reg >= WM8350_BATTERY_CHARGER_CONTROL_1 &&
-	     reg <= WM8350_BATTERY_CHARGER_CONTROL_3))
-		return 1;
-	return 0;
+	return is_reg_lockable(reg);
 }
 
-static int wm8350_write(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *src)
+/* registers written back per transfer by wm8350_sync() */
+#define WM8350_SYNC_REGS 16
+
+static inline int wm8350_is_audio_reg(int reg)
+{
+	return reg >= WM8350_CLOCK_CONTROL_1 && reg <= WM8350_AIF_TEST;
+}
+
+/* whether a write to reg should only update the cache */
+static inline int wm8350_write_cached(struct wm8350 *wm8350, int reg)
+{
+	return wm8350->cache_only ||
+		(wm8350->audio_cache_only && wm8350_is_audio_reg(reg));
+}
+
+/* The audio block is powered down, or held in reset if reset is set,
+ * so writes to it go to the cache until wm8350_audio_cache_sync().
+ * Caller holds io_mutex.
+ */
+static void wm8350_audio_off(struct wm8350 *wm8350, int reset)
 {
 	int i;
+
+	/* anything still waiting for the rest of the device to sync */
+	for (i = 0; i < WM8350_AUDIO_NUM_REGS; i++)
+		if (test_and_clear_bit(i + WM8350_CLOCK_CONTROL_1,
+				       wm8350->reg_dirty))
+			set_bit(i, wm8350->audio_dirty);
+
+	wm8350->audio_cache_only = 1;
+	if (reset)
+		wm8350->audio_reset = 1;
+}
+
+static int wm8350_write(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *src)
+{
+	int i, j, cached, ret = 0;
 	int end = reg + num_regs;
-	int bytes = num_regs * 2;
+	ktime_t start = wm8350_trace_start();
 
 	if (wm8350->write_dev == NULL)
 		return -ENODEV;
@@ -179,6 +277,12 @@ static int wm8350_write(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *src)
 
 		src[i - reg] &= wm8350_reg_io_map[i].writable;
 
+		/* clearing CODEC_ENA resets the audio block to its defaults */
+		if (i == WM8350_POWER_MGMT_5 &&
+		    (wm8350->reg_cache[i] & WM8350_CODEC_ENA) &&
+		    !(src[i - reg] & WM8350_CODEC_ENA))
+			wm8350_audio_off(wm8350, 1);
+
 		wm8350->reg_cache[i] =
 			(wm8350->reg_cache[i] & ~wm8350_reg_io_map[i].writable)
 			| src[i - reg];
@@ -187,21 +291,145 @@ static int wm8350_write(struct wm8350 *wm8350, u8 reg, int num_regs, u16 *src)
 		wm8350->reg_cache[i] &= ~wm8350_reg_io_map[i].vol;
 
 		src[i - reg] = cpu_to_be16(src[i - reg]);
+
+		/* the audio block keeps its own record while powered down
+		 * so that a sync of the rest of the device leaves it alone
+		 */
+		if (wm8350->audio_cache_only && wm8350_is_audio_reg(i))
+			set_bit(i - WM8350_CLOCK_CONTROL_1,
+				wm8350->audio_dirty);
+		else if (wm8350->cache_only)
+			set_bit(i, wm8350->reg_dirty);
+		else
+			clear_bit(i, wm8350->reg_dirty);
+	}
+
+	/* Actually write out each run of registers not held in the cache
+	 * alone; there are at most two, either side of the audio block.
+	 */
+	for (i = reg; i < end && ret >= 0; i = j) {
+		cached = wm8350_write_cached(wm8350, i);
+		for (j = i + 1; j < end; j++)
+			if (wm8350_write_cached(wm8350, j) != cached)
+				break;
+
+		if (!cached)
+			ret = wm8350->write_dev(wm8350, i, (j - i) * 2,
+						(char *)&src[i - reg]);
+
+		if (ret >= 0)
+			wm8350_trace_write(wm8350, i, j - i, &src[i - reg],
+					   cached, start);
+	}
+
+	return ret;
+}
+
+static int wm8350_sync_block(void *data, unsigned int start,
+			     unsigned int count)
+{
+	struct wm8350 *wm8350 = data;
+	u16 buf[WM8350_SYNC_REGS];
+	ktime_t t = wm8350_trace_start();
+	int i, reg, ret;
+
+	for (i = 0; i < count; i++) {
+		reg = start + i;
+		buf[i] = cpu_to_be16(wm8350->reg_cache[reg] &
+				     wm8350_reg_io_map[reg].writable);
 	}
 
-	/* Actually write it out */
-	return wm8350->write_dev(wm8350, reg, bytes, (char *)src);
+	ret = wm8350->write_dev(wm8350, start, count * 2, (char *)buf);
+	if (ret >= 0)
+		wm8350_trace_write(wm8350, start, count, buf, 0, t);
+
+	return ret;
+}
+
+/* Write back dirty registers, each run of adjacent registers in as few
+ * transfers as possible.  Registers which fail to write stay dirty.
+ */
+static int wm8350_sync(struct wm8350 *wm8350)
+{
+	u16 key = cpu_to_be16(WM8350_UNLOCK_KEY);
+	int i, ret;
+
+	/* Locked registers need the device unlocked; marking the security
+	 * register dirty puts its cached value back afterwards since it
+	 * sits above every lockable register.
+	 */
+	for_each_bit(i, wm8350->reg_dirty, WM8350_MAX_REGISTER + 1) {
+		if (!is_reg_lockable(i))
+			continue;
+
+		ret = wm8350->write_dev(wm8350, WM8350_SECURITY, 2,
+					(char *)&key);
+		if (ret < 0)
+			return ret;
+		set_bit(WM8350_SECURITY, wm8350->reg_dirty);
+		break;
+	}
+
+	return mfd_regcache_sync(wm8350->reg_dirty, WM8350_MAX_REGISTER + 1,
+				 WM8350_SYNC_REGS, wm8350_sync_block, wm8350);
+}
+
+/* audio_dirty is indexed from the start of the audio block */
+static int wm8350_audio_sync_block(void *data, unsigned int start,
+				   unsigned int count)
+{
+	return wm8350_sync_block(data, start + WM8350_CLOCK_CONTROL_1, count);
 }
 
 /*
  * Safe read, modify, write methods
  */
+
+/**
+ * wm8350_reg_update_bits - update register bits in a single operation
+ * @wm8350: device
+ * @reg: register to update
+ * @mask: bits to change
+ * @val: new value for the bits in mask
+ *
+ * The read, modify and write are done under a single acquisition of
+ * the IO lock so no other access to the device can come in between.
+ * Non-volatile registers are read from the cache and the write is
+ * skipped if it would not change them; volatile registers are always
+ * written since the write itself may have side effects.
+ */
+int wm8350_reg_update_bits(struct wm8350 *wm8350, u16 reg, u16 mask, u16 val)
+{
+	u16 data, old;
+	int err;
+
+	mutex_lock(&wm8350->io_mutex);
+	err = wm8350_read(wm8350, reg, 1, &data);
+	if (err) {
+		dev_err(wm8350->dev, "read from reg R%d failed\n", reg);
+		goto out;
+	}
+
+	old = data;
+	data = (data & ~mask) | (val & mask);
+	if (data == old && !wm8350_reg_io_map[reg].vol)
+		goto out;
+
+	err = wm8350_write(wm8350, reg, 1, &data);
+	if (err)
+		dev_err(wm8350->dev, "write to reg R%d failed\n", reg);
+out:
+	mutex_unlock(&wm8350->io_mutex);
+	return err;
+}
+EXPORT_SYMBOL_GPL(wm8350_reg_update_bits);
+
 int wm8350_clear_bits(struct wm8350 *wm8350, u16 reg, u16 mask)
 {
 	u16 data;
 	int err;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	err = wm8350_read(wm8350, reg, 1, &data);
 	if (err) {
 		dev_err(wm8350->dev, "read from reg R%d failed\n", reg);
@@ -213,7 +441,7 @@ int wm8350_clear_bits(struct wm8350 *wm8350, u16 reg, u16 mask)
 	if (err)
 		dev_err(wm8350->dev, "write to reg R%d failed\n", reg);
 out:
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return err;
 }
 EXPORT_SYMBOL_GPL(wm8350_clear_bits);
@@ -223,7 +451,7 @@ int wm8350_set_bits(struct wm8350 *wm8350, u16 reg, u16 mask)
 	u16 data;
 	int err;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	err = wm8350_read(wm8350, reg, 1, &data);
 	if (err) {
 		dev_err(wm8350->dev, "read from reg R%d failed\n", reg);
@@ -235,22 +463,34 @@ int wm8350_set_bits(struct wm8350 *wm8350, u16 reg, u16 mask)
 	if (err)
 		dev_err(wm8350->dev, "write to reg R%d failed\n", reg);
 out:
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return err;
 }
 EXPORT_SYMBOL_GPL(wm8350_set_bits);
 
+/**
+ * wm8350_reg_volatile - check if a register has bits the cache can't hold
+ * @reg: register
+ *
+ * Non volatile registers can be read straight from wm8350->reg_cache.
+ */
+int wm8350_reg_volatile(int reg)
+{
+	return wm8350_reg_io_map[reg].vol != 0;
+}
+EXPORT_SYMBOL_GPL(wm8350_reg_volatile);
+
 u16 wm8350_reg_read(struct wm8350 *wm8350, int reg)
 {
 	u16 data;
 	int err;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	err = wm8350_read(wm8350, reg, 1, &data);
 	if (err)
 		dev_err(wm8350->dev, "read from reg R%d failed\n", reg);
 
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return data;
 }
 EXPORT_SYMBOL_GPL(wm8350_reg_read);
@@ -260,26 +500,65 @@ int wm8350_reg_write(struct wm8350 *wm8350, int reg, u16 val)
 	int ret;
 	u16 data = val;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	ret = wm8350_write(wm8350, reg, 1, &data);
 	if (ret)
 		dev_err(wm8350->dev, "write to reg R%d failed\n", reg);
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(wm8350_reg_write);
 
+/**
+ * wm8350_reg_rewrite - write a register back to the device unchanged
+ * @wm8350: device
+ * @reg: register
+ * @buf: buffer for the transfers, which must stay valid and be used for
+ *       nothing else during the call
+ *
+ * For registers where the write itself does something, such as kicking
+ * the watchdog.  The raw value read from the device is written straight
+ * back, so volatile bits the device may change are preserved and the
+ * cache stays valid without any bookkeeping.  The IO lock isn't taken,
+ * so the latency is that of two transfers on the bus however much other
+ * traffic there is for the device; the caller must make sure nothing
+ * else writes the register at the same time.
+ *
+ * Fails with -EBUSY in cache only mode, when the bus is off limits.
+ */
+int wm8350_reg_rewrite(struct wm8350 *wm8350, int reg, u16 *buf)
+{
+	int ret;
+
+	if (wm8350->cache_only)
+		return -EBUSY;
+
+	if (reg > WM8350_MAX_REGISTER || !wm8350_reg_io_map[reg].writable)
+		return -EINVAL;
+
+	ret = wm8350->read_dev(wm8350, reg, 2, buf);
+	if (ret < 0)
+		return ret;
+
+	ret = wm8350->write_dev(wm8350, reg, 2, buf);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(wm8350_reg_rewrite);
+
 int wm8350_block_read(struct wm8350 *wm8350, int start_reg, int regs,
 		      u16 *dest)
 {
 	int err = 0;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	err = wm8350_read(wm8350, start_reg, regs, dest);
 	if (err)
 		dev_err(wm8350->dev, "block read starting from R%d failed\n",
 			start_reg);
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return err;
 }
 EXPORT_SYMBOL_GPL(wm8350_block_read);
@@ -289,27 +568,145 @@ int wm8350_block_write(struct wm8350 *wm8350, int start_reg, int regs,
 {
 	int ret = 0;
 
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	ret = wm8350_write(wm8350, start_reg, regs, src);
 	if (ret)
 		dev_err(wm8350->dev, "block write starting at R%d failed\n",
 			start_reg);
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(wm8350_block_write);
 
+/**
+ * wm8350_cache_only - stop or restart register writes to the device
+ * @wm8350: device
+ * @enable: non-zero to only update the register cache
+ *
+ * While the device is hibernated or otherwise unreachable register
+ * writes can be made in the cache alone; volatile bits read back as
+ * zero.  Call wm8350_cache_sync() once the device is available again
+ * to write back everything that changed.
+ */
+void wm8350_cache_only(struct wm8350 *wm8350, int enable)
+{
+	mutex_lock(&wm8350->io_mutex);
+	wm8350->cache_only = enable;
+	mutex_unlock(&wm8350->io_mutex);
+}
+EXPORT_SYMBOL_GPL(wm8350_cache_only);
+
+/**
+ * wm8350_cache_sync - write back registers changed in cache only mode
+ * @wm8350: device
+ *
+ * Leaves cache only mode and writes every register changed since it
+ * was entered, adjacent registers together in block writes.  On
+ * failure the registers not yet written stay in the cache for a later
+ * sync.
+ */
+int wm8350_cache_sync(struct wm8350 *wm8350)
+{
+	int ret;
+
+	mutex_lock(&wm8350->io_mutex);
+	wm8350->cache_only = 0;
+	ret = wm8350_sync(wm8350);
+	if (ret)
+		dev_err(wm8350->dev, "cache sync failed: %d\n", ret);
+	mutex_unlock(&wm8350->io_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(wm8350_cache_sync);
+
+/**
+ * wm8350_audio_cache_only - hold writes to the powered down audio block
+ * @wm8350: device
+ * @reset: non-zero if the audio registers return to their defaults
+ *         while the block is off
+ *
+ * For the CODEC driver when it powers the audio block down.  Writes to
+ * the audio registers (WM8350_CLOCK_CONTROL_1 to WM8350_AIF_TEST) then
+ * only update the cache and are recorded apart from the rest of the
+ * device, which wm8350_cache_sync() and the device suspend and
+ * hibernate paths otherwise keep writing as usual.  Call
+ * wm8350_audio_cache_sync() once the audio block has power again.
+ *
+ * Clearing CODEC_ENA, which resets the audio block, does the same with
+ * @reset set.
+ */
+void wm8350_audio_cache_only(struct wm8350 *wm8350, int reset)
+{
+	mutex_lock(&wm8350->io_mutex);
+	wm8350_audio_off(wm8350, reset);
+	mutex_unlock(&wm8350->io_mutex);
+}
+EXPORT_SYMBOL_GPL(wm8350_audio_cache_only);
+
+/**
+ * wm8350_audio_cache_sync - bring the audio block back up to date
+ * @wm8350: device
+ *
+ * Leaves audio cache only mode and writes the audio registers changed
+ * while the block was powered down, plus those which differ from their
+ * defaults if the block was reset, in block writes.  Nothing else is
+ * rewritten or read back from the device.  If the whole device is in
+ * cache only mode the registers are left for wm8350_cache_sync().
+ *
+ * Does nothing while CODEC_ENA is clear and the block is in reset.
+ */
+int wm8350_audio_cache_sync(struct wm8350 *wm8350)
+{
+	int i, reg, ret = 0;
+
+	mutex_lock(&wm8350->io_mutex);
+
+	if (!(wm8350->reg_cache[WM8350_POWER_MGMT_5] & WM8350_CODEC_ENA))
+		goto out;
+
+	if (wm8350->audio_reset) {
+		for (i = 0; i < WM8350_AUDIO_NUM_REGS; i++) {
+			reg = i + WM8350_CLOCK_CONTROL_1;
+			if ((wm8350->reg_cache[reg] ^
+			     wm8350->reg_defaults[reg]) &
+			    wm8350_reg_io_map[reg].writable &
+			    ~wm8350_reg_io_map[reg].vol)
+				set_bit(i, wm8350->audio_dirty);
+		}
+		wm8350->audio_reset = 0;
+	}
+
+	wm8350->audio_cache_only = 0;
+
+	if (wm8350->cache_only) {
+		for_each_bit(i, wm8350->audio_dirty, WM8350_AUDIO_NUM_REGS)
+			set_bit(i + WM8350_CLOCK_CONTROL_1, wm8350->reg_dirty);
+		bitmap_zero(wm8350->audio_dirty, WM8350_AUDIO_NUM_REGS);
+		goto out;
+	}
+
+	ret = mfd_regcache_sync(wm8350->audio_dirty, WM8350_AUDIO_NUM_REGS,
+				WM8350_SYNC_REGS, wm8350_audio_sync_block,
+				wm8350);
+	if (ret)
+		dev_err(wm8350->dev, "audio cache sync failed: %d\n", ret);
+out:
+	mutex_unlock(&wm8350->io_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(wm8350_audio_cache_sync);
+
 int wm8350_reg_lock(struct wm8350 *wm8350)
 {
 	u16 key = WM8350_LOCK_KEY;
 	int ret;
 
 	ldbg(__func__);
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	ret = wm8350_write(wm8350, WM8350_SECURITY, 1, &key);
 	if (ret)
 		dev_err(wm8350->dev, "lock failed\n");
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(wm8350_reg_lock);
@@ -320,11 +717,11 @@ int wm8350_reg_unlock(struct wm8350 *wm8350)
 	int ret;
 
 	ldbg(__func__);
-	mutex_lock(&io_mutex);
+	mutex_lock(&wm8350->io_mutex);
 	ret = wm8350_write(wm8350, WM8350_SECURITY, 1, &key);
 	if (ret)
 		dev_err(wm8350->dev, "unlock failed\n");
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&wm8350->io_mutex);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(wm8350_reg_unlock);
@@ -344,6 +741,326 @@ static void wm8350_irq_call_handler(struct wm8350 *wm8350, int irq)
 	mutex_unlock(&wm8350->irq_mutex);
 }
 
+/* the status registers and their masks are two parallel blocks */
+#define WM8350_NUM_IRQ_REGS \
+	(WM8350_COMPARATOR_INT_STATUS - WM8350_SYSTEM_INTERRUPTS + 1)
+#define WM8350_IRQ_REG(reg) ((reg) - WM8350_SYSTEM_INTERRUPTS)
+#define WM8350_IRQ_MASK_REG(reg) \
+	(WM8350_SYSTEM_INTERRUPTS_MASK + WM8350_IRQ_REG(reg))
+
+/*
+ * Each IRQ is a bit in one of the second level status registers.  Some
+ * of these are only valid when their summary bit in the System
+ * Interrupts register is also set.  Every status register is followed
+ * WM8350_NUM_IRQ_REGS registers later by its mask.
+ */
+struct wm8350_irq_data {
+	u16 primary;		/* System Interrupts bit gating the IRQ, or 0 */
+	u16 reg;		/* status register */
+	u16 mask;		/* bit in the status and mask registers */
+};
+
+static const struct wm8350_irq_data wm8350_irqs[WM8350_NUM_IRQ] = {
+	[WM8350_IRQ_CHG_BAT_HOT] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_BAT_HOT_EINT,
+	},
+	[WM8350_IRQ_CHG_BAT_COLD] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_BAT_COLD_EINT,
+	},
+	[WM8350_IRQ_CHG_BAT_FAIL] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_BAT_FAIL_EINT,
+	},
+	[WM8350_IRQ_CHG_TO] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_TO_EINT,
+	},
+	[WM8350_IRQ_CHG_END] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_END_EINT,
+	},
+	[WM8350_IRQ_CHG_START] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_START_EINT,
+	},
+	[WM8350_IRQ_CHG_FAST_RDY] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_FAST_RDY_EINT,
+	},
+	[WM8350_IRQ_RTC_PER] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_RTC_PER_EINT,
+	},
+	[WM8350_IRQ_RTC_SEC] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_RTC_SEC_EINT,
+	},
+	[WM8350_IRQ_RTC_ALM] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_RTC_ALM_EINT,
+	},
+	[WM8350_IRQ_CHG_VBATT_LT_3P9] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_VBATT_LT_3P9_EINT,
+	},
+	[WM8350_IRQ_CHG_VBATT_LT_3P1] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_VBATT_LT_3P1_EINT,
+	},
+	[WM8350_IRQ_CHG_VBATT_LT_2P85] = {
+		.reg = WM8350_INT_STATUS_1,
+		.mask = WM8350_CHG_VBATT_LT_2P85_EINT,
+	},
+	[WM8350_IRQ_CS1] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_CS1_EINT,
+	},
+	[WM8350_IRQ_CS2] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_CS2_EINT,
+	},
+	[WM8350_IRQ_USB_LIMIT] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_USB_LIMIT_EINT,
+	},
+	[WM8350_IRQ_AUXADC_DATARDY] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_AUXADC_DATARDY_EINT,
+	},
+	[WM8350_IRQ_AUXADC_DCOMP4] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_AUXADC_DCOMP4_EINT,
+	},
+	[WM8350_IRQ_AUXADC_DCOMP3] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_AUXADC_DCOMP3_EINT,
+	},
+	[WM8350_IRQ_AUXADC_DCOMP2] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_AUXADC_DCOMP2_EINT,
+	},
+	[WM8350_IRQ_AUXADC_DCOMP1] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_AUXADC_DCOMP1_EINT,
+	},
+	[WM8350_IRQ_SYS_HYST_COMP_FAIL] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_SYS_HYST_COMP_FAIL_EINT,
+	},
+	[WM8350_IRQ_SYS_CHIP_GT115] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_SYS_CHIP_GT115_EINT,
+	},
+	[WM8350_IRQ_SYS_CHIP_GT140] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_SYS_CHIP_GT140_EINT,
+	},
+	[WM8350_IRQ_SYS_WDOG_TO] = {
+		.reg = WM8350_INT_STATUS_2,
+		.mask = WM8350_SYS_WDOG_TO_EINT,
+	},
+	[WM8350_IRQ_UV_LDO4] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_LDO4_EINT,
+	},
+	[WM8350_IRQ_UV_LDO3] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_LDO3_EINT,
+	},
+	[WM8350_IRQ_UV_LDO2] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_LDO2_EINT,
+	},
+	[WM8350_IRQ_UV_LDO1] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_LDO1_EINT,
+	},
+	[WM8350_IRQ_UV_DC6] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC6_EINT,
+	},
+	[WM8350_IRQ_UV_DC5] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC5_EINT,
+	},
+	[WM8350_IRQ_UV_DC4] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC4_EINT,
+	},
+	[WM8350_IRQ_UV_DC3] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC3_EINT,
+	},
+	[WM8350_IRQ_UV_DC2] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC2_EINT,
+	},
+	[WM8350_IRQ_UV_DC1] = {
+		.primary = WM8350_UV_INT,
+		.reg = WM8350_UNDER_VOLTAGE_INT_STATUS,
+		.mask = WM8350_UV_DC1_EINT,
+	},
+	[WM8350_IRQ_OC_LS] = {
+		.primary = WM8350_OC_INT,
+		.reg = WM8350_OVER_CURRENT_INT_STATUS,
+		.mask = WM8350_OC_LS_EINT,
+	},
+	[WM8350_IRQ_EXT_USB_FB] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_EXT_USB_FB_EINT,
+	},
+	[WM8350_IRQ_EXT_WALL_FB] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_EXT_WALL_FB_EINT,
+	},
+	[WM8350_IRQ_EXT_BAT_FB] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_EXT_BAT_FB_EINT,
+	},
+	[WM8350_IRQ_CODEC_JCK_DET_L] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_CODEC_JCK_DET_L_EINT,
+	},
+	[WM8350_IRQ_CODEC_JCK_DET_R] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_CODEC_JCK_DET_R_EINT,
+	},
+	[WM8350_IRQ_CODEC_MICSCD] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_CODEC_MICSCD_EINT,
+	},
+	[WM8350_IRQ_CODEC_MICD] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_CODEC_MICD_EINT,
+	},
+	[WM8350_IRQ_WKUP_OFF_STATE] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_OFF_STATE_EINT,
+	},
+	[WM8350_IRQ_WKUP_HIB_STATE] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_HIB_STATE_EINT,
+	},
+	[WM8350_IRQ_WKUP_CONV_FAULT] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_CONV_FAULT_EINT,
+	},
+	[WM8350_IRQ_WKUP_WDOG_RST] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_WDOG_RST_EINT,
+	},
+	[WM8350_IRQ_WKUP_GP_PWR_ON] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_GP_PWR_ON_EINT,
+	},
+	[WM8350_IRQ_WKUP_ONKEY] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_ONKEY_EINT,
+	},
+	[WM8350_IRQ_WKUP_GP_WAKEUP] = {
+		.reg = WM8350_COMPARATOR_INT_STATUS,
+		.mask = WM8350_WKUP_GP_WAKEUP_EINT,
+	},
+	[WM8350_IRQ_GPIO(0)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP0_EINT,
+	},
+	[WM8350_IRQ_GPIO(1)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP1_EINT,
+	},
+	[WM8350_IRQ_GPIO(2)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP2_EINT,
+	},
+	[WM8350_IRQ_GPIO(3)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP3_EINT,
+	},
+	[WM8350_IRQ_GPIO(4)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP4_EINT,
+	},
+	[WM8350_IRQ_GPIO(5)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP5_EINT,
+	},
+	[WM8350_IRQ_GPIO(6)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP6_EINT,
+	},
+	[WM8350_IRQ_GPIO(7)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP7_EINT,
+	},
+	[WM8350_IRQ_GPIO(8)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP8_EINT,
+	},
+	[WM8350_IRQ_GPIO(9)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP9_EINT,
+	},
+	[WM8350_IRQ_GPIO(10)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP10_EINT,
+	},
+	[WM8350_IRQ_GPIO(11)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP11_EINT,
+	},
+	[WM8350_IRQ_GPIO(12)] = {
+		.primary = WM8350_GP_INT,
+		.reg = WM8350_GPIO_INT_STATUS,
+		.mask = WM8350_GP12_EINT,
+	},
+};
+
+/*
+ * The IRQ plus one for each bit of each status register, 0 for bits
+ * which aren't IRQs, so the worker only visits the bits that are set.
+ * Filled in from wm8350_irqs by wm8350_irq_init_lookup(); doing that
+ * again for a second device writes the same values.
+ */
+static u8 wm8350_irq_lookup[WM8350_NUM_IRQ_REGS][16];
+
+static void wm8350_irq_init_lookup(void)
+{
+	const struct wm8350_irq_data *data;
+	int i;
+
+	for (i = 0; i < WM8350_NUM_IRQ; i++) {
+		data = &wm8350_irqs[i];
+		if (!data->mask)
+			continue;
+		wm8350_irq_lookup[WM8350_IRQ_REG(data->reg)]
+			[__ffs(data->mask)] = i + 1;
+	}
+}
+
 /*
  * wm8350_irq_worker actually handles the interrupts.  Since all
  * interrupts are clear on read the IRQ line will be reasserted and
@@ -354,205 +1071,62 @@ static void wm8350_irq_call_handler(struct wm8350 *wm8350, int irq)
 static void wm8350_irq_worker(struct work_struct *work)
 {
 	struct wm8350 *wm8350 = container_of(work, struct wm8350, irq_work);
-	u16 level_one, status1, status2, comp;
-
-	/* TODO: Use block reads to improve performance? */
-	level_one = wm8350_reg_read(wm8350, WM8350_SYSTEM_INTERRUPTS)
-		& ~wm8350_reg_read(wm8350, WM8350_SYSTEM_INTERRUPTS_MASK);
-	status1 = wm8350_reg_read(wm8350, WM8350_INT_STATUS_1)
-		& ~wm8350_reg_read(wm8350, WM8350_INT_STATUS_1_MASK);
-	status2 = wm8350_reg_read(wm8350, WM8350_INT_STATUS_2)
-		& ~wm8350_reg_read(wm8350, WM8350_INT_STATUS_2_MASK);
-	comp = wm8350_reg_read(wm8350, WM8350_COMPARATOR_INT_STATUS)
-		& ~wm8350_reg_read(wm8350, WM8350_COMPARATOR_INT_STATUS_MASK);
-
-	/* over current */
-	if (level_one & WM8350_OC_INT) {
-		u16 oc;
-
-		oc = wm8350_reg_read(wm8350, WM8350_OVER_CURRENT_INT_STATUS);
-		oc &= ~wm8350_reg_read(wm8350,
-				       WM8350_OVER_CURRENT_INT_STATUS_MASK);
-
-		if (oc & WM8350_OC_LS_EINT)	/* limit switch */
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_OC_LS);
-	}
-
-	/* under voltage */
-	if (level_one & WM8350_UV_INT) {
-		u16 uv;
-
-		uv = wm8350_reg_read(wm8350, WM8350_UNDER_VOLTAGE_INT_STATUS);
-		uv &= ~wm8350_reg_read(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK);
-
-		if (uv & WM8350_UV_DC1_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC1);
-		if (uv & WM8350_UV_DC2_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC2);
-		if (uv & WM8350_UV_DC3_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC3);
-		if (uv & WM8350_UV_DC4_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC4);
-		if (uv & WM8350_UV_DC5_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC5);
-		if (uv & WM8350_UV_DC6_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_DC6);
-		if (uv & WM8350_UV_LDO1_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_LDO1);
-		if (uv & WM8350_UV_LDO2_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_LDO2);
-		if (uv & WM8350_UV_LDO3_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_LDO3);
-		if (uv & WM8350_UV_LDO4_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_UV_LDO4);
-	}
-
-	/* charger, RTC */
-	if (status1) {
-		if (status1 & WM8350_CHG_BAT_HOT_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_BAT_HOT);
-		if (status1 & WM8350_CHG_BAT_COLD_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_BAT_COLD);
-		if (status1 & WM8350_CHG_BAT_FAIL_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_BAT_FAIL);
-		if (status1 & WM8350_CHG_TO_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CHG_TO);
-		if (status1 & WM8350_CHG_END_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CHG_END);
-		if (status1 & WM8350_CHG_START_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CHG_START);
-		if (status1 & WM8350_CHG_FAST_RDY_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_FAST_RDY);
-		if (status1 & WM8350_CHG_VBATT_LT_3P9_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_VBATT_LT_3P9);
-		if (status1 & WM8350_CHG_VBATT_LT_3P1_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_VBATT_LT_3P1);
-		if (status1 & WM8350_CHG_VBATT_LT_2P85_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CHG_VBATT_LT_2P85);
-		if (status1 & WM8350_RTC_ALM_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_RTC_ALM);
-		if (status1 & WM8350_RTC_SEC_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_RTC_SEC);
-		if (status1 & WM8350_RTC_PER_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_RTC_PER);
-	}
+	u16 status[WM8350_NUM_IRQ_REGS], mask[WM8350_NUM_IRQ_REGS];
+	const struct wm8350_irq_data *data;
+	unsigned long pending;
+	u16 level_one;
+	int i, bit, irq;
+
+	/* Fetch every status register in one transaction; the masks are
+	 * only ever written by us so they come straight from the cache.
+	 */
+	if (wm8350_block_read(wm8350, WM8350_SYSTEM_INTERRUPTS,
+			      WM8350_NUM_IRQ_REGS, status) != 0 ||
+	    wm8350_block_read(wm8350, WM8350_SYSTEM_INTERRUPTS_MASK,
+			      WM8350_NUM_IRQ_REGS, mask) != 0)
+		goto out;
 
-	/* current sink, system, aux adc */
-	if (status2) {
-		if (status2 & WM8350_CS1_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CS1);
-		if (status2 & WM8350_CS2_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CS2);
-
-		if (status2 & WM8350_SYS_HYST_COMP_FAIL_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_SYS_HYST_COMP_FAIL);
-		if (status2 & WM8350_SYS_CHIP_GT115_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_SYS_CHIP_GT115);
-		if (status2 & WM8350_SYS_CHIP_GT140_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_SYS_CHIP_GT140);
-		if (status2 & WM8350_SYS_WDOG_TO_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_SYS_WDOG_TO);
-
-		if (status2 & WM8350_AUXADC_DATARDY_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_AUXADC_DATARDY);
-		if (status2 & WM8350_AUXADC_DCOMP4_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_AUXADC_DCOMP4);
-		if (status2 & WM8350_AUXADC_DCOMP3_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_AUXADC_DCOMP3);
-		if (status2 & WM8350_AUXADC_DCOMP2_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_AUXADC_DCOMP2);
-		if (status2 & WM8350_AUXADC_DCOMP1_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_AUXADC_DCOMP1);
-
-		if (status2 & WM8350_USB_LIMIT_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_USB_LIMIT);
-	}
+	level_one = status[WM8350_IRQ_REG(WM8350_SYSTEM_INTERRUPTS)] &
+		~mask[WM8350_IRQ_REG(WM8350_SYSTEM_INTERRUPTS)];
 
-	/* wake, codec, ext */
-	if (comp) {
-		if (comp & WM8350_WKUP_OFF_STATE_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_OFF_STATE);
-		if (comp & WM8350_WKUP_HIB_STATE_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_HIB_STATE);
-		if (comp & WM8350_WKUP_CONV_FAULT_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_CONV_FAULT);
-		if (comp & WM8350_WKUP_WDOG_RST_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_WDOG_RST);
-		if (comp & WM8350_WKUP_GP_PWR_ON_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_GP_PWR_ON);
-		if (comp & WM8350_WKUP_ONKEY_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_WKUP_ONKEY);
-		if (comp & WM8350_WKUP_GP_WAKEUP_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_WKUP_GP_WAKEUP);
-
-		if (comp & WM8350_CODEC_JCK_DET_L_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CODEC_JCK_DET_L);
-		if (comp & WM8350_CODEC_JCK_DET_R_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CODEC_JCK_DET_R);
-		if (comp & WM8350_CODEC_MICSCD_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_CODEC_MICSCD);
-		if (comp & WM8350_CODEC_MICD_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_CODEC_MICD);
-
-		if (comp & WM8350_EXT_USB_FB_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_EXT_USB_FB);
-		if (comp & WM8350_EXT_WALL_FB_EINT)
-			wm8350_irq_call_handler(wm8350,
-						WM8350_IRQ_EXT_WALL_FB);
-		if (comp & WM8350_EXT_BAT_FB_EINT)
-			wm8350_irq_call_handler(wm8350, WM8350_IRQ_EXT_BAT_FB);
-	}
+	for (i = 0; i < WM8350_NUM_IRQ_REGS; i++) {
+		pending = status[i] & ~mask[i];
 
-	if (level_one & WM8350_GP_INT) {
-		int i;
-		u16 gpio;
+		for_each_bit(bit, &pending, 16) {
+			irq = wm8350_irq_lookup[i][bit];
+			if (!irq--)
+				continue;
 
-		gpio = wm8350_reg_read(wm8350, WM8350_GPIO_INT_STATUS);
-		gpio &= ~wm8350_reg_read(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK);
+			data = &wm8350_irqs[irq];
+			if (data->primary && !(level_one & data->primary))
+				continue;
 
-		for (i = 0; i < 12; i++) {
-			if (gpio & (1 << i))
-				wm8350_irq_call_handler(wm8350,
-							WM8350_IRQ_GPIO(i));
+			wm8350_irq_call_handler(wm8350, irq);
 		}
 	}
 
+out:
 	enable_irq(wm8350->chip_irq);
 }
 
+/*
+ * While we are suspended the line is left disabled rather than
+ * scheduling the worker, which could otherwise run against a bus that
+ * is suspending under it.  Status bits accumulate in the chip and are
+ * all handled in one pass by wm8350_device_resume().
+ */
 static irqreturn_t wm8350_irq(int irq, void *data)
 {
 	struct wm8350 *wm8350 = data;
 
 	disable_irq_nosync(irq);
-	schedule_work(&wm8350->irq_work);
+
+	spin_lock(&wm8350->irq_lock);
+	if (wm8350->irq_suspended)
+		wm8350->irq_deferred = 1;
+	else
+		schedule_work(&wm8350->irq_work);
+	spin_unlock(&wm8350->irq_lock);
 
 	return IRQ_HANDLED;
 }
@@ -561,7 +1135,7 @@ int wm8350_register_irq(struct wm8350 *wm8350, int irq,
 			void (*handler) (struct wm8350 *, int, void *),
 			void *data)
 {
-	if (irq < 0 || irq > WM8350_NUM_IRQ || !handler)
+	if (irq < 0 || irq >= WM8350_NUM_IRQ || !handler)
 		return -EINVAL;
 
 	if (wm8350->irq[irq].handler)
@@ -578,7 +1152,7 @@ EXPORT_SYMBOL_GPL(wm8350_register_irq);
 
 int wm8350_free_irq(struct wm8350 *wm8350, int irq)
 {
-	if (irq < 0 || irq > WM8350_NUM_IRQ)
+	if (irq < 0 || irq >= WM8350_NUM_IRQ)
 		return -EINVAL;
 
 	mutex_lock(&wm8350->irq_mutex);
@@ -590,489 +1164,355 @@ EXPORT_SYMBOL_GPL(wm8350_free_irq);
 
 int wm8350_mask_irq(struct wm8350 *wm8350, int irq)
 {
-	switch (irq) {
-	case WM8350_IRQ_CHG_BAT_HOT:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_BAT_HOT_EINT);
-	case WM8350_IRQ_CHG_BAT_COLD:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_BAT_COLD_EINT);
-	case WM8350_IRQ_CHG_BAT_FAIL:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_BAT_FAIL_EINT);
-	case WM8350_IRQ_CHG_TO:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_TO_EINT);
-	case WM8350_IRQ_CHG_END:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_END_EINT);
-	case WM8350_IRQ_CHG_START:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_START_EINT);
-	case WM8350_IRQ_CHG_FAST_RDY:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_FAST_RDY_EINT);
-	case WM8350_IRQ_RTC_PER:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_RTC_PER_EINT);
-	case WM8350_IRQ_RTC_SEC:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_RTC_SEC_EINT);
-	case WM8350_IRQ_RTC_ALM:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_RTC_ALM_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_3P9:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_VBATT_LT_3P9_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_3P1:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_VBATT_LT_3P1_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_2P85:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-				       WM8350_IM_CHG_VBATT_LT_2P85_EINT);
-	case WM8350_IRQ_CS1:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_CS1_EINT);
-	case WM8350_IRQ_CS2:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_CS2_EINT);
-	case WM8350_IRQ_USB_LIMIT:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_USB_LIMIT_EINT);
-	case WM8350_IRQ_AUXADC_DATARDY:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_AUXADC_DATARDY_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP4:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_AUXADC_DCOMP4_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP3:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_AUXADC_DCOMP3_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP2:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_AUXADC_DCOMP2_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP1:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_AUXADC_DCOMP1_EINT);
-	case WM8350_IRQ_SYS_HYST_COMP_FAIL:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_SYS_HYST_COMP_FAIL_EINT);
-	case WM8350_IRQ_SYS_CHIP_GT115:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_SYS_CHIP_GT115_EINT);
-	case WM8350_IRQ_SYS_CHIP_GT140:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_SYS_CHIP_GT140_EINT);
-	case WM8350_IRQ_SYS_WDOG_TO:
-		return wm8350_set_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-				       WM8350_IM_SYS_WDOG_TO_EINT);
-	case WM8350_IRQ_UV_LDO4:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_LDO4_EINT);
-	case WM8350_IRQ_UV_LDO3:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_LDO3_EINT);
-	case WM8350_IRQ_UV_LDO2:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_LDO2_EINT);
-	case WM8350_IRQ_UV_LDO1:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_LDO1_EINT);
-	case WM8350_IRQ_UV_DC6:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC6_EINT);
-	case WM8350_IRQ_UV_DC5:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC5_EINT);
-	case WM8350_IRQ_UV_DC4:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC4_EINT);
-	case WM8350_IRQ_UV_DC3:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC3_EINT);
-	case WM8350_IRQ_UV_DC2:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC2_EINT);
-	case WM8350_IRQ_UV_DC1:
-		return wm8350_set_bits(wm8350,
-				       WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-				       WM8350_IM_UV_DC1_EINT);
-	case WM8350_IRQ_OC_LS:
-		return wm8350_set_bits(wm8350,
-				       WM8350_OVER_CURRENT_INT_STATUS_MASK,
-				       WM8350_IM_OC_LS_EINT);
-	case WM8350_IRQ_EXT_USB_FB:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_EXT_USB_FB_EINT);
-	case WM8350_IRQ_EXT_WALL_FB:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_EXT_WALL_FB_EINT);
-	case WM8350_IRQ_EXT_BAT_FB:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_EXT_BAT_FB_EINT);
-	case WM8350_IRQ_CODEC_JCK_DET_L:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_CODEC_JCK_DET_L_EINT);
-	case WM8350_IRQ_CODEC_JCK_DET_R:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_CODEC_JCK_DET_R_EINT);
-	case WM8350_IRQ_CODEC_MICSCD:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_CODEC_MICSCD_EINT);
-	case WM8350_IRQ_CODEC_MICD:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_CODEC_MICD_EINT);
-	case WM8350_IRQ_WKUP_OFF_STATE:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_OFF_STATE_EINT);
-	case WM8350_IRQ_WKUP_HIB_STATE:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_HIB_STATE_EINT);
-	case WM8350_IRQ_WKUP_CONV_FAULT:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_CONV_FAULT_EINT);
-	case WM8350_IRQ_WKUP_WDOG_RST:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_OFF_STATE_EINT);
-	case WM8350_IRQ_WKUP_GP_PWR_ON:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_GP_PWR_ON_EINT);
-	case WM8350_IRQ_WKUP_ONKEY:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_ONKEY_EINT);
-	case WM8350_IRQ_WKUP_GP_WAKEUP:
-		return wm8350_set_bits(wm8350,
-				       WM8350_COMPARATOR_INT_STATUS_MASK,
-				       WM8350_IM_WKUP_GP_WAKEUP_EINT);
-	case WM8350_IRQ_GPIO(0):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP0_EINT);
-	case WM8350_IRQ_GPIO(1):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP1_EINT);
-	case WM8350_IRQ_GPIO(2):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP2_EINT);
-	case WM8350_IRQ_GPIO(3):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP3_EINT);
-	case WM8350_IRQ_GPIO(4):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP4_EINT);
-	case WM8350_IRQ_GPIO(5):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP5_EINT);
-	case WM8350_IRQ_GPIO(6):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP6_EINT);
-	case WM8350_IRQ_GPIO(7):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP7_EINT);
-	case WM8350_IRQ_GPIO(8):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP8_EINT);
-	case WM8350_IRQ_GPIO(9):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP9_EINT);
-	case WM8350_IRQ_GPIO(10):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP10_EINT);
-	case WM8350_IRQ_GPIO(11):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP11_EINT);
-	case WM8350_IRQ_GPIO(12):
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_INT_STATUS_MASK,
-				       WM8350_IM_GP12_EINT);
-	default:
+	const struct wm8350_irq_data *data;
+
+	if (irq < 0 || irq >= WM8350_NUM_IRQ) {
 		dev_warn(wm8350->dev, "Attempting to mask unknown IRQ %d\n",
 			 irq);
 		return -EINVAL;
 	}
-	return 0;
+
+	data = &wm8350_irqs[irq];
+
+	return wm8350_set_bits(wm8350, WM8350_IRQ_MASK_REG(data->reg),
+			       data->mask);
 }
 EXPORT_SYMBOL_GPL(wm8350_mask_irq);
 
 int wm8350_unmask_irq(struct wm8350 *wm8350, int irq)
 {
-	switch (irq) {
-	case WM8350_IRQ_CHG_BAT_HOT:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_BAT_HOT_EINT);
-	case WM8350_IRQ_CHG_BAT_COLD:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_BAT_COLD_EINT);
-	case WM8350_IRQ_CHG_BAT_FAIL:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_BAT_FAIL_EINT);
-	case WM8350_IRQ_CHG_TO:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_TO_EINT);
-	case WM8350_IRQ_CHG_END:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_END_EINT);
-	case WM8350_IRQ_CHG_START:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_START_EINT);
-	case WM8350_IRQ_CHG_FAST_RDY:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_FAST_RDY_EINT);
-	case WM8350_IRQ_RTC_PER:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_RTC_PER_EINT);
-	case WM8350_IRQ_RTC_SEC:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_RTC_SEC_EINT);
-	case WM8350_IRQ_RTC_ALM:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_RTC_ALM_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_3P9:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_VBATT_LT_3P9_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_3P1:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_VBATT_LT_3P1_EINT);
-	case WM8350_IRQ_CHG_VBATT_LT_2P85:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_1_MASK,
-					 WM8350_IM_CHG_VBATT_LT_2P85_EINT);
-	case WM8350_IRQ_CS1:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_CS1_EINT);
-	case WM8350_IRQ_CS2:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_CS2_EINT);
-	case WM8350_IRQ_USB_LIMIT:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_USB_LIMIT_EINT);
-	case WM8350_IRQ_AUXADC_DATARDY:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_AUXADC_DATARDY_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP4:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_AUXADC_DCOMP4_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP3:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_AUXADC_DCOMP3_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP2:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_AUXADC_DCOMP2_EINT);
-	case WM8350_IRQ_AUXADC_DCOMP1:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_AUXADC_DCOMP1_EINT);
-	case WM8350_IRQ_SYS_HYST_COMP_FAIL:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_SYS_HYST_COMP_FAIL_EINT);
-	case WM8350_IRQ_SYS_CHIP_GT115:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_SYS_CHIP_GT115_EINT);
-	case WM8350_IRQ_SYS_CHIP_GT140:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_SYS_CHIP_GT140_EINT);
-	case WM8350_IRQ_SYS_WDOG_TO:
-		return wm8350_clear_bits(wm8350, WM8350_INT_STATUS_2_MASK,
-					 WM8350_IM_SYS_WDOG_TO_EINT);
-	case WM8350_IRQ_UV_LDO4:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_LDO4_EINT);
-	case WM8350_IRQ_UV_LDO3:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_LDO3_EINT);
-	case WM8350_IRQ_UV_LDO2:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_LDO2_EINT);
-	case WM8350_IRQ_UV_LDO1:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_LDO1_EINT);
-	case WM8350_IRQ_UV_DC6:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC6_EINT);
-	case WM8350_IRQ_UV_DC5:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC5_EINT);
-	case WM8350_IRQ_UV_DC4:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC4_EINT);
-	case WM8350_IRQ_UV_DC3:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC3_EINT);
-	case WM8350_IRQ_UV_DC2:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC2_EINT);
-	case WM8350_IRQ_UV_DC1:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_UNDER_VOLTAGE_INT_STATUS_MASK,
-					 WM8350_IM_UV_DC1_EINT);
-	case WM8350_IRQ_OC_LS:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_OVER_CURRENT_INT_STATUS_MASK,
-					 WM8350_IM_OC_LS_EINT);
-	case WM8350_IRQ_EXT_USB_FB:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_EXT_USB_FB_EINT);
-	case WM8350_IRQ_EXT_WALL_FB:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_EXT_WALL_FB_EINT);
-	case WM8350_IRQ_EXT_BAT_FB:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_EXT_BAT_FB_EINT);
-	case WM8350_IRQ_CODEC_JCK_DET_L:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_CODEC_JCK_DET_L_EINT);
-	case WM8350_IRQ_CODEC_JCK_DET_R:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_CODEC_JCK_DET_R_EINT);
-	case WM8350_IRQ_CODEC_MICSCD:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_CODEC_MICSCD_EINT);
-	case WM8350_IRQ_CODEC_MICD:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_CODEC_MICD_EINT);
-	case WM8350_IRQ_WKUP_OFF_STATE:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_OFF_STATE_EINT);
-	case WM8350_IRQ_WKUP_HIB_STATE:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_HIB_STATE_EINT);
-	case WM8350_IRQ_WKUP_CONV_FAULT:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_CONV_FAULT_EINT);
-	case WM8350_IRQ_WKUP_WDOG_RST:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_OFF_STATE_EINT);
-	case WM8350_IRQ_WKUP_GP_PWR_ON:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_GP_PWR_ON_EINT);
-	case WM8350_IRQ_WKUP_ONKEY:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_ONKEY_EINT);
-	case WM8350_IRQ_WKUP_GP_WAKEUP:
-		return wm8350_clear_bits(wm8350,
-					 WM8350_COMPARATOR_INT_STATUS_MASK,
-					 WM8350_IM_WKUP_GP_WAKEUP_EINT);
-	case WM8350_IRQ_GPIO(0):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP0_EINT);
-	case WM8350_IRQ_GPIO(1):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP1_EINT);
-	case WM8350_IRQ_GPIO(2):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP2_EINT);
-	case WM8350_IRQ_GPIO(3):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP3_EINT);
-	case WM8350_IRQ_GPIO(4):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP4_EINT);
-	case WM8350_IRQ_GPIO(5):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP5_EINT);
-	case WM8350_IRQ_GPIO(6):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP6_EINT);
-	case WM8350_IRQ_GPIO(7):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP7_EINT);
-	case WM8350_IRQ_GPIO(8):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP8_EINT);
-	case WM8350_IRQ_GPIO(9):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP9_EINT);
-	case WM8350_IRQ_GPIO(10):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP10_EINT);
-	case WM8350_IRQ_GPIO(11):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP11_EINT);
-	case WM8350_IRQ_GPIO(12):
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_STATUS_MASK,
-					 WM8350_IM_GP12_EINT);
-	default:
+	const struct wm8350_irq_data *data;
+
+	if (irq < 0 || irq >= WM8350_NUM_IRQ) {
 		dev_warn(wm8350->dev, "Attempting to unmask unknown IRQ %d\n",
 			 irq);
 		return -EINVAL;
 	}
-	return 0;
+
+	data = &wm8350_irqs[irq];
+
+	return wm8350_clear_bits(wm8350, WM8350_IRQ_MASK_REG(data->reg),
+				 data->mask);
 }
 EXPORT_SYMBOL_GPL(wm8350_unmask_irq);
 
+/*
+ * AUXADC
+ *
+ * Requests are queued and everything compatible with the sequence
+ * being built is converted in one go: the chip samples every selected
+ * channel and raises DATARDY when all the results are in.  Only the
+ * AUX1-4 inputs have scale and reference settings so two requests for
+ * the same one of those can only share a sequence if they agree.
+ *
+ * A request is owned by the AUXADC code while req->queued is set; it
+ * is cleared under the lock as the request is taken off the queues to
+ * be completed, so a submitter giving up on a request can tell whether
+ * it may still withdraw it.  Without the DATARDY interrupt the end of
+ * the sequence is polled for.
+ */
+#define WM8350_AUXADC_CHANNELS	8
+#define WM8350_AUXADC_TIMEOUT	(HZ / 10)
+
+static int wm8350_auxadc_compatible(struct wm8350_auxadc_request *a,
+				    struct wm8350_auxadc_request *b)
+{
+	if (a->channel != b->channel || a->channel > WM8350_AUXADC_AUX4)
+		return 1;
+
+	return a->scale == b->scale && !a->vref == !b->vref;
+}
+
+static void wm8350_auxadc_complete(struct wm8350 *wm8350,
+				   struct list_head *done)
+{
+	struct wm8350_auxadc_request *req, *n;
+
+	list_for_each_entry_safe(req, n, done, list) {
+		list_del_init(&req->list);
+		req->complete(wm8350, req);
+	}
+}
+
+/* Start a sequence for whatever is pending, with the lock held.  If
+ * the chip can't be started the requests are moved to @failed for the
+ * caller to complete once it has dropped the lock.
+ */
+static void wm8350_auxadc_start(struct wm8350 *wm8350,
+				struct list_head *failed)
+{
+	struct wm8350_auxadc *adc = &wm8350->auxadc;
+	struct wm8350_auxadc_request *req, *n, *first[WM8350_AUXADC_CHANNELS];
+	u16 sel = 0, val;
+	int ch, ret;
+
+	if (list_empty(&adc->pending)) {
+		if (adc->irq)
+			wm8350_mask_irq(wm8350, WM8350_IRQ_AUXADC_DATARDY);
+		wm8350_clear_bits(wm8350, WM8350_POWER_MGMT_5,
+				  WM8350_AUXADC_ENA);
+		return;
+	}
+
+	memset(first, 0, sizeof(first));
+	list_for_each_entry_safe(req, n, &adc->pending, list) {
+		ch = req->channel;
+		if (first[ch] && !wm8350_auxadc_compatible(first[ch], req))
+			continue;
+		if (!first[ch])
+			first[ch] = req;
+		sel |= 1 << ch;
+		list_move_tail(&req->list, &adc->active);
+	}
+
+	for (ch = WM8350_AUXADC_AUX1; ch <= WM8350_AUXADC_AUX4; ch++) {
+		if (!first[ch])
+			continue;
+		val = (first[ch]->scale << 13) & WM8350_AUXADC_SCALE1_MASK;
+		if (first[ch]->vref)
+			val |= WM8350_AUXADC_REF1;
+		wm8350_reg_update_bits(wm8350, WM8350_AUX1_READBACK + ch,
+				       WM8350_AUXADC_SCALE1_MASK |
+				       WM8350_AUXADC_REF1, val);
+	}
+
+	wm8350_set_bits(wm8350, WM8350_POWER_MGMT_5, WM8350_AUXADC_ENA);
+	if (adc->irq)
+		wm8350_unmask_irq(wm8350, WM8350_IRQ_AUXADC_DATARDY);
+	ret = wm8350_reg_update_bits(wm8350, WM8350_DIGITISER_CONTROL_1,
+				     0xff | WM8350_AUXADC_POLL,
+				     sel | WM8350_AUXADC_POLL);
+	if (ret != 0) {
+		list_for_each_entry(req, &adc->active, list) {
+			req->value = ret;
+			req->queued = 0;
+		}
+		list_splice_init(&adc->active, failed);
+		return;
+	}
+
+	adc->started = jiffies;
+	if (!adc->irq)
+		schedule_delayed_work(&adc->poll_work, 1);
+}
+
+/* The running sequence is over, with the results in the readback
+ * registers unless err is set; collect them and start the next.
+ */
+static void wm8350_auxadc_finish(struct wm8350 *wm8350, int err)
+{
+	struct wm8350_auxadc *adc = &wm8350->auxadc;
+	struct wm8350_auxadc_request *req, *n;
+	u16 result[WM8350_AUXADC_CHANNELS];
+	LIST_HEAD(done);
+	int ret = err;
+
+	mutex_lock(&adc->lock);
+
+	/* all the readback registers in one transfer */
+	if (!ret)
+		ret = wm8350_block_read(wm8350, WM8350_AUX1_READBACK,
+					WM8350_AUXADC_CHANNELS, result);
+
+	list_for_each_entry_safe(req, n, &adc->active, list) {
+		if (ret != 0)
+			req->value = ret;
+		else if (req->value >= 0)
+			req->value = result[req->channel] &
+				WM8350_AUXADC_DATA1_MASK;
+		req->queued = 0;
+		list_move_tail(&req->list, &done);
+	}
+
+	wm8350_auxadc_start(wm8350, &done);
+	mutex_unlock(&adc->lock);
+
+	wm8350_auxadc_complete(wm8350, &done);
+}
+
+static void wm8350_auxadc_irq(struct wm8350 *wm8350, int irq, void *data)
+{
+	wm8350_auxadc_finish(wm8350, 0);
+}
+
+/* AUXADC_POLL clears itself once every selected channel is converted */
+static void wm8350_auxadc_poll(struct work_struct *work)
+{
+	struct wm8350 *wm8350 = container_of(work, struct wm8350,
+					     auxadc.poll_work.work);
+	struct wm8350_auxadc *adc = &wm8350->auxadc;
+	u16 reg;
+
+	reg = wm8350_reg_read(wm8350, WM8350_DIGITISER_CONTROL_1);
+	if (!(reg & WM8350_AUXADC_POLL)) {
+		wm8350_auxadc_finish(wm8350, 0);
+		return;
+	}
+
+	if (time_after(jiffies, adc->started + WM8350_AUXADC_TIMEOUT)) {
+		dev_err(wm8350->dev, "AUXADC sequence timed out\n");
+		wm8350_auxadc_finish(wm8350, -ETIMEDOUT);
+		return;
+	}
+
+	schedule_delayed_work(&adc->poll_work, 1);
+}
+
+/**
+ * wm8350_auxadc_submit - queue an AUXADC conversion
+ * @wm8350: device
+ * @req: conversion to make
+ *
+ * The request is converted along with any others queued at the same
+ * time and @req->complete() called from the conversion complete
+ * interrupt.  @req must stay valid until then.
+ */
+int wm8350_auxadc_submit(struct wm8350 *wm8350,
+			 struct wm8350_auxadc_request *req)
+{
+	struct wm8350_auxadc *adc = &wm8350->auxadc;
+	LIST_HEAD(failed);
+
+	if (req->channel < 0 || req->channel >= WM8350_AUXADC_CHANNELS ||
+	    !req->complete)
+		return -EINVAL;
+
+	req->value = 0;
+
+	mutex_lock(&adc->lock);
+	req->queued = 1;
+	list_add_tail(&req->list, &adc->pending);
+	if (list_empty(&adc->active))
+		wm8350_auxadc_start(wm8350, &failed);
+	mutex_unlock(&adc->lock);
+
+	wm8350_auxadc_complete(wm8350, &failed);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(wm8350_auxadc_submit);
+
+/**
+ * wm8350_auxadc_cancel - withdraw a queued AUXADC conversion
+ * @wm8350: device
+ * @req: conversion submitted with wm8350_auxadc_submit()
+ *
+ * Returns 0 if @req was withdrawn and will not be completed, or -EBUSY
+ * if it is already being completed, in which case @req->complete() is
+ * or has been called and @req must stay valid until it returns.
+ */
+int wm8350_auxadc_cancel(struct wm8350 *wm8350,
+			 struct wm8350_auxadc_request *req)
+{
+	struct wm8350_auxadc *adc = &wm8350->auxadc;
+	int ret = -EBUSY;
+
+	mutex_lock(&adc->lock);
+	if (req->queued) {
+		list_del_init(&req->list);
+		req->queued = 0;
+		ret = 0;
+	}
+	mutex_unlock(&adc->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(wm8350_auxadc_cancel);
+
+static void wm8350_auxadc_read_complete(struct wm8350 *wm8350,
+					struct wm8350_auxadc_request *req)
+{
+	complete(req->data);
+}
+
+/**
+ * wm8350_read_auxadc - make an AUXADC conversion and wait for it
+ * @wm8350: device
+ * @channel: WM8350_AUXADC_ channel to convert
+ * @scale: input scaling, AUX1-4 only
+ * @vref: non-zero to use the external reference, AUX1-4 only
+ *
+ * Returns the 12 bit result or a negative errno.
+ */
+int wm8350_read_auxadc(struct wm8350 *wm8350, int channel, int scale,
+		       int vref)
+{
+	struct wm8350_auxadc_request req;
+	DECLARE_COMPLETION_ONSTACK(done);
+	int ret;
+
+	req.channel = channel;
+	req.scale = scale;
+	req.vref = vref;
+	req.complete = wm8350_auxadc_read_complete;
+	req.data = &done;
+
+	ret = wm8350_auxadc_submit(wm8350, &req);
+	if (ret != 0)
+		return ret;
+
+	if (!wait_for_completion_timeout(&done, WM8350_AUXADC_TIMEOUT)) {
+		if (wm8350_auxadc_cancel(wm8350, &req) == 0) {
+			dev_err(wm8350->dev, "AUXADC conversion timed out\n");
+			return -ETIMEDOUT;
+		}
+
+		/* the result is being delivered */
+		wait_for_completion(&done);
+	}
+
+	return req.value;
+}
+EXPORT_SYMBOL_GPL(wm8350_read_auxadc);
+
 /*
  * Cache is always host endian.
  */
-static int wm8350_create_cache(struct wm8350 *wm8350, int mode)
+/* registers to read back into the cache, skipping the audio block */
+static inline int wm8350_cache_readable(int reg)
+{
+	return wm8350_reg_io_map[reg].readable && !wm8350_is_audio_reg(reg);
+}
+
+/* Read every readable register into buf, each run of them with a
+ * single block read to keep the number of bus transactions down.
+ * Entries for the other registers are left alone.
+ */
+static int wm8350_read_cache(struct wm8350 *wm8350, u16 *buf)
 {
-	int i, ret = 0;
+	int i, end, ret;
 	u16 value;
+
+	i = 0;
+	while (i < WM8350_MAX_REGISTER) {
+		if (!wm8350_cache_readable(i)) {
+			i++;
+			continue;
+		}
+
+		for (end = i + 1; end < WM8350_MAX_REGISTER; end++)
+			if (!wm8350_cache_readable(end))
+				break;
+
+		ret = wm8350->read_dev(wm8350, i, (end - i) * 2,
+				       (char *)&buf[i]);
+		if (ret < 0)
+			return ret;
+
+		for (; i < end; i++) {
+			value = be16_to_cpu(buf[i]);
+			value &= wm8350_reg_io_map[i].readable;
+			value &= ~wm8350_reg_io_map[i].vol;
+			buf[i] = value;
+		}
+	}
+
+	return 0;
+}
+
+static int wm8350_create_cache(struct wm8350 *wm8350, int mode)
+{
+	int i, ret;
 	const u16 *reg_map;
 
 	switch (mode) {
@@ -1111,52 +1551,308 @@ static int wm8350_create_cache(struct wm8350 *wm8350, int mode)
 	 * a PMIC so the device many not be in a virgin state and we
 	 * can't rely on the silicon values.
 	 */
-	for (i = 0; i < WM8350_MAX_REGISTER; i++) {
-		/* audio register range */
-		if (wm8350_reg_io_map[i].readable &&
-		    (i < WM8350_CLOCK_CONTROL_1 || i > WM8350_AIF_TEST)) {
-			ret = wm8350->read_dev(wm8350, i, 2, (char *)&value);
-			if (ret < 0) {
-				dev_err(wm8350->dev,
-				       "failed to read initial cache value\n");
-				goto out;
-			}
-			value = be16_to_cpu(value);
-			value &= wm8350_reg_io_map[i].readable;
-			value &= ~wm8350_reg_io_map[i].vol;
-			wm8350->reg_cache[i] = value;
-		} else
+	for (i = 0; i < WM8350_MAX_REGISTER; i++)
+		if (!wm8350_cache_readable(i))
 			wm8350->reg_cache[i] = reg_map[i];
+	wm8350->reg_defaults = reg_map;
+
+	ret = wm8350_read_cache(wm8350, wm8350->reg_cache);
+	if (ret < 0) {
+		dev_err(wm8350->dev, "failed to read initial cache values\n");
+		return ret;
+	}
+
+	/* The audio block is only known to match the defaults while it is
+	 * in reset; if it is running it gets reset before use by the CODEC
+	 * driver, which clears CODEC_ENA.
+	 */
+	if (!(wm8350->reg_cache[WM8350_POWER_MGMT_5] & WM8350_CODEC_ENA))
+		wm8350_audio_off(wm8350, 1);
+
+	return 0;
+}
+
+/* Firmware, or the PMIC itself on the way through a low power state,
+ * may have changed registers behind our back.  The cache is refreshed
+ * from the hardware in a single pass of block reads, except for the
+ * registers written while in cache only mode, which are then written
+ * back.
+ */
+static int wm8350_cache_refresh(struct wm8350 *wm8350)
+{
+	u16 *buf;
+	int i, ret;
+
+	buf = kmalloc(sizeof(u16) * (WM8350_MAX_REGISTER + 1), GFP_KERNEL);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&wm8350->io_mutex);
+	ret = wm8350_read_cache(wm8350, buf);
+	if (ret < 0) {
+		dev_err(wm8350->dev, "failed to refresh cache: %d\n", ret);
+		goto out;
+	}
+
+	for (i = 0; i < WM8350_MAX_REGISTER; i++)
+		if (wm8350_cache_readable(i) && !test_bit(i, wm8350->reg_dirty))
+			wm8350->reg_cache[i] = buf[i];
+
+	wm8350->cache_only = 0;
+	ret = wm8350_sync(wm8350);
+	if (ret)
+		dev_err(wm8350->dev, "cache sync failed: %d\n", ret);
+out:
+	mutex_unlock(&wm8350->io_mutex);
+	kfree(buf);
+	return ret;
+}
+
+/*
+ * debugfs register snapshot.  The interrupt status registers are left
+ * out since reading them clears them.
+ */
+static int wm8350_dump_readable(void *data, unsigned int reg)
+{
+	if (reg >= WM8350_SYSTEM_INTERRUPTS &&
+	    reg < WM8350_SYSTEM_INTERRUPTS + WM8350_NUM_IRQ_REGS)
+		return 0;
+
+	return wm8350_cache_readable(reg);
+}
+
+static int wm8350_dump_cached(void *data, unsigned int reg, unsigned int *val)
+{
+	struct wm8350 *wm8350 = data;
+
+	if (wm8350_reg_io_map[reg].vol)
+		return 0;
+
+	*val = wm8350->reg_cache[reg];
+	return 1;
+}
+
+static int wm8350_dump_read(void *data, unsigned int reg, unsigned int count,
+			    unsigned int *vals)
+{
+	struct wm8350 *wm8350 = data;
+	u16 *buf;
+	int i, ret;
+
+	if (wm8350->cache_only)
+		return -EBUSY;
+
+	buf = kmalloc(count * sizeof(u16), GFP_KERNEL);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	ret = wm8350->read_dev(wm8350, reg, count * sizeof(u16), (char *)buf);
+	if (ret >= 0) {
+		ret = 0;
+		for (i = 0; i < count; i++)
+			vals[i] = be16_to_cpu(buf[i]) &
+				wm8350_reg_io_map[reg + i].readable;
+	}
+
+	kfree(buf);
+	return ret;
+}
+
+static void wm8350_dump_lock(void *data)
+{
+	struct wm8350 *wm8350 = data;
+
+	mutex_lock(&wm8350->io_mutex);
+}
+
+static void wm8350_dump_unlock(void *data)
+{
+	struct wm8350 *wm8350 = data;
+
+	mutex_unlock(&wm8350->io_mutex);
+}
+
+static void wm8350_hold_irqs(struct wm8350 *wm8350)
+{
+	spin_lock_irq(&wm8350->irq_lock);
+	wm8350->irq_suspended = 1;
+	spin_unlock_irq(&wm8350->irq_lock);
+
+	flush_work(&wm8350->irq_work);
+}
+
+static void wm8350_release_irqs(struct wm8350 *wm8350)
+{
+	spin_lock_irq(&wm8350->irq_lock);
+	wm8350->irq_suspended = 0;
+	if (wm8350->irq_deferred) {
+		wm8350->irq_deferred = 0;
+		schedule_work(&wm8350->irq_work);
+	}
+	spin_unlock_irq(&wm8350->irq_lock);
+}
+
+/**
+ * wm8350_device_suspend - stop handling interrupts for system suspend
+ * @wm8350: device
+ *
+ * Interrupts arriving from now on are left pending in the chip until
+ * wm8350_device_resume().  A pass of the interrupt worker which is
+ * already queued is allowed to finish while the bus is still running.
+ */
+int wm8350_device_suspend(struct wm8350 *wm8350)
+{
+	wm8350_hold_irqs(wm8350);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(wm8350_device_suspend);
+
+/**
+ * wm8350_device_resume - bring the device back in step after suspend
+ * @wm8350: device
+ *
+ * Refreshes the register cache so that regulators resuming after us
+ * compare against the hardware without going to the bus, then handles
+ * every interrupt which came in while suspended in a single pass.
+ */
+int wm8350_device_resume(struct wm8350 *wm8350)
+{
+	int ret;
+
+	ret = wm8350_cache_refresh(wm8350);
+
+	wm8350_release_irqs(wm8350);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(wm8350_device_resume);
+
+/**
+ * wm8350_hibernate - put the device into its hibernate state
+ * @wm8350: device
+ *
+ * In hibernate each DCDC and LDO runs with the hibernate voltage, mode
+ * and enable programmed by wm8350_dcdc_set_suspend_voltage(),
+ * wm8350_dcdc_set_suspend_mode() and the regulator suspend operations.
+ * Those settings only take effect in hibernate, so they can be made
+ * once and the device then hibernated and woken as often as needed,
+ * for example from deep idle states as well as system suspend.  To
+ * make them in one pass instead, call wm8350_cache_only() first; every
+ * register changed since then is written here in as few transfers as
+ * possible before the device enters hibernate.
+ *
+ * Until wm8350_wake() register writes, including those from the
+ * regulator API, only update the cache, volatile bits read as zero and
+ * interrupts are held back, so nothing goes to the bus.  Must be
+ * called from process context, and not at the same time as
+ * wm8350_wake().
+ */
+int wm8350_hibernate(struct wm8350 *wm8350)
+{
+	u16 val;
+	int ret;
+
+	if (wm8350->hibernating)
+		return -EBUSY;
+
+	wm8350_hold_irqs(wm8350);
+
+	mutex_lock(&wm8350->io_mutex);
+
+	wm8350->cache_only = 0;
+	ret = wm8350_sync(wm8350);
+	if (ret) {
+		dev_err(wm8350->dev, "failed to write hibernate setup: %d\n",
+			ret);
+		goto out;
 	}
 
+	/* HIBERNATE is volatile so stays out of the cache and won't be set
+	 * again by the sync in wm8350_wake() */
+	val = wm8350->reg_cache[WM8350_SYSTEM_HIBERNATE] | WM8350_HIBERNATE;
+	ret = wm8350_write(wm8350, WM8350_SYSTEM_HIBERNATE, 1, &val);
+	if (ret) {
+		dev_err(wm8350->dev, "failed to enter hibernate: %d\n", ret);
+		goto out;
+	}
+
+	wm8350->cache_only = 1;
+	wm8350->hibernating = 1;
+
 out:
+	mutex_unlock(&wm8350->io_mutex);
+
+	if (ret)
+		wm8350_release_irqs(wm8350);
+
 	return ret;
 }
+EXPORT_SYMBOL_GPL(wm8350_hibernate);
+
+/**
+ * wm8350_wake - bring the device out of wm8350_hibernate()
+ * @wm8350: device
+ *
+ * Takes the device out of hibernate and writes the registers changed
+ * while it was hibernated in the same cache sync; the system hibernate
+ * register comes first so the rails are back at their active settings
+ * before anything else is written.  Interrupts which came in while
+ * hibernated, including the wake event if the device woke itself, are
+ * then handled in a single pass.  Must be called from process context.
+ */
+int wm8350_wake(struct wm8350 *wm8350)
+{
+	int ret;
+
+	mutex_lock(&wm8350->io_mutex);
+
+	if (!wm8350->hibernating) {
+		mutex_unlock(&wm8350->io_mutex);
+		return -EINVAL;
+	}
+
+	/* the cached value never has HIBERNATE set */
+	set_bit(WM8350_SYSTEM_HIBERNATE, wm8350->reg_dirty);
+	wm8350->cache_only = 0;
+	ret = wm8350_sync(wm8350);
+	if (ret) {
+		/* what wasn't written stays dirty for another try */
+		dev_err(wm8350->dev, "failed to leave hibernate: %d\n", ret);
+		wm8350->cache_only = 1;
+	} else {
+		wm8350->hibernating = 0;
+	}
+
+	mutex_unlock(&wm8350->io_mutex);
+
+	if (ret)
+		return ret;
+
+	wm8350_release_irqs(wm8350);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(wm8350_wake);
 
 /*
  * Register a client device.  This is non-fatal since there is no need to
  * fail the entire device init due to a single platform device failing.
+ * The clients only depend on the core so they are registered, and hence
+ * probed, in the background alongside each other.
  */
 static void wm8350_client_dev_register(struct wm8350 *wm8350,
 				       const char *name,
 				       struct platform_device **pdev)
 {
-	int ret;
-
 	*pdev = platform_device_alloc(name, -1);
-	if (pdev == NULL) {
+	if (*pdev == NULL) {
 		dev_err(wm8350->dev, "Failed to allocate %s\n", name);
 		return;
 	}
 
 	(*pdev)->dev.parent = wm8350->dev;
 	platform_set_drvdata(*pdev, wm8350);
-	ret = platform_device_add(*pdev);
-	if (ret != 0) {
-		dev_err(wm8350->dev, "Failed to register %s: %d\n", name, ret);
-		platform_device_put(*pdev);
-		*pdev = NULL;
-	}
+	mfd_platform_device_add_async(&wm8350->client_async, pdev);
 }
 
 int wm8350_device_init(struct wm8350 *wm8350, int irq,
@@ -1165,6 +1861,9 @@ int wm8350_device_init(struct wm8350 *wm8350, int irq,
 	int ret = -EINVAL;
 	u16 id1, id2, mask, mode;
 
+	mutex_init(&wm8350->io_mutex);
+	mfd_async_init(&wm8350->client_async);
+
 	/* get WM8350 revision and config mode */
 	wm8350->read_dev(wm8350, WM8350_RESET_ID, sizeof(id1), &id1);
 	wm8350->read_dev(wm8350, WM8350_ID, sizeof(id2), &id2);
@@ -1219,7 +1918,9 @@ int wm8350_device_init(struct wm8350 *wm8350, int irq,
 	}
 
 	mutex_init(&wm8350->irq_mutex);
+	spin_lock_init(&wm8350->irq_lock);
 	INIT_WORK(&wm8350->irq_work, wm8350_irq_worker);
+	wm8350_irq_init_lookup();
 	if (irq) {
 		ret = request_irq(irq, wm8350_irq, 0,
 				  "wm8350", wm8350);
@@ -1236,6 +1937,31 @@ int wm8350_device_init(struct wm8350 *wm8350, int irq,
 
 	wm8350_reg_write(wm8350, WM8350_SYSTEM_INTERRUPTS_MASK, 0x0);
 
+	/* the rest of the system needs our supplies to resume */
+	device_enable_resume_first(wm8350->dev);
+
+	mutex_init(&wm8350->auxadc.lock);
+	INIT_LIST_HEAD(&wm8350->auxadc.pending);
+	INIT_LIST_HEAD(&wm8350->auxadc.active);
+	INIT_DELAYED_WORK(&wm8350->auxadc.poll_work, wm8350_auxadc_poll);
+	if (wm8350_register_irq(wm8350, WM8350_IRQ_AUXADC_DATARDY,
+				wm8350_auxadc_irq, NULL) == 0)
+		wm8350->auxadc.irq = 1;
+	else
+		dev_warn(wm8350->dev, "No AUXADC interrupt, polling\n");
+
+	wm8350->regdump.num_regs = WM8350_MAX_REGISTER;
+	wm8350->regdump.max_block = WM8350_MAX_REGISTER;
+	wm8350->regdump.reg_digits = 2;
+	wm8350->regdump.val_digits = 4;
+	wm8350->regdump.readable = wm8350_dump_readable;
+	wm8350->regdump.cached = wm8350_dump_cached;
+	wm8350->regdump.read = wm8350_dump_read;
+	wm8350->regdump.lock = wm8350_dump_lock;
+	wm8350->regdump.unlock = wm8350_dump_unlock;
+	wm8350->regdump.data = wm8350;
+	mfd_regdump_add(&wm8350->regdump, wm8350->dev);
+
 	wm8350_client_dev_register(wm8350, "wm8350-codec",
 				   &(wm8350->codec.pdev));
 	wm8350_client_dev_register(wm8350, "wm8350-gpio",
@@ -1257,6 +1983,9 @@ void wm8350_device_exit(struct wm8350 *wm8350)
 {
 	int i;
 
+	mfd_async_synchronize(&wm8350->client_async);
+	mfd_regdump_remove(&wm8350->regdump);
+
 	for (i = 0; i < ARRAY_SIZE(wm8350->pmic.pdev); i++)
 		platform_device_unregister(wm8350->pmic.pdev[i]);
 
@@ -1266,6 +1995,10 @@ void wm8350_device_exit(struct wm8350 *wm8350)
 	platform_device_unregister(wm8350->gpio.pdev);
 	platform_device_unregister(wm8350->codec.pdev);
 
+	if (wm8350->auxadc.irq)
+		wm8350_free_irq(wm8350, WM8350_IRQ_AUXADC_DATARDY);
+	cancel_delayed_work_sync(&wm8350->auxadc.poll_work);
+
 	free_irq(wm8350->chip_irq, wm8350);
 	flush_work(&wm8350->irq_work);
 	kfree(wm8350->reg_cache);
@@ -20,203 +20,118 @@
 #include <linux/mfd/wm8350/gpio.h>
 #include <linux/mfd/wm8350/pmic.h>
 
-static int gpio_set_dir(struct wm8350 *wm8350, int gpio, int dir)
-{
-	int ret;
+#define WM8350_NUM_GPIO		13
 
-	wm8350_reg_unlock(wm8350);
-	if (dir == WM8350_GPIO_DIR_OUT)
-		ret = wm8350_clear_bits(wm8350,
-					WM8350_GPIO_CONFIGURATION_I_O,
-					1 << gpio);
-	else
-		ret = wm8350_set_bits(wm8350,
-				      WM8350_GPIO_CONFIGURATION_I_O,
-				      1 << gpio);
-	wm8350_reg_lock(wm8350);
-	return ret;
-}
-
-static int gpio_set_debounce(struct wm8350 *wm8350, int gpio, int db)
+/*
+ * Each setting lives in a register with one bit per GPIO (or, for the
+ * function, a nibble per GPIO) so a whole set of GPIOs is configured
+ * with a single update of each register.
+ */
+static int gpio_update(struct wm8350 *wm8350, u16 reg, u16 mask, int set)
 {
-	if (db == WM8350_GPIO_DEBOUNCE_ON)
-		return wm8350_set_bits(wm8350, WM8350_GPIO_DEBOUNCE,
-				       1 << gpio);
-	else
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_DEBOUNCE, 1 << gpio);
+	return wm8350_reg_update_bits(wm8350, reg, mask, set ? mask : 0);
 }
 
-static int gpio_set_func(struct wm8350 *wm8350, int gpio, int func)
+static int gpio_set_func(struct wm8350 *wm8350, u16 mask, int func)
 {
-	u16 reg;
+	u16 fn_mask[4] = { 0 };
+	u16 fn_val[4] = { 0 };
+	int gpio, i, ret = 0;
 
-	wm8350_reg_unlock(wm8350);
-	switch (gpio) {
-	case 0:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_1)
-		    & ~WM8350_GP0_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_1,
-				 reg | ((func & 0xf) << 0));
-		break;
-	case 1:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_1)
-		    & ~WM8350_GP1_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_1,
-				 reg | ((func & 0xf) << 4));
-		break;
-	case 2:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_1)
-		    & ~WM8350_GP2_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_1,
-				 reg | ((func & 0xf) << 8));
-		break;
-	case 3:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_1)
-		    & ~WM8350_GP3_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_1,
-				 reg | ((func & 0xf) << 12));
-		break;
-	case 4:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_2)
-		    & ~WM8350_GP4_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_2,
-				 reg | ((func & 0xf) << 0));
-		break;
-	case 5:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_2)
-		    & ~WM8350_GP5_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_2,
-				 reg | ((func & 0xf) << 4));
-		break;
-	case 6:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_2)
-		    & ~WM8350_GP6_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_2,
-				 reg | ((func & 0xf) << 8));
-		break;
-	case 7:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_2)
-		    & ~WM8350_GP7_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_2,
-				 reg | ((func & 0xf) << 12));
-		break;
-	case 8:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_3)
-		    & ~WM8350_GP8_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_3,
-				 reg | ((func & 0xf) << 0));
-		break;
-	case 9:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_3)
-		    & ~WM8350_GP9_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_3,
-				 reg | ((func & 0xf) << 4));
-		break;
-	case 10:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_3)
-		    & ~WM8350_GP10_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_3,
-				 reg | ((func & 0xf) << 8));
-		break;
-	case 11:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_3)
-		    & ~WM8350_GP11_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_3,
-				 reg | ((func & 0xf) << 12));
-		break;
-	case 12:
-		reg = wm8350_reg_read(wm8350, WM8350_GPIO_FUNCTION_SELECT_4)
-		    & ~WM8350_GP12_FN_MASK;
-		wm8350_reg_write(wm8350, WM8350_GPIO_FUNCTION_SELECT_4,
-				 reg | ((func & 0xf) << 0));
-		break;
-	default:
-		wm8350_reg_lock(wm8350);
-		return -EINVAL;
+	for (gpio = 0; gpio < WM8350_NUM_GPIO; gpio++) {
+		if (!(mask & (1 << gpio)))
+			continue;
+		fn_mask[gpio / 4] |= 0xf << ((gpio % 4) * 4);
+		fn_val[gpio / 4] |= (func & 0xf) << ((gpio % 4) * 4);
 	}
 
+	wm8350_reg_unlock(wm8350);
+	for (i = 0; i < ARRAY_SIZE(fn_mask) && !ret; i++) {
+		if (!fn_mask[i])
+			continue;
+		ret = wm8350_reg_update_bits(wm8350,
+					     WM8350_GPIO_FUNCTION_SELECT_1 + i,
+					     fn_mask[i], fn_val[i]);
+	}
 	wm8350_reg_lock(wm8350);
-	return 0;
-}
-
-static int gpio_set_pull_up(struct wm8350 *wm8350, int gpio, int up)
-{
-	if (up)
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_PIN_PULL_UP_CONTROL,
-				       1 << gpio);
-	else
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_PIN_PULL_UP_CONTROL,
-					 1 << gpio);
-}
 
-static int gpio_set_pull_down(struct wm8350 *wm8350, int gpio, int down)
-{
-	if (down)
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_PULL_DOWN_CONTROL,
-				       1 << gpio);
-	else
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_PULL_DOWN_CONTROL,
-					 1 << gpio);
+	return ret;
 }
 
-static int gpio_set_polarity(struct wm8350 *wm8350, int gpio, int pol)
+/**
+ * wm8350_gpio_config_mask - configure several GPIOs the same way
+ *
+ * @wm8350: The WM8350 device
+ * @mask: Bitmask of the GPIOs to configure
+ *
+ * The remaining arguments are as for wm8350_gpio_config().  Each
+ * configuration register is only read and written once, whatever
+ * the number of GPIOs in @mask.
+ */
+int wm8350_gpio_config_mask(struct wm8350 *wm8350, u16 mask, int dir,
+			    int func, int pol, int pull, int invert,
+			    int debounce)
 {
-	if (pol == WM8350_GPIO_ACTIVE_HIGH)
-		return wm8350_set_bits(wm8350,
-				       WM8350_GPIO_PIN_POLARITY_TYPE,
-				       1 << gpio);
-	else
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_PIN_POLARITY_TYPE,
-					 1 << gpio);
-}
+	int ret;
 
-static int gpio_set_invert(struct wm8350 *wm8350, int gpio, int invert)
-{
-	if (invert == WM8350_GPIO_INVERT_ON)
-		return wm8350_set_bits(wm8350, WM8350_GPIO_INT_MODE, 1 << gpio);
-	else
-		return wm8350_clear_bits(wm8350,
-					 WM8350_GPIO_INT_MODE, 1 << gpio);
-}
+	if (!mask || mask & ~((1 << WM8350_NUM_GPIO) - 1))
+		return -EINVAL;
 
-int wm8350_gpio_config(struct wm8350 *wm8350, int gpio, int dir, int func,
-		       int pol, int pull, int invert, int debounce)
-{
 	/* make sure we never pull up and down at the same time */
 	if (pull == WM8350_GPIO_PULL_NONE) {
-		if (gpio_set_pull_up(wm8350, gpio, 0))
+		if (gpio_update(wm8350, WM8350_GPIO_PIN_PULL_UP_CONTROL,
+				mask, 0))
 			goto err;
-		if (gpio_set_pull_down(wm8350, gpio, 0))
+		if (gpio_update(wm8350, WM8350_GPIO_PULL_DOWN_CONTROL,
+				mask, 0))
 			goto err;
 	} else if (pull == WM8350_GPIO_PULL_UP) {
-		if (gpio_set_pull_down(wm8350, gpio, 0))
+		if (gpio_update(wm8350, WM8350_GPIO_PULL_DOWN_CONTROL,
+				mask, 0))
 			goto err;
-		if (gpio_set_pull_up(wm8350, gpio, 1))
+		if (gpio_update(wm8350, WM8350_GPIO_PIN_PULL_UP_CONTROL,
+				mask, 1))
 			goto err;
 	} else if (pull == WM8350_GPIO_PULL_DOWN) {
-		if (gpio_set_pull_up(wm8350, gpio, 0))
+		if (gpio_update(wm8350, WM8350_GPIO_PIN_PULL_UP_CONTROL,
+				mask, 0))
 			goto err;
-		if (gpio_set_pull_down(wm8350, gpio, 1))
+		if (gpio_update(wm8350, WM8350_GPIO_PULL_DOWN_CONTROL,
+				mask, 1))
 			goto err;
 	}
 
-	if (gpio_set_invert(wm8350, gpio, invert))
+	if (gpio_update(wm8350, WM8350_GPIO_INT_MODE, mask,
+			invert == WM8350_GPIO_INVERT_ON))
 		goto err;
-	if (gpio_set_polarity(wm8350, gpio, pol))
+	if (gpio_update(wm8350, WM8350_GPIO_PIN_POLARITY_TYPE, mask,
+			pol == WM8350_GPIO_ACTIVE_HIGH))
 		goto err;
-	if (gpio_set_debounce(wm8350, gpio, debounce))
+	if (gpio_update(wm8350, WM8350_GPIO_DEBOUNCE, mask,
+			debounce == WM8350_GPIO_DEBOUNCE_ON))
 		goto err;
-	if (gpio_set_dir(wm8350, gpio, dir))
+
+	wm8350_reg_unlock(wm8350);
+	ret = gpio_update(wm8350, WM8350_GPIO_CONFIGURATION_I_O, mask,
+			  dir != WM8350_GPIO_DIR_OUT);
+	wm8350_reg_lock(wm8350);
+	if (ret)
 		goto err;
-	return gpio_set_func(wm8350, gpio, func);
+
+	return gpio_set_func(wm8350, mask, func);
 
 err:
 	return -EIO;
 }
+EXPORT_SYMBOL_GPL(wm8350_gpio_config_mask);
+
+int wm8350_gpio_config(struct wm8350 *wm8350, int gpio, int dir, int func,
+		       int pol, int pull, int invert, int debounce)
+{
+	if (gpio < 0 || gpio >= WM8350_NUM_GPIO)
+		return -EINVAL;
+
+	return wm8350_gpio_config_mask(wm8350, 1 << gpio, dir, func, pol,
+				       pull, invert, debounce);
+}
 EXPORT_SYMBOL_GPL(wm8350_gpio_config);
@@ -25,32 +25,87 @@
 static int wm8350_i2c_read_device(struct wm8350 *wm8350, char reg,
 				  int bytes, void *dest)
 {
+	struct i2c_client *i2c = wm8350->i2c_client;
+	struct i2c_msg xfer[2];
 	int ret;
 
-	ret = i2c_master_send(wm8350->i2c_client, &reg, 1);
-	if (ret < 0)
-		return ret;
-	ret = i2c_master_recv(wm8350->i2c_client, dest, bytes);
+	/* address and data in one transfer with a repeated start so
+	 * nothing else on the bus can come in between
+	 */
+	xfer[0].addr = i2c->addr;
+	xfer[0].flags = 0;
+	xfer[0].len = 1;
+	xfer[0].buf = (u8 *)&reg;
+
+	xfer[1].addr = i2c->addr;
+	xfer[1].flags = I2C_M_RD;
+	xfer[1].len = bytes;
+	xfer[1].buf = dest;
+
+	ret = i2c_transfer(i2c->adapter, xfer, 2);
 	if (ret < 0)
 		return ret;
-	if (ret != bytes)
+	if (ret != 2)
 		return -EIO;
 	return 0;
 }
 
+/* writes of up to this many bytes are assembled on the stack */
+#define WM8350_I2C_SMALL_WRITE	8
+
 static int wm8350_i2c_write_device(struct wm8350 *wm8350, char reg,
 				   int bytes, void *src)
 {
-	/* we add 1 byte for device register */
-	u8 msg[(WM8350_MAX_REGISTER << 1) + 1];
+	struct i2c_client *i2c = wm8350->i2c_client;
+	struct i2c_msg xfer[2];
+	u8 small[WM8350_I2C_SMALL_WRITE + 1];
+	u8 *msg;
 	int ret;
 
-	if (bytes > ((WM8350_MAX_REGISTER << 1) + 1))
+	if (bytes > ((WM8350_MAX_REGISTER + 1) << 1))
 		return -EINVAL;
 
+	/* Adapters which can continue a message without a new start
+	 * condition can send the payload from where it already is.
+	 */
+	if (i2c_check_functionality(i2c->adapter,
+				    I2C_FUNC_PROTOCOL_MANGLING)) {
+		xfer[0].addr = i2c->addr;
+		xfer[0].flags = 0;
+		xfer[0].len = 1;
+		xfer[0].buf = (u8 *)&reg;
+
+		xfer[1].addr = i2c->addr;
+		xfer[1].flags = I2C_M_NOSTART;
+		xfer[1].len = bytes;
+		xfer[1].buf = src;
+
+		ret = i2c_transfer(i2c->adapter, xfer, 2);
+		if (ret < 0)
+			return ret;
+		if (ret != 2)
+			return -EIO;
+		return 0;
+	}
+
+	/* Otherwise the register address has to be prepended; most
+	 * writes are a single register so only block writes allocate.
+	 */
+	if (bytes <= WM8350_I2C_SMALL_WRITE) {
+		msg = small;
+	} else {
+		msg = kmalloc(bytes + 1, GFP_KERNEL);
+		if (msg == NULL)
+			return -ENOMEM;
+	}
+
 	msg[0] = reg;
 	memcpy(&msg[1], src, bytes);
-	ret = i2c_master_send(wm8350->i2c_client, msg, bytes + 1);
+	ret = i2c_master_send(i2c, msg, bytes + 1);
+
+	if (msg != small)
+		kfree(msg);
+
 	if (ret < 0)
 		return ret;
 	if (ret != bytes + 1)
@@ -97,6 +152,21 @@ static int wm8350_i2c_remove(struct i2c_client *i2c)
 	return 0;
 }
 
+#ifdef CONFIG_PM
+static int wm8350_i2c_suspend(struct i2c_client *i2c, pm_message_t state)
+{
+	return wm8350_device_suspend(i2c_get_clientdata(i2c));
+}
+
+static int wm8350_i2c_resume(struct i2c_client *i2c)
+{
+	return wm8350_device_resume(i2c_get_clientdata(i2c));
+}
+#else
+#define wm8350_i2c_suspend NULL
+#define wm8350_i2c_resume NULL
+#endif
+
 static const struct i2c_device_id wm8350_i2c_id[] = {
        { "wm8350", 0 },
        { }
@@ -111,6 +181,8 @@ static struct i2c_driver wm8350_i2c_driver = {
 	},
 	.probe = wm8350_i2c_probe,
 	.remove = wm8350_i2c_remove,
+	.suspend = wm8350_i2c_suspend,
+	.resume = wm8350_i2c_resume,
 	.id_table = wm8350_i2c_id,
 };
 
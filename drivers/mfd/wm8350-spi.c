@@ -0,0 +1,190 @@
+/*
+ * wm8350-spi.c  --  Generic SPI driver for Wolfson WM8350 PMIC
+ *
+ * Copyright 2008 Wolfson Microelectronics PLC.
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/device.h>
+#include <linux/spi/spi.h>
+#include <linux/mfd/wm8350/core.h>
+
+/*
+ * Each transfer starts with a two byte header giving the direction and
+ * the first register.  The device auto-increments the register address
+ * so a block of registers is one burst.  Callers pass buffers on the
+ * stack, which the SPI controller may not be able to DMA from, so the
+ * header and payload go through a bounce buffer big enough for the
+ * whole register map.  All bus access is under io_mutex so one buffer
+ * per device is enough.
+ */
+#define WM8350_SPI_READ		0x80
+#define WM8350_SPI_HEADER	2
+#define WM8350_SPI_BUF_SIZE	(WM8350_SPI_HEADER + \
+				 (WM8350_MAX_REGISTER + 1) * 2)
+
+struct wm8350_spi {
+	struct wm8350 wm8350;
+	u8 *buf;		/* kmalloc()ed so DMA safe */
+};
+
+static int wm8350_spi_transfer(struct wm8350 *wm8350, u8 cmd, char reg,
+			       int bytes, void *tx, void *rx)
+{
+	struct wm8350_spi *wm_spi = container_of(wm8350, struct wm8350_spi,
+						 wm8350);
+	u8 *buf = wm_spi->buf;
+	struct spi_transfer t[2];
+	struct spi_message m;
+	int ret;
+
+	if (bytes > WM8350_SPI_BUF_SIZE - WM8350_SPI_HEADER)
+		return -EINVAL;
+
+	buf[0] = cmd;
+	buf[1] = reg;
+	if (tx)
+		memcpy(buf + WM8350_SPI_HEADER, tx, bytes);
+
+	spi_message_init(&m);
+	memset(t, 0, sizeof(t));
+
+	if (rx) {
+		/* the payload comes back after the header */
+		t[0].tx_buf = buf;
+		t[0].len = WM8350_SPI_HEADER;
+		spi_message_add_tail(&t[0], &m);
+
+		t[1].rx_buf = buf + WM8350_SPI_HEADER;
+		t[1].len = bytes;
+		spi_message_add_tail(&t[1], &m);
+	} else {
+		t[0].tx_buf = buf;
+		t[0].len = WM8350_SPI_HEADER + bytes;
+		spi_message_add_tail(&t[0], &m);
+	}
+
+	ret = spi_sync(wm8350->spi_device, &m);
+	if (ret == 0 && rx)
+		memcpy(rx, buf + WM8350_SPI_HEADER, bytes);
+
+	return ret;
+}
+
+static int wm8350_spi_read_device(struct wm8350 *wm8350, char reg,
+				  int bytes, void *dest)
+{
+	return wm8350_spi_transfer(wm8350, WM8350_SPI_READ, reg, bytes,
+				   NULL, dest);
+}
+
+static int wm8350_spi_write_device(struct wm8350 *wm8350, char reg,
+				   int bytes, void *src)
+{
+	return wm8350_spi_transfer(wm8350, 0, reg, bytes, src, NULL);
+}
+
+static int __devinit wm8350_spi_probe(struct spi_device *spi)
+{
+	struct wm8350_spi *wm_spi;
+	struct wm8350 *wm8350;
+	int ret;
+
+	spi->bits_per_word = 8;
+	ret = spi_setup(spi);
+	if (ret < 0)
+		return ret;
+
+	wm_spi = kzalloc(sizeof(struct wm8350_spi), GFP_KERNEL);
+	if (wm_spi == NULL)
+		return -ENOMEM;
+	wm8350 = &wm_spi->wm8350;
+
+	wm_spi->buf = kmalloc(WM8350_SPI_BUF_SIZE, GFP_KERNEL);
+	if (wm_spi->buf == NULL) {
+		kfree(wm_spi);
+		return -ENOMEM;
+	}
+
+	dev_set_drvdata(&spi->dev, wm8350);
+	wm8350->dev = &spi->dev;
+	wm8350->spi_device = spi;
+	wm8350->read_dev = wm8350_spi_read_device;
+	wm8350->write_dev = wm8350_spi_write_device;
+
+	ret = wm8350_device_init(wm8350, spi->irq, spi->dev.platform_data);
+	if (ret < 0)
+		goto err;
+
+	return ret;
+
+err:
+	dev_set_drvdata(&spi->dev, NULL);
+	kfree(wm_spi->buf);
+	kfree(wm_spi);
+	return ret;
+}
+
+static int __devexit wm8350_spi_remove(struct spi_device *spi)
+{
+	struct wm8350 *wm8350 = dev_get_drvdata(&spi->dev);
+	struct wm8350_spi *wm_spi = container_of(wm8350, struct wm8350_spi,
+						 wm8350);
+
+	wm8350_device_exit(wm8350);
+	kfree(wm_spi->buf);
+	kfree(wm_spi);
+
+	return 0;
+}
+
+#ifdef CONFIG_PM
+static int wm8350_spi_suspend(struct spi_device *spi, pm_message_t state)
+{
+	return wm8350_device_suspend(dev_get_drvdata(&spi->dev));
+}
+
+static int wm8350_spi_resume(struct spi_device *spi)
+{
+	return wm8350_device_resume(dev_get_drvdata(&spi->dev));
+}
+#else
+#define wm8350_spi_suspend NULL
+#define wm8350_spi_resume NULL
+#endif
+
+static struct spi_driver wm8350_spi_driver = {
+	.driver = {
+		   .name = "wm8350",
+		   .bus = &spi_bus_type,
+		   .owner = THIS_MODULE,
+	},
+	.probe = wm8350_spi_probe,
+	.remove = __devexit_p(wm8350_spi_remove),
+	.suspend = wm8350_spi_suspend,
+	.resume = wm8350_spi_resume,
+};
+
+static int __init wm8350_spi_init(void)
+{
+	return spi_register_driver(&wm8350_spi_driver);
+}
+/* init early so consumer devices can complete system boot */
+subsys_initcall(wm8350_spi_init);
+
+static void __exit wm8350_spi_exit(void)
+{
+	spi_unregister_driver(&wm8350_spi_driver);
+}
+module_exit(wm8350_spi_exit);
+
+MODULE_DESCRIPTION("SPI support for the WM8350 AudioPlus PMIC");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("spi:wm8350");
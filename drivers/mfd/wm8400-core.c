@@ -13,10 +13,13 @@
  */
 
 #include <linux/bug.h>
+#include <linux/hrtimer.h>
 #include <linux/i2c.h>
 #include <linux/kernel.h>
+#include <linux/mfd/regcache.h>
 #include <linux/mfd/wm8400-private.h>
 #include <linux/mfd/wm8400-audio.h>
+#include <trace/mfd.h>
 
 static struct {
 	u16  readable;    /* Mask of readable bits */
@@ -112,8 +115,36 @@ static struct {
 	{ 0x80FF, 0x80FF, 0x0000, 0, 0x00ff }, /* R84 */
 };
 
+static inline ktime_t wm8400_trace_start(void)
+{
+	return mfd_reg_trace_enabled() ? ktime_get() : ktime_set(0, 0);
+}
+
+static void wm8400_trace(struct wm8400 *wm8400, int write, u8 reg,
+			 int num_regs, const u16 *vals, int cached,
+			 ktime_t start)
+{
+	s64 ns;
+	int i;
+
+	if (!mfd_reg_trace_enabled() || !ktime_to_ns(start))
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	for (i = 0; i < num_regs; i++) {
+		if (write)
+			trace_mfd_reg_write(wm8400->dev, reg + i,
+					    wm8400->reg_cache[reg + i],
+					    cached, ns);
+		else
+			trace_mfd_reg_read(wm8400->dev, reg + i, vals[i],
+					   cached, ns);
+	}
+}
+
 static int wm8400_read(struct wm8400 *wm8400, u8 reg, int num_regs, u16 *dest)
 {
+	ktime_t start = wm8400_trace_start();
 	int i, ret = 0;
 
 	BUG_ON(reg + num_regs - 1 > ARRAY_SIZE(wm8400->reg_cache));
@@ -128,11 +159,13 @@ static int wm8400_read(struct wm8400 *wm8400, u8 reg, int num_regs, u16 *dest)
 			for (i = 0; i < num_regs; i++)
 				dest[i] = be16_to_cpu(dest[i]);
 
+			wm8400_trace(wm8400, 0, reg, num_regs, dest, 0, start);
 			return 0;
 		}
 
 	/* Otherwise use the cache */
 	memcpy(dest, &wm8400->reg_cache[reg], num_regs * sizeof(u16));
+	wm8400_trace(wm8400, 0, reg, num_regs, dest, 1, start);
 
 	return 0;
 }
@@ -140,6 +173,7 @@ static int wm8400_read(struct wm8400 *wm8400, u8 reg, int num_regs, u16 *dest)
 static int wm8400_write(struct wm8400 *wm8400, u8 reg, int num_regs,
 			u16 *src)
 {
+	ktime_t start = wm8400_trace_start();
 	int ret, i;
 
 	BUG_ON(reg + num_regs - 1 > ARRAY_SIZE(wm8400->reg_cache));
@@ -155,6 +189,8 @@ static int wm8400_write(struct wm8400 *wm8400, u8 reg, int num_regs,
 	if (ret != 0)
 		return -EIO;
 
+	wm8400_trace(wm8400, 1, reg, num_regs, NULL, 0, start);
+
 	return 0;
 }
 
@@ -194,30 +230,118 @@ int wm8400_block_read(struct wm8400 *wm8400, u8 reg, int count, u16 *data)
 }
 EXPORT_SYMBOL_GPL(wm8400_block_read);
 
+static int wm8400_sync_block(void *data, unsigned int reg,
+			     unsigned int count)
+{
+	struct wm8400 *wm8400 = data;
+	u16 buf[WM8400_REGISTER_COUNT];
+
+	memcpy(buf, &wm8400->reg_cache[reg], count * sizeof(u16));
+
+	return wm8400_write(wm8400, reg, count, buf);
+}
+
+/* Write back dirty registers, each run of adjacent registers in a
+ * single transfer.  Registers which fail to write stay dirty. */
+static int wm8400_sync(struct wm8400 *wm8400)
+{
+	return mfd_regcache_sync(wm8400->reg_dirty, WM8400_REGISTER_COUNT,
+				 WM8400_REGISTER_COUNT, wm8400_sync_block,
+				 wm8400);
+}
+
 /**
- * wm8400_set_bits - Bitmask write
+ * wm8400_reg_lock - Start a batch of register updates
+ *
+ * @wm8400: Pointer to wm8400 control structure
+ *
+ * Until wm8400_reg_unlock() is called updates made with
+ * __wm8400_set_bits() are only made in the register cache, other
+ * users of the device waiting until they have been written back.
+ */
+void wm8400_reg_lock(struct wm8400 *wm8400)
+{
+	mutex_lock(&wm8400->io_lock);
+}
+EXPORT_SYMBOL_GPL(wm8400_reg_lock);
+
+/**
+ * __wm8400_set_bits - Bitmask write within a batch
  *
  * @wm8400: Pointer to wm8400 control structure
  * @reg:    Register to access
  * @mask:   Mask of bits to change
  * @val:    Value to set for masked bits
+ *
+ * Must be called between wm8400_reg_lock() and wm8400_reg_unlock().
+ * The register is only marked for writing back if its value changes.
  */
-int wm8400_set_bits(struct wm8400 *wm8400, u8 reg, u16 mask, u16 val)
+int __wm8400_set_bits(struct wm8400 *wm8400, u8 reg, u16 mask, u16 val)
 {
-	u16 tmp;
+	u16 tmp, new;
 	int ret;
 
-	mutex_lock(&wm8400->io_lock);
+	BUG_ON(!reg_data[reg].writable);
 
 	ret = wm8400_read(wm8400, reg, 1, &tmp);
-	tmp = (tmp & ~mask) | val;
-	if (ret == 0)
-		ret = wm8400_write(wm8400, reg, 1, &tmp);
+	if (ret != 0)
+		return ret;
+
+	new = (tmp & ~mask) | val;
+	if (new == tmp && !reg_data[reg].vol)
+		return 0;
+
+	wm8400->reg_cache[reg] = new;
+	set_bit(reg, wm8400->reg_dirty);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__wm8400_set_bits);
+
+/**
+ * wm8400_reg_unlock - Finish a batch of register updates
+ *
+ * @wm8400: Pointer to wm8400 control structure
+ *
+ * Writes back every register changed since wm8400_reg_lock(), adjacent
+ * registers in a single block transfer.
+ */
+int wm8400_reg_unlock(struct wm8400 *wm8400)
+{
+	int ret;
+
+	ret = wm8400_sync(wm8400);
 
 	mutex_unlock(&wm8400->io_lock);
 
 	return ret;
 }
+EXPORT_SYMBOL_GPL(wm8400_reg_unlock);
+
+/**
+ * wm8400_set_bits - Bitmask write
+ *
+ * @wm8400: Pointer to wm8400 control structure
+ * @reg:    Register to access
+ * @mask:   Mask of bits to change
+ * @val:    Value to set for masked bits
+ *
+ * The write is skipped if it would not change the register.
+ */
+int wm8400_set_bits(struct wm8400 *wm8400, u8 reg, u16 mask, u16 val)
+{
+	int ret;
+
+	wm8400_reg_lock(wm8400);
+
+	ret = __wm8400_set_bits(wm8400, reg, mask, val);
+	if (ret != 0) {
+		mutex_unlock(&wm8400->io_lock);
+		return ret;
+	}
+
+	return wm8400_reg_unlock(wm8400);
+}
 EXPORT_SYMBOL_GPL(wm8400_set_bits);
 
 /**
@@ -232,13 +356,63 @@ void wm8400_reset_codec_reg_cache(struct wm8400 *wm8400)
 
 	/* Reset all codec registers to their initial value */
 	for (i = 0; i < ARRAY_SIZE(wm8400->reg_cache); i++)
-		if (reg_data[i].is_codec)
+		if (reg_data[i].is_codec) {
 			wm8400->reg_cache[i] = reg_data[i].default_val;
+			clear_bit(i, wm8400->reg_dirty);
+		}
 
 	mutex_unlock(&wm8400->io_lock);
 }
 EXPORT_SYMBOL_GPL(wm8400_reset_codec_reg_cache);
 
+/* debugfs register snapshot */
+static int wm8400_dump_readable(void *data, unsigned int reg)
+{
+	return reg_data[reg].readable != 0;
+}
+
+static int wm8400_dump_cached(void *data, unsigned int reg, unsigned int *val)
+{
+	struct wm8400 *wm8400 = data;
+
+	if (reg_data[reg].vol)
+		return 0;
+
+	*val = wm8400->reg_cache[reg];
+	return 1;
+}
+
+static int wm8400_dump_read(void *data, unsigned int reg, unsigned int count,
+			    unsigned int *vals)
+{
+	struct wm8400 *wm8400 = data;
+	u16 buf[WM8400_REGISTER_COUNT];
+	int i, ret;
+
+	ret = wm8400->read_dev(wm8400->io_data, reg, count, buf);
+	if (ret != 0)
+		return ret;
+
+	for (i = 0; i < count; i++)
+		vals[i] = be16_to_cpu(buf[i]);
+
+	return 0;
+}
+
+static void wm8400_dump_lock(void *data)
+{
+	struct wm8400 *wm8400 = data;
+
+	mutex_lock(&wm8400->io_lock);
+}
+
+static void wm8400_dump_unlock(void *data)
+{
+	struct wm8400 *wm8400 = data;
+
+	mutex_unlock(&wm8400->io_lock);
+}
+
 /*
  * wm8400_init - Generic initialisation
  *
@@ -304,6 +478,20 @@ static int wm8400_init(struct wm8400 *wm8400,
 	} else
 		dev_warn(wm8400->dev, "No platform initialisation supplied\n");
 
+	if (ret == 0) {
+		wm8400->regdump.num_regs = WM8400_REGISTER_COUNT;
+		wm8400->regdump.max_block = WM8400_REGISTER_COUNT;
+		wm8400->regdump.reg_digits = 2;
+		wm8400->regdump.val_digits = 4;
+		wm8400->regdump.readable = wm8400_dump_readable;
+		wm8400->regdump.cached = wm8400_dump_cached;
+		wm8400->regdump.read = wm8400_dump_read;
+		wm8400->regdump.lock = wm8400_dump_lock;
+		wm8400->regdump.unlock = wm8400_dump_unlock;
+		wm8400->regdump.data = wm8400;
+		mfd_regdump_add(&wm8400->regdump, wm8400->dev);
+	}
+
 	return ret;
 }
 
@@ -311,6 +499,8 @@ static void wm8400_release(struct wm8400 *wm8400)
 {
 	int i;
 
+	mfd_regdump_remove(&wm8400->regdump);
+
 	for (i = 0; i < ARRAY_SIZE(wm8400->regulators); i++)
 		if (wm8400->regulators[i].name)
 			platform_device_unregister(&wm8400->regulators[i]);
@@ -20,6 +20,8 @@
 #include <linux/err.h>
 #include <linux/leds.h>
 #include <linux/scatterlist.h>
+#include <linux/log2.h>
+#include <linux/regulator/consumer.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -473,6 +475,114 @@ u32 mmc_select_voltage(struct mmc_host *host, u32 ocr)
 	return ocr;
 }
 
+#ifdef CONFIG_REGULATOR
+
+/* the OCR bit whose range holds vdd_mV, or -EINVAL */
+static int mmc_vdd_to_ocrbitnum(int vdd_mV)
+{
+	if (vdd_mV < 1650 || vdd_mV > 3600)
+		return -EINVAL;
+
+	if (vdd_mV <= 1950)
+		return ilog2(MMC_VDD_165_195);
+
+	/* 2.0V upwards in 100mV steps from bit 8, 3.6V in the top bit */
+	if (vdd_mV < 2000)
+		return -EINVAL;
+	return min((vdd_mV - 2000) / 100 + 8, ilog2(MMC_VDD_35_36));
+}
+
+/**
+ * mmc_regulator_get_ocrmask - return the OCR mask a regulator can supply
+ * @supply: regulator to use
+ *
+ * Every voltage the regulator can be set to, as reported through
+ * regulator_list_voltage(), contributes the OCR bit covering it.  The
+ * result is suitable for mmc->ocr_avail.  Returns a negative errno if
+ * the voltages can't be listed.
+ */
+int mmc_regulator_get_ocrmask(struct regulator *supply)
+{
+	int result = 0;
+	int count, i, bit;
+
+	count = regulator_count_voltages(supply);
+	if (count < 0)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		int vdd_uV = regulator_list_voltage(supply, i);
+
+		if (vdd_uV <= 0)
+			continue;
+
+		bit = mmc_vdd_to_ocrbitnum(vdd_uV / 1000);
+		if (bit >= 0)
+			result |= 1 << bit;
+	}
+
+	return result;
+}
+EXPORT_SYMBOL(mmc_regulator_get_ocrmask);
+
+/**
+ * mmc_regulator_set_ocr - set the slot supply for an OCR bit
+ * @host: host the supply belongs to
+ * @supply: slot supply regulator
+ * @vdd_bit: OCR bit number from ios->vdd, zero for power off
+ *
+ * For use from a host's set_ios().  The supply is set to the range of
+ * @vdd_bit and enabled, or disabled when @vdd_bit is zero, which the
+ * core asks for whenever there is no card in the slot.  The voltage is
+ * only changed when the bit differs from the last one set and the
+ * supply isn't already within its range, so repeated power-ups at the
+ * same voltage cost no regulator calls.
+ */
+int mmc_regulator_set_ocr(struct mmc_host *host, struct regulator *supply,
+			  unsigned short vdd_bit)
+{
+	int min_uV, max_uV, voltage;
+	int ret = 0;
+
+	if (!vdd_bit) {
+		if (host->regulator_on) {
+			ret = regulator_disable(supply);
+			if (ret == 0)
+				host->regulator_on = 0;
+		}
+		return ret;
+	}
+
+	if (vdd_bit != host->regulator_vdd) {
+		if (vdd_bit == ilog2(MMC_VDD_165_195)) {
+			min_uV = 1650 * 1000;
+			max_uV = 1950 * 1000;
+		} else {
+			min_uV = 2000 * 1000 + (vdd_bit - 8) * 100 * 1000;
+			max_uV = min_uV + 100 * 1000;
+		}
+
+		/* the regulator may not allow changes we don't need */
+		voltage = regulator_get_voltage(supply);
+		if (voltage < min_uV || voltage > max_uV)
+			ret = regulator_set_voltage(supply, min_uV, max_uV);
+		if (ret != 0)
+			return ret;
+		host->regulator_vdd = vdd_bit;
+	}
+
+	if (!host->regulator_on) {
+		ret = regulator_enable(supply);
+		if (ret == 0)
+			host->regulator_on = 1;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(mmc_regulator_set_ocr);
+
+#endif /* CONFIG_REGULATOR */
+
 /*
  * Select timing parameters for host.
  */
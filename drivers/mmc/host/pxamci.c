@@ -26,6 +26,7 @@
 #include <linux/clk.h>
 #include <linux/err.h>
 #include <linux/mmc/host.h>
+#include <linux/regulator/consumer.h>
 
 #include <asm/dma.h>
 #include <asm/io.h>
@@ -55,6 +56,7 @@ struct pxamci_host {
 	unsigned int		imask;
 	unsigned int		power_mode;
 	struct pxamci_platform_data *pdata;
+	struct regulator	*vcc;		/* slot supply, if any */
 
 	struct mmc_request	*mrq;
 	struct mmc_command	*cmd;
@@ -69,6 +71,41 @@ struct pxamci_host {
 	unsigned int		dma_drcmrtx;
 };
 
+/* a slot supply from the regulator API takes over from the board hooks */
+static void pxamci_init_ocr(struct pxamci_host *host)
+{
+	struct mmc_host *mmc = host->mmc;
+	int ocr;
+
+	host->vcc = regulator_get(mmc_dev(mmc), "vmmc");
+	if (IS_ERR(host->vcc)) {
+		host->vcc = NULL;
+	} else {
+		ocr = mmc_regulator_get_ocrmask(host->vcc);
+		if (ocr > 0) {
+			if (host->pdata && host->pdata->ocr_mask)
+				dev_warn(mmc_dev(mmc), "ocr_mask/setpower will "
+					 "not be used\n");
+			mmc->ocr_avail = ocr;
+			return;
+		}
+		regulator_put(host->vcc);
+		host->vcc = NULL;
+	}
+
+	mmc->ocr_avail = host->pdata ?
+			 host->pdata->ocr_mask :
+			 MMC_VDD_32_33|MMC_VDD_33_34;
+}
+
+static void pxamci_set_power(struct pxamci_host *host, unsigned int vdd)
+{
+	if (host->vcc)
+		mmc_regulator_set_ocr(host->mmc, host->vcc, vdd);
+	else if (host->pdata && host->pdata->setpower)
+		host->pdata->setpower(mmc_dev(host->mmc), vdd);
+}
+
 static void pxamci_stop_clock(struct pxamci_host *host)
 {
 	if (readl(host->base + MMC_STAT) & STAT_CLK_EN) {
@@ -425,8 +462,7 @@ static void pxamci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 	if (host->power_mode != ios->power_mode) {
 		host->power_mode = ios->power_mode;
 
-		if (host->pdata && host->pdata->setpower)
-			host->pdata->setpower(mmc_dev(mmc), ios->vdd);
+		pxamci_set_power(host, ios->vdd);
 
 		if (ios->power_mode == MMC_POWER_ON)
 			host->cmdat |= CMDAT_INIT;
@@ -549,9 +585,7 @@ static int pxamci_probe(struct platform_device *pdev)
 	mmc->f_max = (cpu_is_pxa300() || cpu_is_pxa310()) ? 26000000
 							  : host->clkrate;
 
-	mmc->ocr_avail = host->pdata ?
-			 host->pdata->ocr_mask :
-			 MMC_VDD_32_33|MMC_VDD_33_34;
+	pxamci_init_ocr(host);
 	mmc->caps = 0;
 	host->cmdat = 0;
 	if (!cpu_is_pxa25x()) {
@@ -632,6 +666,8 @@ static int pxamci_probe(struct platform_device *pdev)
 			dma_free_coherent(&pdev->dev, PAGE_SIZE, host->sg_cpu, host->sg_dma);
 		if (host->clk)
 			clk_put(host->clk);
+		if (host->vcc)
+			regulator_put(host->vcc);
 	}
 	if (mmc)
 		mmc_free_host(mmc);
@@ -667,6 +703,8 @@ static int pxamci_remove(struct platform_device *pdev)
 		dma_free_coherent(&pdev->dev, PAGE_SIZE, host->sg_cpu, host->sg_dma);
 
 		clk_put(host->clk);
+		if (host->vcc)
+			regulator_put(host->vcc);
 
 		release_resource(host->res);
 
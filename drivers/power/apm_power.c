@@ -14,11 +14,11 @@
 #include <linux/apm-emulation.h>
 
 
-#define PSY_PROP(psy, prop, val) psy->get_property(psy, \
+#define PSY_PROP(psy, prop, val) power_supply_get_property(psy, \
 			 POWER_SUPPLY_PROP_##prop, val)
 
-#define _MPSY_PROP(prop, val) main_battery->get_property(main_battery, \
-							 prop, val)
+#define _MPSY_PROP(prop, val) power_supply_get_property(main_battery, \
+							prop, val)
 
 #define MPSY_PROP(prop, val) _MPSY_PROP(POWER_SUPPLY_PROP_##prop, val)
 
@@ -34,16 +34,31 @@
 #define BQ27x00_REG_AI			0x14
 #define BQ27x00_REG_FLAGS		0x0A
 
+/*
+ * The standard commands from temperature up to average current are read
+ * as one block and kept briefly, so a sweep of every property costs a
+ * single transfer.
+ */
+#define BQ27x00_BLOCK_FIRST		BQ27x00_REG_TEMP
+#define BQ27x00_BLOCK_LEN	(BQ27x00_REG_AI + 2 - BQ27x00_BLOCK_FIRST)
+#define BQ27x00_BLOCK_CACHE_MS		100
+
 /* If the system has several batteries we need a different name for each
  * of them...
  */
 static DEFINE_IDR(battery_id);
 static DEFINE_MUTEX(battery_mutex);
 
+static unsigned int cache_time = 1000;
+module_param(cache_time, uint, 0444);
+MODULE_PARM_DESC(cache_time, "cache time in milliseconds");
+
 struct bq27x00_device_info;
 struct bq27x00_access_methods {
 	int (*read)(u8 reg, int *rt_value, int b_single,
 		struct bq27x00_device_info *di);
+	int (*read_block)(u8 reg, u8 *buf, int len,
+		struct bq27x00_device_info *di);
 };
 
 struct bq27x00_device_info {
@@ -57,6 +72,11 @@ struct bq27x00_device_info {
 	struct power_supply	bat;
 
 	struct i2c_client	*client;
+
+	struct mutex		block_lock;
+	int			block_valid;
+	unsigned long		block_time;
+	u8			block[BQ27x00_BLOCK_LEN];
 };
 
 static enum power_supply_property bq27x00_battery_props[] = {
@@ -71,13 +91,53 @@ static enum power_supply_property bq27x00_battery_props[] = {
  * Common code for BQ27x00 devices
  */
 
+/* with block_lock held */
+static int bq27x00_update_block(struct bq27x00_device_info *di)
+{
+	unsigned long expires;
+	int ret;
+
+	expires = di->block_time + msecs_to_jiffies(BQ27x00_BLOCK_CACHE_MS);
+	if (di->block_valid && time_before(jiffies, expires))
+		return 0;
+
+	ret = di->bus->read_block(BQ27x00_BLOCK_FIRST, di->block,
+				  sizeof(di->block), di);
+	if (ret) {
+		di->block_valid = 0;
+		return ret;
+	}
+
+	di->block_valid = 1;
+	di->block_time = jiffies;
+
+	return 0;
+}
+
+/*
+ * Read a byte, or a little endian word, from the gauge.  Registers in
+ * the block come from the cached copy of it.
+ */
 static int bq27x00_read(u8 reg, int *rt_value, int b_single,
 			struct bq27x00_device_info *di)
 {
+	int len = b_single ? 1 : 2;
 	int ret;
+	u8 *p;
 
-	ret = di->bus->read(reg, rt_value, b_single, di);
-	*rt_value = be16_to_cpu(*rt_value);
+	if (!di->bus->read_block || reg < BQ27x00_BLOCK_FIRST ||
+	    reg + len > BQ27x00_BLOCK_FIRST + BQ27x00_BLOCK_LEN)
+		return di->bus->read(reg, rt_value, b_single, di);
+
+	mutex_lock(&di->block_lock);
+
+	ret = bq27x00_update_block(di);
+	if (ret == 0) {
+		p = &di->block[reg - BQ27x00_BLOCK_FIRST];
+		*rt_value = b_single ? *p : get_unaligned_le16(p);
+	}
+
+	mutex_unlock(&di->block_lock);
 
 	return ret;
 }
@@ -161,7 +221,7 @@ static int bq27x00_battery_rsoc(struct bq27x00_device_info *di)
 		return ret;
 	}
 
-	return rsoc >> 8;
+	return rsoc;
 }
 
 #define to_bq27x00_device_info(x) container_of((x), \
@@ -196,12 +256,57 @@ static int bq27x00_battery_get_property(struct power_supply *psy,
 	return 0;
 }
 
+/*
+ * Read each gauge register once for a snapshot of all the properties,
+ * rather than once per property.
+ */
+static void bq27x00_battery_get_properties(struct power_supply *psy,
+					   union power_supply_propval *vals,
+					   int *rets)
+{
+	int volt, curr, rsoc, temp;
+	int i;
+	struct bq27x00_device_info *di = to_bq27x00_device_info(psy);
+
+	volt = bq27x00_battery_voltage(di);
+	curr = bq27x00_battery_current(di);
+	rsoc = bq27x00_battery_rsoc(di);
+	temp = bq27x00_battery_temperature(di);
+
+	for (i = 0; i < psy->num_properties; i++) {
+		rets[i] = 0;
+
+		switch (psy->properties[i]) {
+		case POWER_SUPPLY_PROP_PRESENT:
+			vals[i].intval = volt <= 0 ? 0 : 1;
+			break;
+		case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+			vals[i].intval = volt;
+			break;
+		case POWER_SUPPLY_PROP_CURRENT_NOW:
+			vals[i].intval = curr;
+			break;
+		case POWER_SUPPLY_PROP_CAPACITY:
+			vals[i].intval = rsoc;
+			break;
+		case POWER_SUPPLY_PROP_TEMP:
+			vals[i].intval = temp;
+			break;
+		default:
+			rets[i] = -EINVAL;
+			break;
+		}
+	}
+}
+
 static void bq27x00_powersupply_init(struct bq27x00_device_info *di)
 {
 	di->bat.type = POWER_SUPPLY_TYPE_BATTERY;
 	di->bat.properties = bq27x00_battery_props;
 	di->bat.num_properties = ARRAY_SIZE(bq27x00_battery_props);
 	di->bat.get_property = bq27x00_battery_get_property;
+	di->bat.get_properties = bq27x00_battery_get_properties;
+	di->bat.snapshot_ms = cache_time;
 	di->bat.external_power_changed = NULL;
 }
 
@@ -238,7 +343,7 @@ static int bq27200_read(u8 reg, int *rt_value, int b_single,
 		err = i2c_transfer(client->adapter, msg, 1);
 		if (err >= 0) {
 			if (!b_single)
-				*rt_value = get_unaligned_be16(data);
+				*rt_value = get_unaligned_le16(data);
 			else
 				*rt_value = data[0];
 
@@ -248,6 +353,36 @@ static int bq27200_read(u8 reg, int *rt_value, int b_single,
 	return err;
 }
 
+/* the gauge auto-increments so a block is one combined transfer */
+static int bq27200_read_block(u8 reg, u8 *buf, int len,
+			      struct bq27x00_device_info *di)
+{
+	struct i2c_client *client = di->client;
+	struct i2c_msg msg[2];
+	int err;
+
+	if (!client->adapter)
+		return -ENODEV;
+
+	msg[0].addr = client->addr;
+	msg[0].flags = 0;
+	msg[0].len = 1;
+	msg[0].buf = &reg;
+
+	msg[1].addr = client->addr;
+	msg[1].flags = I2C_M_RD;
+	msg[1].len = len;
+	msg[1].buf = buf;
+
+	err = i2c_transfer(client->adapter, msg, 2);
+	if (err < 0)
+		return err;
+	if (err != 2)
+		return -EIO;
+
+	return 0;
+}
+
 static int bq27200_battery_probe(struct i2c_client *client,
 				 const struct i2c_device_id *id)
 {
@@ -294,8 +429,10 @@ static int bq27200_battery_probe(struct i2c_client *client,
 	di->dev = &client->dev;
 	di->bat.name = name;
 	bus->read = &bq27200_read;
+	bus->read_block = &bq27200_read_block;
 	di->bus = bus;
 	di->client = client;
+	mutex_init(&di->block_lock);
 
 	bq27x00_powersupply_init(di);
 
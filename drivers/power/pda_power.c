@@ -15,8 +15,11 @@
 #include <linux/interrupt.h>
 #include <linux/power_supply.h>
 #include <linux/pda_power.h>
+#include <linux/regulator/consumer.h>
 #include <linux/timer.h>
 #include <linux/jiffies.h>
+#include <linux/workqueue.h>
+#include <linux/err.h>
 
 static inline unsigned int get_irq_flags(struct resource *res)
 {
@@ -30,10 +33,17 @@ static inline unsigned int get_irq_flags(struct resource *res)
 static struct device *dev;
 static struct pda_power_pdata *pdata;
 static struct resource *ac_irq, *usb_irq;
-static struct timer_list charger_timer;
-static struct timer_list supply_timer;
-static struct timer_list polling_timer;
+static struct delayed_work charger_work;
+static struct delayed_work supply_work;
+static struct delayed_work polling_work;
 static int polling;
+static unsigned int polling_delay;
+
+static struct regulator *charger;
+static int charger_enabled;
+static struct notifier_block charger_nb;
+/* current the USB host has granted us; 100mA until we're configured */
+static int usb_draw_uA = 100000;
 
 enum {
 	PDA_PSY_OFFLINE = 0,
@@ -102,8 +112,44 @@ static void update_status(void)
 		new_usb_status = !!pdata->is_usb_online();
 }
 
+static void update_regulator(void)
+{
+	int min_uA = 0, max_uA = 0;
+
+	if (new_ac_status > 0) {
+		/* no ac_max_uA means as much as the constraints allow */
+		if (pdata->ac_max_uA) {
+			min_uA = pdata->ac_max_uA;
+			max_uA = pdata->ac_max_uA;
+		} else {
+			max_uA = INT_MAX;
+		}
+	} else if (new_usb_status > 0) {
+		min_uA = usb_draw_uA;
+		max_uA = usb_draw_uA;
+	} else {
+		usb_draw_uA = 100000;
+	}
+
+	if (max_uA > 0) {
+		dev_dbg(dev, "charger on, %d-%d uA\n", min_uA, max_uA);
+		regulator_set_current_limit(charger, min_uA, max_uA);
+		if (!charger_enabled && regulator_enable(charger) == 0)
+			charger_enabled = 1;
+	} else if (charger_enabled) {
+		dev_dbg(dev, "charger off\n");
+		regulator_disable(charger);
+		charger_enabled = 0;
+	}
+}
+
 static void update_charger(void)
 {
+	if (charger) {
+		update_regulator();
+		return;
+	}
+
 	if (!pdata->set_charge)
 		return;
 
@@ -119,7 +165,7 @@ static void update_charger(void)
 	}
 }
 
-static void supply_timer_func(unsigned long unused)
+static void supply_work_func(struct work_struct *work)
 {
 	if (ac_status == PDA_PSY_TO_CHANGE) {
 		ac_status = new_ac_status;
@@ -134,22 +180,86 @@ static void supply_timer_func(unsigned long unused)
 
 static void psy_changed(void)
 {
+	/* poll quickly again for a while after a transition */
+	polling_delay = pdata->polling_interval;
+
 	update_charger();
 
 	/*
 	 * Okay, charger set. Now wait a bit before notifying supplicants,
 	 * charge power should stabilize.
 	 */
-	mod_timer(&supply_timer,
-		  jiffies + msecs_to_jiffies(pdata->wait_for_charger));
+	cancel_delayed_work(&supply_work);
+	schedule_delayed_work(&supply_work,
+			      msecs_to_jiffies(pdata->wait_for_charger));
 }
 
-static void charger_timer_func(unsigned long unused)
+static void charger_work_func(struct work_struct *work)
 {
 	update_status();
 	psy_changed();
 }
 
+/**
+ * pda_power_usb_draw - report the current negotiated with the USB host
+ * @mA: current granted by the host, as passed to the gadget's vbus_draw()
+ *
+ * Boards charging through a regulator should call this from their UDC
+ * glue whenever the gadget is configured, suspended or reset so the
+ * charger input current tracks enumeration.  A USB connection starts out
+ * at 100mA; a draw of less than that stops charging from USB.  May be
+ * called from atomic context.
+ */
+void pda_power_usb_draw(unsigned int mA)
+{
+	usb_draw_uA = mA * 1000;
+
+	if (!pdata || !charger)
+		return;
+
+	cancel_delayed_work(&charger_work);
+	schedule_delayed_work(&charger_work, 0);
+}
+EXPORT_SYMBOL_GPL(pda_power_usb_draw);
+
+/**
+ * pda_power_changed - report a change of AC or USB status
+ *
+ * For boards setting status_events in their platform data, which
+ * detect supply changes by other means (a PMIC charger interrupt, say)
+ * rather than through interrupts given to this driver.  May be called
+ * from atomic context.
+ */
+void pda_power_changed(void)
+{
+	if (!pdata)
+		return;
+
+	if (pdata->is_ac_online)
+		ac_status = PDA_PSY_TO_CHANGE;
+	if (pdata->is_usb_online)
+		usb_status = PDA_PSY_TO_CHANGE;
+
+	cancel_delayed_work(&charger_work);
+	schedule_delayed_work(&charger_work,
+			      msecs_to_jiffies(pdata->wait_for_status));
+}
+EXPORT_SYMBOL_GPL(pda_power_changed);
+
+/*
+ * Charger regulator events (failure, loss of input) usually mean the
+ * supply has gone, recheck the status.
+ */
+static int charger_notify(struct notifier_block *nb, unsigned long event,
+			  void *data)
+{
+	if (event & (REGULATOR_EVENT_UNDER_VOLTAGE | REGULATOR_EVENT_FAIL |
+		     REGULATOR_EVENT_FORCE_DISABLE))
+		pda_power_changed();
+
+	return NOTIFY_OK;
+}
+
 static irqreturn_t power_changed_isr(int irq, void *power_supply)
 {
 	if (power_supply == &pda_psy_ac)
@@ -163,13 +273,14 @@ static irqreturn_t power_changed_isr(int irq, void *power_supply)
 	 * Wait a bit before reading ac/usb line status and setting charger,
 	 * because ac/usb status readings may lag from irq.
 	 */
-	mod_timer(&charger_timer,
-		  jiffies + msecs_to_jiffies(pdata->wait_for_status));
+	cancel_delayed_work(&charger_work);
+	schedule_delayed_work(&charger_work,
+			      msecs_to_jiffies(pdata->wait_for_status));
 
 	return IRQ_HANDLED;
 }
 
-static void polling_timer_func(unsigned long unused)
+static void polling_work_func(struct work_struct *work)
 {
 	int changed = 0;
 
@@ -189,9 +300,12 @@ static void polling_timer_func(unsigned long unused)
 
 	if (changed)
 		psy_changed();
+	else if (polling_delay < pdata->polling_max_interval)
+		/* stable, back off */
+		polling_delay = min(polling_delay * 2,
+				    pdata->polling_max_interval);
 
-	mod_timer(&polling_timer,
-		  jiffies + msecs_to_jiffies(pdata->polling_interval));
+	schedule_delayed_work(&polling_work, msecs_to_jiffies(polling_delay));
 }
 
 static int pda_power_probe(struct platform_device *pdev)
@@ -200,6 +314,11 @@ static int pda_power_probe(struct platform_device *pdev)
 
 	dev = &pdev->dev;
 
+	/* the interrupts, notifier and exported calls all schedule these */
+	INIT_DELAYED_WORK(&charger_work, charger_work_func);
+	INIT_DELAYED_WORK(&supply_work, supply_work_func);
+	INIT_DELAYED_WORK(&polling_work, polling_work_func);
+
 	if (pdev->id != -1) {
 		dev_err(dev, "it's meaningless to register several "
 			"pda_powers; use id = -1\n");
@@ -215,6 +334,15 @@ static int pda_power_probe(struct platform_device *pdev)
 			goto init_failed;
 	}
 
+	/* boards without a set_charge() callback may supply a regulator */
+	if (!pdata->set_charge) {
+		charger = regulator_get(dev, "charger");
+		if (IS_ERR(charger)) {
+			dev_dbg(dev, "couldn't get charger regulator\n");
+			charger = NULL;
+		}
+	}
+
 	update_status();
 	update_charger();
 
@@ -227,8 +355,11 @@ static int pda_power_probe(struct platform_device *pdev)
 	if (!pdata->polling_interval)
 		pdata->polling_interval = 2000;
 
-	setup_timer(&charger_timer, charger_timer_func, 0);
-	setup_timer(&supply_timer, supply_timer_func, 0);
+	if (!pdata->polling_max_interval)
+		pdata->polling_max_interval = pdata->polling_interval * 4;
+	if (pdata->polling_max_interval < pdata->polling_interval)
+		pdata->polling_max_interval = pdata->polling_interval;
+	polling_delay = pdata->polling_interval;
 
 	ac_irq = platform_get_resource_byname(pdev, IORESOURCE_IRQ, "ac");
 	usb_irq = platform_get_resource_byname(pdev, IORESOURCE_IRQ, "usb");
@@ -256,7 +387,7 @@ static int pda_power_probe(struct platform_device *pdev)
 				dev_err(dev, "request ac irq failed\n");
 				goto ac_irq_failed;
 			}
-		} else {
+		} else if (!pdata->status_events) {
 			polling = 1;
 		}
 	}
@@ -277,19 +408,24 @@ static int pda_power_probe(struct platform_device *pdev)
 				dev_err(dev, "request usb irq failed\n");
 				goto usb_irq_failed;
 			}
-		} else {
+		} else if (!pdata->status_events) {
 			polling = 1;
 		}
 	}
 
+	if (charger) {
+		charger_nb.notifier_call = charger_notify;
+		if (regulator_register_notifier(charger, &charger_nb))
+			charger_nb.notifier_call = NULL;
+	}
+
 	if (polling) {
 		dev_dbg(dev, "will poll for status\n");
-		setup_timer(&polling_timer, polling_timer_func, 0);
-		mod_timer(&polling_timer,
-			  jiffies + msecs_to_jiffies(pdata->polling_interval));
+		schedule_delayed_work(&polling_work,
+				msecs_to_jiffies(pdata->polling_interval));
 	}
 
-	if (ac_irq || usb_irq)
+	if (ac_irq || usb_irq || pdata->status_events)
 		device_init_wakeup(&pdev->dev, 1);
 
 	return 0;
@@ -304,6 +440,15 @@ ac_irq_failed:
 	if (pdata->is_ac_online)
 		power_supply_unregister(&pda_psy_ac);
 ac_supply_failed:
+	cancel_delayed_work_sync(&charger_work);
+	cancel_delayed_work_sync(&supply_work);
+	if (charger) {
+		if (charger_enabled)
+			regulator_disable(charger);
+		regulator_put(charger);
+		charger = NULL;
+		charger_enabled = 0;
+	}
 	if (pdata->exit)
 		pdata->exit(dev);
 init_failed:
@@ -313,20 +458,31 @@ wrongid:
 
 static int pda_power_remove(struct platform_device *pdev)
 {
+	if (charger && charger_nb.notifier_call) {
+		regulator_unregister_notifier(charger, &charger_nb);
+		charger_nb.notifier_call = NULL;
+	}
 	if (pdata->is_usb_online && usb_irq)
 		free_irq(usb_irq->start, &pda_psy_usb);
 	if (pdata->is_ac_online && ac_irq)
 		free_irq(ac_irq->start, &pda_psy_ac);
 
 	if (polling)
-		del_timer_sync(&polling_timer);
-	del_timer_sync(&charger_timer);
-	del_timer_sync(&supply_timer);
+		cancel_delayed_work_sync(&polling_work);
+	cancel_delayed_work_sync(&charger_work);
+	cancel_delayed_work_sync(&supply_work);
 
 	if (pdata->is_usb_online)
 		power_supply_unregister(&pda_psy_usb);
 	if (pdata->is_ac_online)
 		power_supply_unregister(&pda_psy_ac);
+	if (charger) {
+		if (charger_enabled)
+			regulator_disable(charger);
+		regulator_put(charger);
+		charger = NULL;
+		charger_enabled = 0;
+	}
 	if (pdata->exit)
 		pdata->exit(dev);
 
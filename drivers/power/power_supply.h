@@ -10,6 +10,10 @@
  *  You may use this code as per GPL version 2
  */
 
+extern void power_supply_get_all_properties(struct power_supply *psy,
+					    union power_supply_propval *vals,
+					    int *rets);
+
 #ifdef CONFIG_SYSFS
 
 extern int power_supply_create_attrs(struct power_supply *psy);
@@ -15,98 +15,460 @@
 #include <linux/init.h>
 #include <linux/device.h>
 #include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/srcu.h>
+#include <linux/timer.h>
 #include <linux/power_supply.h>
+#include <linux/regulator/machine.h>
 #include "power_supply.h"
 
 struct class *power_supply_class;
 
-static int __power_supply_changed_work(struct device *dev, void *data)
+/*
+ * The supplied_to names are resolved into links between registered
+ * supplies, so notifications and supply checks only visit the supplies
+ * actually involved.  Readers use SRCU since the callbacks may sleep;
+ * updates are serialised by power_supply_lock.
+ */
+struct power_supply_link {
+	struct power_supply *supplier;
+	struct power_supply *supplicant;
+	struct list_head supplicant_list;	/* on supplier->supplicants */
+	struct list_head supplier_list;		/* on supplicant->suppliers */
+};
+
+static DEFINE_MUTEX(power_supply_lock);
+static LIST_HEAD(power_supply_list);
+static struct srcu_struct power_supply_srcu;
+
+static int power_supply_supplies(struct power_supply *supplier,
+				 struct power_supply *supplicant)
 {
-	struct power_supply *psy = (struct power_supply *)data;
-	struct power_supply *pst = dev_get_drvdata(dev);
 	int i;
 
-	for (i = 0; i < psy->num_supplicants; i++)
-		if (!strcmp(psy->supplied_to[i], pst->name)) {
-			if (pst->external_power_changed)
-				pst->external_power_changed(pst);
+	for (i = 0; i < supplier->num_supplicants; i++)
+		if (!strcmp(supplier->supplied_to[i], supplicant->name))
+			return 1;
+	return 0;
+}
+
+static int power_supply_add_link(struct power_supply *supplier,
+				 struct power_supply *supplicant)
+{
+	struct power_supply_link *link;
+
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link)
+		return -ENOMEM;
+
+	link->supplier = supplier;
+	link->supplicant = supplicant;
+	list_add_tail_rcu(&link->supplicant_list, &supplier->supplicants);
+	list_add_tail_rcu(&link->supplier_list, &supplicant->suppliers);
+
+	return 0;
+}
+
+static void power_supply_remove_links(struct power_supply *psy)
+{
+	struct power_supply_link *link, *n;
+
+	mutex_lock(&power_supply_lock);
+
+	/* unpublish psy and the links other supplies can see */
+	list_del_rcu(&psy->node);
+	list_for_each_entry(link, &psy->supplicants, supplicant_list)
+		list_del_rcu(&link->supplier_list);
+	list_for_each_entry(link, &psy->suppliers, supplier_list)
+		list_del_rcu(&link->supplicant_list);
+
+	synchronize_srcu(&power_supply_srcu);
+
+	list_for_each_entry_safe(link, n, &psy->supplicants, supplicant_list)
+		kfree(link);
+	list_for_each_entry_safe(link, n, &psy->suppliers, supplier_list)
+		kfree(link);
+	INIT_LIST_HEAD(&psy->supplicants);
+	INIT_LIST_HEAD(&psy->suppliers);
+
+	mutex_unlock(&power_supply_lock);
+}
+
+static int power_supply_add_links(struct power_supply *psy)
+{
+	struct power_supply *pst;
+	int rc = 0;
+
+	mutex_lock(&power_supply_lock);
+
+	list_for_each_entry(pst, &power_supply_list, node) {
+		if (power_supply_supplies(psy, pst)) {
+			rc = power_supply_add_link(psy, pst);
+			if (rc)
+				break;
+		}
+		if (power_supply_supplies(pst, psy)) {
+			rc = power_supply_add_link(pst, psy);
+			if (rc)
+				break;
+		}
+	}
+
+	list_add_tail_rcu(&psy->node, &power_supply_list);
+
+	mutex_unlock(&power_supply_lock);
+
+	if (rc)
+		power_supply_remove_links(psy);
+
+	return rc;
+}
+
+/*
+ * Run the regulators from their battery profile while every external
+ * supply is offline, if the system has any.
+ */
+static void power_supply_update_profile(void)
+{
+	union power_supply_propval ret = {0,};
+	struct power_supply *psy;
+	int idx, external = 0, online = 0;
+
+	idx = srcu_read_lock(&power_supply_srcu);
+	list_for_each_entry_rcu(psy, &power_supply_list, node) {
+		if (psy->type == POWER_SUPPLY_TYPE_BATTERY)
+			continue;
+		external = 1;
+		if (power_supply_get_property(psy, POWER_SUPPLY_PROP_ONLINE,
+					      &ret))
+			continue;
+		if (ret.intval) {
+			online = 1;
+			break;
 		}
+	}
+	srcu_read_unlock(&power_supply_srcu, idx);
+
+	if (external)
+		regulator_set_profile(online ? REGULATOR_PROFILE_DEFAULT :
+				      REGULATOR_PROFILE_BATTERY);
+}
+
+/* change notifications held back by changed_min_ms */
+struct power_supply_ratelimit {
+	struct timer_list timer;	/* delivers the last held back change */
+	unsigned long next;		/* jiffies until which changes wait */
+	int dead;			/* supply being unregistered */
+
+	/* state seen by the last change, for spotting urgent ones */
+	int online;
+	int present;
+	int health;
+	int capacity;
+};
+
+static void power_supply_ratelimit_timer(unsigned long data)
+{
+	struct power_supply *psy = (struct power_supply *)data;
+
+	schedule_work(&psy->changed_work);
+}
+
+static int power_supply_ratelimit_init(struct power_supply *psy)
+{
+	struct power_supply_ratelimit *rl;
+
+	if (!psy->changed_min_ms)
+		return 0;
+
+	rl = kzalloc(sizeof(*rl), GFP_KERNEL);
+	if (!rl)
+		return -ENOMEM;
+
+	setup_timer(&rl->timer, power_supply_ratelimit_timer,
+		    (unsigned long)psy);
+	rl->next = jiffies;
+	rl->health = POWER_SUPPLY_HEALTH_UNKNOWN;
+	rl->capacity = INT_MAX;
+	psy->ratelimit = rl;
+
 	return 0;
 }
 
+static void power_supply_ratelimit_exit(struct power_supply *psy)
+{
+	struct power_supply_ratelimit *rl = psy->ratelimit;
+
+	if (!rl)
+		return;
+
+	/* a change already running may still rearm the timer */
+	rl->dead = 1;
+	flush_scheduled_work();
+	del_timer_sync(&rl->timer);
+	flush_scheduled_work();
+
+	kfree(rl);
+	psy->ratelimit = NULL;
+}
+
+/* read an integer property, if the supply has it */
+static int power_supply_read_int(struct power_supply *psy,
+				 enum power_supply_property psp, int *val)
+{
+	union power_supply_propval ret = {0,};
+	int i;
+
+	for (i = 0; i < psy->num_properties; i++)
+		if (psy->properties[i] == psp)
+			break;
+	if (i == psy->num_properties)
+		return -EINVAL;
+
+	if (power_supply_get_property(psy, psp, &ret))
+		return -EINVAL;
+
+	*val = ret.intval;
+	return 0;
+}
+
+/* whether the change is one which shouldn't wait for changed_min_ms */
+static int power_supply_changed_urgent(struct power_supply *psy,
+				       struct power_supply_ratelimit *rl)
+{
+	int val, urgent = 0;
+
+	if (!power_supply_read_int(psy, POWER_SUPPLY_PROP_ONLINE, &val)) {
+		if (rl->online && !val)
+			urgent = 1;
+		rl->online = val;
+	}
+
+	if (!power_supply_read_int(psy, POWER_SUPPLY_PROP_PRESENT, &val)) {
+		if (rl->present && !val)
+			urgent = 1;
+		rl->present = val;
+	}
+
+	if (!power_supply_read_int(psy, POWER_SUPPLY_PROP_HEALTH, &val)) {
+		if (val != rl->health && val != POWER_SUPPLY_HEALTH_GOOD &&
+		    val != POWER_SUPPLY_HEALTH_UNKNOWN)
+			urgent = 1;
+		rl->health = val;
+	}
+
+	if (psy->capacity_critical &&
+	    !power_supply_read_int(psy, POWER_SUPPLY_PROP_CAPACITY, &val)) {
+		if (rl->capacity > psy->capacity_critical &&
+		    val <= psy->capacity_critical)
+			urgent = 1;
+		rl->capacity = val;
+	}
+
+	return urgent;
+}
+
 static void power_supply_changed_work(struct work_struct *work)
 {
 	struct power_supply *psy = container_of(work, struct power_supply,
 						changed_work);
+	struct power_supply_ratelimit *rl = psy->ratelimit;
+	struct power_supply_link *link;
+	int idx;
 
 	dev_dbg(psy->dev, "%s\n", __func__);
 
-	class_for_each_device(power_supply_class, NULL, psy,
-			      __power_supply_changed_work);
+	if (rl) {
+		/* changes held back are reported together, with the
+		 * state when the timer fires */
+		if (!power_supply_changed_urgent(psy, rl) && !rl->dead &&
+		    time_before(jiffies, rl->next)) {
+			mod_timer(&rl->timer, rl->next);
+			return;
+		}
+
+		del_timer(&rl->timer);
+		rl->next = jiffies + msecs_to_jiffies(psy->changed_min_ms);
+	}
+
+	idx = srcu_read_lock(&power_supply_srcu);
+	list_for_each_entry_rcu(link, &psy->supplicants, supplicant_list) {
+		struct power_supply *pst = link->supplicant;
+
+		if (pst->external_power_changed)
+			pst->external_power_changed(pst);
+	}
+	srcu_read_unlock(&power_supply_srcu, idx);
+
+	if (psy->type != POWER_SUPPLY_TYPE_BATTERY)
+		power_supply_update_profile();
 
 	power_supply_update_leds(psy);
 
 	kobject_uevent(&psy->dev->kobj, KOBJ_CHANGE);
 }
 
-void power_supply_changed(struct power_supply *psy)
+/* properties read in one batch by the driver's get_properties() */
+struct power_supply_snapshot {
+	struct mutex lock;
+	int valid;
+	unsigned long time;		/* jiffies when taken */
+	union power_supply_propval *vals;
+	int *rets;
+};
+
+static int power_supply_snapshot_init(struct power_supply *psy)
 {
-	dev_dbg(psy->dev, "%s\n", __func__);
+	struct power_supply_snapshot *snap;
+	size_t n = psy->num_properties;
 
-	schedule_work(&psy->changed_work);
+	if (!psy->get_properties)
+		return 0;
+
+	snap = kzalloc(sizeof(*snap) + n * (sizeof(*snap->vals) +
+					    sizeof(*snap->rets)), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	mutex_init(&snap->lock);
+	snap->vals = (union power_supply_propval *)(snap + 1);
+	snap->rets = (int *)(snap->vals + n);
+	psy->snapshot = snap;
+
+	return 0;
 }
 
-static int __power_supply_am_i_supplied(struct device *dev, void *data)
+/* snap->lock held by caller */
+static void power_supply_snapshot_refresh(struct power_supply *psy)
 {
-	union power_supply_propval ret = {0,};
-	struct power_supply *psy = (struct power_supply *)data;
-	struct power_supply *epsy = dev_get_drvdata(dev);
-	int i;
+	struct power_supply_snapshot *snap = psy->snapshot;
 
-	for (i = 0; i < epsy->num_supplicants; i++) {
-		if (!strcmp(epsy->supplied_to[i], psy->name)) {
-			if (epsy->get_property(epsy,
-				  POWER_SUPPLY_PROP_ONLINE, &ret))
-				continue;
-			if (ret.intval)
-				return ret.intval;
-		}
+	if (!snap->valid || time_after(jiffies, snap->time +
+				       msecs_to_jiffies(psy->snapshot_ms))) {
+		psy->get_properties(psy, snap->vals, snap->rets);
+		snap->time = jiffies;
+		snap->valid = 1;
 	}
-	return 0;
 }
 
-int power_supply_am_i_supplied(struct power_supply *psy)
+/**
+ * power_supply_get_property - read a power supply property
+ * @psy: power supply
+ * @psp: property
+ * @val: returned value
+ *
+ * Supplies providing get_properties() are answered from their
+ * snapshot, which is refreshed when it is older than snapshot_ms.
+ */
+int power_supply_get_property(struct power_supply *psy,
+			      enum power_supply_property psp,
+			      union power_supply_propval *val)
 {
-	int error;
+	struct power_supply_snapshot *snap = psy->snapshot;
+	int i, ret;
 
-	error = class_for_each_device(power_supply_class, NULL, psy,
-				      __power_supply_am_i_supplied);
+	if (!snap)
+		return psy->get_property(psy, psp, val);
 
-	dev_dbg(psy->dev, "%s %d\n", __func__, error);
+	for (i = 0; i < psy->num_properties; i++)
+		if (psy->properties[i] == psp)
+			break;
+	if (i == psy->num_properties)
+		return psy->get_property(psy, psp, val);
 
-	return error;
+	mutex_lock(&snap->lock);
+	power_supply_snapshot_refresh(psy);
+	*val = snap->vals[i];
+	ret = snap->rets[i];
+	mutex_unlock(&snap->lock);
+
+	return ret;
+}
+
+/*
+ * Read every property of a supply, vals[i] and rets[i] being the
+ * value and result for psy->properties[i].  For supplies providing
+ * get_properties() all of them come from the same snapshot rather
+ * than from whichever snapshot was current as each was read.
+ */
+void power_supply_get_all_properties(struct power_supply *psy,
+				     union power_supply_propval *vals,
+				     int *rets)
+{
+	struct power_supply_snapshot *snap = psy->snapshot;
+	int i;
+
+	if (!snap) {
+		for (i = 0; i < psy->num_properties; i++)
+			rets[i] = psy->get_property(psy, psy->properties[i],
+						    &vals[i]);
+		return;
+	}
+
+	mutex_lock(&snap->lock);
+	power_supply_snapshot_refresh(psy);
+	memcpy(vals, snap->vals, psy->num_properties * sizeof(*vals));
+	memcpy(rets, snap->rets, psy->num_properties * sizeof(*rets));
+	mutex_unlock(&snap->lock);
 }
 
-static int __power_supply_is_system_supplied(struct device *dev, void *data)
+void power_supply_changed(struct power_supply *psy)
 {
-	union power_supply_propval ret = {0,};
-	struct power_supply *psy = dev_get_drvdata(dev);
+	dev_dbg(psy->dev, "%s\n", __func__);
 
-	if (psy->type != POWER_SUPPLY_TYPE_BATTERY) {
-		if (psy->get_property(psy, POWER_SUPPLY_PROP_ONLINE, &ret))
-			return 0;
-		if (ret.intval)
-			return ret.intval;
+	/* the next read must see the new state */
+	if (psy->snapshot)
+		psy->snapshot->valid = 0;
+
+	schedule_work(&psy->changed_work);
+}
+
+int power_supply_am_i_supplied(struct power_supply *psy)
+{
+	union power_supply_propval ret = {0,};
+	struct power_supply_link *link;
+	int idx, error = 0;
+
+	idx = srcu_read_lock(&power_supply_srcu);
+	list_for_each_entry_rcu(link, &psy->suppliers, supplier_list) {
+		struct power_supply *epsy = link->supplier;
+
+		if (power_supply_get_property(epsy, POWER_SUPPLY_PROP_ONLINE,
+					      &ret))
+			continue;
+		if (ret.intval) {
+			error = ret.intval;
+			break;
+		}
 	}
-	return 0;
+	srcu_read_unlock(&power_supply_srcu, idx);
+
+	dev_dbg(psy->dev, "%s %d\n", __func__, error);
+
+	return error;
 }
 
 int power_supply_is_system_supplied(void)
 {
-	int error;
-
-	error = class_for_each_device(power_supply_class, NULL, NULL,
-				      __power_supply_is_system_supplied);
+	union power_supply_propval ret = {0,};
+	struct power_supply *psy;
+	int idx, error = 0;
+
+	idx = srcu_read_lock(&power_supply_srcu);
+	list_for_each_entry_rcu(psy, &power_supply_list, node) {
+		if (psy->type == POWER_SUPPLY_TYPE_BATTERY)
+			continue;
+		if (power_supply_get_property(psy, POWER_SUPPLY_PROP_ONLINE,
+					      &ret))
+			continue;
+		if (ret.intval) {
+			error = ret.intval;
+			break;
+		}
+	}
+	srcu_read_unlock(&power_supply_srcu, idx);
 
 	return error;
 }
@@ -123,6 +485,16 @@ int power_supply_register(struct device *parent, struct power_supply *psy)
 	}
 
 	INIT_WORK(&psy->changed_work, power_supply_changed_work);
+	INIT_LIST_HEAD(&psy->supplicants);
+	INIT_LIST_HEAD(&psy->suppliers);
+
+	rc = power_supply_snapshot_init(psy);
+	if (rc)
+		goto snapshot_failed;
+
+	rc = power_supply_ratelimit_init(psy);
+	if (rc)
+		goto ratelimit_failed;
 
 	rc = power_supply_create_attrs(psy);
 	if (rc)
@@ -132,13 +504,25 @@ int power_supply_register(struct device *parent, struct power_supply *psy)
 	if (rc)
 		goto create_triggers_failed;
 
+	rc = power_supply_add_links(psy);
+	if (rc)
+		goto add_links_failed;
+
 	power_supply_changed(psy);
 
 	goto success;
 
+add_links_failed:
+	power_supply_remove_triggers(psy);
 create_triggers_failed:
 	power_supply_remove_attrs(psy);
 create_attrs_failed:
+	kfree(psy->ratelimit);
+	psy->ratelimit = NULL;
+ratelimit_failed:
+	kfree(psy->snapshot);
+	psy->snapshot = NULL;
+snapshot_failed:
 	device_unregister(psy->dev);
 dev_create_failed:
 success:
@@ -147,18 +531,30 @@ success:
 
 void power_supply_unregister(struct power_supply *psy)
 {
+	power_supply_remove_links(psy);
 	flush_scheduled_work();
+	power_supply_ratelimit_exit(psy);
 	power_supply_remove_triggers(psy);
 	power_supply_remove_attrs(psy);
 	device_unregister(psy->dev);
+	kfree(psy->snapshot);
+	psy->snapshot = NULL;
 }
 
 static int __init power_supply_class_init(void)
 {
+	int rc;
+
+	rc = init_srcu_struct(&power_supply_srcu);
+	if (rc)
+		return rc;
+
 	power_supply_class = class_create(THIS_MODULE, "power_supply");
 
-	if (IS_ERR(power_supply_class))
+	if (IS_ERR(power_supply_class)) {
+		cleanup_srcu_struct(&power_supply_srcu);
 		return PTR_ERR(power_supply_class);
+	}
 
 	power_supply_class->dev_uevent = power_supply_uevent;
 
@@ -168,9 +564,11 @@ static int __init power_supply_class_init(void)
 static void __exit power_supply_class_exit(void)
 {
 	class_destroy(power_supply_class);
+	cleanup_srcu_struct(&power_supply_srcu);
 }
 
 EXPORT_SYMBOL_GPL(power_supply_changed);
+EXPORT_SYMBOL_GPL(power_supply_get_property);
 EXPORT_SYMBOL_GPL(power_supply_am_i_supplied);
 EXPORT_SYMBOL_GPL(power_supply_is_system_supplied);
 EXPORT_SYMBOL_GPL(power_supply_register);
@@ -12,6 +12,7 @@
  */
 
 #include <linux/ctype.h>
+#include <linux/slab.h>
 #include <linux/power_supply.h>
 
 #include "power_supply.h"
@@ -37,9 +38,11 @@
 
 static struct device_attribute power_supply_attrs[];
 
-static ssize_t power_supply_show_property(struct device *dev,
-					  struct device_attribute *attr,
-					  char *buf) {
+/* the text of a property value, at most size bytes including the newline */
+static ssize_t power_supply_format_property(enum power_supply_property off,
+					    union power_supply_propval *value,
+					    char *buf, size_t size)
+{
 	static char *status_text[] = {
 		"Unknown", "Charging", "Discharging", "Not charging", "Full"
 	};
@@ -51,12 +54,31 @@ static ssize_t power_supply_show_property(struct device *dev,
 		"Unknown", "NiMH", "Li-ion", "Li-poly", "LiFe", "NiCd",
 		"LiMn"
 	};
+
+	if (off == POWER_SUPPLY_PROP_STATUS)
+		return scnprintf(buf, size, "%s\n",
+				 status_text[value->intval]);
+	else if (off == POWER_SUPPLY_PROP_HEALTH)
+		return scnprintf(buf, size, "%s\n",
+				 health_text[value->intval]);
+	else if (off == POWER_SUPPLY_PROP_TECHNOLOGY)
+		return scnprintf(buf, size, "%s\n",
+				 technology_text[value->intval]);
+	else if (off >= POWER_SUPPLY_PROP_MODEL_NAME)
+		return scnprintf(buf, size, "%s\n", value->strval);
+
+	return scnprintf(buf, size, "%d\n", value->intval);
+}
+
+static ssize_t power_supply_show_property(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf) {
 	ssize_t ret;
 	struct power_supply *psy = dev_get_drvdata(dev);
 	const ptrdiff_t off = attr - power_supply_attrs;
 	union power_supply_propval value;
 
-	ret = psy->get_property(psy, off, &value);
+	ret = power_supply_get_property(psy, off, &value);
 
 	if (ret < 0) {
 		if (ret != -ENODEV)
@@ -65,16 +87,7 @@ static ssize_t power_supply_show_property(struct device *dev,
 		return ret;
 	}
 
-	if (off == POWER_SUPPLY_PROP_STATUS)
-		return sprintf(buf, "%s\n", status_text[value.intval]);
-	else if (off == POWER_SUPPLY_PROP_HEALTH)
-		return sprintf(buf, "%s\n", health_text[value.intval]);
-	else if (off == POWER_SUPPLY_PROP_TECHNOLOGY)
-		return sprintf(buf, "%s\n", technology_text[value.intval]);
-	else if (off >= POWER_SUPPLY_PROP_MODEL_NAME)
-		return sprintf(buf, "%s\n", value.strval);
-
-	return sprintf(buf, "%d\n", value.intval);
+	return power_supply_format_property(off, &value, buf, PAGE_SIZE);
 }
 
 /* Must be in the same order as POWER_SUPPLY_PROP_* */
@@ -132,6 +145,73 @@ static struct device_attribute power_supply_static_attrs[] = {
 	__ATTR(type, 0444, power_supply_show_static_attrs, NULL),
 };
 
+/* upper case copy of an attribute name, for the uevent variable */
+static void power_supply_upcase(char *dst, const char *src, size_t size)
+{
+	while (*src && --size)
+		*dst++ = toupper(*src++);
+
+	*dst = 0;
+}
+
+/*
+ * Every property in the form used by the uevent, from a single read
+ * of the supply, so that userspace polling all of them costs one
+ * batch from the gauge and sees values which belong together.
+ */
+static ssize_t power_supply_show_properties(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct power_supply *psy = dev_get_drvdata(dev);
+	union power_supply_propval *vals;
+	int *rets;
+	char attrname[32];
+	ssize_t len;
+	int j;
+
+	vals = kmalloc(psy->num_properties * (sizeof(*vals) + sizeof(*rets)),
+		       GFP_KERNEL);
+	if (!vals)
+		return -ENOMEM;
+	rets = (int *)(vals + psy->num_properties);
+
+	power_supply_get_all_properties(psy, vals, rets);
+
+	len = scnprintf(buf, PAGE_SIZE, "POWER_SUPPLY_NAME=%s\n", psy->name);
+
+	for (j = 0; j < ARRAY_SIZE(power_supply_static_attrs); j++) {
+		attr = &power_supply_static_attrs[j];
+		power_supply_upcase(attrname, attr->attr.name,
+				    sizeof(attrname));
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "POWER_SUPPLY_%s=", attrname);
+		len += power_supply_show_static_attrs(dev, attr, buf + len);
+	}
+
+	for (j = 0; j < psy->num_properties; j++) {
+		enum power_supply_property psp = psy->properties[j];
+
+		/* as in the uevent, absent properties are left out */
+		if (rets[j] < 0)
+			continue;
+
+		attr = &power_supply_attrs[psp];
+		power_supply_upcase(attrname, attr->attr.name,
+				    sizeof(attrname));
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "POWER_SUPPLY_%s=", attrname);
+		len += power_supply_format_property(psp, &vals[j], buf + len,
+						    PAGE_SIZE - len);
+	}
+
+	kfree(vals);
+
+	return len;
+}
+
+static DEVICE_ATTR(properties, 0444, power_supply_show_properties, NULL);
+
 int power_supply_create_attrs(struct power_supply *psy)
 {
 	int rc = 0;
@@ -151,6 +231,10 @@ int power_supply_create_attrs(struct power_supply *psy)
 			goto dynamics_failed;
 	}
 
+	rc = device_create_file(psy->dev, &dev_attr_properties);
+	if (rc)
+		goto dynamics_failed;
+
 	goto succeed;
 
 dynamics_failed:
@@ -168,6 +252,8 @@ void power_supply_remove_attrs(struct power_supply *psy)
 {
 	int i;
 
+	device_remove_file(psy->dev, &dev_attr_properties);
+
 	for (i = 0; i < ARRAY_SIZE(power_supply_static_attrs); i++)
 		device_remove_file(psy->dev, &power_supply_static_attrs[i]);
 
@@ -176,29 +262,14 @@ void power_supply_remove_attrs(struct power_supply *psy)
 			    &power_supply_attrs[psy->properties[i]]);
 }
 
-static char *kstruprdup(const char *str, gfp_t gfp)
-{
-	char *ret, *ustr;
-
-	ustr = ret = kmalloc(strlen(str) + 1, gfp);
-
-	if (!ret)
-		return NULL;
-
-	while (*str)
-		*ustr++ = toupper(*str++);
-
-	*ustr = 0;
-
-	return ret;
-}
-
 int power_supply_uevent(struct device *dev, struct kobj_uevent_env *env)
 {
 	struct power_supply *psy = dev_get_drvdata(dev);
+	union power_supply_propval *vals;
+	int *rets;
 	int ret = 0, j;
 	char *prop_buf;
-	char *attrname;
+	char attrname[32];
 
 	dev_dbg(dev, "uevent\n");
 
@@ -217,6 +288,14 @@ int power_supply_uevent(struct device *dev, struct kobj_uevent_env *env)
 	if (!prop_buf)
 		return -ENOMEM;
 
+	vals = kmalloc(psy->num_properties * (sizeof(*vals) + sizeof(*rets)),
+		       GFP_KERNEL);
+	if (!vals) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	rets = (int *)(vals + psy->num_properties);
+
 	for (j = 0; j < ARRAY_SIZE(power_supply_static_attrs); j++) {
 		struct device_attribute *attr;
 		char *line;
@@ -231,29 +310,28 @@ int power_supply_uevent(struct device *dev, struct kobj_uevent_env *env)
 		if (line)
 			*line = 0;
 
-		attrname = kstruprdup(attr->attr.name, GFP_KERNEL);
-		if (!attrname) {
-			ret = -ENOMEM;
-			goto out;
-		}
+		power_supply_upcase(attrname, attr->attr.name,
+				    sizeof(attrname));
 
 		dev_dbg(dev, "Static prop %s=%s\n", attrname, prop_buf);
 
 		ret = add_uevent_var(env, "POWER_SUPPLY_%s=%s", attrname, prop_buf);
-		kfree(attrname);
 		if (ret)
 			goto out;
 	}
 
 	dev_dbg(dev, "%zd dynamic props\n", psy->num_properties);
 
+	/* one batch from the driver for the whole event */
+	power_supply_get_all_properties(psy, vals, rets);
+
 	for (j = 0; j < psy->num_properties; j++) {
 		struct device_attribute *attr;
 		char *line;
 
 		attr = &power_supply_attrs[psy->properties[j]];
 
-		ret = power_supply_show_property(dev, attr, prop_buf);
+		ret = rets[j];
 		if (ret == -ENODEV) {
 			/* When a battery is absent, we expect -ENODEV. Don't abort;
 			   send the uevent with at least the the PRESENT=0 property */
@@ -261,28 +339,31 @@ int power_supply_uevent(struct device *dev, struct kobj_uevent_env *env)
 			continue;
 		}
 
-		if (ret < 0)
+		if (ret < 0) {
+			dev_err(dev, "driver failed to report `%s' property\n",
+				attr->attr.name);
 			goto out;
+		}
+
+		power_supply_format_property(psy->properties[j], &vals[j],
+					     prop_buf, PAGE_SIZE);
 
 		line = strchr(prop_buf, '\n');
 		if (line)
 			*line = 0;
 
-		attrname = kstruprdup(attr->attr.name, GFP_KERNEL);
-		if (!attrname) {
-			ret = -ENOMEM;
-			goto out;
-		}
+		power_supply_upcase(attrname, attr->attr.name,
+				    sizeof(attrname));
 
 		dev_dbg(dev, "prop %s=%s\n", attrname, prop_buf);
 
 		ret = add_uevent_var(env, "POWER_SUPPLY_%s=%s", attrname, prop_buf);
-		kfree(attrname);
 		if (ret)
 			goto out;
 	}
 
 out:
+	kfree(vals);
 	free_page((unsigned long)prop_buf);
 
 	return ret;
@@ -0,0 +1,609 @@
+/*
+ * wm8350_power.c  --  Power supply driver for the Wolfson WM8350 PMIC
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ *  Supply and charger state is updated from the charger and supply
+ *  interrupts, with the supply voltages converted by the AUXADC whenever
+ *  one of those fires, and cached so reading a property never touches
+ *  the bus.  The charge current is controlled through the WM8350_CHARGER
+ *  regulator rather than here.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/platform_device.h>
+#include <linux/power_supply.h>
+#include <linux/mfd/wm8350/core.h>
+#include <linux/mfd/wm8350/comparator.h>
+#include <linux/mfd/wm8350/supply.h>
+
+/* inputs below these are taken as not connected */
+#define WM8350_SUPPLY_PRESENT_UV	3800000
+#define WM8350_BATT_PRESENT_UV		2000000
+
+/* keep the battery voltage fresh while nothing interrupts */
+#define WM8350_POWER_REFRESH		(60 * HZ)
+
+/* longest to wait for background conversions before withdrawing them */
+#define WM8350_POWER_ADC_TIMEOUT	(HZ / 2)
+
+#define WM8350_EXT_SUPPLIES		(WM8350_USB_SUPPLY | WM8350_LINE_SUPPLY)
+
+static const int wm8350_power_adc_channels[WM8350_POWER_ADC_CHANNELS] = {
+	WM8350_AUXADC_BATT,
+	WM8350_AUXADC_USB,
+	WM8350_AUXADC_LINE,
+};
+
+static int wm8350_power_adc_uV(int channel, int value)
+{
+	/* USB is read through a divide by two */
+	if (channel == WM8350_AUXADC_USB)
+		return value * WM8350_AUX_COEFF * 2;
+	return value * WM8350_AUX_COEFF;
+}
+
+static int *wm8350_power_adc_dest(struct wm8350_power *power, int channel)
+{
+	switch (channel) {
+	case WM8350_AUXADC_BATT:
+		return &power->batt_uV;
+	case WM8350_AUXADC_USB:
+		return &power->usb_uV;
+	default:
+		return &power->line_uV;
+	}
+}
+
+/*
+ * Work out which supplies are connected from the cached voltages, with
+ * the lock held.  Returns the supplies whose state changed.
+ */
+static int wm8350_power_update(struct wm8350_power *power)
+{
+	int supplies = 0;
+	int changed;
+
+	if (power->batt_uV >= WM8350_BATT_PRESENT_UV)
+		supplies |= WM8350_BATT_SUPPLY;
+	if (power->usb_uV >= WM8350_SUPPLY_PRESENT_UV)
+		supplies |= WM8350_USB_SUPPLY;
+	if (power->line_uV >= WM8350_SUPPLY_PRESENT_UV)
+		supplies |= WM8350_LINE_SUPPLY;
+
+	changed = supplies ^ power->supplies;
+	power->supplies = supplies;
+
+	/* the battery status follows the external supplies */
+	if (changed & WM8350_EXT_SUPPLIES) {
+		changed |= WM8350_BATT_SUPPLY;
+		if (!(supplies & WM8350_EXT_SUPPLIES))
+			power->charge_done = 0;
+	}
+
+	return changed;
+}
+
+static void wm8350_power_notify(struct wm8350_power *power, int supplies)
+{
+	if (supplies & WM8350_BATT_SUPPLY)
+		power_supply_changed(&power->battery);
+	if (supplies & WM8350_USB_SUPPLY)
+		power_supply_changed(&power->usb);
+	if (supplies & WM8350_LINE_SUPPLY)
+		power_supply_changed(&power->ac);
+}
+
+static void wm8350_power_adc_complete(struct wm8350 *wm8350,
+				      struct wm8350_auxadc_request *req);
+
+/* start the conversions, adc_busy must already cover all of them */
+static void wm8350_power_submit(struct wm8350 *wm8350)
+{
+	struct wm8350_power *power = &wm8350->power;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(power->adc); i++) {
+		ret = wm8350_auxadc_submit(wm8350, &power->adc[i]);
+		if (ret != 0) {
+			power->adc[i].value = ret;
+			wm8350_power_adc_complete(wm8350, &power->adc[i]);
+		}
+	}
+}
+
+static void wm8350_power_adc_complete(struct wm8350 *wm8350,
+				      struct wm8350_auxadc_request *req)
+{
+	struct wm8350_power *power = &wm8350->power;
+	int changed = 0;
+	int again = 0;
+	int idle = 0;
+
+	mutex_lock(&power->lock);
+
+	if (req->value >= 0)
+		*wm8350_power_adc_dest(power, req->channel) =
+			wm8350_power_adc_uV(req->channel, req->value);
+	else
+		dev_err(&power->pdev->dev, "AUXADC channel %d failed: %d\n",
+			req->channel, req->value);
+
+	if (--power->adc_busy == 0) {
+		changed = wm8350_power_update(power) | power->notify;
+		power->notify = 0;
+
+		/* stay busy across a repeat so remove can wait for us */
+		if (power->adc_again) {
+			power->adc_again = 0;
+			power->adc_busy = ARRAY_SIZE(power->adc);
+			again = 1;
+		} else {
+			idle = 1;
+		}
+	}
+
+	mutex_unlock(&power->lock);
+
+	wm8350_power_notify(power, changed);
+
+	if (again)
+		wm8350_power_submit(wm8350);
+	else if (idle)
+		wake_up(&power->adc_wait);
+}
+
+/*
+ * Convert the supply voltages in the background and report @notify,
+ * plus any supply which came or went, once they are in.
+ */
+static void wm8350_power_refresh(struct wm8350 *wm8350, int notify)
+{
+	struct wm8350_power *power = &wm8350->power;
+	int busy;
+
+	mutex_lock(&power->lock);
+	power->notify |= notify;
+	busy = power->adc_busy;
+	if (busy)
+		power->adc_again = 1;
+	else
+		power->adc_busy = ARRAY_SIZE(power->adc);
+	mutex_unlock(&power->lock);
+
+	if (!busy)
+		wm8350_power_submit(wm8350);
+}
+
+static void wm8350_power_work(struct work_struct *work)
+{
+	struct wm8350_power *power =
+		container_of(work, struct wm8350_power, work.work);
+	struct wm8350 *wm8350 = container_of(power, struct wm8350, power);
+
+	wm8350_power_refresh(wm8350, 0);
+	schedule_delayed_work(&power->work, WM8350_POWER_REFRESH);
+}
+
+static void wm8350_charger_handler(struct wm8350 *wm8350, int irq, void *data)
+{
+	struct wm8350_power *power = &wm8350->power;
+	u16 reg;
+
+	reg = wm8350_reg_read(wm8350, WM8350_BATTERY_CHARGER_CONTROL_2);
+
+	mutex_lock(&power->lock);
+
+	power->chg_sts = reg & WM8350_CHG_STS_MASK;
+
+	switch (irq) {
+	case WM8350_IRQ_CHG_BAT_HOT:
+		power->health = POWER_SUPPLY_HEALTH_OVERHEAT;
+		break;
+	case WM8350_IRQ_CHG_BAT_COLD:
+	case WM8350_IRQ_CHG_TO:
+		power->health = POWER_SUPPLY_HEALTH_UNSPEC_FAILURE;
+		break;
+	case WM8350_IRQ_CHG_BAT_FAIL:
+		power->health = POWER_SUPPLY_HEALTH_DEAD;
+		break;
+	case WM8350_IRQ_CHG_END:
+		power->charge_done = 1;
+		break;
+	case WM8350_IRQ_CHG_START:
+		power->charge_done = 0;
+		power->health = POWER_SUPPLY_HEALTH_GOOD;
+		break;
+	}
+
+	mutex_unlock(&power->lock);
+
+	power_supply_changed(&power->battery);
+}
+
+static void wm8350_vbatt_handler(struct wm8350 *wm8350, int irq, void *data)
+{
+	wm8350_power_refresh(wm8350, WM8350_BATT_SUPPLY);
+}
+
+static void wm8350_supply_handler(struct wm8350 *wm8350, int irq, void *data)
+{
+	/* the USB current limit doesn't change what is connected */
+	if (irq == WM8350_IRQ_USB_LIMIT)
+		wm8350_power_refresh(wm8350, WM8350_USB_SUPPLY);
+	else
+		wm8350_power_refresh(wm8350, 0);
+}
+
+static const struct {
+	int irq;
+	void (*handler)(struct wm8350 *wm8350, int irq, void *data);
+} wm8350_power_irqs[] = {
+	{ WM8350_IRQ_CHG_BAT_HOT, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_BAT_COLD, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_BAT_FAIL, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_TO, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_END, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_START, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_FAST_RDY, wm8350_charger_handler },
+	{ WM8350_IRQ_CHG_VBATT_LT_3P9, wm8350_vbatt_handler },
+	{ WM8350_IRQ_CHG_VBATT_LT_3P1, wm8350_vbatt_handler },
+	{ WM8350_IRQ_CHG_VBATT_LT_2P85, wm8350_vbatt_handler },
+	{ WM8350_IRQ_USB_LIMIT, wm8350_supply_handler },
+	{ WM8350_IRQ_EXT_USB_FB, wm8350_supply_handler },
+	{ WM8350_IRQ_EXT_WALL_FB, wm8350_supply_handler },
+	{ WM8350_IRQ_EXT_BAT_FB, wm8350_supply_handler },
+};
+
+/* with the lock held */
+static int wm8350_batt_status(struct wm8350_power *power)
+{
+	if (power->chg_sts == WM8350_CHG_STS_TRICKLE ||
+	    power->chg_sts == WM8350_CHG_STS_FAST)
+		return POWER_SUPPLY_STATUS_CHARGING;
+
+	if (!(power->supplies & WM8350_EXT_SUPPLIES))
+		return POWER_SUPPLY_STATUS_DISCHARGING;
+
+	if (power->charge_done)
+		return POWER_SUPPLY_STATUS_FULL;
+
+	return POWER_SUPPLY_STATUS_NOT_CHARGING;
+}
+
+static int wm8350_batt_get_property(struct power_supply *psy,
+				    enum power_supply_property psp,
+				    union power_supply_propval *val)
+{
+	struct wm8350_power *power =
+		container_of(psy, struct wm8350_power, battery);
+	int ret = 0;
+
+	mutex_lock(&power->lock);
+
+	switch (psp) {
+	case POWER_SUPPLY_PROP_STATUS:
+		val->intval = wm8350_batt_status(power);
+		break;
+	case POWER_SUPPLY_PROP_HEALTH:
+		val->intval = power->health;
+		break;
+	case POWER_SUPPLY_PROP_PRESENT:
+		val->intval = !!(power->supplies & WM8350_BATT_SUPPLY);
+		break;
+	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+		val->intval = power->batt_uV;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	mutex_unlock(&power->lock);
+
+	return ret;
+}
+
+static enum power_supply_property wm8350_batt_props[] = {
+	POWER_SUPPLY_PROP_STATUS,
+	POWER_SUPPLY_PROP_HEALTH,
+	POWER_SUPPLY_PROP_PRESENT,
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,
+};
+
+static int wm8350_ext_get_property(struct wm8350_power *power, int supply,
+				   int *uV, enum power_supply_property psp,
+				   union power_supply_propval *val)
+{
+	int ret = 0;
+
+	mutex_lock(&power->lock);
+
+	switch (psp) {
+	case POWER_SUPPLY_PROP_ONLINE:
+		val->intval = !!(power->supplies & supply);
+		break;
+	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+		val->intval = *uV;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	mutex_unlock(&power->lock);
+
+	return ret;
+}
+
+static int wm8350_usb_get_property(struct power_supply *psy,
+				   enum power_supply_property psp,
+				   union power_supply_propval *val)
+{
+	struct wm8350_power *power =
+		container_of(psy, struct wm8350_power, usb);
+
+	return wm8350_ext_get_property(power, WM8350_USB_SUPPLY,
+				       &power->usb_uV, psp, val);
+}
+
+static int wm8350_ac_get_property(struct power_supply *psy,
+				  enum power_supply_property psp,
+				  union power_supply_propval *val)
+{
+	struct wm8350_power *power =
+		container_of(psy, struct wm8350_power, ac);
+
+	return wm8350_ext_get_property(power, WM8350_LINE_SUPPLY,
+				       &power->line_uV, psp, val);
+}
+
+static enum power_supply_property wm8350_ext_props[] = {
+	POWER_SUPPLY_PROP_ONLINE,
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,
+};
+
+static char *wm8350_supplied_to[] = {
+	"wm8350-battery",
+};
+
+static void wm8350_power_init_supplies(struct wm8350_power *power)
+{
+	power->battery.name = "wm8350-battery";
+	power->battery.type = POWER_SUPPLY_TYPE_BATTERY;
+	power->battery.properties = wm8350_batt_props;
+	power->battery.num_properties = ARRAY_SIZE(wm8350_batt_props);
+	power->battery.get_property = wm8350_batt_get_property;
+
+	power->usb.name = "wm8350-usb";
+	power->usb.type = POWER_SUPPLY_TYPE_USB;
+	power->usb.properties = wm8350_ext_props;
+	power->usb.num_properties = ARRAY_SIZE(wm8350_ext_props);
+	power->usb.get_property = wm8350_usb_get_property;
+	power->usb.supplied_to = wm8350_supplied_to;
+	power->usb.num_supplicants = ARRAY_SIZE(wm8350_supplied_to);
+
+	power->ac.name = "wm8350-ac";
+	power->ac.type = POWER_SUPPLY_TYPE_MAINS;
+	power->ac.properties = wm8350_ext_props;
+	power->ac.num_properties = ARRAY_SIZE(wm8350_ext_props);
+	power->ac.get_property = wm8350_ac_get_property;
+	power->ac.supplied_to = wm8350_supplied_to;
+	power->ac.num_supplicants = ARRAY_SIZE(wm8350_supplied_to);
+}
+
+/* fill the cache before anything can read it */
+static void wm8350_power_read_state(struct wm8350 *wm8350)
+{
+	struct wm8350_power *power = &wm8350->power;
+	int i, ch, ret;
+	u16 reg;
+
+	reg = wm8350_reg_read(wm8350, WM8350_BATTERY_CHARGER_CONTROL_2);
+	power->chg_sts = reg & WM8350_CHG_STS_MASK;
+	power->health = POWER_SUPPLY_HEALTH_GOOD;
+
+	for (i = 0; i < ARRAY_SIZE(wm8350_power_adc_channels); i++) {
+		ch = wm8350_power_adc_channels[i];
+		ret = wm8350_read_auxadc(wm8350, ch, 0, 0);
+		if (ret < 0) {
+			dev_err(&power->pdev->dev,
+				"AUXADC channel %d failed: %d\n", ch, ret);
+			continue;
+		}
+		*wm8350_power_adc_dest(power, ch) =
+			wm8350_power_adc_uV(ch, ret);
+	}
+
+	wm8350_power_update(power);
+}
+
+static int wm8350_power_adc_idle(struct wm8350_power *power)
+{
+	int idle;
+
+	mutex_lock(&power->lock);
+	idle = power->adc_busy == 0;
+	mutex_unlock(&power->lock);
+
+	return idle;
+}
+
+/*
+ * Wait for the background conversions to finish once nothing can start
+ * any more, withdrawing those still queued if they take too long.
+ */
+static void wm8350_power_adc_stop(struct wm8350 *wm8350)
+{
+	struct wm8350_power *power = &wm8350->power;
+	int i;
+
+	mutex_lock(&power->lock);
+	power->adc_again = 0;
+	mutex_unlock(&power->lock);
+
+	if (wait_event_timeout(power->adc_wait, wm8350_power_adc_idle(power),
+			       WM8350_POWER_ADC_TIMEOUT))
+		return;
+
+	dev_warn(&power->pdev->dev, "withdrawing AUXADC conversions\n");
+
+	for (i = 0; i < ARRAY_SIZE(power->adc); i++) {
+		if (wm8350_auxadc_cancel(wm8350, &power->adc[i]) != 0)
+			continue;
+
+		mutex_lock(&power->lock);
+		power->adc_busy--;
+		mutex_unlock(&power->lock);
+	}
+
+	/* anything left is being completed right now */
+	wait_event(power->adc_wait, wm8350_power_adc_idle(power));
+}
+
+static void wm8350_power_free_irqs(struct wm8350 *wm8350)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(wm8350_power_irqs); i++) {
+		wm8350_mask_irq(wm8350, wm8350_power_irqs[i].irq);
+		wm8350_free_irq(wm8350, wm8350_power_irqs[i].irq);
+	}
+}
+
+static int __devinit wm8350_power_probe(struct platform_device *pdev)
+{
+	struct wm8350 *wm8350 = platform_get_drvdata(pdev);
+	struct wm8350_power *power = &wm8350->power;
+	int i, ret;
+
+	mutex_init(&power->lock);
+	init_waitqueue_head(&power->adc_wait);
+	INIT_DELAYED_WORK(&power->work, wm8350_power_work);
+
+	for (i = 0; i < ARRAY_SIZE(power->adc); i++) {
+		power->adc[i].channel = wm8350_power_adc_channels[i];
+		power->adc[i].complete = wm8350_power_adc_complete;
+	}
+
+	wm8350_power_read_state(wm8350);
+	wm8350_power_init_supplies(power);
+
+	ret = power_supply_register(&pdev->dev, &power->battery);
+	if (ret != 0) {
+		dev_err(&pdev->dev, "failed to register battery: %d\n", ret);
+		return ret;
+	}
+
+	ret = power_supply_register(&pdev->dev, &power->usb);
+	if (ret != 0) {
+		dev_err(&pdev->dev, "failed to register USB supply: %d\n",
+			ret);
+		goto err_battery;
+	}
+
+	ret = power_supply_register(&pdev->dev, &power->ac);
+	if (ret != 0) {
+		dev_err(&pdev->dev, "failed to register line supply: %d\n",
+			ret);
+		goto err_usb;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(wm8350_power_irqs); i++) {
+		ret = wm8350_register_irq(wm8350, wm8350_power_irqs[i].irq,
+					  wm8350_power_irqs[i].handler, NULL);
+		if (ret != 0) {
+			dev_err(&pdev->dev, "failed to request IRQ %d: %d\n",
+				wm8350_power_irqs[i].irq, ret);
+			goto err_irq;
+		}
+		wm8350_unmask_irq(wm8350, wm8350_power_irqs[i].irq);
+	}
+
+	schedule_delayed_work(&power->work, WM8350_POWER_REFRESH);
+
+	return 0;
+
+err_irq:
+	while (--i >= 0) {
+		wm8350_mask_irq(wm8350, wm8350_power_irqs[i].irq);
+		wm8350_free_irq(wm8350, wm8350_power_irqs[i].irq);
+	}
+	wm8350_power_adc_stop(wm8350);
+	power_supply_unregister(&power->ac);
+err_usb:
+	power_supply_unregister(&power->usb);
+err_battery:
+	power_supply_unregister(&power->battery);
+	return ret;
+}
+
+static int __devexit wm8350_power_remove(struct platform_device *pdev)
+{
+	struct wm8350 *wm8350 = platform_get_drvdata(pdev);
+	struct wm8350_power *power = &wm8350->power;
+
+	wm8350_power_free_irqs(wm8350);
+	cancel_delayed_work_sync(&power->work);
+	wm8350_power_adc_stop(wm8350);
+
+	power_supply_unregister(&power->ac);
+	power_supply_unregister(&power->usb);
+	power_supply_unregister(&power->battery);
+
+	return 0;
+}
+
+#ifdef CONFIG_PM
+static int wm8350_power_resume(struct platform_device *pdev)
+{
+	struct wm8350 *wm8350 = platform_get_drvdata(pdev);
+	u16 reg;
+
+	/* supplies may have come and gone while we were asleep */
+	reg = wm8350_reg_read(wm8350, WM8350_BATTERY_CHARGER_CONTROL_2);
+	mutex_lock(&wm8350->power.lock);
+	wm8350->power.chg_sts = reg & WM8350_CHG_STS_MASK;
+	mutex_unlock(&wm8350->power.lock);
+
+	wm8350_power_refresh(wm8350, WM8350_BATT_SUPPLY);
+
+	return 0;
+}
+#else
+#define wm8350_power_resume NULL
+#endif
+
+static struct platform_driver wm8350_power_driver = {
+	.probe = wm8350_power_probe,
+	.remove = __devexit_p(wm8350_power_remove),
+	.resume = wm8350_power_resume,
+	.driver = {
+		.name = "wm8350-power",
+		.owner = THIS_MODULE,
+	},
+};
+
+static int __init wm8350_power_init(void)
+{
+	return platform_driver_register(&wm8350_power_driver);
+}
+module_init(wm8350_power_init);
+
+static void __exit wm8350_power_exit(void)
+{
+	platform_driver_unregister(&wm8350_power_driver);
+}
+module_exit(wm8350_power_exit);
+
+MODULE_DESCRIPTION("Power supply driver for the WM8350 PMIC");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:wm8350-power");
@@ -31,6 +31,10 @@ static int bat_status = POWER_SUPPLY_STATUS_UNKNOWN;
 static struct wm97xx_batt_info *pdata;
 static enum power_supply_property *prop;
 
+static unsigned int cache_time = 1000;
+module_param(cache_time, uint, 0444);
+MODULE_PARM_DESC(cache_time, "cache time in milliseconds");
+
 static unsigned long wm97xx_read_bat(struct power_supply *bat_ps)
 {
 	return wm97xx_read_aux_adc(bat_ps->dev->parent->driver_data,
@@ -89,6 +93,53 @@ static int wm97xx_bat_get_property(struct power_supply *bat_ps,
 	return 0;
 }
 
+/*
+ * Sample the battery voltage and temperature together, and only when
+ * the snapshot has expired rather than for each property read.
+ */
+static void wm97xx_bat_get_properties(struct power_supply *bat_ps,
+				      union power_supply_propval *vals,
+				      int *rets)
+{
+	u16 adcsel[2];
+	int adc[2];
+	int n = 0, bat = -1, temp = -1;
+	int i;
+
+	if (pdata->batt_aux >= 0) {
+		bat = n;
+		adcsel[n++] = pdata->batt_aux;
+	}
+	if (pdata->temp_aux >= 0) {
+		temp = n;
+		adcsel[n++] = pdata->temp_aux;
+	}
+
+	if (n)
+		wm97xx_read_aux_adcs(bat_ps->dev->parent->driver_data,
+				     adcsel, adc, n);
+
+	for (i = 0; i < bat_ps->num_properties; i++) {
+		rets[i] = 0;
+
+		switch (bat_ps->properties[i]) {
+		case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+			vals[i].intval = adc[bat] * pdata->batt_mult /
+				pdata->batt_div;
+			break;
+		case POWER_SUPPLY_PROP_TEMP:
+			vals[i].intval = adc[temp] * pdata->temp_mult /
+				pdata->temp_div;
+			break;
+		default:
+			rets[i] = wm97xx_bat_get_property(bat_ps,
+							  bat_ps->properties[i],
+							  &vals[i]);
+			break;
+		}
+	}
+}
+
 static void wm97xx_bat_external_power_changed(struct power_supply *bat_ps)
 {
 	schedule_work(&bat_work);
@@ -211,6 +262,8 @@ static int __devinit wm97xx_bat_probe(struct platform_device *dev)
 
 	bat_ps.properties = prop;
 	bat_ps.num_properties = props;
+	bat_ps.get_properties = wm97xx_bat_get_properties;
+	bat_ps.snapshot_ms = cache_time;
 
 	ret = power_supply_register(&dev->dev, &bat_ps);
 	if (!ret)
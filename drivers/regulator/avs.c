@@ -0,0 +1,362 @@
+/*
+ * avs.c -- Adaptive voltage scaling for regulator consumers
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Runs a supply at the lowest voltage at which the consumer's process
+ * and temperature sensors say timing is still met, rather than at the
+ * worst case voltage for every part.  The loop only ever asks for
+ * voltages the regulator can produce exactly so the core always
+ * knows the selector to use and each step costs a single register
+ * write with no readback.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/workqueue.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator/avs.h>
+
+struct regulator_avs {
+	struct regulator *regulator;
+	struct regulator_avs_config config;
+
+	struct mutex lock;
+	struct delayed_work poll_work;
+	struct work_struct trigger_work;
+	int stopped;
+
+	int *table;		/* voltages available in range, ascending */
+	int num;
+	int cur;		/* index of the voltage set */
+	int safe;		/* index of the safe voltage */
+	unsigned long last_change;
+};
+
+static int regulator_avs_cmp(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * List the distinct voltages the regulator can produce between min_uV
+ * and max_uV, returning the number found.
+ */
+static int regulator_avs_build_table(struct regulator *regulator,
+				     int min_uV, int max_uV, int **table_out)
+{
+	int *table;
+	int i, n, uV, count;
+
+	count = regulator_count_voltages(regulator);
+	if (count <= 0)
+		return -EINVAL;
+
+	table = kmalloc(count * sizeof(*table), GFP_KERNEL);
+	if (table == NULL)
+		return -ENOMEM;
+
+	n = 0;
+	for (i = 0; i < count; i++) {
+		uV = regulator_list_voltage(regulator, i);
+		if (uV > 0 && uV >= min_uV && uV <= max_uV)
+			table[n++] = uV;
+	}
+
+	sort(table, n, sizeof(*table), regulator_avs_cmp, NULL);
+
+	/* several selectors may give the same voltage */
+	count = n;
+	n = 0;
+	for (i = 0; i < count; i++)
+		if (n == 0 || table[i] != table[n - 1])
+			table[n++] = table[i];
+
+	if (n == 0) {
+		kfree(table);
+		return -EINVAL;
+	}
+
+	*table_out = table;
+	return n;
+}
+
+/* index of the lowest voltage no lower than uV */
+static int regulator_avs_index(const int *table, int num, int uV)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (table[i] >= uV)
+			return i;
+
+	return num - 1;
+}
+
+/* avs->lock held by caller */
+static int regulator_avs_set(struct regulator_avs *avs, int idx)
+{
+	int ret;
+
+	ret = regulator_set_voltage(avs->regulator, avs->table[idx],
+				    avs->table[idx]);
+	if (ret != 0)
+		return ret;
+
+	avs->cur = idx;
+	avs->last_change = jiffies;
+
+	return 0;
+}
+
+static void regulator_avs_run(struct regulator_avs *avs)
+{
+	unsigned long lower_after;
+	int verdict, idx, ret;
+
+	mutex_lock(&avs->lock);
+
+	if (avs->stopped)
+		goto out;
+
+	idx = avs->cur;
+	verdict = avs->config.sense(avs->config.data);
+
+	switch (verdict) {
+	case REGULATOR_AVS_HOLD:
+		break;
+
+	case REGULATOR_AVS_LOWER:
+		/* give the sensors time to settle after each change */
+		lower_after = avs->last_change +
+			msecs_to_jiffies(avs->config.lower_interval_ms);
+		if (idx > 0 && time_after_eq(jiffies, lower_after))
+			idx--;
+		break;
+
+	case REGULATOR_AVS_RAISE:
+		if (idx < avs->num - 1)
+			idx++;
+		break;
+
+	default:
+		/* we no longer know how much margin there is */
+		if (printk_ratelimit())
+			printk(KERN_WARNING "%s: sensor failed (%d), "
+			       "using safe voltage\n", __func__, verdict);
+		idx = max(idx, avs->safe);
+		break;
+	}
+
+	if (idx != avs->cur) {
+		ret = regulator_avs_set(avs, idx);
+		if (ret != 0) {
+			printk(KERN_ERR "%s: failed to set %duV: %d\n",
+			       __func__, avs->table[idx], ret);
+			if (avs->cur < avs->safe)
+				regulator_avs_set(avs, avs->safe);
+		}
+	}
+
+	if (avs->config.period_ms)
+		schedule_delayed_work(&avs->poll_work,
+				      msecs_to_jiffies(avs->config.period_ms));
+
+out:
+	mutex_unlock(&avs->lock);
+}
+
+static void regulator_avs_poll_work(struct work_struct *work)
+{
+	struct regulator_avs *avs = container_of(work, struct regulator_avs,
+						 poll_work.work);
+
+	regulator_avs_run(avs);
+}
+
+static void regulator_avs_trigger_work(struct work_struct *work)
+{
+	struct regulator_avs *avs = container_of(work, struct regulator_avs,
+						 trigger_work);
+
+	regulator_avs_run(avs);
+}
+
+/*
+ * Switch to a new range, starting from its safe voltage.  avs->lock
+ * held by caller.
+ */
+static int regulator_avs_load(struct regulator_avs *avs,
+			      int min_uV, int max_uV, int safe_uV)
+{
+	int *table;
+	int num, safe, ret;
+
+	if (min_uV > safe_uV || safe_uV > max_uV)
+		return -EINVAL;
+
+	num = regulator_avs_build_table(avs->regulator, min_uV, max_uV,
+					&table);
+	if (num < 0)
+		return num;
+
+	safe = regulator_avs_index(table, num, safe_uV);
+
+	ret = regulator_set_voltage(avs->regulator, table[safe], table[safe]);
+	if (ret != 0) {
+		kfree(table);
+		return ret;
+	}
+
+	kfree(avs->table);
+	avs->table = table;
+	avs->num = num;
+	avs->safe = safe;
+	avs->cur = safe;
+	avs->last_change = jiffies;
+
+	avs->config.min_uV = min_uV;
+	avs->config.max_uV = max_uV;
+	avs->config.safe_uV = safe_uV;
+
+	return 0;
+}
+
+/**
+ * regulator_avs_register - start adaptive voltage scaling of a supply
+ * @regulator: consumer of the supply to scale
+ * @config: loop configuration, copied
+ *
+ * The supply is set to the safe voltage and then moved one step at a
+ * time as directed by the sense() callback, which is run every
+ * period_ms and on each call to regulator_avs_trigger().  The
+ * regulator must provide a list of the voltages it supports.
+ * While the loop is running the consumer should not set the voltage
+ * of @regulator itself.
+ *
+ * Returns an ERR_PTR() on failure.
+ */
+struct regulator_avs *regulator_avs_register(struct regulator *regulator,
+				const struct regulator_avs_config *config)
+{
+	struct regulator_avs *avs;
+	int ret;
+
+	if (regulator == NULL || IS_ERR(regulator) || config->sense == NULL)
+		return ERR_PTR(-EINVAL);
+
+	avs = kzalloc(sizeof(*avs), GFP_KERNEL);
+	if (avs == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	avs->regulator = regulator;
+	avs->config = *config;
+	mutex_init(&avs->lock);
+	INIT_DELAYED_WORK(&avs->poll_work, regulator_avs_poll_work);
+	INIT_WORK(&avs->trigger_work, regulator_avs_trigger_work);
+
+	mutex_lock(&avs->lock);
+	ret = regulator_avs_load(avs, config->min_uV, config->max_uV,
+				 config->safe_uV);
+	if (ret == 0 && avs->config.period_ms)
+		schedule_delayed_work(&avs->poll_work,
+				      msecs_to_jiffies(avs->config.period_ms));
+	mutex_unlock(&avs->lock);
+
+	if (ret != 0) {
+		kfree(avs);
+		return ERR_PTR(ret);
+	}
+
+	return avs;
+}
+EXPORT_SYMBOL_GPL(regulator_avs_register);
+
+/**
+ * regulator_avs_unregister - stop adaptive voltage scaling of a supply
+ * @avs: loop to stop
+ *
+ * The supply is returned to the safe voltage.
+ */
+void regulator_avs_unregister(struct regulator_avs *avs)
+{
+	mutex_lock(&avs->lock);
+	avs->stopped = 1;
+	mutex_unlock(&avs->lock);
+
+	cancel_delayed_work_sync(&avs->poll_work);
+	cancel_work_sync(&avs->trigger_work);
+
+	if (avs->cur < avs->safe)
+		regulator_avs_set(avs, avs->safe);
+
+	kfree(avs->table);
+	kfree(avs);
+}
+EXPORT_SYMBOL_GPL(regulator_avs_unregister);
+
+/**
+ * regulator_avs_set_range - change the range the loop works within
+ * @avs: loop to update
+ * @min_uV: new minimum voltage
+ * @max_uV: new maximum voltage
+ * @safe_uV: new safe voltage
+ *
+ * Used when the operating point of the consumer changes.  The supply
+ * moves to the new safe voltage straight away and the loop then works
+ * down from there, so when raising performance this should be called
+ * before the consumer speeds up and when reducing it afterwards.
+ */
+int regulator_avs_set_range(struct regulator_avs *avs,
+			    int min_uV, int max_uV, int safe_uV)
+{
+	int ret;
+
+	mutex_lock(&avs->lock);
+	ret = regulator_avs_load(avs, min_uV, max_uV, safe_uV);
+	mutex_unlock(&avs->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_avs_set_range);
+
+/**
+ * regulator_avs_trigger - run the loop now
+ * @avs: loop to run
+ *
+ * For sensors which can signal that their reading has changed.  May be
+ * called from interrupt context, the sense() callback is run from a
+ * workqueue.
+ */
+void regulator_avs_trigger(struct regulator_avs *avs)
+{
+	schedule_work(&avs->trigger_work);
+}
+EXPORT_SYMBOL_GPL(regulator_avs_trigger);
+
+/**
+ * regulator_avs_get_voltage - get the voltage chosen by the loop
+ * @avs: loop to query
+ */
+int regulator_avs_get_voltage(struct regulator_avs *avs)
+{
+	int uV;
+
+	mutex_lock(&avs->lock);
+	uV = avs->table[avs->cur];
+	mutex_unlock(&avs->lock);
+
+	return uV;
+}
+EXPORT_SYMBOL_GPL(regulator_avs_get_voltage);
+
+MODULE_DESCRIPTION("Adaptive voltage scaling for regulator consumers");
+MODULE_LICENSE("GPL");
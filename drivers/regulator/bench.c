@@ -0,0 +1,380 @@
+/*
+ * bench.c -- benchmarks for the regulator core
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Loading this module builds a chain of depth mock regulators, each
+ * supplied by the one before, with consumers handles on the last of
+ * them.  It then times the core operations listed below, prints one
+ * line for each and tears everything down again:
+ *
+ *	get		regulator_get() of each consumer
+ *	enable_chain	enabling one consumer, powering up the whole chain
+ *	disable_chain	and powering it down again
+ *	enable_fanout	enabling every consumer of the already on leaf
+ *	disable_fanout	and disabling them again
+ *	drms		regulator_set_optimum_mode() across the idle
+ *			threshold with every consumer enabled
+ *	notify		regulator_set_voltage() with notifiers registered
+ *	put		regulator_put() of each consumer
+ *
+ * The lines have the form
+ *
+ *	regulator-bench: <test> ops <n> errors <n> avg_ns <n> max_ns <n>
+ *
+ * for scripts to compare between kernels.  The mock regulators can be
+ * given a simulated bus latency to see how the core behaves with real
+ * hardware costs.  Reload the module to run the benchmarks again.
+ */
+
+#include <linux/err.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator/machine.h>
+#include <linux/regulator/mock.h>
+
+static int depth = 8;
+module_param(depth, int, 0444);
+MODULE_PARM_DESC(depth, "Number of regulators in the supply chain");
+
+static int consumers = 64;
+module_param(consumers, int, 0444);
+MODULE_PARM_DESC(consumers, "Number of consumers of the last regulator");
+
+static int notifiers = 32;
+module_param(notifiers, int, 0444);
+MODULE_PARM_DESC(notifiers, "Number of voltage change notifiers");
+
+static int iterations = 100;
+module_param(iterations, int, 0444);
+MODULE_PARM_DESC(iterations, "Number of times each operation is repeated");
+
+static int latency_us;
+module_param(latency_us, int, 0444);
+MODULE_PARM_DESC(latency_us, "Simulated bus latency of each mock operation");
+
+#define BENCH_MIN_UV		800000
+#define BENCH_STEP_UV		25000
+#define BENCH_N_VOLTAGES	41
+#define BENCH_IDLE_UA		10000
+
+struct bench_stat {
+	unsigned int ops;
+	unsigned int errors;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+struct bench {
+	struct platform_device *consumer_dev;
+	struct regulator_consumer_supply supply;
+
+	struct platform_device **rails;
+	struct mock_regulator_config *configs;
+	char (*names)[16];
+
+	struct regulator **regs;
+	struct notifier_block *nbs;
+};
+
+static void bench_time(struct bench_stat *stat, ktime_t start, int ret)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stat->ops++;
+	if (ret < 0)
+		stat->errors++;
+	stat->total_ns += ns;
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
+}
+
+static void bench_report(const char *name, struct bench_stat *stat)
+{
+	printk(KERN_INFO "regulator-bench: %s ops %u errors %u "
+	       "avg_ns %llu max_ns %llu\n", name, stat->ops, stat->errors,
+	       stat->ops ? div_u64(stat->total_ns, stat->ops) : 0,
+	       stat->max_ns);
+	memset(stat, 0, sizeof(*stat));
+}
+
+static atomic_t bench_notified;
+
+static int bench_notify(struct notifier_block *nb, unsigned long event,
+			void *data)
+{
+	atomic_inc(&bench_notified);
+	return NOTIFY_OK;
+}
+
+static int bench_add_rail(struct bench *b, int i)
+{
+	struct regulator_init_data init;
+	struct mock_regulator_config *config = &b->configs[i];
+	struct platform_device *pdev;
+	int j, ret;
+
+	snprintf(b->names[i], sizeof(b->names[i]), "BENCH%d", i);
+	config->supply_name = b->names[i];
+	config->min_uV = BENCH_MIN_UV;
+	config->uV_step = BENCH_STEP_UV;
+	config->n_voltages = BENCH_N_VOLTAGES;
+	config->modes = REGULATOR_MODE_NORMAL | REGULATOR_MODE_IDLE;
+	config->idle_max_uA = BENCH_IDLE_UA;
+	for (j = 0; j < MOCK_REGULATOR_OP_NUM; j++)
+		config->latency_us[j] = latency_us;
+
+	memset(&init, 0, sizeof(init));
+	init.constraints.min_uV = BENCH_MIN_UV;
+	init.constraints.max_uV = BENCH_MIN_UV +
+		BENCH_STEP_UV * (BENCH_N_VOLTAGES - 1);
+	init.constraints.valid_modes_mask = config->modes;
+	init.constraints.valid_ops_mask = REGULATOR_CHANGE_STATUS |
+		REGULATOR_CHANGE_VOLTAGE | REGULATOR_CHANGE_MODE |
+		REGULATOR_CHANGE_DRMS;
+	init.driver_data = config;
+	if (i > 0)
+		init.supply_regulator_dev = &b->rails[i - 1]->dev;
+	if (i == depth - 1) {
+		init.num_consumer_supplies = 1;
+		init.consumer_supplies = &b->supply;
+	}
+
+	pdev = platform_device_alloc("reg-mock", i);
+	if (pdev == NULL)
+		return -ENOMEM;
+
+	ret = platform_device_add_data(pdev, &init, sizeof(init));
+	if (ret == 0)
+		ret = platform_device_add(pdev);
+	if (ret != 0) {
+		platform_device_put(pdev);
+		return ret;
+	}
+
+	b->rails[i] = pdev;
+	return 0;
+}
+
+static void bench_free(struct bench *b)
+{
+	int i;
+
+	if (b->rails) {
+		for (i = depth - 1; i >= 0; i--)
+			if (b->rails[i])
+				platform_device_unregister(b->rails[i]);
+	}
+	if (b->consumer_dev)
+		platform_device_unregister(b->consumer_dev);
+
+	kfree(b->nbs);
+	kfree(b->regs);
+	kfree(b->names);
+	kfree(b->configs);
+	kfree(b->rails);
+	kfree(b);
+}
+
+static struct bench *bench_build(void)
+{
+	struct bench *b;
+	int i, ret;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (b == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	b->rails = kcalloc(depth, sizeof(*b->rails), GFP_KERNEL);
+	b->configs = kcalloc(depth, sizeof(*b->configs), GFP_KERNEL);
+	b->names = kcalloc(depth, sizeof(*b->names), GFP_KERNEL);
+	b->regs = kcalloc(consumers, sizeof(*b->regs), GFP_KERNEL);
+	b->nbs = kcalloc(notifiers, sizeof(*b->nbs), GFP_KERNEL);
+	if (!b->rails || !b->configs || !b->names || !b->regs ||
+	    (notifiers && !b->nbs)) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	b->consumer_dev = platform_device_register_simple("reg-bench", -1,
+							  NULL, 0);
+	if (IS_ERR(b->consumer_dev)) {
+		ret = PTR_ERR(b->consumer_dev);
+		b->consumer_dev = NULL;
+		goto err;
+	}
+	b->supply.dev = &b->consumer_dev->dev;
+	b->supply.supply = "vbench";
+
+	for (i = 0; i < depth; i++) {
+		ret = bench_add_rail(b, i);
+		if (ret != 0)
+			goto err;
+	}
+
+	return b;
+
+err:
+	bench_free(b);
+	return ERR_PTR(ret);
+}
+
+static int bench_run(struct bench *b)
+{
+	struct bench_stat stat = { 0 };
+	ktime_t start;
+	int i, n, ret;
+
+	for (i = 0; i < consumers; i++) {
+		start = ktime_get();
+		b->regs[i] = regulator_get(&b->consumer_dev->dev, "vbench");
+		bench_time(&stat, start, 0);
+		if (IS_ERR(b->regs[i])) {
+			ret = PTR_ERR(b->regs[i]);
+			b->regs[i] = NULL;
+			printk(KERN_ERR "regulator-bench: no mock regulator, "
+			       "is the reg-mock driver loaded?\n");
+			return ret;
+		}
+	}
+	bench_report("get", &stat);
+
+	for (n = 0; n < iterations; n++) {
+		start = ktime_get();
+		ret = regulator_enable(b->regs[0]);
+		bench_time(&stat, start, ret);
+		if (ret == 0)
+			regulator_disable(b->regs[0]);
+	}
+	bench_report("enable_chain", &stat);
+
+	for (n = 0; n < iterations; n++) {
+		if (regulator_enable(b->regs[0]) != 0)
+			continue;
+		start = ktime_get();
+		ret = regulator_disable(b->regs[0]);
+		bench_time(&stat, start, ret);
+	}
+	bench_report("disable_chain", &stat);
+
+	/* the leaf stays on through the fan out tests */
+	ret = regulator_enable(b->regs[0]);
+	if (ret != 0)
+		return ret;
+
+	for (n = 0; n < iterations; n++) {
+		for (i = 1; i < consumers; i++) {
+			start = ktime_get();
+			ret = regulator_enable(b->regs[i]);
+			bench_time(&stat, start, ret);
+		}
+		for (i = 1; i < consumers; i++)
+			regulator_disable(b->regs[i]);
+	}
+	bench_report("enable_fanout", &stat);
+
+	for (n = 0; n < iterations; n++) {
+		for (i = 1; i < consumers; i++)
+			regulator_enable(b->regs[i]);
+		for (i = 1; i < consumers; i++) {
+			start = ktime_get();
+			ret = regulator_disable(b->regs[i]);
+			bench_time(&stat, start, ret);
+		}
+	}
+	bench_report("disable_fanout", &stat);
+
+	/* alternate the total load either side of the idle threshold */
+	for (i = 1; i < consumers; i++)
+		regulator_enable(b->regs[i]);
+	for (n = 0; n < iterations; n++) {
+		for (i = 0; i < consumers; i++) {
+			start = ktime_get();
+			ret = regulator_set_optimum_mode(b->regs[i],
+				n & 1 ? BENCH_IDLE_UA : 0);
+			bench_time(&stat, start, ret);
+		}
+	}
+	for (i = 0; i < consumers; i++)
+		regulator_set_optimum_mode(b->regs[i], 0);
+	for (i = 1; i < consumers; i++)
+		regulator_disable(b->regs[i]);
+	bench_report("drms", &stat);
+
+	for (i = 0; i < notifiers; i++) {
+		b->nbs[i].notifier_call = bench_notify;
+		regulator_register_notifier(b->regs[0], &b->nbs[i]);
+	}
+	atomic_set(&bench_notified, 0);
+	for (n = 0; n < iterations; n++) {
+		int uV = BENCH_MIN_UV + (n & 1 ? 8 : 16) * BENCH_STEP_UV;
+
+		start = ktime_get();
+		ret = regulator_set_voltage(b->regs[0], uV, uV);
+		bench_time(&stat, start, ret);
+	}
+	for (i = 0; i < notifiers; i++)
+		regulator_unregister_notifier(b->regs[0], &b->nbs[i]);
+	printk(KERN_INFO "regulator-bench: notify delivered %d events to "
+	       "%d notifiers\n", atomic_read(&bench_notified), notifiers);
+	bench_report("notify", &stat);
+
+	regulator_disable(b->regs[0]);
+
+	for (i = 0; i < consumers; i++) {
+		start = ktime_get();
+		regulator_put(b->regs[i]);
+		bench_time(&stat, start, 0);
+		b->regs[i] = NULL;
+	}
+	bench_report("put", &stat);
+
+	return 0;
+}
+
+static int __init regulator_bench_init(void)
+{
+	struct bench *b;
+	int i, ret;
+
+	if (depth < 1 || consumers < 1 || notifiers < 0 || iterations < 1)
+		return -EINVAL;
+
+	printk(KERN_INFO "regulator-bench: depth %d consumers %d "
+	       "notifiers %d iterations %d latency_us %d\n",
+	       depth, consumers, notifiers, iterations, latency_us);
+
+	b = bench_build();
+	if (IS_ERR(b))
+		return PTR_ERR(b);
+
+	ret = bench_run(b);
+
+	/* anything left over if a benchmark gave up */
+	for (i = 0; i < consumers; i++)
+		regulator_put(b->regs[i]);
+
+	bench_free(b);
+
+	return ret;
+}
+module_init(regulator_bench_init);
+
+static void __exit regulator_bench_exit(void)
+{
+}
+module_exit(regulator_bench_exit);
+
+MODULE_DESCRIPTION("Regulator core benchmarks");
+MODULE_LICENSE("GPL");
@@ -24,11 +24,14 @@ static int bq24022_set_current_limit(struct regulator_dev *rdev,
 {
 	struct bq24022_mach_info *pdata = rdev_get_drvdata(rdev);
 
+	/* ISET2 selects between the two USB limits, there's nothing lower */
+	if (max_uA < 100000)
+		return -EINVAL;
+
 	dev_dbg(rdev_get_dev(rdev), "setting current limit to %s mA\n",
 		max_uA >= 500000 ? "500" : "100");
 
-	/* REVISIT: maybe return error if min_uA != 0 ? */
-	gpio_set_value(pdata->gpio_iset2, max_uA >= 500000);
+	gpio_set_value_cansleep(pdata->gpio_iset2, max_uA >= 500000);
 	return 0;
 }
 
@@ -36,7 +39,7 @@ static int bq24022_get_current_limit(struct regulator_dev *rdev)
 {
 	struct bq24022_mach_info *pdata = rdev_get_drvdata(rdev);
 
-	return gpio_get_value(pdata->gpio_iset2) ? 500000 : 100000;
+	return gpio_get_value_cansleep(pdata->gpio_iset2) ? 500000 : 100000;
 }
 
 static int bq24022_enable(struct regulator_dev *rdev)
@@ -45,7 +48,7 @@ static int bq24022_enable(struct regulator_dev *rdev)
 
 	dev_dbg(rdev_get_dev(rdev), "enabling charger\n");
 
-	gpio_set_value(pdata->gpio_nce, 0);
+	gpio_set_value_cansleep(pdata->gpio_nce, 0);
 	return 0;
 }
 
@@ -55,16 +58,15 @@ static int bq24022_disable(struct regulator_dev *rdev)
 
 	dev_dbg(rdev_get_dev(rdev), "disabling charger\n");
 
-	gpio_set_value(pdata->gpio_nce, 1);
+	gpio_set_value_cansleep(pdata->gpio_nce, 1);
 	return 0;
 }
 
 static int bq24022_is_enabled(struct regulator_dev *rdev)
 {
-	struct platform_device *pdev = rdev_get_drvdata(rdev);
-	struct bq24022_mach_info *pdata = pdev->dev.platform_data;
+	struct bq24022_mach_info *pdata = rdev_get_drvdata(rdev);
 
-	return !gpio_get_value(pdata->gpio_nce);
+	return !gpio_get_value_cansleep(pdata->gpio_nce);
 }
 
 static struct regulator_ops bq24022_ops = {
@@ -18,21 +18,201 @@
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/rculist.h>
+#include <linux/srcu.h>
+#include <linux/jhash.h>
 #include <linux/suspend.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/interrupt.h>
+#include <linux/leds.h>
+#include <linux/pm_runtime.h>
+#include <linux/pm_qos_params.h>
+#include <linux/fault-inject.h>
+#include <linux/uaccess.h>
 #include <linux/regulator/consumer.h>
 #include <linux/regulator/driver.h>
 #include <linux/regulator/machine.h>
+#include <trace/regulator.h>
+
+#include "dummy.h"
 
 #define REGULATOR_VERSION "0.5"
 
+DEFINE_TRACE(regulator_enable);
+DEFINE_TRACE(regulator_enable_complete);
+DEFINE_TRACE(regulator_disable);
+DEFINE_TRACE(regulator_disable_complete);
+DEFINE_TRACE(regulator_set_voltage);
+DEFINE_TRACE(regulator_set_voltage_complete);
+DEFINE_TRACE(regulator_set_mode);
+DEFINE_TRACE(regulator_set_mode_complete);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_enable);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_enable_complete);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_disable);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_disable_complete);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_set_voltage);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_set_voltage_complete);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_set_mode);
+EXPORT_TRACEPOINT_SYMBOL_GPL(regulator_set_mode_complete);
+
+/*
+ * regulator_list and the supply lists are updated with regulator_list_mutex
+ * held.  Readers which only report on or reconfigure the regulators already
+ * there walk them under regulator_list_srcu instead, so they don't hold up
+ * registration, and regulator_unregister() waits for them before the
+ * regulator goes away.  Supply lookups likewise walk the map under RCU.
+ */
 static DEFINE_MUTEX(regulator_list_mutex);
+static DEFINE_MUTEX(regulator_coupled_mutex); /* coupled rail pairs */
 static LIST_HEAD(regulator_list);
+static struct srcu_struct regulator_list_srcu;
+static LIST_HEAD(regulator_domain_list);	/* regulator_list_mutex */
+static int regulator_profile;	/* REGULATOR_PROFILE_*, regulator_list_mutex */
+
+/* boot time constraints left to apply, see regulator_defer_constraints() */
+static int regulator_defer;	/* regulator_list_mutex */
+static LIST_HEAD(regulator_init_list);
+
 static LIST_HEAD(regulator_map_list);
 
+/* supply lookups are hashed on consumer device and supply name */
+#define REGULATOR_MAP_HASH_BITS	6
+#define REGULATOR_MAP_HASH_SIZE	(1 << REGULATOR_MAP_HASH_BITS)
+static struct hlist_head regulator_map_hash[REGULATOR_MAP_HASH_SIZE];
+static DEFINE_SPINLOCK(regulator_map_lock); /* serialises map updates */
+
+static struct workqueue_struct *regulator_wq;
+
+/* Parallel bulk and sequence operations are waited for by callers which
+ * may themselves be running on regulator_wq, such as event notifiers and
+ * async callbacks, so they get a workqueue of their own that only runs
+ * regulator operations and never waits on anything queued behind it. */
+static struct workqueue_struct *regulator_parallel_wq;
+
+/* regulator_ops callbacks we account latency for */
+enum regulator_op {
+	REGULATOR_OP_ENABLE,
+	REGULATOR_OP_DISABLE,
+	REGULATOR_OP_IS_ENABLED,
+	REGULATOR_OP_SET_VOLTAGE,
+	REGULATOR_OP_GET_VOLTAGE,
+	REGULATOR_OP_SET_CURRENT_LIMIT,
+	REGULATOR_OP_GET_CURRENT_LIMIT,
+	REGULATOR_OP_SET_MODE,
+	REGULATOR_OP_GET_MODE,
+	REGULATOR_OP_SET_CONFIG,
+	REGULATOR_OP_NUM,
+};
+
+static const char *regulator_op_names[REGULATOR_OP_NUM] = {
+	[REGULATOR_OP_ENABLE] = "enable",
+	[REGULATOR_OP_DISABLE] = "disable",
+	[REGULATOR_OP_IS_ENABLED] = "is_enabled",
+	[REGULATOR_OP_SET_VOLTAGE] = "set_voltage",
+	[REGULATOR_OP_GET_VOLTAGE] = "get_voltage",
+	[REGULATOR_OP_SET_CURRENT_LIMIT] = "set_current_limit",
+	[REGULATOR_OP_GET_CURRENT_LIMIT] = "get_current_limit",
+	[REGULATOR_OP_SET_MODE] = "set_mode",
+	[REGULATOR_OP_GET_MODE] = "get_mode",
+	[REGULATOR_OP_SET_CONFIG] = "set_config",
+};
+
+struct regulator_op_stats {
+	unsigned long count;
+	unsigned long errors;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+};
+
+/* recent operations on a regulator, kept for post mortem debugging */
+#define REGULATOR_HISTORY_LEN	16	/* must be a power of two */
+#define REGULATOR_HISTORY_NAME	16
+
+struct regulator_history_entry {
+	s64 time_ns;
+	enum regulator_op op;
+	int value;		/* value being set, 0 for reads */
+	int ret;
+	char consumer[REGULATOR_HISTORY_NAME];	/* empty if from the core */
+};
+
+/* energy used by a regulator or consumer, integrated on each change */
+struct regulator_energy {
+	u64 uJ;			/* energy used up to last_ns */
+	u32 rem_pJ;		/* and the part not yet a whole uJ */
+	unsigned int uW;	/* power drawn since last_ns */
+	s64 last_ns;		/* time of the last change, 0 if never */
+};
+
+/**
+ * struct regulator_stats
+ *
+ * Runtime statistics for a regulator, exported via sysfs.
+ */
+struct regulator_stats {
+	spinlock_t lock;
+	u64 enabled_ns;		/* total time spent enabled */
+	s64 enabled_since;	/* start of current enabled period or 0 */
+	struct regulator_op_stats op[REGULATOR_OP_NUM];
+	unsigned long lock_contended;	/* times rdev->mutex was busy */
+	u64 lock_wait_ns;	/* total time spent waiting for it */
+	struct regulator_energy energy;	/* at our output */
+};
+
+/*
+ * The machine constraints reduced to what the consumer operation checks
+ * need, see regulator_digest_constraints().  All zero without
+ * constraints so that nothing is permitted.
+ */
+struct regulator_limits {
+	unsigned int ops;	/* REGULATOR_CHANGE_ operations permitted */
+	unsigned int modes;	/* REGULATOR_MODE_ modes permitted */
+	int min_uV;		/* constraints intersected with the */
+	int max_uV;		/* voltages the hardware can produce */
+	int min_uA;
+	int max_uA;
+};
+
+/*
+ * An LED trigger following the state of a regulator.  Until an LED
+ * is assigned to the trigger the core doesn't touch it, so unused
+ * triggers cost no more than a test of users.
+ */
+struct regulator_led {
+	struct led_trigger trig;
+	struct regulator_dev *rdev;
+	atomic_t users;		/* LEDs using the trigger */
+	int fault;		/* follows faults rather than the output */
+};
+
 /**
  * struct regulator_dev
  *
  * Voltage / Current regulator class device. One for each regulator.
+ *
+ * Locking: config_lock serialises consumers being added and removed,
+ * along with their sysfs entries, and may sleep for some time.  mutex
+ * protects the regulator state - hardware operations, use_count, the
+ * cached values and consumer requests - and is held only briefly.
+ * consumer_list is modified with both held and may be walked with
+ * either.  Likewise supply_list is modified with regulator_list_mutex
+ * and the lock of our domain held, so consumer operations walking it
+ * take only the domain lock, and readers may also use
+ * regulator_list_srcu.  Locks are always taken in the order
+ * regulator_list_mutex, regulator_coupled_mutex, config_lock, mutex and
+ * a regulator's mutex is taken before that of its supply, never after;
+ * depth is used to tell lockdep about the nesting.  The mutex of a
+ * coupled regulator may be taken inside ours, but only with
+ * regulator_coupled_mutex held.  Domain locks nest inside everything.
  */
 struct regulator_dev {
 	struct regulator_desc *desc;
@@ -41,21 +221,96 @@ struct regulator_dev {
 	/* lists we belong to */
 	struct list_head list; /* list of all regulators */
 	struct list_head slist; /* list of supplied regulators */
+	struct list_head init_list; /* constraints not yet applied */
 
 	/* lists we own */
 	struct list_head consumer_list; /* consumers we supply */
 	struct list_head supply_list; /* regulators we supply */
 
 	struct blocking_notifier_head notifier;
-	struct mutex mutex; /* consumer lock */
+	spinlock_t event_lock;	/* protects the pending events */
+	unsigned long pending_events;	/* raised by the regulator itself */
+	unsigned long supply_events;	/* passed down from our supply */
+	struct work_struct event_work;
+
+	/* fault handling, see regulator_handle_fault() */
+	int fault_off;		/* output turned off by a fault */
+	int fault_count;	/* faults since the consumers last let go */
+	struct delayed_work fault_work;	/* pending re-enable or unmask */
+	struct list_head fault_irqs;	/* from regulator_request_fault_irq() */
+	unsigned long fault_unmasked;	/* jiffies the fault IRQs came back */
+	int fault_backoff;	/* shift applied to the unmask delay */
+
+	struct mutex config_lock; /* consumer list and sysfs lock */
+	struct mutex mutex; /* state lock */
 	struct module *owner;
 	struct device dev;
 	struct regulation_constraints *constraints;
+	struct regulation_constraints *profiles[REGULATOR_NUM_PROFILES];
+	struct regulator_limits limits;	/* digest of constraints */
 	struct regulator_dev *supply;	/* for tree */
+	struct device *supply_dev;	/* supply not yet registered */
+	struct regulator_dev *coupled;	/* kept within max_spread_uV of us */
+	struct regulator_domain *domain;	/* shared with our PMIC */
+	int depth;		/* number of supplies above us */
+	struct regulator_sequence sequence;	/* machine power sequence */
+	int seq_enabled;	/* enabled by regulator_sequence_power_up() */
+	int suspend_prepared;	/* suspend state set for the current suspend */
+	int init_pending;	/* constraints to apply once registered */
+
+	int cached_uV;		/* last output voltage read, 0 if unknown */
+	int enabled_state;	/* hardware enable state, -1 if unknown */
+	int req_min_uV;		/* aggregate consumer voltage range */
+	int req_max_uV;		/* last applied to the hardware */
+	int selector;		/* last voltage selector set, -1 if unknown */
+	int preload_sel;	/* selector loaded for switching, -1 if none */
+	int min_uA;		/* last current limit range set, */
+	int max_uA;		/* 0 if unknown */
+	int child_uA;		/* load drawn by regulators we supply */
+	int supply_uA;		/* load we place on our supply */
+	int supply_min_uV;	/* voltage we need from our supply, 0 if none,
+				 * written with the supply locked */
+	int enabling;		/* counted by our supply while it is raised
+				 * for our enable, written with it locked */
+	unsigned int mode;	/* last mode set by the core, 0 if unknown */
+	unsigned long mode_changed;	/* jiffies at last mode change */
+	struct delayed_work drms_work;	/* deferred DRMS re-evaluation */
+
+	struct regulator_stats stats;
+
+	/* written with mutex held, may be read at any time */
+	struct regulator *requester;	/* consumer being serviced or NULL */
+	unsigned int history_next;	/* number of entries ever written */
+	struct regulator_history_entry *history; /* NULL for fixed regulators */
+
+#ifdef CONFIG_FAIL_REGULATOR
+	unsigned int fail_ops;	/* (1 << op) for operations to fail */
+	struct dentry *fail_dir;
+#endif
+
+#ifdef CONFIG_REGULATOR_LEDS
+	struct regulator_led led_on;	/* lit while the output is on */
+	struct regulator_led led_fault;	/* lit from a fault until cleared */
+#endif
 
 	void *reg_data;		/* regulator_dev data */
 };
 
+/*
+ * struct regulator_domain
+ *
+ * Regulators are grouped into locking domains, one for each PMIC, so
+ * that consumers of rails on different chips, and usually different
+ * buses, never wait on one another.  Only registration and machine
+ * wide operations take the global regulator_list_mutex.
+ */
+struct regulator_domain {
+	struct list_head list;	/* on regulator_domain_list */
+	void *pmic;		/* regulator_pmic() of the members */
+	int users;		/* members, regulator_list_mutex */
+	struct mutex lock;	/* supply_list of the members */
+};
+
 /**
  * struct regulator_map
  *
@@ -63,56 +318,312 @@ struct regulator_dev {
  */
 struct regulator_map {
 	struct list_head list;
+	struct hlist_node hlist;
 	struct device *dev;
 	const char *supply;
 	struct regulator_dev *regulator;
 };
 
+#define REG_STR_SIZE	32
+
+#ifdef CONFIG_REGULATOR_CONSUMER_SYSFS
+/*
+ * struct regulator_sysfs
+ *
+ * Debug sysfs entries for a consumer, only allocated when enabled.
+ */
+struct regulator_sysfs {
+	struct regulator *regulator;
+	struct device_attribute dev_attr;
+	char attr_name[REG_STR_SIZE];	/* microamps_requested_<supply> */
+	char link_name[REG_STR_SIZE];	/* <device>-<supply> */
+};
+#endif
+
 /*
  * struct regulator
  *
  * One for each consumer device.
  */
 struct regulator {
-	struct device *dev;
 	struct list_head list;
+	struct regulator_dev *rdev;
+	struct device *dev;
 	int uA_load;
 	int min_uV;
 	int max_uV;
-	int enabled; /* client has called enabled */
-	char *supply_name;
-	struct device_attribute dev_attr;
-	struct regulator_dev *rdev;
+	int min_uA; /* requested current limit, max_uA 0 if none */
+	int max_uA;
+	unsigned int mode; /* requested with regulator_set_mode(), 0 if none */
+	int enable_count; /* unbalanced regulator_enable() calls */
+	unsigned int disable_pending:1; /* deferred disable scheduled */
+	struct delayed_work disable_work;
+
+	/* regulator_enable_async() and regulator_disable_async() */
+	unsigned long async_pending;	/* bit 0 set while one is queued */
+	struct work_struct async_work;
+	int async_enable;
+	void (*async_done)(struct regulator *regulator, int ret, void *data);
+	void *async_data;
+	struct regulator_energy energy; /* protected by rdev->stats.lock */
+#ifdef CONFIG_REGULATOR_CONSUMER_SYSFS
+	struct regulator_sysfs *sysfs;
+#endif
 };
 
 static int _regulator_is_enabled(struct regulator_dev *rdev);
+static int _regulator_enable(struct regulator_dev *rdev);
 static int _regulator_disable(struct regulator_dev *rdev);
 static int _regulator_get_voltage(struct regulator_dev *rdev);
+static int _regulator_can_get_voltage(struct regulator_dev *rdev);
+static int _regulator_apply_voltage(struct regulator_dev *rdev,
+				    struct regulator *regulator);
 static int _regulator_get_current_limit(struct regulator_dev *rdev);
+static int _regulator_apply_current(struct regulator_dev *rdev,
+				    struct regulator *regulator);
+static void drms_uA_update(struct regulator_dev *rdev);
+static int _regulator_get_load(struct regulator_dev *rdev);
+static int regulator_is_coupled(struct regulator_dev *rdev);
+static int _regulator_get_headroom(struct regulator_dev *rdev);
 static unsigned int _regulator_get_mode(struct regulator_dev *rdev);
-static void _notifier_call_chain(struct regulator_dev *rdev,
-				  unsigned long event, void *data);
+static void regulator_post_event(struct regulator_dev *rdev,
+				 unsigned long event);
+static void regulator_clear_fault(struct regulator_dev *rdev);
+static void *regulator_pmic(struct regulator_dev *rdev);
+static void regulator_stats_op(struct regulator_dev *rdev,
+			       enum regulator_op op, int value, s64 start,
+			       int ret);
 
-/* gets the regulator for a given consumer device */
-static struct regulator *get_device_regulator(struct device *dev)
+#ifdef CONFIG_FAIL_REGULATOR
+
+static DECLARE_FAULT_ATTR(fail_regulator);
+
+static int __init setup_fail_regulator(char *str)
 {
-	struct regulator *regulator = NULL;
-	struct regulator_dev *rdev;
+	return setup_fault_attr(&fail_regulator, str);
+}
+__setup("fail_regulator=", setup_fail_regulator);
 
-	mutex_lock(&regulator_list_mutex);
-	list_for_each_entry(rdev, &regulator_list, list) {
-		mutex_lock(&rdev->mutex);
-		list_for_each_entry(regulator, &rdev->consumer_list, list) {
-			if (regulator->dev == dev) {
-				mutex_unlock(&rdev->mutex);
-				mutex_unlock(&regulator_list_mutex);
-				return regulator;
-			}
-		}
-		mutex_unlock(&rdev->mutex);
+/* should the operation be failed, get_mode() has no way to report it */
+static bool regulator_should_fail(struct regulator_dev *rdev,
+				  enum regulator_op op)
+{
+	if (!(rdev->fail_ops & (1 << op)) || op == REGULATOR_OP_GET_MODE)
+		return false;
+
+	return should_fail(&fail_regulator, 1);
+}
+
+static void regulator_fail_add(struct regulator_dev *rdev);
+static void regulator_fail_remove(struct regulator_dev *rdev);
+
+#else
+
+static inline bool regulator_should_fail(struct regulator_dev *rdev,
+					 enum regulator_op op)
+{
+	return false;
+}
+
+static inline void regulator_fail_add(struct regulator_dev *rdev)
+{
+}
+
+static inline void regulator_fail_remove(struct regulator_dev *rdev)
+{
+}
+
+#endif /* CONFIG_FAIL_REGULATOR */
+
+#ifdef CONFIG_REGULATOR_LEDS
+
+static void regulator_led_activate(struct led_classdev *led_cdev)
+{
+	struct regulator_led *led = container_of(led_cdev->trigger,
+						 struct regulator_led, trig);
+	struct regulator_dev *rdev = led->rdev;
+	int on;
+
+	atomic_inc(&led->users);
+
+	/* events only report changes so start from the current state */
+	if (led->fault)
+		on = ACCESS_ONCE(rdev->fault_off) ||
+			ACCESS_ONCE(rdev->fault_count);
+	else
+		on = _regulator_is_enabled(rdev) > 0;
+
+	/* the new LED is already on the trigger's list */
+	led_trigger_event(&led->trig, on ? LED_FULL : LED_OFF);
+}
+
+static void regulator_led_deactivate(struct led_classdev *led_cdev)
+{
+	struct regulator_led *led = container_of(led_cdev->trigger,
+						 struct regulator_led, trig);
+
+	atomic_dec(&led->users);
+}
+
+static void regulator_led_event(struct regulator_led *led, int on)
+{
+	if (atomic_read(&led->users))
+		led_trigger_event(&led->trig, on ? LED_FULL : LED_OFF);
+}
+
+static int regulator_led_register(struct regulator_dev *rdev,
+				  struct regulator_led *led,
+				  const char *suffix, int fault)
+{
+	led->trig.name = kasprintf(GFP_KERNEL, "%s-%s", rdev->desc->name,
+				   suffix);
+	if (!led->trig.name)
+		return -ENOMEM;
+
+	led->trig.activate = regulator_led_activate;
+	led->trig.deactivate = regulator_led_deactivate;
+	led->rdev = rdev;
+	led->fault = fault;
+	atomic_set(&led->users, 0);
+
+	return led_trigger_register(&led->trig);
+}
+
+static void regulator_led_unregister(struct regulator_led *led)
+{
+	if (!led->trig.name)
+		return;
+
+	led_trigger_unregister(&led->trig);
+	kfree(led->trig.name);
+	led->trig.name = NULL;
+}
+
+/* the LEDs are only for diagnostics so the regulator works without */
+static void regulator_leds_add(struct regulator_dev *rdev)
+{
+	if (regulator_led_register(rdev, &rdev->led_on, "on", 0) ||
+	    regulator_led_register(rdev, &rdev->led_fault, "fault", 1))
+		printk(KERN_WARNING "%s: failed to add LED triggers for %s\n",
+		       __func__, rdev->desc->name);
+}
+
+static void regulator_leds_remove(struct regulator_dev *rdev)
+{
+	regulator_led_unregister(&rdev->led_fault);
+	regulator_led_unregister(&rdev->led_on);
+}
+
+static void regulator_led_on(struct regulator_dev *rdev, int on)
+{
+	regulator_led_event(&rdev->led_on, on);
+}
+
+static void regulator_led_fault(struct regulator_dev *rdev, int on)
+{
+	regulator_led_event(&rdev->led_fault, on);
+}
+
+#else
+
+static inline void regulator_leds_add(struct regulator_dev *rdev)
+{
+}
+
+static inline void regulator_leds_remove(struct regulator_dev *rdev)
+{
+}
+
+static inline void regulator_led_on(struct regulator_dev *rdev, int on)
+{
+}
+
+static inline void regulator_led_fault(struct regulator_dev *rdev, int on)
+{
+}
+
+#endif /* CONFIG_REGULATOR_LEDS */
+
+/* call a regulator_ops callback, accounting its latency and noting it in
+ * the history along with the value being set.  Injected faults fail the
+ * operation with -EIO without calling the driver. */
+#define rdev_op(rdev, op, value, call) ({				\
+	s64 __start = ktime_to_ns(ktime_get());				\
+	typeof(call) __ret = regulator_should_fail(rdev, op) ?		\
+		(typeof(call))-EIO : (call);				\
+	regulator_stats_op(rdev, op, value, __start, (int)__ret);	\
+	__ret;								\
+})
+
+/* more steps than any sane pair of coupled rails needs */
+#define REGULATOR_COUPLED_MAX_STEPS	32
+
+/* lockdep subclass for a coupled regulator, the ones below are depths */
+#define REGULATOR_COUPLED_SUBCLASS	(MAX_LOCKDEP_SUBCLASSES - 1)
+
+/* take rdev->mutex, accounting any time spent waiting for it */
+static void regulator_lock(struct regulator_dev *rdev)
+{
+	unsigned long flags;
+	s64 start;
+
+	if (mutex_trylock(&rdev->mutex))
+		return;
+
+	start = ktime_to_ns(ktime_get());
+	mutex_lock_nested(&rdev->mutex,
+			  min_t(int, rdev->depth, REGULATOR_COUPLED_SUBCLASS - 1));
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	rdev->stats.lock_contended++;
+	rdev->stats.lock_wait_ns += ktime_to_ns(ktime_get()) - start;
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+}
+
+/* release a regulator taken with regulator_lock() */
+static void regulator_unlock(struct regulator_dev *rdev)
+{
+	mutex_unlock(&rdev->mutex);
+}
+
+/* lock the regulator on behalf of a consumer, noting it in the history */
+static void regulator_lock_consumer(struct regulator *regulator)
+{
+	/* a voltage change may need to move the coupled regulator too */
+	if (regulator->rdev->constraints &&
+	    regulator->rdev->constraints->max_spread_uV)
+		mutex_lock(&regulator_coupled_mutex);
+	regulator_lock(regulator->rdev);
+	regulator->rdev->requester = regulator;
+}
+
+static void regulator_unlock_consumer(struct regulator *regulator)
+{
+	regulator->rdev->requester = NULL;
+	regulator_unlock(regulator->rdev);
+	if (regulator->rdev->constraints &&
+	    regulator->rdev->constraints->max_spread_uV)
+		mutex_unlock(&regulator_coupled_mutex);
+}
+
+/*
+ * The constraint checks run on every consumer request so they only
+ * look at rdev->limits.  Consumers are expected to cope with refused
+ * requests, so these are not logged unless debugging.
+ */
+
+/* the reason a permission test failed */
+static int regulator_check_denied(struct regulator_dev *rdev)
+{
+	if (!rdev->constraints) {
+		pr_debug("regulator: no constraints for %s\n",
+			 rdev->desc->name);
+		return -ENODEV;
 	}
-	mutex_unlock(&regulator_list_mutex);
-	return NULL;
+
+	pr_debug("regulator: operation not allowed for %s\n",
+		 rdev->desc->name);
+	return -EPERM;
 }
 
 /* Platform voltage constraint check */
@@ -121,21 +632,11 @@ static int regulator_check_voltage(struct regulator_dev *rdev,
 {
 	BUG_ON(*min_uV > *max_uV);
 
-	if (!rdev->constraints) {
-		printk(KERN_ERR "%s: no constraints for %s\n", __func__,
-		       rdev->desc->name);
-		return -ENODEV;
-	}
-	if (!(rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_VOLTAGE)) {
-		printk(KERN_ERR "%s: operation not allowed for %s\n",
-		       __func__, rdev->desc->name);
-		return -EPERM;
-	}
+	if (!(rdev->limits.ops & REGULATOR_CHANGE_VOLTAGE))
+		return regulator_check_denied(rdev);
 
-	if (*max_uV > rdev->constraints->max_uV)
-		*max_uV = rdev->constraints->max_uV;
-	if (*min_uV < rdev->constraints->min_uV)
-		*min_uV = rdev->constraints->min_uV;
+	*min_uV = max(*min_uV, rdev->limits.min_uV);
+	*max_uV = min(*max_uV, rdev->limits.max_uV);
 
 	if (*min_uV > *max_uV)
 		return -EINVAL;
@@ -149,21 +650,11 @@ static int regulator_check_current_limit(struct regulator_dev *rdev,
 {
 	BUG_ON(*min_uA > *max_uA);
 
-	if (!rdev->constraints) {
-		printk(KERN_ERR "%s: no constraints for %s\n", __func__,
-		       rdev->desc->name);
-		return -ENODEV;
-	}
-	if (!(rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_CURRENT)) {
-		printk(KERN_ERR "%s: operation not allowed for %s\n",
-		       __func__, rdev->desc->name);
-		return -EPERM;
-	}
+	if (!(rdev->limits.ops & REGULATOR_CHANGE_CURRENT))
+		return regulator_check_denied(rdev);
 
-	if (*max_uA > rdev->constraints->max_uA)
-		*max_uA = rdev->constraints->max_uA;
-	if (*min_uA < rdev->constraints->min_uA)
-		*min_uA = rdev->constraints->min_uA;
+	*min_uA = max(*min_uA, rdev->limits.min_uA);
+	*max_uA = min(*max_uA, rdev->limits.max_uA);
 
 	if (*min_uA > *max_uA)
 		return -EINVAL;
@@ -174,19 +665,12 @@ static int regulator_check_current_limit(struct regulator_dev *rdev,
 /* operating mode constraint check */
 static int regulator_check_mode(struct regulator_dev *rdev, int mode)
 {
-	if (!rdev->constraints) {
-		printk(KERN_ERR "%s: no constraints for %s\n", __func__,
-		       rdev->desc->name);
-		return -ENODEV;
-	}
-	if (!(rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_MODE)) {
-		printk(KERN_ERR "%s: operation not allowed for %s\n",
-		       __func__, rdev->desc->name);
-		return -EPERM;
-	}
-	if (!(rdev->constraints->valid_modes_mask & mode)) {
-		printk(KERN_ERR "%s: invalid mode %x for %s\n",
-		       __func__, mode, rdev->desc->name);
+	if (!(rdev->limits.ops & REGULATOR_CHANGE_MODE))
+		return regulator_check_denied(rdev);
+
+	if (!(rdev->limits.modes & mode)) {
+		pr_debug("regulator: invalid mode %x for %s\n",
+			 mode, rdev->desc->name);
 		return -EINVAL;
 	}
 	return 0;
@@ -195,40 +679,26 @@ static int regulator_check_mode(struct regulator_dev *rdev, int mode)
 /* dynamic regulator mode switching constraint check */
 static int regulator_check_drms(struct regulator_dev *rdev)
 {
-	if (!rdev->constraints) {
-		printk(KERN_ERR "%s: no constraints for %s\n", __func__,
-		       rdev->desc->name);
-		return -ENODEV;
-	}
-	if (!(rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_DRMS)) {
-		printk(KERN_ERR "%s: operation not allowed for %s\n",
-		       __func__, rdev->desc->name);
-		return -EPERM;
-	}
+	if (!(rdev->limits.ops & REGULATOR_CHANGE_DRMS))
+		return regulator_check_denied(rdev);
 	return 0;
 }
 
-static ssize_t device_requested_uA_show(struct device *dev,
-			     struct device_attribute *attr, char *buf)
-{
-	struct regulator *regulator;
-
-	regulator = get_device_regulator(dev);
-	if (regulator == NULL)
-		return 0;
-
-	return sprintf(buf, "%d\n", regulator->uA_load);
-}
-
 static ssize_t regulator_uV_show(struct device *dev,
 				struct device_attribute *attr, char *buf)
 {
 	struct regulator_dev *rdev = dev_get_drvdata(dev);
 	ssize_t ret;
+	int uV;
 
-	mutex_lock(&rdev->mutex);
+	/* avoid waiting behind a slow operation when the voltage is known */
+	uV = ACCESS_ONCE(rdev->cached_uV);
+	if (uV > 0)
+		return sprintf(buf, "%d\n", uV);
+
+	regulator_lock(rdev);
 	ret = sprintf(buf, "%d\n", _regulator_get_voltage(rdev));
-	mutex_unlock(&rdev->mutex);
+	regulator_unlock(rdev);
 
 	return ret;
 }
@@ -341,10 +811,26 @@ static ssize_t regulator_total_uA_show(struct device *dev,
 	struct regulator *regulator;
 	int uA = 0;
 
-	mutex_lock(&rdev->mutex);
+	mutex_lock(&rdev->config_lock);
 	list_for_each_entry(regulator, &rdev->consumer_list, list)
 	    uA += regulator->uA_load;
-	mutex_unlock(&rdev->mutex);
+	mutex_unlock(&rdev->config_lock);
+	return sprintf(buf, "%d\n", uA);
+}
+
+static ssize_t regulator_headroom_uA_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	int uA;
+
+	regulator_lock(rdev);
+	uA = _regulator_get_headroom(rdev);
+	regulator_unlock(rdev);
+
+	if (uA == INT_MAX)
+		return sprintf(buf, "unlimited\n");
 	return sprintf(buf, "%d\n", uA);
 }
 
@@ -448,6 +934,16 @@ static ssize_t regulator_suspend_standby_mode_show(struct device *dev,
 		rdev->constraints->state_standby.mode, buf);
 }
 
+static ssize_t regulator_print_suspend_state(char *buf,
+					     struct regulator_state *state)
+{
+	if (state->enabled)
+		return sprintf(buf, "enabled\n");
+	if (state->disabled)
+		return sprintf(buf, "disabled\n");
+	return sprintf(buf, "not defined\n");
+}
+
 static ssize_t regulator_suspend_mem_state_show(struct device *dev,
 				   struct device_attribute *attr, char *buf)
 {
@@ -456,10 +952,8 @@ static ssize_t regulator_suspend_mem_state_show(struct device *dev,
 	if (!rdev->constraints)
 		return sprintf(buf, "not defined\n");
 
-	if (rdev->constraints->state_mem.enabled)
-		return sprintf(buf, "enabled\n");
-	else
-		return sprintf(buf, "disabled\n");
+	return regulator_print_suspend_state(buf,
+					     &rdev->constraints->state_mem);
 }
 
 static ssize_t regulator_suspend_disk_state_show(struct device *dev,
@@ -470,10 +964,8 @@ static ssize_t regulator_suspend_disk_state_show(struct device *dev,
 	if (!rdev->constraints)
 		return sprintf(buf, "not defined\n");
 
-	if (rdev->constraints->state_disk.enabled)
-		return sprintf(buf, "enabled\n");
-	else
-		return sprintf(buf, "disabled\n");
+	return regulator_print_suspend_state(buf,
+					     &rdev->constraints->state_disk);
 }
 
 static ssize_t regulator_suspend_standby_state_show(struct device *dev,
@@ -484,1401 +976,5697 @@ static ssize_t regulator_suspend_standby_state_show(struct device *dev,
 	if (!rdev->constraints)
 		return sprintf(buf, "not defined\n");
 
-	if (rdev->constraints->state_standby.enabled)
-		return sprintf(buf, "enabled\n");
-	else
-		return sprintf(buf, "disabled\n");
+	return regulator_print_suspend_state(buf,
+					     &rdev->constraints->state_standby);
 }
 
+/* attributes which make sense for every regulator */
 static struct device_attribute regulator_dev_attrs[] = {
 	__ATTR(name, 0444, regulator_name_show, NULL),
-	__ATTR(microvolts, 0444, regulator_uV_show, NULL),
-	__ATTR(microamps, 0444, regulator_uA_show, NULL),
-	__ATTR(opmode, 0444, regulator_opmode_show, NULL),
 	__ATTR(state, 0444, regulator_state_show, NULL),
-	__ATTR(min_microvolts, 0444, regulator_min_uV_show, NULL),
-	__ATTR(min_microamps, 0444, regulator_min_uA_show, NULL),
-	__ATTR(max_microvolts, 0444, regulator_max_uV_show, NULL),
-	__ATTR(max_microamps, 0444, regulator_max_uA_show, NULL),
 	__ATTR(requested_microamps, 0444, regulator_total_uA_show, NULL),
+	__ATTR(headroom_microamps, 0444, regulator_headroom_uA_show, NULL),
 	__ATTR(num_users, 0444, regulator_num_users_show, NULL),
 	__ATTR(type, 0444, regulator_type_show, NULL),
-	__ATTR(suspend_mem_microvolts, 0444,
-		regulator_suspend_mem_uV_show, NULL),
-	__ATTR(suspend_disk_microvolts, 0444,
-		regulator_suspend_disk_uV_show, NULL),
-	__ATTR(suspend_standby_microvolts, 0444,
-		regulator_suspend_standby_uV_show, NULL),
-	__ATTR(suspend_mem_mode, 0444,
-		regulator_suspend_mem_mode_show, NULL),
-	__ATTR(suspend_disk_mode, 0444,
-		regulator_suspend_disk_mode_show, NULL),
-	__ATTR(suspend_standby_mode, 0444,
-		regulator_suspend_standby_mode_show, NULL),
-	__ATTR(suspend_mem_state, 0444,
-		regulator_suspend_mem_state_show, NULL),
-	__ATTR(suspend_disk_state, 0444,
-		regulator_suspend_disk_state_show, NULL),
-	__ATTR(suspend_standby_state, 0444,
-		regulator_suspend_standby_state_show, NULL),
 	__ATTR_NULL,
 };
 
-static void regulator_dev_release(struct device *dev)
+/*
+ * The rest are only created when the regulator can do what they
+ * describe, most rails on a board are simple switches or fixed
+ * supplies which would otherwise carry a sysfs file for each.
+ */
+static DEVICE_ATTR(microvolts, 0444, regulator_uV_show, NULL);
+static DEVICE_ATTR(min_microvolts, 0444, regulator_min_uV_show, NULL);
+static DEVICE_ATTR(max_microvolts, 0444, regulator_max_uV_show, NULL);
+static DEVICE_ATTR(microamps, 0444, regulator_uA_show, NULL);
+static DEVICE_ATTR(min_microamps, 0444, regulator_min_uA_show, NULL);
+static DEVICE_ATTR(max_microamps, 0444, regulator_max_uA_show, NULL);
+static DEVICE_ATTR(opmode, 0444, regulator_opmode_show, NULL);
+static DEVICE_ATTR(suspend_mem_microvolts, 0444,
+		   regulator_suspend_mem_uV_show, NULL);
+static DEVICE_ATTR(suspend_disk_microvolts, 0444,
+		   regulator_suspend_disk_uV_show, NULL);
+static DEVICE_ATTR(suspend_standby_microvolts, 0444,
+		   regulator_suspend_standby_uV_show, NULL);
+static DEVICE_ATTR(suspend_mem_mode, 0444,
+		   regulator_suspend_mem_mode_show, NULL);
+static DEVICE_ATTR(suspend_disk_mode, 0444,
+		   regulator_suspend_disk_mode_show, NULL);
+static DEVICE_ATTR(suspend_standby_mode, 0444,
+		   regulator_suspend_standby_mode_show, NULL);
+static DEVICE_ATTR(suspend_mem_state, 0444,
+		   regulator_suspend_mem_state_show, NULL);
+static DEVICE_ATTR(suspend_disk_state, 0444,
+		   regulator_suspend_disk_state_show, NULL);
+static DEVICE_ATTR(suspend_standby_state, 0444,
+		   regulator_suspend_standby_state_show, NULL);
+
+static struct regulator_dev *regulator_kobj_rdev(struct kobject *kobj)
 {
-	struct regulator_dev *rdev = dev_get_drvdata(dev);
-	kfree(rdev);
+	return dev_get_drvdata(container_of(kobj, struct device, kobj));
 }
 
-static struct class regulator_class = {
-	.name = "regulator",
-	.dev_release = regulator_dev_release,
-	.dev_attrs = regulator_dev_attrs,
-};
-
-/* Calculate the new optimum regulator operating mode based on the new total
- * consumer load. All locks held by caller */
-static void drms_uA_update(struct regulator_dev *rdev)
+static mode_t regulator_voltage_visible(struct kobject *kobj,
+					struct attribute *attr, int idx)
 {
-	struct regulator *sibling;
-	int current_uA = 0, output_uV, input_uV, err;
-	unsigned int mode;
+	struct regulator_dev *rdev = regulator_kobj_rdev(kobj);
+	struct regulator_ops *ops = rdev->desc->ops;
 
-	err = regulator_check_drms(rdev);
-	if (err < 0 || !rdev->desc->ops->get_optimum_mode ||
-	    !rdev->desc->ops->get_voltage || !rdev->desc->ops->set_mode);
-	return;
+	if (rdev->desc->type != REGULATOR_VOLTAGE)
+		return 0;
 
-	/* get output voltage */
-	output_uV = rdev->desc->ops->get_voltage(rdev);
-	if (output_uV <= 0)
-		return;
+	if (attr == &dev_attr_microvolts.attr)
+		return rdev->desc->fixed_uV || _regulator_can_get_voltage(rdev) ?
+			attr->mode : 0;
 
-	/* get input voltage */
-	if (rdev->supply && rdev->supply->desc->ops->get_voltage)
-		input_uV = rdev->supply->desc->ops->get_voltage(rdev->supply);
-	else
-		input_uV = rdev->constraints->input_uV;
-	if (input_uV <= 0)
-		return;
+	return ops->set_voltage || ops->set_voltage_sel ? attr->mode : 0;
+}
+
+static struct attribute *regulator_voltage_attrs[] = {
+	&dev_attr_microvolts.attr,
+	&dev_attr_min_microvolts.attr,
+	&dev_attr_max_microvolts.attr,
+	NULL,
+};
+
+static struct attribute_group regulator_voltage_group = {
+	.is_visible = regulator_voltage_visible,
+	.attrs = regulator_voltage_attrs,
+};
 
-	/* calc total requested load */
-	list_for_each_entry(sibling, &rdev->consumer_list, list)
-	    current_uA += sibling->uA_load;
+static mode_t regulator_current_visible(struct kobject *kobj,
+					struct attribute *attr, int idx)
+{
+	struct regulator_ops *ops = regulator_kobj_rdev(kobj)->desc->ops;
 
-	/* now get the optimum mode for our new total regulator load */
-	mode = rdev->desc->ops->get_optimum_mode(rdev, input_uV,
-						  output_uV, current_uA);
+	if (attr == &dev_attr_microamps.attr)
+		return ops->get_current_limit ? attr->mode : 0;
+	if (attr == &dev_attr_opmode.attr)
+		return ops->get_mode ? attr->mode : 0;
 
-	/* check the new mode is allowed */
-	err = regulator_check_mode(rdev, mode);
-	if (err == 0)
-		rdev->desc->ops->set_mode(rdev, mode);
+	return ops->set_current_limit ? attr->mode : 0;
 }
 
-static int suspend_set_state(struct regulator_dev *rdev,
-	struct regulator_state *rstate)
+static struct attribute *regulator_current_attrs[] = {
+	&dev_attr_microamps.attr,
+	&dev_attr_min_microamps.attr,
+	&dev_attr_max_microamps.attr,
+	&dev_attr_opmode.attr,
+	NULL,
+};
+
+static struct attribute_group regulator_current_group = {
+	.is_visible = regulator_current_visible,
+	.attrs = regulator_current_attrs,
+};
+
+/* a driver with set_suspend_states() can configure all of the state */
+static mode_t regulator_suspend_visible(struct kobject *kobj,
+					struct attribute *attr, int idx)
 {
-	int ret = 0;
+	struct regulator_ops *ops = regulator_kobj_rdev(kobj)->desc->ops;
 
-	/* enable & disable are mandatory for suspend control */
-	if (!rdev->desc->ops->set_suspend_enable ||
-		!rdev->desc->ops->set_suspend_disable) {
-		printk(KERN_ERR "%s: no way to set suspend state\n",
-			__func__);
-		return -EINVAL;
-	}
+	if (ops->set_suspend_states)
+		return attr->mode;
 
-	if (rstate->enabled)
-		ret = rdev->desc->ops->set_suspend_enable(rdev);
+	if (attr == &dev_attr_suspend_mem_microvolts.attr ||
+	    attr == &dev_attr_suspend_disk_microvolts.attr ||
+	    attr == &dev_attr_suspend_standby_microvolts.attr)
+		return ops->set_suspend_voltage ? attr->mode : 0;
+
+	if (attr == &dev_attr_suspend_mem_mode.attr ||
+	    attr == &dev_attr_suspend_disk_mode.attr ||
+	    attr == &dev_attr_suspend_standby_mode.attr)
+		return ops->set_suspend_mode ? attr->mode : 0;
+
+	return ops->set_suspend_enable || ops->set_suspend_disable ?
+		attr->mode : 0;
+}
+
+static struct attribute *regulator_suspend_attrs[] = {
+	&dev_attr_suspend_mem_microvolts.attr,
+	&dev_attr_suspend_disk_microvolts.attr,
+	&dev_attr_suspend_standby_microvolts.attr,
+	&dev_attr_suspend_mem_mode.attr,
+	&dev_attr_suspend_disk_mode.attr,
+	&dev_attr_suspend_standby_mode.attr,
+	&dev_attr_suspend_mem_state.attr,
+	&dev_attr_suspend_disk_state.attr,
+	&dev_attr_suspend_standby_state.attr,
+	NULL,
+};
+
+static struct attribute_group regulator_suspend_group = {
+	.is_visible = regulator_suspend_visible,
+	.attrs = regulator_suspend_attrs,
+};
+
+static struct attribute_group *regulator_attr_groups[] = {
+	&regulator_voltage_group,
+	&regulator_current_group,
+	&regulator_suspend_group,
+};
+
+static void regulator_remove_attrs(struct regulator_dev *rdev)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(regulator_attr_groups); i++)
+		sysfs_remove_group(&rdev->dev.kobj, regulator_attr_groups[i]);
+}
+
+static int regulator_add_attrs(struct regulator_dev *rdev)
+{
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(regulator_attr_groups); i++) {
+		ret = sysfs_create_group(&rdev->dev.kobj,
+					 regulator_attr_groups[i]);
+		if (ret != 0)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	while (--i >= 0)
+		sysfs_remove_group(&rdev->dev.kobj, regulator_attr_groups[i]);
+	return ret;
+}
+
+static void regulator_history_add(struct regulator_dev *rdev,
+				  enum regulator_op op, int value, s64 time_ns,
+				  int ret)
+{
+	struct regulator_history_entry *entry;
+	struct regulator *requester = rdev->requester;
+
+	if (!rdev->history)
+		return;
+
+	entry = &rdev->history[rdev->history_next &
+			       (REGULATOR_HISTORY_LEN - 1)];
+	entry->time_ns = time_ns;
+	entry->op = op;
+	entry->value = value;
+	entry->ret = ret;
+	if (requester && requester->dev)
+		strlcpy(entry->consumer, dev_name(requester->dev),
+			sizeof(entry->consumer));
 	else
-		ret = rdev->desc->ops->set_suspend_disable(rdev);
+		entry->consumer[0] = '\0';
+
+	/* publish the entry before readers can see it */
+	smp_wmb();
+	rdev->history_next++;
+}
+
+/* the oldest history entry which can't be in the middle of a rewrite */
+static unsigned int regulator_history_first(struct regulator_dev *rdev)
+{
+	unsigned int next = ACCESS_ONCE(rdev->history_next);
+
+	smp_rmb();
+	return next >= REGULATOR_HISTORY_LEN ?
+		next - REGULATOR_HISTORY_LEN + 1 : 0;
+}
+
+/* Format the read'th entry written to the history without locking,
+ * returning 0 if the writer has since reused its slot. */
+static int regulator_history_format(struct regulator_dev *rdev,
+				    unsigned int read, char *buf, size_t len)
+{
+	struct regulator_history_entry entry;
+	u32 rem_ns;
+	u64 secs;
+
+	entry = rdev->history[read & (REGULATOR_HISTORY_LEN - 1)];
+	smp_rmb();
+	if (ACCESS_ONCE(rdev->history_next) - read >= REGULATOR_HISTORY_LEN)
+		return 0;
+
+	entry.consumer[sizeof(entry.consumer) - 1] = '\0';
+	secs = div_u64_rem(entry.time_ns, NSEC_PER_SEC, &rem_ns);
+	return snprintf(buf, len, "[%5llu.%06u] %s %d ret %d %s",
+			(unsigned long long)secs, rem_ns / 1000,
+			regulator_op_names[entry.op], entry.value,
+			entry.ret, entry.consumer);
+}
+
+/* log the recent operations on a regulator after it reports a failure */
+static void regulator_history_dump(struct regulator_dev *rdev)
+{
+	char buf[80];
+	unsigned int read;
+
+	printk(KERN_ERR "regulator: %s recent operations:\n",
+	       rdev->desc->name);
+	for (read = regulator_history_first(rdev);
+	     read != ACCESS_ONCE(rdev->history_next); read++)
+		if (regulator_history_format(rdev, read, buf, sizeof(buf)))
+			printk(KERN_ERR "regulator: %s\n", buf);
+}
+
+static void regulator_stats_op(struct regulator_dev *rdev,
+			       enum regulator_op op, int value, s64 start,
+			       int ret)
+{
+	struct regulator_stats *stats = &rdev->stats;
+	struct regulator_op_stats *op_stats = &stats->op[op];
+	s64 now = ktime_to_ns(ktime_get());
+	u64 delta = now - start;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+
+	if (!op_stats->count || delta < op_stats->min_ns)
+		op_stats->min_ns = delta;
+	if (delta > op_stats->max_ns)
+		op_stats->max_ns = delta;
+	op_stats->total_ns += delta;
+	op_stats->count++;
+
+	if (ret < 0 && op != REGULATOR_OP_GET_MODE) {
+		op_stats->errors++;
+	} else if (op == REGULATOR_OP_ENABLE && !stats->enabled_since) {
+		stats->enabled_since = now;
+	} else if (op == REGULATOR_OP_DISABLE && stats->enabled_since) {
+		stats->enabled_ns += now - stats->enabled_since;
+		stats->enabled_since = 0;
+	}
+
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	/* reads are only worth remembering when they fail */
+	switch (op) {
+	case REGULATOR_OP_IS_ENABLED:
+	case REGULATOR_OP_GET_VOLTAGE:
+	case REGULATOR_OP_GET_CURRENT_LIMIT:
+		if (ret >= 0)
+			return;
+		break;
+	case REGULATOR_OP_GET_MODE:
+		return;
+	default:
+		break;
+	}
+
+	regulator_history_add(rdev, op, value, start, ret);
+}
+
+/* account for the energy used since the last change at the old power */
+static void regulator_energy_add(struct regulator_energy *energy, s64 now,
+				 unsigned int uW)
+{
+	u64 pJ;
+
+	if (energy->last_ns) {
+		pJ = (u64)energy->uW * div_u64(now - energy->last_ns,
+					       NSEC_PER_USEC);
+		pJ += energy->rem_pJ;
+		energy->uJ += div_u64_rem(pJ, 1000000, &energy->rem_pJ);
+	}
+
+	energy->last_ns = now;
+	energy->uW = uW;
+}
+
+/* the energy used so far including the current period */
+static u64 regulator_energy_read(struct regulator_energy *energy, s64 now)
+{
+	u64 pJ = energy->rem_pJ;
+
+	if (energy->last_ns)
+		pJ += (u64)energy->uW * div_u64(now - energy->last_ns,
+						NSEC_PER_USEC);
+
+	return energy->uJ + div_u64(pJ, 1000000);
+}
+
+static unsigned int regulator_power(int uV, int uA)
+{
+	if (uV <= 0 || uA <= 0)
+		return 0;
+
+	return div_u64((u64)uV * uA, 1000000);
+}
+
+/* Start a new accounting period for the regulator and its consumers after
+ * a change which may affect their power, rdev->mutex held by caller.  The
+ * loads used are those declared with regulator_set_optimum_mode(). */
+static void regulator_energy_update(struct regulator_dev *rdev)
+{
+	struct regulator *consumer;
+	unsigned long flags;
+	unsigned int uW;
+	int on, uV = 0;
+	s64 now;
+
+	/* trust the hardware state if we know it */
+	if (rdev->enabled_state >= 0)
+		on = rdev->enabled_state;
+	else
+		on = rdev->use_count > 0;
+	if (on)
+		uV = _regulator_get_voltage(rdev);
+
+	now = ktime_to_ns(ktime_get());
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	regulator_energy_add(&rdev->stats.energy, now,
+			     regulator_power(uV, _regulator_get_load(rdev)));
+	list_for_each_entry(consumer, &rdev->consumer_list, list) {
+		uW = 0;
+		if (consumer->enable_count)
+			uW = regulator_power(uV, consumer->uA_load);
+		regulator_energy_add(&consumer->energy, now, uW);
+	}
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+}
+
+/* hardware state changes, traced and accounted */
+static int rdev_do_enable(struct regulator_dev *rdev)
+{
+	int ret;
+
+	trace_regulator_enable(rdev->desc->name);
+	ret = rdev_op(rdev, REGULATOR_OP_ENABLE, 1,
+		      rdev->desc->ops->enable(rdev));
+	trace_regulator_enable_complete(rdev->desc->name, ret);
+
+	/* if the enable failed we don't know what state we are in */
+	rdev->enabled_state = ret < 0 ? -1 : 1;
+	regulator_energy_update(rdev);
+	if (ret >= 0)
+		regulator_led_on(rdev, 1);
+
+	return ret;
+}
+
+static int rdev_do_disable(struct regulator_dev *rdev)
+{
+	int ret;
+
+	trace_regulator_disable(rdev->desc->name);
+	ret = rdev_op(rdev, REGULATOR_OP_DISABLE, 0,
+		      rdev->desc->ops->disable(rdev));
+	trace_regulator_disable_complete(rdev->desc->name, ret);
+
+	rdev->enabled_state = ret < 0 ? -1 : 0;
+	regulator_energy_update(rdev);
+	if (ret >= 0)
+		regulator_led_on(rdev, 0);
+
+	return ret;
+}
+
+/* can the output voltage of rdev be changed by the core */
+static int _regulator_can_set_voltage(struct regulator_dev *rdev)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+
+	return ops->set_voltage ||
+		(ops->set_voltage_sel && ops->list_voltage);
+}
+
+/* can the output voltage of rdev be read back */
+static int _regulator_can_get_voltage(struct regulator_dev *rdev)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+
+	return ops->get_voltage ||
+		(ops->get_voltage_sel && ops->list_voltage);
+}
+
+/* find the selector giving the lowest voltage within min_uV..max_uV */
+static int _regulator_map_voltage(struct regulator_dev *rdev,
+				  int min_uV, int max_uV, int *best_uV)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+	int i, uV, best = -EINVAL;
+
+	*best_uV = INT_MAX;
+
+	for (i = 0; i < rdev->desc->n_voltages; i++) {
+		uV = ops->list_voltage(rdev, i);
+		if (uV <= 0 || uV < min_uV || uV > max_uV)
+			continue;
+		if (uV < *best_uV) {
+			*best_uV = uV;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+/* The voltage a set left the output at for the trace, 0 if unknown.
+ * Drivers which pick the voltage themselves are only read back when
+ * the event is being traced. */
+static int rdev_traced_uV(struct regulator_dev *rdev, int ret)
+{
+	int uV;
+
+	if (ret < 0)
+		return 0;
+
+	uV = rdev->cached_uV;
+#ifdef CONFIG_TRACEPOINTS
+	if (!uV && unlikely(__tracepoint_regulator_set_voltage_complete.state))
+		uV = _regulator_get_voltage(rdev);
+#endif
+
+	return uV > 0 ? uV : 0;
+}
+
+static int rdev_do_set_voltage(struct regulator_dev *rdev,
+			       int min_uV, int max_uV)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret, sel, uV;
+
+	trace_regulator_set_voltage(rdev->desc->name, min_uV, max_uV);
+
+	/* whatever was cached no longer describes the output */
+	rdev->cached_uV = 0;
+	rdev->selector = -1;
+	if (ops->set_voltage) {
+		ret = rdev_op(rdev, REGULATOR_OP_SET_VOLTAGE, min_uV,
+			      ops->set_voltage(rdev, min_uV, max_uV));
+	} else {
+		sel = _regulator_map_voltage(rdev, min_uV, max_uV, &uV);
+		if (sel < 0) {
+			ret = sel;
+		} else if (sel == rdev->preload_sel) {
+			rdev->preload_sel = -1;
+			ret = rdev_op(rdev, REGULATOR_OP_SET_VOLTAGE, uV,
+				      ops->switch_voltage_sel(rdev));
+		} else {
+			ret = rdev_op(rdev, REGULATOR_OP_SET_VOLTAGE, uV,
+				      ops->set_voltage_sel(rdev, sel));
+		}
+
+		/* we know what we asked for, no need to read it back */
+		if (ret >= 0) {
+			rdev->cached_uV = uV;
+			rdev->selector = sel;
+		}
+	}
+
+	trace_regulator_set_voltage_complete(rdev->desc->name,
+					     rdev_traced_uV(rdev, ret), ret);
+
+	return ret;
+}
+
+static int rdev_do_set_mode(struct regulator_dev *rdev, unsigned int mode)
+{
+	int ret;
+
+	trace_regulator_set_mode(rdev->desc->name, mode);
+	ret = rdev_op(rdev, REGULATOR_OP_SET_MODE, mode,
+		      rdev->desc->ops->set_mode(rdev, mode));
+	if (ret >= 0) {
+		rdev->mode = mode;
+		rdev->mode_changed = jiffies;
+	} else
+		rdev->mode = 0;
+
+	trace_regulator_set_mode_complete(rdev->desc->name, rdev->mode, ret);
+
+	return ret;
+}
+
+static int rdev_do_set_current_limit(struct regulator_dev *rdev,
+				     int min_uA, int max_uA)
+{
+	int ret;
+
+	ret = rdev_op(rdev, REGULATOR_OP_SET_CURRENT_LIMIT, max_uA,
+		      rdev->desc->ops->set_current_limit(rdev, min_uA, max_uA));
+	if (ret >= 0) {
+		rdev->min_uA = min_uA;
+		rdev->max_uA = max_uA;
+	} else {
+		rdev->min_uA = 0;
+		rdev->max_uA = 0;
+	}
+
+	return ret;
+}
+
+static ssize_t regulator_stats_op_count(struct device *dev, char *buf,
+					enum regulator_op op)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	unsigned long count;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	count = rdev->stats.op[op].count - rdev->stats.op[op].errors;
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return sprintf(buf, "%lu\n", count);
+}
+
+static ssize_t regulator_enable_count_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return regulator_stats_op_count(dev, buf, REGULATOR_OP_ENABLE);
+}
+
+static ssize_t regulator_disable_count_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return regulator_stats_op_count(dev, buf, REGULATOR_OP_DISABLE);
+}
+
+static ssize_t regulator_voltage_changes_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return regulator_stats_op_count(dev, buf, REGULATOR_OP_SET_VOLTAGE);
+}
+
+static ssize_t regulator_mode_changes_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return regulator_stats_op_count(dev, buf, REGULATOR_OP_SET_MODE);
+}
+
+static ssize_t regulator_enabled_time_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	unsigned long flags;
+	u64 ns;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	ns = rdev->stats.enabled_ns;
+	if (rdev->stats.enabled_since)
+		ns += ktime_to_ns(ktime_get()) - rdev->stats.enabled_since;
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ns, NSEC_PER_MSEC));
+}
+
+static ssize_t regulator_op_latency_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	struct regulator_op_stats op_stats[REGULATOR_OP_NUM];
+	unsigned long flags;
+	ssize_t count;
+	int i;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	memcpy(op_stats, rdev->stats.op, sizeof(op_stats));
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	count = sprintf(buf, "%-18s %8s %8s %8s %8s %8s\n", "op", "count",
+			"errors", "min_us", "avg_us", "max_us");
+	for (i = 0; i < REGULATOR_OP_NUM; i++) {
+		if (!op_stats[i].count)
+			continue;
+		count += sprintf(buf + count,
+				 "%-18s %8lu %8lu %8llu %8llu %8llu\n",
+				 regulator_op_names[i], op_stats[i].count,
+				 op_stats[i].errors,
+				 (unsigned long long)div_u64(op_stats[i].min_ns,
+							     NSEC_PER_USEC),
+				 (unsigned long long)div64_u64(
+					op_stats[i].total_ns,
+					(u64)op_stats[i].count * NSEC_PER_USEC),
+				 (unsigned long long)div_u64(op_stats[i].max_ns,
+							     NSEC_PER_USEC));
+	}
+
+	return count;
+}
+
+static ssize_t regulator_lock_contention_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	unsigned long flags, contended;
+	u64 wait_ns;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	contended = rdev->stats.lock_contended;
+	wait_ns = rdev->stats.lock_wait_ns;
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return sprintf(buf, "%lu %llu\n", contended,
+		       (unsigned long long)div_u64(wait_ns, NSEC_PER_USEC));
+}
+
+static ssize_t regulator_energy_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	unsigned long flags;
+	u64 uJ;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	uJ = regulator_energy_read(&rdev->stats.energy,
+				   ktime_to_ns(ktime_get()));
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return sprintf(buf, "%llu\n", (unsigned long long)uJ);
+}
+
+static ssize_t regulator_stats_reset(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	unsigned long flags;
+
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	memset(rdev->stats.op, 0, sizeof(rdev->stats.op));
+	rdev->stats.enabled_ns = 0;
+	rdev->stats.lock_contended = 0;
+	rdev->stats.lock_wait_ns = 0;
+	rdev->stats.energy.uJ = 0;
+	rdev->stats.energy.rem_pJ = 0;
+	if (rdev->stats.energy.last_ns)
+		rdev->stats.energy.last_ns = ktime_to_ns(ktime_get());
+	if (rdev->stats.enabled_since)
+		rdev->stats.enabled_since = ktime_to_ns(ktime_get());
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR(enable_count, 0444, regulator_enable_count_show, NULL);
+static DEVICE_ATTR(disable_count, 0444, regulator_disable_count_show, NULL);
+static DEVICE_ATTR(voltage_changes, 0444,
+		   regulator_voltage_changes_show, NULL);
+static DEVICE_ATTR(mode_changes, 0444, regulator_mode_changes_show, NULL);
+static DEVICE_ATTR(enabled_time_ms, 0444, regulator_enabled_time_show, NULL);
+static DEVICE_ATTR(op_latency, 0444, regulator_op_latency_show, NULL);
+static DEVICE_ATTR(lock_contention, 0444,
+		   regulator_lock_contention_show, NULL);
+static DEVICE_ATTR(energy_uJ, 0444, regulator_energy_show, NULL);
+static DEVICE_ATTR(reset, 0200, NULL, regulator_stats_reset);
+
+static struct attribute *regulator_stats_attrs[] = {
+	&dev_attr_enable_count.attr,
+	&dev_attr_disable_count.attr,
+	&dev_attr_voltage_changes.attr,
+	&dev_attr_mode_changes.attr,
+	&dev_attr_enabled_time_ms.attr,
+	&dev_attr_op_latency.attr,
+	&dev_attr_lock_contention.attr,
+	&dev_attr_energy_uJ.attr,
+	&dev_attr_reset.attr,
+	NULL,
+};
+
+static struct attribute_group regulator_stats_group = {
+	.name = "stats",
+	.attrs = regulator_stats_attrs,
+};
+
+static void regulator_dev_release(struct device *dev)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+	kfree(rdev->history);
+	kfree(rdev);
+}
+
+/*
+ * Regulators given a suspend state by regulator_suspend_prepare() are put
+ * back the way the core left them once their PMIC has resumed, in the
+ * PM core's first resume pass so every consumer finds its supplies ready.
+ * Other regulators are untouched.
+ */
+static int regulator_resume(struct device *dev)
+{
+	struct regulator_dev *rdev = dev_get_drvdata(dev);
+
+	if (!rdev->suspend_prepared)
+		return 0;
+	rdev->suspend_prepared = 0;
+
+	/* failures are reported, but shouldn't stop the system resuming */
+	regulator_sync_state(rdev);
+	return 0;
+}
+
+static struct class regulator_class = {
+	.name = "regulator",
+	.dev_release = regulator_dev_release,
+	.dev_attrs = regulator_dev_attrs,
+	.resume = regulator_resume,
+};
+
+/* returns the input voltage of rdev, 0 if unknown */
+static int _regulator_get_input_voltage(struct regulator_dev *rdev)
+{
+	int input_uV = 0;
+
+	if (rdev->supply && _regulator_can_get_voltage(rdev->supply)) {
+		regulator_lock(rdev->supply);
+		input_uV = _regulator_get_voltage(rdev->supply);
+		regulator_unlock(rdev->supply);
+	}
+	if (input_uV <= 0 && rdev->constraints)
+		input_uV = rdev->constraints->input_uV;
+
+	return input_uV > 0 ? input_uV : 0;
+}
+
+/* total load on the output of rdev from consumers and supplied regulators */
+static int _regulator_get_load(struct regulator_dev *rdev)
+{
+	struct regulator *consumer;
+	int load_uA = rdev->child_uA;
+
+	list_for_each_entry(consumer, &rdev->consumer_list, list)
+		load_uA += consumer->uA_load;
+
+	return load_uA;
+}
+
+/* convert a load on the output of rdev into the load on its supply */
+static int regulator_input_load(struct regulator_dev *rdev, int input_uV,
+				int output_uV, int load_uA)
+{
+	unsigned int efficiency = rdev->desc->efficiency;
+
+	if (rdev->constraints && rdev->constraints->efficiency)
+		efficiency = rdev->constraints->efficiency;
+
+	/* linear regulators pass their load current straight through */
+	if (!efficiency || input_uV <= 0 || output_uV <= 0 || load_uA <= 0)
+		return load_uA;
+
+	return div64_u64((u64)load_uA * output_uV * 100,
+			 (u64)input_uV * efficiency);
+}
+
+/* the output load of rdev which would draw input_uA from its supply */
+static int regulator_output_load(struct regulator_dev *rdev, int input_uV,
+				 int output_uV, int input_uA)
+{
+	unsigned int efficiency = rdev->desc->efficiency;
+	u64 load_uA;
+
+	if (rdev->constraints && rdev->constraints->efficiency)
+		efficiency = rdev->constraints->efficiency;
+
+	if (!efficiency || input_uV <= 0 || output_uV <= 0 || input_uA <= 0)
+		return input_uA;
+
+	load_uA = div64_u64((u64)input_uA * input_uV * efficiency,
+			    (u64)output_uV * 100);
+
+	return min_t(u64, load_uA, INT_MAX);
+}
+
+/* The extra load in uA rdev could supply before it or a regulator above
+ * it in the tree goes over budget, INT_MAX if there is no budget.  Called
+ * with rdev->mutex held, the supplies are locked as we walk up. */
+static int _regulator_get_headroom(struct regulator_dev *rdev)
+{
+	int headroom_uA = INT_MAX;
+	int input_uV, output_uV, supply_uA;
+
+	if (rdev->constraints && rdev->constraints->budget_uA)
+		headroom_uA = max(rdev->constraints->budget_uA -
+				  _regulator_get_load(rdev), 0);
+
+	if (!rdev->supply)
+		return headroom_uA;
+
+	input_uV = _regulator_get_input_voltage(rdev);
+	output_uV = _regulator_get_voltage(rdev);
+
+	regulator_lock(rdev->supply);
+	supply_uA = _regulator_get_headroom(rdev->supply);
+	regulator_unlock(rdev->supply);
+
+	if (supply_uA != INT_MAX)
+		headroom_uA = min(headroom_uA,
+				  regulator_output_load(rdev, input_uV,
+							output_uV, supply_uA));
+
+	return headroom_uA;
+}
+
+/* can the core choose an optimum mode for rdev */
+static int _regulator_can_get_optimum_mode(struct regulator_dev *rdev)
+{
+	return (rdev->constraints && rdev->constraints->mode_table) ||
+		rdev->desc->ops->get_optimum_mode || rdev->desc->mode_table;
+}
+
+/* The most capable mode requested by an enabled consumer or 0 if none
+ * have asked for one; modes are ordered from FAST to STANDBY so this is
+ * the lowest.  rdev->mutex held by caller */
+static unsigned int regulator_aggregate_mode(struct regulator_dev *rdev)
+{
+	struct regulator *consumer;
+	unsigned int mode = 0;
+
+	list_for_each_entry(consumer, &rdev->consumer_list, list) {
+		if (!consumer->mode || !consumer->enable_count)
+			continue;
+		if (!mode || consumer->mode < mode)
+			mode = consumer->mode;
+	}
+
+	return mode;
+}
+
+/* The least capable permitted mode whose transient response meets the
+ * pm_qos CPU/DMA latency requirement, or 0 if any mode will do */
+static unsigned int regulator_qos_mode(struct regulator_dev *rdev)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	int latency = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int mode;
+
+	if (constraints->idle_latency_us &&
+	    latency < constraints->idle_latency_us)
+		mode = REGULATOR_MODE_NORMAL;
+	else if (constraints->standby_latency_us &&
+		 latency < constraints->standby_latency_us)
+		mode = REGULATOR_MODE_IDLE;
+	else
+		return 0;
+
+	/* round up to a mode the machine allows, more capable modes have
+	 * lower values */
+	for (; mode; mode >>= 1)
+		if (constraints->valid_modes_mask & mode)
+			return mode;
+
+	return 0;
+}
+
+/* DRMS may not pick a less capable mode than the consumers asked for,
+ * or than the latency requirement allows */
+static unsigned int regulator_mode_floor(struct regulator_dev *rdev,
+					 unsigned int mode)
+{
+	unsigned int floor = regulator_aggregate_mode(rdev);
+	unsigned int qos = regulator_qos_mode(rdev);
+
+	if (qos && (!floor || qos < floor))
+		floor = qos;
+
+	if (floor && floor < mode)
+		return floor;
+
+	return mode;
+}
+
+/* board mode tables take precedence over the driver's own knowledge */
+static unsigned int _regulator_get_optimum_mode(struct regulator_dev *rdev,
+						int input_uV, int output_uV,
+						int load_uA)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+
+	if (constraints && constraints->mode_table)
+		return regulator_mode_table_lookup(constraints->mode_table,
+						   constraints->n_mode_table,
+						   input_uV, load_uA);
+
+	if (rdev->desc->ops->get_optimum_mode)
+		return rdev->desc->ops->get_optimum_mode(rdev, input_uV,
+							 output_uV, load_uA);
+
+	return regulator_mode_table_lookup(rdev->desc->mode_table,
+					   rdev->desc->n_mode_table,
+					   input_uV, load_uA);
+}
+
+/*
+ * Apply a mode chosen by DRMS.  Moving to a more capable mode always
+ * happens at once so the output stays in regulation, moving to a less
+ * capable one is damped by the machine constraints: the load must be
+ * clear of the mode threshold by the hysteresis band and the previous
+ * change must be at least the dwell time ago, otherwise the change is
+ * retried once the dwell time expires.  Returns the mode now in effect.
+ */
+static int regulator_drms_set_mode(struct regulator_dev *rdev,
+				   unsigned int mode, int input_uV,
+				   int output_uV, int load_uA)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	unsigned long next;
+	int ret;
+
+	mode = regulator_mode_floor(rdev, mode);
+	if (mode == rdev->mode)
+		return mode;
+
+	/* modes are ordered from FAST to STANDBY so higher is less capable */
+	if (rdev->mode && mode > rdev->mode) {
+		if (constraints->drms_hysteresis_uA) {
+			mode = regulator_mode_floor(rdev,
+				_regulator_get_optimum_mode(rdev,
+				input_uV, output_uV,
+				load_uA + constraints->drms_hysteresis_uA));
+			if (mode <= rdev->mode ||
+			    !(constraints->valid_modes_mask & mode))
+				return rdev->mode;
+		}
+
+		if (constraints->drms_dwell_ms) {
+			next = rdev->mode_changed +
+				msecs_to_jiffies(constraints->drms_dwell_ms);
+			if (time_before(jiffies, next)) {
+				if (regulator_wq)
+					queue_delayed_work(regulator_wq,
+							   &rdev->drms_work,
+							   next - jiffies);
+				else
+					schedule_delayed_work(&rdev->drms_work,
+							      next - jiffies);
+				return rdev->mode;
+			}
+		}
+	}
+
+	ret = rdev_do_set_mode(rdev, mode);
+	if (ret < 0)
+		return ret;
+
+	return mode;
+}
+
+static void regulator_drms_work(struct work_struct *work)
+{
+	struct regulator_dev *rdev = container_of(work, struct regulator_dev,
+						  drms_work.work);
+
+	regulator_lock(rdev);
+	drms_uA_update(rdev);
+	regulator_unlock(rdev);
+}
+
+/* pass a change in the load of rdev up to the regulators supplying it */
+static void regulator_propagate_load(struct regulator_dev *rdev,
+				     int input_uV, int output_uV, int load_uA)
+{
+	int supply_uA;
+
+	if (!rdev->supply)
+		return;
+
+	supply_uA = regulator_input_load(rdev, input_uV, output_uV, load_uA);
+	if (supply_uA == rdev->supply_uA)
+		return;
+
+	regulator_lock(rdev->supply);
+	rdev->supply->child_uA += supply_uA - rdev->supply_uA;
+	rdev->supply_uA = supply_uA;
+
+	drms_uA_update(rdev->supply);
+	regulator_energy_update(rdev->supply);
+	regulator_unlock(rdev->supply);
+}
+
+static int regulator_drms_capable(struct regulator_dev *rdev)
+{
+	return rdev->constraints &&
+		(rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_DRMS) &&
+		_regulator_can_get_optimum_mode(rdev) &&
+		rdev->desc->ops->set_mode;
+}
+
+/* Select the most efficient operating mode for the regulator from its
+ * total load, then update the load it places on its own supply, so that
+ * regulators further up the tree can make the same choice.  rdev->mutex
+ * held by caller, the supply is locked here as we move up the tree */
+static void drms_uA_update(struct regulator_dev *rdev)
+{
+	int load_uA, output_uV, input_uV;
+	unsigned int mode;
+
+	load_uA = _regulator_get_load(rdev);
+	output_uV = _regulator_get_voltage(rdev);
+	input_uV = _regulator_get_input_voltage(rdev);
+
+	/* regulators without DRMS still pass their load up to their supply */
+	if (regulator_drms_capable(rdev) && output_uV > 0 && input_uV > 0) {
+		/* now get the optimum mode for our new total regulator load */
+		mode = _regulator_get_optimum_mode(rdev, input_uV,
+						   output_uV, load_uA);
+
+		/* check the new mode is allowed */
+		if (regulator_check_mode(rdev, mode) == 0)
+			regulator_drms_set_mode(rdev, mode, input_uV,
+						output_uV, load_uA);
+	}
+
+	regulator_propagate_load(rdev, input_uV, output_uV, load_uA);
+}
+
+/* Apply the most capable of the modes requested by the consumers,
+ * only touching the hardware if it is not already in effect.  With DRMS
+ * the requests set the least capable mode it may choose, so a more
+ * capable mode DRMS picked for the load is kept.  When the requests go
+ * away the mode is left as it is unless DRMS picks another.
+ * rdev->mutex held by caller */
+static int _regulator_apply_mode(struct regulator_dev *rdev)
+{
+	unsigned int mode;
+
+	if (regulator_drms_capable(rdev))
+		drms_uA_update(rdev);
+
+	mode = regulator_aggregate_mode(rdev);
+	if (!mode || mode == rdev->mode)
+		return 0;
+
+	/* modes are ordered from FAST to STANDBY */
+	if (regulator_drms_capable(rdev) && rdev->mode && rdev->mode < mode)
+		return 0;
+
+	return rdev_do_set_mode(rdev, mode);
+}
+
+/* reselect the modes of the regulators with latency constraints, from
+ * a work item since whoever changed the requirement may hold locks */
+static void regulator_qos_work_fn(struct work_struct *work)
+{
+	struct regulation_constraints *constraints;
+	struct regulator_dev *rdev;
+	int idx;
+
+	idx = srcu_read_lock(&regulator_list_srcu);
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
+		constraints = rdev->constraints;
+		if (!constraints || (!constraints->idle_latency_us &&
+				     !constraints->standby_latency_us))
+			continue;
+
+		regulator_lock(rdev);
+		if (regulator_drms_capable(rdev))
+			drms_uA_update(rdev);
+		regulator_unlock(rdev);
+	}
+	srcu_read_unlock(&regulator_list_srcu, idx);
+}
+
+static DECLARE_WORK(regulator_qos_work, regulator_qos_work_fn);
+
+static int regulator_qos_notify(struct notifier_block *nb,
+				unsigned long latency, void *data)
+{
+	if (regulator_wq)
+		queue_work(regulator_wq, &regulator_qos_work);
+	else
+		schedule_work(&regulator_qos_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block regulator_qos_nb = {
+	.notifier_call = regulator_qos_notify,
+};
+
+/* time in uS for the output to settle after being enabled */
+static unsigned int _regulator_enable_time(struct regulator_dev *rdev)
+{
+	if (rdev->constraints && rdev->constraints->enable_time)
+		return rdev->constraints->enable_time;
+	return rdev->desc->enable_time;
+}
+
+/* time in uS for the output to slew between two voltages */
+static unsigned int _regulator_set_voltage_time(struct regulator_dev *rdev,
+						int old_uV, int new_uV)
+{
+	unsigned int ramp_delay = rdev->desc->ramp_delay;
+
+	if (rdev->constraints && rdev->constraints->ramp_delay)
+		ramp_delay = rdev->constraints->ramp_delay;
+
+	if (!ramp_delay || old_uV <= 0 || new_uV <= 0)
+		return 0;
+
+	return DIV_ROUND_UP(abs(new_uV - old_uV), ramp_delay);
+}
+
+/* wait for the output to settle, busy waiting only for short delays */
+static void _regulator_delay(unsigned int delay)
+{
+	if (!delay)
+		return;
+
+	if (delay >= 1000) {
+		msleep(delay / 1000);
+		udelay(delay % 1000);
+	} else {
+		udelay(delay);
+	}
+}
+
+static int suspend_set_state(struct regulator_dev *rdev,
+	struct regulator_state *rstate)
+{
+	int ret = 0;
+
+	if (rdev->desc->ops->set_suspend_states)
+		return rdev->desc->ops->set_suspend_states(&rdev, &rstate, 1);
+
+	/* enable & disable are mandatory for suspend control */
+	if (!rdev->desc->ops->set_suspend_enable ||
+		!rdev->desc->ops->set_suspend_disable) {
+		printk(KERN_ERR "%s: no way to set suspend state\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	/* the status is only changed if the machine asks for it */
+	if (rstate->enabled)
+		ret = rdev->desc->ops->set_suspend_enable(rdev);
+	else if (rstate->disabled)
+		ret = rdev->desc->ops->set_suspend_disable(rdev);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to enabled/disable\n", __func__);
+		return ret;
+	}
+
+	if (rdev->desc->ops->set_suspend_voltage && rstate->uV > 0) {
+		ret = rdev->desc->ops->set_suspend_voltage(rdev, rstate->uV);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to set voltage\n",
+				__func__);
+			return ret;
+		}
+	}
+
+	if (rdev->desc->ops->set_suspend_mode && rstate->mode > 0) {
+		ret = rdev->desc->ops->set_suspend_mode(rdev, rstate->mode);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to set mode\n", __func__);
+			return ret;
+		}
+	}
+	return ret;
+}
+
+static struct regulator_state *suspend_state(struct regulator_dev *rdev,
+					     suspend_state_t state)
+{
+	if (!rdev->constraints)
+		return NULL;
+
+	switch (state) {
+	case PM_SUSPEND_STANDBY:
+		return &rdev->constraints->state_standby;
+	case PM_SUSPEND_MEM:
+		return &rdev->constraints->state_mem;
+	case PM_SUSPEND_MAX:
+		return &rdev->constraints->state_disk;
+	default:
+		return NULL;
+	}
+}
+
+/* does the machine give the regulator any configuration for the state */
+static int suspend_state_configured(struct regulator_state *rstate)
+{
+	return rstate->enabled || rstate->disabled || rstate->uV > 0 ||
+		rstate->mode;
+}
+
+/* locks held by caller */
+static int suspend_prepare(struct regulator_dev *rdev, suspend_state_t state)
+{
+	struct regulator_state *rstate = suspend_state(rdev, state);
+
+	if (!rstate)
+		return -EINVAL;
+
+	if (rstate->enabled && rstate->disabled) {
+		printk(KERN_ERR "%s: %s both enabled and disabled in suspend\n",
+		       __func__, rdev->desc->name);
+		return -EINVAL;
+	}
+
+	/* nothing to do for regulators the state doesn't concern */
+	if (!suspend_state_configured(rstate))
+		return 0;
+
+	return suspend_set_state(rdev, rstate);
+}
+
+/* does the regulator need programming to enter the state */
+static int suspend_state_needed(struct regulator_dev *rdev,
+				suspend_state_t state)
+{
+	struct regulator_state *rstate = suspend_state(rdev, state);
+
+	return rstate && suspend_state_configured(rstate);
+}
+
+static void print_constraints(struct regulator_dev *rdev)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	char buf[80];
+	int count;
+
+	if (rdev->desc->type == REGULATOR_VOLTAGE) {
+		if (constraints->min_uV == constraints->max_uV)
+			count = sprintf(buf, "%d mV ",
+					constraints->min_uV / 1000);
+		else
+			count = sprintf(buf, "%d <--> %d mV ",
+					constraints->min_uV / 1000,
+					constraints->max_uV / 1000);
+	} else {
+		if (constraints->min_uA == constraints->max_uA)
+			count = sprintf(buf, "%d mA ",
+					constraints->min_uA / 1000);
+		else
+			count = sprintf(buf, "%d <--> %d mA ",
+					constraints->min_uA / 1000,
+					constraints->max_uA / 1000);
+	}
+	if (constraints->valid_modes_mask & REGULATOR_MODE_FAST)
+		count += sprintf(buf + count, "fast ");
+	if (constraints->valid_modes_mask & REGULATOR_MODE_NORMAL)
+		count += sprintf(buf + count, "normal ");
+	if (constraints->valid_modes_mask & REGULATOR_MODE_IDLE)
+		count += sprintf(buf + count, "idle ");
+	if (constraints->valid_modes_mask & REGULATOR_MODE_STANDBY)
+		count += sprintf(buf + count, "standby");
+
+	pr_debug("regulator: %s: %s\n", rdev->desc->name, buf);
+}
+
+/*
+ * Refresh rdev->limits for the constraints in use, called whenever
+ * rdev->constraints changes.  Where the driver can list its voltages
+ * the voltage range is narrowed to those it can produce, unless the
+ * two don't overlap at all in which case the driver is left to reject
+ * requests as before.
+ */
+static void regulator_digest_constraints(struct regulator_dev *rdev)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	struct regulator_limits *limits = &rdev->limits;
+	struct regulator_ops *ops = rdev->desc->ops;
+	int i, uV, hw_min_uV = INT_MAX, hw_max_uV = INT_MIN;
+
+	memset(limits, 0, sizeof(*limits));
+	if (!constraints)
+		return;
+
+	limits->ops = constraints->valid_ops_mask;
+	limits->modes = constraints->valid_modes_mask;
+	limits->min_uV = constraints->min_uV;
+	limits->max_uV = constraints->max_uV;
+	limits->min_uA = constraints->min_uA;
+	limits->max_uA = constraints->max_uA;
+
+	if (!(limits->ops & REGULATOR_CHANGE_VOLTAGE) || !ops->list_voltage)
+		return;
+
+	for (i = 0; i < rdev->desc->n_voltages; i++) {
+		uV = ops->list_voltage(rdev, i);
+		if (uV <= 0)
+			continue;
+		hw_min_uV = min(hw_min_uV, uV);
+		hw_max_uV = max(hw_max_uV, uV);
+	}
+
+	if (hw_min_uV > limits->max_uV || hw_max_uV < limits->min_uV) {
+		if (hw_min_uV <= hw_max_uV)
+			printk(KERN_WARNING "%s: %s can't produce %d-%duV\n",
+			       __func__, rdev->desc->name,
+			       limits->min_uV, limits->max_uV);
+		return;
+	}
+
+	limits->min_uV = max(limits->min_uV, hw_min_uV);
+	limits->max_uV = min(limits->max_uV, hw_max_uV);
+}
+
+static const char *regulator_constraints_name(struct regulator_dev *rdev)
+{
+	if (rdev->constraints->name)
+		return rdev->constraints->name;
+	else if (rdev->desc->name)
+		return rdev->desc->name;
+	else
+		return "regulator";
+}
+
+/*
+ * The hardware side of the machine constraints: the voltage, the
+ * initial suspend state and always_on.  Run as the regulator registers
+ * or, with regulator_defer_constraints(), later along with the rest of
+ * its PMIC.
+ */
+static int regulator_apply_constraints(struct regulator_dev *rdev)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	struct regulator_ops *ops = rdev->desc->ops;
+	const char *name = regulator_constraints_name(rdev);
+	int ret;
+
+	/* do we need to apply the constraint voltage */
+	if (constraints->apply_uV &&
+	    constraints->min_uV == constraints->max_uV &&
+	    _regulator_can_set_voltage(rdev)) {
+		ret = rdev_do_set_voltage(rdev, constraints->min_uV,
+					  constraints->max_uV);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to apply %duV constraint to %s\n",
+			       __func__, constraints->min_uV, name);
+			return ret;
+		}
+	}
+
+	/* do we need to setup our suspend state */
+	if (constraints->initial_state) {
+		ret = suspend_prepare(rdev, constraints->initial_state);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to set suspend state for %s\n",
+			       __func__, name);
+			return ret;
+		}
+	}
+
+	/* if always_on is set then turn the regulator on if it's not
+	 * already on. */
+	if (constraints->always_on && ops->enable &&
+	    ((ops->is_enabled && !ops->is_enabled(rdev)) ||
+	     (!ops->is_enabled && !constraints->boot_on))) {
+		ret = rdev_do_enable(rdev);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to enable %s\n",
+			       __func__, name);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * set_machine_constraints - sets regulator constraints
+ * @regulator: regulator source
+ *
+ * Allows platform initialisation code to define and constrain
+ * regulator circuits e.g. valid voltage/current ranges, etc.  NOTE:
+ * Constraints *must* be set by platform code in order for some
+ * regulator operations to proceed i.e. set_voltage, set_current_limit,
+ * set_mode.
+ */
+static int set_machine_constraints(struct regulator_dev *rdev,
+	struct regulation_constraints *constraints)
+{
+	int ret = 0;
+
+	rdev->constraints = constraints;
+
+	/* are we enabled at boot time by firmware / bootloader */
+	if (constraints->boot_on) {
+		rdev->use_count = 1;
+		rdev->stats.enabled_since = ktime_to_ns(ktime_get());
+		regulator_energy_update(rdev);
+	}
+
+	/* regulator_register() queues us once we are on regulator_list */
+	mutex_lock(&regulator_list_mutex);
+	rdev->init_pending = regulator_defer;
+	mutex_unlock(&regulator_list_mutex);
+
+	if (!rdev->init_pending) {
+		ret = regulator_apply_constraints(rdev);
+		if (ret < 0) {
+			rdev->constraints = NULL;
+			goto out;
+		}
+	}
+
+	print_constraints(rdev);
+out:
+	regulator_digest_constraints(rdev);
+	return ret;
+}
+
+/*
+ * Apply the deferred constraints of the regulators on pmic in the order
+ * they were registered, so the chip gets its writes as a single run.  A
+ * failure is reported but leaves the regulator usable as there is no
+ * caller to fail by now.  regulator_list_mutex held.
+ */
+static void regulator_flush_pmic(void *pmic)
+{
+	struct regulator_dev *rdev, *next;
+	int ret;
+
+	list_for_each_entry_safe(rdev, next, &regulator_init_list, init_list) {
+		if (regulator_pmic(rdev) != pmic)
+			continue;
+
+		list_del_init(&rdev->init_list);
+		regulator_lock(rdev);
+		ret = regulator_apply_constraints(rdev);
+		regulator_unlock(rdev);
+		if (ret < 0)
+			printk(KERN_ERR "%s: constraints of %s not "
+			       "applied: %d\n", __func__, rdev->desc->name,
+			       ret);
+	}
+}
+
+/* flush everything still queued, a PMIC at a time */
+static void regulator_flush_constraints(void)
+{
+	struct regulator_dev *rdev;
+
+	while (!list_empty(&regulator_init_list)) {
+		rdev = list_first_entry(&regulator_init_list,
+					struct regulator_dev, init_list);
+		regulator_flush_pmic(regulator_pmic(rdev));
+	}
+}
+
+/**
+ * regulator_defer_constraints - apply boot constraints per PMIC
+ *
+ * Called by machine code before its regulators register.  Rather than
+ * being written as each regulator registers, the voltages, initial
+ * suspend states and always_on enables given by the constraints are
+ * queued and written a PMIC at a time: when something first gets a
+ * regulator on the PMIC or supplying one on it, or at the end of boot.
+ * Regulators registered after boot are configured as they register.
+ * Machines should only use this if nothing relies on those settings
+ * before then without getting the regulator.
+ */
+void regulator_defer_constraints(void)
+{
+	mutex_lock(&regulator_list_mutex);
+	regulator_defer = 1;
+	mutex_unlock(&regulator_list_mutex);
+}
+EXPORT_SYMBOL_GPL(regulator_defer_constraints);
+
+/* find the regulator registered for dev, regulator_list_mutex held */
+static struct regulator_dev *regulator_dev_lookup(struct device *dev)
+{
+	struct regulator_dev *rdev;
+
+	list_for_each_entry(rdev, &regulator_list, list)
+		if (rdev->dev.parent == dev)
+			return rdev;
+	return NULL;
+}
+
+/* join the domain of rdev's PMIC, regulator_list_mutex held */
+static struct regulator_domain *regulator_domain_get(struct regulator_dev *rdev)
+{
+	struct regulator_domain *domain;
+	void *pmic = regulator_pmic(rdev);
+
+	list_for_each_entry(domain, &regulator_domain_list, list) {
+		if (domain->pmic == pmic) {
+			domain->users++;
+			return domain;
+		}
+	}
+
+	domain = kzalloc(sizeof(*domain), GFP_KERNEL);
+	if (domain == NULL)
+		return NULL;
+
+	domain->pmic = pmic;
+	domain->users = 1;
+	mutex_init(&domain->lock);
+	list_add(&domain->list, &regulator_domain_list);
+
+	return domain;
+}
+
+/* regulator_list_mutex held */
+static void regulator_domain_put(struct regulator_domain *domain)
+{
+	if (domain == NULL || --domain->users)
+		return;
+
+	list_del(&domain->list);
+	kfree(domain);
+}
+
+static void regulator_set_depth(struct regulator_dev *rdev, int depth)
+{
+	struct regulator_dev *child;
+
+	rdev->depth = depth;
+	list_for_each_entry(child, &rdev->supply_list, slist)
+		regulator_set_depth(child, depth + 1);
+}
+
+/**
+ * set_supply - set regulator supply regulator
+ * @regulator: regulator name
+ * @supply: supply regulator name
+ *
+ * Called by platform initialisation code to set the supply regulator for this
+ * regulator. This ensures that a regulators supply will also be enabled by the
+ * core if it's child is enabled.  The supply may be registered after the
+ * regulator, in which case a regulator already in use takes a reference on
+ * it and passes its load up as it is linked.  regulator_list_mutex held.
+ */
+static int set_supply(struct regulator_dev *rdev,
+	struct regulator_dev *supply_rdev)
+{
+	int err;
+
+	err = sysfs_create_link(&rdev->dev.kobj, &supply_rdev->dev.kobj,
+				"supply");
+	if (err) {
+		printk(KERN_ERR
+		       "%s: could not add device link %s err %d\n",
+		       __func__, supply_rdev->dev.kobj.name, err);
+		       goto out;
+	}
+	rdev->supply = supply_rdev;
+	regulator_set_depth(rdev, supply_rdev->depth + 1);
+	mutex_lock(&supply_rdev->domain->lock);
+	list_add_rcu(&rdev->slist, &supply_rdev->supply_list);
+	mutex_unlock(&supply_rdev->domain->lock);
+
+	regulator_lock(rdev);
+	if (rdev->use_count > 0) {
+		regulator_lock(supply_rdev);
+		if (_regulator_enable(supply_rdev) < 0)
+			printk(KERN_WARNING "%s: failed to enable supply %s\n",
+			       __func__, supply_rdev->desc->name);
+		regulator_unlock(supply_rdev);
+	}
+	if (_regulator_get_load(rdev))
+		drms_uA_update(rdev);
+	regulator_unlock(rdev);
+out:
+	return err;
+}
+
+/* link any regulators which were waiting for rdev to supply them */
+static void regulator_resolve_children(struct regulator_dev *rdev)
+{
+	struct regulator_dev *child;
+
+	list_for_each_entry(child, &regulator_list, list) {
+		if (child->supply_dev != rdev->dev.parent)
+			continue;
+		if (set_supply(child, rdev) < 0)
+			continue;
+		child->supply_dev = NULL;
+	}
+}
+
+/* pair rdev with its coupled regulator once both are registered, each
+ * must name the other with the same spread.  regulator_list_mutex held */
+static void regulator_resolve_coupled(struct regulator_dev *rdev)
+{
+	struct regulation_constraints *constraints = rdev->constraints;
+	struct regulator_dev *coupled;
+
+	if (!constraints || !constraints->coupled_regulator_dev)
+		return;
+
+	/* otherwise we're paired when it registers */
+	coupled = regulator_dev_lookup(constraints->coupled_regulator_dev);
+	if (!coupled)
+		return;
+
+	if (!coupled->constraints ||
+	    coupled->constraints->coupled_regulator_dev != rdev->dev.parent ||
+	    coupled->constraints->max_spread_uV != constraints->max_spread_uV ||
+	    !constraints->max_spread_uV) {
+		printk(KERN_ERR "%s: %s and %s don't agree on their coupling\n",
+		       __func__, rdev->desc->name, coupled->desc->name);
+		return;
+	}
+
+	if (!_regulator_can_set_voltage(rdev) ||
+	    !_regulator_can_set_voltage(coupled)) {
+		printk(KERN_ERR "%s: can't couple %s and %s without voltage "
+		       "control\n", __func__, rdev->desc->name,
+		       coupled->desc->name);
+		return;
+	}
+
+	mutex_lock(&regulator_coupled_mutex);
+	rdev->coupled = coupled;
+	coupled->coupled = rdev;
+	mutex_unlock(&regulator_coupled_mutex);
+}
+
+static inline struct hlist_head *regulator_map_bucket(struct device *dev,
+						     const char *supply)
+{
+	u32 hash = jhash(supply, strlen(supply), (u32)(unsigned long)dev);
+
+	return &regulator_map_hash[hash & (REGULATOR_MAP_HASH_SIZE - 1)];
+}
+
+/* find the regulator mapped to a device supply, rcu_read_lock() held */
+static struct regulator_dev *regulator_map_lookup(struct device *dev,
+						  const char *supply)
+{
+	struct regulator_map *map;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry_rcu(map, pos, regulator_map_bucket(dev, supply),
+				 hlist) {
+		if (dev == map->dev && strcmp(map->supply, supply) == 0)
+			return map->regulator;
+	}
+	return NULL;
+}
+
+/**
+ * set_consumer_device_supply: Bind a regulator to a symbolic supply
+ * @regulator: regulator source
+ * @dev:       device the supply applies to
+ * @supply:    symbolic name for supply
+ *
+ * Allows platform initialisation code to map physical regulator
+ * sources to symbolic names for supplies for use by devices.  Devices
+ * should use these symbolic names to request regulators, avoiding the
+ * need to provide board-specific regulator names as platform data.
+ */
+static int set_consumer_device_supply(struct regulator_dev *rdev,
+	struct device *consumer_dev, const char *supply)
+{
+	struct regulator_map *node;
+
+	if (supply == NULL)
+		return -EINVAL;
+
+	node = kmalloc(sizeof(struct regulator_map), GFP_KERNEL);
+	if (node == NULL)
+		return -ENOMEM;
+
+	node->regulator = rdev;
+	node->dev = consumer_dev;
+	node->supply = supply;
+
+	spin_lock(&regulator_map_lock);
+	list_add(&node->list, &regulator_map_list);
+	hlist_add_head_rcu(&node->hlist,
+			   regulator_map_bucket(consumer_dev, supply));
+	spin_unlock(&regulator_map_lock);
+	return 0;
+}
+
+static void unset_consumer_device_supply(struct regulator_dev *rdev,
+	struct device *consumer_dev)
+{
+	struct regulator_map *node, *n;
+
+	spin_lock(&regulator_map_lock);
+	list_for_each_entry_safe(node, n, &regulator_map_list, list) {
+		if (rdev == node->regulator &&
+			consumer_dev == node->dev) {
+			list_del(&node->list);
+			hlist_del_rcu(&node->hlist);
+			spin_unlock(&regulator_map_lock);
+			synchronize_rcu();
+			kfree(node);
+			return;
+		}
+	}
+	spin_unlock(&regulator_map_lock);
+}
+
+/* remove all supply mappings for a regulator that is going away */
+static void unset_regulator_supplies(struct regulator_dev *rdev)
+{
+	struct regulator_map *node, *n;
+	LIST_HEAD(dead);
+
+	spin_lock(&regulator_map_lock);
+	list_for_each_entry_safe(node, n, &regulator_map_list, list) {
+		if (rdev == node->regulator) {
+			hlist_del_rcu(&node->hlist);
+			list_move(&node->list, &dead);
+		}
+	}
+	spin_unlock(&regulator_map_lock);
+
+	if (list_empty(&dead))
+		return;
+
+	synchronize_rcu();
+	list_for_each_entry_safe(node, n, &dead, list)
+		kfree(node);
+}
+
+static void regulator_disable_work(struct work_struct *work);
+static void regulator_async_work(struct work_struct *work);
+
+#ifdef CONFIG_REGULATOR_CONSUMER_SYSFS
+static ssize_t device_requested_uA_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	/* each consumer has its own attribute */
+	struct regulator_sysfs *sysfs = container_of(attr,
+						     struct regulator_sysfs,
+						     dev_attr);
+
+	return sprintf(buf, "%d\n", sysfs->regulator->uA_load);
+}
+
+/* does dev already have sysfs entries for this supply of rdev */
+static int regulator_has_sysfs(struct regulator_dev *rdev, const char *name)
+{
+	struct regulator *regulator;
+
+	list_for_each_entry(regulator, &rdev->consumer_list, list) {
+		if (regulator->sysfs &&
+		    strcmp(regulator->sysfs->link_name, name) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* add debug sysfs entries for a consumer, failure is not fatal */
+static void regulator_sysfs_add(struct regulator_dev *rdev,
+				struct regulator *regulator,
+				const char *supply_name)
+{
+	struct device *dev = regulator->dev;
+	struct regulator_sysfs *sysfs;
+	int err;
+
+	sysfs = kzalloc(sizeof(*sysfs), GFP_KERNEL);
+	if (sysfs == NULL)
+		return;
+
+	if (snprintf(sysfs->link_name, REG_STR_SIZE, "%s-%s",
+		     dev->kobj.name, supply_name) >= REG_STR_SIZE ||
+	    snprintf(sysfs->attr_name, REG_STR_SIZE, "microamps_requested_%s",
+		     supply_name) >= REG_STR_SIZE)
+		goto err;
+
+	/* further handles on the same supply share the first's entries */
+	if (regulator_has_sysfs(rdev, sysfs->link_name))
+		goto err;
+
+	/* create a 'requested_microamps_name' sysfs entry */
+	sysfs->regulator = regulator;
+	sysfs->dev_attr.attr.name = sysfs->attr_name;
+	sysfs->dev_attr.attr.owner = THIS_MODULE;
+	sysfs->dev_attr.attr.mode = 0444;
+	sysfs->dev_attr.show = device_requested_uA_show;
+	err = device_create_file(dev, &sysfs->dev_attr);
+	if (err < 0) {
+		printk(KERN_WARNING "%s: could not add regulator_dev"
+			" load sysfs\n", __func__);
+		goto err;
+	}
+
+	/* also add a link to the device sysfs entry */
+	err = sysfs_create_link(&rdev->dev.kobj, &dev->kobj,
+				sysfs->link_name);
+	if (err) {
+		printk(KERN_WARNING
+		       "%s: could not add device link %s err %d\n",
+		       __func__, dev->kobj.name, err);
+		device_remove_file(dev, &sysfs->dev_attr);
+		goto err;
+	}
+
+	regulator->sysfs = sysfs;
+	return;
+
+err:
+	kfree(sysfs);
+}
+
+static void regulator_sysfs_remove(struct regulator_dev *rdev,
+				   struct regulator *regulator)
+{
+	struct regulator_sysfs *sysfs = regulator->sysfs;
+
+	if (sysfs == NULL)
+		return;
+
+	sysfs_remove_link(&rdev->dev.kobj, sysfs->link_name);
+	device_remove_file(regulator->dev, &sysfs->dev_attr);
+	kfree(sysfs);
+	regulator->sysfs = NULL;
+}
+#else
+static inline void regulator_sysfs_add(struct regulator_dev *rdev,
+				       struct regulator *regulator,
+				       const char *supply_name)
+{
+}
+
+static inline void regulator_sysfs_remove(struct regulator_dev *rdev,
+					  struct regulator *regulator)
+{
+}
+#endif
+
+static struct regulator *create_regulator(struct regulator_dev *rdev,
+					  struct device *dev,
+					  const char *supply_name)
+{
+	struct regulator *regulator;
+
+	regulator = kzalloc(sizeof(*regulator), GFP_KERNEL);
+	if (regulator == NULL)
+		return NULL;
+
+	regulator->rdev = rdev;
+	regulator->dev = dev;
+	INIT_DELAYED_WORK(&regulator->disable_work, regulator_disable_work);
+	INIT_WORK(&regulator->async_work, regulator_async_work);
+
+	/* sysfs work is slow so only the list update holds the state lock */
+	mutex_lock(&rdev->config_lock);
+	regulator_lock(rdev);
+	list_add(&regulator->list, &rdev->consumer_list);
+	regulator_unlock(rdev);
+
+	if (dev)
+		regulator_sysfs_add(rdev, regulator, supply_name);
+	mutex_unlock(&rdev->config_lock);
+
+	return regulator;
+}
+
+/* find the regulator for a consumer supply, rcu_read_lock() held */
+static struct regulator_dev *regulator_supply_lookup(struct device *dev,
+						     const char *supply)
+{
+	struct regulator_dev *rdev;
+
+	rdev = regulator_map_lookup(dev, supply);
+	if (rdev == NULL && regulator_dummy()) {
+		printk(KERN_WARNING "regulator: %s supply %s not mapped, "
+		       "using dummy regulator\n",
+		       dev ? dev_name(dev) : "(none)", supply);
+		rdev = regulator_dummy();
+	}
+
+	return rdev;
+}
+
+/* the consumer is about to use rdev so bring the PMICs of it and its
+ * supplies up to their boot constraints */
+static void regulator_flush_supplies(struct regulator_dev *rdev)
+{
+	/* nothing is queued unless constraints are being deferred, and
+	 * once boot is over they never are, so consumers getting their
+	 * supplies don't touch the global lock */
+	if (!ACCESS_ONCE(regulator_defer) && list_empty(&regulator_init_list))
+		return;
+
+	mutex_lock(&regulator_list_mutex);
+	for (; rdev && !list_empty(&regulator_init_list); rdev = rdev->supply)
+		regulator_flush_pmic(regulator_pmic(rdev));
+	mutex_unlock(&regulator_list_mutex);
+}
+
+/**
+ * regulator_get - lookup and obtain a reference to a regulator.
+ * @dev: device for regulator "consumer"
+ * @id: Supply name or regulator ID.
+ *
+ * Returns a struct regulator corresponding to the regulator producer,
+ * or IS_ERR() condition containing errno.  Use of supply names
+ * configured via regulator_set_device_supply() is strongly
+ * encouraged.
+ */
+struct regulator *regulator_get(struct device *dev, const char *id)
+{
+	struct regulator_dev *rdev;
+	struct regulator *regulator = ERR_PTR(-ENODEV);
+
+	if (id == NULL) {
+		printk(KERN_ERR "regulator: get() with no identifier\n");
+		return regulator;
+	}
+
+	/* unset_regulator_supplies() waits for us before the regulator can
+	 * be unregistered, so take the module and device references that
+	 * keep it around once we leave RCU */
+	rcu_read_lock();
+	rdev = regulator_supply_lookup(dev, id);
+	if (rdev && !try_module_get(rdev->owner)) {
+		rcu_read_unlock();
+		return regulator;
+	}
+	if (rdev)
+		get_device(&rdev->dev);
+	rcu_read_unlock();
+
+	if (rdev == NULL) {
+		printk(KERN_ERR "regulator: Unable to get requested regulator: %s\n",
+		       id);
+		return regulator;
+	}
+
+	regulator_flush_supplies(rdev);
+
+	regulator = create_regulator(rdev, dev, id);
+	if (regulator == NULL) {
+		regulator = ERR_PTR(-ENOMEM);
+		put_device(&rdev->dev);
+		module_put(rdev->owner);
+	}
+
+	return regulator;
+}
+EXPORT_SYMBOL_GPL(regulator_get);
+
+/**
+ * regulator_put - "free" the regulator source
+ * @regulator: regulator source
+ *
+ * Note: drivers must ensure that all regulator_enable calls made on this
+ * regulator source are balanced by regulator_disable calls prior to calling
+ * this function.
+ */
+void regulator_put(struct regulator *regulator)
+{
+	struct regulator_dev *rdev;
+
+	if (regulator == NULL || IS_ERR(regulator))
+		return;
+
+	/* anything asynchronous not yet started is dropped */
+	regulator_cancel_async(regulator);
+
+	regulator_disable_flush(regulator);
+
+	if (regulator->enable_count) {
+		printk(KERN_WARNING "Releasing supply %s while enabled\n",
+		       regulator->rdev->desc->name);
+		WARN_ON(regulator->enable_count);
+		regulator->enable_count = 1;
+		regulator_disable(regulator);
+	}
+
+	rdev = regulator->rdev;
+	mutex_lock(&rdev->config_lock);
+
+	/* remove any sysfs entries */
+	regulator_sysfs_remove(rdev, regulator);
+	regulator_lock(rdev);
+	list_del(&regulator->list);
+	regulator_unlock(rdev);
+
+	mutex_unlock(&rdev->config_lock);
+	kfree(regulator);
+	module_put(rdev->owner);
+	put_device(&rdev->dev);
+}
+EXPORT_SYMBOL_GPL(regulator_put);
+
+/* locks held by regulator_enable() */
+static int _regulator_enable(struct regulator_dev *rdev)
+{
+	int ret;
+
+	if (!rdev->constraints) {
+		printk(KERN_ERR "%s: %s has no constraints\n",
+		       __func__, rdev->desc->name);
+		return -EINVAL;
+	}
+
+	/* only the first user needs to touch the hardware */
+	if (rdev->use_count > 0) {
+		rdev->use_count++;
+		return 0;
+	}
+
+	if (!rdev->desc->ops->enable && !rdev->desc->fixed_uV)
+		return -EINVAL;
+
+	/* do we need to enable the supply regulator first, and raise it
+	 * to meet our dropout now that we will be on */
+	if (rdev->supply) {
+		regulator_lock(rdev->supply);
+		ret = _regulator_enable(rdev->supply);
+		if (ret == 0 && rdev->supply_min_uV &&
+		    !regulator_is_coupled(rdev->supply)) {
+			rdev->enabling = 1;
+			ret = _regulator_apply_voltage(rdev->supply, NULL);
+			rdev->enabling = 0;
+			if (ret < 0)
+				_regulator_disable(rdev->supply);
+		}
+		regulator_unlock(rdev->supply);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to enable %s: %d\n",
+			       __func__, rdev->desc->name, ret);
+			return ret;
+		}
+	}
+
+	/* fixed regulators are always on, we only count their users */
+	if (rdev->desc->fixed_uV) {
+		rdev->use_count++;
+		return 0;
+	}
+
+	/* check voltage and requested load before enabling */
+	if (rdev->constraints->valid_ops_mask & REGULATOR_CHANGE_DRMS)
+		drms_uA_update(rdev);
+
+	ret = rdev_do_enable(rdev);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to enable %s: %d\n",
+		       __func__, rdev->desc->name, ret);
+		/* drop the reference we took on our supply */
+		if (rdev->supply) {
+			regulator_lock(rdev->supply);
+			_regulator_disable(rdev->supply);
+			regulator_unlock(rdev->supply);
+		}
+		return ret;
+	}
+	rdev->use_count++;
+
+	_regulator_delay(_regulator_enable_time(rdev));
+
+	return 0;
+}
+
+/**
+ * regulator_enable - enable regulator output
+ * @regulator: regulator source
+ *
+ * Enable the regulator output at the predefined voltage or current value.
+ * NOTE: the output value can be set by other drivers, boot loader or may be
+ * hardwired in the regulator.
+ * NOTE: calls to regulator_enable() must be balanced with calls to
+ * regulator_disable().  Calls may be nested, only the first enable of
+ * each consumer takes a reference on the regulator.
+ */
+int regulator_enable(struct regulator *regulator)
+{
+	int ret = 0;
+
+	/* The count is tested and updated in the same lock section as
+	 * the hardware so racing enables and disables stay balanced.
+	 * A pending deferred disable just gets cancelled, the supply
+	 * was never turned off; nested enables only count.
+	 */
+	regulator_lock_consumer(regulator);
+	if (regulator->disable_pending) {
+		regulator->disable_pending = 0;
+		cancel_delayed_work(&regulator->disable_work);
+		goto out;
+	}
+	if (regulator->enable_count) {
+		regulator->enable_count++;
+		goto out;
+	}
+
+	regulator->enable_count = 1;
+
+	/* make sure the rail meets our voltage request before powering us */
+	if (regulator->max_uV) {
+		ret = _regulator_apply_voltage(regulator->rdev, regulator);
+		if (ret < 0) {
+			regulator->enable_count = 0;
+			goto out;
+		}
+	}
+
+	/* and our current limit and mode requests */
+	if (regulator->max_uA) {
+		ret = _regulator_apply_current(regulator->rdev, regulator);
+		if (ret < 0) {
+			regulator->enable_count = 0;
+			goto out;
+		}
+	}
+
+	if (regulator->mode) {
+		ret = _regulator_apply_mode(regulator->rdev);
+		if (ret < 0) {
+			regulator->enable_count = 0;
+			goto out;
+		}
+	}
+
+	ret = _regulator_enable(regulator->rdev);
+	if (ret != 0)
+		regulator->enable_count = 0;
+	regulator_energy_update(regulator->rdev);
+out:
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_enable);
+
+/* locks held by regulator_disable() */
+static int _regulator_disable(struct regulator_dev *rdev)
+{
+	int ret = 0;
+
+	/* are we the last user and permitted to disable ? */
+	if (rdev->use_count == 1 && !rdev->constraints->always_on) {
+		regulator_clear_fault(rdev);
+
+		/* we are last user */
+		if (rdev->desc->ops->disable) {
+			ret = rdev_do_disable(rdev);
+			if (ret < 0) {
+				printk(KERN_ERR "%s: failed to disable %s\n",
+				       __func__, rdev->desc->name);
+				return ret;
+			}
+		}
+
+		/* decrease our supplies ref count and disable if required */
+		if (rdev->supply) {
+			regulator_lock(rdev->supply);
+			_regulator_disable(rdev->supply);
+			regulator_unlock(rdev->supply);
+		}
+
+		rdev->use_count = 0;
+	} else if (rdev->use_count > 1) {
+
+		if (rdev->constraints &&
+			(rdev->constraints->valid_ops_mask &
+			REGULATOR_CHANGE_DRMS))
+			drms_uA_update(rdev);
+
+		rdev->use_count--;
+	}
+	return ret;
+}
+
+/**
+ * regulator_disable - disable regulator output
+ * @regulator: regulator source
+ *
+ * Disable the regulator output voltage or current.
+ * NOTE: this will only disable the regulator output if no other consumer
+ * devices have it enabled.
+ * NOTE: calls to regulator_enable() must be balanced with calls to
+ * regulator_disable().  Only the last disable of each consumer drops
+ * its reference on the regulator, an unbalanced call returns -EIO.
+ */
+int regulator_disable(struct regulator *regulator)
+{
+	int ret = 0;
+
+	/* as for regulator_enable(), all in one lock section */
+	regulator_lock_consumer(regulator);
+	if (!regulator->enable_count) {
+		printk(KERN_ERR "%s: not in use by this consumer\n",
+			__func__);
+		ret = -EIO;
+		goto out;
+	}
+
+	if (regulator->enable_count > 1 && !regulator->disable_pending) {
+		regulator->enable_count--;
+		goto out;
+	}
+
+	if (regulator->disable_pending) {
+		regulator->disable_pending = 0;
+		cancel_delayed_work(&regulator->disable_work);
+	}
+	regulator->enable_count = 0;
+	regulator->uA_load = 0;
+	ret = _regulator_disable(regulator->rdev);
+	if (regulator->max_uA)
+		_regulator_apply_current(regulator->rdev, NULL);
+	if (regulator->mode)
+		_regulator_apply_mode(regulator->rdev);
+	regulator_energy_update(regulator->rdev);
+out:
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_disable);
+
+static void regulator_disable_work(struct work_struct *work)
+{
+	struct regulator *regulator = container_of(work, struct regulator,
+						   disable_work.work);
+	struct regulator_dev *rdev = regulator->rdev;
+
+	regulator_lock_consumer(regulator);
+	/* the consumer may have re-enabled while we were waiting */
+	if (regulator->disable_pending) {
+		regulator->disable_pending = 0;
+		regulator->enable_count = 0;
+		regulator->uA_load = 0;
+		_regulator_disable(rdev);
+		if (regulator->max_uA)
+			_regulator_apply_current(rdev, NULL);
+		if (regulator->mode)
+			_regulator_apply_mode(rdev);
+		regulator_energy_update(rdev);
+	}
+	regulator_unlock_consumer(regulator);
+}
+
+/**
+ * regulator_disable_deferred - disable regulator output after a delay
+ * @regulator: regulator source
+ * @ms: milliseconds until the regulator is disabled
+ *
+ * Execute regulator_disable() on the regulator after a delay.  If the
+ * consumer calls regulator_enable() before the delay expires then the
+ * disable is cancelled without the hardware being touched, avoiding
+ * toggling supplies for consumers with bursty activity.
+ *
+ * NOTE: this counts as a regulator_disable() call for the purposes of
+ * balancing regulator_enable() calls.  Nested enables are dropped
+ * immediately, only the final disable is deferred.  Returns -EIO if
+ * the consumer has no enable left to drop or a disable already pending.
+ */
+int regulator_disable_deferred(struct regulator *regulator, int ms)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+
+	if (!ms)
+		return regulator_disable(regulator);
+
+	regulator_lock(rdev);
+	if (!regulator->enable_count || regulator->disable_pending) {
+		regulator_unlock(rdev);
+		printk(KERN_ERR "%s: not in use by this consumer\n",
+			__func__);
+		return -EIO;
+	}
+	if (regulator->enable_count > 1) {
+		regulator->enable_count--;
+		regulator_unlock(rdev);
+		return 0;
+	}
+	regulator->disable_pending = 1;
+	schedule_delayed_work(&regulator->disable_work,
+			      msecs_to_jiffies(ms));
+	regulator_unlock(rdev);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(regulator_disable_deferred);
+
+/**
+ * regulator_disable_flush - carry out a pending deferred disable now
+ * @regulator: regulator source
+ *
+ * If a regulator_disable_deferred() is still waiting for its delay to
+ * expire the regulator is disabled immediately, otherwise nothing is
+ * done.  For consumers which are about to stop using the supply, for
+ * example when suspending.
+ */
+void regulator_disable_flush(struct regulator *regulator)
+{
+	cancel_delayed_work_sync(&regulator->disable_work);
+	if (regulator->disable_pending)
+		regulator_disable(regulator);
+}
+EXPORT_SYMBOL_GPL(regulator_disable_flush);
+
+static void regulator_async_work(struct work_struct *work)
+{
+	struct regulator *regulator = container_of(work, struct regulator,
+						   async_work);
+	void (*done)(struct regulator *regulator, int ret, void *data);
+	void *data;
+	int ret;
+
+	done = regulator->async_done;
+	data = regulator->async_data;
+
+	/* the enable returns once the output has settled */
+	if (regulator->async_enable)
+		ret = regulator_enable(regulator);
+	else
+		ret = regulator_disable(regulator);
+
+	/* done may queue the next operation, bulk operations made from it
+	 * are run on regulator_parallel_wq so don't wait on us */
+	clear_bit(0, &regulator->async_pending);
+	if (done)
+		done(regulator, ret, data);
+}
+
+static int regulator_queue_async(struct regulator *regulator, int enable,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data)
+{
+	if (test_and_set_bit(0, &regulator->async_pending))
+		return -EBUSY;
+
+	regulator->async_enable = enable;
+	regulator->async_done = done;
+	regulator->async_data = data;
+
+	if (regulator_wq)
+		queue_work(regulator_wq, &regulator->async_work);
+	else
+		schedule_work(&regulator->async_work);
+
+	return 0;
+}
+
+/**
+ * regulator_enable_async - enable regulator output without waiting
+ * @regulator: regulator source
+ * @done: called with the result of the enable once the output is stable,
+ *        may be NULL
+ * @data: passed to @done
+ *
+ * Queue regulator_enable() to be run by the core, for consumers which
+ * can't sleep for the bus traffic and the settling time of the supply
+ * chain or which have other work to do meanwhile.  May be called from
+ * atomic context.  @done is called from the core's workqueue and may
+ * queue another operation or use the bulk operations, but must not put
+ * @regulator or cancel its own operation since that waits for @done.
+ * Without regulator support nothing is queued and @done is called
+ * before this returns, in the caller's context, so it must not sleep
+ * if this is called from atomic context.
+ *
+ * Each consumer may have one asynchronous operation outstanding at a
+ * time, -EBUSY is returned if another is already queued.  Once @done
+ * has been called with success the enable is balanced in the same way
+ * as one made by regulator_enable().
+ */
+int regulator_enable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data)
+{
+	return regulator_queue_async(regulator, 1, done, data);
+}
+EXPORT_SYMBOL_GPL(regulator_enable_async);
+
+/**
+ * regulator_disable_async - disable regulator output without waiting
+ * @regulator: regulator source
+ * @done: called with the result of the disable, may be NULL
+ * @data: passed to @done
+ *
+ * Queue regulator_disable() to be run by the core, as for
+ * regulator_enable_async().
+ */
+int regulator_disable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data)
+{
+	return regulator_queue_async(regulator, 0, done, data);
+}
+EXPORT_SYMBOL_GPL(regulator_disable_async);
+
+/**
+ * regulator_cancel_async - cancel an asynchronous enable or disable
+ * @regulator: regulator source
+ *
+ * Returns 1 if an operation was cancelled before it started, in which
+ * case the regulator is untouched and its callback isn't called.
+ * Otherwise returns 0 once any operation already running has completed
+ * and called back.  May sleep.
+ */
+int regulator_cancel_async(struct regulator *regulator)
+{
+	if (cancel_work_sync(&regulator->async_work)) {
+		clear_bit(0, &regulator->async_pending);
+		return 1;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(regulator_cancel_async);
+
+/* locks held by regulator_force_disable() */
+static int _regulator_force_disable(struct regulator_dev *rdev)
+{
+	int ret = 0;
+
+	regulator_clear_fault(rdev);
+
+	/* force disable */
+	if (rdev->desc->ops->disable) {
+		/* ah well, who wants to live forever... */
+		ret = rdev_do_disable(rdev);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to force disable %s\n",
+			       __func__, rdev->desc->name);
+			return ret;
+		}
+		/* notify other consumers that power has been forced off */
+		regulator_post_event(rdev, REGULATOR_EVENT_FORCE_DISABLE);
+	}
+
+	/* decrease our supplies ref count and disable if required, we
+	 * only hold a reference on it while we have users ourselves */
+	if (rdev->supply && rdev->use_count > 0) {
+		regulator_lock(rdev->supply);
+		_regulator_disable(rdev->supply);
+		regulator_unlock(rdev->supply);
+	}
+
+	rdev->use_count = 0;
+	return ret;
+}
+
+/**
+ * regulator_force_disable - force disable regulator output
+ * @regulator: regulator source
+ *
+ * Forcibly disable the regulator output voltage or current.
+ * NOTE: this *will* disable the regulator output even if other consumer
+ * devices have it enabled. This should be used for situations when device
+ * damage will likely occur if the regulator is not disabled (e.g. over temp).
+ */
+int regulator_force_disable(struct regulator *regulator)
+{
+	int ret;
+
+	regulator_lock_consumer(regulator);
+	if (regulator->disable_pending) {
+		regulator->disable_pending = 0;
+		cancel_delayed_work(&regulator->disable_work);
+	}
+	regulator->enable_count = 0;
+	regulator->uA_load = 0;
+	ret = _regulator_force_disable(regulator->rdev);
+	regulator_energy_update(regulator->rdev);
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_force_disable);
+
+static int _regulator_is_enabled(struct regulator_dev *rdev)
+{
+	int ret;
+
+	if (rdev->desc->fixed_uV)
+		return 1;
+
+	/* the cached state is updated under the mutex on every transition
+	 * made by the core so can be read without taking it */
+	ret = ACCESS_ONCE(rdev->enabled_state);
+	if (ret >= 0 && !rdev->desc->enable_volatile)
+		return ret;
+
+	regulator_lock(rdev);
+
+	/* sanity check */
+	if (!rdev->desc->ops->is_enabled) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = rdev_op(rdev, REGULATOR_OP_IS_ENABLED, 0,
+		      rdev->desc->ops->is_enabled(rdev));
+	if (ret >= 0)
+		rdev->enabled_state = ret > 0;
+out:
+	regulator_unlock(rdev);
+	return ret;
+}
+
+/**
+ * regulator_is_enabled - is the regulator output enabled
+ * @regulator: regulator source
+ *
+ * Returns zero for disabled otherwise return number of enable requests.
+ *
+ * The state is normally cached by the core so this does not need to
+ * access the hardware or take any locks.
+ */
+int regulator_is_enabled(struct regulator *regulator)
+{
+	return _regulator_is_enabled(regulator->rdev);
+}
+EXPORT_SYMBOL_GPL(regulator_is_enabled);
+
+/* Work out the voltage range that satisfies every enabled consumer that
+ * has requested a voltage, plus the consumer making the request.
+ * rdev->mutex held by caller */
+static int regulator_aggregate_voltage(struct regulator_dev *rdev,
+				       struct regulator *regulator,
+				       int *min_uV, int *max_uV)
+{
+	struct regulator *consumer;
+	struct regulator_dev *child;
+	int idx;
+
+	*min_uV = INT_MIN;
+	*max_uV = INT_MAX;
+
+	list_for_each_entry(consumer, &rdev->consumer_list, list) {
+		if (!consumer->max_uV)
+			continue;
+		if (!consumer->enable_count && consumer != regulator)
+			continue;
+
+		if (consumer->min_uV > *min_uV)
+			*min_uV = consumer->min_uV;
+		if (consumer->max_uV < *max_uV)
+			*max_uV = consumer->max_uV;
+	}
+
+	/* Regulators we supply with a dropout need us above their output
+	 * while they are on, _regulator_enable() raises us before they
+	 * are.  The supply list is changed under the domain lock, not
+	 * rdev->mutex, so walk it as an SRCU reader which keeps the
+	 * children from being freed. */
+	idx = srcu_read_lock(&regulator_list_srcu);
+	list_for_each_entry_rcu(child, &rdev->supply_list, slist) {
+		if (!ACCESS_ONCE(child->use_count) && !child->enabling)
+			continue;
+		if (child->supply_min_uV <= *min_uV)
+			continue;
+
+		*min_uV = max(child->supply_min_uV, rdev->limits.min_uV);
+		*max_uV = min(*max_uV, rdev->limits.max_uV);
+	}
+	srcu_read_unlock(&regulator_list_srcu, idx);
+
+	if (*min_uV > *max_uV) {
+		printk(KERN_ERR "%s: no voltage satisfies all consumers of %s\n",
+		       __func__, rdev->desc->name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int regulator_min_dropout(struct regulator_dev *rdev)
+{
+	if (rdev->constraints && rdev->constraints->min_dropout_uV)
+		return rdev->constraints->min_dropout_uV;
+
+	return rdev->desc->min_dropout_uV;
+}
+
+/* coupled, or configured to be once its partner registers */
+static int regulator_is_coupled(struct regulator_dev *rdev)
+{
+	return rdev->coupled ||
+		(rdev->constraints && rdev->constraints->max_spread_uV);
+}
+
+/* Supplies are only moved by the core if they can be; coupled ones are
+ * left alone as moving them would need regulator_coupled_mutex, which
+ * can't be taken with rdev->mutex held */
+static int regulator_tracks_supply(struct regulator_dev *rdev)
+{
+	struct regulator_dev *supply = rdev->supply;
+
+	return supply && regulator_min_dropout(rdev) > 0 &&
+		(supply->limits.ops & REGULATOR_CHANGE_VOLTAGE) &&
+		_regulator_can_set_voltage(supply) &&
+		!regulator_is_coupled(supply);
+}
+
+/* The voltage rdev should produce for min_uV..max_uV, drivers which pick
+ * the voltage themselves are assumed to pick the lowest */
+static int regulator_expected_uV(struct regulator_dev *rdev,
+				 int min_uV, int max_uV)
+{
+	int uV;
+
+	if (rdev->desc->ops->set_voltage || !rdev->desc->ops->list_voltage)
+		return min_uV;
+
+	if (_regulator_map_voltage(rdev, min_uV, max_uV, &uV) < 0)
+		return min_uV;
+
+	return uV;
+}
+
+/*
+ * Update the voltage rdev needs from its supply for an output of
+ * output_uV.  The requirement is rounded up to a voltage the supply can
+ * produce so the supply is only changed when it crosses one of its
+ * selectors.  If raise_only is set a lower requirement is ignored, used
+ * ahead of a change of output.  rdev->mutex held by caller, the supply
+ * is locked here.
+ */
+static int regulator_track_supply(struct regulator_dev *rdev, int output_uV,
+				  int raise_only)
+{
+	struct regulator_dev *supply = rdev->supply;
+	int need_uV, uV, old_uV, ret;
+
+	/* locking a coupled supply here would be ABBA against the
+	 * coupled path, which takes regulator_coupled_mutex first */
+	if (regulator_is_coupled(supply))
+		return 0;
+
+	need_uV = output_uV + regulator_min_dropout(rdev);
+
+	if (supply->desc->ops->list_voltage &&
+	    _regulator_map_voltage(supply, need_uV, supply->limits.max_uV,
+				   &uV) >= 0)
+		need_uV = uV;
+
+	if (need_uV == rdev->supply_min_uV ||
+	    (raise_only && need_uV < rdev->supply_min_uV))
+		return 0;
+
+	regulator_lock(supply);
+
+	old_uV = rdev->supply_min_uV;
+	rdev->supply_min_uV = need_uV;
+
+	ret = _regulator_apply_voltage(supply, NULL);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: can't set %s to %duV for %s: %d\n",
+		       __func__, supply->desc->name, need_uV,
+		       rdev->desc->name, ret);
+		rdev->supply_min_uV = old_uV;
+	}
+
+	regulator_unlock(supply);
+
+	return ret;
+}
+
+/* Set the output voltage range, notifying and waiting for the output to
+ * settle.  A supply we have a dropout for is raised first if needed and
+ * lowered after as far as the new output allows.  rdev->mutex held by
+ * caller */
+static int _regulator_set_voltage_range(struct regulator_dev *rdev,
+					int min_uV, int max_uV)
+{
+	struct regulator_voltage_change change;
+	int ret, old_uV = 0;
+	int notify = rdev->notifier.head != NULL;
+
+	/* we only need to wait for the output to slew if it is on but
+	 * notifiers always want to know where we are starting from */
+	if (rdev->use_count > 0 || notify)
+		old_uV = _regulator_get_voltage(rdev);
+
+	if (notify) {
+		change.old_uV = old_uV > 0 ? old_uV : 0;
+		change.min_uV = min_uV;
+		change.max_uV = max_uV;
+		change.new_uV = 0;
+
+		ret = blocking_notifier_call_chain(&rdev->notifier,
+					REGULATOR_EVENT_PRE_VOLTAGE_CHANGE,
+					&change);
+		ret = notifier_to_errno(ret);
+		if (ret < 0)
+			goto abort;
+	}
+
+	if (regulator_tracks_supply(rdev)) {
+		ret = regulator_track_supply(rdev,
+				regulator_expected_uV(rdev, min_uV, max_uV), 1);
+		if (ret < 0)
+			goto abort;
+	}
+
+	/* the driver picks the actual voltage so reread it on demand */
+	rdev->cached_uV = 0;
+	ret = rdev_do_set_voltage(rdev, min_uV, max_uV);
+	if (ret < 0)
+		goto abort;
+
+	rdev->req_min_uV = min_uV;
+	rdev->req_max_uV = max_uV;
+	regulator_energy_update(rdev);
+
+	/* drivers select the lowest voltage in range so slew towards that
+	 * unless the core picked the selector and knows the exact value */
+	if (rdev->use_count > 0)
+		_regulator_delay(_regulator_set_voltage_time(rdev, old_uV,
+				 rdev->cached_uV > 0 ?
+				 rdev->cached_uV : min_uV));
+
+	/* a failure here leaves the supply higher than needed, harmless */
+	if (regulator_tracks_supply(rdev))
+		regulator_track_supply(rdev, rdev->cached_uV > 0 ?
+				       rdev->cached_uV : min_uV, 0);
+
+	if (notify) {
+		change.new_uV = _regulator_get_voltage(rdev);
+		if (change.new_uV < 0)
+			change.new_uV = 0;
+		blocking_notifier_call_chain(&rdev->notifier,
+					     REGULATOR_EVENT_POST_VOLTAGE_CHANGE,
+					     &change);
+	}
+
+	return ret;
+
+abort:
+	if (notify)
+		blocking_notifier_call_chain(&rdev->notifier,
+					     REGULATOR_EVENT_ABORT_VOLTAGE_CHANGE,
+					     &change);
+	return ret;
+}
+
+/* Move rdev into [min_uV, max_uV] and its coupled regulator to the lowest
+ * voltage its own consumers accept, without the two ever being more than
+ * max_spread_uV apart.  The rails are stepped alternately, each as far
+ * towards its target as the other allows, so the change takes as few
+ * steps as possible.  rdev->mutex and regulator_coupled_mutex held */
+static int regulator_balance_coupled(struct regulator_dev *rdev,
+				     int min_uV, int max_uV)
+{
+	struct regulator_dev *rails[2] = { rdev, rdev->coupled };
+	int spread = rdev->constraints->max_spread_uV;
+	int lo[2], hi[2], target[2], cur[2], last[2] = { 0, 0 };
+	int i, ret, moved, steps = 0;
+
+	mutex_lock_nested(&rails[1]->mutex, REGULATOR_COUPLED_SUBCLASS);
+
+	lo[0] = min_uV;
+	hi[0] = max_uV;
+	ret = regulator_aggregate_voltage(rails[1], NULL, &lo[1], &hi[1]);
+	if (ret < 0)
+		goto out;
+	lo[1] = max(lo[1], rails[1]->constraints->min_uV);
+	hi[1] = min(hi[1], rails[1]->constraints->max_uV);
+
+	/* the lowest pair of voltages which keeps within the spread */
+	target[0] = lo[0];
+	target[1] = max(lo[1], target[0] - spread);
+	if (target[1] > target[0] + spread)
+		target[0] = target[1] - spread;
+	if (target[0] > hi[0] || target[1] > hi[1]) {
+		printk(KERN_ERR "%s: no voltages for %s and %s within %d uV\n",
+		       __func__, rails[0]->desc->name, rails[1]->desc->name,
+		       spread);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (i = 0; i < 2; i++) {
+		cur[i] = _regulator_get_voltage(rails[i]);
+		if (cur[i] <= 0) {
+			printk(KERN_ERR "%s: can't read %s voltage\n",
+			       __func__, rails[i]->desc->name);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	do {
+		moved = 0;
+		for (i = 0; i < 2; i++) {
+			int step_min = clamp(target[i], cur[!i] - spread,
+					     cur[!i] + spread);
+			int step_max = min(hi[i], cur[!i] + spread);
+
+			if (step_min == cur[i] || step_min == last[i])
+				continue;
+
+			ret = _regulator_set_voltage_range(rails[i], step_min,
+							   step_max);
+			if (ret < 0)
+				goto out;
+
+			last[i] = step_min;
+			cur[i] = _regulator_get_voltage(rails[i]);
+			if (cur[i] <= 0)
+				cur[i] = step_min;
+			moved = 1;
+		}
+	} while (moved && ++steps < REGULATOR_COUPLED_MAX_STEPS);
+
+	if (moved) {
+		printk(KERN_ERR "%s: %s and %s failed to settle\n", __func__,
+		       rails[0]->desc->name, rails[1]->desc->name);
+		ret = -EIO;
+	}
+
+out:
+	mutex_unlock(&rails[1]->mutex);
+	return ret;
+}
+
+/* Apply the aggregate consumer voltage range, only touching the hardware
+ * if it has changed.  rdev->mutex held by caller */
+static int _regulator_apply_voltage(struct regulator_dev *rdev,
+				    struct regulator *regulator)
+{
+	int ret, min_uV, max_uV;
+
+	ret = regulator_aggregate_voltage(rdev, regulator, &min_uV, &max_uV);
+	if (ret < 0)
+		return ret;
+
+	if (min_uV == rdev->req_min_uV && max_uV == rdev->req_max_uV)
+		return 0;
+
+	if (rdev->coupled)
+		return regulator_balance_coupled(rdev, min_uV, max_uV);
+
+	return _regulator_set_voltage_range(rdev, min_uV, max_uV);
+}
+
+/**
+ * regulator_set_voltage - set regulator output voltage
+ * @regulator: regulator source
+ * @min_uV: Minimum required voltage in uV
+ * @max_uV: Maximum acceptable voltage in uV
+ *
+ * Sets a voltage regulator to the desired output voltage. This can be set
+ * during any regulator state. IOW, regulator can be disabled or enabled.
+ *
+ * If the regulator is enabled then the voltage will change to the new value
+ * immediately otherwise if the regulator is disabled the regulator will
+ * output at the new voltage when enabled.
+ *
+ * NOTE: If the regulator is shared between several devices then the lowest
+ * voltage that meets the requests of all enabled consumers and the system
+ * constraints will be used.  The hardware is only updated when this
+ * aggregate range changes.
+ * NOTE: Regulator system constraints must be set for this regulator before
+ * calling this function otherwise this call will fail.
+ */
+int regulator_set_voltage(struct regulator *regulator, int min_uV, int max_uV)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	int ret, old_min_uV, old_max_uV;
+
+	regulator_lock_consumer(regulator);
+
+	/* sanity check */
+	if (!_regulator_can_set_voltage(rdev)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* constraints check */
+	ret = regulator_check_voltage(rdev, &min_uV, &max_uV);
+	if (ret < 0)
+		goto out;
+
+	old_min_uV = regulator->min_uV;
+	old_max_uV = regulator->max_uV;
+	regulator->min_uV = min_uV;
+	regulator->max_uV = max_uV;
+
+	ret = _regulator_apply_voltage(rdev, regulator);
+	if (ret < 0) {
+		regulator->min_uV = old_min_uV;
+		regulator->max_uV = old_max_uV;
+	}
+
+out:
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_set_voltage);
+
+/**
+ * regulator_preload_voltage - prepare for a fast voltage change
+ * @regulator: regulator source
+ * @min_uV: Minimum required voltage in uV
+ * @max_uV: Maximum acceptable voltage in uV
+ *
+ * Loads the voltage regulator_set_voltage() would pick for this range
+ * into the hardware ahead of time without changing the output.  When
+ * the consumers of the regulator next ask for a range giving the same
+ * voltage the hardware is just switched over, e.g. by a single go bit
+ * write, which cuts the latency of the change.  Returns -EINVAL if the
+ * regulator can't preload voltages.
+ */
+int regulator_preload_voltage(struct regulator *regulator,
+			      int min_uV, int max_uV)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret, sel, uV;
+
+	if (ops->set_voltage || !ops->list_voltage ||
+	    !ops->preload_voltage_sel || !ops->switch_voltage_sel)
+		return -EINVAL;
+
+	regulator_lock(rdev);
+
+	ret = regulator_check_voltage(rdev, &min_uV, &max_uV);
+	if (ret < 0)
+		goto out;
+
+	sel = _regulator_map_voltage(rdev, min_uV, max_uV, &uV);
+	if (sel < 0) {
+		ret = sel;
+		goto out;
+	}
+
+	if (sel == rdev->preload_sel)
+		goto out;
+
+	rdev->preload_sel = -1;
+	ret = ops->preload_voltage_sel(rdev, sel);
+	if (ret >= 0)
+		rdev->preload_sel = sel;
+
+out:
+	regulator_unlock(rdev);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_preload_voltage);
+
+/* returns the cached output voltage, reading the hardware if unknown */
+static int _regulator_get_voltage(struct regulator_dev *rdev)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret;
+
+	if (rdev->desc->fixed_uV)
+		return rdev->desc->fixed_uV;
+
+	if (rdev->cached_uV > 0)
+		return rdev->cached_uV;
+
+	if (ops->get_voltage) {
+		ret = rdev_op(rdev, REGULATOR_OP_GET_VOLTAGE, 0,
+			      ops->get_voltage(rdev));
+	} else if (ops->get_voltage_sel && ops->list_voltage) {
+		ret = rdev_op(rdev, REGULATOR_OP_GET_VOLTAGE, 0,
+			      ops->get_voltage_sel(rdev));
+		if (ret >= 0)
+			ret = ops->list_voltage(rdev, ret);
+	} else
+		return -EINVAL;
+
+	if (ret > 0)
+		rdev->cached_uV = ret;
+	return ret;
+}
+
+/**
+ * regulator_get_voltage - get regulator output voltage
+ * @regulator: regulator source
+ *
+ * This returns the current regulator voltage in uV.
+ *
+ * NOTE: If the regulator is disabled it will return the voltage value. This
+ * function should not be used to determine regulator state.
+ */
+int regulator_get_voltage(struct regulator *regulator)
+{
+	int ret;
+
+	regulator_lock(regulator->rdev);
+
+	ret = _regulator_get_voltage(regulator->rdev);
+
+	regulator_unlock(regulator->rdev);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_get_voltage);
+
+/**
+ * regulator_count_voltages - count regulator_list_voltage() selectors
+ * @regulator: regulator source
+ *
+ * Return number of selectors usable with regulator_list_voltage() or
+ * negative errno if the regulator does not describe its voltage table.
+ */
+int regulator_count_voltages(struct regulator *regulator)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+
+	if (rdev->desc->fixed_uV)
+		return 1;
+
+	if (!rdev->desc->ops->list_voltage)
+		return -EINVAL;
+
+	return rdev->desc->n_voltages;
+}
+EXPORT_SYMBOL_GPL(regulator_count_voltages);
+
+/**
+ * regulator_list_voltage - enumerate supported voltages
+ * @regulator: regulator source
+ * @selector: identify voltage to list
+ *
+ * Return a voltage in microvolts that can be passed to
+ * regulator_set_voltage(), zero if this selector code can't be used on
+ * this system given its constraints, or negative errno.  Consumers can
+ * use this to build a table of the operating points the supply can
+ * really provide, for example when planning DVFS transitions.  Where
+ * the constraints don't allow the voltage to be changed only the
+ * voltage the regulator is already at is listed.
+ */
+int regulator_list_voltage(struct regulator *regulator, unsigned selector)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret;
+
+	if (rdev->desc->fixed_uV)
+		return selector ? -EINVAL : rdev->desc->fixed_uV;
+
+	if (!ops->list_voltage || selector >= rdev->desc->n_voltages)
+		return -EINVAL;
+
+	regulator_lock(rdev);
+	ret = ops->list_voltage(rdev, selector);
+	if (ret > 0) {
+		if (!(rdev->limits.ops & REGULATOR_CHANGE_VOLTAGE)) {
+			if (ret != _regulator_get_voltage(rdev))
+				ret = 0;
+		} else if (ret < rdev->limits.min_uV ||
+			   ret > rdev->limits.max_uV) {
+			ret = 0;
+		}
+	}
+	regulator_unlock(rdev);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_list_voltage);
+
+/**
+ * regulator_is_supported_voltage - check if a voltage range can be used
+ * @regulator: regulator source
+ * @min_uV: minimum voltage in microvolts
+ * @max_uV: maximum voltage in microvolts
+ *
+ * Returns 1 if regulator_set_voltage() could set a voltage within the
+ * range given the hardware and the constraints, 0 if not, or negative
+ * errno.  For consumers which only need a yes or no for each of their
+ * operating points, such as MMC hosts building their OCR mask at probe.
+ */
+int regulator_is_supported_voltage(struct regulator *regulator,
+				   int min_uV, int max_uV)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	int i, count, uV;
+
+	/* only the present voltage can be had when it can't change */
+	if (rdev->desc->fixed_uV ||
+	    !(rdev->limits.ops & REGULATOR_CHANGE_VOLTAGE)) {
+		uV = regulator_get_voltage(regulator);
+		if (uV < 0)
+			return uV;
+		return min_uV <= uV && uV <= max_uV;
+	}
+
+	count = regulator_count_voltages(regulator);
+	if (count < 0)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		uV = regulator_list_voltage(regulator, i);
+		if (uV > 0 && min_uV <= uV && uV <= max_uV)
+			return 1;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(regulator_is_supported_voltage);
+
+/**
+ * regulator_enable_time - get regulator enable settling time
+ * @regulator: regulator source
+ *
+ * Returns the time in microseconds the regulator output takes to become
+ * stable after being enabled.  The core waits for this time before
+ * regulator_enable() returns so consumers do not need to delay further.
+ */
+int regulator_enable_time(struct regulator *regulator)
+{
+	return _regulator_enable_time(regulator->rdev);
+}
+EXPORT_SYMBOL_GPL(regulator_enable_time);
+
+/**
+ * regulator_set_voltage_time - get regulator voltage change settling time
+ * @regulator: regulator source
+ * @old_uV: starting voltage in microvolts
+ * @new_uV: target voltage in microvolts
+ *
+ * Returns the time in microseconds the regulator output takes to slew
+ * from old_uV to new_uV, or 0 if the slew rate is not known.  The core
+ * waits for this time before regulator_set_voltage() returns.
+ */
+int regulator_set_voltage_time(struct regulator *regulator,
+			       int old_uV, int new_uV)
+{
+	return _regulator_set_voltage_time(regulator->rdev, old_uV, new_uV);
+}
+EXPORT_SYMBOL_GPL(regulator_set_voltage_time);
+
+/* Work out the current limit range that satisfies every enabled consumer
+ * that has requested one, plus the consumer making the request.  Returns
+ * 1 if nobody has a request.  rdev->mutex held by caller */
+static int regulator_aggregate_current(struct regulator_dev *rdev,
+				       struct regulator *regulator,
+				       int *min_uA, int *max_uA)
+{
+	struct regulator *consumer;
+	int found = 0;
+
+	*min_uA = INT_MIN;
+	*max_uA = INT_MAX;
+
+	list_for_each_entry(consumer, &rdev->consumer_list, list) {
+		if (!consumer->max_uA)
+			continue;
+		if (!consumer->enable_count && consumer != regulator)
+			continue;
+
+		*min_uA = max(*min_uA, consumer->min_uA);
+		*max_uA = min(*max_uA, consumer->max_uA);
+		found = 1;
+	}
+
+	if (!found)
+		return 1;
+
+	if (*min_uA > *max_uA) {
+		printk(KERN_ERR "%s: no current limit satisfies all consumers "
+		       "of %s\n", __func__, rdev->desc->name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Apply the aggregate consumer current limit range, only touching the
+ * hardware if it has changed.  The limit is left as it is once there
+ * are no requests.  rdev->mutex held by caller */
+static int _regulator_apply_current(struct regulator_dev *rdev,
+				    struct regulator *regulator)
+{
+	int ret, min_uA, max_uA;
+
+	ret = regulator_aggregate_current(rdev, regulator, &min_uA, &max_uA);
+	if (ret != 0)
+		return ret < 0 ? ret : 0;
+
+	if (min_uA == rdev->min_uA && max_uA == rdev->max_uA)
+		return 0;
+
+	return rdev_do_set_current_limit(rdev, min_uA, max_uA);
+}
+
+/**
+ * regulator_set_current_limit - set regulator output current limit
+ * @regulator: regulator source
+ * @min_uA: Minimuum supported current in uA
+ * @max_uA: Maximum supported current in uA
+ *
+ * Sets current sink to the desired output current. This can be set during
+ * any regulator state. IOW, regulator can be disabled or enabled.
+ *
+ * If the regulator is enabled then the current will change to the new value
+ * immediately otherwise if the regulator is disabled the regulator will
+ * output at the new current when enabled.
+ *
+ * NOTE: If the regulator is shared between several devices then the
+ * range set is the intersection of the requests of all enabled consumers,
+ * the lowest maximum and the highest minimum.  The hardware is only
+ * updated when this aggregate range changes.
+ * NOTE: Regulator system constraints must be set for this regulator before
+ * calling this function otherwise this call will fail.
+ */
+int regulator_set_current_limit(struct regulator *regulator,
+			       int min_uA, int max_uA)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	int ret, old_min_uA, old_max_uA;
+
+	regulator_lock_consumer(regulator);
+
+	/* sanity check */
+	if (!rdev->desc->ops->set_current_limit) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* constraints check */
+	ret = regulator_check_current_limit(rdev, &min_uA, &max_uA);
+	if (ret < 0)
+		goto out;
+
+	old_min_uA = regulator->min_uA;
+	old_max_uA = regulator->max_uA;
+	regulator->min_uA = min_uA;
+	regulator->max_uA = max_uA;
+
+	ret = _regulator_apply_current(rdev, regulator);
 	if (ret < 0) {
-		printk(KERN_ERR "%s: failed to enabled/disable\n", __func__);
-		return ret;
+		regulator->min_uA = old_min_uA;
+		regulator->max_uA = old_max_uA;
+	}
+
+out:
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_set_current_limit);
+
+static int _regulator_get_current_limit(struct regulator_dev *rdev)
+{
+	int ret;
+
+	regulator_lock(rdev);
+
+	/* sanity check */
+	if (!rdev->desc->ops->get_current_limit) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = rdev_op(rdev, REGULATOR_OP_GET_CURRENT_LIMIT, 0,
+		      rdev->desc->ops->get_current_limit(rdev));
+out:
+	regulator_unlock(rdev);
+	return ret;
+}
+
+/**
+ * regulator_get_current_limit - get regulator output current
+ * @regulator: regulator source
+ *
+ * This returns the current supplied by the specified current sink in uA.
+ *
+ * NOTE: If the regulator is disabled it will return the current value. This
+ * function should not be used to determine regulator state.
+ */
+int regulator_get_current_limit(struct regulator *regulator)
+{
+	return _regulator_get_current_limit(regulator->rdev);
+}
+EXPORT_SYMBOL_GPL(regulator_get_current_limit);
+
+/**
+ * regulator_set_mode - set regulator operating mode
+ * @regulator: regulator source
+ * @mode: operating mode - one of the REGULATOR_MODE constants
+ *
+ * Set regulator operating mode to increase regulator efficiency or improve
+ * regulation performance.
+ *
+ * NOTE: If the regulator is shared between several devices then the most
+ * capable mode requested by an enabled consumer is used, FAST being the
+ * most capable followed by NORMAL, IDLE and STANDBY.  The request of a
+ * disabled consumer takes effect when it enables the regulator and a
+ * mode of 0 withdraws the request.  The hardware is only updated when
+ * the mode needed changes.  With DRMS the requests are the least
+ * capable mode DRMS will choose.
+ * NOTE: Regulator system constraints must be set for this regulator before
+ * calling this function otherwise this call will fail.
+ */
+int regulator_set_mode(struct regulator *regulator, unsigned int mode)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	unsigned int old_mode;
+	int ret;
+
+	regulator_lock_consumer(regulator);
+
+	/* sanity check */
+	if (!rdev->desc->ops->set_mode) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* constraints check */
+	if (mode) {
+		ret = regulator_check_mode(rdev, mode);
+		if (ret < 0)
+			goto out;
+	}
+
+	old_mode = regulator->mode;
+	regulator->mode = mode;
+
+	ret = _regulator_apply_mode(rdev);
+	if (ret < 0)
+		regulator->mode = old_mode;
+out:
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_set_mode);
+
+static unsigned int _regulator_get_mode(struct regulator_dev *rdev)
+{
+	int ret;
+
+	regulator_lock(rdev);
+
+	/* sanity check */
+	if (!rdev->desc->ops->get_mode) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = rdev_op(rdev, REGULATOR_OP_GET_MODE, 0,
+		      rdev->desc->ops->get_mode(rdev));
+out:
+	regulator_unlock(rdev);
+	return ret;
+}
+
+/**
+ * regulator_get_mode - get regulator operating mode
+ * @regulator: regulator source
+ *
+ * Get the current regulator operating mode.
+ */
+unsigned int regulator_get_mode(struct regulator *regulator)
+{
+	return _regulator_get_mode(regulator->rdev);
+}
+EXPORT_SYMBOL_GPL(regulator_get_mode);
+
+/**
+ * regulator_set_optimum_mode - set regulator optimum operating mode
+ * @regulator: regulator source
+ * @uA_load: load current
+ *
+ * Notifies the regulator core of a new device load. This is then used by
+ * DRMS (if enabled by constraints) to set the most efficient regulator
+ * operating mode for the new regulator loading.
+ *
+ * Consumer devices notify their supply regulator of the maximum power
+ * they will require (can be taken from device datasheet in the power
+ * consumption tables) when they change operational status and hence power
+ * state. Examples of operational state changes that can affect power
+ * consumption are :-
+ *
+ *    o Device is opened / closed.
+ *    o Device I/O is about to begin or has just finished.
+ *    o Device is idling in between work.
+ *
+ * This information is also exported via sysfs to userspace.
+ *
+ * DRMS will sum the total requested load on the regulator and change
+ * to the most efficient operating mode if platform constraints allow.
+ *
+ * Returns the new regulator mode or error, -EBUSY if the increase in load
+ * would take the regulator or one of its supplies over its budget.
+ */
+int regulator_set_optimum_mode(struct regulator *regulator, int uA_load)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	int ret, output_uV, input_uV, total_uA_load;
+	unsigned int mode;
+
+	regulator_lock_consumer(regulator);
+
+	/* refuse to take the rail or its supplies over their budget */
+	if (uA_load > regulator->uA_load &&
+	    uA_load - regulator->uA_load > _regulator_get_headroom(rdev)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	regulator->uA_load = uA_load;
+	ret = regulator_check_drms(rdev);
+	if (ret < 0) {
+		/* we can't change mode but our supply may be able to */
+		drms_uA_update(rdev);
+		goto out;
+	}
+	ret = -EINVAL;
+
+	/* sanity check */
+	if (!_regulator_can_get_optimum_mode(rdev))
+		goto out;
+
+	/* get output voltage */
+	output_uV = _regulator_get_voltage(rdev);
+	if (output_uV <= 0) {
+		printk(KERN_ERR "%s: invalid output voltage found for %s\n",
+			__func__, rdev->desc->name);
+		goto out;
 	}
 
-	if (rdev->desc->ops->set_suspend_voltage && rstate->uV > 0) {
-		ret = rdev->desc->ops->set_suspend_voltage(rdev, rstate->uV);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to set voltage\n",
-				__func__);
-			return ret;
-		}
+	/* get input voltage */
+	input_uV = _regulator_get_input_voltage(rdev);
+	if (input_uV <= 0) {
+		printk(KERN_ERR "%s: invalid input voltage found for %s\n",
+			__func__, rdev->desc->name);
+		goto out;
 	}
 
-	if (rdev->desc->ops->set_suspend_mode && rstate->mode > 0) {
-		ret = rdev->desc->ops->set_suspend_mode(rdev, rstate->mode);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to set mode\n", __func__);
-			return ret;
-		}
+	/* calc total requested load for this regulator */
+	total_uA_load = _regulator_get_load(rdev);
+
+	mode = _regulator_get_optimum_mode(rdev, input_uV, output_uV,
+					   total_uA_load);
+	ret = regulator_check_mode(rdev, mode);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to get optimum mode for %s @"
+			" %d uA %d -> %d uV\n", __func__, rdev->desc->name,
+			total_uA_load, input_uV, output_uV);
+		goto out;
+	}
+
+	ret = regulator_drms_set_mode(rdev, mode, input_uV, output_uV,
+				      total_uA_load);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to set optimum mode %x for %s\n",
+			__func__, mode, rdev->desc->name);
+		goto out;
 	}
+
+	/* our supply sees the new load whatever mode we ended up in */
+	regulator_propagate_load(rdev, input_uV, output_uV, total_uA_load);
+out:
+	regulator_energy_update(rdev);
+	regulator_unlock_consumer(regulator);
 	return ret;
 }
+EXPORT_SYMBOL_GPL(regulator_set_optimum_mode);
 
-/* locks held by caller */
-static int suspend_prepare(struct regulator_dev *rdev, suspend_state_t state)
+/**
+ * regulator_get_headroom - get the load a consumer may still add
+ * @regulator: regulator source
+ *
+ * Returns the additional load in uA that could be requested from the
+ * regulator with regulator_set_optimum_mode() before it or a regulator
+ * supplying it goes over its budget, or INT_MAX if there is no budget.
+ * Consumers able to run in lower power modes can use this to choose one
+ * which the system can supply.
+ */
+int regulator_get_headroom(struct regulator *regulator)
 {
-	if (!rdev->constraints)
-		return -EINVAL;
+	struct regulator_dev *rdev = regulator->rdev;
+	int ret;
 
-	switch (state) {
-	case PM_SUSPEND_STANDBY:
-		return suspend_set_state(rdev,
-			&rdev->constraints->state_standby);
-	case PM_SUSPEND_MEM:
-		return suspend_set_state(rdev,
-			&rdev->constraints->state_mem);
-	case PM_SUSPEND_MAX:
-		return suspend_set_state(rdev,
-			&rdev->constraints->state_disk);
-	default:
-		return -EINVAL;
-	}
+	regulator_lock(rdev);
+	ret = _regulator_get_headroom(rdev);
+	regulator_unlock(rdev);
+
+	return ret;
 }
+EXPORT_SYMBOL_GPL(regulator_get_headroom);
 
-static void print_constraints(struct regulator_dev *rdev)
+/**
+ * regulator_get_energy - get the energy used by a consumer
+ * @regulator: regulator source
+ *
+ * Returns the energy in uJ supplied to the consumer since it got the
+ * regulator, estimated from the output voltage and the load declared with
+ * regulator_set_optimum_mode() while the consumer had the regulator
+ * enabled.
+ */
+unsigned long long regulator_get_energy(struct regulator *regulator)
 {
-	struct regulation_constraints *constraints = rdev->constraints;
-	char buf[80];
-	int count;
+	struct regulator_dev *rdev = regulator->rdev;
+	unsigned long flags;
+	u64 uJ;
 
-	if (rdev->desc->type == REGULATOR_VOLTAGE) {
-		if (constraints->min_uV == constraints->max_uV)
-			count = sprintf(buf, "%d mV ",
-					constraints->min_uV / 1000);
-		else
-			count = sprintf(buf, "%d <--> %d mV ",
-					constraints->min_uV / 1000,
-					constraints->max_uV / 1000);
-	} else {
-		if (constraints->min_uA == constraints->max_uA)
-			count = sprintf(buf, "%d mA ",
-					constraints->min_uA / 1000);
-		else
-			count = sprintf(buf, "%d <--> %d mA ",
-					constraints->min_uA / 1000,
-					constraints->max_uA / 1000);
+	spin_lock_irqsave(&rdev->stats.lock, flags);
+	uJ = regulator_energy_read(&regulator->energy,
+				   ktime_to_ns(ktime_get()));
+	spin_unlock_irqrestore(&rdev->stats.lock, flags);
+
+	return uJ;
+}
+EXPORT_SYMBOL_GPL(regulator_get_energy);
+
+/* Apply a validated configuration one setting at a time.  If one fails
+ * those already applied are put back, in reverse order, so the hardware
+ * is left matching the consumer's old voltage range restored by the
+ * caller. */
+static int _regulator_apply_config(struct regulator_dev *rdev,
+				   struct regulator *regulator,
+				   const struct regulator_config *config,
+				   int old_min_uV, int old_max_uV)
+{
+	int old_min_uA = rdev->min_uA, old_max_uA = rdev->max_uA;
+	int ret = 0;
+
+	if (config->flags & REGULATOR_CONFIG_VOLTAGE) {
+		ret = _regulator_apply_voltage(rdev, regulator);
+		if (ret < 0)
+			return ret;
 	}
-	if (constraints->valid_modes_mask & REGULATOR_MODE_FAST)
-		count += sprintf(buf + count, "fast ");
-	if (constraints->valid_modes_mask & REGULATOR_MODE_NORMAL)
-		count += sprintf(buf + count, "normal ");
-	if (constraints->valid_modes_mask & REGULATOR_MODE_IDLE)
-		count += sprintf(buf + count, "idle ");
-	if (constraints->valid_modes_mask & REGULATOR_MODE_STANDBY)
-		count += sprintf(buf + count, "standby");
 
-	printk(KERN_INFO "regulator: %s: %s\n", rdev->desc->name, buf);
+	if (config->flags & REGULATOR_CONFIG_CURRENT) {
+		ret = rdev_do_set_current_limit(rdev, config->min_uA,
+						config->max_uA);
+		if (ret < 0)
+			goto undo_voltage;
+	}
+
+	if (config->flags & REGULATOR_CONFIG_MODE) {
+		ret = rdev_do_set_mode(rdev, config->mode);
+		if (ret < 0)
+			goto undo_current;
+	}
+
+	return 0;
+
+undo_current:
+	/* an unknown old limit can't be put back */
+	if ((config->flags & REGULATOR_CONFIG_CURRENT) && old_max_uA)
+		rdev_do_set_current_limit(rdev, old_min_uA, old_max_uA);
+undo_voltage:
+	if (config->flags & REGULATOR_CONFIG_VOLTAGE) {
+		regulator->min_uV = old_min_uV;
+		regulator->max_uV = old_max_uV;
+		_regulator_apply_voltage(rdev, regulator);
+	}
+	return ret;
 }
 
 /**
- * set_machine_constraints - sets regulator constraints
+ * regulator_apply_config - change several regulator settings at once
  * @regulator: regulator source
+ * @config: settings to apply
  *
- * Allows platform initialisation code to define and constrain
- * regulator circuits e.g. valid voltage/current ranges, etc.  NOTE:
- * Constraints *must* be set by platform code in order for some
- * regulator operations to proceed i.e. set_voltage, set_current_limit,
- * set_mode.
+ * Changes the voltage, current limit and/or operating mode of a
+ * regulator as selected by config->flags.  All the settings are checked
+ * against the regulator constraints before any are applied, and
+ * regulator drivers which support it are passed the whole configuration
+ * so that they can update the hardware in a single operation.  The
+ * voltage request is combined with those of other consumers as for
+ * regulator_set_voltage().
+ *
+ * NOTE: Regulator system constraints must be set for this regulator before
+ * calling this function otherwise this call will fail.
  */
-static int set_machine_constraints(struct regulator_dev *rdev,
-	struct regulation_constraints *constraints)
+int regulator_apply_config(struct regulator *regulator,
+			   const struct regulator_config *config)
 {
-	int ret = 0;
-	const char *name;
+	struct regulator_dev *rdev = regulator->rdev;
 	struct regulator_ops *ops = rdev->desc->ops;
+	struct regulator_config hw = *config;
+	int ret = 0, old_min_uV, old_max_uV, old_uV = 0;
+	int old_min_uA, old_max_uA;
 
-	if (constraints->name)
-		name = constraints->name;
-	else if (rdev->desc->name)
-		name = rdev->desc->name;
-	else
-		name = "regulator";
+	regulator_lock_consumer(regulator);
 
-	rdev->constraints = constraints;
+	old_min_uV = regulator->min_uV;
+	old_max_uV = regulator->max_uV;
+	old_min_uA = regulator->min_uA;
+	old_max_uA = regulator->max_uA;
 
-	/* do we need to apply the constraint voltage */
-	if (rdev->constraints->apply_uV &&
-		rdev->constraints->min_uV == rdev->constraints->max_uV &&
-		ops->set_voltage) {
-		ret = ops->set_voltage(rdev,
-			rdev->constraints->min_uV, rdev->constraints->max_uV);
-			if (ret < 0) {
-				printk(KERN_ERR "%s: failed to apply %duV constraint to %s\n",
-				       __func__,
-				       rdev->constraints->min_uV, name);
-				rdev->constraints = NULL;
-				goto out;
-			}
+	/* check everything before touching the hardware */
+	if (hw.flags & REGULATOR_CONFIG_CURRENT) {
+		if (!ops->set_current_limit) {
+			ret = -EINVAL;
+			goto out;
+		}
+		ret = regulator_check_current_limit(rdev, &hw.min_uA,
+						    &hw.max_uA);
+		if (ret < 0)
+			goto out;
+
+		regulator->min_uA = hw.min_uA;
+		regulator->max_uA = hw.max_uA;
+		ret = regulator_aggregate_current(rdev, regulator,
+						  &hw.min_uA, &hw.max_uA);
+		if (ret < 0)
+			goto restore;
+
+		/* nothing to do if the aggregate range is unchanged */
+		if (ret > 0 ||
+		    (hw.min_uA == rdev->min_uA && hw.max_uA == rdev->max_uA))
+			hw.flags &= ~REGULATOR_CONFIG_CURRENT;
+		ret = 0;
 	}
 
-	/* are we enabled at boot time by firmware / bootloader */
-	if (rdev->constraints->boot_on)
-		rdev->use_count = 1;
+	if (hw.flags & REGULATOR_CONFIG_MODE) {
+		if (!ops->set_mode) {
+			ret = -EINVAL;
+			goto restore;
+		}
+		ret = regulator_check_mode(rdev, hw.mode);
+		if (ret < 0)
+			goto restore;
+	}
 
-	/* do we need to setup our suspend state */
-	if (constraints->initial_state) {
-		ret = suspend_prepare(rdev, constraints->initial_state);
+	if (hw.flags & REGULATOR_CONFIG_VOLTAGE) {
+		if (!_regulator_can_set_voltage(rdev)) {
+			ret = -EINVAL;
+			goto restore;
+		}
+		ret = regulator_check_voltage(rdev, &hw.min_uV, &hw.max_uV);
+		if (ret < 0)
+			goto restore;
+
+		regulator->min_uV = hw.min_uV;
+		regulator->max_uV = hw.max_uV;
+		ret = regulator_aggregate_voltage(rdev, regulator,
+						  &hw.min_uV, &hw.max_uV);
+		if (ret < 0)
+			goto restore;
+
+		/* nothing to do if the aggregate range is unchanged */
+		if (hw.min_uV == rdev->req_min_uV &&
+		    hw.max_uV == rdev->req_max_uV)
+			hw.flags &= ~REGULATOR_CONFIG_VOLTAGE;
+	}
+
+	if (!hw.flags)
+		goto out;
+
+	if (!ops->set_config) {
+		ret = _regulator_apply_config(rdev, regulator, &hw,
+					      old_min_uV, old_max_uV);
+		if (ret < 0)
+			goto restore;
+		goto out;
+	}
+
+	if (hw.flags & REGULATOR_CONFIG_VOLTAGE) {
+		if (rdev->use_count > 0)
+			old_uV = _regulator_get_voltage(rdev);
+		rdev->cached_uV = 0;
+		rdev->selector = -1;
+	}
+
+	ret = rdev_op(rdev, REGULATOR_OP_SET_CONFIG, hw.flags,
+		      ops->set_config(rdev, &hw));
+	if (ret < 0)
+		goto restore;
+
+	if (hw.flags & REGULATOR_CONFIG_MODE) {
+		rdev->mode = hw.mode;
+		rdev->mode_changed = jiffies;
+	}
+
+	if (hw.flags & REGULATOR_CONFIG_CURRENT) {
+		rdev->min_uA = hw.min_uA;
+		rdev->max_uA = hw.max_uA;
+	}
+
+	if (hw.flags & REGULATOR_CONFIG_VOLTAGE) {
+		rdev->req_min_uV = hw.min_uV;
+		rdev->req_max_uV = hw.max_uV;
+		_regulator_delay(_regulator_set_voltage_time(rdev, old_uV,
+							     hw.min_uV));
+	}
+	goto out;
+
+restore:
+	regulator->min_uV = old_min_uV;
+	regulator->max_uV = old_max_uV;
+	regulator->min_uA = old_min_uA;
+	regulator->max_uA = old_max_uA;
+out:
+	regulator_energy_update(rdev);
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_apply_config);
+
+/**
+ * regulator_save_state - save the requests made by a consumer
+ * @regulator: regulator source
+ * @snap: where to save them
+ *
+ * Records the voltage and current limit ranges, load, mode and enable
+ * state requested by the consumer so that they can be reapplied with
+ * regulator_restore_state(), e.g. around runtime power management.  A
+ * consumer with a deferred disable pending is saved as disabled.
+ */
+void regulator_save_state(struct regulator *regulator,
+			  struct regulator_snapshot *snap)
+{
+	regulator_lock(regulator->rdev);
+	snap->min_uV = regulator->min_uV;
+	snap->max_uV = regulator->max_uV;
+	snap->min_uA = regulator->min_uA;
+	snap->max_uA = regulator->max_uA;
+	snap->uA_load = regulator->uA_load;
+	snap->mode = regulator->mode;
+	snap->enable_count = regulator->disable_pending ?
+		0 : regulator->enable_count;
+	regulator_unlock(regulator->rdev);
+}
+EXPORT_SYMBOL_GPL(regulator_save_state);
+
+/**
+ * regulator_restore_state - reapply requests saved by regulator_save_state()
+ * @regulator: regulator source
+ * @snap: saved requests
+ *
+ * Brings the consumer's requests back to those in @snap in a single
+ * locked operation, only changing the settings which differ, except
+ * the voltage which is always reapplied to an enabled consumer.  The
+ * voltage and load are restored before the regulator is enabled, or
+ * after it is disabled, so it is never powered with stale settings.
+ * Returns 0 on success or the error from the first setting which could
+ * not be restored, leaving the remaining settings unchanged.
+ */
+int regulator_restore_state(struct regulator *regulator,
+			    const struct regulator_snapshot *snap)
+{
+	struct regulator_dev *rdev = regulator->rdev;
+	int ret = 0, old_min_uV, old_max_uV, old_min_uA, old_max_uA;
+	unsigned int old_mode = regulator->mode;
+
+	regulator_lock_consumer(regulator);
+
+	/* a pending deferred disable is overridden by the saved state */
+	if (regulator->disable_pending) {
+		regulator->disable_pending = 0;
+		cancel_delayed_work(&regulator->disable_work);
+	}
+
+	if (regulator->enable_count && !snap->enable_count) {
+		regulator->enable_count = 0;
+		regulator->uA_load = 0;
+		ret = _regulator_disable(rdev);
+		if (ret < 0)
+			goto out;
+		if (regulator->max_uA)
+			_regulator_apply_current(rdev, NULL);
+	}
+
+	/* The voltage is reapplied even if our request is unchanged since
+	 * another consumer or a supply may have moved the output since the
+	 * save; the hardware is only written if the aggregate changes.
+	 * Disabled consumers get their voltage applied on enable.
+	 */
+	old_min_uV = regulator->min_uV;
+	old_max_uV = regulator->max_uV;
+	regulator->min_uV = snap->min_uV;
+	regulator->max_uV = snap->max_uV;
+
+	if (snap->max_uV && snap->enable_count) {
+		ret = _regulator_apply_voltage(rdev, regulator);
 		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to set suspend state for %s\n",
-			       __func__, name);
-			rdev->constraints = NULL;
+			regulator->min_uV = old_min_uV;
+			regulator->max_uV = old_max_uV;
 			goto out;
 		}
 	}
 
-	/* if always_on is set then turn the regulator on if it's not
-	 * already on. */
-	if (constraints->always_on && ops->enable &&
-	    ((ops->is_enabled && !ops->is_enabled(rdev)) ||
-	     (!ops->is_enabled && !constraints->boot_on))) {
-		ret = ops->enable(rdev);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to enable %s\n",
-			       __func__, name);
-			rdev->constraints = NULL;
+	if (snap->min_uA != regulator->min_uA ||
+	    snap->max_uA != regulator->max_uA) {
+		old_min_uA = regulator->min_uA;
+		old_max_uA = regulator->max_uA;
+		regulator->min_uA = snap->min_uA;
+		regulator->max_uA = snap->max_uA;
+
+		if (snap->enable_count) {
+			ret = _regulator_apply_current(rdev, regulator);
+			if (ret < 0) {
+				regulator->min_uA = old_min_uA;
+				regulator->max_uA = old_max_uA;
+				goto out;
+			}
+		}
+	}
+
+	if (snap->uA_load != regulator->uA_load) {
+		if (snap->uA_load > regulator->uA_load &&
+		    snap->uA_load - regulator->uA_load >
+		    _regulator_get_headroom(rdev)) {
+			ret = -EBUSY;
 			goto out;
 		}
+		regulator->uA_load = snap->uA_load;
+		drms_uA_update(rdev);
+	}
+
+	if (snap->enable_count && !regulator->enable_count) {
+		ret = _regulator_enable(rdev);
+		if (ret < 0)
+			goto out;
+	}
+	regulator->enable_count = snap->enable_count;
+
+	regulator->mode = snap->mode;
+	if (regulator->mode || old_mode) {
+		ret = _regulator_apply_mode(rdev);
+		if (ret < 0)
+			regulator->mode = old_mode;
 	}
 
-	print_constraints(rdev);
-out:
-	return ret;
+out:
+	regulator_energy_update(rdev);
+	regulator_unlock_consumer(regulator);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_restore_state);
+
+/**
+ * regulator_register_notifier - register regulator event notifier
+ * @regulator: regulator source
+ * @notifier_block: notifier block
+ *
+ * Register notifier block to receive regulator events.
+ */
+int regulator_register_notifier(struct regulator *regulator,
+			      struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&regulator->rdev->notifier,
+						nb);
+}
+EXPORT_SYMBOL_GPL(regulator_register_notifier);
+
+/**
+ * regulator_unregister_notifier - unregister regulator event notifier
+ * @regulator: regulator source
+ * @notifier_block: notifier block
+ *
+ * Unregister regulator event notifier block.
+ */
+int regulator_unregister_notifier(struct regulator *regulator,
+				struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&regulator->rdev->notifier,
+						  nb);
+}
+EXPORT_SYMBOL_GPL(regulator_unregister_notifier);
+
+/*
+ * Events are posted to a per regulator mask and delivered to consumers
+ * from a work item, so drivers can post them cheaply from their IRQ
+ * handling and bursts of the same event coalesce into one notification.
+ * Each regulator passes its events on to the regulators it supplies once
+ * its own consumers have been notified.
+ */
+static void regulator_queue_event(struct regulator_dev *rdev,
+				  unsigned long *pending, unsigned long event)
+{
+	unsigned long flags;
+
+	/* a fault may have moved the output or turned it off so don't
+	 * trust the cached state */
+	rdev->cached_uV = 0;
+	rdev->enabled_state = -1;
+
+	spin_lock_irqsave(&rdev->event_lock, flags);
+	*pending |= event;
+	spin_unlock_irqrestore(&rdev->event_lock, flags);
+
+	if (regulator_wq)
+		queue_work(regulator_wq, &rdev->event_work);
+	else
+		schedule_work(&rdev->event_work);
+}
+
+static void regulator_post_event(struct regulator_dev *rdev,
+				 unsigned long event)
+{
+	regulator_queue_event(rdev, &rdev->pending_events, event);
+}
+
+/*
+ * Fault handling.  Faults reported by a regulator are logged and, if
+ * the machine asks for it with fault_shutdown, the output is turned off
+ * (taking everything it supplies with it) while the consumers keep
+ * their references.  With fault_retry_ms set the core then tries to
+ * turn it back on after a delay which doubles with each further fault,
+ * giving up after fault_retries attempts.  The fault state is
+ * cleared once the consumers have all disabled the regulator.  While
+ * the output is off further reports of the fault are dropped, and
+ * fault IRQs requested through the core stay masked, so a stuck fault
+ * can't flood the consumers.  Otherwise the fault IRQs are unmasked
+ * again after REGULATOR_FAULT_UNMASK_MS, with the delay doubling each
+ * time they fire again within REGULATOR_FAULT_STORM_MS of coming back.
+ */
+#define REGULATOR_FAULT_EVENTS	(REGULATOR_EVENT_UNDER_VOLTAGE | \
+				 REGULATOR_EVENT_OVER_CURRENT | \
+				 REGULATOR_EVENT_OVER_TEMP | \
+				 REGULATOR_EVENT_FAIL)
+
+/* longest retry delay is fault_retry_ms << REGULATOR_FAULT_MAX_SHIFT */
+#define REGULATOR_FAULT_MAX_SHIFT	8
+
+/* fault IRQs left masked when the output stays on */
+#define REGULATOR_FAULT_UNMASK_MS	10
+#define REGULATOR_FAULT_STORM_MS	1000
+
+struct regulator_fault_irq {
+	struct list_head list;
+	struct regulator_dev *rdev;
+	int irq;
+	unsigned long event;
+	unsigned long masked;	/* bit 0 set while disabled by the handler */
+};
+
+/* unmask fault IRQs the handler disabled, rdev->mutex held */
+static void regulator_fault_irq_unmask(struct regulator_dev *rdev)
+{
+	struct regulator_fault_irq *fault;
+
+	list_for_each_entry(fault, &rdev->fault_irqs, list)
+		if (test_and_clear_bit(0, &fault->masked))
+			enable_irq(fault->irq);
+	rdev->fault_unmasked = jiffies;
 }
 
-/**
- * set_supply - set regulator supply regulator
- * @regulator: regulator name
- * @supply: supply regulator name
- *
- * Called by platform initialisation code to set the supply regulator for this
- * regulator. This ensures that a regulators supply will also be enabled by the
- * core if it's child is enabled.
- */
-static int set_supply(struct regulator_dev *rdev,
-	struct regulator_dev *supply_rdev)
+static void regulator_fault_queue(struct regulator_dev *rdev,
+				  unsigned int delay)
 {
-	int err;
-
-	err = sysfs_create_link(&rdev->dev.kobj, &supply_rdev->dev.kobj,
-				"supply");
-	if (err) {
-		printk(KERN_ERR
-		       "%s: could not add device link %s err %d\n",
-		       __func__, supply_rdev->dev.kobj.name, err);
-		       goto out;
-	}
-	rdev->supply = supply_rdev;
-	list_add(&rdev->slist, &supply_rdev->supply_list);
-out:
-	return err;
+	if (regulator_wq)
+		queue_delayed_work(regulator_wq, &rdev->fault_work,
+				   msecs_to_jiffies(delay));
+	else
+		schedule_delayed_work(&rdev->fault_work,
+				      msecs_to_jiffies(delay));
 }
 
-/**
- * set_consumer_device_supply: Bind a regulator to a symbolic supply
- * @regulator: regulator source
- * @dev:       device the supply applies to
- * @supply:    symbolic name for supply
- *
- * Allows platform initialisation code to map physical regulator
- * sources to symbolic names for supplies for use by devices.  Devices
- * should use these symbolic names to request regulators, avoiding the
- * need to provide board-specific regulator names as platform data.
+/*
+ * Unmask the fault IRQs from the fault work, backing off while they
+ * keep firing as soon as they are unmasked.  rdev->mutex held.
  */
-static int set_consumer_device_supply(struct regulator_dev *rdev,
-	struct device *consumer_dev, const char *supply)
+static void regulator_fault_irq_defer(struct regulator_dev *rdev)
 {
-	struct regulator_map *node;
+	struct regulator_fault_irq *fault;
+	int masked = 0;
 
-	if (supply == NULL)
-		return -EINVAL;
+	list_for_each_entry(fault, &rdev->fault_irqs, list)
+		if (test_bit(0, &fault->masked))
+			masked = 1;
+	if (!masked)
+		return;
 
-	node = kmalloc(sizeof(struct regulator_map), GFP_KERNEL);
-	if (node == NULL)
-		return -ENOMEM;
+	if (time_before(jiffies, rdev->fault_unmasked +
+			msecs_to_jiffies(REGULATOR_FAULT_STORM_MS))) {
+		if (rdev->fault_backoff < REGULATOR_FAULT_MAX_SHIFT)
+			rdev->fault_backoff++;
+	} else {
+		rdev->fault_backoff = 0;
+	}
 
-	node->regulator = rdev;
-	node->dev = consumer_dev;
-	node->supply = supply;
+	regulator_fault_queue(rdev,
+			      REGULATOR_FAULT_UNMASK_MS << rdev->fault_backoff);
+}
 
-	list_add(&node->list, &regulator_map_list);
-	return 0;
+/* forget about past faults, rdev->mutex held */
+static void regulator_clear_fault(struct regulator_dev *rdev)
+{
+	if (!rdev->fault_off && !rdev->fault_count)
+		return;
+
+	rdev->fault_off = 0;
+	rdev->fault_count = 0;
+	/* the work rechecks fault_off so needn't be waited for */
+	cancel_delayed_work(&rdev->fault_work);
+	regulator_fault_irq_unmask(rdev);
+	regulator_led_fault(rdev, 0);
 }
 
-static void unset_consumer_device_supply(struct regulator_dev *rdev,
-	struct device *consumer_dev)
+static void regulator_fault_retry(struct regulator_dev *rdev)
 {
-	struct regulator_map *node, *n;
+	struct regulation_constraints *c = rdev->constraints;
+	unsigned int delay;
 
-	list_for_each_entry_safe(node, n, &regulator_map_list, list) {
-		if (rdev == node->regulator &&
-			consumer_dev == node->dev) {
-			list_del(&node->list);
-			kfree(node);
-			return;
-		}
+	if (!c->fault_retry_ms || rdev->fault_count > c->fault_retries) {
+		printk(KERN_ERR "regulator: %s left off after %d faults\n",
+		       rdev->desc->name, rdev->fault_count);
+		return;
 	}
-}
 
-#define REG_STR_SIZE	32
+	delay = c->fault_retry_ms <<
+		min(rdev->fault_count - 1, REGULATOR_FAULT_MAX_SHIFT);
+	regulator_fault_queue(rdev, delay);
+}
 
-static struct regulator *create_regulator(struct regulator_dev *rdev,
-					  struct device *dev,
-					  const char *supply_name)
+/* act on faults reported by rdev, returns the events to deliver */
+static unsigned long regulator_handle_fault(struct regulator_dev *rdev,
+					    unsigned long events)
 {
-	struct regulator *regulator;
-	char buf[REG_STR_SIZE];
-	int err, size;
+	struct regulation_constraints *c = rdev->constraints;
+	int ret;
 
-	regulator = kzalloc(sizeof(*regulator), GFP_KERNEL);
-	if (regulator == NULL)
-		return NULL;
+	regulator_lock(rdev);
 
-	mutex_lock(&rdev->mutex);
-	regulator->rdev = rdev;
-	list_add(&regulator->list, &rdev->consumer_list);
+	/* an IRQ reporting something other than a fault still comes back */
+	if (!(events & REGULATOR_FAULT_EVENTS))
+		goto unmask;
 
-	if (dev) {
-		/* create a 'requested_microamps_name' sysfs entry */
-		size = scnprintf(buf, REG_STR_SIZE, "microamps_requested_%s",
-			supply_name);
-		if (size >= REG_STR_SIZE)
-			goto overflow_err;
-
-		regulator->dev = dev;
-		regulator->dev_attr.attr.name = kstrdup(buf, GFP_KERNEL);
-		if (regulator->dev_attr.attr.name == NULL)
-			goto attr_name_err;
-
-		regulator->dev_attr.attr.owner = THIS_MODULE;
-		regulator->dev_attr.attr.mode = 0444;
-		regulator->dev_attr.show = device_requested_uA_show;
-		err = device_create_file(dev, &regulator->dev_attr);
-		if (err < 0) {
-			printk(KERN_WARNING "%s: could not add regulator_dev"
-				" load sysfs\n", __func__);
-			goto attr_name_err;
-		}
+	/* still the same fault, it has already been dealt with */
+	if (rdev->fault_off) {
+		events &= ~REGULATOR_FAULT_EVENTS;
+		goto out;
+	}
 
-		/* also add a link to the device sysfs entry */
-		size = scnprintf(buf, REG_STR_SIZE, "%s-%s",
-				 dev->kobj.name, supply_name);
-		if (size >= REG_STR_SIZE)
-			goto attr_err;
-
-		regulator->supply_name = kstrdup(buf, GFP_KERNEL);
-		if (regulator->supply_name == NULL)
-			goto attr_err;
-
-		err = sysfs_create_link(&rdev->dev.kobj, &dev->kobj,
-					buf);
-		if (err) {
-			printk(KERN_WARNING
-			       "%s: could not add device link %s err %d\n",
-			       __func__, dev->kobj.name, err);
-			device_remove_file(dev, &regulator->dev_attr);
-			goto link_name_err;
-		}
+	if (printk_ratelimit())
+		printk(KERN_ERR "regulator: %s reported fault 0x%lx\n",
+		       rdev->desc->name, events & REGULATOR_FAULT_EVENTS);
+
+	if (!c || !c->fault_shutdown || !rdev->desc->ops->disable ||
+	    (rdev->use_count == 0 && !c->always_on))
+		goto unmask;
+
+	ret = rdev_do_disable(rdev);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to shut down %s: %d\n",
+		       __func__, rdev->desc->name, ret);
+		goto unmask;
 	}
-	mutex_unlock(&rdev->mutex);
-	return regulator;
-link_name_err:
-	kfree(regulator->supply_name);
-attr_err:
-	device_remove_file(regulator->dev, &regulator->dev_attr);
-attr_name_err:
-	kfree(regulator->dev_attr.attr.name);
-overflow_err:
-	list_del(&regulator->list);
-	kfree(regulator);
-	mutex_unlock(&rdev->mutex);
-	return NULL;
+	printk(KERN_ERR "regulator: %s shut down by fault\n",
+	       rdev->desc->name);
+
+	rdev->fault_off = 1;
+	rdev->fault_count++;
+	events |= REGULATOR_EVENT_FORCE_DISABLE;
+	regulator_fault_retry(rdev);
+	goto out;
+
+unmask:
+	regulator_fault_irq_defer(rdev);
+out:
+	regulator_unlock(rdev);
+	return events;
 }
 
-/**
- * regulator_get - lookup and obtain a reference to a regulator.
- * @dev: device for regulator "consumer"
- * @id: Supply name or regulator ID.
- *
- * Returns a struct regulator corresponding to the regulator producer,
- * or IS_ERR() condition containing errno.  Use of supply names
- * configured via regulator_set_device_supply() is strongly
- * encouraged.
- */
-struct regulator *regulator_get(struct device *dev, const char *id)
+static void regulator_fault_work(struct work_struct *work)
 {
-	struct regulator_dev *rdev;
-	struct regulator_map *map;
-	struct regulator *regulator = ERR_PTR(-ENODEV);
-
-	if (id == NULL) {
-		printk(KERN_ERR "regulator: get() with no identifier\n");
-		return regulator;
-	}
+	struct regulator_dev *rdev = container_of(work, struct regulator_dev,
+						  fault_work.work);
+	int ret;
 
-	mutex_lock(&regulator_list_mutex);
+	regulator_lock(rdev);
 
-	list_for_each_entry(map, &regulator_map_list, list) {
-		if (dev == map->dev &&
-		    strcmp(map->supply, id) == 0) {
-			rdev = map->regulator;
-			goto found;
-		}
+	/* the output stayed on, or the consumers have given up on the
+	 * regulator meanwhile, so there is only the IRQs to bring back */
+	if (!rdev->fault_off) {
+		regulator_fault_irq_unmask(rdev);
+		goto out;
 	}
-	printk(KERN_ERR "regulator: Unable to get requested regulator: %s\n",
-	       id);
-	mutex_unlock(&regulator_list_mutex);
-	return regulator;
 
-found:
-	if (!try_module_get(rdev->owner))
+	ret = rdev_do_enable(rdev);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to re-enable %s: %d\n",
+		       __func__, rdev->desc->name, ret);
+		rdev->fault_count++;
+		regulator_fault_retry(rdev);
 		goto out;
-
-	regulator = create_regulator(rdev, dev, id);
-	if (regulator == NULL) {
-		regulator = ERR_PTR(-ENOMEM);
-		module_put(rdev->owner);
 	}
+	_regulator_delay(_regulator_enable_time(rdev));
 
+	printk(KERN_INFO "regulator: %s re-enabled after fault\n",
+	       rdev->desc->name);
+	rdev->fault_off = 0;
+	regulator_fault_irq_unmask(rdev);
 out:
-	mutex_unlock(&regulator_list_mutex);
-	return regulator;
+	regulator_unlock(rdev);
+}
+
+static irqreturn_t regulator_fault_irq_handler(int irq, void *data)
+{
+	struct regulator_fault_irq *fault = data;
+
+	/* a fault line tends to stay asserted, leave it masked until the
+	 * fault has been handled */
+	disable_irq_nosync(irq);
+	set_bit(0, &fault->masked);
+
+	regulator_post_event(fault->rdev, fault->event);
+
+	return IRQ_HANDLED;
 }
-EXPORT_SYMBOL_GPL(regulator_get);
 
 /**
- * regulator_put - "free" the regulator source
- * @regulator: regulator source
+ * regulator_request_fault_irq - report an interrupt as a regulator fault
+ * @rdev: regulator the interrupt reports on
+ * @irq: interrupt number
+ * @irqflags: flags for request_irq()
+ * @event: REGULATOR_EVENT_ flags to raise when the interrupt fires
  *
- * Note: drivers must ensure that all regulator_enable calls made on this
- * regulator source are balanced by regulator_disable calls prior to calling
- * this function.
+ * For regulator drivers with a dedicated fault interrupt, saving them
+ * from having their own handler.  The interrupt is masked from when it
+ * fires until shortly after the core has handled the fault, longer if
+ * it keeps firing, or until the output has been turned back on if the
+ * fault shut it down.  The interrupt is
+ * freed by regulator_free_fault_irq() or when the regulator is
+ * unregistered.
  */
-void regulator_put(struct regulator *regulator)
+int regulator_request_fault_irq(struct regulator_dev *rdev, int irq,
+				unsigned long irqflags, unsigned long event)
 {
-	struct regulator_dev *rdev;
+	struct regulator_fault_irq *fault;
+	int ret;
 
-	if (regulator == NULL || IS_ERR(regulator))
-		return;
+	fault = kzalloc(sizeof(*fault), GFP_KERNEL);
+	if (fault == NULL)
+		return -ENOMEM;
 
-	if (regulator->enabled) {
-		printk(KERN_WARNING "Releasing supply %s while enabled\n",
-		       regulator->supply_name);
-		WARN_ON(regulator->enabled);
-		regulator_disable(regulator);
-	}
+	fault->rdev = rdev;
+	fault->irq = irq;
+	fault->event = event;
 
-	mutex_lock(&regulator_list_mutex);
-	rdev = regulator->rdev;
+	regulator_lock(rdev);
+	list_add(&fault->list, &rdev->fault_irqs);
+	regulator_unlock(rdev);
 
-	/* remove any sysfs entries */
-	if (regulator->dev) {
-		sysfs_remove_link(&rdev->dev.kobj, regulator->supply_name);
-		kfree(regulator->supply_name);
-		device_remove_file(regulator->dev, &regulator->dev_attr);
-		kfree(regulator->dev_attr.attr.name);
+	ret = request_irq(irq, regulator_fault_irq_handler, irqflags,
+			  rdev->desc->name, fault);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to request IRQ %d for %s: %d\n",
+		       __func__, irq, rdev->desc->name, ret);
+		regulator_lock(rdev);
+		list_del(&fault->list);
+		regulator_unlock(rdev);
+		kfree(fault);
 	}
-	list_del(&regulator->list);
-	kfree(regulator);
 
-	module_put(rdev->owner);
-	mutex_unlock(&regulator_list_mutex);
+	return ret;
 }
-EXPORT_SYMBOL_GPL(regulator_put);
+EXPORT_SYMBOL_GPL(regulator_request_fault_irq);
 
-/* locks held by regulator_enable() */
-static int _regulator_enable(struct regulator_dev *rdev)
+static void regulator_fault_irq_release(struct regulator_fault_irq *fault)
 {
-	int ret = -EINVAL;
+	free_irq(fault->irq, fault);
+	/* keep the disable depth balanced for the next user */
+	if (test_and_clear_bit(0, &fault->masked))
+		enable_irq(fault->irq);
+	kfree(fault);
+}
 
-	if (!rdev->constraints) {
-		printk(KERN_ERR "%s: %s has no constraints\n",
-		       __func__, rdev->desc->name);
-		return ret;
+/**
+ * regulator_free_fault_irq - release a regulator fault interrupt
+ * @rdev: regulator the interrupt reports on
+ * @irq: interrupt number passed to regulator_request_fault_irq()
+ */
+void regulator_free_fault_irq(struct regulator_dev *rdev, int irq)
+{
+	struct regulator_fault_irq *fault, *found = NULL;
+
+	regulator_lock(rdev);
+	list_for_each_entry(fault, &rdev->fault_irqs, list) {
+		if (fault->irq == irq) {
+			found = fault;
+			list_del(&fault->list);
+			break;
+		}
 	}
+	regulator_unlock(rdev);
 
-	/* do we need to enable the supply regulator first */
-	if (rdev->supply) {
-		ret = _regulator_enable(rdev->supply);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to enable %s: %d\n",
-			       __func__, rdev->desc->name, ret);
-			return ret;
+	if (found)
+		regulator_fault_irq_release(found);
+}
+EXPORT_SYMBOL_GPL(regulator_free_fault_irq);
+
+static void regulator_event_work(struct work_struct *work)
+{
+	struct regulator_dev *rdev = container_of(work, struct regulator_dev,
+						  event_work);
+	struct regulator_dev *_rdev;
+	unsigned long flags, events, supply_events;
+
+	spin_lock_irqsave(&rdev->event_lock, flags);
+	events = rdev->pending_events;
+	supply_events = rdev->supply_events;
+	rdev->pending_events = 0;
+	rdev->supply_events = 0;
+	spin_unlock_irqrestore(&rdev->event_lock, flags);
+
+	/* only our own faults are acted on, faults of our supply are
+	 * just passed on to the consumers */
+	events = regulator_handle_fault(rdev, events);
+	if (events & REGULATOR_FAULT_EVENTS)
+		regulator_led_fault(rdev, 1);
+
+	events |= supply_events;
+	if (!events)
+		return;
+
+	if (events & (REGULATOR_EVENT_FAIL | REGULATOR_EVENT_UNDER_VOLTAGE))
+		regulator_history_dump(rdev);
+
+	/* call rdev chain first, the chain has its own locking so we can
+	 * leave the regulator free for notifiers that want to use it */
+	blocking_notifier_call_chain(&rdev->notifier, events, NULL);
+
+	/* now notify regulators we supply */
+	mutex_lock(&rdev->domain->lock);
+	list_for_each_entry(_rdev, &rdev->supply_list, slist)
+		regulator_queue_event(_rdev, &_rdev->supply_events, events);
+	mutex_unlock(&rdev->domain->lock);
+}
+
+/**
+ * regulator_bulk_get - get multiple regulator consumers
+ *
+ * @dev:           Device to supply
+ * @num_consumers: Number of consumers to register
+ * @consumers:     Configuration of consumers; clients are stored here.
+ *
+ * @return 0 on success, an errno on failure.
+ *
+ * This helper function allows drivers to get several regulator
+ * consumers in one operation.  If any of the regulators cannot be
+ * acquired then any regulators that were allocated will be freed
+ * before returning to the caller.
+ */
+int regulator_bulk_get(struct device *dev, int num_consumers,
+		       struct regulator_bulk_data *consumers)
+{
+	struct regulator_dev **rdevs;
+	int i, n;
+	int ret = 0;
+
+	for (i = 0; i < num_consumers; i++)
+		consumers[i].consumer = NULL;
+
+	rdevs = kcalloc(num_consumers, sizeof(*rdevs), GFP_KERNEL);
+	if (rdevs == NULL)
+		return -ENOMEM;
+
+	/* resolve every supply in one pass over the map */
+	rcu_read_lock();
+	for (n = 0; n < num_consumers; n++) {
+		if (consumers[n].supply)
+			rdevs[n] = regulator_supply_lookup(dev,
+							   consumers[n].supply);
+		if (rdevs[n] == NULL || !try_module_get(rdevs[n]->owner)) {
+			ret = -ENODEV;
+			break;
 		}
+		get_device(&rdevs[n]->dev);
 	}
+	rcu_read_unlock();
 
-	/* check voltage and requested load before enabling */
-	if (rdev->desc->ops->enable) {
-
-		if (rdev->constraints &&
-			(rdev->constraints->valid_ops_mask &
-			REGULATOR_CHANGE_DRMS))
-			drms_uA_update(rdev);
+	if (ret < 0) {
+		dev_err(dev, "Failed to get supply '%s'\n",
+			consumers[n].supply);
+		while (--n >= 0) {
+			module_put(rdevs[n]->owner);
+			put_device(&rdevs[n]->dev);
+		}
+		goto out;
+	}
 
-		ret = rdev->desc->ops->enable(rdev);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to enable %s: %d\n",
-			       __func__, rdev->desc->name, ret);
-			return ret;
+	for (n = 0; n < num_consumers; n++) {
+		consumers[n].consumer = create_regulator(rdevs[n], dev,
+							 consumers[n].supply);
+		if (consumers[n].consumer == NULL) {
+			ret = -ENOMEM;
+			goto err_consumer;
 		}
-		rdev->use_count++;
-		return ret;
 	}
 
+	goto out;
+
+err_consumer:
+	/* consumers hold their own references, the rest are ours */
+	for (i = 0; i < n; i++) {
+		regulator_put(consumers[i].consumer);
+		consumers[i].consumer = NULL;
+	}
+	for (i = n; i < num_consumers; i++) {
+		module_put(rdevs[i]->owner);
+		put_device(&rdevs[i]->dev);
+	}
+out:
+	kfree(rdevs);
 	return ret;
 }
+EXPORT_SYMBOL_GPL(regulator_bulk_get);
 
-/**
- * regulator_enable - enable regulator output
- * @regulator: regulator source
- *
- * Enable the regulator output at the predefined voltage or current value.
- * NOTE: the output value can be set by other drivers, boot loader or may be
- * hardwired in the regulator.
- * NOTE: calls to regulator_enable() must be balanced with calls to
- * regulator_disable().
+/* the top of the supply tree a regulator belongs to */
+static void *regulator_root(struct regulator_dev *rdev)
+{
+	while (rdev->supply)
+		rdev = rdev->supply;
+	return rdev;
+}
+
+/* the PMIC a regulator belongs to, regulators of one chip share reg_data */
+static void *regulator_pmic(struct regulator_dev *rdev)
+{
+	return rdev->reg_data;
+}
+
+/*
+ * Consumers are operated on in groups sharing a key, the same root
+ * supply for enables so that regulators in one tree are still enabled
+ * in order or the same PMIC for other settings so that each chip sees
+ * its changes as one run.  Independent groups are run in parallel.
  */
-int regulator_enable(struct regulator *regulator)
-{
-	int ret;
+struct regulator_bulk_work {
+	struct work_struct work;
+	void *(*key_of)(struct regulator_dev *rdev);	/* NULL for all */
+	void *key;
+	int (*op)(struct regulator_bulk_data *consumer);
+	int num_consumers;
+	struct regulator_bulk_data *consumers;
+	struct completion done;
+};
 
-	if (regulator->enabled) {
-		printk(KERN_CRIT "Regulator %s already enabled\n",
-		       regulator->supply_name);
-		WARN_ON(regulator->enabled);
-		return 0;
-	}
+/* Queue work to run in parallel with other work queued the same way,
+ * spreading it over the online CPUs since work on one CPU is run in
+ * sequence.  Pass the CPU returned by the previous call, starting from
+ * the current CPU, with get_online_cpus() held. */
+static int regulator_queue_parallel(int cpu, struct work_struct *work)
+{
+	cpu = next_cpu(cpu, cpu_online_map);
+	if (cpu >= nr_cpu_ids)
+		cpu = first_cpu(cpu_online_map);
 
-	mutex_lock(&regulator->rdev->mutex);
-	regulator->enabled = 1;
-	ret = _regulator_enable(regulator->rdev);
-	if (ret != 0)
-		regulator->enabled = 0;
-	mutex_unlock(&regulator->rdev->mutex);
-	return ret;
+	queue_work_on(cpu, regulator_parallel_wq, work);
+	return cpu;
 }
-EXPORT_SYMBOL_GPL(regulator_enable);
 
-/* locks held by regulator_disable() */
-static int _regulator_disable(struct regulator_dev *rdev)
+static void regulator_bulk_run_group(struct regulator_bulk_work *group)
 {
-	int ret = 0;
-
-	/* are we the last user and permitted to disable ? */
-	if (rdev->use_count == 1 && !rdev->constraints->always_on) {
+	struct regulator_bulk_data *consumers = group->consumers;
+	int i;
 
-		/* we are last user */
-		if (rdev->desc->ops->disable) {
-			ret = rdev->desc->ops->disable(rdev);
-			if (ret < 0) {
-				printk(KERN_ERR "%s: failed to disable %s\n",
-				       __func__, rdev->desc->name);
-				return ret;
-			}
-		}
+	for (i = 0; i < group->num_consumers; i++) {
+		if (group->key_of &&
+		    group->key_of(consumers[i].consumer->rdev) != group->key)
+			continue;
+		consumers[i].ret = group->op(&consumers[i]);
+	}
+}
 
-		/* decrease our supplies ref count and disable if required */
-		if (rdev->supply)
-			_regulator_disable(rdev->supply);
+static void regulator_bulk_work(struct work_struct *work)
+{
+	struct regulator_bulk_work *group =
+		container_of(work, struct regulator_bulk_work, work);
 
-		rdev->use_count = 0;
-	} else if (rdev->use_count > 1) {
+	regulator_bulk_run_group(group);
+	complete(&group->done);
+}
 
-		if (rdev->constraints &&
-			(rdev->constraints->valid_ops_mask &
-			REGULATOR_CHANGE_DRMS))
-			drms_uA_update(rdev);
+/* Run op on every consumer, grouping them by key_of() and running the
+ * groups in parallel.  The result for each consumer is left in ret. */
+static void regulator_bulk_run(int num_consumers,
+			       struct regulator_bulk_data *consumers,
+			       void *(*key_of)(struct regulator_dev *rdev),
+			       int (*op)(struct regulator_bulk_data *consumer))
+{
+	struct regulator_bulk_work *groups;
+	void *key;
+	int i, j, cpu, num_groups = 0;
 
-		rdev->use_count--;
+	for (i = 0; i < num_consumers; i++)
+		consumers[i].ret = 0;
+
+	groups = kcalloc(num_consumers, sizeof(*groups), GFP_KERNEL);
+	if (groups == NULL || num_consumers < 2 || !regulator_parallel_wq) {
+		/* just do them all here, in order */
+		struct regulator_bulk_work all = {
+			.op = op,
+			.num_consumers = num_consumers,
+			.consumers = consumers,
+		};
+
+		kfree(groups);
+		regulator_bulk_run_group(&all);
+		return;
 	}
-	return ret;
-}
 
-/**
- * regulator_disable - disable regulator output
- * @regulator: regulator source
- *
- * Disable the regulator output voltage or current.
- * NOTE: this will only disable the regulator output if no other consumer
- * devices have it enabled.
- * NOTE: calls to regulator_enable() must be balanced with calls to
- * regulator_disable().
- */
-int regulator_disable(struct regulator *regulator)
-{
-	int ret;
+	for (i = 0; i < num_consumers; i++) {
+		key = key_of(consumers[i].consumer->rdev);
+		for (j = 0; j < num_groups; j++)
+			if (groups[j].key == key)
+				break;
+		if (j < num_groups)
+			continue;
+
+		groups[num_groups].key_of = key_of;
+		groups[num_groups].key = key;
+		groups[num_groups].op = op;
+		groups[num_groups].num_consumers = num_consumers;
+		groups[num_groups].consumers = consumers;
+		num_groups++;
+	}
 
-	if (!regulator->enabled) {
-		printk(KERN_ERR "%s: not in use by this consumer\n",
-			__func__);
-		return 0;
+	/* hand every group but the first to the workqueue */
+	get_online_cpus();
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < num_groups; i++) {
+		INIT_WORK(&groups[i].work, regulator_bulk_work);
+		init_completion(&groups[i].done);
+		cpu = regulator_queue_parallel(cpu, &groups[i].work);
 	}
 
-	mutex_lock(&regulator->rdev->mutex);
-	regulator->enabled = 0;
-	regulator->uA_load = 0;
-	ret = _regulator_disable(regulator->rdev);
-	mutex_unlock(&regulator->rdev->mutex);
-	return ret;
+	regulator_bulk_run_group(&groups[0]);
+
+	for (i = 1; i < num_groups; i++)
+		wait_for_completion(&groups[i].done);
+	put_online_cpus();
+
+	kfree(groups);
 }
-EXPORT_SYMBOL_GPL(regulator_disable);
 
-/* locks held by regulator_force_disable() */
-static int _regulator_force_disable(struct regulator_dev *rdev)
+/* report any failures from regulator_bulk_run(), returning the last */
+static int regulator_bulk_check(int num_consumers,
+				struct regulator_bulk_data *consumers,
+				const char *what)
 {
-	int ret = 0;
+	int i, ret = 0;
 
-	/* force disable */
-	if (rdev->desc->ops->disable) {
-		/* ah well, who wants to live forever... */
-		ret = rdev->desc->ops->disable(rdev);
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to force disable %s\n",
-			       __func__, rdev->desc->name);
-			return ret;
+	for (i = 0; i < num_consumers; i++) {
+		if (consumers[i].ret < 0) {
+			printk(KERN_ERR "Failed to %s %s: %d\n", what,
+			       consumers[i].supply, consumers[i].ret);
+			ret = consumers[i].ret;
 		}
-		/* notify other consumers that power has been forced off */
-		_notifier_call_chain(rdev, REGULATOR_EVENT_FORCE_DISABLE,
-			NULL);
 	}
 
-	/* decrease our supplies ref count and disable if required */
-	if (rdev->supply)
-		_regulator_disable(rdev->supply);
-
-	rdev->use_count = 0;
 	return ret;
 }
 
+static int regulator_bulk_op_enable(struct regulator_bulk_data *consumer)
+{
+	return regulator_enable(consumer->consumer);
+}
+
 /**
- * regulator_force_disable - force disable regulator output
- * @regulator: regulator source
+ * regulator_bulk_enable - enable multiple regulator consumers
  *
- * Forcibly disable the regulator output voltage or current.
- * NOTE: this *will* disable the regulator output even if other consumer
- * devices have it enabled. This should be used for situations when device
- * damage will likely occur if the regulator is not disabled (e.g. over temp).
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data; clients are stored here.
+ * @return         0 on success, an errno on failure
+ *
+ * This convenience API allows consumers to enable multiple regulator
+ * clients in a single API call.  Supplies which do not share a parent
+ * regulator are enabled in parallel, supplies in the same regulator
+ * tree are enabled in order.  If any consumers cannot be enabled then
+ * any others that were enabled will be disabled again prior to return.
  */
-int regulator_force_disable(struct regulator *regulator)
+int regulator_bulk_enable(int num_consumers,
+			  struct regulator_bulk_data *consumers)
 {
-	int ret;
+	int i, ret;
+
+	regulator_bulk_run(num_consumers, consumers, regulator_root,
+			   regulator_bulk_op_enable);
+
+	ret = regulator_bulk_check(num_consumers, consumers, "enable");
+	if (ret == 0)
+		return 0;
+
+	for (i = 0; i < num_consumers; i++)
+		if (consumers[i].ret == 0)
+			regulator_disable(consumers[i].consumer);
 
-	mutex_lock(&regulator->rdev->mutex);
-	regulator->enabled = 0;
-	regulator->uA_load = 0;
-	ret = _regulator_force_disable(regulator->rdev);
-	mutex_unlock(&regulator->rdev->mutex);
 	return ret;
 }
-EXPORT_SYMBOL_GPL(regulator_force_disable);
+EXPORT_SYMBOL_GPL(regulator_bulk_enable);
 
-static int _regulator_is_enabled(struct regulator_dev *rdev)
+/**
+ * regulator_bulk_disable - disable multiple regulator consumers
+ *
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data; clients are stored here.
+ * @return         0 on success, an errno on failure
+ *
+ * This convenience API allows consumers to disable multiple regulator
+ * clients in a single API call.  If any consumers cannot be enabled
+ * then any others that were disabled will be disabled again prior to
+ * return.
+ */
+int regulator_bulk_disable(int num_consumers,
+			   struct regulator_bulk_data *consumers)
 {
+	int i;
 	int ret;
 
-	mutex_lock(&rdev->mutex);
-
-	/* sanity check */
-	if (!rdev->desc->ops->is_enabled) {
-		ret = -EINVAL;
-		goto out;
+	for (i = 0; i < num_consumers; i++) {
+		ret = regulator_disable(consumers[i].consumer);
+		if (ret != 0)
+			goto err;
 	}
 
-	ret = rdev->desc->ops->is_enabled(rdev);
-out:
-	mutex_unlock(&rdev->mutex);
+	return 0;
+
+err:
+	printk(KERN_ERR "Failed to disable %s\n", consumers[i].supply);
+	for (i = 0; i < num_consumers; i++)
+		regulator_enable(consumers[i].consumer);
+
 	return ret;
 }
+EXPORT_SYMBOL_GPL(regulator_bulk_disable);
 
-/**
- * regulator_is_enabled - is the regulator output enabled
- * @regulator: regulator source
- *
- * Returns zero for disabled otherwise return number of enable requests.
- */
-int regulator_is_enabled(struct regulator *regulator)
+static int regulator_bulk_op_voltage(struct regulator_bulk_data *consumer)
 {
-	return _regulator_is_enabled(regulator->rdev);
+	return regulator_set_voltage(consumer->consumer, consumer->min_uV,
+				     consumer->max_uV);
 }
-EXPORT_SYMBOL_GPL(regulator_is_enabled);
 
 /**
- * regulator_set_voltage - set regulator output voltage
- * @regulator: regulator source
- * @min_uV: Minimum required voltage in uV
- * @max_uV: Maximum acceptable voltage in uV
- *
- * Sets a voltage regulator to the desired output voltage. This can be set
- * during any regulator state. IOW, regulator can be disabled or enabled.
+ * regulator_bulk_set_voltage - set the voltage of multiple consumers
  *
- * If the regulator is enabled then the voltage will change to the new value
- * immediately otherwise if the regulator is disabled the regulator will
- * output at the new voltage when enabled.
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data, min_uV and max_uV give the voltage
+ *                 range for each supply.
+ * @return         0 on success, an errno on failure
  *
- * NOTE: If the regulator is shared between several devices then the lowest
- * request voltage that meets the system constraints will be used.
- * NOTE: Regulator system constraints must be set for this regulator before
- * calling this function otherwise this call will fail.
+ * This convenience API applies regulator_set_voltage() to several
+ * consumers in a single call.  Supplies on the same PMIC are changed
+ * together, one after the other, and different PMICs are updated in
+ * parallel.  Supplies which were changed successfully are left at
+ * their new voltage if others fail; the ret field of each consumer
+ * gives its result.
  */
-int regulator_set_voltage(struct regulator *regulator, int min_uV, int max_uV)
+int regulator_bulk_set_voltage(int num_consumers,
+			       struct regulator_bulk_data *consumers)
 {
-	struct regulator_dev *rdev = regulator->rdev;
-	int ret;
-
-	mutex_lock(&rdev->mutex);
-
-	/* sanity check */
-	if (!rdev->desc->ops->set_voltage) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	/* constraints check */
-	ret = regulator_check_voltage(rdev, &min_uV, &max_uV);
-	if (ret < 0)
-		goto out;
-	regulator->min_uV = min_uV;
-	regulator->max_uV = max_uV;
-	ret = rdev->desc->ops->set_voltage(rdev, min_uV, max_uV);
+	regulator_bulk_run(num_consumers, consumers, regulator_pmic,
+			   regulator_bulk_op_voltage);
 
-out:
-	mutex_unlock(&rdev->mutex);
-	return ret;
+	return regulator_bulk_check(num_consumers, consumers, "set voltage of");
 }
-EXPORT_SYMBOL_GPL(regulator_set_voltage);
+EXPORT_SYMBOL_GPL(regulator_bulk_set_voltage);
 
-static int _regulator_get_voltage(struct regulator_dev *rdev)
+static int regulator_bulk_op_mode(struct regulator_bulk_data *consumer)
 {
-	/* sanity check */
-	if (rdev->desc->ops->get_voltage)
-		return rdev->desc->ops->get_voltage(rdev);
-	else
-		return -EINVAL;
+	return regulator_set_mode(consumer->consumer, consumer->mode);
 }
 
 /**
- * regulator_get_voltage - get regulator output voltage
- * @regulator: regulator source
+ * regulator_bulk_set_mode - set the operating mode of multiple consumers
  *
- * This returns the current regulator voltage in uV.
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data, mode gives the mode for each supply.
+ * @return         0 on success, an errno on failure
  *
- * NOTE: If the regulator is disabled it will return the voltage value. This
- * function should not be used to determine regulator state.
+ * This convenience API applies regulator_set_mode() to several
+ * consumers in a single call, grouping them by PMIC as for
+ * regulator_bulk_set_voltage().
  */
-int regulator_get_voltage(struct regulator *regulator)
+int regulator_bulk_set_mode(int num_consumers,
+			    struct regulator_bulk_data *consumers)
 {
-	int ret;
+	regulator_bulk_run(num_consumers, consumers, regulator_pmic,
+			   regulator_bulk_op_mode);
 
-	mutex_lock(&regulator->rdev->mutex);
+	return regulator_bulk_check(num_consumers, consumers, "set mode of");
+}
+EXPORT_SYMBOL_GPL(regulator_bulk_set_mode);
 
-	ret = _regulator_get_voltage(regulator->rdev);
+static int regulator_bulk_op_optimum_mode(struct regulator_bulk_data *consumer)
+{
+	return regulator_set_optimum_mode(consumer->consumer,
+					  consumer->uA_load);
+}
 
-	mutex_unlock(&regulator->rdev->mutex);
+/**
+ * regulator_bulk_set_optimum_mode - set the load of multiple consumers
+ *
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data, uA_load gives the load on each supply.
+ * @return         0 on success, an errno on failure
+ *
+ * This convenience API applies regulator_set_optimum_mode() to several
+ * consumers in a single call, grouping them by PMIC as for
+ * regulator_bulk_set_voltage().  The ret field of each consumer holds
+ * the mode chosen for it.
+ */
+int regulator_bulk_set_optimum_mode(int num_consumers,
+				    struct regulator_bulk_data *consumers)
+{
+	regulator_bulk_run(num_consumers, consumers, regulator_pmic,
+			   regulator_bulk_op_optimum_mode);
 
-	return ret;
+	return regulator_bulk_check(num_consumers, consumers, "set load of");
 }
-EXPORT_SYMBOL_GPL(regulator_get_voltage);
+EXPORT_SYMBOL_GPL(regulator_bulk_set_optimum_mode);
 
 /**
- * regulator_set_current_limit - set regulator output current limit
- * @regulator: regulator source
- * @min_uA: Minimuum supported current in uA
- * @max_uA: Maximum supported current in uA
- *
- * Sets current sink to the desired output current. This can be set during
- * any regulator state. IOW, regulator can be disabled or enabled.
+ * regulator_bulk_free - free multiple regulator consumers
  *
- * If the regulator is enabled then the current will change to the new value
- * immediately otherwise if the regulator is disabled the regulator will
- * output at the new current when enabled.
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data; clients are stored here.
  *
- * NOTE: Regulator system constraints must be set for this regulator before
- * calling this function otherwise this call will fail.
+ * This convenience API allows consumers to free multiple regulator
+ * clients in a single API call.
  */
-int regulator_set_current_limit(struct regulator *regulator,
-			       int min_uA, int max_uA)
+void regulator_bulk_free(int num_consumers,
+			 struct regulator_bulk_data *consumers)
 {
-	struct regulator_dev *rdev = regulator->rdev;
-	int ret;
+	int i;
+
+	for (i = 0; i < num_consumers; i++) {
+		regulator_put(consumers[i].consumer);
+		consumers[i].consumer = NULL;
+	}
+}
+EXPORT_SYMBOL_GPL(regulator_bulk_free);
+
+/* supplies following the run-time PM state of a device */
+struct regulator_runtime {
+	struct list_head list;
+	struct notifier_block nb;
+	struct device *dev;
+	int num_consumers;
+	struct regulator_bulk_data *consumers;
+	int off_delay_ms;
+	int enabled;		/* the binding holds an enable of each */
+};
 
-	mutex_lock(&rdev->mutex);
+static LIST_HEAD(regulator_runtime_list);
 
-	/* sanity check */
-	if (!rdev->desc->ops->set_current_limit) {
-		ret = -EINVAL;
-		goto out;
+static void regulator_runtime_off(struct regulator_runtime *rr, int ms)
+{
+	int i, ret;
+
+	for (i = 0; i < rr->num_consumers; i++) {
+		ret = regulator_disable_deferred(rr->consumers[i].consumer, ms);
+		if (ret < 0)
+			printk(KERN_ERR "%s: failed to disable %s: %d\n",
+			       __func__, rr->consumers[i].supply, ret);
 	}
+	rr->enabled = 0;
+}
 
-	/* constraints check */
-	ret = regulator_check_current_limit(rdev, &min_uA, &max_uA);
-	if (ret < 0)
-		goto out;
+/* called with the device's run-time PM transitions serialised */
+static int regulator_runtime_notify(struct notifier_block *nb,
+				    unsigned long event, void *data)
+{
+	struct regulator_runtime *rr =
+		container_of(nb, struct regulator_runtime, nb);
+	int ret;
 
-	ret = rdev->desc->ops->set_current_limit(rdev, min_uA, max_uA);
-out:
-	mutex_unlock(&rdev->mutex);
-	return ret;
+	switch (event) {
+	case RPM_NOTIFY_RESUMING:
+		if (rr->enabled)
+			return NOTIFY_OK;
+		ret = regulator_bulk_enable(rr->num_consumers, rr->consumers);
+		if (ret < 0)
+			return notifier_from_errno(ret);
+		rr->enabled = 1;
+		return NOTIFY_OK;
+
+	case RPM_NOTIFY_SUSPENDED:
+		if (rr->enabled)
+			regulator_runtime_off(rr, rr->off_delay_ms);
+		return NOTIFY_OK;
+	}
+
+	return NOTIFY_DONE;
 }
-EXPORT_SYMBOL_GPL(regulator_set_current_limit);
 
-static int _regulator_get_current_limit(struct regulator_dev *rdev)
+/**
+ * regulator_bulk_bind_runtime - make supplies follow a device's runtime PM
+ *
+ * @dev:           Consumer device
+ * @num_consumers: Number of consumers
+ * @consumers:     Consumer data from regulator_bulk_get()
+ * @off_delay_ms:  Time to keep the supplies on after the device suspends
+ * @return         0 on success, an errno on failure
+ *
+ * The supplies are enabled now unless @dev is runtime suspended.  After
+ * that they are enabled before each runtime resume of @dev and disabled
+ * with regulator_disable_deferred() once it has runtime suspended, so a
+ * device used again within @off_delay_ms leaves its supplies untouched.
+ * The consumer must not enable or disable the supplies itself while they
+ * are bound.  Without CONFIG_PM_RUNTIME the supplies stay on until
+ * regulator_bulk_unbind_runtime().
+ */
+int regulator_bulk_bind_runtime(struct device *dev, int num_consumers,
+				struct regulator_bulk_data *consumers,
+				int off_delay_ms)
 {
+	struct regulator_runtime *rr;
 	int ret;
 
-	mutex_lock(&rdev->mutex);
+	rr = kzalloc(sizeof(*rr), GFP_KERNEL);
+	if (rr == NULL)
+		return -ENOMEM;
 
-	/* sanity check */
-	if (!rdev->desc->ops->get_current_limit) {
-		ret = -EINVAL;
-		goto out;
+	rr->dev = dev;
+	rr->num_consumers = num_consumers;
+	rr->consumers = consumers;
+	rr->off_delay_ms = off_delay_ms;
+	rr->nb.notifier_call = regulator_runtime_notify;
+
+	/* hold the run-time PM state of dev while we pick it up */
+	pm_runtime_disable(dev);
+	if (!pm_runtime_status_suspended(dev)) {
+		ret = regulator_bulk_enable(num_consumers, consumers);
+		if (ret < 0)
+			goto err;
+		rr->enabled = 1;
+	}
+	ret = pm_runtime_register_notifier(dev, &rr->nb);
+	if (ret < 0) {
+		if (rr->enabled)
+			regulator_runtime_off(rr, 0);
+		goto err;
 	}
+	pm_runtime_enable(dev);
 
-	ret = rdev->desc->ops->get_current_limit(rdev);
-out:
-	mutex_unlock(&rdev->mutex);
+	mutex_lock(&regulator_list_mutex);
+	list_add(&rr->list, &regulator_runtime_list);
+	mutex_unlock(&regulator_list_mutex);
+	return 0;
+
+err:
+	pm_runtime_enable(dev);
+	kfree(rr);
 	return ret;
 }
+EXPORT_SYMBOL_GPL(regulator_bulk_bind_runtime);
 
 /**
- * regulator_get_current_limit - get regulator output current
- * @regulator: regulator source
+ * regulator_bulk_unbind_runtime - stop supplies following runtime PM
  *
- * This returns the current supplied by the specified current sink in uA.
+ * @dev:           Consumer device
+ * @consumers:     Consumer data passed to regulator_bulk_bind_runtime()
  *
- * NOTE: If the regulator is disabled it will return the current value. This
- * function should not be used to determine regulator state.
+ * Supplies the binding has enabled are disabled immediately.
  */
-int regulator_get_current_limit(struct regulator *regulator)
+void regulator_bulk_unbind_runtime(struct device *dev,
+				   struct regulator_bulk_data *consumers)
 {
-	return _regulator_get_current_limit(regulator->rdev);
+	struct regulator_runtime *rr, *found = NULL;
+
+	mutex_lock(&regulator_list_mutex);
+	list_for_each_entry(rr, &regulator_runtime_list, list) {
+		if (rr->dev == dev && rr->consumers == consumers) {
+			list_del(&rr->list);
+			found = rr;
+			break;
+		}
+	}
+	mutex_unlock(&regulator_list_mutex);
+	if (found == NULL)
+		return;
+
+	pm_runtime_disable(dev);
+	pm_runtime_unregister_notifier(dev, &found->nb);
+	if (found->enabled)
+		regulator_runtime_off(found, 0);
+	pm_runtime_enable(dev);
+	kfree(found);
 }
-EXPORT_SYMBOL_GPL(regulator_get_current_limit);
+EXPORT_SYMBOL_GPL(regulator_bulk_unbind_runtime);
 
 /**
- * regulator_set_mode - set regulator operating mode
+ * regulator_notifier_call_chain - call regulator event notifier
  * @regulator: regulator source
- * @mode: operating mode - one of the REGULATOR_MODE constants
+ * @event: notifier block
+ * @data: unused
  *
- * Set regulator operating mode to increase regulator efficiency or improve
- * regulation performance.
+ * Called by regulator drivers to notify clients a regulator event has
+ * occurred. We also notify regulator clients downstream.
  *
- * NOTE: Regulator system constraints must be set for this regulator before
- * calling this function otherwise this call will fail.
+ * Consumers are notified asynchronously from a workqueue, with events
+ * that are posted again before delivery being coalesced.  The event
+ * passed to consumers may therefore contain several REGULATOR_EVENT
+ * flags.  This may be called from any context.
  */
-int regulator_set_mode(struct regulator *regulator, unsigned int mode)
+int regulator_notifier_call_chain(struct regulator_dev *rdev,
+				  unsigned long event, void *data)
 {
-	struct regulator_dev *rdev = regulator->rdev;
-	int ret;
+	regulator_post_event(rdev, event);
+	return NOTIFY_DONE;
 
-	mutex_lock(&rdev->mutex);
+}
+EXPORT_SYMBOL_GPL(regulator_notifier_call_chain);
 
-	/* sanity check */
-	if (!rdev->desc->ops->set_mode) {
-		ret = -EINVAL;
-		goto out;
+/* locks held by regulator_sync_state() */
+static int _regulator_sync_state(struct regulator_dev *rdev)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret, on = -1, want_on, n = 0;
+
+	/* the hardware may have changed under us */
+	rdev->cached_uV = 0;
+	rdev->enabled_state = -1;
+	rdev->preload_sel = -1;
+
+	want_on = rdev->use_count > 0 ||
+		(rdev->constraints && rdev->constraints->always_on);
+
+	if (ops->is_enabled) {
+		ret = rdev_op(rdev, REGULATOR_OP_IS_ENABLED, 0,
+			      ops->is_enabled(rdev));
+		if (ret < 0)
+			return ret;
+		on = ret > 0;
+		rdev->enabled_state = on;
 	}
 
-	/* constraints check */
-	ret = regulator_check_mode(rdev, mode);
-	if (ret < 0)
-		goto out;
+	/* turn off before reconfiguring, on only once configured */
+	if (on == 1 && !want_on && ops->disable) {
+		ret = rdev_do_disable(rdev);
+		if (ret < 0)
+			return ret;
+		n++;
+	}
 
-	ret = rdev->desc->ops->set_mode(rdev, mode);
-out:
-	mutex_unlock(&rdev->mutex);
-	return ret;
-}
-EXPORT_SYMBOL_GPL(regulator_set_mode);
+	if (rdev->selector >= 0 && ops->get_voltage_sel &&
+	    ops->set_voltage_sel) {
+		ret = rdev_op(rdev, REGULATOR_OP_GET_VOLTAGE, 0,
+			      ops->get_voltage_sel(rdev));
+		if (ret < 0)
+			return ret;
+		if (ret != rdev->selector) {
+			ret = rdev_op(rdev, REGULATOR_OP_SET_VOLTAGE,
+				      ops->list_voltage(rdev, rdev->selector),
+				      ops->set_voltage_sel(rdev,
+							   rdev->selector));
+			if (ret < 0)
+				return ret;
+			n++;
+		}
+	} else if (rdev->req_max_uV && ops->get_voltage && ops->set_voltage) {
+		ret = rdev_op(rdev, REGULATOR_OP_GET_VOLTAGE, 0,
+			      ops->get_voltage(rdev));
+		if (ret < 0)
+			return ret;
+		if (ret < rdev->req_min_uV || ret > rdev->req_max_uV) {
+			ret = rdev_do_set_voltage(rdev, rdev->req_min_uV,
+						  rdev->req_max_uV);
+			if (ret < 0)
+				return ret;
+			n++;
+		}
+	}
 
-static unsigned int _regulator_get_mode(struct regulator_dev *rdev)
-{
-	int ret;
+	if (rdev->mode && ops->get_mode && ops->set_mode &&
+	    ops->get_mode(rdev) != rdev->mode) {
+		ret = rdev_do_set_mode(rdev, rdev->mode);
+		if (ret < 0)
+			return ret;
+		n++;
+	}
 
-	mutex_lock(&rdev->mutex);
+	if (rdev->max_uA && ops->get_current_limit &&
+	    ops->set_current_limit) {
+		ret = rdev_op(rdev, REGULATOR_OP_GET_CURRENT_LIMIT, 0,
+			      ops->get_current_limit(rdev));
+		if (ret < 0)
+			return ret;
+		if (ret < rdev->min_uA || ret > rdev->max_uA) {
+			ret = rdev_do_set_current_limit(rdev, rdev->min_uA,
+							rdev->max_uA);
+			if (ret < 0)
+				return ret;
+			n++;
+		}
+	}
 
-	/* sanity check */
-	if (!rdev->desc->ops->get_mode) {
-		ret = -EINVAL;
-		goto out;
+	if (on != 1 && want_on && ops->enable) {
+		ret = rdev_do_enable(rdev);
+		if (ret < 0)
+			return ret;
+		_regulator_delay(_regulator_enable_time(rdev));
+		n++;
 	}
 
-	ret = rdev->desc->ops->get_mode(rdev);
-out:
-	mutex_unlock(&rdev->mutex);
-	return ret;
+	return n;
 }
 
 /**
- * regulator_get_mode - get regulator operating mode
- * @regulator: regulator source
+ * regulator_sync_state - reprogram the hardware with the core's state
+ * @rdev: regulator to resynchronise
  *
- * Get the current regulator operating mode.
+ * For use by regulator drivers on resume when the PMIC may have lost
+ * its configuration or been changed by firmware.  The enable state,
+ * voltage, operating mode and current limit last programmed by the
+ * core are read back and only those which differ are written again.
+ * Drivers which can read all their control registers in one bulk
+ * transfer should refresh their register cache that way first so the
+ * comparison does not need a bus access for each setting.
+ *
+ * Returns the number of settings which had to be rewritten, or a
+ * negative error code.
  */
-unsigned int regulator_get_mode(struct regulator *regulator)
+int regulator_sync_state(struct regulator_dev *rdev)
 {
-	return _regulator_get_mode(regulator->rdev);
+	int ret;
+
+	regulator_lock(rdev);
+	ret = _regulator_sync_state(rdev);
+	if (ret > 0)
+		regulator_energy_update(rdev);
+	regulator_unlock(rdev);
+
+	if (ret < 0)
+		printk(KERN_ERR "%s: failed to restore %s: %d\n",
+		       __func__, rdev->desc->name, ret);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_sync_state);
+
+/* Switch rdev to the constraints of profile and reselect its mode with
+ * them.  rdev->mutex held by caller */
+static void regulator_apply_profile(struct regulator_dev *rdev, int profile)
+{
+	struct regulation_constraints *constraints = rdev->profiles[profile];
+
+	if (constraints == rdev->constraints)
+		return;
+
+	rdev->constraints = constraints;
+	regulator_digest_constraints(rdev);
+	drms_uA_update(rdev);
 }
-EXPORT_SYMBOL_GPL(regulator_get_mode);
 
 /**
- * regulator_set_optimum_mode - set regulator optimum operating mode
+ * regulator_register - register regulator
  * @regulator: regulator source
- * @uA_load: load current
- *
- * Notifies the regulator core of a new device load. This is then used by
- * DRMS (if enabled by constraints) to set the most efficient regulator
- * operating mode for the new regulator loading.
- *
- * Consumer devices notify their supply regulator of the maximum power
- * they will require (can be taken from device datasheet in the power
- * consumption tables) when they change operational status and hence power
- * state. Examples of operational state changes that can affect power
- * consumption are :-
- *
- *    o Device is opened / closed.
- *    o Device I/O is about to begin or has just finished.
- *    o Device is idling in between work.
- *
- * This information is also exported via sysfs to userspace.
+ * @reg_data: private regulator data
  *
- * DRMS will sum the total requested load on the regulator and change
- * to the most efficient operating mode if platform constraints allow.
+ * Called by regulator drivers to register a regulator.
+ * Returns 0 on success.
  *
- * Returns the new regulator mode or error.
+ * The supply regulator need not be registered yet, the regulator is
+ * linked to it when it appears.  The hardware is set up before the
+ * regulator list is locked so several regulators may be registered at
+ * once.
  */
-int regulator_set_optimum_mode(struct regulator *regulator, int uA_load)
+struct regulator_dev *regulator_register(struct regulator_desc *regulator_desc,
+	struct device *dev, void *driver_data)
 {
-	struct regulator_dev *rdev = regulator->rdev;
-	struct regulator *consumer;
-	int ret, output_uV, input_uV, total_uA_load = 0;
-	unsigned int mode;
+	static atomic_t regulator_no = ATOMIC_INIT(0);
+	struct regulator_dev *rdev, *supply;
+	struct regulator_init_data *init_data = dev->platform_data;
+	int ret, i;
+
+	if (regulator_desc == NULL)
+		return ERR_PTR(-EINVAL);
 
-	mutex_lock(&rdev->mutex);
+	if (regulator_desc->name == NULL || regulator_desc->ops == NULL)
+		return ERR_PTR(-EINVAL);
 
-	regulator->uA_load = uA_load;
-	ret = regulator_check_drms(rdev);
+	if (!regulator_desc->type == REGULATOR_VOLTAGE &&
+	    !regulator_desc->type == REGULATOR_CURRENT)
+		return ERR_PTR(-EINVAL);
+
+	if (!init_data)
+		return ERR_PTR(-EINVAL);
+
+	/* the core does everything for fixed regulators */
+	if (regulator_desc->fixed_uV &&
+	    (regulator_desc->ops->enable || regulator_desc->ops->disable ||
+	     regulator_desc->ops->is_enabled ||
+	     regulator_desc->ops->get_voltage ||
+	     regulator_desc->ops->set_voltage ||
+	     regulator_desc->ops->set_voltage_sel))
+		return ERR_PTR(-EINVAL);
+
+	rdev = kzalloc(sizeof(struct regulator_dev), GFP_KERNEL);
+	if (rdev == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	/* nothing is ever done to a fixed regulator so keep no history */
+	if (!regulator_desc->fixed_uV) {
+		rdev->history = kcalloc(REGULATOR_HISTORY_LEN,
+					sizeof(*rdev->history), GFP_KERNEL);
+		if (rdev->history == NULL) {
+			kfree(rdev);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
+	mutex_init(&rdev->config_lock);
+	mutex_init(&rdev->mutex);
+	spin_lock_init(&rdev->stats.lock);
+	rdev->enabled_state = -1;
+	rdev->selector = -1;
+	rdev->preload_sel = -1;
+	rdev->reg_data = driver_data;
+	rdev->owner = regulator_desc->owner;
+	rdev->desc = regulator_desc;
+	INIT_LIST_HEAD(&rdev->consumer_list);
+	INIT_LIST_HEAD(&rdev->supply_list);
+	INIT_LIST_HEAD(&rdev->list);
+	INIT_LIST_HEAD(&rdev->slist);
+	INIT_LIST_HEAD(&rdev->init_list);
+	BLOCKING_INIT_NOTIFIER_HEAD(&rdev->notifier);
+	spin_lock_init(&rdev->event_lock);
+	INIT_WORK(&rdev->event_work, regulator_event_work);
+	INIT_DELAYED_WORK(&rdev->drms_work, regulator_drms_work);
+	INIT_DELAYED_WORK(&rdev->fault_work, regulator_fault_work);
+	INIT_LIST_HEAD(&rdev->fault_irqs);
+	rdev->fault_unmasked = jiffies;
+
+	/* nothing else can see rdev until it is on regulator_list */
+
+	/* preform any regulator specific init */
+	if (init_data->regulator_init) {
+		ret = init_data->regulator_init(rdev->reg_data);
+		if (ret < 0)
+			goto err;
+	}
+
+	/* set regulator constraints */
+	ret = set_machine_constraints(rdev, &init_data->constraints);
 	if (ret < 0)
-		goto out;
-	ret = -EINVAL;
+		goto err;
+
+	rdev->profiles[REGULATOR_PROFILE_DEFAULT] = &init_data->constraints;
+	for (i = REGULATOR_PROFILE_DEFAULT + 1; i < REGULATOR_NUM_PROFILES; i++)
+		rdev->profiles[i] = init_data->profiles[i] ?
+			init_data->profiles[i] : &init_data->constraints;
+
+	/* let any hardware sequencer know where we are in the sequence */
+	rdev->sequence = init_data->sequence;
+	if (rdev->sequence.step > 0 && regulator_desc->ops->set_sequence_step) {
+		ret = regulator_desc->ops->set_sequence_step(rdev,
+							rdev->sequence.step);
+		if (ret < 0)
+			printk(KERN_WARNING "%s: failed to set %s sequence "
+			       "step: %d\n", __func__, regulator_desc->name, ret);
+	}
 
-	/* sanity check */
-	if (!rdev->desc->ops->get_optimum_mode)
-		goto out;
+	/* register with sysfs */
+	rdev->dev.class = &regulator_class;
+	rdev->dev.parent = dev;
+	snprintf(rdev->dev.bus_id, sizeof(rdev->dev.bus_id),
+		 "regulator.%d", atomic_inc_return(&regulator_no) - 1);
+	/* restore the rails along with their PMIC, ahead of the consumers */
+	device_enable_resume_first(&rdev->dev);
+	ret = device_register(&rdev->dev);
+	if (ret != 0)
+		goto err;
 
-	/* get output voltage */
-	output_uV = rdev->desc->ops->get_voltage(rdev);
-	if (output_uV <= 0) {
-		printk(KERN_ERR "%s: invalid output voltage found for %s\n",
-			__func__, rdev->desc->name);
-		goto out;
+	dev_set_drvdata(&rdev->dev, rdev);
+
+	ret = regulator_add_attrs(rdev);
+	if (ret != 0) {
+		device_unregister(&rdev->dev);
+		return ERR_PTR(ret);
 	}
 
-	/* get input voltage */
-	if (rdev->supply && rdev->supply->desc->ops->get_voltage)
-		input_uV = rdev->supply->desc->ops->get_voltage(rdev->supply);
-	else
-		input_uV = rdev->constraints->input_uV;
-	if (input_uV <= 0) {
-		printk(KERN_ERR "%s: invalid input voltage found for %s\n",
-			__func__, rdev->desc->name);
-		goto out;
+	/* statistics are only informational so don't fail without them,
+	 * fixed regulators never have any to report */
+	if (!regulator_desc->fixed_uV &&
+	    sysfs_create_group(&rdev->dev.kobj, &regulator_stats_group))
+		printk(KERN_WARNING "%s: could not add statistics for %s\n",
+		       __func__, regulator_desc->name);
+	regulator_fail_add(rdev);
+	regulator_leds_add(rdev);
+
+	mutex_lock(&regulator_list_mutex);
+
+	rdev->domain = regulator_domain_get(rdev);
+	if (rdev->domain == NULL) {
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+
+	/* set supply regulator if it exists, otherwise wait for it */
+	if (init_data->supply_regulator_dev) {
+		supply = regulator_dev_lookup(init_data->supply_regulator_dev);
+		if (supply) {
+			ret = set_supply(rdev, supply);
+			if (ret < 0)
+				goto err_unlock;
+		} else {
+			rdev->supply_dev = init_data->supply_regulator_dev;
+		}
+	}
+
+	/* add consumers devices */
+	for (i = 0; i < init_data->num_consumer_supplies; i++) {
+		ret = set_consumer_device_supply(rdev,
+			init_data->consumer_supplies[i].dev,
+			init_data->consumer_supplies[i].supply);
+		if (ret < 0) {
+			for (--i; i >= 0; i--)
+				unset_consumer_device_supply(rdev,
+					init_data->consumer_supplies[i].dev);
+			goto err_supply;
+		}
 	}
 
-	/* calc total requested load for this regulator */
-	list_for_each_entry(consumer, &rdev->consumer_list, list)
-	    total_uA_load += consumer->uA_load;
-
-	mode = rdev->desc->ops->get_optimum_mode(rdev,
-						 input_uV, output_uV,
-						 total_uA_load);
-	if (ret <= 0) {
-		printk(KERN_ERR "%s: failed to get optimum mode for %s @"
-			" %d uA %d -> %d uV\n", __func__, rdev->desc->name,
-			total_uA_load, input_uV, output_uV);
-		goto out;
+	/* join in with the profile already in use */
+	if (regulator_profile != REGULATOR_PROFILE_DEFAULT) {
+		regulator_lock(rdev);
+		regulator_apply_profile(rdev, regulator_profile);
+		regulator_unlock(rdev);
 	}
 
-	ret = rdev->desc->ops->set_mode(rdev, mode);
-	if (ret <= 0) {
-		printk(KERN_ERR "%s: failed to set optimum mode %x for %s\n",
-			__func__, mode, rdev->desc->name);
-		goto out;
+	list_add_rcu(&rdev->list, &regulator_list);
+	if (rdev->init_pending)
+		list_add_tail(&rdev->init_list, &regulator_init_list);
+	regulator_resolve_children(rdev);
+	regulator_resolve_coupled(rdev);
+	mutex_unlock(&regulator_list_mutex);
+	return rdev;
+
+err_supply:
+	if (rdev->supply) {
+		mutex_lock(&rdev->supply->domain->lock);
+		list_del_rcu(&rdev->slist);
+		mutex_unlock(&rdev->supply->domain->lock);
+		synchronize_srcu(&regulator_list_srcu);
+		sysfs_remove_link(&rdev->dev.kobj, "supply");
 	}
-	ret = mode;
-out:
-	mutex_unlock(&rdev->mutex);
-	return ret;
+err_unlock:
+	regulator_domain_put(rdev->domain);
+	mutex_unlock(&regulator_list_mutex);
+	regulator_leds_remove(rdev);
+	regulator_fail_remove(rdev);
+	if (!regulator_desc->fixed_uV)
+		sysfs_remove_group(&rdev->dev.kobj, &regulator_stats_group);
+	regulator_remove_attrs(rdev);
+	/* the release function frees rdev */
+	device_unregister(&rdev->dev);
+	return ERR_PTR(ret);
+err:
+	kfree(rdev->history);
+	kfree(rdev);
+	return ERR_PTR(ret);
 }
-EXPORT_SYMBOL_GPL(regulator_set_optimum_mode);
+EXPORT_SYMBOL_GPL(regulator_register);
 
 /**
- * regulator_register_notifier - register regulator event notifier
+ * regulator_unregister - unregister regulator
  * @regulator: regulator source
- * @notifier_block: notifier block
  *
- * Register notifier block to receive regulator events.
+ * Called by regulator drivers to unregister a regulator.
  */
-int regulator_register_notifier(struct regulator *regulator,
-			      struct notifier_block *nb)
+void regulator_unregister(struct regulator_dev *rdev)
 {
-	return blocking_notifier_chain_register(&regulator->rdev->notifier,
-						nb);
-}
-EXPORT_SYMBOL_GPL(regulator_register_notifier);
+	struct regulator_dev *child;
+	struct regulator_fault_irq *fault, *next;
+	LIST_HEAD(fault_irqs);
 
-/**
- * regulator_unregister_notifier - unregister regulator event notifier
- * @regulator: regulator source
- * @notifier_block: notifier block
- *
- * Unregister regulator event notifier block.
- */
-int regulator_unregister_notifier(struct regulator *regulator,
-				struct notifier_block *nb)
-{
-	return blocking_notifier_chain_unregister(&regulator->rdev->notifier,
-						  nb);
-}
-EXPORT_SYMBOL_GPL(regulator_unregister_notifier);
+	if (rdev == NULL)
+		return;
 
-/* notify regulator consumers and downstream regulator consumers */
-static void _notifier_call_chain(struct regulator_dev *rdev,
-				  unsigned long event, void *data)
-{
-	struct regulator_dev *_rdev;
+	regulator_lock(rdev);
+	list_splice_init(&rdev->fault_irqs, &fault_irqs);
+	regulator_unlock(rdev);
+	list_for_each_entry_safe(fault, next, &fault_irqs, list) {
+		list_del(&fault->list);
+		regulator_fault_irq_release(fault);
+	}
 
-	/* call rdev chain first */
-	mutex_lock(&rdev->mutex);
-	blocking_notifier_call_chain(&rdev->notifier, event, NULL);
-	mutex_unlock(&rdev->mutex);
+	mutex_lock(&regulator_list_mutex);
+	unset_regulator_supplies(rdev);
+	list_del_rcu(&rdev->list);
+	list_del_init(&rdev->init_list);
+	if (rdev->coupled) {
+		mutex_lock(&regulator_coupled_mutex);
+		rdev->coupled->coupled = NULL;
+		rdev->coupled = NULL;
+		mutex_unlock(&regulator_coupled_mutex);
+	}
+	if (rdev->supply) {
+		/* our load no longer counts against the supply */
+		regulator_lock(rdev->supply);
+		rdev->supply->child_uA -= rdev->supply_uA;
+		rdev->supply_uA = 0;
+		drms_uA_update(rdev->supply);
+		regulator_energy_update(rdev->supply);
+		regulator_unlock(rdev->supply);
+		mutex_lock(&rdev->supply->domain->lock);
+		list_del_rcu(&rdev->slist);
+		mutex_unlock(&rdev->supply->domain->lock);
+		sysfs_remove_link(&rdev->dev.kobj, "supply");
+	}
 
-	/* now notify regulator we supply */
-	list_for_each_entry(_rdev, &rdev->supply_list, slist)
-		_notifier_call_chain(_rdev, event, data);
+	/* Anything we supply waits for us to be registered again.  Domain
+	 * locks nest inside everything else so each child is unlinked
+	 * under it on its own; SRCU readers may be walking the list, so
+	 * it can't be spliced away.  Children can't come or go meanwhile
+	 * as that needs regulator_list_mutex.
+	 */
+	for (;;) {
+		mutex_lock(&rdev->domain->lock);
+		if (list_empty(&rdev->supply_list)) {
+			mutex_unlock(&rdev->domain->lock);
+			break;
+		}
+		child = list_first_entry(&rdev->supply_list,
+					 struct regulator_dev, slist);
+		list_del_rcu(&child->slist);
+		mutex_unlock(&rdev->domain->lock);
+
+		sysfs_remove_link(&child->dev.kobj, "supply");
+		regulator_lock(child);
+		child->supply = NULL;
+		child->supply_uA = 0;
+		child->supply_dev = rdev->dev.parent;
+		regulator_unlock(child);
+		regulator_set_depth(child, 0);
+	}
+
+	/* readers may still be looking at us or at the links we removed */
+	synchronize_srcu(&regulator_list_srcu);
+
+	/* Only now that nothing can find us can the works be stopped for
+	 * good: readers reselecting modes re-arm drms_work and our
+	 * supply's events queue event_work.  Event delivery takes domain
+	 * locks so must finish outside them.
+	 */
+	cancel_work_sync(&rdev->event_work);
+	cancel_delayed_work_sync(&rdev->drms_work);
+	cancel_delayed_work_sync(&rdev->fault_work);
+
+	regulator_leds_remove(rdev);
+	regulator_fail_remove(rdev);
+	if (!rdev->desc->fixed_uV)
+		sysfs_remove_group(&rdev->dev.kobj, &regulator_stats_group);
+	regulator_remove_attrs(rdev);
+	regulator_domain_put(rdev->domain);
+	device_unregister(&rdev->dev);
+	mutex_unlock(&regulator_list_mutex);
 }
+EXPORT_SYMBOL_GPL(regulator_unregister);
 
 /**
- * regulator_bulk_get - get multiple regulator consumers
- *
- * @dev:           Device to supply
- * @num_consumers: Number of consumers to register
- * @consumers:     Configuration of consumers; clients are stored here.
- *
- * @return 0 on success, an errno on failure.
+ * regulator_set_profile - switch every regulator to a constraint profile
+ * @profile: REGULATOR_PROFILE_*
  *
- * This helper function allows drivers to get several regulator
- * consumers in one operation.  If any of the regulators cannot be
- * acquired then any regulators that were allocated will be freed
- * before returning to the caller.
+ * Each regulator with constraints for @profile in its init data moves to
+ * them, the others go back to their normal constraints, in a single pass
+ * made with the regulator list locked.  Operating modes are chosen again
+ * under the new constraints; voltages and current limits are kept, the
+ * new limits apply to later requests.
  */
-int regulator_bulk_get(struct device *dev, int num_consumers,
-		       struct regulator_bulk_data *consumers)
+int regulator_set_profile(int profile)
 {
-	int i;
-	int ret;
+	struct regulator_dev *rdev;
 
-	for (i = 0; i < num_consumers; i++)
-		consumers[i].consumer = NULL;
+	if (profile < 0 || profile >= REGULATOR_NUM_PROFILES)
+		return -EINVAL;
 
-	for (i = 0; i < num_consumers; i++) {
-		consumers[i].consumer = regulator_get(dev,
-						      consumers[i].supply);
-		if (IS_ERR(consumers[i].consumer)) {
-			dev_err(dev, "Failed to get supply '%s'\n",
-				consumers[i].supply);
-			ret = PTR_ERR(consumers[i].consumer);
-			consumers[i].consumer = NULL;
-			goto err;
+	mutex_lock(&regulator_list_mutex);
+
+	if (profile != regulator_profile) {
+		regulator_profile = profile;
+
+		list_for_each_entry(rdev, &regulator_list, list) {
+			regulator_lock(rdev);
+			regulator_apply_profile(rdev, profile);
+			regulator_unlock(rdev);
 		}
 	}
 
-	return 0;
-
-err:
-	for (i = 0; i < num_consumers && consumers[i].consumer; i++)
-		regulator_put(consumers[i].consumer);
+	mutex_unlock(&regulator_list_mutex);
 
-	return ret;
+	return 0;
 }
-EXPORT_SYMBOL_GPL(regulator_bulk_get);
+EXPORT_SYMBOL_GPL(regulator_set_profile);
 
-/**
- * regulator_bulk_enable - enable multiple regulator consumers
- *
- * @num_consumers: Number of consumers
- * @consumers:     Consumer data; clients are stored here.
- * @return         0 on success, an errno on failure
- *
- * This convenience API allows consumers to enable multiple regulator
- * clients in a single API call.  If any consumers cannot be enabled
- * then any others that were enabled will be disabled again prior to
- * return.
- */
-int regulator_bulk_enable(int num_consumers,
-			  struct regulator_bulk_data *consumers)
+/* regulators passed to the same set_suspend_states() call */
+static int suspend_same_batch(struct regulator_dev *a, struct regulator_dev *b)
 {
-	int i;
-	int ret;
+	return a->desc->ops->set_suspend_states ==
+		b->desc->ops->set_suspend_states &&
+		a->reg_data == b->reg_data;
+}
 
-	for (i = 0; i < num_consumers; i++) {
-		ret = regulator_enable(consumers[i].consumer);
-		if (ret != 0)
-			goto err;
+/* was rdev already handled along with an earlier regulator */
+static int suspend_batched(struct regulator_dev *rdev, suspend_state_t state)
+{
+	struct regulator_dev *r;
+
+	list_for_each_entry_rcu(r, &regulator_list, list) {
+		if (r == rdev)
+			break;
+		if (suspend_same_batch(r, rdev) &&
+		    suspend_state_needed(r, state))
+			return 1;
 	}
-
 	return 0;
+}
 
-err:
-	printk(KERN_ERR "Failed to enable %s\n", consumers[i].supply);
-	for (i = 0; i < num_consumers; i++)
-		regulator_disable(consumers[i].consumer);
+/*
+ * Hand the suspend state of first and every later regulator sharing its
+ * driver data to the driver in one call.  The rdev locks are not taken,
+ * the suspend configuration is only otherwise written as a regulator
+ * is registered, before it is visible to anyone else.  At most max
+ * regulators are passed, any registered since they were counted are
+ * left alone.  regulator_list_srcu held.
+ */
+static int suspend_prepare_batch(struct regulator_dev *first,
+				 suspend_state_t state,
+				 struct regulator_dev **rdevs,
+				 struct regulator_state **rstates, int max)
+{
+	struct regulator_dev *rdev;
+	int n = 0;
+
+	for (rdev = first; &rdev->list != &regulator_list && n < max;
+	     rdev = list_entry(rcu_dereference(rdev->list.next),
+			       struct regulator_dev, list)) {
+		if (!suspend_same_batch(first, rdev) ||
+		    !suspend_state_needed(rdev, state))
+			continue;
+		rstates[n] = suspend_state(rdev, state);
+		if (rstates[n]->enabled && rstates[n]->disabled)
+			return -EINVAL;
+		rdevs[n++] = rdev;
+	}
 
-	return ret;
+	return first->desc->ops->set_suspend_states(rdevs, rstates, n);
 }
-EXPORT_SYMBOL_GPL(regulator_bulk_enable);
 
 /**
- * regulator_bulk_disable - disable multiple regulator consumers
- *
- * @num_consumers: Number of consumers
- * @consumers:     Consumer data; clients are stored here.
- * @return         0 on success, an errno on failure
+ * regulator_suspend_prepare: prepare regulators for system wide suspend
+ * @state: system suspend state
  *
- * This convenience API allows consumers to disable multiple regulator
- * clients in a single API call.  If any consumers cannot be enabled
- * then any others that were disabled will be disabled again prior to
- * return.
+ * Configure each regulator with it's suspend operating parameters for state.
+ * This is called by the PM core before devices are suspended.  Regulators
+ * whose driver provides set_suspend_states() are configured together, one
+ * call for each device; regulators with no suspend control, or with no
+ * configuration for @state in their constraints, are left alone.
+ * Regulators which were configured are resynchronised with the state the
+ * core last programmed as they resume.  A regulator which can't be
+ * configured doesn't stop the others, the first error is returned.
  */
-int regulator_bulk_disable(int num_consumers,
-			   struct regulator_bulk_data *consumers)
+int regulator_suspend_prepare(suspend_state_t state)
 {
-	int i;
-	int ret;
+	struct regulator_dev *rdev, **rdevs = NULL;
+	struct regulator_state **rstates = NULL;
+	int ret = 0, err, n = 0, idx;
 
-	for (i = 0; i < num_consumers; i++) {
-		ret = regulator_disable(consumers[i].consumer);
-		if (ret != 0)
-			goto err;
+	/* ON is handled by regulator active state */
+	if (state == PM_SUSPEND_ON)
+		return -EINVAL;
+
+	idx = srcu_read_lock(&regulator_list_srcu);
+
+	list_for_each_entry_rcu(rdev, &regulator_list, list)
+		n++;
+	rdevs = kcalloc(n, sizeof(*rdevs), GFP_KERNEL);
+	rstates = kcalloc(n, sizeof(*rstates), GFP_KERNEL);
+	if (n && (!rdevs || !rstates)) {
+		ret = -ENOMEM;
+		goto out;
 	}
 
-	return 0;
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
 
-err:
-	printk(KERN_ERR "Failed to disable %s\n", consumers[i].supply);
-	for (i = 0; i < num_consumers; i++)
-		regulator_enable(consumers[i].consumer);
+		struct regulator_ops *ops = rdev->desc->ops;
+
+		/* fixed regulators have nothing to configure */
+		if (rdev->desc->fixed_uV)
+			continue;
+
+		if (!ops->set_suspend_states &&
+		    (!ops->set_suspend_enable || !ops->set_suspend_disable))
+			continue;
+
+		/* rails the target state doesn't mention aren't touched */
+		if (!suspend_state_needed(rdev, state))
+			continue;
+
+		rdev->suspend_prepared = 1;
 
+		if (ops->set_suspend_states) {
+			if (suspend_batched(rdev, state))
+				continue;
+			err = suspend_prepare_batch(rdev, state, rdevs, rstates,
+						    n);
+		} else {
+			regulator_lock(rdev);
+			err = suspend_prepare(rdev, state);
+			regulator_unlock(rdev);
+		}
+
+		/* one bad rail shouldn't leave the others unconfigured */
+		if (err < 0) {
+			printk(KERN_ERR "%s: failed to prepare %s\n",
+				__func__, rdev->desc->name);
+			if (!ret)
+				ret = err;
+		}
+	}
+out:
+	srcu_read_unlock(&regulator_list_srcu, idx);
+	kfree(rdevs);
+	kfree(rstates);
 	return ret;
 }
-EXPORT_SYMBOL_GPL(regulator_bulk_disable);
+EXPORT_SYMBOL_GPL(regulator_suspend_prepare);
 
-/**
- * regulator_bulk_free - free multiple regulator consumers
- *
- * @num_consumers: Number of consumers
- * @consumers:     Consumer data; clients are stored here.
- *
- * This convenience API allows consumers to free multiple regulator
- * clients in a single API call.
- */
-void regulator_bulk_free(int num_consumers,
-			 struct regulator_bulk_data *consumers)
-{
-	int i;
+struct regulator_sequence_work {
+	struct work_struct work;
+	struct regulator_dev *rdev;
+	int enable;
+	int changed;	/* the output was switched */
+	int ret;
+	struct completion done;
+};
 
-	for (i = 0; i < num_consumers; i++) {
-		regulator_put(consumers[i].consumer);
-		consumers[i].consumer = NULL;
+static void regulator_sequence_one(struct regulator_sequence_work *seq)
+{
+	struct regulator_dev *rdev = seq->rdev;
+	int was_on;
+
+	regulator_lock(rdev);
+
+	was_on = rdev->use_count > 0 || rdev->enabled_state == 1;
+	seq->ret = 0;
+
+	if (seq->enable && !rdev->seq_enabled) {
+		seq->ret = _regulator_enable(rdev);
+		if (seq->ret == 0)
+			rdev->seq_enabled = 1;
+	} else if (!seq->enable && rdev->seq_enabled) {
+		seq->ret = _regulator_disable(rdev);
+		if (seq->ret == 0)
+			rdev->seq_enabled = 0;
 	}
+
+	seq->changed = was_on != (rdev->use_count > 0);
+	regulator_energy_update(rdev);
+	regulator_unlock(rdev);
 }
-EXPORT_SYMBOL_GPL(regulator_bulk_free);
 
-/**
- * regulator_notifier_call_chain - call regulator event notifier
- * @regulator: regulator source
- * @event: notifier block
- * @data:
- *
- * Called by regulator drivers to notify clients a regulator event has
- * occurred. We also notify regulator clients downstream.
- */
-int regulator_notifier_call_chain(struct regulator_dev *rdev,
-				  unsigned long event, void *data)
+static void regulator_sequence_work(struct work_struct *work)
 {
-	_notifier_call_chain(rdev, event, data);
-	return NOTIFY_DONE;
+	struct regulator_sequence_work *seq =
+		container_of(work, struct regulator_sequence_work, work);
 
+	regulator_sequence_one(seq);
+	complete(&seq->done);
 }
-EXPORT_SYMBOL_GPL(regulator_notifier_call_chain);
 
-/**
- * regulator_register - register regulator
- * @regulator: regulator source
- * @reg_data: private regulator data
- *
- * Called by regulator drivers to register a regulator.
- * Returns 0 on success.
- */
-struct regulator_dev *regulator_register(struct regulator_desc *regulator_desc,
-	struct device *dev, void *driver_data)
+/* the step after step when going up, before it when going down, 0 when
+ * there are none left; regulator_list_srcu read lock held */
+static int regulator_sequence_next(int step, int up)
 {
-	static atomic_t regulator_no = ATOMIC_INIT(0);
 	struct regulator_dev *rdev;
-	struct regulator_init_data *init_data = dev->platform_data;
-	int ret, i;
-
-	if (regulator_desc == NULL)
-		return ERR_PTR(-EINVAL);
-
-	if (regulator_desc->name == NULL || regulator_desc->ops == NULL)
-		return ERR_PTR(-EINVAL);
-
-	if (!regulator_desc->type == REGULATOR_VOLTAGE &&
-	    !regulator_desc->type == REGULATOR_CURRENT)
-		return ERR_PTR(-EINVAL);
+	int s, next = 0;
+
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
+		s = rdev->sequence.step;
+		if (s <= 0)
+			continue;
+		if (up && s > step && (!next || s < next))
+			next = s;
+		if (!up && s < step && s > next)
+			next = s;
+	}
 
-	if (!init_data)
-		return ERR_PTR(-EINVAL);
+	return next;
+}
 
-	rdev = kzalloc(sizeof(struct regulator_dev), GFP_KERNEL);
-	if (rdev == NULL)
-		return ERR_PTR(-ENOMEM);
+/* Switch all the regulators in a step in parallel then wait for the
+ * step's delay if anything changed.  The list is only walked under the
+ * regulator_list_srcu read lock, held by the caller, since the work
+ * waited for on regulator_parallel_wq may need regulator_list_mutex.
+ */
+static int regulator_sequence_run(int step, int enable)
+{
+	struct regulator_sequence_work *seq;
+	struct regulator_dev *rdev;
+	unsigned int delay_ms = 0;
+	int i, cpu, n = 0, changed = 0, ret = 0;
 
-	mutex_lock(&regulator_list_mutex);
+	list_for_each_entry_rcu(rdev, &regulator_list, list)
+		if (rdev->sequence.step == step)
+			n++;
+	if (!n)
+		return 0;
 
-	mutex_init(&rdev->mutex);
-	rdev->reg_data = driver_data;
-	rdev->owner = regulator_desc->owner;
-	rdev->desc = regulator_desc;
-	INIT_LIST_HEAD(&rdev->consumer_list);
-	INIT_LIST_HEAD(&rdev->supply_list);
-	INIT_LIST_HEAD(&rdev->list);
-	INIT_LIST_HEAD(&rdev->slist);
-	BLOCKING_INIT_NOTIFIER_HEAD(&rdev->notifier);
+	seq = kcalloc(n, sizeof(*seq), GFP_KERNEL);
+	if (seq == NULL)
+		return -ENOMEM;
 
-	/* preform any regulator specific init */
-	if (init_data->regulator_init) {
-		ret = init_data->regulator_init(rdev->reg_data);
-		if (ret < 0) {
-			kfree(rdev);
-			rdev = ERR_PTR(ret);
-			goto out;
-		}
+	/* regulators may have been added since they were counted */
+	i = 0;
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
+		if (rdev->sequence.step != step)
+			continue;
+		if (i == n)
+			break;
+		seq[i].rdev = rdev;
+		seq[i].enable = enable;
+		if (rdev->sequence.delay_ms > delay_ms)
+			delay_ms = rdev->sequence.delay_ms;
+		i++;
 	}
-
-	/* set regulator constraints */
-	ret = set_machine_constraints(rdev, &init_data->constraints);
-	if (ret < 0) {
-		kfree(rdev);
-		rdev = ERR_PTR(ret);
-		goto out;
+	n = i;
+	if (!n) {
+		kfree(seq);
+		return 0;
 	}
 
-	/* register with sysfs */
-	rdev->dev.class = &regulator_class;
-	rdev->dev.parent = dev;
-	snprintf(rdev->dev.bus_id, sizeof(rdev->dev.bus_id),
-		 "regulator.%d", atomic_inc_return(&regulator_no) - 1);
-	ret = device_register(&rdev->dev);
-	if (ret != 0) {
-		kfree(rdev);
-		rdev = ERR_PTR(ret);
-		goto out;
+	get_online_cpus();
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < n; i++) {
+		init_completion(&seq[i].done);
+		if (regulator_parallel_wq) {
+			INIT_WORK(&seq[i].work, regulator_sequence_work);
+			cpu = regulator_queue_parallel(cpu, &seq[i].work);
+		} else {
+			regulator_sequence_one(&seq[i]);
+			complete(&seq[i].done);
+		}
 	}
 
-	dev_set_drvdata(&rdev->dev, rdev);
+	regulator_sequence_one(&seq[0]);
 
-	/* set supply regulator if it exists */
-	if (init_data->supply_regulator_dev) {
-		ret = set_supply(rdev,
-			dev_get_drvdata(init_data->supply_regulator_dev));
-		if (ret < 0) {
-			device_unregister(&rdev->dev);
-			kfree(rdev);
-			rdev = ERR_PTR(ret);
-			goto out;
-		}
-	}
+	for (i = 1; i < n; i++)
+		wait_for_completion(&seq[i].done);
+	put_online_cpus();
 
-	/* add consumers devices */
-	for (i = 0; i < init_data->num_consumer_supplies; i++) {
-		ret = set_consumer_device_supply(rdev,
-			init_data->consumer_supplies[i].dev,
-			init_data->consumer_supplies[i].supply);
-		if (ret < 0) {
-			for (--i; i >= 0; i--)
-				unset_consumer_device_supply(rdev,
-					init_data->consumer_supplies[i].dev);
-			device_unregister(&rdev->dev);
-			kfree(rdev);
-			rdev = ERR_PTR(ret);
-			goto out;
+	for (i = 0; i < n; i++) {
+		if (seq[i].ret < 0) {
+			printk(KERN_ERR "%s: failed to %s %s: %d\n", __func__,
+			       enable ? "enable" : "disable",
+			       seq[i].rdev->desc->name, seq[i].ret);
+			if (!ret)
+				ret = seq[i].ret;
 		}
+		changed |= seq[i].changed;
 	}
 
-	list_add(&rdev->list, &regulator_list);
-out:
-	mutex_unlock(&regulator_list_mutex);
-	return rdev;
+	kfree(seq);
+
+	if (changed && delay_ms)
+		msleep(delay_ms);
+
+	return ret;
 }
-EXPORT_SYMBOL_GPL(regulator_register);
 
 /**
- * regulator_unregister - unregister regulator
- * @regulator: regulator source
+ * regulator_sequence_power_up - run the machine power up sequence
  *
- * Called by regulator drivers to unregister a regulator.
+ * Enables the regulators given a sequence step in their init data, all
+ * the regulators in each step together and the steps in order, waiting
+ * at least the delay for each step before starting the next one.  The
+ * delay is skipped for steps where all the regulators were already on,
+ * for example having been powered by a hardware sequencer.  Stops at the
+ * first step which fails.
  */
-void regulator_unregister(struct regulator_dev *rdev)
+int regulator_sequence_power_up(void)
 {
-	if (rdev == NULL)
-		return;
+	int step = 0, ret = 0, idx;
 
-	mutex_lock(&regulator_list_mutex);
-	list_del(&rdev->list);
-	if (rdev->supply)
-		sysfs_remove_link(&rdev->dev.kobj, "supply");
-	device_unregister(&rdev->dev);
-	mutex_unlock(&regulator_list_mutex);
+	idx = srcu_read_lock(&regulator_list_srcu);
+	while (ret == 0 && (step = regulator_sequence_next(step, 1)) > 0)
+		ret = regulator_sequence_run(step, 1);
+	srcu_read_unlock(&regulator_list_srcu, idx);
+
+	return ret;
 }
-EXPORT_SYMBOL_GPL(regulator_unregister);
+EXPORT_SYMBOL_GPL(regulator_sequence_power_up);
 
 /**
- * regulator_suspend_prepare: prepare regulators for system wide suspend
- * @state: system suspend state
+ * regulator_sequence_power_down - run the machine power down sequence
  *
- * Configure each regulator with it's suspend operating parameters for state.
- * This will usually be called by machine suspend code prior to supending.
+ * Drops the references taken by regulator_sequence_power_up() in the
+ * reverse order, so regulators still used by consumers stay on.  Carries
+ * on through failures, returning the first error.
  */
-int regulator_suspend_prepare(suspend_state_t state)
+int regulator_sequence_power_down(void)
 {
-	struct regulator_dev *rdev;
-	int ret = 0;
+	int step = INT_MAX, ret = 0, err, idx;
 
-	/* ON is handled by regulator active state */
-	if (state == PM_SUSPEND_ON)
+	idx = srcu_read_lock(&regulator_list_srcu);
+	while ((step = regulator_sequence_next(step, 0)) > 0) {
+		err = regulator_sequence_run(step, 0);
+		if (err && !ret)
+			ret = err;
+	}
+	srcu_read_unlock(&regulator_list_srcu, idx);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_sequence_power_down);
+
+/**
+ * regulator_mode_table_lookup - find the optimum mode in a mode table
+ * @table: table of modes, in order of increasing load
+ * @n_entries: number of entries in @table
+ * @input_uV: input voltage of the regulator
+ * @load_uA: total load on the regulator output
+ *
+ * Returns the mode of the first entry in the table which covers the load
+ * at this input voltage, or the mode of the last entry if the load is
+ * beyond the table.  Returns 0 for an empty table.
+ */
+unsigned int
+regulator_mode_table_lookup(const struct regulator_mode_table *table,
+			    int n_entries, int input_uV, int load_uA)
+{
+	int i;
+
+	if (!table || n_entries <= 0)
+		return 0;
+
+	for (i = 0; i < n_entries; i++) {
+		if (input_uV < table[i].min_input_uV)
+			continue;
+		if (load_uA <= table[i].max_uA)
+			return table[i].mode;
+	}
+
+	return table[n_entries - 1].mode;
+}
+EXPORT_SYMBOL_GPL(regulator_mode_table_lookup);
+
+/**
+ * regulator_list_voltage_linear - list voltages with a simple step
+ * @rdev: regulator to operate on
+ * @selector: selector to convert
+ *
+ * Regulators with a simple linear mapping between voltages and selectors
+ * can set min_uV, uV_step and n_voltages in their descriptor and use
+ * this as their list_voltage() operation.
+ */
+int regulator_list_voltage_linear(struct regulator_dev *rdev,
+				  unsigned int selector)
+{
+	if (selector >= rdev->desc->n_voltages)
 		return -EINVAL;
 
-	mutex_lock(&regulator_list_mutex);
-	list_for_each_entry(rdev, &regulator_list, list) {
+	return rdev->desc->min_uV + (rdev->desc->uV_step * selector);
+}
+EXPORT_SYMBOL_GPL(regulator_list_voltage_linear);
+
+/**
+ * regulator_list_voltage_linear_range - list voltages for linear ranges
+ * @rdev: regulator to operate on
+ * @selector: selector to convert
+ *
+ * Regulators whose selectors map onto several linearly spaced blocks of
+ * voltages can describe them with linear_ranges and n_linear_ranges in
+ * their descriptor and use this as their list_voltage() operation.
+ */
+int regulator_list_voltage_linear_range(struct regulator_dev *rdev,
+					unsigned int selector)
+{
+	const struct regulator_linear_range *range;
+	int i;
 
-		mutex_lock(&rdev->mutex);
-		ret = suspend_prepare(rdev, state);
-		mutex_unlock(&rdev->mutex);
+	for (i = 0; i < rdev->desc->n_linear_ranges; i++) {
+		range = &rdev->desc->linear_ranges[i];
 
-		if (ret < 0) {
-			printk(KERN_ERR "%s: failed to prepare %s\n",
-				__func__, rdev->desc->name);
-			goto out;
-		}
+		if (selector >= range->min_sel && selector <= range->max_sel)
+			return range->min_uV +
+				(range->uV_step * (selector - range->min_sel));
 	}
-out:
-	mutex_unlock(&regulator_list_mutex);
-	return ret;
+
+	return -EINVAL;
 }
-EXPORT_SYMBOL_GPL(regulator_suspend_prepare);
+EXPORT_SYMBOL_GPL(regulator_list_voltage_linear_range);
 
 /**
  * rdev_get_drvdata - get rdev regulator driver data
@@ -1939,11 +6727,399 @@ void *regulator_get_init_drvdata(struct regulator_init_data *reg_init_data)
 }
 EXPORT_SYMBOL_GPL(regulator_get_init_drvdata);
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *regulator_debugfs_root;
+
+static const char *regulator_mode_name(unsigned int mode)
+{
+	switch (mode) {
+	case REGULATOR_MODE_FAST:
+		return "fast";
+	case REGULATOR_MODE_NORMAL:
+		return "normal";
+	case REGULATOR_MODE_IDLE:
+		return "idle";
+	case REGULATOR_MODE_STANDBY:
+		return "standby";
+	}
+	return "unknown";
+}
+
+/* print rdev and everything it supplies using only state the core has
+ * cached, so reading the summary never touches the hardware */
+static void regulator_summary_show_one(struct seq_file *s,
+				       struct regulator_dev *rdev, int depth)
+{
+	struct regulation_constraints *c = rdev->constraints;
+	struct regulator_dev *child;
+	struct regulator *consumer;
+
+	regulator_lock(rdev);
+
+	seq_printf(s, "%*s%s: use %d %s", depth * 2, "", rdev->desc->name,
+		   rdev->use_count,
+		   rdev->enabled_state < 0 ? "unknown" :
+		   rdev->enabled_state ? "enabled" : "disabled");
+	if (rdev->cached_uV > 0)
+		seq_printf(s, " %duV", rdev->cached_uV);
+	if (rdev->mode)
+		seq_printf(s, " %s", regulator_mode_name(rdev->mode));
+	seq_printf(s, " load %duA supply %duA\n",
+		   _regulator_get_load(rdev), rdev->supply_uA);
+
+	if (c)
+		seq_printf(s, "%*s  constraints: %d-%duV %d-%duA modes 0x%x "
+			   "ops 0x%x%s%s\n", depth * 2, "",
+			   c->min_uV, c->max_uV, c->min_uA, c->max_uA,
+			   c->valid_modes_mask, c->valid_ops_mask,
+			   c->always_on ? " always_on" : "",
+			   c->boot_on ? " boot_on" : "");
+
+	list_for_each_entry(consumer, &rdev->consumer_list, list)
+		seq_printf(s, "%*s  consumer %s: %s(%d) %d-%duV %duA %lluuJ\n",
+			   depth * 2, "",
+			   consumer->dev ? dev_name(consumer->dev) : "(none)",
+			   consumer->enable_count ? "enabled" : "disabled",
+			   consumer->enable_count,
+			   consumer->min_uV, consumer->max_uV,
+			   consumer->uA_load, regulator_get_energy(consumer));
+
+	regulator_unlock(rdev);
+
+	list_for_each_entry_rcu(child, &rdev->supply_list, slist)
+		regulator_summary_show_one(s, child, depth + 1);
+}
+
+static int regulator_summary_show(struct seq_file *s, void *data)
+{
+	struct regulator_dev *rdev;
+	int idx;
+
+	idx = srcu_read_lock(&regulator_list_srcu);
+
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
+		if (rdev->supply == NULL)
+			regulator_summary_show_one(s, rdev, 0);
+	}
+
+	srcu_read_unlock(&regulator_list_srcu, idx);
+
+	return 0;
+}
+
+static int regulator_summary_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, regulator_summary_show, inode->i_private);
+}
+
+static int regulator_history_show(struct seq_file *s, void *data)
+{
+	struct regulator_dev *rdev;
+	unsigned int next, read;
+	char buf[80];
+	int idx;
+
+	idx = srcu_read_lock(&regulator_list_srcu);
+
+	list_for_each_entry_rcu(rdev, &regulator_list, list) {
+		read = regulator_history_first(rdev);
+		next = ACCESS_ONCE(rdev->history_next);
+
+		seq_printf(s, "%s:\n", rdev->desc->name);
+		for (; read != next; read++)
+			if (regulator_history_format(rdev, read, buf,
+						     sizeof(buf)))
+				seq_printf(s, "  %s\n", buf);
+	}
+
+	srcu_read_unlock(&regulator_list_srcu, idx);
+
+	return 0;
+}
+
+static int regulator_history_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, regulator_history_show, inode->i_private);
+}
+
+static const struct file_operations regulator_history_fops = {
+	.open		= regulator_history_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.owner		= THIS_MODULE,
+};
+
+static const struct file_operations regulator_summary_fops = {
+	.open		= regulator_summary_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.owner		= THIS_MODULE,
+};
+
+#ifdef CONFIG_FAIL_REGULATOR
+static int regulator_fail_ops_open(struct inode *inode, struct file *file)
+{
+	file->private_data = inode->i_private;
+	return 0;
+}
+
+static ssize_t regulator_fail_ops_read(struct file *file,
+				       char __user *user_buf,
+				       size_t count, loff_t *ppos)
+{
+	struct regulator_dev *rdev = file->private_data;
+	unsigned int fail_ops = ACCESS_ONCE(rdev->fail_ops);
+	char buf[REGULATOR_OP_NUM * 20];
+	int i, len = 0;
+
+	for (i = 0; i < REGULATOR_OP_NUM; i++)
+		if (fail_ops & (1 << i))
+			len += snprintf(buf + len, sizeof(buf) - len, "%s ",
+					regulator_op_names[i]);
+	if (len)
+		buf[len - 1] = '\n';
+	else
+		len = snprintf(buf, sizeof(buf), "none\n");
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+/* takes operation names, "all" or "none" */
+static ssize_t regulator_fail_ops_write(struct file *file,
+					const char __user *user_buf,
+					size_t count, loff_t *ppos)
+{
+	struct regulator_dev *rdev = file->private_data;
+	char buf[REGULATOR_OP_NUM * 20], *p, *name;
+	size_t len = min(count, sizeof(buf) - 1);
+	unsigned int mask = 0;
+	int i;
+
+	if (copy_from_user(buf, user_buf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	p = buf;
+	while ((name = strsep(&p, " \t\n")) != NULL) {
+		if (!*name || strcmp(name, "none") == 0)
+			continue;
+		if (strcmp(name, "all") == 0) {
+			mask = ((1 << REGULATOR_OP_NUM) - 1) &
+				~(1 << REGULATOR_OP_GET_MODE);
+			continue;
+		}
+
+		for (i = 0; i < REGULATOR_OP_NUM; i++)
+			if (strcmp(name, regulator_op_names[i]) == 0)
+				break;
+		if (i == REGULATOR_OP_NUM || i == REGULATOR_OP_GET_MODE)
+			return -EINVAL;
+		mask |= 1 << i;
+	}
+
+	rdev->fail_ops = mask;
+
+	return count;
+}
+
+static const struct file_operations regulator_fail_ops_fops = {
+	.open		= regulator_fail_ops_open,
+	.read		= regulator_fail_ops_read,
+	.write		= regulator_fail_ops_write,
+	.owner		= THIS_MODULE,
+};
+
+/* per regulator selection of the operations fail_regulator applies to */
+static void regulator_fail_add(struct regulator_dev *rdev)
+{
+	if (!regulator_debugfs_root)
+		return;
+
+	rdev->fail_dir = debugfs_create_dir(rdev->desc->name,
+					    regulator_debugfs_root);
+	if (IS_ERR(rdev->fail_dir) || !rdev->fail_dir) {
+		printk(KERN_WARNING "%s: failed to create debugfs for %s\n",
+		       __func__, rdev->desc->name);
+		rdev->fail_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("fail_ops", 0600, rdev->fail_dir, rdev,
+			    &regulator_fail_ops_fops);
+}
+
+static void regulator_fail_remove(struct regulator_dev *rdev)
+{
+	debugfs_remove_recursive(rdev->fail_dir);
+	rdev->fail_dir = NULL;
+	rdev->fail_ops = 0;
+}
+#endif /* CONFIG_FAIL_REGULATOR */
+
+static void regulator_init_debugfs(void)
+{
+	regulator_debugfs_root = debugfs_create_dir("regulator", NULL);
+	if (IS_ERR(regulator_debugfs_root) || !regulator_debugfs_root) {
+		printk(KERN_WARNING "regulator: failed to create debugfs\n");
+		regulator_debugfs_root = NULL;
+		return;
+	}
+
+	debugfs_create_file("summary", 0444, regulator_debugfs_root, NULL,
+			    &regulator_summary_fops);
+	debugfs_create_file("history", 0444, regulator_debugfs_root, NULL,
+			    &regulator_history_fops);
+
+#ifdef CONFIG_FAIL_REGULATOR
+	if (init_fault_attr_dentries(&fail_regulator, "fail_regulator"))
+		printk(KERN_WARNING "regulator: failed to create "
+		       "fail_regulator debugfs\n");
+#endif
+}
+#else
+static inline void regulator_init_debugfs(void)
+{
+}
+#endif
+
 static int __init regulator_init(void)
 {
+	int ret;
+
 	printk(KERN_INFO "regulator: core version %s\n", REGULATOR_VERSION);
-	return class_register(&regulator_class);
+
+	ret = init_srcu_struct(&regulator_list_srcu);
+	if (ret)
+		return ret;
+
+	regulator_wq = create_workqueue("kregulatord");
+	if (regulator_wq == NULL)
+		printk(KERN_WARNING "regulator: failed to create workqueue\n");
+
+	/* bulk operations fall back to running in the caller without this */
+	regulator_parallel_wq = create_workqueue("kregulator_pard");
+	if (regulator_parallel_wq == NULL)
+		printk(KERN_WARNING
+		       "regulator: failed to create parallel workqueue\n");
+
+	regulator_init_debugfs();
+
+	if (pm_qos_add_notifier(PM_QOS_CPU_DMA_LATENCY, &regulator_qos_nb))
+		printk(KERN_WARNING "regulator: failed to follow pm_qos\n");
+
+	ret = class_register(&regulator_class);
+	if (ret == 0)
+		regulator_dummy_init();
+
+	return ret;
 }
 
 /* init early to allow our consumers to complete system booting */
 core_initcall(regulator_init);
+
+/* is rdev kept on by a consumer or by a regulator it supplies */
+static int __init regulator_in_use(struct regulator_dev *rdev)
+{
+	struct regulator_dev *child;
+	struct regulator *consumer;
+	int used = 0;
+
+	mutex_lock(&rdev->config_lock);
+	list_for_each_entry(consumer, &rdev->consumer_list, list) {
+		if (consumer->enable_count) {
+			used = 1;
+			break;
+		}
+	}
+	mutex_unlock(&rdev->config_lock);
+	if (used)
+		return 1;
+
+	list_for_each_entry(child, &regulator_list, list) {
+		if (child->supply != rdev)
+			continue;
+		regulator_lock(child);
+		used = child->use_count > 0 || child->enabled_state == 1;
+		regulator_unlock(child);
+		if (used)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* disable rdev if it was left on by the bootloader without a user */
+static void __init regulator_disable_unused(struct regulator_dev *rdev)
+{
+	struct regulator_ops *ops = rdev->desc->ops;
+	int ret;
+
+	if (!rdev->constraints || rdev->constraints->always_on ||
+	    !ops->disable || regulator_in_use(rdev))
+		return;
+
+	regulator_lock(rdev);
+
+	/* only a boot_on reference may remain, anything else came from
+	 * the power sequencer or is unbalanced */
+	if (rdev->use_count > 1 || rdev->seq_enabled)
+		goto out;
+
+	if (ops->is_enabled) {
+		ret = rdev_op(rdev, REGULATOR_OP_IS_ENABLED, 0,
+			      ops->is_enabled(rdev));
+		if (ret < 0)
+			goto out;
+		rdev->enabled_state = ret > 0;
+	} else {
+		ret = rdev->use_count;
+	}
+	if (!ret)
+		goto out;
+
+	printk(KERN_INFO "regulator: disabling unused %s\n",
+	       rdev->desc->name);
+	ret = rdev_do_disable(rdev);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: failed to disable %s: %d\n",
+		       __func__, rdev->desc->name, ret);
+		goto out;
+	}
+	rdev->use_count = 0;
+out:
+	regulator_unlock(rdev);
+}
+
+/*
+ * Apply any boot constraints still deferred then turn off regulators
+ * left enabled by the bootloader which nothing has claimed by the end
+ * of boot.  Regulators are visited from the leaves
+ * of each tree towards the root so that supplies freed up by their
+ * children are also disabled.
+ */
+static int __init regulator_init_complete(void)
+{
+	struct regulator_dev *rdev;
+	int depth, max_depth = 0;
+
+	mutex_lock(&regulator_list_mutex);
+
+	/* anything registered from now on is configured straight away */
+	regulator_flush_constraints();
+	regulator_defer = 0;
+
+	list_for_each_entry(rdev, &regulator_list, list)
+		max_depth = max(max_depth, rdev->depth);
+
+	for (depth = max_depth; depth >= 0; depth--)
+		list_for_each_entry(rdev, &regulator_list, list)
+			if (rdev->depth == depth)
+				regulator_disable_unused(rdev);
+
+	mutex_unlock(&regulator_list_mutex);
+
+	return 0;
+}
+late_initcall(regulator_init_complete);
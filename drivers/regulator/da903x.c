@@ -64,6 +64,10 @@
 #define DA9034_MDTV2		(0x33)
 #define DA9034_MVRC		(0x34)
 
+/* each DVC has a second voltage register after the first, the bit after
+ * its GO bit in VCC1 selecting which of the two is in use */
+#define DA9034_DVC_SEL(info)	(1 << ((info)->update_bit + 1))
+
 struct da903x_regulator_info {
 	struct regulator_desc desc;
 
@@ -77,6 +81,7 @@ struct da903x_regulator_info {
 	int	update_bit;
 	int	enable_reg;
 	int	enable_bit;
+	int	dvc_bank;	/* DTV register in use, 0 for DTV1 */
 };
 
 static inline struct device *to_da903x_dev(struct regulator_dev *rdev)
@@ -94,26 +99,23 @@ static inline int check_range(struct da903x_regulator_info *info,
 }
 
 /* DA9030/DA9034 common operations */
-static int da903x_set_ldo_voltage(struct regulator_dev *rdev,
-				  int min_uV, int max_uV)
+static int da903x_set_voltage_sel(struct regulator_dev *rdev,
+				  unsigned selector)
 {
 	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
 	struct device *da9034_dev = to_da903x_dev(rdev);
 	uint8_t val, mask;
 
-	if (check_range(info, min_uV, max_uV)) {
-		pr_err("invalid voltage range (%d, %d) uV", min_uV, max_uV);
+	if (selector >= info->desc.n_voltages)
 		return -EINVAL;
-	}
 
-	val = (min_uV - info->min_uV + info->step_uV - 1) / info->step_uV;
-	val <<= info->vol_shift;
+	val = selector << info->vol_shift;
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
 
 	return da903x_update(da9034_dev, info->vol_reg, val, mask);
 }
 
-static int da903x_get_voltage(struct regulator_dev *rdev)
+static int da903x_get_voltage_sel(struct regulator_dev *rdev)
 {
 	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
 	struct device *da9034_dev = to_da903x_dev(rdev);
@@ -127,7 +129,7 @@ static int da903x_get_voltage(struct regulator_dev *rdev)
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
 	val = (val & mask) >> info->vol_shift;
 
-	return info->min_uV + info->step_uV * val;
+	return val;
 }
 
 static int da903x_enable(struct regulator_dev *rdev)
@@ -163,21 +165,18 @@ static int da903x_is_enabled(struct regulator_dev *rdev)
 }
 
 /* DA9030 specific operations */
-static int da9030_set_ldo1_15_voltage(struct regulator_dev *rdev,
-				       int min_uV, int max_uV)
+static int da9030_set_ldo1_15_voltage_sel(struct regulator_dev *rdev,
+					  unsigned selector)
 {
 	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
 	struct device *da903x_dev = to_da903x_dev(rdev);
 	uint8_t val, mask;
 	int ret;
 
-	if (check_range(info, min_uV, max_uV)) {
-		pr_err("invalid voltage range (%d, %d) uV", min_uV, max_uV);
+	if (selector >= info->desc.n_voltages)
 		return -EINVAL;
-	}
 
-	val = (min_uV - info->min_uV + info->step_uV - 1) / info->step_uV;
-	val <<= info->vol_shift;
+	val = selector << info->vol_shift;
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
 	val |= DA9030_LDO_UNLOCK; /* have to set UNLOCK bits */
 	mask |= DA9030_LDO_UNLOCK_MASK;
@@ -239,24 +238,22 @@ static int da9030_get_ldo14_voltage(struct regulator_dev *rdev)
 }
 
 /* DA9034 specific operations */
-static int da9034_set_dvc_voltage(struct regulator_dev *rdev,
-				  int min_uV, int max_uV)
+static int da9034_set_dvc_voltage_sel(struct regulator_dev *rdev,
+				      unsigned selector)
 {
 	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
 	struct device *da9034_dev = to_da903x_dev(rdev);
 	uint8_t val, mask;
 	int ret;
 
-	if (check_range(info, min_uV, max_uV)) {
-		pr_err("invalid voltage range (%d, %d) uV", min_uV, max_uV);
+	if (selector >= info->desc.n_voltages)
 		return -EINVAL;
-	}
 
-	val = (min_uV - info->min_uV + info->step_uV - 1) / info->step_uV;
-	val <<= info->vol_shift;
+	val = selector << info->vol_shift;
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
 
-	ret = da903x_update(da9034_dev, info->vol_reg, val, mask);
+	ret = da903x_update(da9034_dev, info->vol_reg + info->dvc_bank,
+			    val, mask);
 	if (ret)
 		return ret;
 
@@ -265,6 +262,59 @@ static int da9034_set_dvc_voltage(struct regulator_dev *rdev,
 	return ret;
 }
 
+static int da9034_get_dvc_voltage_sel(struct regulator_dev *rdev)
+{
+	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
+	struct device *da9034_dev = to_da903x_dev(rdev);
+	uint8_t val, mask;
+	int ret;
+
+	ret = da903x_read(da9034_dev, info->vol_reg + info->dvc_bank, &val);
+	if (ret)
+		return ret;
+
+	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
+	val = (val & mask) >> info->vol_shift;
+
+	return val;
+}
+
+/* load the DTV register not in use, leaving the output alone */
+static int da9034_preload_dvc_voltage_sel(struct regulator_dev *rdev,
+					  unsigned selector)
+{
+	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
+	struct device *da9034_dev = to_da903x_dev(rdev);
+	uint8_t val, mask;
+
+	if (selector >= info->desc.n_voltages)
+		return -EINVAL;
+
+	val = selector << info->vol_shift;
+	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
+
+	return da903x_update(da9034_dev, info->vol_reg + !info->dvc_bank,
+			     val, mask);
+}
+
+/* select the preloaded DTV register and kick the change in one write */
+static int da9034_switch_dvc_voltage_sel(struct regulator_dev *rdev)
+{
+	struct da903x_regulator_info *info = rdev_get_drvdata(rdev);
+	struct device *da9034_dev = to_da903x_dev(rdev);
+	uint8_t go = 1 << info->update_bit;
+	int ret;
+
+	ret = da903x_update(da9034_dev, info->update_reg,
+			    (info->dvc_bank ? 0 : DA9034_DVC_SEL(info)) | go,
+			    DA9034_DVC_SEL(info) | go);
+	if (ret)
+		return ret;
+
+	info->dvc_bank = !info->dvc_bank;
+	return 0;
+}
+
 static int da9034_set_ldo12_voltage(struct regulator_dev *rdev,
 				    int min_uV, int max_uV)
 {
@@ -306,8 +356,9 @@ static int da9034_get_ldo12_voltage(struct regulator_dev *rdev)
 }
 
 static struct regulator_ops da903x_regulator_ldo_ops = {
-	.set_voltage	= da903x_set_ldo_voltage,
-	.get_voltage	= da903x_get_voltage,
+	.list_voltage	= regulator_list_voltage_linear,
+	.set_voltage_sel = da903x_set_voltage_sel,
+	.get_voltage_sel = da903x_get_voltage_sel,
 	.enable		= da903x_enable,
 	.disable	= da903x_disable,
 	.is_enabled	= da903x_is_enabled,
@@ -324,16 +375,20 @@ static struct regulator_ops da9030_regulator_ldo14_ops = {
 
 /* NOTE: this is dedicated for the DA9030 LDO1 and LDO15 that have locks  */
 static struct regulator_ops da9030_regulator_ldo1_15_ops = {
-	.set_voltage	= da9030_set_ldo1_15_voltage,
-	.get_voltage	= da903x_get_voltage,
+	.list_voltage	= regulator_list_voltage_linear,
+	.set_voltage_sel = da9030_set_ldo1_15_voltage_sel,
+	.get_voltage_sel = da903x_get_voltage_sel,
 	.enable		= da903x_enable,
 	.disable	= da903x_disable,
 	.is_enabled	= da903x_is_enabled,
 };
 
 static struct regulator_ops da9034_regulator_dvc_ops = {
-	.set_voltage	= da9034_set_dvc_voltage,
-	.get_voltage	= da903x_get_voltage,
+	.list_voltage	= regulator_list_voltage_linear,
+	.set_voltage_sel = da9034_set_dvc_voltage_sel,
+	.get_voltage_sel = da9034_get_dvc_voltage_sel,
+	.preload_voltage_sel = da9034_preload_dvc_voltage_sel,
+	.switch_voltage_sel = da9034_switch_dvc_voltage_sel,
 	.enable		= da903x_enable,
 	.disable	= da903x_disable,
 	.is_enabled	= da903x_is_enabled,
@@ -348,6 +403,10 @@ static struct regulator_ops da9034_regulator_ldo12_ops = {
 	.is_enabled	= da903x_is_enabled,
 };
 
+/* number of selectors between min and max, fixed regulators have one */
+#define DA903x_N_VOLTAGES(min, max, step)				\
+	((step) ? ((max) - (min)) / (step) + 1 : 1)
+
 #define DA903x_LDO(_pmic, _id, min, max, step, vreg, shift, nbits, ereg, ebit)	\
 {									\
 	.desc	= {							\
@@ -356,6 +415,9 @@ static struct regulator_ops da9034_regulator_ldo12_ops = {
 		.type	= REGULATOR_VOLTAGE,				\
 		.id	= _pmic##_ID_LDO##_id,				\
 		.owner	= THIS_MODULE,					\
+		.n_voltages = DA903x_N_VOLTAGES(min, max, step),	\
+		.min_uV	= (min) * 1000,					\
+		.uV_step = (step) * 1000,				\
 	},								\
 	.min_uV		= (min) * 1000,					\
 	.max_uV		= (max) * 1000,					\
@@ -375,6 +437,9 @@ static struct regulator_ops da9034_regulator_ldo12_ops = {
 		.type	= REGULATOR_VOLTAGE,				\
 		.id	= DA9034_ID_##_id,				\
 		.owner	= THIS_MODULE,					\
+		.n_voltages = DA903x_N_VOLTAGES(min, max, step),	\
+		.min_uV	= (min) * 1000,					\
+		.uV_step = (step) * 1000,				\
 	},								\
 	.min_uV		= (min) * 1000,					\
 	.max_uV		= (max) * 1000,					\
@@ -454,6 +519,8 @@ static int __devinit da903x_regulator_probe(struct platform_device *pdev)
 {
 	struct da903x_regulator_info *ri = NULL;
 	struct regulator_dev *rdev;
+	uint8_t val;
+	int ret;
 
 	ri = find_regulator_info(pdev->id);
 	if (ri == NULL) {
@@ -471,6 +538,14 @@ static int __devinit da903x_regulator_probe(struct platform_device *pdev)
 	if (ri->desc.id == DA9030_ID_LDO1 || ri->desc.id == DA9030_ID_LDO15)
 		ri->desc.ops = &da9030_regulator_ldo1_15_ops;
 
+	/* find out which DTV register a DVC is using */
+	if (ri->desc.ops == &da9034_regulator_dvc_ops) {
+		ret = da903x_read(pdev->dev.parent, ri->update_reg, &val);
+		if (ret)
+			return ret;
+		ri->dvc_bank = !!(val & DA9034_DVC_SEL(ri));
+	}
+
 	rdev = regulator_register(&ri->desc, &pdev->dev, ri);
 	if (IS_ERR(rdev)) {
 		dev_err(&pdev->dev, "failed to register regulator %s\n",
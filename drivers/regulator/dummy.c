@@ -0,0 +1,127 @@
+/*
+ * dummy.c
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This is useful for systems which have supplies that are hardwired
+ * or otherwise not described to the regulator API: rather than every
+ * consumer needing to cope with a missing supply the core hands out
+ * this always on regulator, which does nothing.  Voltage, current limit
+ * and mode requests are accepted and ignored, though since every
+ * consumer without a supply shares it, consumers asking for voltages
+ * or current limits which don't overlap will still see an error.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/err.h>
+#include <linux/platform_device.h>
+#include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
+
+#include "dummy.h"
+
+struct regulator_dev *dummy_regulator_rdev;
+
+static struct regulator_init_data dummy_initdata = {
+	.constraints = {
+		.always_on = 1,
+		.max_uV = INT_MAX,
+		.max_uA = INT_MAX,
+		.valid_ops_mask = REGULATOR_CHANGE_VOLTAGE |
+				  REGULATOR_CHANGE_CURRENT |
+				  REGULATOR_CHANGE_MODE,
+		.valid_modes_mask = REGULATOR_MODE_FAST |
+				    REGULATOR_MODE_NORMAL |
+				    REGULATOR_MODE_IDLE |
+				    REGULATOR_MODE_STANDBY,
+	},
+};
+
+static int dummy_is_enabled(struct regulator_dev *rdev)
+{
+	return 1;
+}
+
+static int dummy_enable(struct regulator_dev *rdev)
+{
+	return 0;
+}
+
+static int dummy_set_voltage(struct regulator_dev *rdev, int min_uV,
+			     int max_uV)
+{
+	return 0;
+}
+
+static int dummy_set_current_limit(struct regulator_dev *rdev, int min_uA,
+				   int max_uA)
+{
+	return 0;
+}
+
+static int dummy_set_mode(struct regulator_dev *rdev, unsigned int mode)
+{
+	return 0;
+}
+
+/* there is nothing to configure for suspend either */
+static int dummy_set_suspend_states(struct regulator_dev **rdevs,
+				    struct regulator_state **states, int n)
+{
+	return 0;
+}
+
+static struct regulator_ops dummy_ops = {
+	.is_enabled = dummy_is_enabled,
+	.enable = dummy_enable,
+	.set_voltage = dummy_set_voltage,
+	.set_current_limit = dummy_set_current_limit,
+	.set_mode = dummy_set_mode,
+	.set_suspend_states = dummy_set_suspend_states,
+};
+
+static struct regulator_desc dummy_desc = {
+	.name = "dummy",
+	.id = -1,
+	.type = REGULATOR_VOLTAGE,
+	.ops = &dummy_ops,
+	.owner = THIS_MODULE,
+};
+
+void __init regulator_dummy_init(void)
+{
+	struct platform_device *pdev;
+	struct regulator_dev *rdev;
+	int ret;
+
+	pdev = platform_device_alloc("reg-dummy", -1);
+	if (!pdev) {
+		printk(KERN_ERR "%s: failed to allocate device\n", __func__);
+		return;
+	}
+
+	ret = platform_device_add_data(pdev, &dummy_initdata,
+				       sizeof(dummy_initdata));
+	if (ret == 0)
+		ret = platform_device_add(pdev);
+	if (ret != 0) {
+		printk(KERN_ERR "%s: failed to add device: %d\n",
+		       __func__, ret);
+		platform_device_put(pdev);
+		return;
+	}
+
+	rdev = regulator_register(&dummy_desc, &pdev->dev, NULL);
+	if (IS_ERR(rdev)) {
+		printk(KERN_ERR "%s: failed to register regulator: %ld\n",
+		       __func__, PTR_ERR(rdev));
+		platform_device_unregister(pdev);
+		return;
+	}
+
+	dummy_regulator_rdev = rdev;
+}
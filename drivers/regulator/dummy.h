@@ -0,0 +1,37 @@
+/*
+ * dummy.h
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Regulator core internal interface to the dummy regulator.
+ */
+
+#ifndef _DUMMY_H
+#define _DUMMY_H
+
+struct regulator_dev;
+
+#ifdef CONFIG_REGULATOR_DUMMY
+extern struct regulator_dev *dummy_regulator_rdev;
+
+void __init regulator_dummy_init(void);
+
+static inline struct regulator_dev *regulator_dummy(void)
+{
+	return dummy_regulator_rdev;
+}
+#else
+static inline void regulator_dummy_init(void)
+{
+}
+
+static inline struct regulator_dev *regulator_dummy(void)
+{
+	return NULL;
+}
+#endif
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * dvfs.c -- Load driven voltage and frequency scaling for devices
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * DSPs, GPUs and video accelerators need the same coupling of supply
+ * voltage to clock rate as CPUs do under cpufreq, but have no
+ * framework of their own so tend to run at a fixed worst case
+ * operating point.  This samples the load of such a device and picks
+ * an operating point for it the way the ondemand governor does for a
+ * CPU, scaling the device clock and its supplies together: supplies
+ * are raised before the clock speeds up and lowered after it slows
+ * down, so the device is never clocked faster than its voltage
+ * allows.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/clk.h>
+#include <linux/math64.h>
+#include <linux/workqueue.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator/dvfs.h>
+
+struct regulator_dvfs {
+	struct regulator_dvfs_config config;
+	struct clk *clk;
+	struct regulator_bulk_data supplies[REGULATOR_DVFS_MAX_SUPPLIES];
+
+	struct mutex lock;
+	struct delayed_work work;
+	int stopped;
+
+	int cur;		/* index of the operating point, -1 if none */
+	int min;		/* range of operating points permitted */
+	int max;		/* by regulator_dvfs_set_limits() */
+};
+
+static int regulator_dvfs_set_voltage(struct regulator_dvfs *dvfs,
+				      const struct regulator_dvfs_opp *opp)
+{
+	int i;
+
+	if (!dvfs->config.num_supplies)
+		return 0;
+
+	for (i = 0; i < dvfs->config.num_supplies; i++) {
+		dvfs->supplies[i].min_uV = opp->min_uV[i];
+		dvfs->supplies[i].max_uV = opp->max_uV[i];
+	}
+
+	/* supplies on different PMICs are moved in parallel */
+	return regulator_bulk_set_voltage(dvfs->config.num_supplies,
+					  dvfs->supplies);
+}
+
+/* dvfs->lock held by caller */
+static int regulator_dvfs_set(struct regulator_dvfs *dvfs, int idx)
+{
+	const struct regulator_dvfs_opp *new = &dvfs->config.opp[idx];
+	const struct regulator_dvfs_opp *old = NULL;
+	int ret;
+
+	if (idx == dvfs->cur)
+		return 0;
+	if (dvfs->cur >= 0)
+		old = &dvfs->config.opp[dvfs->cur];
+
+	/* the supplies must be ready for the new rate before it is used */
+	if (!old || new->rate > old->rate) {
+		ret = regulator_dvfs_set_voltage(dvfs, new);
+		if (ret < 0) {
+			printk(KERN_ERR "%s: failed to raise supplies for "
+			       "%lu Hz: %d\n", __func__, new->rate, ret);
+			return ret;
+		}
+	}
+
+	ret = clk_set_rate(dvfs->clk, new->rate);
+	if (ret < 0) {
+		/* any supplies already raised are merely wasteful */
+		printk(KERN_ERR "%s: failed to set %lu Hz: %d\n",
+		       __func__, new->rate, ret);
+		return ret;
+	}
+
+	if (old && new->rate < old->rate) {
+		ret = regulator_dvfs_set_voltage(dvfs, new);
+		if (ret < 0)
+			printk(KERN_WARNING "%s: failed to lower supplies for "
+			       "%lu Hz: %d\n", __func__, new->rate, ret);
+	}
+
+	dvfs->cur = idx;
+
+	return 0;
+}
+
+/*
+ * As ondemand: jump to the fastest operating point when busy, else
+ * step down to the slowest one which would leave the load
+ * down_differential below up_threshold.
+ */
+static int regulator_dvfs_target(struct regulator_dvfs *dvfs,
+				 unsigned int load)
+{
+	const struct regulator_dvfs_config *c = &dvfs->config;
+	unsigned int down = c->up_threshold - c->down_differential;
+	unsigned long rate;
+	int i;
+
+	if (load > c->up_threshold)
+		return dvfs->max;
+
+	if (load >= down)
+		return clamp(dvfs->cur, dvfs->min, dvfs->max);
+
+	rate = div_u64((u64)c->opp[dvfs->cur].rate * load, down);
+	for (i = dvfs->min; i < dvfs->max; i++)
+		if (c->opp[i].rate >= rate)
+			break;
+
+	return i;
+}
+
+static void regulator_dvfs_work(struct work_struct *work)
+{
+	struct regulator_dvfs *dvfs = container_of(work, struct regulator_dvfs,
+						   work.work);
+	int load, idx;
+
+	mutex_lock(&dvfs->lock);
+
+	if (dvfs->stopped)
+		goto out;
+
+	load = dvfs->config.get_load(dvfs->config.data);
+	if (load < 0) {
+		/* keep the current rate until we know better */
+		if (printk_ratelimit())
+			printk(KERN_WARNING "%s: failed to read load: %d\n",
+			       __func__, load);
+		idx = dvfs->cur;
+	} else {
+		idx = regulator_dvfs_target(dvfs, load);
+	}
+
+	regulator_dvfs_set(dvfs, idx);
+
+	schedule_delayed_work(&dvfs->work,
+			      msecs_to_jiffies(dvfs->config.period_ms));
+
+out:
+	mutex_unlock(&dvfs->lock);
+}
+
+/**
+ * regulator_dvfs_register - start load driven scaling of a device
+ * @dev: device to scale, used to look up its clock and supplies
+ * @config: scaling configuration, copied; the operating point table
+ *          must stay valid until regulator_dvfs_unregister()
+ *
+ * The device starts at its fastest operating point and each period_ms
+ * is moved according to the load reported by get_load().  The device
+ * driver still enables its supplies and clock itself but should not
+ * change their voltage or rate while scaling is running.
+ *
+ * Returns an ERR_PTR() on failure.
+ */
+struct regulator_dvfs *regulator_dvfs_register(struct device *dev,
+				const struct regulator_dvfs_config *config)
+{
+	struct regulator_dvfs *dvfs;
+	int i, ret;
+
+	if (config->num_opp <= 0 || config->get_load == NULL ||
+	    config->num_supplies < 0 ||
+	    config->num_supplies > REGULATOR_DVFS_MAX_SUPPLIES ||
+	    config->up_threshold > 100 ||
+	    config->down_differential >= config->up_threshold ||
+	    config->period_ms == 0)
+		return ERR_PTR(-EINVAL);
+
+	dvfs = kzalloc(sizeof(*dvfs), GFP_KERNEL);
+	if (dvfs == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	dvfs->config = *config;
+	dvfs->cur = -1;
+	dvfs->min = 0;
+	dvfs->max = config->num_opp - 1;
+	mutex_init(&dvfs->lock);
+	INIT_DELAYED_WORK(&dvfs->work, regulator_dvfs_work);
+
+	dvfs->clk = clk_get(dev, config->clk_id);
+	if (IS_ERR(dvfs->clk)) {
+		ret = PTR_ERR(dvfs->clk);
+		goto err;
+	}
+
+	for (i = 0; i < config->num_supplies; i++)
+		dvfs->supplies[i].supply = config->supplies[i];
+
+	if (config->num_supplies) {
+		ret = regulator_bulk_get(dev, config->num_supplies,
+					 dvfs->supplies);
+		if (ret != 0)
+			goto err_clk;
+	}
+
+	mutex_lock(&dvfs->lock);
+	ret = regulator_dvfs_set(dvfs, dvfs->max);
+	if (ret == 0)
+		schedule_delayed_work(&dvfs->work,
+				      msecs_to_jiffies(config->period_ms));
+	mutex_unlock(&dvfs->lock);
+	if (ret != 0)
+		goto err_supplies;
+
+	return dvfs;
+
+err_supplies:
+	regulator_bulk_free(config->num_supplies, dvfs->supplies);
+err_clk:
+	clk_put(dvfs->clk);
+err:
+	kfree(dvfs);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(regulator_dvfs_register);
+
+/**
+ * regulator_dvfs_unregister - stop load driven scaling of a device
+ * @dvfs: scaling to stop
+ *
+ * The device is returned to its fastest permitted operating point.
+ */
+void regulator_dvfs_unregister(struct regulator_dvfs *dvfs)
+{
+	mutex_lock(&dvfs->lock);
+	dvfs->stopped = 1;
+	mutex_unlock(&dvfs->lock);
+
+	cancel_delayed_work_sync(&dvfs->work);
+
+	mutex_lock(&dvfs->lock);
+	regulator_dvfs_set(dvfs, dvfs->max);
+	mutex_unlock(&dvfs->lock);
+
+	regulator_bulk_free(dvfs->config.num_supplies, dvfs->supplies);
+	clk_put(dvfs->clk);
+	kfree(dvfs);
+}
+EXPORT_SYMBOL_GPL(regulator_dvfs_unregister);
+
+/**
+ * regulator_dvfs_set_limits - restrict the rates scaling may choose
+ * @dvfs: scaling to update
+ * @min_rate: lowest rate to use in Hz, for example while a use case
+ *            has a throughput requirement the load can't show
+ * @max_rate: highest rate to use in Hz, for example for thermal limits
+ *
+ * The device is moved into the new range straight away if it is
+ * outside it.
+ */
+int regulator_dvfs_set_limits(struct regulator_dvfs *dvfs,
+			      unsigned long min_rate, unsigned long max_rate)
+{
+	const struct regulator_dvfs_opp *opp = dvfs->config.opp;
+	int min, max, ret;
+
+	for (min = 0; min < dvfs->config.num_opp - 1; min++)
+		if (opp[min].rate >= min_rate)
+			break;
+
+	for (max = dvfs->config.num_opp - 1; max > 0; max--)
+		if (opp[max].rate <= max_rate)
+			break;
+
+	if (min > max)
+		return -EINVAL;
+
+	mutex_lock(&dvfs->lock);
+	dvfs->min = min;
+	dvfs->max = max;
+	ret = regulator_dvfs_set(dvfs, clamp(dvfs->cur, min, max));
+	mutex_unlock(&dvfs->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regulator_dvfs_set_limits);
+
+/**
+ * regulator_dvfs_get_rate - get the rate chosen for a device
+ * @dvfs: scaling to query
+ */
+unsigned long regulator_dvfs_get_rate(struct regulator_dvfs *dvfs)
+{
+	unsigned long rate;
+
+	mutex_lock(&dvfs->lock);
+	rate = dvfs->config.opp[dvfs->cur].rate;
+	mutex_unlock(&dvfs->lock);
+
+	return rate;
+}
+EXPORT_SYMBOL_GPL(regulator_dvfs_get_rate);
+
+MODULE_DESCRIPTION("Load driven voltage and frequency scaling for devices");
+MODULE_LICENSE("GPL");
@@ -16,24 +16,49 @@
  */
 
 #include <linux/err.h>
+#include <linux/gpio.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
 #include <linux/regulator/fixed.h>
 
 struct fixed_voltage_data {
 	struct regulator_desc desc;
 	struct regulator_dev *dev;
 	int microvolts;
+	int gpio;
+	unsigned enable_high:1;
+	unsigned is_enabled:1;
 };
 
+/* the core handles fixed regulators itself, see regulator_desc.fixed_uV */
+static struct regulator_ops fixed_voltage_ops;
+
 static int fixed_voltage_is_enabled(struct regulator_dev *dev)
 {
-	return 1;
+	struct fixed_voltage_data *data = rdev_get_drvdata(dev);
+
+	return data->is_enabled;
 }
 
 static int fixed_voltage_enable(struct regulator_dev *dev)
 {
+	struct fixed_voltage_data *data = rdev_get_drvdata(dev);
+
+	gpio_set_value_cansleep(data->gpio, data->enable_high);
+	data->is_enabled = 1;
+
+	return 0;
+}
+
+static int fixed_voltage_disable(struct regulator_dev *dev)
+{
+	struct fixed_voltage_data *data = rdev_get_drvdata(dev);
+
+	gpio_set_value_cansleep(data->gpio, !data->enable_high);
+	data->is_enabled = 0;
+
 	return 0;
 }
 
@@ -44,18 +69,40 @@ static int fixed_voltage_get_voltage(struct regulator_dev *dev)
 	return data->microvolts;
 }
 
-static struct regulator_ops fixed_voltage_ops = {
+static int fixed_voltage_list_voltage(struct regulator_dev *dev,
+				      unsigned selector)
+{
+	struct fixed_voltage_data *data = rdev_get_drvdata(dev);
+
+	if (selector != 0)
+		return -EINVAL;
+
+	return data->microvolts;
+}
+
+/* a fixed rail which can be switched, the core can't do this itself */
+static struct regulator_ops fixed_voltage_gpio_ops = {
 	.is_enabled = fixed_voltage_is_enabled,
 	.enable = fixed_voltage_enable,
+	.disable = fixed_voltage_disable,
 	.get_voltage = fixed_voltage_get_voltage,
+	.list_voltage = fixed_voltage_list_voltage,
 };
 
 static int regulator_fixed_voltage_probe(struct platform_device *pdev)
 {
-	struct fixed_voltage_config *config = pdev->dev.platform_data;
+	struct regulator_init_data *init_data = pdev->dev.platform_data;
+	struct fixed_voltage_config *config;
 	struct fixed_voltage_data *drvdata;
 	int ret;
 
+	if (init_data == NULL || init_data->driver_data == NULL)
+		return -EINVAL;
+	config = init_data->driver_data;
+
+	if (config->microvolts <= 0)
+		return -EINVAL;
+
 	drvdata = kzalloc(sizeof(struct fixed_voltage_data), GFP_KERNEL);
 	if (drvdata == NULL) {
 		ret = -ENOMEM;
@@ -69,14 +116,42 @@ static int regulator_fixed_voltage_probe(struct platform_device *pdev)
 	}
 	drvdata->desc.type = REGULATOR_VOLTAGE;
 	drvdata->desc.owner = THIS_MODULE;
-	drvdata->desc.ops = &fixed_voltage_ops,
-
 	drvdata->microvolts = config->microvolts;
+	drvdata->gpio = config->gpio;
+
+	if (gpio_is_valid(config->gpio)) {
+		drvdata->desc.ops = &fixed_voltage_gpio_ops;
+		drvdata->desc.n_voltages = 1;
+		drvdata->desc.enable_time = config->startup_delay;
+		drvdata->enable_high = config->enable_high;
+		drvdata->is_enabled = config->enabled_at_boot;
+
+		ret = gpio_request(config->gpio, config->supply_name);
+		if (ret != 0) {
+			dev_err(&pdev->dev, "Could not obtain GPIO %d: %d\n",
+				config->gpio, ret);
+			goto err_name;
+		}
+
+		/* drive the switch to the state the board booted with */
+		ret = gpio_direction_output(config->gpio,
+					    config->enabled_at_boot ?
+					    config->enable_high :
+					    !config->enable_high);
+		if (ret != 0) {
+			dev_err(&pdev->dev, "Could not configure GPIO %d: %d\n",
+				config->gpio, ret);
+			goto err_gpio;
+		}
+	} else {
+		drvdata->desc.ops = &fixed_voltage_ops;
+		drvdata->desc.fixed_uV = config->microvolts;
+	}
 
-	drvdata->dev = regulator_register(&drvdata->desc, drvdata);
+	drvdata->dev = regulator_register(&drvdata->desc, &pdev->dev, drvdata);
 	if (IS_ERR(drvdata->dev)) {
 		ret = PTR_ERR(drvdata->dev);
-		goto err_name;
+		goto err_gpio;
 	}
 
 	platform_set_drvdata(pdev, drvdata);
@@ -86,6 +161,9 @@ static int regulator_fixed_voltage_probe(struct platform_device *pdev)
 
 	return 0;
 
+err_gpio:
+	if (gpio_is_valid(config->gpio))
+		gpio_free(config->gpio);
 err_name:
 	kfree(drvdata->desc.name);
 err:
@@ -98,6 +176,8 @@ static int regulator_fixed_voltage_remove(struct platform_device *pdev)
 	struct fixed_voltage_data *drvdata = platform_get_drvdata(pdev);
 
 	regulator_unregister(drvdata->dev);
+	if (gpio_is_valid(drvdata->gpio))
+		gpio_free(drvdata->gpio);
 	kfree(drvdata->desc.name);
 	kfree(drvdata);
 
@@ -0,0 +1,531 @@
+/*
+ * mock.c
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * A regulator with no hardware behind it, for exercising and
+ * benchmarking the core without a PMIC.  It keeps its state in memory
+ * but can be made to take as long as a real bus transaction for each
+ * operation and to fail operations on demand.
+ */
+
+#include <linux/delay.h>
+#include <linux/err.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
+#include <linux/regulator/mock.h>
+
+static const char *mock_regulator_op_names[MOCK_REGULATOR_OP_NUM] = {
+	[MOCK_REGULATOR_ENABLE] = "enable",
+	[MOCK_REGULATOR_DISABLE] = "disable",
+	[MOCK_REGULATOR_IS_ENABLED] = "is_enabled",
+	[MOCK_REGULATOR_SET_VOLTAGE] = "set_voltage",
+	[MOCK_REGULATOR_GET_VOLTAGE] = "get_voltage",
+	[MOCK_REGULATOR_SET_MODE] = "set_mode",
+	[MOCK_REGULATOR_GET_MODE] = "get_mode",
+};
+
+struct mock_regulator {
+	struct regulator_desc desc;
+	struct regulator_ops ops;
+	struct regulator_dev *rdev;
+
+	int min_uV;
+	unsigned int uV_step;
+	int *voltage_table;
+	unsigned int modes;
+	int idle_max_uA;
+
+	/* simulated hardware state */
+	int enabled;
+	unsigned int selector;
+	unsigned int mode;
+
+	/* latency and fault injection, changed through sysfs */
+	spinlock_t lock;
+	unsigned int latency_us[MOCK_REGULATOR_OP_NUM];
+	unsigned int fail_ops;
+	unsigned int fail_every;
+	unsigned int fail_countdown;
+	unsigned long faults;
+	unsigned long count[MOCK_REGULATOR_OP_NUM];
+};
+
+/* account for an operation, taking as long as the bus would */
+static int mock_regulator_op(struct mock_regulator *mock,
+			     enum mock_regulator_op op)
+{
+	unsigned int us;
+	int fail = 0;
+
+	spin_lock(&mock->lock);
+	us = mock->latency_us[op];
+	mock->count[op]++;
+	if ((mock->fail_ops & (1 << op)) && mock->fail_every &&
+	    ++mock->fail_countdown >= mock->fail_every) {
+		mock->fail_countdown = 0;
+		mock->faults++;
+		fail = 1;
+	}
+	spin_unlock(&mock->lock);
+
+	if (us >= 1000)
+		msleep(us / 1000);
+	if (us % 1000)
+		udelay(us % 1000);
+
+	return fail ? -EIO : 0;
+}
+
+static int mock_regulator_enable(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_ENABLE);
+	if (ret == 0)
+		mock->enabled = 1;
+
+	return ret;
+}
+
+static int mock_regulator_disable(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_DISABLE);
+	if (ret == 0)
+		mock->enabled = 0;
+
+	return ret;
+}
+
+static int mock_regulator_is_enabled(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_IS_ENABLED);
+	if (ret != 0)
+		return ret;
+
+	return mock->enabled;
+}
+
+static int mock_regulator_list_voltage(struct regulator_dev *rdev,
+				       unsigned selector)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+
+	if (selector >= mock->desc.n_voltages)
+		return -EINVAL;
+
+	if (mock->voltage_table)
+		return mock->voltage_table[selector];
+
+	return regulator_list_voltage_linear(rdev, selector);
+}
+
+static int mock_regulator_set_voltage_sel(struct regulator_dev *rdev,
+					  unsigned selector)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	if (selector >= mock->desc.n_voltages)
+		return -EINVAL;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_SET_VOLTAGE);
+	if (ret == 0)
+		mock->selector = selector;
+
+	return ret;
+}
+
+static int mock_regulator_get_voltage_sel(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_GET_VOLTAGE);
+	if (ret != 0)
+		return ret;
+
+	return mock->selector;
+}
+
+/* for mocks without a voltage table */
+static int mock_regulator_get_voltage(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_GET_VOLTAGE);
+	if (ret != 0)
+		return ret;
+
+	return mock->min_uV;
+}
+
+static int mock_regulator_set_mode(struct regulator_dev *rdev,
+				   unsigned int mode)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+	int ret;
+
+	if (!(mode & mock->modes))
+		return -EINVAL;
+
+	ret = mock_regulator_op(mock, MOCK_REGULATOR_SET_MODE);
+	if (ret == 0)
+		mock->mode = mode;
+
+	return ret;
+}
+
+static unsigned int mock_regulator_get_mode(struct regulator_dev *rdev)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+
+	/* there is no way to report an error from get_mode() */
+	mock_regulator_op(mock, MOCK_REGULATOR_GET_MODE);
+
+	return mock->mode;
+}
+
+static unsigned int mock_regulator_get_optimum_mode(struct regulator_dev *rdev,
+						    int input_uV,
+						    int output_uV, int load_uA)
+{
+	struct mock_regulator *mock = rdev_get_drvdata(rdev);
+
+	if ((mock->modes & REGULATOR_MODE_IDLE) &&
+	    load_uA <= mock->idle_max_uA)
+		return REGULATOR_MODE_IDLE;
+	if (mock->modes & REGULATOR_MODE_NORMAL)
+		return REGULATOR_MODE_NORMAL;
+
+	return mock->mode;
+}
+
+/* cut down to what each mock supports when it is probed */
+static const struct regulator_ops mock_regulator_ops = {
+	.enable = mock_regulator_enable,
+	.disable = mock_regulator_disable,
+	.is_enabled = mock_regulator_is_enabled,
+	.list_voltage = mock_regulator_list_voltage,
+	.set_voltage_sel = mock_regulator_set_voltage_sel,
+	.get_voltage_sel = mock_regulator_get_voltage_sel,
+	.get_voltage = mock_regulator_get_voltage,
+	.set_mode = mock_regulator_set_mode,
+	.get_mode = mock_regulator_get_mode,
+	.get_optimum_mode = mock_regulator_get_optimum_mode,
+};
+
+static int mock_regulator_parse_op(const char *buf, size_t len)
+{
+	int i;
+
+	for (i = 0; i < MOCK_REGULATOR_OP_NUM; i++)
+		if (strlen(mock_regulator_op_names[i]) == len &&
+		    strncmp(buf, mock_regulator_op_names[i], len) == 0)
+			return i;
+
+	return -EINVAL;
+}
+
+static ssize_t show_latency(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < MOCK_REGULATOR_OP_NUM; i++)
+		len += sprintf(buf + len, "%s %u\n", mock_regulator_op_names[i],
+			       mock->latency_us[i]);
+
+	return len;
+}
+
+/* "<op> <us>" sets one operation, "<us>" sets them all */
+static ssize_t set_latency(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	const char *space;
+	char *end;
+	unsigned long us;
+	int i, op = -1;
+
+	space = strchr(buf, ' ');
+	if (space) {
+		op = mock_regulator_parse_op(buf, space - buf);
+		if (op < 0)
+			return op;
+		buf = space + 1;
+	}
+
+	us = simple_strtoul(buf, &end, 10);
+	if (end == buf)
+		return -EINVAL;
+
+	spin_lock(&mock->lock);
+	for (i = 0; i < MOCK_REGULATOR_OP_NUM; i++)
+		if (op < 0 || op == i)
+			mock->latency_us[i] = us;
+	spin_unlock(&mock->lock);
+
+	return count;
+}
+
+static ssize_t show_fail_ops(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < MOCK_REGULATOR_OP_NUM; i++)
+		if (mock->fail_ops & (1 << i))
+			len += sprintf(buf + len, "%s ",
+				       mock_regulator_op_names[i]);
+	if (len == 0)
+		return sprintf(buf, "none\n");
+
+	buf[len - 1] = '\n';
+	return len;
+}
+
+/* a space separated list of operation names, or "none" */
+static ssize_t set_fail_ops(struct device *dev, struct device_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	unsigned int mask = 0;
+	const char *p = buf;
+	size_t len;
+	int op;
+
+	while (*p) {
+		p += strspn(p, " \n");
+		len = strcspn(p, " \n");
+		if (len == 0)
+			break;
+
+		if (len != 4 || strncmp(p, "none", 4) != 0) {
+			op = mock_regulator_parse_op(p, len);
+			if (op < 0)
+				return op;
+			mask |= 1 << op;
+		}
+		p += len;
+	}
+
+	spin_lock(&mock->lock);
+	mock->fail_ops = mask;
+	mock->fail_countdown = 0;
+	spin_unlock(&mock->lock);
+
+	return count;
+}
+
+static ssize_t show_fail_every(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", mock->fail_every);
+}
+
+static ssize_t set_fail_every(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	unsigned long val;
+	char *end;
+
+	val = simple_strtoul(buf, &end, 10);
+	if (end == buf)
+		return -EINVAL;
+
+	spin_lock(&mock->lock);
+	mock->fail_every = val;
+	mock->fail_countdown = 0;
+	spin_unlock(&mock->lock);
+
+	return count;
+}
+
+static ssize_t show_stats(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct mock_regulator *mock = dev_get_drvdata(dev);
+	ssize_t len = 0;
+	int i;
+
+	spin_lock(&mock->lock);
+	for (i = 0; i < MOCK_REGULATOR_OP_NUM; i++)
+		len += sprintf(buf + len, "%s %lu\n",
+			       mock_regulator_op_names[i], mock->count[i]);
+	len += sprintf(buf + len, "faults %lu\n", mock->faults);
+	spin_unlock(&mock->lock);
+
+	return len;
+}
+
+static DEVICE_ATTR(latency_us, 0644, show_latency, set_latency);
+static DEVICE_ATTR(fail_ops, 0644, show_fail_ops, set_fail_ops);
+static DEVICE_ATTR(fail_every, 0644, show_fail_every, set_fail_every);
+static DEVICE_ATTR(stats, 0444, show_stats, NULL);
+
+static struct attribute *mock_regulator_attributes[] = {
+	&dev_attr_latency_us.attr,
+	&dev_attr_fail_ops.attr,
+	&dev_attr_fail_every.attr,
+	&dev_attr_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group mock_regulator_attr_group = {
+	.attrs	= mock_regulator_attributes,
+};
+
+static int regulator_mock_probe(struct platform_device *pdev)
+{
+	struct regulator_init_data *init_data = pdev->dev.platform_data;
+	struct mock_regulator_config *config;
+	struct mock_regulator *mock;
+	int ret;
+
+	if (init_data == NULL || init_data->driver_data == NULL)
+		return -EINVAL;
+	config = init_data->driver_data;
+
+	mock = kzalloc(sizeof(struct mock_regulator), GFP_KERNEL);
+	if (mock == NULL)
+		return -ENOMEM;
+
+	mock->desc.name = kstrdup(config->supply_name, GFP_KERNEL);
+	if (mock->desc.name == NULL) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	mock->desc.id = pdev->id;
+	mock->desc.type = REGULATOR_VOLTAGE;
+	mock->desc.owner = THIS_MODULE;
+	mock->desc.ops = &mock->ops;
+	mock->ops = mock_regulator_ops;
+
+	mock->min_uV = config->min_uV;
+	mock->uV_step = config->uV_step;
+	mock->modes = config->modes;
+	mock->idle_max_uA = config->idle_max_uA;
+	mock->enabled = config->enabled_at_boot;
+
+	if (config->voltage_table) {
+		mock->voltage_table = kmemdup(config->voltage_table,
+					      config->n_voltages * sizeof(int),
+					      GFP_KERNEL);
+		if (mock->voltage_table == NULL) {
+			ret = -ENOMEM;
+			goto err_name;
+		}
+	}
+
+	if (config->n_voltages) {
+		mock->desc.n_voltages = config->n_voltages;
+		mock->desc.min_uV = config->min_uV;
+		mock->desc.uV_step = config->uV_step;
+		mock->ops.get_voltage = NULL;
+	} else {
+		mock->ops.list_voltage = NULL;
+		mock->ops.set_voltage_sel = NULL;
+		mock->ops.get_voltage_sel = NULL;
+	}
+
+	if (mock->modes) {
+		mock->mode = mock->modes & REGULATOR_MODE_NORMAL ?
+			REGULATOR_MODE_NORMAL : 1 << (ffs(mock->modes) - 1);
+	} else {
+		mock->ops.set_mode = NULL;
+		mock->ops.get_mode = NULL;
+		mock->ops.get_optimum_mode = NULL;
+	}
+
+	spin_lock_init(&mock->lock);
+	memcpy(mock->latency_us, config->latency_us, sizeof(mock->latency_us));
+	mock->fail_ops = config->fail_ops;
+	mock->fail_every = config->fail_every;
+
+	platform_set_drvdata(pdev, mock);
+
+	mock->rdev = regulator_register(&mock->desc, &pdev->dev, mock);
+	if (IS_ERR(mock->rdev)) {
+		ret = PTR_ERR(mock->rdev);
+		goto err_table;
+	}
+
+	ret = sysfs_create_group(&pdev->dev.kobj, &mock_regulator_attr_group);
+	if (ret != 0)
+		goto err_rdev;
+
+	return 0;
+
+err_rdev:
+	regulator_unregister(mock->rdev);
+err_table:
+	kfree(mock->voltage_table);
+err_name:
+	kfree(mock->desc.name);
+err:
+	kfree(mock);
+	return ret;
+}
+
+static int regulator_mock_remove(struct platform_device *pdev)
+{
+	struct mock_regulator *mock = platform_get_drvdata(pdev);
+
+	sysfs_remove_group(&pdev->dev.kobj, &mock_regulator_attr_group);
+	regulator_unregister(mock->rdev);
+	kfree(mock->voltage_table);
+	kfree(mock->desc.name);
+	kfree(mock);
+
+	return 0;
+}
+
+static struct platform_driver regulator_mock_driver = {
+	.probe		= regulator_mock_probe,
+	.remove		= regulator_mock_remove,
+	.driver		= {
+		.name		= "reg-mock",
+	},
+};
+
+static int __init regulator_mock_init(void)
+{
+	return platform_driver_register(&regulator_mock_driver);
+}
+module_init(regulator_mock_init);
+
+static void __exit regulator_mock_exit(void)
+{
+	platform_driver_unregister(&regulator_mock_driver);
+}
+module_exit(regulator_mock_exit);
+
+MODULE_DESCRIPTION("Mock regulator for testing the regulator core");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:reg-mock");
@@ -0,0 +1,602 @@
+/*
+ * userspace-consumer.c
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Gives userspace control of a group of supplies, for example those
+ * powering a modem or GPS block managed by a daemon.  All the supplies
+ * can be reconfigured with a single write to the "config" attribute
+ * which is validated as a whole and then applied through the bulk
+ * APIs, so a daemon does not need a system call per supply and
+ * parameter.
+ */
+
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator/userspace-consumer.h>
+
+/* the requested configuration of one supply */
+struct userspace_consumer_supply {
+	int enabled;
+	int min_uV;		/* 0 if no voltage has been requested */
+	int max_uV;
+	unsigned int mode;	/* 0 if the mode is unknown */
+};
+
+struct userspace_consumer_data {
+	const char *name;
+
+	struct mutex lock;
+	int num_supplies;
+	struct regulator_bulk_data *supplies;
+
+	struct userspace_consumer_supply *state;	/* as applied */
+	struct userspace_consumer_supply *pending;	/* being applied */
+	struct regulator_bulk_data *batch;		/* for the bulk calls */
+	int *index;			/* supply behind each batch entry */
+	int *undo_uV;			/* see userspace_consumer_save_uV() */
+};
+
+enum userspace_consumer_op {
+	USERSPACE_CONSUMER_VOLTAGE,
+	USERSPACE_CONSUMER_MODE,
+	USERSPACE_CONSUMER_ENABLE,
+	USERSPACE_CONSUMER_DISABLE,
+};
+
+static const struct {
+	const char *name;
+	unsigned int mode;
+} userspace_consumer_modes[] = {
+	{ "fast", REGULATOR_MODE_FAST },
+	{ "normal", REGULATOR_MODE_NORMAL },
+	{ "idle", REGULATOR_MODE_IDLE },
+	{ "standby", REGULATOR_MODE_STANDBY },
+};
+
+static const char *userspace_consumer_mode_name(unsigned int mode)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(userspace_consumer_modes); i++)
+		if (userspace_consumer_modes[i].mode == mode)
+			return userspace_consumer_modes[i].name;
+
+	return NULL;
+}
+
+/*
+ * Fill the batch with the supplies that @op has to touch to get from
+ * the applied state to the pending one, taking the values to set from
+ * @to.  Called with @to as the applied state to back a change out.
+ */
+static int userspace_consumer_gather(struct userspace_consumer_data *data,
+				     enum userspace_consumer_op op,
+				     const struct userspace_consumer_supply *to)
+{
+	struct userspace_consumer_supply *cur, *new;
+	int i, n = 0;
+
+	for (i = 0; i < data->num_supplies; i++) {
+		cur = &data->state[i];
+		new = &data->pending[i];
+
+		switch (op) {
+		case USERSPACE_CONSUMER_VOLTAGE:
+			if ((new->min_uV == cur->min_uV &&
+			     new->max_uV == cur->max_uV) || !to[i].min_uV)
+				continue;
+			break;
+		case USERSPACE_CONSUMER_MODE:
+			if (new->mode == cur->mode || !to[i].mode)
+				continue;
+			break;
+		case USERSPACE_CONSUMER_ENABLE:
+			if (!new->enabled || cur->enabled)
+				continue;
+			break;
+		case USERSPACE_CONSUMER_DISABLE:
+			if (new->enabled || !cur->enabled)
+				continue;
+			break;
+		}
+
+		data->index[n] = i;
+		data->batch[n] = data->supplies[i];
+		data->batch[n].min_uV = to[i].min_uV;
+		data->batch[n].max_uV = to[i].max_uV;
+		data->batch[n].mode = to[i].mode;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Note how to back out the voltage changes in the batch: a supply with
+ * an applied range goes back to it (0), one without goes back to the
+ * output it has now.  Supplies left alone, or whose output can't be
+ * read, are marked with a negative value.
+ */
+static void userspace_consumer_save_uV(struct userspace_consumer_data *data,
+				       int n)
+{
+	struct regulator *consumer;
+	int i, k;
+
+	for (i = 0; i < data->num_supplies; i++)
+		data->undo_uV[i] = -EINVAL;
+
+	for (k = 0; k < n; k++) {
+		i = data->index[k];
+		consumer = data->supplies[i].consumer;
+		if (data->state[i].min_uV)
+			data->undo_uV[i] = 0;
+		else
+			data->undo_uV[i] = regulator_get_voltage(consumer);
+	}
+}
+
+/* forget the supplies in the batch whose voltage wasn't changed */
+static void userspace_consumer_uV_done(struct userspace_consumer_data *data,
+				       int n)
+{
+	int k;
+
+	for (k = 0; k < n; k++)
+		if (data->batch[k].ret != 0)
+			data->undo_uV[data->index[k]] = -EINVAL;
+}
+
+/* put back the voltages noted by userspace_consumer_save_uV() */
+static void userspace_consumer_undo_uV(struct userspace_consumer_data *data)
+{
+	int i, n = 0;
+
+	for (i = 0; i < data->num_supplies; i++) {
+		if (data->undo_uV[i] < 0)
+			continue;
+
+		data->batch[n] = data->supplies[i];
+		if (data->undo_uV[i]) {
+			data->batch[n].min_uV = data->undo_uV[i];
+			data->batch[n].max_uV = data->undo_uV[i];
+		} else {
+			data->batch[n].min_uV = data->state[i].min_uV;
+			data->batch[n].max_uV = data->state[i].max_uV;
+		}
+		n++;
+	}
+
+	if (n)
+		regulator_bulk_set_voltage(n, data->batch);
+}
+
+/*
+ * Move the supplies from the applied state to the pending one.  If
+ * anything fails the supplies are put back the way they were so the
+ * update either happens as a whole or not at all.
+ */
+static int userspace_consumer_apply(struct userspace_consumer_data *data)
+{
+	int n, ret;
+
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_VOLTAGE,
+				      data->pending);
+	userspace_consumer_save_uV(data, n);
+	if (n) {
+		ret = regulator_bulk_set_voltage(n, data->batch);
+		userspace_consumer_uV_done(data, n);
+		if (ret != 0)
+			goto err_voltage;
+	}
+
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_MODE,
+				      data->pending);
+	if (n) {
+		ret = regulator_bulk_set_mode(n, data->batch);
+		if (ret != 0)
+			goto err_mode;
+	}
+
+	/* the bulk enable and disable clean up after themselves */
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_ENABLE,
+				      data->pending);
+	if (n) {
+		ret = regulator_bulk_enable(n, data->batch);
+		if (ret != 0)
+			goto err_mode;
+	}
+
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_DISABLE,
+				      data->pending);
+	if (n) {
+		ret = regulator_bulk_disable(n, data->batch);
+		if (ret != 0)
+			goto err_enable;
+	}
+
+	memcpy(data->state, data->pending,
+	       data->num_supplies * sizeof(*data->state));
+
+	return 0;
+
+err_enable:
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_ENABLE,
+				      data->pending);
+	regulator_bulk_disable(n, data->batch);
+err_mode:
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_MODE,
+				      data->state);
+	regulator_bulk_set_mode(n, data->batch);
+err_voltage:
+	userspace_consumer_undo_uV(data);
+	return ret;
+}
+
+/* parse "key=value" from a config line into the pending state */
+static int userspace_consumer_parse_field(struct userspace_consumer_supply *s,
+					  char *field)
+{
+	char *value, *end;
+	int i;
+
+	value = strchr(field, '=');
+	if (!value)
+		return -EINVAL;
+	*value++ = '\0';
+
+	if (strcmp(field, "state") == 0) {
+		if (strcmp(value, "enabled") == 0)
+			s->enabled = 1;
+		else if (strcmp(value, "disabled") == 0)
+			s->enabled = 0;
+		else
+			return -EINVAL;
+
+	} else if (strcmp(field, "uV") == 0) {
+		s->min_uV = simple_strtol(value, &end, 10);
+		if (end == value)
+			return -EINVAL;
+		if (*end == ':') {
+			value = end + 1;
+			s->max_uV = simple_strtol(value, &end, 10);
+			if (end == value)
+				return -EINVAL;
+		} else {
+			s->max_uV = s->min_uV;
+		}
+		if (*end || s->min_uV <= 0 || s->min_uV > s->max_uV)
+			return -EINVAL;
+
+	} else if (strcmp(field, "mode") == 0) {
+		for (i = 0; i < ARRAY_SIZE(userspace_consumer_modes); i++) {
+			if (strcmp(value, userspace_consumer_modes[i].name))
+				continue;
+			s->mode = userspace_consumer_modes[i].mode;
+			break;
+		}
+		if (i == ARRAY_SIZE(userspace_consumer_modes))
+			return -EINVAL;
+
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* parse "<supply> key=value..." into the pending state */
+static int userspace_consumer_parse_line(struct userspace_consumer_data *data,
+					 char *line)
+{
+	char *name, *field;
+	int i, ret;
+
+	do {
+		name = strsep(&line, " \t");
+	} while (name && !*name);
+	if (!name)
+		return 0;
+
+	for (i = 0; i < data->num_supplies; i++)
+		if (strcmp(name, data->supplies[i].supply) == 0)
+			break;
+	if (i == data->num_supplies)
+		return -ENODEV;
+
+	while ((field = strsep(&line, " \t")) != NULL) {
+		if (!*field)
+			continue;
+		ret = userspace_consumer_parse_field(&data->pending[i], field);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static ssize_t show_name(struct device *dev,
+			 struct device_attribute *attr, char *buf)
+{
+	struct userspace_consumer_data *data = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%s\n", data->name);
+}
+
+static ssize_t show_state(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct userspace_consumer_data *data = dev_get_drvdata(dev);
+	int i, on = 0;
+
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->num_supplies; i++)
+		on += data->state[i].enabled;
+	mutex_unlock(&data->lock);
+
+	if (on == 0)
+		return sprintf(buf, "disabled\n");
+	if (on == data->num_supplies)
+		return sprintf(buf, "enabled\n");
+	return sprintf(buf, "mixed\n");
+}
+
+static ssize_t set_state(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count)
+{
+	struct userspace_consumer_data *data = dev_get_drvdata(dev);
+	int i, enabled, ret;
+
+	if (sysfs_streq(buf, "enabled"))
+		enabled = 1;
+	else if (sysfs_streq(buf, "disabled"))
+		enabled = 0;
+	else
+		return -EINVAL;
+
+	mutex_lock(&data->lock);
+	memcpy(data->pending, data->state,
+	       data->num_supplies * sizeof(*data->state));
+	for (i = 0; i < data->num_supplies; i++)
+		data->pending[i].enabled = enabled;
+	ret = userspace_consumer_apply(data);
+	mutex_unlock(&data->lock);
+
+	if (ret != 0)
+		return ret;
+	return count;
+}
+
+static ssize_t show_config(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct userspace_consumer_data *data = dev_get_drvdata(dev);
+	struct userspace_consumer_supply *s;
+	const char *mode;
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->num_supplies; i++) {
+		s = &data->state[i];
+
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s state=%s",
+				 data->supplies[i].supply,
+				 s->enabled ? "enabled" : "disabled");
+		if (s->min_uV)
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 " uV=%d:%d", s->min_uV, s->max_uV);
+		mode = userspace_consumer_mode_name(s->mode);
+		if (mode)
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 " mode=%s", mode);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+	mutex_unlock(&data->lock);
+
+	return len;
+}
+
+/*
+ * Each line (or ';' separated entry) names a supply followed by the
+ * settings to change for it, for example:
+ *
+ *	vcc state=enabled uV=1800000 mode=idle; vrf uV=2700000:2900000
+ *
+ * Supplies and settings which are not mentioned are left alone.
+ */
+static ssize_t set_config(struct device *dev, struct device_attribute *attr,
+			  const char *buf, size_t count)
+{
+	struct userspace_consumer_data *data = dev_get_drvdata(dev);
+	char *copy, *p, *line;
+	int ret = 0;
+
+	copy = kstrndup(buf, count, GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+
+	mutex_lock(&data->lock);
+	memcpy(data->pending, data->state,
+	       data->num_supplies * sizeof(*data->state));
+
+	p = copy;
+	while ((line = strsep(&p, "\n;")) != NULL) {
+		ret = userspace_consumer_parse_line(data, line);
+		if (ret != 0)
+			break;
+	}
+
+	/* nothing is touched unless the whole write made sense */
+	if (ret == 0)
+		ret = userspace_consumer_apply(data);
+	mutex_unlock(&data->lock);
+
+	kfree(copy);
+
+	if (ret != 0)
+		return ret;
+	return count;
+}
+
+static DEVICE_ATTR(name, 0444, show_name, NULL);
+static DEVICE_ATTR(state, 0644, show_state, set_state);
+static DEVICE_ATTR(config, 0644, show_config, set_config);
+
+static struct attribute *attributes[] = {
+	&dev_attr_name.attr,
+	&dev_attr_state.attr,
+	&dev_attr_config.attr,
+	NULL,
+};
+
+static const struct attribute_group attr_group = {
+	.attrs	= attributes,
+};
+
+static int regulator_userspace_consumer_probe(struct platform_device *pdev)
+{
+	struct regulator_userspace_consumer_data *pdata;
+	struct userspace_consumer_data *drvdata;
+	int i, ret;
+
+	pdata = pdev->dev.platform_data;
+	if (!pdata || !pdata->num_supplies)
+		return -EINVAL;
+
+	drvdata = kzalloc(sizeof(*drvdata), GFP_KERNEL);
+	if (drvdata == NULL)
+		return -ENOMEM;
+
+	drvdata->name = pdata->name;
+	drvdata->num_supplies = pdata->num_supplies;
+	mutex_init(&drvdata->lock);
+
+	/* keep our own copy of the supplies, the bulk calls write to it */
+	drvdata->supplies = kmemdup(pdata->supplies,
+				    pdata->num_supplies *
+				    sizeof(*drvdata->supplies), GFP_KERNEL);
+	drvdata->batch = kcalloc(pdata->num_supplies,
+				 sizeof(*drvdata->batch), GFP_KERNEL);
+	drvdata->state = kcalloc(pdata->num_supplies,
+				 sizeof(*drvdata->state), GFP_KERNEL);
+	drvdata->pending = kcalloc(pdata->num_supplies,
+				   sizeof(*drvdata->pending), GFP_KERNEL);
+	drvdata->index = kcalloc(pdata->num_supplies,
+				 sizeof(*drvdata->index), GFP_KERNEL);
+	drvdata->undo_uV = kcalloc(pdata->num_supplies,
+				   sizeof(*drvdata->undo_uV), GFP_KERNEL);
+	if (!drvdata->supplies || !drvdata->batch || !drvdata->state ||
+	    !drvdata->pending || !drvdata->index || !drvdata->undo_uV) {
+		ret = -ENOMEM;
+		goto err_alloc;
+	}
+
+	ret = regulator_bulk_get(&pdev->dev, drvdata->num_supplies,
+				 drvdata->supplies);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to get supplies: %d\n", ret);
+		goto err_alloc;
+	}
+
+	for (i = 0; i < drvdata->num_supplies; i++)
+		drvdata->state[i].mode =
+			regulator_get_mode(drvdata->supplies[i].consumer);
+
+	if (pdata->init_on) {
+		ret = regulator_bulk_enable(drvdata->num_supplies,
+					    drvdata->supplies);
+		if (ret) {
+			dev_err(&pdev->dev,
+				"Failed to set initial state: %d\n", ret);
+			goto err_enable;
+		}
+		for (i = 0; i < drvdata->num_supplies; i++)
+			drvdata->state[i].enabled = 1;
+	}
+
+	platform_set_drvdata(pdev, drvdata);
+
+	ret = sysfs_create_group(&pdev->dev.kobj, &attr_group);
+	if (ret != 0)
+		goto err_create_attrs;
+
+	return 0;
+
+err_create_attrs:
+	platform_set_drvdata(pdev, NULL);
+	if (pdata->init_on)
+		regulator_bulk_disable(drvdata->num_supplies,
+				       drvdata->supplies);
+err_enable:
+	regulator_bulk_free(drvdata->num_supplies, drvdata->supplies);
+err_alloc:
+	kfree(drvdata->undo_uV);
+	kfree(drvdata->index);
+	kfree(drvdata->pending);
+	kfree(drvdata->state);
+	kfree(drvdata->batch);
+	kfree(drvdata->supplies);
+	kfree(drvdata);
+	return ret;
+}
+
+static int regulator_userspace_consumer_remove(struct platform_device *pdev)
+{
+	struct userspace_consumer_data *data = platform_get_drvdata(pdev);
+	int n;
+
+	sysfs_remove_group(&pdev->dev.kobj, &attr_group);
+
+	/* drop whatever userspace left enabled */
+	memset(data->pending, 0, data->num_supplies * sizeof(*data->pending));
+	n = userspace_consumer_gather(data, USERSPACE_CONSUMER_DISABLE,
+				      data->pending);
+	if (n)
+		regulator_bulk_disable(n, data->batch);
+
+	regulator_bulk_free(data->num_supplies, data->supplies);
+
+	kfree(data->undo_uV);
+	kfree(data->index);
+	kfree(data->pending);
+	kfree(data->state);
+	kfree(data->batch);
+	kfree(data->supplies);
+	kfree(data);
+
+	return 0;
+}
+
+static struct platform_driver regulator_userspace_consumer_driver = {
+	.probe		= regulator_userspace_consumer_probe,
+	.remove		= regulator_userspace_consumer_remove,
+	.driver		= {
+		.name		= "reg-userspace-consumer",
+	},
+};
+
+
+static int __init regulator_userspace_consumer_init(void)
+{
+	return platform_driver_register(&regulator_userspace_consumer_driver);
+}
+module_init(regulator_userspace_consumer_init);
+
+static void __exit regulator_userspace_consumer_exit(void)
+{
+	platform_driver_unregister(&regulator_userspace_consumer_driver);
+}
+module_exit(regulator_userspace_consumer_exit);
+
+MODULE_DESCRIPTION("Userspace consumer for voltage and current regulators");
+MODULE_LICENSE("GPL");
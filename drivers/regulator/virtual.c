@@ -11,13 +11,64 @@
  * License, or (at your option) any later version.
  */
 
+#include <linux/completion.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
 
+enum virtual_bench_op {
+	VIRTUAL_BENCH_ENABLE = 0,
+	VIRTUAL_BENCH_DISABLE,
+	VIRTUAL_BENCH_VOLTAGE,
+	VIRTUAL_BENCH_MODE,
+	VIRTUAL_BENCH_OPTIMUM_MODE,
+	VIRTUAL_BENCH_NUM,
+};
+
+static const char *virtual_bench_names[] = {
+	[VIRTUAL_BENCH_ENABLE] = "enable",
+	[VIRTUAL_BENCH_DISABLE] = "disable",
+	[VIRTUAL_BENCH_VOLTAGE] = "set_voltage",
+	[VIRTUAL_BENCH_MODE] = "set_mode",
+	[VIRTUAL_BENCH_OPTIMUM_MODE] = "set_optimum_mode",
+};
+
+/* latency histogram buckets are powers of two in microseconds */
+#define VIRTUAL_BENCH_BUCKETS	16
+
+struct virtual_bench_stats {
+	unsigned int count;
+	unsigned int errors;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u64 elapsed_ns;		/* wall time taken by the whole run */
+	unsigned int hist[VIRTUAL_BENCH_BUCKETS];
+};
+
+/* enough threads to contend any lock, each is a kthread and a handle */
+#define VIRTUAL_STRESS_MAX_THREADS	32
+
+/* results of a multi-threaded stress run */
+struct virtual_stress_stats {
+	unsigned int threads;
+	unsigned long ops;
+	unsigned long errors;
+	unsigned long violations;
+	u64 total_ns;
+	u64 max_ns;
+	u64 elapsed_ns;
+};
+
 struct virtual_consumer_data {
 	struct mutex lock;
+	struct device *dev;
+	const char *supply;
 	struct regulator *regulator;
 	int enabled;
 	int min_uV;
@@ -25,6 +76,28 @@ struct virtual_consumer_data {
 	int min_uA;
 	int max_uA;
 	unsigned int mode;
+
+	unsigned int bench_iterations;
+	struct virtual_bench_stats bench[VIRTUAL_BENCH_NUM];
+
+	unsigned int stress_threads;
+	struct virtual_stress_stats stress;
+};
+
+/* per thread state for a stress run, each thread has its own handle */
+struct virtual_stress_thread {
+	struct virtual_consumer_data *data;
+	struct regulator *regulator;
+	struct completion *start;
+	struct completion done;
+	int min_uV;
+	int max_uV;
+	int load_uA;
+	unsigned long ops;
+	unsigned long errors;
+	unsigned long violations;
+	u64 total_ns;
+	u64 max_ns;
 };
 
 static void update_voltage_constraints(struct virtual_consumer_data *data)
@@ -250,11 +323,516 @@ static ssize_t set_mode(struct device *dev, struct device_attribute *attr,
 	return count;
 }
 
+static void virtual_bench_record(struct virtual_bench_stats *stats,
+				 ktime_t start, int ret)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned long us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = us ? ilog2(us) + 1 : 0;
+
+	if (ret < 0) {
+		stats->errors++;
+		return;
+	}
+
+	if (bucket >= VIRTUAL_BENCH_BUCKETS)
+		bucket = VIRTUAL_BENCH_BUCKETS - 1;
+
+	if (!stats->count || ns < stats->min_ns)
+		stats->min_ns = ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	stats->total_ns += ns;
+	stats->count++;
+	stats->hist[bucket]++;
+}
+
+static void virtual_bench_enable(struct virtual_consumer_data *data)
+{
+	struct virtual_bench_stats *en = &data->bench[VIRTUAL_BENCH_ENABLE];
+	struct virtual_bench_stats *dis = &data->bench[VIRTUAL_BENCH_DISABLE];
+	ktime_t start, run;
+	unsigned int i;
+	int ret;
+
+	run = ktime_get();
+	for (i = 0; i < data->bench_iterations; i++) {
+		start = ktime_get();
+		ret = regulator_enable(data->regulator);
+		virtual_bench_record(en, start, ret);
+		if (ret < 0)
+			continue;
+
+		start = ktime_get();
+		ret = regulator_disable(data->regulator);
+		virtual_bench_record(dis, start, ret);
+	}
+	en->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+	dis->elapsed_ns = en->elapsed_ns;
+}
+
+static void virtual_bench_voltage(struct virtual_consumer_data *data)
+{
+	struct virtual_bench_stats *stats = &data->bench[VIRTUAL_BENCH_VOLTAGE];
+	int n_voltages = regulator_count_voltages(data->regulator);
+	int uV, old_uV = regulator_get_voltage(data->regulator);
+	ktime_t start, run;
+	unsigned int i;
+	int ret;
+
+	run = ktime_get();
+	for (i = 0; i < data->bench_iterations; i++) {
+		/* sweep the voltage table if there is one, otherwise
+		 * alternate between the configured limits */
+		if (n_voltages > 0)
+			uV = regulator_list_voltage(data->regulator,
+						    i % n_voltages);
+		else if (data->min_uV && data->max_uV)
+			uV = i & 1 ? data->max_uV : data->min_uV;
+		else
+			uV = -EINVAL;
+
+		if (uV <= 0) {
+			stats->errors++;
+			continue;
+		}
+
+		start = ktime_get();
+		ret = regulator_set_voltage(data->regulator, uV, uV);
+		virtual_bench_record(stats, start, ret);
+	}
+	stats->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+
+	/* put back the configuration the user asked for */
+	if (data->min_uV && data->max_uV && data->min_uV <= data->max_uV)
+		regulator_set_voltage(data->regulator,
+				      data->min_uV, data->max_uV);
+	else if (old_uV > 0)
+		regulator_set_voltage(data->regulator, old_uV, old_uV);
+}
+
+static const unsigned int virtual_bench_modes[] = {
+	REGULATOR_MODE_FAST,
+	REGULATOR_MODE_NORMAL,
+	REGULATOR_MODE_IDLE,
+	REGULATOR_MODE_STANDBY,
+};
+
+static void virtual_bench_mode(struct virtual_consumer_data *data)
+{
+	struct virtual_bench_stats *stats = &data->bench[VIRTUAL_BENCH_MODE];
+	unsigned int modes[ARRAY_SIZE(virtual_bench_modes)];
+	unsigned int old_mode = regulator_get_mode(data->regulator);
+	int i, n_modes = 0;
+	ktime_t start, run;
+	int ret;
+
+	/* find out which modes the machine lets us use */
+	for (i = 0; i < ARRAY_SIZE(virtual_bench_modes); i++)
+		if (regulator_set_mode(data->regulator,
+				       virtual_bench_modes[i]) == 0)
+			modes[n_modes++] = virtual_bench_modes[i];
+
+	if (!n_modes) {
+		stats->errors += data->bench_iterations;
+		return;
+	}
+
+	run = ktime_get();
+	for (i = 0; i < data->bench_iterations; i++) {
+		start = ktime_get();
+		ret = regulator_set_mode(data->regulator, modes[i % n_modes]);
+		virtual_bench_record(stats, start, ret);
+	}
+	stats->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+
+	regulator_set_mode(data->regulator, old_mode);
+}
+
+static void virtual_bench_optimum_mode(struct virtual_consumer_data *data)
+{
+	struct virtual_bench_stats *stats =
+		&data->bench[VIRTUAL_BENCH_OPTIMUM_MODE];
+	ktime_t start, run;
+	unsigned int i;
+	int ret, uA;
+
+	run = ktime_get();
+	for (i = 0; i < data->bench_iterations; i++) {
+		/* step through loads from 1mA to 1A */
+		switch (i % 4) {
+		case 0:
+			uA = 1000;
+			break;
+		case 1:
+			uA = 10000;
+			break;
+		case 2:
+			uA = 100000;
+			break;
+		default:
+			uA = 1000000;
+			break;
+		}
+
+		start = ktime_get();
+		ret = regulator_set_optimum_mode(data->regulator, uA);
+		virtual_bench_record(stats, start, ret);
+	}
+	stats->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+
+	regulator_set_optimum_mode(data->regulator, 0);
+}
+
+static ssize_t show_bench_iterations(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", data->bench_iterations);
+}
+
+static ssize_t set_bench_iterations(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 10, &val) != 0)
+		return count;
+
+	mutex_lock(&data->lock);
+	data->bench_iterations = val;
+	mutex_unlock(&data->lock);
+
+	return count;
+}
+
+static ssize_t show_bench(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	struct virtual_bench_stats *stats;
+	ssize_t ret = 0;
+	u64 avg_ns, ops;
+	int i, j;
+
+	mutex_lock(&data->lock);
+
+	for (i = 0; i < VIRTUAL_BENCH_NUM; i++) {
+		stats = &data->bench[i];
+		if (!stats->count && !stats->errors)
+			continue;
+
+		avg_ns = stats->count ? div_u64(stats->total_ns,
+						stats->count) : 0;
+		ops = stats->elapsed_ns ?
+			div64_u64((u64)stats->count * NSEC_PER_SEC,
+				  stats->elapsed_ns) : 0;
+
+		ret += sprintf(buf + ret, "%s: %u ok %u failed, "
+			       "latency ns min %llu avg %llu max %llu, "
+			       "%llu ops/s\n", virtual_bench_names[i],
+			       stats->count, stats->errors,
+			       (unsigned long long)stats->min_ns,
+			       (unsigned long long)avg_ns,
+			       (unsigned long long)stats->max_ns,
+			       (unsigned long long)ops);
+
+		/* histogram of latencies in microseconds */
+		ret += sprintf(buf + ret, "  <1us %u", stats->hist[0]);
+		for (j = 1; j < VIRTUAL_BENCH_BUCKETS; j++)
+			if (stats->hist[j])
+				ret += sprintf(buf + ret, " %s%luus %u",
+					       j == VIRTUAL_BENCH_BUCKETS - 1 ?
+					       ">=" : "<", 1UL << j,
+					       stats->hist[j]);
+		ret += sprintf(buf + ret, "\n");
+	}
+
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+/*
+ * Writing the name of an operation ("enable", "voltage", "mode",
+ * "optimum_mode" or "all") runs bench_iterations of it against the
+ * supply, replacing any previous results for that operation.
+ */
+static ssize_t set_bench(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	int all = strncmp(buf, "all", strlen("all")) == 0;
+	int run = 0;
+
+	mutex_lock(&data->lock);
+
+	if (!data->bench_iterations) {
+		dev_err(dev, "No benchmark iterations configured\n");
+		goto out;
+	}
+
+	if (all || strncmp(buf, "enable", strlen("enable")) == 0) {
+		memset(&data->bench[VIRTUAL_BENCH_ENABLE], 0,
+		       sizeof(data->bench[0]));
+		memset(&data->bench[VIRTUAL_BENCH_DISABLE], 0,
+		       sizeof(data->bench[0]));
+		virtual_bench_enable(data);
+		run = 1;
+	}
+
+	if (all || strncmp(buf, "voltage", strlen("voltage")) == 0) {
+		memset(&data->bench[VIRTUAL_BENCH_VOLTAGE], 0,
+		       sizeof(data->bench[0]));
+		virtual_bench_voltage(data);
+		run = 1;
+	}
+
+	if (all || strncmp(buf, "mode", strlen("mode")) == 0) {
+		memset(&data->bench[VIRTUAL_BENCH_MODE], 0,
+		       sizeof(data->bench[0]));
+		virtual_bench_mode(data);
+		run = 1;
+	}
+
+	if (all || strncmp(buf, "optimum_mode", strlen("optimum_mode")) == 0) {
+		memset(&data->bench[VIRTUAL_BENCH_OPTIMUM_MODE], 0,
+		       sizeof(data->bench[0]));
+		virtual_bench_optimum_mode(data);
+		run = 1;
+	}
+
+	if (!run)
+		dev_err(dev, "Unknown benchmark\n");
+
+out:
+	mutex_unlock(&data->lock);
+
+	return count;
+}
+
+static void virtual_stress_record(struct virtual_stress_thread *thread,
+				  ktime_t start, int ret)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (ret < 0)
+		thread->errors++;
+	thread->ops++;
+	thread->total_ns += ns;
+	if (ns > thread->max_ns)
+		thread->max_ns = ns;
+}
+
+static int virtual_stress_thread(void *arg)
+{
+	struct virtual_stress_thread *thread = arg;
+	struct regulator *regulator = thread->regulator;
+	unsigned int i, iterations = thread->data->bench_iterations;
+	ktime_t start;
+	int ret, uV;
+
+	wait_for_completion(thread->start);
+
+	for (i = 0; i < iterations; i++) {
+		start = ktime_get();
+		ret = regulator_enable(regulator);
+		virtual_stress_record(thread, start, ret);
+		if (ret < 0)
+			continue;
+
+		/* while we hold it enabled the supply must be on */
+		if (regulator_is_enabled(regulator) <= 0)
+			thread->violations++;
+
+		if (thread->min_uV && thread->max_uV) {
+			start = ktime_get();
+			ret = regulator_set_voltage(regulator, thread->min_uV,
+						    thread->max_uV);
+			virtual_stress_record(thread, start, ret);
+
+			/* and within the range we asked for */
+			uV = regulator_get_voltage(regulator);
+			if (ret == 0 &&
+			    (uV < thread->min_uV || uV > thread->max_uV))
+				thread->violations++;
+		}
+
+		/* not every rail permits DRMS so don't count failures */
+		start = ktime_get();
+		regulator_set_optimum_mode(regulator,
+					   i & 1 ? thread->load_uA : 0);
+		virtual_stress_record(thread, start, 0);
+
+		start = ktime_get();
+		ret = regulator_disable(regulator);
+		virtual_stress_record(thread, start, ret);
+	}
+
+	regulator_set_optimum_mode(regulator, 0);
+	complete(&thread->done);
+
+	return 0;
+}
+
+static void virtual_stress_run(struct virtual_consumer_data *data)
+{
+	struct virtual_stress_stats *stats = &data->stress;
+	struct virtual_stress_thread *threads;
+	struct task_struct *task;
+	struct completion start;
+	unsigned int i, n = 0;
+	ktime_t run;
+	int span;
+
+	memset(stats, 0, sizeof(*stats));
+
+	threads = kcalloc(data->stress_threads, sizeof(*threads), GFP_KERNEL);
+	if (threads == NULL)
+		return;
+
+	init_completion(&start);
+
+	/* every thread accepts max_uV so the requests can be combined */
+	span = data->max_uV - data->min_uV;
+
+	for (n = 0; n < data->stress_threads; n++) {
+		threads[n].data = data;
+		threads[n].start = &start;
+		init_completion(&threads[n].done);
+		if (data->min_uV && data->max_uV && span >= 0) {
+			threads[n].min_uV = data->min_uV +
+				span / data->stress_threads * n;
+			threads[n].max_uV = data->max_uV;
+		}
+		threads[n].load_uA = 1000 * (n + 1);
+
+		threads[n].regulator = regulator_get(data->dev, data->supply);
+		if (IS_ERR(threads[n].regulator)) {
+			dev_err(data->dev, "Failed to get stress handle: %ld\n",
+				PTR_ERR(threads[n].regulator));
+			break;
+		}
+
+		task = kthread_run(virtual_stress_thread, &threads[n],
+				   "regstress/%u", n);
+		if (IS_ERR(task)) {
+			dev_err(data->dev, "Failed to start stress thread: %ld\n",
+				PTR_ERR(task));
+			regulator_put(threads[n].regulator);
+			break;
+		}
+	}
+
+	/* let everything go at once to maximise contention */
+	run = ktime_get();
+	complete_all(&start);
+
+	for (i = 0; i < n; i++) {
+		wait_for_completion(&threads[i].done);
+		regulator_put(threads[i].regulator);
+
+		stats->ops += threads[i].ops;
+		stats->errors += threads[i].errors;
+		stats->violations += threads[i].violations;
+		stats->total_ns += threads[i].total_ns;
+		if (threads[i].max_ns > stats->max_ns)
+			stats->max_ns = threads[i].max_ns;
+	}
+
+	stats->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+	stats->threads = n;
+
+	kfree(threads);
+}
+
+static ssize_t show_stress_threads(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", data->stress_threads);
+}
+
+static ssize_t set_stress_threads(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 10, &val) != 0)
+		return -EINVAL;
+
+	mutex_lock(&data->lock);
+	data->stress_threads = min_t(unsigned long, val,
+				     VIRTUAL_STRESS_MAX_THREADS);
+	mutex_unlock(&data->lock);
+
+	return count;
+}
+
+static ssize_t show_stress(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+	struct virtual_stress_stats *stats = &data->stress;
+	u64 avg_ns, ops;
+	ssize_t ret;
+
+	mutex_lock(&data->lock);
+
+	avg_ns = stats->ops ? div64_u64(stats->total_ns, stats->ops) : 0;
+	ops = stats->elapsed_ns ?
+		div64_u64((u64)stats->ops * NSEC_PER_SEC, stats->elapsed_ns) : 0;
+
+	ret = sprintf(buf, "threads %u ops %lu failed %lu violations %lu\n"
+		      "latency ns avg %llu max %llu, %llu ops/s\n",
+		      stats->threads, stats->ops, stats->errors,
+		      stats->violations, (unsigned long long)avg_ns,
+		      (unsigned long long)stats->max_ns,
+		      (unsigned long long)ops);
+
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+/*
+ * Writing anything runs bench_iterations on each of stress_threads
+ * kernel threads, each using its own handle on the supply.  Time spent
+ * waiting for the regulator lock is reported in the regulator's own
+ * stats/lock_contention.
+ */
+static ssize_t set_stress(struct device *dev, struct device_attribute *attr,
+			  const char *buf, size_t count)
+{
+	struct virtual_consumer_data *data = dev_get_drvdata(dev);
+
+	mutex_lock(&data->lock);
+
+	if (data->stress_threads && data->bench_iterations)
+		virtual_stress_run(data);
+	else
+		dev_err(dev, "No stress threads or iterations configured\n");
+
+	mutex_unlock(&data->lock);
+
+	return count;
+}
+
 static DEVICE_ATTR(min_microvolts, 0666, show_min_uV, set_min_uV);
 static DEVICE_ATTR(max_microvolts, 0666, show_max_uV, set_max_uV);
 static DEVICE_ATTR(min_microamps, 0666, show_min_uA, set_min_uA);
 static DEVICE_ATTR(max_microamps, 0666, show_max_uA, set_max_uA);
 static DEVICE_ATTR(mode, 0666, show_mode, set_mode);
+static DEVICE_ATTR(bench_iterations, 0666, show_bench_iterations,
+		   set_bench_iterations);
+static DEVICE_ATTR(bench, 0666, show_bench, set_bench);
+static DEVICE_ATTR(stress_threads, 0666, show_stress_threads,
+		   set_stress_threads);
+static DEVICE_ATTR(stress, 0666, show_stress, set_stress);
 
 struct device_attribute *attributes[] = {
 	&dev_attr_min_microvolts,
@@ -262,6 +840,10 @@ struct device_attribute *attributes[] = {
 	&dev_attr_min_microamps,
 	&dev_attr_max_microamps,
 	&dev_attr_mode,
+	&dev_attr_bench_iterations,
+	&dev_attr_bench,
+	&dev_attr_stress_threads,
+	&dev_attr_stress,
 };
 
 static int regulator_virtual_consumer_probe(struct platform_device *pdev)
@@ -277,6 +859,8 @@ static int regulator_virtual_consumer_probe(struct platform_device *pdev)
 	}
 
 	mutex_init(&drvdata->lock);
+	drvdata->dev = &pdev->dev;
+	drvdata->supply = reg_id;
 
 	drvdata->regulator = regulator_get(&pdev->dev, reg_id);
 	if (IS_ERR(drvdata->regulator)) {
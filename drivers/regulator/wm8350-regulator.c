@@ -17,9 +17,11 @@
 #include <linux/init.h>
 #include <linux/bitops.h>
 #include <linux/err.h>
+#include <linux/gpio.h>
 #include <linux/i2c.h>
 #include <linux/mfd/wm8350/core.h>
 #include <linux/mfd/wm8350/pmic.h>
+#include <linux/mfd/wm8350/supply.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/driver.h>
 #include <linux/regulator/machine.h>
@@ -92,28 +94,31 @@ static const int isink_cur[] = {
 	223191
 };
 
+/* the highest current in range, isink_cur[] is in ascending order */
 static int get_isink_val(int min_uA, int max_uA, u16 *setting)
 {
-	int i;
+	int lo = 0, hi = ARRAY_SIZE(isink_cur), mid;
 
-	for (i = ARRAY_SIZE(isink_cur) - 1; i >= 0; i--) {
-		if (min_uA <= isink_cur[i] && max_uA >= isink_cur[i]) {
-			*setting = i;
-			return 0;
-		}
+	/* find the first current above max_uA */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (isink_cur[mid] <= max_uA)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	return -EINVAL;
-}
 
-static inline int wm8350_ldo_val_to_mvolts(unsigned int val)
-{
-	if (val < 16)
-		return (val * 50) + 900;
-	else
-		return ((val - 16) * 100) + 1800;
+	if (lo == 0 || isink_cur[lo - 1] < min_uA)
+		return -EINVAL;
 
+	*setting = lo - 1;
+	return 0;
 }
 
+/* DCDC output voltage is 0.85V plus 25mV per selector */
+#define WM8350_DCDC_MIN_UV	850000
+#define WM8350_DCDC_STEP_UV	25000
+
 static inline unsigned int wm8350_ldo_mvolts_to_val(int mV)
 {
 	if (mV < 1800)
@@ -122,112 +127,193 @@ static inline unsigned int wm8350_ldo_mvolts_to_val(int mV)
 		return ((mV - 1800) / 100) + 16;
 }
 
-static inline int wm8350_dcdc_val_to_mvolts(unsigned int val)
+static inline unsigned int wm8350_dcdc_mvolts_to_val(int mV)
 {
-	return (val * 25) + 850;
+	return (mV - 850) / 25;
 }
 
-static inline unsigned int wm8350_dcdc_mvolts_to_val(int mV)
+/*
+ * Register layout of each regulator, indexed by regulator ID.  Registers
+ * a regulator doesn't have are left as zero.
+ */
+struct wm8350_regulator_info {
+	u16 control_reg;	/* voltage select, or ISINK current select */
+	u16 vsel_mask;		/* zero if the voltage can't be set */
+	u16 timeouts_reg;	/* power up sequencer slots */
+	u16 low_power_reg;	/* hibernate configuration */
+	u16 force_pwm_reg;
+	u16 enable_reg;
+	u16 enable_mask;
+	u16 flash_reg;
+};
+
+static const struct wm8350_regulator_info wm8350_info[NUM_WM8350_REGULATORS] = {
+	[WM8350_DCDC_1] = {
+		.control_reg = WM8350_DCDC1_CONTROL,
+		.vsel_mask = WM8350_DC1_VSEL_MASK,
+		.timeouts_reg = WM8350_DCDC1_TIMEOUTS,
+		.low_power_reg = WM8350_DCDC1_LOW_POWER,
+		.force_pwm_reg = WM8350_DCDC1_FORCE_PWM,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 0,
+	},
+	[WM8350_DCDC_2] = {
+		.control_reg = WM8350_DCDC2_CONTROL,
+		.timeouts_reg = WM8350_DCDC2_TIMEOUTS,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 1,
+	},
+	[WM8350_DCDC_3] = {
+		.control_reg = WM8350_DCDC3_CONTROL,
+		.vsel_mask = WM8350_DC1_VSEL_MASK,
+		.timeouts_reg = WM8350_DCDC3_TIMEOUTS,
+		.low_power_reg = WM8350_DCDC3_LOW_POWER,
+		.force_pwm_reg = WM8350_DCDC3_FORCE_PWM,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 2,
+	},
+	[WM8350_DCDC_4] = {
+		.control_reg = WM8350_DCDC4_CONTROL,
+		.vsel_mask = WM8350_DC1_VSEL_MASK,
+		.timeouts_reg = WM8350_DCDC4_TIMEOUTS,
+		.low_power_reg = WM8350_DCDC4_LOW_POWER,
+		.force_pwm_reg = WM8350_DCDC4_FORCE_PWM,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 3,
+	},
+	[WM8350_DCDC_5] = {
+		.control_reg = WM8350_DCDC5_CONTROL,
+		.timeouts_reg = WM8350_DCDC5_TIMEOUTS,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 4,
+	},
+	[WM8350_DCDC_6] = {
+		.control_reg = WM8350_DCDC6_CONTROL,
+		.vsel_mask = WM8350_DC1_VSEL_MASK,
+		.timeouts_reg = WM8350_DCDC6_TIMEOUTS,
+		.low_power_reg = WM8350_DCDC6_LOW_POWER,
+		.force_pwm_reg = WM8350_DCDC6_FORCE_PWM,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 5,
+	},
+	[WM8350_LDO_1] = {
+		.control_reg = WM8350_LDO1_CONTROL,
+		.vsel_mask = WM8350_LDO1_VSEL_MASK,
+		.timeouts_reg = WM8350_LDO1_TIMEOUTS,
+		.low_power_reg = WM8350_LDO1_LOW_POWER,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 8,
+	},
+	[WM8350_LDO_2] = {
+		.control_reg = WM8350_LDO2_CONTROL,
+		.vsel_mask = WM8350_LDO1_VSEL_MASK,
+		.timeouts_reg = WM8350_LDO2_TIMEOUTS,
+		.low_power_reg = WM8350_LDO2_LOW_POWER,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 9,
+	},
+	[WM8350_LDO_3] = {
+		.control_reg = WM8350_LDO3_CONTROL,
+		.vsel_mask = WM8350_LDO1_VSEL_MASK,
+		.timeouts_reg = WM8350_LDO3_TIMEOUTS,
+		.low_power_reg = WM8350_LDO3_LOW_POWER,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 10,
+	},
+	[WM8350_LDO_4] = {
+		.control_reg = WM8350_LDO4_CONTROL,
+		.vsel_mask = WM8350_LDO1_VSEL_MASK,
+		.timeouts_reg = WM8350_LDO4_TIMEOUTS,
+		.low_power_reg = WM8350_LDO4_LOW_POWER,
+		.enable_reg = WM8350_DCDC_LDO_REQUESTED,
+		.enable_mask = 1 << 11,
+	},
+	[WM8350_ISINK_A] = {
+		.control_reg = WM8350_CURRENT_SINK_DRIVER_A,
+		.enable_reg = WM8350_POWER_MGMT_7,
+		.enable_mask = WM8350_CS1_ENA,
+		.flash_reg = WM8350_CSA_FLASH_CONTROL,
+	},
+	[WM8350_ISINK_B] = {
+		.control_reg = WM8350_CURRENT_SINK_DRIVER_B,
+		.enable_reg = WM8350_POWER_MGMT_7,
+		.enable_mask = WM8350_CS2_ENA,
+		.flash_reg = WM8350_CSB_FLASH_CONTROL,
+	},
+	[WM8350_CHARGER] = {
+		.control_reg = WM8350_BATTERY_CHARGER_CONTROL_2,
+		.enable_reg = WM8350_BATTERY_CHARGER_CONTROL_1,
+		.enable_mask = WM8350_CHG_ENA_R168,
+	},
+};
+
+static inline const struct wm8350_regulator_info *
+rdev_to_info(struct regulator_dev *rdev)
 {
-	return (mV - 850) / 25;
+	return &wm8350_info[rdev_get_id(rdev)];
 }
 
 static int wm8350_isink_set_current(struct regulator_dev *rdev, int min_uA,
 	int max_uA)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int isink = rdev_get_id(rdev);
-	u16 val, setting;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
+	u16 setting;
 	int ret;
 
 	ret = get_isink_val(min_uA, max_uA, &setting);
 	if (ret != 0)
 		return ret;
 
-	switch (isink) {
-	case WM8350_ISINK_A:
-		val = wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_A) &
-		    ~WM8350_CS1_ISEL_MASK;
-		wm8350_reg_write(wm8350, WM8350_CURRENT_SINK_DRIVER_A,
-				 val | setting);
-		break;
-	case WM8350_ISINK_B:
-		val = wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_B) &
-		    ~WM8350_CS1_ISEL_MASK;
-		wm8350_reg_write(wm8350, WM8350_CURRENT_SINK_DRIVER_B,
-				 val | setting);
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	return 0;
+	/* both ISINKs have the same current bits */
+	return wm8350_reg_update_bits(wm8350, info->control_reg,
+				      WM8350_CS1_ISEL_MASK, setting);
 }
 
 static int wm8350_isink_get_current(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int isink = rdev_get_id(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 	u16 val;
 
-	switch (isink) {
-	case WM8350_ISINK_A:
-		val = wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_A) &
-		    WM8350_CS1_ISEL_MASK;
-		break;
-	case WM8350_ISINK_B:
-		val = wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_B) &
-		    WM8350_CS1_ISEL_MASK;
-		break;
-	default:
-		return 0;
-	}
+	val = wm8350_reg_read(wm8350, info->control_reg) & WM8350_CS1_ISEL_MASK;
 
 	return (isink_cur[val] + 50) / 100;
 }
 
+/* the DCDC supplying an ISINK, only DCDC2 and DCDC5 can */
+static int wm8350_isink_dcdc(struct wm8350 *wm8350, int isink)
+{
+	int dcdc;
+
+	if (isink == WM8350_ISINK_A)
+		dcdc = wm8350->pmic.isink_A_dcdc;
+	else
+		dcdc = wm8350->pmic.isink_B_dcdc;
+
+	if (dcdc != WM8350_DCDC_2 && dcdc != WM8350_DCDC_5)
+		return -EINVAL;
+
+	return dcdc;
+}
+
 /* turn on ISINK followed by DCDC */
 static int wm8350_isink_enable(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
 	int isink = rdev_get_id(rdev);
-
-	switch (isink) {
-	case WM8350_ISINK_A:
-		switch (wm8350->pmic.isink_A_dcdc) {
-		case WM8350_DCDC_2:
-		case WM8350_DCDC_5:
-			wm8350_set_bits(wm8350, WM8350_POWER_MGMT_7,
-					WM8350_CS1_ENA);
-			wm8350_set_bits(wm8350, WM8350_CSA_FLASH_CONTROL,
-					WM8350_CS1_DRIVE);
-			wm8350_set_bits(wm8350, WM8350_DCDC_LDO_REQUESTED,
-					1 << (wm8350->pmic.isink_A_dcdc -
-					      WM8350_DCDC_1));
-			break;
-		default:
-			return -EINVAL;
-		}
-		break;
-	case WM8350_ISINK_B:
-		switch (wm8350->pmic.isink_B_dcdc) {
-		case WM8350_DCDC_2:
-		case WM8350_DCDC_5:
-			wm8350_set_bits(wm8350, WM8350_POWER_MGMT_7,
-					WM8350_CS2_ENA);
-			wm8350_set_bits(wm8350, WM8350_CSB_FLASH_CONTROL,
-					WM8350_CS2_DRIVE);
-			wm8350_set_bits(wm8350, WM8350_DCDC_LDO_REQUESTED,
-					1 << (wm8350->pmic.isink_B_dcdc -
-					      WM8350_DCDC_1));
-			break;
-		default:
-			return -EINVAL;
-		}
-		break;
-	default:
-		return -EINVAL;
-	}
+	const struct wm8350_regulator_info *info = &wm8350_info[isink];
+	int dcdc;
+
+	dcdc = wm8350_isink_dcdc(wm8350, isink);
+	if (dcdc < 0)
+		return dcdc;
+
+	/* both ISINKs have the same flash control bits */
+	wm8350_set_bits(wm8350, info->enable_reg, info->enable_mask);
+	wm8350_set_bits(wm8350, info->flash_reg, WM8350_CS1_DRIVE);
+	wm8350_set_bits(wm8350, wm8350_info[dcdc].enable_reg,
+			wm8350_info[dcdc].enable_mask);
 	return 0;
 }
 
@@ -235,552 +321,365 @@ static int wm8350_isink_disable(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
 	int isink = rdev_get_id(rdev);
+	const struct wm8350_regulator_info *info = &wm8350_info[isink];
+	int dcdc;
 
-	switch (isink) {
-	case WM8350_ISINK_A:
-		switch (wm8350->pmic.isink_A_dcdc) {
-		case WM8350_DCDC_2:
-		case WM8350_DCDC_5:
-			wm8350_clear_bits(wm8350, WM8350_DCDC_LDO_REQUESTED,
-					  1 << (wm8350->pmic.isink_A_dcdc -
-						WM8350_DCDC_1));
-			wm8350_clear_bits(wm8350, WM8350_POWER_MGMT_7,
-					  WM8350_CS1_ENA);
-			break;
-		default:
-			return -EINVAL;
-		}
-		break;
-	case WM8350_ISINK_B:
-		switch (wm8350->pmic.isink_B_dcdc) {
-		case WM8350_DCDC_2:
-		case WM8350_DCDC_5:
-			wm8350_clear_bits(wm8350, WM8350_DCDC_LDO_REQUESTED,
-					  1 << (wm8350->pmic.isink_B_dcdc -
-						WM8350_DCDC_1));
-			wm8350_clear_bits(wm8350, WM8350_POWER_MGMT_7,
-					  WM8350_CS2_ENA);
-			break;
-		default:
-			return -EINVAL;
-		}
-		break;
-	default:
-		return -EINVAL;
-	}
+	dcdc = wm8350_isink_dcdc(wm8350, isink);
+	if (dcdc < 0)
+		return dcdc;
+
+	wm8350_clear_bits(wm8350, wm8350_info[dcdc].enable_reg,
+			  wm8350_info[dcdc].enable_mask);
+	wm8350_clear_bits(wm8350, info->enable_reg, info->enable_mask);
 	return 0;
 }
 
 static int wm8350_isink_is_enabled(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int isink = rdev_get_id(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	switch (isink) {
-	case WM8350_ISINK_A:
-		return wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_A) &
-		    0x8000;
-	case WM8350_ISINK_B:
-		return wm8350_reg_read(wm8350, WM8350_CURRENT_SINK_DRIVER_B) &
-		    0x8000;
-	}
-	return -EINVAL;
+	return wm8350_reg_read(wm8350, info->control_reg) & 0x8000;
 }
 
-int wm8350_isink_set_flash(struct wm8350 *wm8350, int isink, u16 mode,
-			   u16 trigger, u16 duration, u16 on_ramp, u16 off_ramp,
-			   u16 drive)
+/* fast charge current limit in 50mA steps, from 0 to 750mA */
+#define WM8350_CHG_ISEL_STEP_UA		50000
+
+/* the charger registers can only be written with the security key set */
+static int wm8350_charger_update_bits(struct wm8350 *wm8350, u16 reg,
+				      u16 mask, u16 val)
 {
-	switch (isink) {
-	case WM8350_ISINK_A:
-		wm8350_reg_write(wm8350, WM8350_CSA_FLASH_CONTROL,
-				 (mode ? WM8350_CS1_FLASH_MODE : 0) |
-				 (trigger ? WM8350_CS1_TRIGSRC : 0) |
-				 duration | on_ramp | off_ramp | drive);
-		break;
-	case WM8350_ISINK_B:
-		wm8350_reg_write(wm8350, WM8350_CSB_FLASH_CONTROL,
-				 (mode ? WM8350_CS2_FLASH_MODE : 0) |
-				 (trigger ? WM8350_CS2_TRIGSRC : 0) |
-				 duration | on_ramp | off_ramp | drive);
-		break;
-	default:
-		return -EINVAL;
-	}
-	return 0;
+	int ret;
+
+	ret = wm8350_reg_unlock(wm8350);
+	if (ret != 0)
+		return ret;
+	ret = wm8350_reg_update_bits(wm8350, reg, mask, val);
+	wm8350_reg_lock(wm8350);
+
+	return ret;
 }
-EXPORT_SYMBOL_GPL(wm8350_isink_set_flash);
 
-static int wm8350_dcdc_set_voltage(struct regulator_dev *rdev, int min_uV,
-	int max_uV)
+static int wm8350_charger_set_current(struct regulator_dev *rdev,
+				      int min_uA, int max_uA)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, dcdc = rdev_get_id(rdev), mV,
-		min_mV = min_uV / 1000, max_mV = max_uV / 1000;
-	u16 val;
-
-	if (min_mV < 850 || min_mV > 4025)
-		return -EINVAL;
-	if (max_mV < 850 || max_mV > 4025)
-		return -EINVAL;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
+	int sel = max_uA / WM8350_CHG_ISEL_STEP_UA;
 
-	/* step size is 25mV */
-	mV = (min_mV - 826) / 25;
-	if (wm8350_dcdc_val_to_mvolts(mV) > max_mV)
-		return -EINVAL;
-	BUG_ON(wm8350_dcdc_val_to_mvolts(mV) < min_mV);
-
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		volt_reg = WM8350_DCDC1_CONTROL;
-		break;
-	case WM8350_DCDC_3:
-		volt_reg = WM8350_DCDC3_CONTROL;
-		break;
-	case WM8350_DCDC_4:
-		volt_reg = WM8350_DCDC4_CONTROL;
-		break;
-	case WM8350_DCDC_6:
-		volt_reg = WM8350_DCDC6_CONTROL;
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
-	default:
+	if (sel > WM8350_CHG_ISEL_MASK)
+		sel = WM8350_CHG_ISEL_MASK;
+	if (sel * WM8350_CHG_ISEL_STEP_UA < min_uA)
 		return -EINVAL;
-	}
 
-	/* all DCDCs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_DC1_VSEL_MASK;
-	wm8350_reg_write(wm8350, volt_reg, val | mV);
-	return 0;
+	return wm8350_charger_update_bits(wm8350, info->control_reg,
+					  WM8350_CHG_ISEL_MASK, sel);
 }
 
-static int wm8350_dcdc_get_voltage(struct regulator_dev *rdev)
+static int wm8350_charger_get_current(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, dcdc = rdev_get_id(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 	u16 val;
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		volt_reg = WM8350_DCDC1_CONTROL;
-		break;
-	case WM8350_DCDC_3:
-		volt_reg = WM8350_DCDC3_CONTROL;
-		break;
-	case WM8350_DCDC_4:
-		volt_reg = WM8350_DCDC4_CONTROL;
-		break;
-	case WM8350_DCDC_6:
-		volt_reg = WM8350_DCDC6_CONTROL;
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
-	default:
-		return -EINVAL;
-	}
+	val = wm8350_reg_read(wm8350, info->control_reg) & WM8350_CHG_ISEL_MASK;
 
-	/* all DCDCs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & WM8350_DC1_VSEL_MASK;
-	return wm8350_dcdc_val_to_mvolts(val) * 1000;
+	return val * WM8350_CHG_ISEL_STEP_UA;
 }
 
-static int wm8350_dcdc_set_suspend_voltage(struct regulator_dev *rdev, int uV)
+static int wm8350_charger_enable(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, mV = uV / 1000, dcdc = rdev_get_id(rdev);
-	u16 val;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	dev_dbg(wm8350->dev, "%s %d mV %d\n", __func__, dcdc, mV);
-
-	if (mV && (mV < 850 || mV > 4025)) {
-		dev_err(wm8350->dev,
-			"DCDC%d suspend voltage %d mV out of range\n",
-			dcdc, mV);
-		return -EINVAL;
-	}
-	if (mV == 0)
-		mV = 850;
+	return wm8350_charger_update_bits(wm8350, info->enable_reg,
+					  info->enable_mask, info->enable_mask);
+}
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		volt_reg = WM8350_DCDC1_LOW_POWER;
-		break;
-	case WM8350_DCDC_3:
-		volt_reg = WM8350_DCDC3_LOW_POWER;
-		break;
-	case WM8350_DCDC_4:
-		volt_reg = WM8350_DCDC4_LOW_POWER;
-		break;
-	case WM8350_DCDC_6:
-		volt_reg = WM8350_DCDC6_LOW_POWER;
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
-	default:
-		return -EINVAL;
-	}
+static int wm8350_charger_disable(struct regulator_dev *rdev)
+{
+	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	/* all DCDCs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_DC1_VSEL_MASK;
-	wm8350_reg_write(wm8350, volt_reg,
-			 val | wm8350_dcdc_mvolts_to_val(mV));
-	return 0;
+	return wm8350_charger_update_bits(wm8350, info->enable_reg,
+					  info->enable_mask, 0);
 }
 
-static int wm8350_dcdc_set_suspend_enable(struct regulator_dev *rdev)
+static int wm8350_charger_is_enabled(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 val;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC1_LOW_POWER)
-			& ~WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC1_LOW_POWER,
-			wm8350->pmic.dcdc1_hib_mode);
-		break;
-	case WM8350_DCDC_3:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC3_LOW_POWER)
-			& ~WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC3_LOW_POWER,
-			wm8350->pmic.dcdc3_hib_mode);
-		break;
-	case WM8350_DCDC_4:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC4_LOW_POWER)
-			& ~WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC4_LOW_POWER,
-			wm8350->pmic.dcdc4_hib_mode);
-		break;
-	case WM8350_DCDC_6:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC6_LOW_POWER)
-			& ~WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC6_LOW_POWER,
-			wm8350->pmic.dcdc6_hib_mode);
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
-	default:
+	return !!(wm8350_reg_read(wm8350, info->enable_reg) &
+		  info->enable_mask);
+}
+
+int wm8350_isink_set_flash(struct wm8350 *wm8350, int isink, u16 mode,
+			   u16 trigger, u16 duration, u16 on_ramp, u16 off_ramp,
+			   u16 drive)
+{
+	if (isink < WM8350_ISINK_A || isink > WM8350_ISINK_B)
 		return -EINVAL;
-	}
 
+	wm8350_reg_write(wm8350, wm8350_info[isink].flash_reg,
+			 (mode ? WM8350_CS1_FLASH_MODE : 0) |
+			 (trigger ? WM8350_CS1_TRIGSRC : 0) |
+			 duration | on_ramp | off_ramp | drive);
 	return 0;
 }
+EXPORT_SYMBOL_GPL(wm8350_isink_set_flash);
 
-static int wm8350_dcdc_set_suspend_disable(struct regulator_dev *rdev)
+/**
+ * wm8350_isink_set_ramp - set the hardware ramp times of an ISINK
+ * @wm8350: device
+ * @isink: WM8350_ISINK_A or WM8350_ISINK_B
+ * @on_ramp: one of WM8350_ISINK_FLASH_ON_*
+ * @off_ramp: one of WM8350_ISINK_FLASH_OFF_*
+ *
+ * The ISINK ramps its current up from zero when it is enabled and back
+ * down when it is disabled, so a backlight can be faded in or out by a
+ * single regulator_enable() or regulator_disable() rather than stepping
+ * the current limit from a timer.  The rest of the flash configuration
+ * is left alone.  Each ramp setting gives the shorter of its two times
+ * in flash mode and the longer otherwise.
+ */
+int wm8350_isink_set_ramp(struct wm8350 *wm8350, int isink, u16 on_ramp,
+			  u16 off_ramp)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 val;
+	if (isink < WM8350_ISINK_A || isink > WM8350_ISINK_B)
+		return -EINVAL;
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC1_LOW_POWER);
-		wm8350->pmic.dcdc1_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC1_LOW_POWER,
-			WM8350_DCDC_HIB_MODE_DIS);
-		break;
-	case WM8350_DCDC_3:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC3_LOW_POWER);
-		wm8350->pmic.dcdc3_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC3_LOW_POWER,
-			WM8350_DCDC_HIB_MODE_DIS);
-		break;
-	case WM8350_DCDC_4:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC4_LOW_POWER);
-		wm8350->pmic.dcdc4_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC4_LOW_POWER,
-			WM8350_DCDC_HIB_MODE_DIS);
-		break;
-	case WM8350_DCDC_6:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC6_LOW_POWER);
-		wm8350->pmic.dcdc6_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC6_LOW_POWER,
-			WM8350_DCDC_HIB_MODE_DIS);
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
-	default:
+	/* both ISINKs have the same ramp bits */
+	if (on_ramp & ~WM8350_CS1_ON_RAMP_MASK ||
+	    off_ramp & ~WM8350_CS1_OFF_RAMP_MASK)
 		return -EINVAL;
-	}
 
-	return 0;
+	return wm8350_reg_update_bits(wm8350, wm8350_info[isink].flash_reg,
+				      WM8350_CS1_ON_RAMP_MASK |
+				      WM8350_CS1_OFF_RAMP_MASK,
+				      on_ramp | off_ramp);
 }
+EXPORT_SYMBOL_GPL(wm8350_isink_set_ramp);
 
-static int wm8350_dcdc25_set_suspend_enable(struct regulator_dev *rdev)
+static int wm8350_set_voltage_sel(struct regulator_dev *rdev,
+				  unsigned selector)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 val;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	switch (dcdc) {
-	case WM8350_DCDC_2:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC2_CONTROL)
-		    & ~WM8350_DC2_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC2_CONTROL, val |
-				 WM8350_DC2_HIB_MODE_ACTIVE);
-		break;
-	case WM8350_DCDC_5:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC5_CONTROL)
-		    & ~WM8350_DC2_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC5_CONTROL, val |
-				 WM8350_DC5_HIB_MODE_ACTIVE);
-		break;
-	default:
+	if (!info->vsel_mask || selector > info->vsel_mask)
 		return -EINVAL;
-	}
-	return 0;
+
+	return wm8350_reg_update_bits(wm8350, info->control_reg,
+				      info->vsel_mask, selector);
 }
 
-static int wm8350_dcdc25_set_suspend_disable(struct regulator_dev *rdev)
+static int wm8350_get_voltage_sel(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 val;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	switch (dcdc) {
-	case WM8350_DCDC_2:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC2_CONTROL)
-		    & ~WM8350_DC2_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC2_CONTROL, val |
-				 WM8350_DC2_HIB_MODE_DISABLE);
-		break;
-	case WM8350_DCDC_5:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC5_CONTROL)
-		    & ~WM8350_DC2_HIB_MODE_MASK;
-		wm8350_reg_write(wm8350, WM8350_DCDC5_CONTROL, val |
-				 WM8350_DC2_HIB_MODE_DISABLE);
-		break;
-	default:
+	if (!info->vsel_mask)
 		return -EINVAL;
-	}
-	return 0;
+
+	return wm8350_reg_read(wm8350, info->control_reg) & info->vsel_mask;
 }
 
-static int wm8350_dcdc_set_suspend_mode(struct regulator_dev *rdev,
-	unsigned int mode)
-{
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 *hib_mode;
+/* the suspend configuration of every DCDC and LDO is within this block */
+#define WM8350_SUSPEND_FIRST	WM8350_DCDC1_CONTROL
+#define WM8350_SUSPEND_REGS	(WM8350_LDO4_LOW_POWER - WM8350_SUSPEND_FIRST + 1)
 
+static u16 *wm8350_dcdc_hib_mode(struct wm8350 *wm8350, int dcdc)
+{
 	switch (dcdc) {
 	case WM8350_DCDC_1:
-		hib_mode = &wm8350->pmic.dcdc1_hib_mode;
-		break;
+		return &wm8350->pmic.dcdc1_hib_mode;
 	case WM8350_DCDC_3:
-		hib_mode = &wm8350->pmic.dcdc3_hib_mode;
-		break;
+		return &wm8350->pmic.dcdc3_hib_mode;
 	case WM8350_DCDC_4:
-		hib_mode = &wm8350->pmic.dcdc4_hib_mode;
-		break;
+		return &wm8350->pmic.dcdc4_hib_mode;
 	case WM8350_DCDC_6:
-		hib_mode = &wm8350->pmic.dcdc6_hib_mode;
-		break;
-	case WM8350_DCDC_2:
-	case WM8350_DCDC_5:
+		return &wm8350->pmic.dcdc6_hib_mode;
 	default:
-		return -EINVAL;
+		return NULL;
 	}
-
-	switch (mode) {
-	case REGULATOR_MODE_NORMAL:
-		*hib_mode = WM8350_DCDC_HIB_MODE_IMAGE;
-		break;
-	case REGULATOR_MODE_IDLE:
-		*hib_mode = WM8350_DCDC_HIB_MODE_STANDBY;
-		break;
-	case REGULATOR_MODE_STANDBY:
-		*hib_mode = WM8350_DCDC_HIB_MODE_LDO_IM;
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	return 0;
 }
 
-static int wm8350_ldo_set_suspend_voltage(struct regulator_dev *rdev, int uV)
+static int wm8350_dcdc_suspend_state(struct wm8350 *wm8350, int dcdc,
+				     struct regulator_state *state, u16 *regs)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, mV = uV / 1000, ldo = rdev_get_id(rdev);
-	u16 val;
-
-	dev_dbg(wm8350->dev, "%s %d mV %d\n", __func__, ldo, mV);
-
-	if (mV < 900 || mV > 3300) {
-		dev_err(wm8350->dev, "LDO%d voltage %d mV out of range\n",
-			ldo, mV);
-		return -EINVAL;
+	const struct wm8350_regulator_info *info = &wm8350_info[dcdc];
+	int mV = state->uV / 1000;
+	u16 *val, *hib_mode;
+	int enabled;
+
+	if (!info->low_power_reg) {
+		/* DCDC2 and DCDC5 only have a hibernate enable */
+		if (!state->enabled && !state->disabled)
+			return 0;
+		if (wm8350->pmic.hw_ena & (1 << dcdc)) {
+			dev_warn(wm8350->dev, "DCDC%d suspend state ignored, "
+				 "under hardware enable\n", dcdc);
+			return 0;
+		}
+		val = &regs[info->control_reg - WM8350_SUSPEND_FIRST];
+		*val &= ~WM8350_DC2_HIB_MODE_MASK;
+		if (state->enabled)
+			*val |= WM8350_DC2_HIB_MODE_ACTIVE <<
+				WM8350_DC2_HIB_MODE_SHIFT;
+		return 0;
 	}
+	val = &regs[info->low_power_reg - WM8350_SUSPEND_FIRST];
+	hib_mode = wm8350_dcdc_hib_mode(wm8350, dcdc);
 
-	switch (ldo) {
-	case WM8350_LDO_1:
-		volt_reg = WM8350_LDO1_LOW_POWER;
-		break;
-	case WM8350_LDO_2:
-		volt_reg = WM8350_LDO2_LOW_POWER;
-		break;
-	case WM8350_LDO_3:
-		volt_reg = WM8350_LDO3_LOW_POWER;
-		break;
-	case WM8350_LDO_4:
-		volt_reg = WM8350_LDO4_LOW_POWER;
-		break;
-	default:
-		return -EINVAL;
+	if (wm8350->pmic.hw_ena & (1 << dcdc)) {
+		dev_warn(wm8350->dev,
+			 "DCDC%d suspend state ignored, under hardware enable\n",
+			 dcdc);
+		return 0;
 	}
 
-	/* all LDOs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_LDO1_VSEL_MASK;
-	wm8350_reg_write(wm8350, volt_reg,
-			 val | wm8350_ldo_mvolts_to_val(mV));
-	return 0;
-}
-
-static int wm8350_ldo_set_suspend_enable(struct regulator_dev *rdev)
-{
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, ldo = rdev_get_id(rdev);
-	u16 val;
-
-	switch (ldo) {
-	case WM8350_LDO_1:
-		volt_reg = WM8350_LDO1_LOW_POWER;
-		break;
-	case WM8350_LDO_2:
-		volt_reg = WM8350_LDO2_LOW_POWER;
-		break;
-	case WM8350_LDO_3:
-		volt_reg = WM8350_LDO3_LOW_POWER;
-		break;
-	case WM8350_LDO_4:
-		volt_reg = WM8350_LDO4_LOW_POWER;
-		break;
-	default:
-		return -EINVAL;
+	/* the image voltage is the DVS alternate while DVS is in use */
+	if (state->uV > 0 && (wm8350->pmic.dvs & (1 << dcdc))) {
+		dev_warn(wm8350->dev,
+			 "DCDC%d suspend voltage ignored, used for DVS\n", dcdc);
+	} else if (state->uV > 0) {
+		if (mV < 850 || mV > 4025) {
+			dev_err(wm8350->dev,
+				"DCDC%d suspend voltage %d mV out of range\n",
+				dcdc, mV);
+			return -EINVAL;
+		}
+		*val = (*val & ~WM8350_DC1_VSEL_MASK) |
+			wm8350_dcdc_mvolts_to_val(mV);
 	}
 
-	/* all LDOs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_LDO1_HIB_MODE_MASK;
-	wm8350_reg_write(wm8350, volt_reg, val);
-	return 0;
-}
+	/* keep the current hibernate status unless told otherwise */
+	if (state->enabled || state->disabled)
+		enabled = state->enabled;
+	else
+		enabled = (*val & WM8350_DCDC_HIB_MODE_MASK) !=
+			WM8350_DCDC_HIB_MODE_DIS;
 
-static int wm8350_ldo_set_suspend_disable(struct regulator_dev *rdev)
-{
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, ldo = rdev_get_id(rdev);
-	u16 val;
+	/* remember the hibernate mode while disabled so that it can be
+	 * restored when the DCDC is next enabled in hibernate */
+	if (!enabled &&
+	    (*val & WM8350_DCDC_HIB_MODE_MASK) != WM8350_DCDC_HIB_MODE_DIS)
+		*hib_mode = *val & WM8350_DCDC_HIB_MODE_MASK;
 
-	switch (ldo) {
-	case WM8350_LDO_1:
-		volt_reg = WM8350_LDO1_LOW_POWER;
+	switch (state->mode) {
+	case 0:
 		break;
-	case WM8350_LDO_2:
-		volt_reg = WM8350_LDO2_LOW_POWER;
+	case REGULATOR_MODE_NORMAL:
+		*hib_mode = WM8350_DCDC_HIB_MODE_IMAGE;
 		break;
-	case WM8350_LDO_3:
-		volt_reg = WM8350_LDO3_LOW_POWER;
+	case REGULATOR_MODE_IDLE:
+		*hib_mode = WM8350_DCDC_HIB_MODE_STANDBY;
 		break;
-	case WM8350_LDO_4:
-		volt_reg = WM8350_LDO4_LOW_POWER;
+	case REGULATOR_MODE_STANDBY:
+		*hib_mode = WM8350_DCDC_HIB_MODE_LDO_IM;
 		break;
 	default:
 		return -EINVAL;
 	}
 
-	/* all LDOs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_LDO1_HIB_MODE_MASK;
-	wm8350_reg_write(wm8350, volt_reg, WM8350_LDO1_HIB_MODE_DIS);
+	*val &= ~WM8350_DCDC_HIB_MODE_MASK;
+	if (enabled)
+		*val |= *hib_mode;
+	else
+		*val |= WM8350_DCDC_HIB_MODE_DIS;
+
 	return 0;
 }
 
-static int wm8350_ldo_set_voltage(struct regulator_dev *rdev, int min_uV,
-	int max_uV)
+static int wm8350_ldo_suspend_state(struct wm8350 *wm8350, int ldo,
+				    struct regulator_state *state, u16 *regs)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, ldo = rdev_get_id(rdev), mV, min_mV = min_uV / 1000,
-		max_mV = max_uV / 1000;
-	u16 val;
+	int mV = state->uV / 1000;
+	u16 *val;
 
-	if (min_mV < 900 || min_mV > 3300)
-		return -EINVAL;
-	if (max_mV < 900 || max_mV > 3300)
-		return -EINVAL;
+	val = &regs[wm8350_info[ldo].low_power_reg - WM8350_SUSPEND_FIRST];
 
-	if (min_mV < 1800) {
-		/* step size is 50mV < 1800mV */
-		mV = (min_mV - 851) / 50;
-		if (wm8350_ldo_val_to_mvolts(mV) > max_mV)
-			return -EINVAL;
-		BUG_ON(wm8350_ldo_val_to_mvolts(mV) < min_mV);
-	} else {
-		/* step size is 100mV > 1800mV */
-		mV = ((min_mV - 1701) / 100) + 16;
-		if (wm8350_ldo_val_to_mvolts(mV) > max_mV)
+	if (wm8350->pmic.hw_ena & (1 << ldo)) {
+		dev_warn(wm8350->dev,
+			 "LDO%d suspend state ignored, under hardware enable\n",
+			 ldo);
+		return 0;
+	}
+
+	if (state->uV > 0) {
+		if (mV < 900 || mV > 3300) {
+			dev_err(wm8350->dev, "LDO%d voltage %d mV out of range\n",
+				ldo, mV);
 			return -EINVAL;
-		BUG_ON(wm8350_ldo_val_to_mvolts(mV) < min_mV);
+		}
+		/* all LDOs have same mV bits */
+		*val = (*val & ~WM8350_LDO1_VSEL_MASK) |
+			wm8350_ldo_mvolts_to_val(mV);
 	}
 
-	switch (ldo) {
-	case WM8350_LDO_1:
-		volt_reg = WM8350_LDO1_CONTROL;
-		break;
-	case WM8350_LDO_2:
-		volt_reg = WM8350_LDO2_CONTROL;
-		break;
-	case WM8350_LDO_3:
-		volt_reg = WM8350_LDO3_CONTROL;
-		break;
-	case WM8350_LDO_4:
-		volt_reg = WM8350_LDO4_CONTROL;
-		break;
-	default:
-		return -EINVAL;
+	if (state->enabled || state->disabled) {
+		*val &= ~WM8350_LDO1_HIB_MODE_MASK;
+		if (state->disabled)
+			*val |= WM8350_LDO1_HIB_MODE_DIS;
 	}
 
-	/* all LDOs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & ~WM8350_LDO1_VSEL_MASK;
-	wm8350_reg_write(wm8350, volt_reg, val | mV);
 	return 0;
 }
 
-static int wm8350_ldo_get_voltage(struct regulator_dev *rdev)
+/*
+ * Work out the suspend configuration of all the DCDCs and LDOs from the
+ * register cache then write back only the registers which changed, each
+ * run of adjacent registers in a single bus transfer.
+ */
+static int wm8350_set_suspend_states(struct regulator_dev **rdevs,
+				     struct regulator_state **states, int n)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int volt_reg, ldo = rdev_get_id(rdev);
-	u16 val;
+	struct wm8350 *wm8350 = rdev_get_drvdata(rdevs[0]);
+	u16 old[WM8350_SUSPEND_REGS], regs[WM8350_SUSPEND_REGS];
+	int i, end, id, ret;
 
-	switch (ldo) {
-	case WM8350_LDO_1:
-		volt_reg = WM8350_LDO1_CONTROL;
-		break;
-	case WM8350_LDO_2:
-		volt_reg = WM8350_LDO2_CONTROL;
-		break;
-	case WM8350_LDO_3:
-		volt_reg = WM8350_LDO3_CONTROL;
-		break;
-	case WM8350_LDO_4:
-		volt_reg = WM8350_LDO4_CONTROL;
-		break;
-	default:
-		return -EINVAL;
+	ret = wm8350_block_read(wm8350, WM8350_SUSPEND_FIRST,
+				WM8350_SUSPEND_REGS, old);
+	if (ret < 0)
+		return ret;
+	memcpy(regs, old, sizeof(regs));
+
+	for (i = 0; i < n; i++) {
+		id = rdev_get_id(rdevs[i]);
+
+		if (id >= WM8350_DCDC_1 && id <= WM8350_DCDC_6)
+			ret = wm8350_dcdc_suspend_state(wm8350, id, states[i],
+							regs);
+		else if (id >= WM8350_LDO_1 && id <= WM8350_LDO_4)
+			ret = wm8350_ldo_suspend_state(wm8350, id, states[i],
+						       regs);
+		else
+			ret = -EINVAL;
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = 0; i < WM8350_SUSPEND_REGS; i = end) {
+		end = i + 1;
+		if (regs[i] == old[i])
+			continue;
+
+		while (end < WM8350_SUSPEND_REGS && regs[end] != old[end])
+			end++;
+
+		ret = wm8350_block_write(wm8350, WM8350_SUSPEND_FIRST + i,
+					 end - i, &regs[i]);
+		if (ret < 0)
+			return ret;
 	}
 
-	/* all LDOs have same mV bits */
-	val = wm8350_reg_read(wm8350, volt_reg) & WM8350_LDO1_VSEL_MASK;
-	return wm8350_ldo_val_to_mvolts(val) * 1000;
+	return 0;
 }
 
 int wm8350_dcdc_set_slot(struct wm8350 *wm8350, int dcdc, u16 start,
 			 u16 stop, u16 fault)
 {
-	int slot_reg;
-	u16 val;
-
 	dev_dbg(wm8350->dev, "%s %d start %d stop %d\n",
 		__func__, dcdc, start, stop);
 
@@ -788,46 +687,21 @@ int wm8350_dcdc_set_slot(struct wm8350 *wm8350, int dcdc, u16 start,
 	if (start > 15 || stop > 15)
 		return -EINVAL;
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		slot_reg = WM8350_DCDC1_TIMEOUTS;
-		break;
-	case WM8350_DCDC_2:
-		slot_reg = WM8350_DCDC2_TIMEOUTS;
-		break;
-	case WM8350_DCDC_3:
-		slot_reg = WM8350_DCDC3_TIMEOUTS;
-		break;
-	case WM8350_DCDC_4:
-		slot_reg = WM8350_DCDC4_TIMEOUTS;
-		break;
-	case WM8350_DCDC_5:
-		slot_reg = WM8350_DCDC5_TIMEOUTS;
-		break;
-	case WM8350_DCDC_6:
-		slot_reg = WM8350_DCDC6_TIMEOUTS;
-		break;
-	default:
+	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
 		return -EINVAL;
-	}
-
-	val = wm8350_reg_read(wm8350, slot_reg) &
-	    ~(WM8350_DC1_ENSLOT_MASK | WM8350_DC1_SDSLOT_MASK |
-	      WM8350_DC1_ERRACT_MASK);
-	wm8350_reg_write(wm8350, slot_reg,
-			 val | (start << WM8350_DC1_ENSLOT_SHIFT) |
-			 (stop << WM8350_DC1_SDSLOT_SHIFT) |
-			 (fault << WM8350_DC1_ERRACT_SHIFT));
 
-	return 0;
+	return wm8350_reg_update_bits(wm8350, wm8350_info[dcdc].timeouts_reg,
+				      WM8350_DC1_ENSLOT_MASK |
+				      WM8350_DC1_SDSLOT_MASK |
+				      WM8350_DC1_ERRACT_MASK,
+				      (start << WM8350_DC1_ENSLOT_SHIFT) |
+				      (stop << WM8350_DC1_SDSLOT_SHIFT) |
+				      (fault << WM8350_DC1_ERRACT_SHIFT));
 }
 EXPORT_SYMBOL_GPL(wm8350_dcdc_set_slot);
 
 int wm8350_ldo_set_slot(struct wm8350 *wm8350, int ldo, u16 start, u16 stop)
 {
-	int slot_reg;
-	u16 val;
-
 	dev_dbg(wm8350->dev, "%s %d start %d stop %d\n",
 		__func__, ldo, start, stop);
 
@@ -835,143 +709,323 @@ int wm8350_ldo_set_slot(struct wm8350 *wm8350, int ldo, u16 start, u16 stop)
 	if (start > 15 || stop > 15)
 		return -EINVAL;
 
-	switch (ldo) {
-	case WM8350_LDO_1:
-		slot_reg = WM8350_LDO1_TIMEOUTS;
-		break;
-	case WM8350_LDO_2:
-		slot_reg = WM8350_LDO2_TIMEOUTS;
-		break;
-	case WM8350_LDO_3:
-		slot_reg = WM8350_LDO3_TIMEOUTS;
-		break;
-	case WM8350_LDO_4:
-		slot_reg = WM8350_LDO4_TIMEOUTS;
-		break;
-	default:
+	if (ldo < WM8350_LDO_1 || ldo > WM8350_LDO_4)
 		return -EINVAL;
-	}
 
-	val = wm8350_reg_read(wm8350, slot_reg) & ~WM8350_LDO1_SDSLOT_MASK;
-	wm8350_reg_write(wm8350, slot_reg, val | ((start << 10) | (stop << 6)));
-	return 0;
+	return wm8350_reg_update_bits(wm8350, wm8350_info[ldo].timeouts_reg,
+				      WM8350_LDO1_ENSLOT_MASK |
+				      WM8350_LDO1_SDSLOT_MASK,
+				      (start << WM8350_LDO1_ENSLOT_SHIFT) |
+				      (stop << WM8350_LDO1_SDSLOT_SHIFT));
 }
 EXPORT_SYMBOL_GPL(wm8350_ldo_set_slot);
 
+/* The power up sequencer has 15 slots, shut down runs in reverse */
+static int wm8350_dcdc_set_sequence_step(struct regulator_dev *rdev, int step)
+{
+	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
+	int dcdc = rdev_get_id(rdev);
+	u16 fault;
+
+	if (step < 1 || step > 15)
+		return -EINVAL;
+
+	/* keep the existing fault action */
+	fault = (wm8350_reg_read(wm8350, wm8350_info[dcdc].timeouts_reg) &
+		 WM8350_DC1_ERRACT_MASK) >> WM8350_DC1_ERRACT_SHIFT;
+
+	return wm8350_dcdc_set_slot(wm8350, dcdc, step, 16 - step, fault);
+}
+
+static int wm8350_ldo_set_sequence_step(struct regulator_dev *rdev, int step)
+{
+	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
+
+	if (step < 1 || step > 15)
+		return -EINVAL;
+
+	return wm8350_ldo_set_slot(wm8350, rdev_get_id(rdev), step, 16 - step);
+}
+
 int wm8350_dcdc25_set_mode(struct wm8350 *wm8350, int dcdc, u16 mode,
 			   u16 ilim, u16 ramp, u16 feedback)
 {
-	u16 val;
-
 	dev_dbg(wm8350->dev, "%s %d mode: %s %s\n", __func__, dcdc,
 		mode ? "normal" : "boost", ilim ? "low" : "normal");
 
-	switch (dcdc) {
-	case WM8350_DCDC_2:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC2_CONTROL)
-		    & ~(WM8350_DC2_MODE_MASK | WM8350_DC2_ILIM_MASK |
-			WM8350_DC2_RMP_MASK | WM8350_DC2_FBSRC_MASK);
-		wm8350_reg_write(wm8350, WM8350_DCDC2_CONTROL, val |
-				 (mode << WM8350_DC2_MODE_SHIFT) |
-				 (ilim << WM8350_DC2_ILIM_SHIFT) |
-				 (ramp << WM8350_DC2_RMP_SHIFT) |
-				 (feedback << WM8350_DC2_FBSRC_SHIFT));
-		break;
-	case WM8350_DCDC_5:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC5_CONTROL)
-		    & ~(WM8350_DC5_MODE_MASK | WM8350_DC5_ILIM_MASK |
-			WM8350_DC5_RMP_MASK | WM8350_DC5_FBSRC_MASK);
-		wm8350_reg_write(wm8350, WM8350_DCDC5_CONTROL, val |
-				 (mode << WM8350_DC5_MODE_SHIFT) |
-				 (ilim << WM8350_DC5_ILIM_SHIFT) |
-				 (ramp << WM8350_DC5_RMP_SHIFT) |
-				 (feedback << WM8350_DC5_FBSRC_SHIFT));
-		break;
-	default:
+	if (dcdc != WM8350_DCDC_2 && dcdc != WM8350_DCDC_5)
 		return -EINVAL;
-	}
 
-	return 0;
+	/* DCDC2 and DCDC5 have the same control bits */
+	return wm8350_reg_update_bits(wm8350, wm8350_info[dcdc].control_reg,
+			WM8350_DC2_MODE_MASK | WM8350_DC2_ILIM_MASK |
+			WM8350_DC2_RMP_MASK | WM8350_DC2_FBSRC_MASK,
+			(mode << WM8350_DC2_MODE_SHIFT) |
+			(ilim << WM8350_DC2_ILIM_SHIFT) |
+			(ramp << WM8350_DC2_RMP_SHIFT) |
+			(feedback << WM8350_DC2_FBSRC_SHIFT));
 }
 EXPORT_SYMBOL_GPL(wm8350_dcdc25_set_mode);
 
-static int wm8350_dcdc_enable(struct regulator_dev *rdev)
+/**
+ * wm8350_dcdc_set_dvs - set up hardware voltage switching for a DCDC
+ * @wm8350: device
+ * @dcdc: DCDC1, 3, 4 or 6
+ * @uV: alternate voltage
+ * @signal: WM8350_DCDC_HIB_SIG_LPWR1 to 3 or WM8350_DCDC_HIB_SIG_REG to
+ *          stop using DVS
+ *
+ * Programs the hibernate image voltage of the DCDC as an alternate
+ * output voltage and has the given LPWR input select it rather than
+ * the system hibernate.  The host then switches the DCDC between its
+ * normal and alternate voltage by driving the GPIO wired to that
+ * input, with no register write at all.  While DVS is in use the
+ * suspend voltage of the DCDC can't be set since it shares the image.
+ */
+int wm8350_dcdc_set_dvs(struct wm8350 *wm8350, int dcdc, int uV, u16 signal)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 shift;
+	int mV = uV / 1000;
+	u16 *hib_mode;
+	int reg, ret;
 
 	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
 		return -EINVAL;
 
-	shift = dcdc - WM8350_DCDC_1;
-	wm8350_set_bits(wm8350, WM8350_DCDC_LDO_REQUESTED, 1 << shift);
+	reg = wm8350_info[dcdc].low_power_reg;
+	if (!reg)
+		return -EINVAL;
+	hib_mode = wm8350_dcdc_hib_mode(wm8350, dcdc);
+
+	/* both use the hibernate trigger */
+	if (wm8350->pmic.hw_ena & (1 << dcdc))
+		return -EBUSY;
+
+	if (signal == WM8350_DCDC_HIB_SIG_REG) {
+		wm8350->pmic.dvs &= ~(1 << dcdc);
+		return wm8350_reg_update_bits(wm8350, reg,
+					      WM8350_DC1_HIB_TRIG_MASK,
+					      WM8350_DCDC_HIB_SIG_REG);
+	}
+
+	if (signal & ~WM8350_DC1_HIB_TRIG_MASK)
+		return -EINVAL;
+
+	if (mV < 850 || mV > 4025) {
+		dev_err(wm8350->dev, "DCDC%d DVS voltage %d mV out of range\n",
+			dcdc, mV);
+		return -EINVAL;
+	}
+
+	ret = wm8350_reg_update_bits(wm8350, reg,
+				     WM8350_DCDC_HIB_MODE_MASK |
+				     WM8350_DC1_HIB_TRIG_MASK |
+				     WM8350_DC1_VIMG_MASK,
+				     WM8350_DCDC_HIB_MODE_IMAGE | signal |
+				     wm8350_dcdc_mvolts_to_val(mV));
+	if (ret < 0)
+		return ret;
+
+	*hib_mode = WM8350_DCDC_HIB_MODE_IMAGE;
+	wm8350->pmic.dvs |= 1 << dcdc;
 	return 0;
 }
+EXPORT_SYMBOL_GPL(wm8350_dcdc_set_dvs);
 
-static int wm8350_dcdc_disable(struct regulator_dev *rdev)
+/* where the hibernate mode and trigger of a DCDC or LDO live */
+static int wm8350_hib_fields(int reg, u16 *hib_reg, u16 *mode_mask,
+			     u16 *mode_off, u16 *trig_mask)
 {
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 shift;
+	const struct wm8350_regulator_info *info = &wm8350_info[reg];
 
-	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
+	switch (reg) {
+	case WM8350_DCDC_1:
+	case WM8350_DCDC_3:
+	case WM8350_DCDC_4:
+	case WM8350_DCDC_6:
+		*hib_reg = info->low_power_reg;
+		*mode_mask = WM8350_DCDC_HIB_MODE_MASK;
+		*mode_off = WM8350_DCDC_HIB_MODE_DIS;
+		*trig_mask = WM8350_DC1_HIB_TRIG_MASK;
+		return 0;
+	case WM8350_DCDC_2:
+	case WM8350_DCDC_5:
+		*hib_reg = info->control_reg;
+		*mode_mask = WM8350_DC2_HIB_MODE_MASK;
+		*mode_off = WM8350_DC2_HIB_MODE_DISABLE <<
+			WM8350_DC2_HIB_MODE_SHIFT;
+		*trig_mask = WM8350_DC2_HIB_TRIG_MASK;
+		return 0;
+	case WM8350_LDO_1:
+	case WM8350_LDO_2:
+	case WM8350_LDO_3:
+	case WM8350_LDO_4:
+		*hib_reg = info->low_power_reg;
+		*mode_mask = WM8350_LDO1_HIB_MODE_MASK;
+		*mode_off = WM8350_LDO1_HIB_MODE_DIS;
+		*trig_mask = WM8350_LDO1_HIB_TRIG_MASK;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * wm8350_set_hw_enable - switch a DCDC or LDO with an LPWR input
+ * @wm8350: device
+ * @reg: DCDC or LDO
+ * @signal: WM8350_DCDC_HIB_SIG_LPWR1 to 3, or WM8350_DCDC_HIB_SIG_REG
+ *          to return the rail to register control
+ * @gpio: host GPIO wired to the input, or -1 if something else such as
+ *        the sleep signal of the processor drives it
+ *
+ * Programs the rail to switch off whenever the given LPWR input is
+ * asserted, and on again when it is released, so it can be switched
+ * without any register write.  With a GPIO the regulator API enables
+ * and disables the rail by driving the GPIO, high to assert the input
+ * (set its polarity with wm8350_gpio_config()), taking the bus latency
+ * out of the enable path.  Without one the regulator API still controls
+ * the rail through its enable register, and the input turns it off
+ * regardless.
+ *
+ * The rail no longer follows the system hibernate while this is in
+ * use, so its suspend state isn't configured, and a DCDC can't use DVS
+ * at the same time.
+ */
+int wm8350_set_hw_enable(struct wm8350 *wm8350, int reg, u16 signal,
+			 int gpio)
+{
+	const struct wm8350_regulator_info *info;
+	struct wm8350_pmic *pmic = &wm8350->pmic;
+	u16 hib_reg, mode_mask, mode_off, trig_mask;
+	int on, ret;
+
+	ret = wm8350_hib_fields(reg, &hib_reg, &mode_mask, &mode_off,
+				&trig_mask);
+	if (ret < 0)
+		return ret;
+	info = &wm8350_info[reg];
+
+	if (signal == WM8350_DCDC_HIB_SIG_REG) {
+		if (!(pmic->hw_ena & (1 << reg)))
+			return 0;
+
+		/* the enable register takes over in the present state */
+		if (gpio_is_valid(pmic->hw_ena_gpio[reg])) {
+			if (pmic->hw_ena_off & (1 << reg))
+				wm8350_clear_bits(wm8350, info->enable_reg,
+						  info->enable_mask);
+			gpio_set_value_cansleep(pmic->hw_ena_gpio[reg], 0);
+			gpio_free(pmic->hw_ena_gpio[reg]);
+		}
+
+		ret = wm8350_reg_update_bits(wm8350, hib_reg,
+					     mode_mask | trig_mask,
+					     pmic->hw_ena_hib[reg] |
+					     WM8350_DCDC_HIB_SIG_REG);
+		pmic->hw_ena &= ~(1 << reg);
+		pmic->hw_ena_off &= ~(1 << reg);
+		return ret;
+	}
+
+	if (signal & ~trig_mask)
 		return -EINVAL;
 
-	shift = dcdc - WM8350_DCDC_1;
-	wm8350_clear_bits(wm8350, WM8350_DCDC_LDO_REQUESTED, 1 << shift);
+	if (pmic->hw_ena & (1 << reg) || pmic->dvs & (1 << reg))
+		return -EBUSY;
+
+	on = wm8350_reg_read(wm8350, info->enable_reg) & info->enable_mask;
+
+	if (gpio_is_valid(gpio)) {
+		ret = gpio_request(gpio, "wm8350 hardware enable");
+		if (ret < 0)
+			return ret;
+
+		/* keep the rail as it is until told otherwise */
+		ret = gpio_direction_output(gpio, !on);
+		if (ret < 0)
+			goto err_gpio;
+	}
+
+	pmic->hw_ena_hib[reg] = wm8350_reg_read(wm8350, hib_reg) & mode_mask;
+	ret = wm8350_reg_update_bits(wm8350, hib_reg, mode_mask | trig_mask,
+				     mode_off | signal);
+	if (ret < 0)
+		goto err_gpio;
+
+	/* from now on only the GPIO switches the rail */
+	if (gpio_is_valid(gpio)) {
+		ret = wm8350_set_bits(wm8350, info->enable_reg,
+				      info->enable_mask);
+		if (ret < 0)
+			goto err_hib;
+		if (!on)
+			pmic->hw_ena_off |= 1 << reg;
+	}
 
+	pmic->hw_ena_gpio[reg] = gpio;
+	pmic->hw_ena |= 1 << reg;
 	return 0;
+
+err_hib:
+	wm8350_reg_update_bits(wm8350, hib_reg, mode_mask | trig_mask,
+			       pmic->hw_ena_hib[reg] | WM8350_DCDC_HIB_SIG_REG);
+err_gpio:
+	if (gpio_is_valid(gpio))
+		gpio_free(gpio);
+	return ret;
 }
+EXPORT_SYMBOL_GPL(wm8350_set_hw_enable);
 
-static int wm8350_ldo_enable(struct regulator_dev *rdev)
+/* rails under hardware enable control with a GPIO are switched by it */
+static int wm8350_hw_ena_gpio(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int ldo = rdev_get_id(rdev);
-	u16 shift;
+	int id = rdev_get_id(rdev);
 
-	if (ldo < WM8350_LDO_1 || ldo > WM8350_LDO_4)
-		return -EINVAL;
+	if (!(wm8350->pmic.hw_ena & (1 << id)))
+		return -1;
+
+	return wm8350->pmic.hw_ena_gpio[id];
+}
+
+static int wm8350_regulator_enable(struct regulator_dev *rdev)
+{
+	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
+	int gpio = wm8350_hw_ena_gpio(rdev);
 
-	shift = (ldo - WM8350_LDO_1) + 8;
-	wm8350_set_bits(wm8350, WM8350_DCDC_LDO_REQUESTED, 1 << shift);
+	if (gpio_is_valid(gpio)) {
+		gpio_set_value_cansleep(gpio, 0);
+		wm8350->pmic.hw_ena_off &= ~(1 << rdev_get_id(rdev));
+		return 0;
+	}
+
+	wm8350_set_bits(wm8350, info->enable_reg, info->enable_mask);
 	return 0;
 }
 
-static int wm8350_ldo_disable(struct regulator_dev *rdev)
+static int wm8350_regulator_disable(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int ldo = rdev_get_id(rdev);
-	u16 shift;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
+	int gpio = wm8350_hw_ena_gpio(rdev);
 
-	if (ldo < WM8350_LDO_1 || ldo > WM8350_LDO_4)
-		return -EINVAL;
+	if (gpio_is_valid(gpio)) {
+		gpio_set_value_cansleep(gpio, 1);
+		wm8350->pmic.hw_ena_off |= 1 << rdev_get_id(rdev);
+		return 0;
+	}
 
-	shift = (ldo - WM8350_LDO_1) + 8;
-	wm8350_clear_bits(wm8350, WM8350_DCDC_LDO_REQUESTED, 1 << shift);
+	wm8350_clear_bits(wm8350, info->enable_reg, info->enable_mask);
 	return 0;
 }
 
 static int force_continuous_enable(struct wm8350 *wm8350, int dcdc, int enable)
 {
-	int reg = 0, ret;
+	int reg = wm8350_info[dcdc].force_pwm_reg, ret;
 
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-		reg = WM8350_DCDC1_FORCE_PWM;
-		break;
-	case WM8350_DCDC_3:
-		reg = WM8350_DCDC3_FORCE_PWM;
-		break;
-	case WM8350_DCDC_4:
-		reg = WM8350_DCDC4_FORCE_PWM;
-		break;
-	case WM8350_DCDC_6:
-		reg = WM8350_DCDC6_FORCE_PWM;
-		break;
-	default:
+	if (!reg)
 		return -EINVAL;
-	}
 
 	if (enable)
 		ret = wm8350_set_bits(wm8350, reg,
@@ -985,63 +1039,112 @@ static int force_continuous_enable(struct wm8350 *wm8350, int dcdc, int enable)
 static int wm8350_dcdc_set_mode(struct regulator_dev *rdev, unsigned int mode)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
-	u16 val;
+	int dcdc = rdev_get_id(rdev), force, ret;
+	u16 val, opts[2];
 
-	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
+	if (!wm8350_info[dcdc].force_pwm_reg)
 		return -EINVAL;
 
-	if (dcdc == WM8350_DCDC_2 || dcdc == WM8350_DCDC_5)
-		return -EINVAL;
+	/* the options use the same bit as the enable */
+	val = wm8350_info[dcdc].enable_mask;
 
-	val = 1 << (dcdc - WM8350_DCDC_1);
+	/* the active and sleep options are adjacent so update both with
+	 * a single block transfer */
+	ret = wm8350_block_read(wm8350, WM8350_DCDC_ACTIVE_OPTIONS, 2, opts);
+	if (ret < 0)
+		return ret;
 
 	switch (mode) {
 	case REGULATOR_MODE_FAST:
 		/* force continuous mode */
-		wm8350_set_bits(wm8350, WM8350_DCDC_ACTIVE_OPTIONS, val);
-		wm8350_clear_bits(wm8350, WM8350_DCDC_SLEEP_OPTIONS, val);
-		force_continuous_enable(wm8350, dcdc, 1);
+		opts[0] |= val;
+		opts[1] &= ~val;
+		force = 1;
 		break;
 	case REGULATOR_MODE_NORMAL:
 		/* active / pulse skipping */
-		wm8350_set_bits(wm8350, WM8350_DCDC_ACTIVE_OPTIONS, val);
-		wm8350_clear_bits(wm8350, WM8350_DCDC_SLEEP_OPTIONS, val);
-		force_continuous_enable(wm8350, dcdc, 0);
+		opts[0] |= val;
+		opts[1] &= ~val;
+		force = 0;
 		break;
 	case REGULATOR_MODE_IDLE:
 		/* standby mode */
-		force_continuous_enable(wm8350, dcdc, 0);
-		wm8350_clear_bits(wm8350, WM8350_DCDC_SLEEP_OPTIONS, val);
-		wm8350_clear_bits(wm8350, WM8350_DCDC_ACTIVE_OPTIONS, val);
+		opts[0] &= ~val;
+		opts[1] &= ~val;
+		force = 0;
 		break;
 	case REGULATOR_MODE_STANDBY:
 		/* LDO mode */
-		force_continuous_enable(wm8350, dcdc, 0);
-		wm8350_set_bits(wm8350, WM8350_DCDC_SLEEP_OPTIONS, val);
+		opts[1] |= val;
+		force = 0;
 		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* leave continuous mode before changing the options and only
+	 * enter it once they are set up */
+	if (!force) {
+		ret = force_continuous_enable(wm8350, dcdc, 0);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = wm8350_block_write(wm8350, WM8350_DCDC_ACTIVE_OPTIONS, 2, opts);
+	if (ret < 0)
+		return ret;
+
+	if (force)
+		ret = force_continuous_enable(wm8350, dcdc, 1);
+
+	return ret;
+}
+
+static int wm8350_dcdc_set_config(struct regulator_dev *rdev,
+				  const struct regulator_config *config)
+{
+	unsigned int sel;
+	int ret;
+
+	if (config->flags & REGULATOR_CONFIG_CURRENT)
+		return -EINVAL;
+
+	if (config->flags & REGULATOR_CONFIG_VOLTAGE) {
+		/* the core gives us a range, pick its lowest step */
+		if (config->min_uV < WM8350_DCDC_MIN_UV)
+			return -EINVAL;
+		sel = DIV_ROUND_UP(config->min_uV - WM8350_DCDC_MIN_UV,
+				   WM8350_DCDC_STEP_UV);
+		if (sel > WM8350_DC1_VSEL_MASK ||
+		    WM8350_DCDC_MIN_UV + sel * WM8350_DCDC_STEP_UV >
+		    config->max_uV)
+			return -EINVAL;
+
+		ret = wm8350_set_voltage_sel(rdev, sel);
+		if (ret < 0)
+			return ret;
 	}
 
+	if (config->flags & REGULATOR_CONFIG_MODE)
+		return wm8350_dcdc_set_mode(rdev, config->mode);
+
 	return 0;
 }
 
 static unsigned int wm8350_dcdc_get_mode(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev);
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 	u16 mask, sleep, active, force;
 	int mode = REGULATOR_MODE_NORMAL;
 
-	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
-		return -EINVAL;
-
-	if (dcdc == WM8350_DCDC_2 || dcdc == WM8350_DCDC_5)
+	if (!info->force_pwm_reg)
 		return -EINVAL;
 
-	mask = 1 << (dcdc - WM8350_DCDC_1);
+	mask = info->enable_mask;
 	active = wm8350_reg_read(wm8350, WM8350_DCDC_ACTIVE_OPTIONS) & mask;
 	sleep = wm8350_reg_read(wm8350, WM8350_DCDC_SLEEP_OPTIONS) & mask;
-	force = wm8350_reg_read(wm8350, WM8350_DCDC1_FORCE_PWM)
+	force = wm8350_reg_read(wm8350, info->force_pwm_reg)
 	    & WM8350_DCDC1_FORCE_PWM_ENA;
 	dev_dbg(wm8350->dev, "mask %x active %x sleep %x force %x",
 		mask, active, sleep, force);
@@ -1064,122 +1167,64 @@ static unsigned int wm8350_ldo_get_mode(struct regulator_dev *rdev)
 	return REGULATOR_MODE_NORMAL;
 }
 
-struct wm8350_dcdc_efficiency {
-	int uA_load_min;
-	int uA_load_max;
-	unsigned int mode;
-};
-
-static const struct wm8350_dcdc_efficiency dcdc1_6_efficiency[] = {
-	{0, 10000, REGULATOR_MODE_STANDBY},       /* 0 - 10mA - LDO */
-	{10000, 100000, REGULATOR_MODE_IDLE},     /* 10mA - 100mA - Standby */
-	{100000, 1000000, REGULATOR_MODE_NORMAL}, /* > 100mA - Active */
-	{-1, -1, REGULATOR_MODE_NORMAL},
+/* WM8350 regulator efficiency is pretty similar over different input
+ * and output uV so only the load is considered.
+ */
+static const struct regulator_mode_table dcdc1_6_efficiency[] = {
+	{ .max_uA = 10000, .mode = REGULATOR_MODE_STANDBY },	/* LDO */
+	{ .max_uA = 100000, .mode = REGULATOR_MODE_IDLE },	/* Standby */
+	{ .max_uA = 1000000, .mode = REGULATOR_MODE_NORMAL },	/* Active */
 };
 
-static const struct wm8350_dcdc_efficiency dcdc3_4_efficiency[] = {
-	{0, 10000, REGULATOR_MODE_STANDBY},      /* 0 - 10mA - LDO */
-	{10000, 100000, REGULATOR_MODE_IDLE},    /* 10mA - 100mA - Standby */
-	{100000, 800000, REGULATOR_MODE_NORMAL}, /* > 100mA - Active */
-	{-1, -1, REGULATOR_MODE_NORMAL},
+static const struct regulator_mode_table dcdc3_4_efficiency[] = {
+	{ .max_uA = 10000, .mode = REGULATOR_MODE_STANDBY },	/* LDO */
+	{ .max_uA = 100000, .mode = REGULATOR_MODE_IDLE },	/* Standby */
+	{ .max_uA = 800000, .mode = REGULATOR_MODE_NORMAL },	/* Active */
 };
 
-static unsigned int get_mode(int uA, const struct wm8350_dcdc_efficiency *eff)
-{
-	int i = 0;
-
-	while (eff[i].uA_load_min != -1) {
-		if (uA >= eff[i].uA_load_min && uA <= eff[i].uA_load_max)
-			return eff[i].mode;
-	}
-	return REGULATOR_MODE_NORMAL;
-}
-
-/* Query the regulator for it's most efficient mode @ uV,uA
- * WM8350 regulator efficiency is pretty similar over
- * different input and output uV.
- */
-static unsigned int wm8350_dcdc_get_optimum_mode(struct regulator_dev *rdev,
-						 int input_uV, int output_uV,
-						 int output_uA)
-{
-	int dcdc = rdev_get_id(rdev), mode;
-
-	switch (dcdc) {
-	case WM8350_DCDC_1:
-	case WM8350_DCDC_6:
-		mode = get_mode(output_uA, dcdc1_6_efficiency);
-		break;
-	case WM8350_DCDC_3:
-	case WM8350_DCDC_4:
-		mode = get_mode(output_uA, dcdc3_4_efficiency);
-		break;
-	default:
-		mode = REGULATOR_MODE_NORMAL;
-		break;
-	}
-	return mode;
-}
-
-static int wm8350_dcdc_is_enabled(struct regulator_dev *rdev)
-{
-	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int dcdc = rdev_get_id(rdev), shift;
-
-	if (dcdc < WM8350_DCDC_1 || dcdc > WM8350_DCDC_6)
-		return -EINVAL;
-
-	shift = dcdc - WM8350_DCDC_1;
-	return wm8350_reg_read(wm8350, WM8350_DCDC_LDO_REQUESTED)
-	    & (1 << shift);
-}
-
-static int wm8350_ldo_is_enabled(struct regulator_dev *rdev)
+static int wm8350_regulator_is_enabled(struct regulator_dev *rdev)
 {
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
-	int ldo = rdev_get_id(rdev), shift;
+	const struct wm8350_regulator_info *info = rdev_to_info(rdev);
 
-	if (ldo < WM8350_LDO_1 || ldo > WM8350_LDO_4)
-		return -EINVAL;
+	if (gpio_is_valid(wm8350_hw_ena_gpio(rdev)))
+		return !(wm8350->pmic.hw_ena_off & (1 << rdev_get_id(rdev)));
 
-	shift = (ldo - WM8350_LDO_1) + 8;
-	return wm8350_reg_read(wm8350, WM8350_DCDC_LDO_REQUESTED)
-	    & (1 << shift);
+	return wm8350_reg_read(wm8350, info->enable_reg) & info->enable_mask;
 }
 
 static struct regulator_ops wm8350_dcdc_ops = {
-	.set_voltage = wm8350_dcdc_set_voltage,
-	.get_voltage = wm8350_dcdc_get_voltage,
-	.enable = wm8350_dcdc_enable,
-	.disable = wm8350_dcdc_disable,
+	.list_voltage = regulator_list_voltage_linear,
+	.set_voltage_sel = wm8350_set_voltage_sel,
+	.get_voltage_sel = wm8350_get_voltage_sel,
+	.enable = wm8350_regulator_enable,
+	.disable = wm8350_regulator_disable,
 	.get_mode = wm8350_dcdc_get_mode,
 	.set_mode = wm8350_dcdc_set_mode,
-	.get_optimum_mode = wm8350_dcdc_get_optimum_mode,
-	.is_enabled = wm8350_dcdc_is_enabled,
-	.set_suspend_voltage = wm8350_dcdc_set_suspend_voltage,
-	.set_suspend_enable = wm8350_dcdc_set_suspend_enable,
-	.set_suspend_disable = wm8350_dcdc_set_suspend_disable,
-	.set_suspend_mode = wm8350_dcdc_set_suspend_mode,
+	.set_config = wm8350_dcdc_set_config,
+	.is_enabled = wm8350_regulator_is_enabled,
+	.set_suspend_states = wm8350_set_suspend_states,
+	.set_sequence_step = wm8350_dcdc_set_sequence_step,
 };
 
 static struct regulator_ops wm8350_dcdc2_5_ops = {
-	.enable = wm8350_dcdc_enable,
-	.disable = wm8350_dcdc_disable,
-	.is_enabled = wm8350_dcdc_is_enabled,
-	.set_suspend_enable = wm8350_dcdc25_set_suspend_enable,
-	.set_suspend_disable = wm8350_dcdc25_set_suspend_disable,
+	.enable = wm8350_regulator_enable,
+	.disable = wm8350_regulator_disable,
+	.is_enabled = wm8350_regulator_is_enabled,
+	.set_suspend_states = wm8350_set_suspend_states,
+	.set_sequence_step = wm8350_dcdc_set_sequence_step,
 };
 
 static struct regulator_ops wm8350_ldo_ops = {
-	.set_voltage = wm8350_ldo_set_voltage,
-	.get_voltage = wm8350_ldo_get_voltage,
-	.enable = wm8350_ldo_enable,
-	.disable = wm8350_ldo_disable,
-	.is_enabled = wm8350_ldo_is_enabled,
+	.list_voltage = regulator_list_voltage_linear_range,
+	.set_voltage_sel = wm8350_set_voltage_sel,
+	.get_voltage_sel = wm8350_get_voltage_sel,
+	.enable = wm8350_regulator_enable,
+	.disable = wm8350_regulator_disable,
+	.is_enabled = wm8350_regulator_is_enabled,
 	.get_mode = wm8350_ldo_get_mode,
-	.set_suspend_voltage = wm8350_ldo_set_suspend_voltage,
-	.set_suspend_enable = wm8350_ldo_set_suspend_enable,
-	.set_suspend_disable = wm8350_ldo_set_suspend_disable,
+	.set_suspend_states = wm8350_set_suspend_states,
+	.set_sequence_step = wm8350_ldo_set_sequence_step,
 };
 
 static struct regulator_ops wm8350_isink_ops = {
@@ -1190,6 +1235,20 @@ static struct regulator_ops wm8350_isink_ops = {
 	.is_enabled = wm8350_isink_is_enabled,
 };
 
+static struct regulator_ops wm8350_charger_ops = {
+	.set_current_limit = wm8350_charger_set_current,
+	.get_current_limit = wm8350_charger_get_current,
+	.enable = wm8350_charger_enable,
+	.disable = wm8350_charger_disable,
+	.is_enabled = wm8350_charger_is_enabled,
+};
+
+/* 50mV steps from 0.9V up to 1.8V, then 100mV steps up to 3.3V */
+static const struct regulator_linear_range wm8350_ldo_ranges[] = {
+	{ .min_sel = 0,  .max_sel = 15, .min_uV = 900000,  .uV_step = 50000 },
+	{ .min_sel = 16, .max_sel = 31, .min_uV = 1800000, .uV_step = 100000 },
+};
+
 static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 	{
 		.name = "DCDC1",
@@ -1198,6 +1257,11 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_DC1,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_DC1_VSEL_MASK + 1,
+		.min_uV = WM8350_DCDC_MIN_UV,
+		.uV_step = WM8350_DCDC_STEP_UV,
+		.mode_table = dcdc1_6_efficiency,
+		.n_mode_table = ARRAY_SIZE(dcdc1_6_efficiency),
 	},
 	{
 		.name = "DCDC2",
@@ -1214,6 +1278,11 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_DC3,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_DC1_VSEL_MASK + 1,
+		.min_uV = WM8350_DCDC_MIN_UV,
+		.uV_step = WM8350_DCDC_STEP_UV,
+		.mode_table = dcdc3_4_efficiency,
+		.n_mode_table = ARRAY_SIZE(dcdc3_4_efficiency),
 	},
 	{
 		.name = "DCDC4",
@@ -1222,6 +1291,11 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_DC4,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_DC1_VSEL_MASK + 1,
+		.min_uV = WM8350_DCDC_MIN_UV,
+		.uV_step = WM8350_DCDC_STEP_UV,
+		.mode_table = dcdc3_4_efficiency,
+		.n_mode_table = ARRAY_SIZE(dcdc3_4_efficiency),
 	},
 	{
 		.name = "DCDC5",
@@ -1238,6 +1312,11 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_DC6,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_DC1_VSEL_MASK + 1,
+		.min_uV = WM8350_DCDC_MIN_UV,
+		.uV_step = WM8350_DCDC_STEP_UV,
+		.mode_table = dcdc1_6_efficiency,
+		.n_mode_table = ARRAY_SIZE(dcdc1_6_efficiency),
 	},
 	{
 		.name = "LDO1",
@@ -1246,6 +1325,9 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_LDO1,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8350_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8350_ldo_ranges),
 	},
 	{
 		.name = "LDO2",
@@ -1254,6 +1336,9 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_LDO2,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8350_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8350_ldo_ranges),
 	},
 	{
 		.name = "LDO3",
@@ -1262,6 +1347,9 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_LDO3,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8350_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8350_ldo_ranges),
 	},
 	{
 		.name = "LDO4",
@@ -1270,6 +1358,9 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.irq = WM8350_IRQ_UV_LDO4,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8350_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8350_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8350_ldo_ranges),
 	},
 	{
 		.name = "ISINKA",
@@ -1287,6 +1378,15 @@ static struct regulator_desc wm8350_reg[NUM_WM8350_REGULATORS] = {
 		.type = REGULATOR_CURRENT,
 		.owner = THIS_MODULE,
 	 },
+	{
+		/* the charger interrupts belong to the wm8350-power driver */
+		.name = "CHARGER",
+		.id = WM8350_CHARGER,
+		.ops = &wm8350_charger_ops,
+		.irq = -1,
+		.type = REGULATOR_CURRENT,
+		.owner = THIS_MODULE,
+	},
 };
 
 static void pmic_uv_handler(struct wm8350 *wm8350, int irq, void *data)
@@ -1307,33 +1407,20 @@ static int wm8350_regulator_probe(struct platform_device *pdev)
 {
 	struct wm8350 *wm8350 = dev_get_drvdata(&pdev->dev);
 	struct regulator_dev *rdev;
+	u16 val, *hib_mode;
 	int ret;
-	u16 val;
 
-	if (pdev->id < WM8350_DCDC_1 || pdev->id > WM8350_ISINK_B)
+	if (pdev->id < WM8350_DCDC_1 || pdev->id > WM8350_CHARGER)
 		return -ENODEV;
 
 	/* do any regulatior specific init */
-	switch (pdev->id) {
-	case WM8350_DCDC_1:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC1_LOW_POWER);
-		wm8350->pmic.dcdc1_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		break;
-	case WM8350_DCDC_3:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC3_LOW_POWER);
-		wm8350->pmic.dcdc3_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		break;
-	case WM8350_DCDC_4:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC4_LOW_POWER);
-		wm8350->pmic.dcdc4_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		break;
-	case WM8350_DCDC_6:
-		val = wm8350_reg_read(wm8350, WM8350_DCDC6_LOW_POWER);
-		wm8350->pmic.dcdc6_hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
-		break;
+	hib_mode = wm8350_dcdc_hib_mode(wm8350, pdev->id);
+	if (hib_mode) {
+		val = wm8350_reg_read(wm8350,
+				      wm8350_info[pdev->id].low_power_reg);
+		*hib_mode = val & WM8350_DCDC_HIB_MODE_MASK;
 	}
 
-
 	/* register regulator */
 	rdev = regulator_register(&wm8350_reg[pdev->id], &pdev->dev,
 				  dev_get_drvdata(&pdev->dev));
@@ -1343,6 +1430,9 @@ static int wm8350_regulator_probe(struct platform_device *pdev)
 		return PTR_ERR(rdev);
 	}
 
+	if (wm8350_reg[pdev->id].irq < 0)
+		return 0;
+
 	/* register regulator IRQ */
 	ret = wm8350_register_irq(wm8350, wm8350_reg[pdev->id].irq,
 				  pmic_uv_handler, rdev);
@@ -1363,8 +1453,10 @@ static int wm8350_regulator_remove(struct platform_device *pdev)
 	struct regulator_dev *rdev = platform_get_drvdata(pdev);
 	struct wm8350 *wm8350 = rdev_get_drvdata(rdev);
 
-	wm8350_mask_irq(wm8350, wm8350_reg[pdev->id].irq);
-	wm8350_free_irq(wm8350, wm8350_reg[pdev->id].irq);
+	if (wm8350_reg[pdev->id].irq >= 0) {
+		wm8350_mask_irq(wm8350, wm8350_reg[pdev->id].irq);
+		wm8350_free_irq(wm8350, wm8350_reg[pdev->id].irq);
+	}
 
 	regulator_unregister(rdev);
 
@@ -16,6 +16,7 @@
 #include <linux/err.h>
 #include <linux/kernel.h>
 #include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
 #include <linux/mfd/wm8400-private.h>
 
 static int wm8400_ldo_is_enabled(struct regulator_dev *dev)
@@ -43,57 +44,40 @@ static int wm8400_ldo_disable(struct regulator_dev *dev)
 			       WM8400_LDO1_ENA, 0);
 }
 
-static int wm8400_ldo_get_voltage(struct regulator_dev *dev)
+static int wm8400_ldo_get_voltage_sel(struct regulator_dev *dev)
 {
 	struct wm8400 *wm8400 = rdev_get_drvdata(dev);
 	u16 val;
 
 	val = wm8400_reg_read(wm8400, WM8400_LDO1_CONTROL + rdev_get_id(dev));
-	val &= WM8400_LDO1_VSEL_MASK;
-
-	if (val < 15)
-		return 900000 + (val * 50000);
-	else
-		return 1600000 + ((val - 14) * 100000);
+	return val & WM8400_LDO1_VSEL_MASK;
 }
 
-static int wm8400_ldo_set_voltage(struct regulator_dev *dev,
-				  int min_uV, int max_uV)
+static int wm8400_ldo_set_voltage_sel(struct regulator_dev *dev,
+				      unsigned selector)
 {
 	struct wm8400 *wm8400 = rdev_get_drvdata(dev);
-	u16 val;
 
-	if (min_uV < 900000 || min_uV > 3300000)
+	if (selector > WM8400_LDO1_VSEL_MASK)
 		return -EINVAL;
 
-	if (min_uV < 1700000) {
-		/* Steps of 50mV from 900mV;  */
-		val = (min_uV - 850001) / 50000;
-
-		if ((val * 50000) + 900000 > max_uV)
-			return -EINVAL;
-		BUG_ON((val * 50000) + 900000 < min_uV);
-	} else {
-		/* Steps of 100mV from 1700mV */
-		val = ((min_uV - 1600001) / 100000);
-
-		if ((val * 100000) + 1700000 > max_uV)
-			return -EINVAL;
-		BUG_ON((val * 100000) + 1700000 < min_uV);
-
-		val += 0xf;
-	}
-
 	return wm8400_set_bits(wm8400, WM8400_LDO1_CONTROL + rdev_get_id(dev),
-			       WM8400_LDO1_VSEL_MASK, val);
+			       WM8400_LDO1_VSEL_MASK, selector);
 }
 
+/* Steps of 50mV from 900mV then steps of 100mV from 1700mV */
+static const struct regulator_linear_range wm8400_ldo_ranges[] = {
+	{ .min_sel = 0,  .max_sel = 14, .min_uV = 900000,  .uV_step = 50000 },
+	{ .min_sel = 15, .max_sel = 31, .min_uV = 1700000, .uV_step = 100000 },
+};
+
 static struct regulator_ops wm8400_ldo_ops = {
 	.is_enabled = wm8400_ldo_is_enabled,
 	.enable = wm8400_ldo_enable,
 	.disable = wm8400_ldo_disable,
-	.get_voltage = wm8400_ldo_get_voltage,
-	.set_voltage = wm8400_ldo_set_voltage,
+	.list_voltage = regulator_list_voltage_linear_range,
+	.get_voltage_sel = wm8400_ldo_get_voltage_sel,
+	.set_voltage_sel = wm8400_ldo_set_voltage_sel,
 };
 
 static int wm8400_dcdc_is_enabled(struct regulator_dev *dev)
@@ -124,36 +108,27 @@ static int wm8400_dcdc_disable(struct regulator_dev *dev)
 			       WM8400_DC1_ENA, 0);
 }
 
-static int wm8400_dcdc_get_voltage(struct regulator_dev *dev)
+static int wm8400_dcdc_get_voltage_sel(struct regulator_dev *dev)
 {
 	struct wm8400 *wm8400 = rdev_get_drvdata(dev);
 	u16 val;
 	int offset = (rdev_get_id(dev) - WM8400_DCDC1) * 2;
 
 	val = wm8400_reg_read(wm8400, WM8400_DCDC1_CONTROL_1 + offset);
-	val &= WM8400_DC1_VSEL_MASK;
-
-	return 850000 + (25000 * val);
+	return val & WM8400_DC1_VSEL_MASK;
 }
 
-static int wm8400_dcdc_set_voltage(struct regulator_dev *dev,
-				  int min_uV, int max_uV)
+static int wm8400_dcdc_set_voltage_sel(struct regulator_dev *dev,
+				       unsigned selector)
 {
 	struct wm8400 *wm8400 = rdev_get_drvdata(dev);
-	u16 val;
 	int offset = (rdev_get_id(dev) - WM8400_DCDC1) * 2;
 
-	if (min_uV < 850000)
-		return -EINVAL;
-
-	val = (min_uV - 825001) / 25000;
-
-	if (850000 + (25000 * val) > max_uV)
+	if (selector > WM8400_DC1_VSEL_MASK)
 		return -EINVAL;
-	BUG_ON(850000 + (25000 * val) < min_uV);
 
 	return wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
-			       WM8400_DC1_VSEL_MASK, val);
+			       WM8400_DC1_VSEL_MASK, selector);
 }
 
 static unsigned int wm8400_dcdc_get_mode(struct regulator_dev *dev)
@@ -187,61 +162,70 @@ static int wm8400_dcdc_set_mode(struct regulator_dev *dev, unsigned int mode)
 {
 	struct wm8400 *wm8400 = rdev_get_drvdata(dev);
 	int offset = (rdev_get_id(dev) - WM8400_DCDC1) * 2;
-	int ret;
+	u16 frc_pwm, ctrl1;
 
 	switch (mode) {
 	case REGULATOR_MODE_FAST:
 		/* Datasheet: active with force PWM */
-		ret = wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_2 + offset,
-				      WM8400_DC1_FRC_PWM, WM8400_DC1_FRC_PWM);
-		if (ret != 0)
-			return ret;
-
-		return wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
-				       WM8400_DC1_ACTIVE | WM8400_DC1_SLEEP,
-				       WM8400_DC1_ACTIVE);
+		frc_pwm = WM8400_DC1_FRC_PWM;
+		ctrl1 = WM8400_DC1_ACTIVE;
+		break;
 
 	case REGULATOR_MODE_NORMAL:
 		/* Datasheet: active */
-		ret = wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_2 + offset,
-				      WM8400_DC1_FRC_PWM, 0);
-		if (ret != 0)
-			return ret;
-
-		return wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
-				       WM8400_DC1_ACTIVE | WM8400_DC1_SLEEP,
-				       WM8400_DC1_ACTIVE);
+		frc_pwm = 0;
+		ctrl1 = WM8400_DC1_ACTIVE;
+		break;
 
 	case REGULATOR_MODE_IDLE:
-		/* Datasheet: standby */
-		ret = wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
-				      WM8400_DC1_ACTIVE, 0);
-		if (ret != 0)
-			return ret;
-		return wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
-				       WM8400_DC1_SLEEP, 0);
+		/* Datasheet: standby, leave force PWM alone */
+		frc_pwm = 0;
+		ctrl1 = 0;
+		break;
+
+	case REGULATOR_MODE_STANDBY:
+		/* Datasheet: hibernate, leave force PWM alone */
+		frc_pwm = 0;
+		ctrl1 = WM8400_DC1_SLEEP;
+		break;
 
 	default:
 		return -EINVAL;
 	}
-}
 
-static unsigned int wm8400_dcdc_get_optimum_mode(struct regulator_dev *dev,
-						 int input_uV, int output_uV,
-						 int load_uA)
-{
-	return REGULATOR_MODE_NORMAL;
+	/* both control registers go out in one block write */
+	wm8400_reg_lock(wm8400);
+
+	if (mode == REGULATOR_MODE_FAST || mode == REGULATOR_MODE_NORMAL)
+		__wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_2 + offset,
+				  WM8400_DC1_FRC_PWM, frc_pwm);
+	__wm8400_set_bits(wm8400, WM8400_DCDC1_CONTROL_1 + offset,
+			  WM8400_DC1_ACTIVE | WM8400_DC1_SLEEP, ctrl1);
+
+	return wm8400_reg_unlock(wm8400);
 }
 
+/* The DCDCs have the same hibernate (LDO), standby and active modes as
+ * the WM8350 DCDC1 and DCDC6, so use the load limits Wolfson give for
+ * those in wm8350-regulator.c: each mode is the most efficient up to the
+ * load at which the next one takes over, 10mA and 100mA, and active
+ * above that.  Forced PWM never wins on efficiency.
+ */
+static const struct regulator_mode_table wm8400_dcdc_modes[] = {
+	{ .max_uA = 10000, .mode = REGULATOR_MODE_STANDBY },	/* Hibernate */
+	{ .max_uA = 100000, .mode = REGULATOR_MODE_IDLE },	/* Standby */
+	{ .max_uA = INT_MAX, .mode = REGULATOR_MODE_NORMAL },	/* Active */
+};
+
 static struct regulator_ops wm8400_dcdc_ops = {
 	.is_enabled = wm8400_dcdc_is_enabled,
 	.enable = wm8400_dcdc_enable,
 	.disable = wm8400_dcdc_disable,
-	.get_voltage = wm8400_dcdc_get_voltage,
-	.set_voltage = wm8400_dcdc_set_voltage,
+	.list_voltage = regulator_list_voltage_linear,
+	.get_voltage_sel = wm8400_dcdc_get_voltage_sel,
+	.set_voltage_sel = wm8400_dcdc_set_voltage_sel,
 	.get_mode = wm8400_dcdc_get_mode,
 	.set_mode = wm8400_dcdc_set_mode,
-	.get_optimum_mode = wm8400_dcdc_get_optimum_mode,
 };
 
 static struct regulator_desc regulators[] = {
@@ -251,6 +235,9 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_ldo_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8400_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8400_ldo_ranges),
 	},
 	{
 		.name = "LDO2",
@@ -258,6 +245,9 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_ldo_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8400_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8400_ldo_ranges),
 	},
 	{
 		.name = "LDO3",
@@ -265,6 +255,9 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_ldo_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8400_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8400_ldo_ranges),
 	},
 	{
 		.name = "LDO4",
@@ -272,6 +265,9 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_ldo_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_LDO1_VSEL_MASK + 1,
+		.linear_ranges = wm8400_ldo_ranges,
+		.n_linear_ranges = ARRAY_SIZE(wm8400_ldo_ranges),
 	},
 	{
 		.name = "DCDC1",
@@ -279,6 +275,11 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_dcdc_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_DC1_VSEL_MASK + 1,
+		.min_uV = 850000,
+		.uV_step = 25000,
+		.mode_table = wm8400_dcdc_modes,
+		.n_mode_table = ARRAY_SIZE(wm8400_dcdc_modes),
 	},
 	{
 		.name = "DCDC2",
@@ -286,6 +287,11 @@ static struct regulator_desc regulators[] = {
 		.ops = &wm8400_dcdc_ops,
 		.type = REGULATOR_VOLTAGE,
 		.owner = THIS_MODULE,
+		.n_voltages = WM8400_DC1_VSEL_MASK + 1,
+		.min_uV = 850000,
+		.uV_step = 25000,
+		.mode_table = wm8400_dcdc_modes,
+		.n_mode_table = ARRAY_SIZE(wm8400_dcdc_modes),
 	},
 };
 
@@ -38,42 +38,43 @@
 static int wm8350_rtc_readtime(struct device *dev, struct rtc_time *tm)
 {
 	struct wm8350 *wm8350 = dev_get_drvdata(dev);
-	u16 time1[4], time2[4];
+	u16 time[4], secs;
 	int retries = WM8350_GET_TIME_RETRIES, ret;
 
 	/*
-	 * Read the time twice and compare.
-	 * If time1 == time2, then time is valid else retry.
+	 * Read the time, then the seconds again.  Anything that rolled
+	 * over while the time was being read also changed the seconds,
+	 * so if they still match the time is valid, else retry.
 	 */
 	do {
 		ret = wm8350_block_read(wm8350, WM8350_RTC_SECONDS_MINUTES,
-					4, time1);
+					4, time);
 		if (ret < 0)
 			return ret;
 		ret = wm8350_block_read(wm8350, WM8350_RTC_SECONDS_MINUTES,
-					4, time2);
+					1, &secs);
 		if (ret < 0)
 			return ret;
 
-		if (memcmp(time1, time2, sizeof(time1)) == 0) {
-			tm->tm_sec = time1[0] & WM8350_RTC_SECS_MASK;
+		if (secs == time[0]) {
+			tm->tm_sec = time[0] & WM8350_RTC_SECS_MASK;
 
-			tm->tm_min = (time1[0] & WM8350_RTC_MINS_MASK)
+			tm->tm_min = (time[0] & WM8350_RTC_MINS_MASK)
 			    >> WM8350_RTC_MINS_SHIFT;
 
-			tm->tm_hour = time1[1] & WM8350_RTC_HRS_MASK;
+			tm->tm_hour = time[1] & WM8350_RTC_HRS_MASK;
 
-			tm->tm_wday = ((time1[1] >> WM8350_RTC_DAY_SHIFT)
+			tm->tm_wday = ((time[1] >> WM8350_RTC_DAY_SHIFT)
 				       & 0x7) - 1;
 
-			tm->tm_mon = ((time1[2] & WM8350_RTC_MTH_MASK)
+			tm->tm_mon = ((time[2] & WM8350_RTC_MTH_MASK)
 				      >> WM8350_RTC_MTH_SHIFT) - 1;
 
-			tm->tm_mday = (time1[2] & WM8350_RTC_DATE_MASK);
+			tm->tm_mday = (time[2] & WM8350_RTC_DATE_MASK);
 
-			tm->tm_year = ((time1[3] & WM8350_RTC_YHUNDREDS_MASK)
+			tm->tm_year = ((time[3] & WM8350_RTC_YHUNDREDS_MASK)
 				       >> WM8350_RTC_YHUNDREDS_SHIFT) * 100;
-			tm->tm_year += time1[3] & WM8350_RTC_YUNITS_MASK;
+			tm->tm_year += time[3] & WM8350_RTC_YUNITS_MASK;
 
 			tm->tm_yday = rtc_year_days(tm->tm_mday, tm->tm_mon,
 						    tm->tm_year);
@@ -81,7 +82,7 @@ static int wm8350_rtc_readtime(struct device *dev, struct rtc_time *tm)
 
 			dev_dbg(dev, "Read (%d left): %04x %04x %04x %04x\n",
 				retries,
-				time1[0], time1[1], time1[2], time1[3]);
+				time[0], time[1], time[2], time[3]);
 
 			return 0;
 		}
@@ -319,6 +320,45 @@ static int wm8350_rtc_ioctl(struct device *dev, unsigned int cmd,
 	return 0;
 }
 
+/*
+ * The periodic interrupt ticks once a second; it's there for users of
+ * the periodic interrupt API and costs nothing while it's disabled.
+ */
+static int wm8350_rtc_irq_set_state(struct device *dev, int enabled)
+{
+	struct wm8350 *wm8350 = dev_get_drvdata(dev);
+	int ret;
+
+	if (!enabled)
+		wm8350_mask_irq(wm8350, WM8350_IRQ_RTC_PER);
+
+	ret = wm8350_reg_update_bits(wm8350, WM8350_RTC_TIME_CONTROL,
+				     WM8350_RTC_PINT_MASK,
+				     (enabled ? WM8350_RTC_PINT_SECS :
+				      WM8350_RTC_PINT_DISABLED)
+				     << WM8350_RTC_PINT_SHIFT);
+	if (ret < 0)
+		return ret;
+
+	if (enabled)
+		wm8350_unmask_irq(wm8350, WM8350_IRQ_RTC_PER);
+
+	return 0;
+}
+
+static int wm8350_rtc_irq_set_freq(struct device *dev, int freq)
+{
+	return freq == 1 ? 0 : -EINVAL;
+}
+
+static void wm8350_rtc_periodic_handler(struct wm8350 *wm8350, int irq,
+					void *data)
+{
+	struct rtc_device *rtc = wm8350->rtc.rtc;
+
+	rtc_update_irq(rtc, 1, RTC_IRQF | RTC_PF);
+}
+
 static void wm8350_rtc_alarm_handler(struct wm8350 *wm8350, int irq,
 				     void *data)
 {
@@ -350,6 +390,8 @@ static const struct rtc_class_ops wm8350_rtc_ops = {
 	.set_time = wm8350_rtc_settime,
 	.read_alarm = wm8350_rtc_readalarm,
 	.set_alarm = wm8350_rtc_setalarm,
+	.irq_set_state = wm8350_rtc_irq_set_state,
+	.irq_set_freq = wm8350_rtc_irq_set_freq,
 };
 
 #ifdef CONFIG_PM
@@ -464,6 +506,9 @@ static int wm8350_rtc_probe(struct platform_device *pdev)
 	wm8350_register_irq(wm8350, WM8350_IRQ_RTC_SEC,
 			    wm8350_rtc_update_handler, NULL);
 
+	wm8350_register_irq(wm8350, WM8350_IRQ_RTC_PER,
+			    wm8350_rtc_periodic_handler, NULL);
+
 	wm8350_register_irq(wm8350, WM8350_IRQ_RTC_ALM,
 			    wm8350_rtc_alarm_handler, NULL);
 	wm8350_unmask_irq(wm8350, WM8350_IRQ_RTC_ALM);
@@ -477,8 +522,10 @@ static int __devexit wm8350_rtc_remove(struct platform_device *pdev)
 	struct wm8350_rtc *wm_rtc = &wm8350->rtc;
 
 	wm8350_mask_irq(wm8350, WM8350_IRQ_RTC_SEC);
+	wm8350_mask_irq(wm8350, WM8350_IRQ_RTC_PER);
 
 	wm8350_free_irq(wm8350, WM8350_IRQ_RTC_SEC);
+	wm8350_free_irq(wm8350, WM8350_IRQ_RTC_PER);
 	wm8350_free_irq(wm8350, WM8350_IRQ_RTC_ALM);
 
 	rtc_device_unregister(wm_rtc->rtc);
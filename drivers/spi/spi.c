@@ -701,6 +701,53 @@ int spi_write_then_read(struct spi_device *spi,
 }
 EXPORT_SYMBOL_GPL(spi_write_then_read);
 
+/**
+ * spi_write_regs - SPI synchronous series of register writes
+ * @spi: device to which data will be written
+ * @txbuf: the writes, each of @len bytes, back to back (must be dma-safe)
+ * @len: size of each write, in bytes
+ * @count: number of writes
+ * Context: can sleep
+ *
+ * Register based devices such as codecs and PMICs typically take one
+ * register write per chipselect, latching it as chipselect goes
+ * inactive.  This sends @count such writes as a single message, with
+ * chipselect dropped between them, so that the controller can run them
+ * back to back and the caller waits for one completion rather than
+ * one per register.  The return value is zero for success, else a
+ * negative errno status code.
+ */
+int spi_write_regs(struct spi_device *spi, const void *txbuf,
+		unsigned len, unsigned count)
+{
+	struct spi_message	message;
+	struct spi_transfer	*x;
+	unsigned		i;
+	int			status;
+
+	if (!count)
+		return 0;
+
+	x = kcalloc(count, sizeof(*x), GFP_KERNEL);
+	if (!x)
+		return -ENOMEM;
+
+	spi_message_init(&message);
+	for (i = 0; i < count; i++) {
+		x[i].tx_buf = txbuf + i * len;
+		x[i].len = len;
+		/* a set cs_change on the last transfer would hold CS active */
+		x[i].cs_change = i != count - 1;
+		spi_message_add_tail(&x[i], &message);
+	}
+
+	status = spi_sync(spi, &message);
+
+	kfree(x);
+	return status;
+}
+EXPORT_SYMBOL_GPL(spi_write_regs);
+
 /*-------------------------------------------------------------------------*/
 
 static int __init spi_init(void)
@@ -13,6 +13,8 @@
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/fb.h>
+#include <linux/delay.h>
+#include <linux/regulator/consumer.h>
 
 #if defined(CONFIG_FB) || (defined(CONFIG_FB_MODULE) && \
 			   defined(CONFIG_LCD_CLASS_DEVICE_MODULE))
@@ -229,6 +231,159 @@ struct lcd_device *lcd_device_register(const char *name, struct device *parent,
 }
 EXPORT_SYMBOL(lcd_device_register);
 
+/**
+ * lcd_get_supplies - get the regulators powering a panel
+ * @ld: the lcd device, whose parent is the panel device.
+ * @supplies: the supplies and the power sequence the datasheet gives.
+ * @num_supplies: number of entries in @supplies.
+ *
+ * The supplies are requested for the parent of @ld and switched by
+ * lcd_power_on_supplies() and lcd_power_off_supplies(), which drivers
+ * call from their set_power() method around their own initialisation
+ * of the panel.  They are released when @ld is unregistered.
+ */
+int lcd_get_supplies(struct lcd_device *ld,
+		     const struct lcd_supply *supplies, int num_supplies)
+{
+	struct lcd_supply tmp;
+	int i, j, ret;
+
+	if (ld->supplies || !ld->dev.parent)
+		return -EINVAL;
+
+	ld->supply_seq = kmemdup(supplies, sizeof(*supplies) * num_supplies,
+				 GFP_KERNEL);
+	ld->supplies = kzalloc(sizeof(*ld->supplies) * num_supplies,
+			       GFP_KERNEL);
+	if (!ld->supply_seq || !ld->supplies) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	/* sort by step, keeping the given order within each step */
+	for (i = 1; i < num_supplies; i++) {
+		tmp = ld->supply_seq[i];
+		for (j = i; j > 0 && ld->supply_seq[j - 1].step > tmp.step; j--)
+			ld->supply_seq[j] = ld->supply_seq[j - 1];
+		ld->supply_seq[j] = tmp;
+	}
+
+	for (i = 0; i < num_supplies; i++)
+		ld->supplies[i].supply = ld->supply_seq[i].supply;
+
+	ret = regulator_bulk_get(ld->dev.parent, num_supplies, ld->supplies);
+	if (ret)
+		goto err;
+
+	ld->num_supplies = num_supplies;
+	return 0;
+
+err:
+	kfree(ld->supplies);
+	kfree(ld->supply_seq);
+	ld->supplies = NULL;
+	ld->supply_seq = NULL;
+	return ret;
+}
+EXPORT_SYMBOL(lcd_get_supplies);
+
+static void lcd_supply_delay(unsigned int us)
+{
+	if (us >= 1000)
+		msleep(DIV_ROUND_UP(us, 1000));
+	else if (us)
+		udelay(us);
+}
+
+/* number of supplies in the step starting at supply_seq[first] */
+static int lcd_supply_step_len(struct lcd_device *ld, int first)
+{
+	int i;
+
+	for (i = first; i < ld->num_supplies; i++)
+		if (ld->supply_seq[i].step != ld->supply_seq[first].step)
+			break;
+	return i - first;
+}
+
+/**
+ * lcd_power_on_supplies - run the panel power up sequence
+ * @ld: the lcd device.
+ *
+ * Each step's supplies are enabled together, those on different PMICs
+ * in parallel, and the next step starts once the longest datasheet
+ * delay of the step has passed.  Does nothing if the supplies are on
+ * already.  If a step fails the steps before it are switched off again.
+ */
+int lcd_power_on_supplies(struct lcd_device *ld)
+{
+	unsigned int delay;
+	int i, j, n, ret;
+
+	if (ld->supplies_on || !ld->num_supplies)
+		return 0;
+
+	for (i = 0; i < ld->num_supplies; i += n) {
+		n = lcd_supply_step_len(ld, i);
+
+		ret = regulator_bulk_enable(n, &ld->supplies[i]);
+		if (ret)
+			goto err;
+
+		/* no need to wait after the last step */
+		if (i + n == ld->num_supplies)
+			break;
+
+		delay = 0;
+		for (j = i; j < i + n; j++)
+			delay = max(delay, ld->supply_seq[j].delay_us);
+		lcd_supply_delay(delay);
+	}
+
+	ld->supplies_on = 1;
+	return 0;
+
+err:
+	dev_err(&ld->dev, "failed to power up panel: %d\n", ret);
+	if (i)
+		regulator_bulk_disable(i, ld->supplies);
+	return ret;
+}
+EXPORT_SYMBOL(lcd_power_on_supplies);
+
+/**
+ * lcd_power_off_supplies - run the panel power down sequence
+ * @ld: the lcd device.
+ *
+ * The steps of lcd_power_on_supplies() are undone in reverse order.  The
+ * datasheet delays are only needed on the way up and are not applied.
+ */
+int lcd_power_off_supplies(struct lcd_device *ld)
+{
+	int i, n, ret = 0, err;
+
+	if (!ld->supplies_on)
+		return 0;
+
+	i = ld->num_supplies;
+	while (i > 0) {
+		/* back to the first supply of the last step left on */
+		for (n = 1; n < i; n++)
+			if (ld->supply_seq[i - n - 1].step !=
+			    ld->supply_seq[i - 1].step)
+				break;
+		i -= n;
+
+		err = regulator_bulk_disable(n, &ld->supplies[i]);
+		if (err && !ret)
+			ret = err;
+	}
+
+	ld->supplies_on = 0;
+	return ret;
+}
+EXPORT_SYMBOL(lcd_power_off_supplies);
+
 /**
  * lcd_device_unregister - unregisters a object of lcd_device class.
  * @ld: the lcd device object to be unregistered and freed.
@@ -245,6 +400,13 @@ void lcd_device_unregister(struct lcd_device *ld)
 	mutex_unlock(&ld->ops_lock);
 	lcd_unregister_fb(ld);
 
+	if (ld->supplies) {
+		lcd_power_off_supplies(ld);
+		regulator_bulk_free(ld->num_supplies, ld->supplies);
+		kfree(ld->supplies);
+		kfree(ld->supply_seq);
+	}
+
 	device_unregister(&ld->dev);
 }
 EXPORT_SYMBOL(lcd_device_unregister);
@@ -48,7 +48,15 @@ static int platform_lcd_set_power(struct lcd_device *lcd, int power)
 	if (power == FB_BLANK_POWERDOWN || plcd->suspended)
 		lcd_power = 0;
 
-	plcd->pdata->set_power(plcd->pdata, lcd_power);
+	if (lcd_power)
+		lcd_power_on_supplies(lcd);
+
+	if (plcd->pdata->set_power)
+		plcd->pdata->set_power(plcd->pdata, lcd_power);
+
+	if (!lcd_power)
+		lcd_power_off_supplies(lcd);
+
 	plcd->power = power;
 
 	return 0;
@@ -100,11 +108,22 @@ static int __devinit platform_lcd_probe(struct platform_device *pdev)
 		goto err_mem;
 	}
 
+	if (pdata->num_supplies) {
+		err = lcd_get_supplies(plcd->lcd, pdata->supplies,
+				       pdata->num_supplies);
+		if (err) {
+			dev_err(dev, "cannot get supplies: %d\n", err);
+			goto err_lcd;
+		}
+	}
+
 	platform_set_drvdata(pdev, plcd);
 	platform_lcd_set_power(plcd->lcd, FB_BLANK_NORMAL);
 
 	return 0;
 
+ err_lcd:
+	lcd_device_unregister(plcd->lcd);
  err_mem:
 	kfree(plcd);
 	return err;
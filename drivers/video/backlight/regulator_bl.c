@@ -0,0 +1,225 @@
+/*
+ * linux/drivers/video/backlight/regulator_bl.c
+ *
+ * Backlight driven by a regulator current sink, such as the WM8350
+ * ISINKs.  Each brightness level is a current limit on the sink and
+ * blanking enables or disables it, so sinks with a hardware ramp (set up
+ * by the board's init() hook) fade the backlight in and out themselves
+ * in a single bus write.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/fb.h>
+#include <linux/backlight.h>
+#include <linux/err.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator_backlight.h>
+
+struct regulator_bl_data {
+	struct regulator	*isink;
+	const unsigned int	*levels_uA;
+	unsigned int		max_uA;
+	int			brightness;	/* level last programmed */
+	int			enabled;	/* we hold an enable */
+};
+
+static int regulator_bl_level_uA(struct regulator_bl_data *rb,
+				 struct backlight_device *bl, int brightness)
+{
+	if (rb->levels_uA)
+		return rb->levels_uA[brightness];
+	return rb->max_uA * brightness / bl->props.max_brightness;
+}
+
+static int regulator_bl_set(struct backlight_device *bl, int brightness)
+{
+	struct regulator_bl_data *rb = dev_get_drvdata(&bl->dev);
+	int ret;
+
+	/* userspace often rewrites the level it has already set */
+	if (brightness == rb->brightness)
+		return 0;
+
+	/* The current is left alone when turning off so the sink ramps
+	 * down from where it was and comes back at the same level.
+	 */
+	if (brightness) {
+		ret = regulator_set_current_limit(rb->isink, 0,
+				regulator_bl_level_uA(rb, bl, brightness));
+		if (ret < 0) {
+			dev_err(&bl->dev, "failed to set current: %d\n", ret);
+			return ret;
+		}
+	}
+
+	if (brightness && !rb->enabled) {
+		ret = regulator_enable(rb->isink);
+		if (ret < 0) {
+			dev_err(&bl->dev, "failed to enable: %d\n", ret);
+			return ret;
+		}
+		rb->enabled = 1;
+	} else if (!brightness && rb->enabled) {
+		ret = regulator_disable(rb->isink);
+		if (ret < 0) {
+			dev_err(&bl->dev, "failed to disable: %d\n", ret);
+			return ret;
+		}
+		rb->enabled = 0;
+	}
+
+	rb->brightness = brightness;
+	return 0;
+}
+
+static int regulator_bl_update_status(struct backlight_device *bl)
+{
+	int brightness = bl->props.brightness;
+
+	if (bl->props.power != FB_BLANK_UNBLANK)
+		brightness = 0;
+
+	if (bl->props.fb_blank != FB_BLANK_UNBLANK)
+		brightness = 0;
+
+	return regulator_bl_set(bl, brightness);
+}
+
+static int regulator_bl_get_brightness(struct backlight_device *bl)
+{
+	return bl->props.brightness;
+}
+
+static struct backlight_ops regulator_bl_ops = {
+	.update_status	= regulator_bl_update_status,
+	.get_brightness	= regulator_bl_get_brightness,
+};
+
+static int regulator_bl_probe(struct platform_device *pdev)
+{
+	struct platform_regulator_backlight_data *data =
+		pdev->dev.platform_data;
+	struct backlight_device *bl;
+	struct regulator_bl_data *rb;
+	int ret;
+
+	if (!data || !data->supply || !data->max_brightness) {
+		dev_err(&pdev->dev, "failed to find platform data\n");
+		return -EINVAL;
+	}
+
+	if (data->init) {
+		ret = data->init(&pdev->dev);
+		if (ret < 0)
+			return ret;
+	}
+
+	rb = kzalloc(sizeof(*rb), GFP_KERNEL);
+	if (!rb) {
+		dev_err(&pdev->dev, "no memory for state\n");
+		ret = -ENOMEM;
+		goto err_alloc;
+	}
+
+	rb->levels_uA = data->levels_uA;
+	rb->max_uA = data->max_uA;
+
+	rb->isink = regulator_get(&pdev->dev, data->supply);
+	if (IS_ERR(rb->isink)) {
+		dev_err(&pdev->dev, "unable to get %s supply\n", data->supply);
+		ret = PTR_ERR(rb->isink);
+		goto err_regulator;
+	}
+
+	bl = backlight_device_register(pdev->name, &pdev->dev,
+			rb, &regulator_bl_ops);
+	if (IS_ERR(bl)) {
+		dev_err(&pdev->dev, "failed to register backlight\n");
+		ret = PTR_ERR(bl);
+		goto err_bl;
+	}
+
+	bl->props.max_brightness = data->max_brightness;
+	bl->props.brightness = min(data->dft_brightness, data->max_brightness);
+	backlight_update_status(bl);
+
+	platform_set_drvdata(pdev, bl);
+	return 0;
+
+err_bl:
+	regulator_put(rb->isink);
+err_regulator:
+	kfree(rb);
+err_alloc:
+	if (data->exit)
+		data->exit(&pdev->dev);
+	return ret;
+}
+
+static int regulator_bl_remove(struct platform_device *pdev)
+{
+	struct platform_regulator_backlight_data *data =
+		pdev->dev.platform_data;
+	struct backlight_device *bl = platform_get_drvdata(pdev);
+	struct regulator_bl_data *rb = dev_get_drvdata(&bl->dev);
+
+	backlight_device_unregister(bl);
+	if (rb->enabled)
+		regulator_disable(rb->isink);
+	regulator_put(rb->isink);
+	kfree(rb);
+	if (data->exit)
+		data->exit(&pdev->dev);
+	return 0;
+}
+
+#ifdef CONFIG_PM
+static int regulator_bl_suspend(struct platform_device *pdev,
+				pm_message_t state)
+{
+	return regulator_bl_set(platform_get_drvdata(pdev), 0);
+}
+
+static int regulator_bl_resume(struct platform_device *pdev)
+{
+	backlight_update_status(platform_get_drvdata(pdev));
+	return 0;
+}
+#else
+#define regulator_bl_suspend	NULL
+#define regulator_bl_resume	NULL
+#endif
+
+static struct platform_driver regulator_bl_driver = {
+	.driver		= {
+		.name	= "regulator-backlight",
+		.owner	= THIS_MODULE,
+	},
+	.probe		= regulator_bl_probe,
+	.remove		= regulator_bl_remove,
+	.suspend	= regulator_bl_suspend,
+	.resume		= regulator_bl_resume,
+};
+
+static int __init regulator_bl_init(void)
+{
+	return platform_driver_register(&regulator_bl_driver);
+}
+module_init(regulator_bl_init);
+
+static void __exit regulator_bl_exit(void)
+{
+	platform_driver_unregister(&regulator_bl_driver);
+}
+module_exit(regulator_bl_exit);
+
+MODULE_DESCRIPTION("Regulator current sink based Backlight Driver");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:regulator-backlight");
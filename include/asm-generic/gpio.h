@@ -44,6 +44,10 @@ struct module;
  *	returns either the value actually sensed, or zero
  * @direction_output: configures signal "offset" as output, or returns error
  * @set: assigns output value for signal "offset"
+ * @get_multiple: optional hook reading all the signals set in "mask" at
+ *	once into the matching bits of "bits"; returns zero or an error
+ * @set_multiple: optional hook assigning output values from "bits" to
+ *	all the signals set in "mask" at once
  * @to_irq: optional hook supporting non-static gpio_to_irq() mappings;
  *	implementation may not sleep
  * @dbg_show: optional routine to show contents in debugfs; default code
@@ -84,6 +88,12 @@ struct gpio_chip {
 						unsigned offset, int value);
 	void			(*set)(struct gpio_chip *chip,
 						unsigned offset, int value);
+	int			(*get_multiple)(struct gpio_chip *chip,
+						unsigned long *mask,
+						unsigned long *bits);
+	void			(*set_multiple)(struct gpio_chip *chip,
+						unsigned long *mask,
+						unsigned long *bits);
 
 	int			(*to_irq)(struct gpio_chip *chip,
 						unsigned offset);
@@ -117,6 +127,11 @@ extern int gpio_direction_output(unsigned gpio, int value);
 extern int gpio_get_value_cansleep(unsigned gpio);
 extern void gpio_set_value_cansleep(unsigned gpio, int value);
 
+extern int gpio_get_multiple_cansleep(unsigned ngpio, const unsigned *gpios,
+				      int *values);
+extern void gpio_set_multiple_cansleep(unsigned ngpio, const unsigned *gpios,
+				       const int *values);
+
 
 /* A platform's <asm/gpio.h> code may want to inline the I/O calls when
  * the GPIO is constant and refers to some always-present controller,
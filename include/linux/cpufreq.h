@@ -31,6 +31,7 @@
 
 #define CPUFREQ_TRANSITION_NOTIFIER	(0)
 #define CPUFREQ_POLICY_NOTIFIER		(1)
+#define CPUFREQ_POLICY_TRANSITION_NOTIFIER	(2)
 
 #ifdef CONFIG_CPU_FREQ
 int cpufreq_register_notifier(struct notifier_block *nb, unsigned int list);
@@ -127,6 +128,18 @@ struct cpufreq_freqs {
 	u8 flags;		/* flags of cpufreq_driver, see below. */
 };
 
+/*
+ * Passed to CPUFREQ_POLICY_TRANSITION_NOTIFIER, which is called once for
+ * each transition of a policy however many CPUs it covers.
+ */
+struct cpufreq_policy_freqs {
+	struct cpufreq_policy *policy;
+	const cpumask_t *cpus;	/* all cpus changing frequency */
+	unsigned int old;
+	unsigned int new;
+	u8 flags;		/* flags of cpufreq_driver, see below. */
+};
+
 
 /**
  * cpufreq_scale - "old * mult / div" calculation for large values (32-bit-arch safe)
@@ -190,6 +203,11 @@ extern int __cpufreq_driver_target(struct cpufreq_policy *policy,
 extern int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
 				   unsigned int cpu);
 
+extern unsigned int __cpufreq_driver_transition_cost(
+					struct cpufreq_policy *policy,
+					unsigned int old_freq,
+					unsigned int new_freq);
+
 int cpufreq_register_governor(struct cpufreq_governor *governor);
 void cpufreq_unregister_governor(struct cpufreq_governor *governor);
 
@@ -229,6 +247,9 @@ struct cpufreq_driver {
 	/* optional */
 	unsigned int (*getavg)	(struct cpufreq_policy *policy,
 				 unsigned int cpu);
+	unsigned int (*transition_cost) (struct cpufreq_policy *policy,
+					 unsigned int old_freq,
+					 unsigned int new_freq);
 
 	int	(*exit)		(struct cpufreq_policy *policy);
 	int	(*suspend)	(struct cpufreq_policy *policy, pm_message_t pmsg);
@@ -362,6 +383,38 @@ void cpufreq_frequency_table_get_attr(struct cpufreq_frequency_table *table,
 
 void cpufreq_frequency_table_put_attr(unsigned int cpu);
 
+/* regulator based voltage scaling, see cpufreq_regulator.c */
+
+/**
+ * struct cpufreq_opp - CPU operating point
+ * @frequency: kHz, CPUFREQ_TABLE_END terminates the table
+ * @min_uV: lowest supply voltage the CPU runs reliably at
+ * @max_uV: highest supply voltage allowed
+ */
+struct cpufreq_opp {
+	unsigned int	frequency;
+	int		min_uV;
+	int		max_uV;
+};
+
+struct cpufreq_regulator;
+
+struct cpufreq_regulator *cpufreq_regulator_get(struct device *dev,
+						const struct cpufreq_opp *opp);
+void cpufreq_regulator_put(struct cpufreq_regulator *creg);
+int cpufreq_regulator_prechange(struct cpufreq_regulator *creg,
+				struct cpufreq_freqs *freqs);
+int cpufreq_regulator_postchange(struct cpufreq_regulator *creg,
+				 struct cpufreq_freqs *freqs);
+unsigned int cpufreq_regulator_transition_cost(struct cpufreq_regulator *creg,
+					       unsigned int old_freq,
+					       unsigned int new_freq);
+void cpufreq_regulator_set_fast_switch(struct cpufreq_regulator *creg,
+	int (*fast_switch)(void *data, const struct cpufreq_opp *opp),
+	void *data);
+int cpufreq_regulator_listen(struct cpufreq_regulator *creg, unsigned int cpu);
+void cpufreq_regulator_unlisten(struct cpufreq_regulator *creg);
+
 
 /*********************************************************************
  *                     UNIFIED DEBUG HELPERS                         *
@@ -38,6 +38,12 @@ struct cpuidle_state {
 	unsigned int	power_usage; /* in mW */
 	unsigned int	target_residency; /* in US */
 
+	/* optional low power mode of the rail supplying the CPU, which the
+	 * enter() callback may switch to when dev->regulator_mode is set */
+	unsigned int	regulator_mode; /* REGULATOR_MODE_, 0 if none */
+	unsigned int	regulator_latency; /* in US, added to exit_latency */
+	unsigned int	regulator_residency; /* in US, including the switch */
+
 	unsigned long long	usage;
 	unsigned long long	time; /* in US */
 
@@ -88,6 +94,7 @@ struct cpuidle_device {
 
 	int			last_residency;
 	int			state_count;
+	unsigned int		regulator_mode; /* for the state being entered */
 	struct cpuidle_state	states[CPUIDLE_STATE_MAX];
 	struct cpuidle_state_kobj *kobjs[CPUIDLE_STATE_MAX];
 	struct cpuidle_state	*last_state;
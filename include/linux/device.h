@@ -460,6 +460,25 @@ static inline void dev_set_drvdata(struct device *dev, void *data)
 	dev->driver_data = data;
 }
 
+/*
+ * Allow the device to be suspended and resumed in parallel with others,
+ * only waiting for its parent and children.  Call before registering.
+ */
+static inline void device_enable_async_suspend(struct device *dev)
+{
+	dev->power.async_suspend = 1;
+}
+
+/*
+ * Resume the device, and the devices above it, before any others once
+ * interrupts are back on.  For PMICs and their regulators, which the
+ * rest of the system needs powered before it can resume.
+ */
+static inline void device_enable_resume_first(struct device *dev)
+{
+	dev->power.resume_first = 1;
+}
+
 static inline int device_is_registered(struct device *dev)
 {
 	return dev->kobj.state_in_sysfs;
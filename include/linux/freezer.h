@@ -63,6 +63,10 @@ static inline int try_to_freeze(void)
 extern bool freeze_task(struct task_struct *p, bool sig_only);
 extern void cancel_freezing(struct task_struct *p);
 
+/* entries to the refrigerator, which wake up freezer_wait */
+extern atomic_t freezer_frozen_count;
+extern wait_queue_head_t freezer_wait;
+
 #ifdef CONFIG_CGROUP_FREEZER
 extern int cgroup_frozen(struct task_struct *task);
 #else /* !CONFIG_CGROUP_FREEZER */
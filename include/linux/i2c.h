@@ -34,6 +34,7 @@
 #include <linux/device.h>	/* for struct device */
 #include <linux/sched.h>	/* for completion */
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 extern struct bus_type i2c_bus_type;
 
@@ -46,6 +47,7 @@ struct i2c_client;
 struct i2c_driver;
 union i2c_smbus_data;
 struct i2c_board_info;
+struct i2c_adapter_stats;
 
 /*
  * The master routines are the ones normally used to transmit data to devices
@@ -62,6 +64,34 @@ extern int i2c_master_recv(struct i2c_client *client, char *buf, int count);
 extern int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 			int num);
 
+/**
+ * struct i2c_transaction - a queued combined I2C transfer
+ * @msgs: the messages, transferred as with i2c_transfer()
+ * @num: number of messages in @msgs
+ * @complete: called from task context once the transfer has finished
+ * @context: argument passed to @complete
+ * @status: number of messages transferred, or negative errno
+ * @queue: for use by the I2C core while the transaction is queued
+ *
+ * The transaction and the messages it points to belong to the I2C core
+ * from i2c_transfer_async() until @complete is called.
+ */
+struct i2c_transaction {
+	struct i2c_msg		*msgs;
+	int			num;
+
+	void			(*complete)(void *context);
+	void			*context;
+	int			status;
+
+	struct list_head	queue;
+};
+
+/* Queue a transfer from any context, including atomic ones.
+ */
+extern int i2c_transfer_async(struct i2c_adapter *adap,
+			      struct i2c_transaction *t);
+
 /* This is the very generalized SMBus access routine. You probably do not
    want to use this, though; one of the functions below may be much easier,
    and probably just as fast.
@@ -361,6 +391,15 @@ struct i2c_adapter {
 	struct mutex bus_lock;
 	struct mutex clist_lock;
 
+	/* i2c_transfer_async() queue, run in task context */
+	spinlock_t async_lock;
+	struct list_head async_queue;
+	struct work_struct async_work;
+
+#ifdef CONFIG_I2C_STATS
+	struct i2c_adapter_stats *stats;
+#endif
+
 	int timeout;
 	int retries;
 	struct device dev;		/* the adapter device */
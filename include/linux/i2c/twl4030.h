@@ -81,6 +81,30 @@ int twl4030_i2c_read_u8(u8 mod_no, u8 *val, u8 reg);
 int twl4030_i2c_write(u8 mod_no, u8 *value, u8 reg, u8 num_bytes);
 int twl4030_i2c_read(u8 mod_no, u8 *value, u8 reg, u8 num_bytes);
 
+/*
+ * Read-modify-write one or more registers in a module.  A batch is
+ * applied under a single lock, and with the module cache enabled the
+ * read half of each update usually never reaches the bus.
+ */
+struct twl4030_reg_update {
+	u8 reg;
+	u8 mask;
+	u8 value;
+};
+
+int twl4030_i2c_update_bits(u8 mod_no, u8 mask, u8 value, u8 reg);
+int twl4030_i2c_update_regs(u8 mod_no, const struct twl4030_reg_update *upd,
+			    unsigned num_updates);
+
+/*
+ * Optional register cache for the first num_regs registers of a module.
+ * Registers set in the volatile_regs bitmap (which may be NULL, and must
+ * stay valid while the cache is in use) are always read from the chip.
+ */
+int twl4030_i2c_cache_init(u8 mod_no, unsigned num_regs,
+			   const unsigned long *volatile_regs);
+void twl4030_i2c_cache_exit(u8 mod_no);
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -30,12 +30,28 @@
 
 struct lcd_device;
 struct fb_info;
+struct regulator_bulk_data;
 
 struct lcd_properties {
 	/* The maximum value for contrast (read-only) */
 	int max_contrast;
 };
 
+/**
+ * struct lcd_supply - a panel supply and its place in the power sequence
+ * @supply:   Name of the supply, as mapped to the panel's device.
+ * @step:     Supplies with the same step are switched on together, the
+ *            steps in ascending order; they are switched off in reverse.
+ * @delay_us: The datasheet minimum between this supply being stable and
+ *            the next step starting.  The regulator's own settling time
+ *            is already waited for by the regulator API.
+ */
+struct lcd_supply {
+	const char *supply;
+	unsigned int step;
+	unsigned int delay_us;
+};
+
 struct lcd_ops {
 	/* Get the LCD panel power status (0: full on, 1..3: controller
 	   power on, flat panel power off, 4: full off), see FB_BLANK_XXX */
@@ -66,6 +82,12 @@ struct lcd_device {
 	/* The framebuffer notifier block */
 	struct notifier_block fb_notif;
 
+	/* Panel supplies in power up order, see lcd_get_supplies() */
+	int num_supplies;
+	struct lcd_supply *supply_seq;
+	struct regulator_bulk_data *supplies;
+	int supplies_on;
+
 	struct device dev;
 };
 
@@ -81,6 +103,11 @@ extern struct lcd_device *lcd_device_register(const char *name,
 	struct device *parent, void *devdata, struct lcd_ops *ops);
 extern void lcd_device_unregister(struct lcd_device *ld);
 
+extern int lcd_get_supplies(struct lcd_device *ld,
+	const struct lcd_supply *supplies, int num_supplies);
+extern int lcd_power_on_supplies(struct lcd_device *ld);
+extern int lcd_power_off_supplies(struct lcd_device *ld);
+
 #define to_lcd_device(obj) container_of(obj, struct lcd_device, dev)
 
 static inline void * lcd_get_data(struct lcd_device *ld_dev)
@@ -0,0 +1,29 @@
+/*
+ * leds-regulator.h - platform data for LEDs on regulator current sinks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __LINUX_LEDS_REGULATOR_H
+#define __LINUX_LEDS_REGULATOR_H
+
+/**
+ * struct led_regulator_platform_data - LED on a regulator current sink
+ *
+ * @name:            LED class device name.
+ * @default_trigger: Trigger to attach at registration, may be NULL.
+ * @supply:          Name of the current sink supply driving the LED.
+ * @max_uA:          Current at LED_FULL, scaled linearly below that.  If
+ *                   zero the LED is only switched on and off and the
+ *                   sink's current limit is left alone.
+ */
+struct led_regulator_platform_data {
+	const char *name;
+	const char *default_trigger;
+	const char *supply;
+	unsigned int max_uA;
+};
+
+#endif /* __LINUX_LEDS_REGULATOR_H */
@@ -15,6 +15,8 @@
 #define MFD_CORE_H
 
 #include <linux/platform_device.h>
+#include <linux/wait.h>
+#include <asm/atomic.h>
 
 /*
  * This struct describes the MFD part ("cell").
@@ -52,4 +54,18 @@ extern int mfd_add_devices(struct device *parent, int id,
 
 extern void mfd_remove_devices(struct device *parent);
 
+/*
+ * Tracks children being registered (and so probed) in the background,
+ * letting independent children probe concurrently.
+ */
+struct mfd_async {
+	atomic_t		pending;
+	wait_queue_head_t	wait;
+};
+
+extern void mfd_async_init(struct mfd_async *async);
+extern void mfd_platform_device_add_async(struct mfd_async *async,
+					  struct platform_device **pdev);
+extern void mfd_async_synchronize(struct mfd_async *async);
+
 #endif
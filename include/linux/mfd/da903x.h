@@ -102,6 +102,10 @@ struct da903x_subdev_info {
 struct da903x_platform_data {
 	int num_subdevs;
 	struct da903x_subdev_info *subdevs;
+
+	/* answer reads of non-volatile registers from a cache and skip
+	 * writes which wouldn't change them */
+	int cache_regs;
 };
 
 /* bit definitions for DA9030 events */
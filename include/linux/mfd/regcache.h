@@ -0,0 +1,75 @@
+/*
+ * regcache.h  --  Register cache helpers shared by MFD core drivers
+ *
+ * Drivers keep their own bus I/O and cache storage and call these with
+ * callbacks into them.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __LINUX_MFD_REGCACHE_H
+#define __LINUX_MFD_REGCACHE_H
+
+#include <linux/types.h>
+
+struct device;
+struct dentry;
+
+/**
+ * struct mfd_regdump - debugfs snapshot of a register map
+ * @num_regs: size of the register map
+ * @max_block: most registers @read can take at once
+ * @reg_digits: hex digits to print register numbers with
+ * @val_digits: hex digits to print register values with
+ * @readable: whether a register is dumped; registers with side effects
+ *            on read, such as clear on read interrupt status, must not be
+ * @cached: if the cache holds @reg store its value in @val and return
+ *          non-zero, otherwise return zero; may be NULL
+ * @read: read @count registers from the chip, starting at @reg
+ * @lock: taken around each snapshot to stop the map changing under it
+ * @unlock: releases @lock
+ * @data: passed to the callbacks
+ *
+ * Registered with mfd_regdump_add(), the rest is private.
+ */
+struct mfd_regdump {
+	unsigned int num_regs;
+	unsigned int max_block;
+	int reg_digits;
+	int val_digits;
+	int (*readable)(void *data, unsigned int reg);
+	int (*cached)(void *data, unsigned int reg, unsigned int *val);
+	int (*read)(void *data, unsigned int reg, unsigned int count,
+		    unsigned int *vals);
+	void (*lock)(void *data);
+	void (*unlock)(void *data);
+	void *data;
+
+	u32 bypass;
+	struct dentry *dir;
+};
+
+#ifdef CONFIG_DEBUG_FS
+int mfd_regdump_add(struct mfd_regdump *dump, struct device *dev);
+void mfd_regdump_remove(struct mfd_regdump *dump);
+#else
+static inline int mfd_regdump_add(struct mfd_regdump *dump,
+				  struct device *dev)
+{
+	return 0;
+}
+
+static inline void mfd_regdump_remove(struct mfd_regdump *dump)
+{
+}
+#endif
+
+int mfd_regcache_sync(unsigned long *dirty, unsigned int num_regs,
+		      unsigned int max_block,
+		      int (*write)(void *data, unsigned int reg,
+				   unsigned int count),
+		      void *data);
+
+#endif
@@ -12,6 +12,10 @@
 #ifndef __LINUX_MFD_WM8350_COMPARATOR_H_
 #define __LINUX_MFD_WM8350_COMPARATOR_H_
 
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+
 /*
  * Registers
  */
@@ -164,4 +168,44 @@
 #define WM8350_AUXADC_BATT			6
 #define WM8350_AUXADC_TEMP			7
 
+struct wm8350;
+
+/**
+ * struct wm8350_auxadc_request - an AUXADC conversion
+ * @channel: WM8350_AUXADC_ channel to convert
+ * @scale: input scaling, AUX1-4 only
+ * @vref: non-zero to use the external reference, AUX1-4 only
+ * @complete: called once the conversion is done, may submit again
+ * @data: for use by the submitter
+ * @value: 12 bit result or negative errno, valid in @complete
+ * @queued: set while the AUXADC core owns the request, under its lock
+ */
+struct wm8350_auxadc_request {
+	struct list_head list;
+	int queued;
+	int channel;
+	int scale;
+	int vref;
+	void (*complete)(struct wm8350 *wm8350,
+			 struct wm8350_auxadc_request *req);
+	void *data;
+	int value;
+};
+
+struct wm8350_auxadc {
+	struct mutex lock;
+	struct list_head pending;	/* waiting for a sequence */
+	struct list_head active;	/* in the running sequence */
+	int irq;			/* DATARDY handler registered */
+	struct delayed_work poll_work;	/* without it, poll for the result */
+	unsigned long started;		/* jiffies the sequence started */
+};
+
+int wm8350_auxadc_submit(struct wm8350 *wm8350,
+			 struct wm8350_auxadc_request *req);
+int wm8350_auxadc_cancel(struct wm8350 *wm8350,
+			 struct wm8350_auxadc_request *req);
+int wm8350_read_auxadc(struct wm8350 *wm8350, int channel, int scale,
+		       int vref);
+
 #endif
@@ -14,10 +14,15 @@
 #define __LINUX_MFD_WM8350_CORE_H_
 
 #include <linux/kernel.h>
+#include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/workqueue.h>
+#include <linux/mfd/core.h>
+#include <linux/mfd/regcache.h>
 
 #include <linux/mfd/wm8350/audio.h>
+#include <linux/mfd/wm8350/comparator.h>
 #include <linux/mfd/wm8350/gpio.h>
 #include <linux/mfd/wm8350/pmic.h>
 #include <linux/mfd/wm8350/rtc.h>
@@ -60,6 +65,9 @@
 
 #define WM8350_MAX_REGISTER                     0xFF
 
+/* the audio block, which the CODEC driver may power down separately */
+#define WM8350_AUDIO_NUM_REGS	(WM8350_AIF_TEST - WM8350_CLOCK_CONTROL_1 + 1)
+
 /*
  * Field Definitions.
  */
@@ -571,20 +579,36 @@ struct wm8350 {
 	int (*write_dev)(struct wm8350 *wm8350, char reg, int size,
 			 void *src);
 	u16 *reg_cache;
+	struct mutex io_mutex;	/* register cache and bus access */
+	int cache_only;		/* writes only update reg_cache */
+	int hibernating;	/* put into hibernate by wm8350_hibernate() */
+	DECLARE_BITMAP(reg_dirty, WM8350_MAX_REGISTER + 1);
+	const u16 *reg_defaults;	/* defaults of the config mode */
+
+	/* audio block powered down, see wm8350_audio_cache_only() */
+	int audio_cache_only;	/* audio writes only update reg_cache */
+	int audio_reset;	/* audio registers back at their defaults */
+	DECLARE_BITMAP(audio_dirty, WM8350_AUDIO_NUM_REGS);
+	struct mfd_regdump regdump;	/* debugfs register snapshot */
 
 	/* Interrupt handling */
 	struct work_struct irq_work;
 	struct mutex irq_mutex; /* IRQ table mutex */
 	struct wm8350_irq irq[WM8350_NUM_IRQ];
 	int chip_irq;
+	spinlock_t irq_lock;	/* irq_suspended and irq_deferred */
+	int irq_suspended;	/* hold interrupts back until resume */
+	int irq_deferred;	/* an interrupt came in while suspended */
 
 	/* Client devices */
+	struct mfd_async client_async;	/* client registration in progress */
 	struct wm8350_codec codec;
 	struct wm8350_gpio gpio;
 	struct wm8350_pmic pmic;
 	struct wm8350_power power;
 	struct wm8350_rtc rtc;
 	struct wm8350_wdt wdt;
+	struct wm8350_auxadc auxadc;
 };
 
 /**
@@ -604,18 +628,29 @@ struct wm8350_platform_data {
 int wm8350_device_init(struct wm8350 *wm8350, int irq,
 		       struct wm8350_platform_data *pdata);
 void wm8350_device_exit(struct wm8350 *wm8350);
+int wm8350_device_suspend(struct wm8350 *wm8350);
+int wm8350_device_resume(struct wm8350 *wm8350);
+int wm8350_hibernate(struct wm8350 *wm8350);
+int wm8350_wake(struct wm8350 *wm8350);
 
 /*
  * WM8350 device IO
  */
+int wm8350_reg_update_bits(struct wm8350 *wm8350, u16 reg, u16 mask, u16 val);
 int wm8350_clear_bits(struct wm8350 *wm8350, u16 reg, u16 mask);
 int wm8350_set_bits(struct wm8350 *wm8350, u16 reg, u16 mask);
+int wm8350_reg_volatile(int reg);
 u16 wm8350_reg_read(struct wm8350 *wm8350, int reg);
 int wm8350_reg_write(struct wm8350 *wm8350, int reg, u16 val);
+int wm8350_reg_rewrite(struct wm8350 *wm8350, int reg, u16 *buf);
 int wm8350_reg_lock(struct wm8350 *wm8350);
 int wm8350_reg_unlock(struct wm8350 *wm8350);
 int wm8350_block_read(struct wm8350 *wm8350, int reg, int size, u16 *dest);
 int wm8350_block_write(struct wm8350 *wm8350, int reg, int size, u16 *src);
+void wm8350_cache_only(struct wm8350 *wm8350, int enable);
+int wm8350_cache_sync(struct wm8350 *wm8350);
+void wm8350_audio_cache_only(struct wm8350 *wm8350, int reset);
+int wm8350_audio_cache_sync(struct wm8350 *wm8350);
 
 /*
  * WM8350 internal interrupts
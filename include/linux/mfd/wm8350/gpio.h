@@ -329,6 +329,9 @@ struct wm8350;
 
 int wm8350_gpio_config(struct wm8350 *wm8350, int gpio, int dir, int func,
 		       int pol, int pull, int invert, int debounce);
+int wm8350_gpio_config_mask(struct wm8350 *wm8350, u16 mask, int dir,
+			    int func, int pol, int pull, int invert,
+			    int debounce);
 
 struct wm8350_gpio {
 	struct platform_device *pdev;
@@ -647,6 +647,11 @@
 #define WM8350_ISINK_A				10
 #define WM8350_ISINK_B				11
 
+/*
+ * Battery charger, the fast charge current limit is settable
+ */
+#define WM8350_CHARGER				12
+
 #define WM8350_ISINK_MODE_BOOST			0
 #define WM8350_ISINK_MODE_SWITCH		1
 #define WM8350_ISINK_ILIM_NORMAL		0
@@ -662,20 +667,20 @@
 #define WM8350_ISINK_FLASH_DUR_64MS		(1 << 8)
 #define WM8350_ISINK_FLASH_DUR_96MS		(2 << 8)
 #define WM8350_ISINK_FLASH_DUR_1024MS		(3 << 8)
-#define WM8350_ISINK_FLASH_ON_INSTANT		(0 << 4)
-#define WM8350_ISINK_FLASH_ON_0_25S		(1 << 4)
-#define WM8350_ISINK_FLASH_ON_0_50S		(2 << 4)
-#define WM8350_ISINK_FLASH_ON_1_00S		(3 << 4)
-#define WM8350_ISINK_FLASH_ON_1_95S		(1 << 4)
-#define WM8350_ISINK_FLASH_ON_3_91S		(2 << 4)
-#define WM8350_ISINK_FLASH_ON_7_80S		(3 << 4)
-#define WM8350_ISINK_FLASH_OFF_INSTANT		(0 << 0)
-#define WM8350_ISINK_FLASH_OFF_0_25S		(1 << 0)
-#define WM8350_ISINK_FLASH_OFF_0_50S		(2 << 0)
-#define WM8350_ISINK_FLASH_OFF_1_00S		(3 << 0)
-#define WM8350_ISINK_FLASH_OFF_1_95S		(1 << 0)
-#define WM8350_ISINK_FLASH_OFF_3_91S		(2 << 0)
-#define WM8350_ISINK_FLASH_OFF_7_80S		(3 << 0)
+#define WM8350_ISINK_FLASH_ON_INSTANT		(0 << 0)
+#define WM8350_ISINK_FLASH_ON_0_25S		(1 << 0)
+#define WM8350_ISINK_FLASH_ON_0_50S		(2 << 0)
+#define WM8350_ISINK_FLASH_ON_1_00S		(3 << 0)
+#define WM8350_ISINK_FLASH_ON_1_95S		(1 << 0)
+#define WM8350_ISINK_FLASH_ON_3_91S		(2 << 0)
+#define WM8350_ISINK_FLASH_ON_7_80S		(3 << 0)
+#define WM8350_ISINK_FLASH_OFF_INSTANT		(0 << 4)
+#define WM8350_ISINK_FLASH_OFF_0_25S		(1 << 4)
+#define WM8350_ISINK_FLASH_OFF_0_50S		(2 << 4)
+#define WM8350_ISINK_FLASH_OFF_1_00S		(3 << 4)
+#define WM8350_ISINK_FLASH_OFF_1_95S		(1 << 4)
+#define WM8350_ISINK_FLASH_OFF_3_91S		(2 << 4)
+#define WM8350_ISINK_FLASH_OFF_7_80S		(3 << 4)
 
 /*
  * Regulator Interrupts.
@@ -694,7 +699,7 @@
 #define WM8350_IRQ_UV_DC1			34
 #define WM8350_IRQ_OC_LS			35
 
-#define NUM_WM8350_REGULATORS			12
+#define NUM_WM8350_REGULATORS			13
 
 struct wm8350;
 struct platform_device;
@@ -710,6 +715,13 @@ struct wm8350_pmic {
 	u16 dcdc3_hib_mode;
 	u16 dcdc4_hib_mode;
 	u16 dcdc6_hib_mode;
+	u16 dvs;	/* DCDCs using their image voltage for DVS */
+
+	/* rails switched by an LPWR input, see wm8350_set_hw_enable() */
+	u16 hw_ena;
+	u16 hw_ena_off;		/* switched off by their GPIO */
+	u16 hw_ena_hib[NUM_WM8350_REGULATORS];	/* hibernate mode before */
+	int hw_ena_gpio[NUM_WM8350_REGULATORS];
 
 	/* regulator devices */
 	struct platform_device *pdev[NUM_WM8350_REGULATORS];
@@ -717,6 +729,8 @@ struct wm8350_pmic {
 
 int wm8350_register_regulator(struct wm8350 *wm8350, int reg,
 			      struct regulator_init_data *initdata);
+int wm8350_set_hw_enable(struct wm8350 *wm8350, int reg, u16 signal,
+			 int gpio);
 
 /*
  * Additional DCDC control not supported via regulator API
@@ -725,6 +739,7 @@ int wm8350_dcdc_set_slot(struct wm8350 *wm8350, int dcdc, u16 start,
 			 u16 stop, u16 fault);
 int wm8350_dcdc25_set_mode(struct wm8350 *wm8350, int dcdc, u16 mode,
 			   u16 ilim, u16 ramp, u16 feedback);
+int wm8350_dcdc_set_dvs(struct wm8350 *wm8350, int dcdc, int uV, u16 signal);
 
 /*
  * Additional LDO control not supported via regulator API
@@ -737,5 +752,7 @@ int wm8350_ldo_set_slot(struct wm8350 *wm8350, int ldo, u16 start, u16 stop);
 int wm8350_isink_set_flash(struct wm8350 *wm8350, int isink, u16 mode,
 			   u16 trigger, u16 duration, u16 on_ramp,
 			   u16 off_ramp, u16 drive);
+int wm8350_isink_set_ramp(struct wm8350 *wm8350, int isink, u16 on_ramp,
+			  u16 off_ramp);
 
 #endif
@@ -14,6 +14,11 @@
 #define __LINUX_MFD_WM8350_SUPPLY_H_
 
 #include <linux/platform_device.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <linux/power_supply.h>
+#include <linux/mfd/wm8350/comparator.h>
 
 /*
  * Charger registers
@@ -104,8 +109,42 @@
 #define WM8350_IRQ_EXT_WALL_FB			37
 #define WM8350_IRQ_EXT_BAT_FB			38
 
+/*
+ * Supplies, as bits of wm8350_power.supplies
+ */
+#define WM8350_BATT_SUPPLY			(1 << 0)
+#define WM8350_USB_SUPPLY			(1 << 1)
+#define WM8350_LINE_SUPPLY			(1 << 2)
+
+/* AUXADC conversions made for each refresh of the supply voltages */
+#define WM8350_POWER_ADC_CHANNELS		3
+
 struct wm8350_power {
 	struct platform_device *pdev;
+	struct power_supply battery;
+	struct power_supply usb;
+	struct power_supply ac;
+
+	/*
+	 * State as last reported by the charger interrupts and the AUXADC,
+	 * so property reads never touch the bus.
+	 */
+	struct mutex lock;
+	int supplies;		/* WM8350_*_SUPPLY connected */
+	u16 chg_sts;		/* WM8350_CHG_STS_* */
+	int charge_done;	/* charge ended since the last start */
+	int health;		/* POWER_SUPPLY_HEALTH_* of the battery */
+	int batt_uV;
+	int usb_uV;
+	int line_uV;
+
+	/* supply voltage refresh */
+	struct wm8350_auxadc_request adc[WM8350_POWER_ADC_CHANNELS];
+	int adc_busy;		/* conversions outstanding */
+	int adc_again;		/* refresh again once they are done */
+	int notify;		/* supplies to report once they are done */
+	wait_queue_head_t adc_wait;
+	struct delayed_work work;
 };
 
 #endif
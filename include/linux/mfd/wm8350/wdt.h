@@ -23,6 +23,7 @@
 
 struct wm8350_wdt {
 	struct platform_device *pdev;
+	u16 kick;		/* bus buffer for wm8350_reg_rewrite() */
 };
 
 #endif
@@ -22,6 +22,8 @@
 #define __LINUX_MFD_WM8400_PRIV_H
 
 #include <linux/mfd/wm8400.h>
+#include <linux/mfd/regcache.h>
+#include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 
@@ -37,6 +39,9 @@ struct wm8400 {
 	void *io_data;
 
 	u16 reg_cache[WM8400_REGISTER_COUNT];
+	/* registers changed in the cache but not yet written back */
+	DECLARE_BITMAP(reg_dirty, WM8400_REGISTER_COUNT);
+	struct mfd_regdump regdump;	/* debugfs register snapshot */
 
 	struct platform_device regulators[6];
 };
@@ -933,4 +938,8 @@ u16 wm8400_reg_read(struct wm8400 *wm8400, u8 reg);
 int wm8400_block_read(struct wm8400 *wm8400, u8 reg, int count, u16 *data);
 int wm8400_set_bits(struct wm8400 *wm8400, u8 reg, u16 mask, u16 val);
 
+void wm8400_reg_lock(struct wm8400 *wm8400);
+int __wm8400_set_bits(struct wm8400 *wm8400, u8 reg, u16 mask, u16 val);
+int wm8400_reg_unlock(struct wm8400 *wm8400);
+
 #endif
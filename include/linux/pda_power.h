@@ -31,6 +31,27 @@ struct pda_power_pdata {
 	unsigned int wait_for_status; /* msecs, default is 500 */
 	unsigned int wait_for_charger; /* msecs, default is 500 */
 	unsigned int polling_interval; /* msecs, default is 2000 */
+	/* polling backs off to this while nothing changes, default 4x above */
+	unsigned int polling_max_interval; /* msecs */
+
+	/*
+	 * Set if the board reports every change of AC/USB status by calling
+	 * pda_power_changed(), for example from a PMIC charger interrupt.
+	 * Status is then never polled.
+	 */
+	int status_events;
+
+	/*
+	 * Without set_charge() the "charger" regulator is used, if the
+	 * board has one, with its current limit set to ac_max_uA on AC or
+	 * to the current negotiated through pda_power_usb_draw() on USB.
+	 * Leaving ac_max_uA as 0 charges from AC without a limit beyond
+	 * the regulator constraints.
+	 */
+	int ac_max_uA;
 };
 
+extern void pda_power_usb_draw(unsigned int mA);
+extern void pda_power_changed(void);
+
 #endif /* __PDA_POWER_H__ */
@@ -22,6 +22,10 @@
 #define _LINUX_PM_H
 
 #include <linux/list.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
 
 /*
  * Callbacks for platform drivers to implement.
@@ -126,6 +130,15 @@ typedef struct pm_message {
  *	On most platforms, there are no restrictions on availability of
  *	resources like clocks during @restore().
  *
+ * @runtime_suspend: Put the device into a low power state while the system
+ *	is running, because it has been idle for its autosuspend delay (see
+ *	Documentation/power/runtime_pm.txt).  The device must not need to do
+ *	anything until ->runtime_resume() is called for it.  Returning -EBUSY
+ *	or -EAGAIN leaves the device active.
+ *
+ * @runtime_resume: Bring the device back from the low power state entered
+ *	by ->runtime_suspend(), because somebody wants to use it.
+ *
  * All of the above callbacks, except for @complete(), return error codes.
  * However, the error codes returned by the resume operations, @resume(),
  * @thaw(), and @restore(), do not cause the PM core to abort the resume
@@ -151,6 +164,8 @@ struct pm_ops {
 	int (*thaw)(struct device *dev);
 	int (*poweroff)(struct device *dev);
 	int (*restore)(struct device *dev);
+	int (*runtime_suspend)(struct device *dev);
+	int (*runtime_resume)(struct device *dev);
 };
 
 /**
@@ -341,13 +356,42 @@ enum dpm_state {
 	DPM_OFF_IRQ,
 };
 
+/*
+ * Device run-time power management status, owned by the runtime PM core.
+ *
+ * RPM_ACTIVE		Device is fully operational.  Set before the device is
+ *			used after ->runtime_resume() has succeeded, or by
+ *			pm_runtime_set_active().
+ *
+ * RPM_SUSPENDED	->runtime_suspend() has succeeded for the device, or
+ *			the driver never said it was active.
+ */
+
+enum rpm_status {
+	RPM_ACTIVE,
+	RPM_SUSPENDED,
+};
+
 struct dev_pm_info {
 	pm_message_t		power_state;
 	unsigned		can_wakeup:1;
 	unsigned		should_wakeup:1;
+	unsigned		async_suspend:1;
+	unsigned		resume_first:1;
 	enum dpm_state		status;		/* Owned by the PM core */
 #ifdef	CONFIG_PM_SLEEP
 	struct list_head	entry;
+	struct completion	completion;	/* Owned by the PM core */
+#endif
+#ifdef	CONFIG_PM_RUNTIME
+	struct mutex		runtime_mutex;	/* serialises transitions */
+	struct delayed_work	suspend_work;
+	atomic_t		usage_count;
+	int			disable_depth;
+	enum rpm_status		runtime_status;
+	int			autosuspend_delay;	/* ms */
+	unsigned long		last_busy;	/* jiffies */
+	struct blocking_notifier_head runtime_notifier;
 #endif
 };
 
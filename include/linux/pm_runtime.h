@@ -0,0 +1,92 @@
+/*
+ * pm_runtime.h - Device run-time power management
+ *
+ * This file is released under the GPLv2.
+ *
+ * See Documentation/power/runtime_pm.txt.
+ */
+
+#ifndef _LINUX_PM_RUNTIME_H
+#define _LINUX_PM_RUNTIME_H
+
+#include <linux/device.h>
+#include <linux/jiffies.h>
+#include <linux/notifier.h>
+
+/* Events passed to a device's runtime PM notifiers */
+#define RPM_NOTIFY_SUSPENDED	0x0001	/* ->runtime_suspend() succeeded */
+#define RPM_NOTIFY_RESUMING	0x0002	/* ->runtime_resume() is next */
+
+#ifdef CONFIG_PM_RUNTIME
+
+extern int pm_runtime_get_sync(struct device *dev);
+extern void pm_runtime_put(struct device *dev);
+extern int pm_runtime_put_sync(struct device *dev);
+extern int pm_runtime_suspend(struct device *dev);
+extern int pm_runtime_resume(struct device *dev);
+extern void pm_runtime_enable(struct device *dev);
+extern void pm_runtime_disable(struct device *dev);
+extern int pm_runtime_set_active(struct device *dev);
+extern int pm_runtime_set_suspended(struct device *dev);
+extern void pm_runtime_set_autosuspend_delay(struct device *dev, int delay);
+extern int pm_runtime_register_notifier(struct device *dev,
+					struct notifier_block *nb);
+extern int pm_runtime_unregister_notifier(struct device *dev,
+					  struct notifier_block *nb);
+
+static inline void pm_runtime_get_noresume(struct device *dev)
+{
+	atomic_inc(&dev->power.usage_count);
+}
+
+static inline void pm_runtime_mark_last_busy(struct device *dev)
+{
+	dev->power.last_busy = jiffies;
+}
+
+static inline int pm_runtime_suspended(struct device *dev)
+{
+	return dev->power.runtime_status == RPM_SUSPENDED &&
+		!dev->power.disable_depth;
+}
+
+/* the status alone, whether or not run-time PM is enabled */
+static inline int pm_runtime_status_suspended(struct device *dev)
+{
+	return dev->power.runtime_status == RPM_SUSPENDED;
+}
+
+#else /* !CONFIG_PM_RUNTIME */
+
+static inline int pm_runtime_get_sync(struct device *dev) { return 0; }
+static inline void pm_runtime_put(struct device *dev) {}
+static inline int pm_runtime_put_sync(struct device *dev) { return 0; }
+static inline int pm_runtime_suspend(struct device *dev) { return -ENOSYS; }
+static inline int pm_runtime_resume(struct device *dev) { return 0; }
+static inline void pm_runtime_enable(struct device *dev) {}
+static inline void pm_runtime_disable(struct device *dev) {}
+static inline int pm_runtime_set_active(struct device *dev) { return 0; }
+static inline int pm_runtime_set_suspended(struct device *dev) { return 0; }
+static inline void pm_runtime_set_autosuspend_delay(struct device *dev,
+						    int delay) {}
+static inline int pm_runtime_register_notifier(struct device *dev,
+					       struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int pm_runtime_unregister_notifier(struct device *dev,
+						 struct notifier_block *nb)
+{
+	return 0;
+}
+static inline void pm_runtime_get_noresume(struct device *dev) {}
+static inline void pm_runtime_mark_last_busy(struct device *dev) {}
+static inline int pm_runtime_suspended(struct device *dev) { return 0; }
+static inline int pm_runtime_status_suspended(struct device *dev)
+{
+	return 0;
+}
+
+#endif /* !CONFIG_PM_RUNTIME */
+
+#endif /* _LINUX_PM_RUNTIME_H */
@@ -110,6 +110,9 @@ union power_supply_propval {
 	const char *strval;
 };
 
+struct power_supply_snapshot;
+struct power_supply_ratelimit;
+
 struct power_supply {
 	const char *name;
 	enum power_supply_type type;
@@ -124,12 +127,37 @@ struct power_supply {
 			    union power_supply_propval *val);
 	void (*external_power_changed)(struct power_supply *psy);
 
+	/*
+	 * Optional: read all of properties[] in one batch, setting vals[i]
+	 * and rets[i] (0 or -errno) for properties[i].  Property reads are
+	 * then answered from this snapshot until it is snapshot_ms old or
+	 * power_supply_changed() is called.
+	 */
+	void (*get_properties)(struct power_supply *psy,
+			       union power_supply_propval *vals, int *rets);
+	unsigned int snapshot_ms;
+
+	/*
+	 * Optional: deliver change notifications at most once every
+	 * changed_min_ms, so a burst of power_supply_changed() calls is
+	 * reported once with the latest state.  Going offline, being
+	 * removed, becoming unhealthy or falling to capacity_critical
+	 * percent are always reported straight away.
+	 */
+	unsigned int changed_min_ms;
+	int capacity_critical;
+
 	/* For APM emulation, think legacy userspace. */
 	int use_for_apm;
 
 	/* private */
 	struct device *dev;
 	struct work_struct changed_work;
+	struct list_head node;		/* registered supplies */
+	struct list_head supplicants;	/* links to the supplies we feed */
+	struct list_head suppliers;	/* links to the supplies feeding us */
+	struct power_supply_snapshot *snapshot;
+	struct power_supply_ratelimit *ratelimit;
 
 #ifdef CONFIG_LEDS_TRIGGERS
 	struct led_trigger *charging_full_trig;
@@ -163,6 +191,9 @@ struct power_supply_info {
 };
 
 extern void power_supply_changed(struct power_supply *psy);
+extern int power_supply_get_property(struct power_supply *psy,
+				     enum power_supply_property psp,
+				     union power_supply_propval *val);
 extern int power_supply_am_i_supplied(struct power_supply *psy);
 
 #if defined(CONFIG_POWER_SUPPLY) || defined(CONFIG_POWER_SUPPLY_MODULE)
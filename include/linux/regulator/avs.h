@@ -0,0 +1,101 @@
+/*
+ * avs.h -- Adaptive voltage scaling for regulator consumers
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#ifndef __LINUX_REGULATOR_AVS_H_
+#define __LINUX_REGULATOR_AVS_H_
+
+#include <linux/err.h>
+
+struct regulator;
+struct regulator_avs;
+
+/*
+ * Verdicts returned by the AVS sense() callback.
+ *
+ * HOLD    Timing is met with an acceptable margin, leave the voltage.
+ * LOWER   There is more slack than needed, the voltage can be reduced.
+ * RAISE   Timing margin is too small, the voltage must be increased.
+ */
+#define REGULATOR_AVS_HOLD		0
+#define REGULATOR_AVS_LOWER		1
+#define REGULATOR_AVS_RAISE		2
+
+/**
+ * struct regulator_avs_config - adaptive voltage scaling loop setup
+ *
+ * @min_uV: Lowest voltage the loop may select.
+ * @max_uV: Highest voltage the loop may select.
+ * @safe_uV: Voltage known to meet timing on every part, normally the
+ *           worst case voltage for the operating point.  Used at start
+ *           up and whenever the sensor fails.
+ * @period_ms: Interval between sensor readings, or 0 if the loop only
+ *             runs when regulator_avs_trigger() is called.
+ * @lower_interval_ms: Minimum time between a voltage change and the
+ *                     next reduction.  Increases are never delayed.
+ * @sense: Read the process and temperature sensors, returning one of
+ *         the REGULATOR_AVS_ verdicts or a negative errno.  Called from
+ *         process context.
+ * @data: Passed to @sense.
+ */
+struct regulator_avs_config {
+	int min_uV;
+	int max_uV;
+	int safe_uV;
+	unsigned int period_ms;
+	unsigned int lower_interval_ms;
+	int (*sense)(void *data);
+	void *data;
+};
+
+#if defined(CONFIG_REGULATOR_AVS) || defined(CONFIG_REGULATOR_AVS_MODULE)
+
+struct regulator_avs *regulator_avs_register(struct regulator *regulator,
+				const struct regulator_avs_config *config);
+void regulator_avs_unregister(struct regulator_avs *avs);
+int regulator_avs_set_range(struct regulator_avs *avs,
+			    int min_uV, int max_uV, int safe_uV);
+void regulator_avs_trigger(struct regulator_avs *avs);
+int regulator_avs_get_voltage(struct regulator_avs *avs);
+
+#else
+
+/*
+ * Without AVS consumers should simply run at the safe voltage, which
+ * they are told by the registration failing.
+ */
+static inline struct regulator_avs *regulator_avs_register(
+	struct regulator *regulator, const struct regulator_avs_config *config)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void regulator_avs_unregister(struct regulator_avs *avs)
+{
+}
+
+static inline int regulator_avs_set_range(struct regulator_avs *avs,
+					  int min_uV, int max_uV, int safe_uV)
+{
+	return -ENODEV;
+}
+
+static inline void regulator_avs_trigger(struct regulator_avs *avs)
+{
+}
+
+static inline int regulator_avs_get_voltage(struct regulator_avs *avs)
+{
+	return -ENODEV;
+}
+
+#endif
+
+#endif
@@ -88,8 +88,18 @@
  * FAIL           Regulator output has failed.
  * OVER_TEMP      Regulator over temp.
  * FORCE_DISABLE  Regulator shut down by software.
+ * PRE_VOLTAGE_CHANGE   Regulator is about to change voltage, data is a
+ *                      struct regulator_voltage_change.  A notifier may
+ *                      return notifier_from_errno() to refuse the change.
+ * POST_VOLTAGE_CHANGE  Regulator has changed voltage and the output has
+ *                      settled, data is a struct regulator_voltage_change.
+ * ABORT_VOLTAGE_CHANGE A change announced by PRE_VOLTAGE_CHANGE failed or
+ *                      was refused, data is a struct regulator_voltage_change.
  *
- * NOTE: These events can be OR'ed together when passed into handler.
+ * NOTE: The fault events can be OR'ed together when passed into handler.
+ * The voltage change events are always passed on their own and are sent
+ * synchronously with the regulator locked, so their handlers must not
+ * call back into the regulator API for the same regulator.
  */
 
 #define REGULATOR_EVENT_UNDER_VOLTAGE		0x01
@@ -98,9 +108,86 @@
 #define REGULATOR_EVENT_FAIL			0x08
 #define REGULATOR_EVENT_OVER_TEMP		0x10
 #define REGULATOR_EVENT_FORCE_DISABLE		0x20
+#define REGULATOR_EVENT_PRE_VOLTAGE_CHANGE	0x40
+#define REGULATOR_EVENT_POST_VOLTAGE_CHANGE	0x80
+#define REGULATOR_EVENT_ABORT_VOLTAGE_CHANGE	0x100
+
+/**
+ * struct regulator_voltage_change - voltage change notifier data
+ *
+ * @old_uV: Output voltage before the change, 0 if unknown.
+ * @min_uV: Lowest voltage requested by the change.
+ * @max_uV: Highest voltage requested by the change.
+ * @new_uV: Output voltage after the change, 0 if unknown.  Only valid for
+ *          REGULATOR_EVENT_POST_VOLTAGE_CHANGE.
+ */
+struct regulator_voltage_change {
+	int old_uV;
+	int min_uV;
+	int max_uV;
+	int new_uV;
+};
 
 struct regulator;
 
+/*
+ * Settings changed by regulator_apply_config(), may be OR'ed together.
+ *
+ * VOLTAGE:  Set the voltage to min_uV..max_uV.
+ * CURRENT:  Set the current limit to min_uA..max_uA.
+ * MODE:     Set the operating mode to mode.
+ */
+#define REGULATOR_CONFIG_VOLTAGE		0x1
+#define REGULATOR_CONFIG_CURRENT		0x2
+#define REGULATOR_CONFIG_MODE			0x4
+
+/**
+ * struct regulator_config - Several regulator settings applied at once.
+ *
+ * @flags    REGULATOR_CONFIG_ flags for the settings to be changed.
+ * @min_uV   Minimum required voltage in uV.
+ * @max_uV   Maximum acceptable voltage in uV.
+ * @min_uA   Minimum supported current in uA.
+ * @max_uA   Maximum supported current in uA.
+ * @mode     Operating mode, one of the REGULATOR_MODE constants.
+ *
+ * Used with regulator_apply_config() to change several settings of a
+ * regulator in a single operation.  Only the fields selected by flags
+ * are used.
+ */
+struct regulator_config {
+	unsigned int flags;
+	int min_uV;
+	int max_uV;
+	int min_uA;
+	int max_uA;
+	unsigned int mode;
+};
+
+/**
+ * struct regulator_snapshot - Saved consumer requests.
+ *
+ * @min_uV   Requested minimum voltage in uV, 0 if none.
+ * @max_uV   Requested maximum voltage in uV, 0 if none.
+ * @min_uA   Requested minimum current limit in uA.
+ * @max_uA   Requested maximum current limit in uA, 0 if none.
+ * @uA_load  Declared load in uA.
+ * @mode     Requested operating mode, 0 if none.
+ * @enable_count  Number of unbalanced enables made by the consumer.
+ *
+ * Filled in by regulator_save_state() and reapplied by
+ * regulator_restore_state(), consumers should treat it as opaque.
+ */
+struct regulator_snapshot {
+	int min_uV;
+	int max_uV;
+	int min_uA;
+	int max_uA;
+	int uA_load;
+	unsigned int mode;
+	int enable_count;
+};
+
 /**
  * struct regulator_bulk_data - Data used for bulk regulator operations.
  *
@@ -108,6 +195,12 @@ struct regulator;
  *           using the bulk regulator APIs.
  * @consumer The regulator consumer for the supply.  This will be managed
  *           by the bulk API.
+ * @min_uV   Voltage range requested by regulator_bulk_set_voltage().
+ * @max_uV
+ * @mode     Mode requested by regulator_bulk_set_mode().
+ * @uA_load  Load passed to regulator_bulk_set_optimum_mode().
+ * @ret      Internal use by the bulk API, result of the last operation
+ *           on this supply.
  *
  * The regulator APIs provide a series of regulator_bulk_() API calls as
  * a convenience to consumers which require multiple supplies.  This
@@ -116,6 +209,15 @@ struct regulator;
 struct regulator_bulk_data {
 	const char *supply;
 	struct regulator *consumer;
+
+	/* requests for the bulk set operations */
+	int min_uV;
+	int max_uV;
+	unsigned int mode;
+	int uA_load;
+
+	/* Internal use */
+	int ret;
 };
 
 #if defined(CONFIG_REGULATOR)
@@ -128,6 +230,15 @@ void regulator_put(struct regulator *regulator);
 /* regulator output control and status */
 int regulator_enable(struct regulator *regulator);
 int regulator_disable(struct regulator *regulator);
+int regulator_disable_deferred(struct regulator *regulator, int ms);
+void regulator_disable_flush(struct regulator *regulator);
+int regulator_enable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data);
+int regulator_disable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data);
+int regulator_cancel_async(struct regulator *regulator);
 int regulator_force_disable(struct regulator *regulator);
 int regulator_is_enabled(struct regulator *regulator);
 
@@ -137,11 +248,31 @@ int regulator_bulk_enable(int num_consumers,
 			  struct regulator_bulk_data *consumers);
 int regulator_bulk_disable(int num_consumers,
 			   struct regulator_bulk_data *consumers);
+int regulator_bulk_set_voltage(int num_consumers,
+			       struct regulator_bulk_data *consumers);
+int regulator_bulk_set_mode(int num_consumers,
+			    struct regulator_bulk_data *consumers);
+int regulator_bulk_set_optimum_mode(int num_consumers,
+				    struct regulator_bulk_data *consumers);
 void regulator_bulk_free(int num_consumers,
 			 struct regulator_bulk_data *consumers);
+int regulator_bulk_bind_runtime(struct device *dev, int num_consumers,
+				struct regulator_bulk_data *consumers,
+				int off_delay_ms);
+void regulator_bulk_unbind_runtime(struct device *dev,
+				   struct regulator_bulk_data *consumers);
 
 int regulator_set_voltage(struct regulator *regulator, int min_uV, int max_uV);
+int regulator_preload_voltage(struct regulator *regulator,
+			      int min_uV, int max_uV);
 int regulator_get_voltage(struct regulator *regulator);
+int regulator_count_voltages(struct regulator *regulator);
+int regulator_list_voltage(struct regulator *regulator, unsigned selector);
+int regulator_is_supported_voltage(struct regulator *regulator,
+				   int min_uV, int max_uV);
+int regulator_enable_time(struct regulator *regulator);
+int regulator_set_voltage_time(struct regulator *regulator,
+			       int old_uV, int new_uV);
 int regulator_set_current_limit(struct regulator *regulator,
 			       int min_uA, int max_uA);
 int regulator_get_current_limit(struct regulator *regulator);
@@ -149,6 +280,16 @@ int regulator_get_current_limit(struct regulator *regulator);
 int regulator_set_mode(struct regulator *regulator, unsigned int mode);
 unsigned int regulator_get_mode(struct regulator *regulator);
 int regulator_set_optimum_mode(struct regulator *regulator, int load_uA);
+int regulator_get_headroom(struct regulator *regulator);
+unsigned long long regulator_get_energy(struct regulator *regulator);
+
+int regulator_apply_config(struct regulator *regulator,
+			   const struct regulator_config *config);
+
+void regulator_save_state(struct regulator *regulator,
+			  struct regulator_snapshot *snap);
+int regulator_restore_state(struct regulator *regulator,
+			    const struct regulator_snapshot *snap);
 
 /* regulator notifier block */
 int regulator_register_notifier(struct regulator *regulator,
@@ -189,6 +330,40 @@ static inline int regulator_disable(struct regulator *regulator)
 	return 0;
 }
 
+static inline int regulator_disable_deferred(struct regulator *regulator,
+					     int ms)
+{
+	return 0;
+}
+
+static inline void regulator_disable_flush(struct regulator *regulator)
+{
+}
+
+/* there is nothing to wait for, so done is called inline */
+static inline int regulator_enable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data)
+{
+	if (done)
+		done(regulator, 0, data);
+	return 0;
+}
+
+static inline int regulator_disable_async(struct regulator *regulator,
+	void (*done)(struct regulator *regulator, int ret, void *data),
+	void *data)
+{
+	if (done)
+		done(regulator, 0, data);
+	return 0;
+}
+
+static inline int regulator_cancel_async(struct regulator *regulator)
+{
+	return 0;
+}
+
 static inline int regulator_is_enabled(struct regulator *regulator)
 {
 	return 1;
@@ -213,11 +388,42 @@ static inline int regulator_bulk_disable(int num_consumers,
 	return 0;
 }
 
+static inline int regulator_bulk_set_voltage(int num_consumers,
+					struct regulator_bulk_data *consumers)
+{
+	return 0;
+}
+
+static inline int regulator_bulk_set_mode(int num_consumers,
+					  struct regulator_bulk_data *consumers)
+{
+	return 0;
+}
+
+static inline int regulator_bulk_set_optimum_mode(int num_consumers,
+					struct regulator_bulk_data *consumers)
+{
+	return 0;
+}
+
 static inline void regulator_bulk_free(int num_consumers,
 				       struct regulator_bulk_data *consumers)
 {
 }
 
+static inline int regulator_bulk_bind_runtime(struct device *dev,
+					int num_consumers,
+					struct regulator_bulk_data *consumers,
+					int off_delay_ms)
+{
+	return 0;
+}
+
+static inline void regulator_bulk_unbind_runtime(struct device *dev,
+					struct regulator_bulk_data *consumers)
+{
+}
+
 static inline int regulator_set_voltage(struct regulator *regulator,
 					int min_uV, int max_uV)
 {
@@ -229,6 +435,40 @@ static inline int regulator_get_voltage(struct regulator *regulator)
 	return 0;
 }
 
+static inline int regulator_count_voltages(struct regulator *regulator)
+{
+	return 0;
+}
+
+static inline int regulator_list_voltage(struct regulator *regulator,
+					 unsigned selector)
+{
+	return 0;
+}
+
+static inline int regulator_is_supported_voltage(struct regulator *regulator,
+						 int min_uV, int max_uV)
+{
+	return 0;
+}
+
+static inline int regulator_enable_time(struct regulator *regulator)
+{
+	return 0;
+}
+
+static inline int regulator_set_voltage_time(struct regulator *regulator,
+					     int old_uV, int new_uV)
+{
+	return 0;
+}
+
+static inline int regulator_preload_voltage(struct regulator *regulator,
+					    int min_uV, int max_uV)
+{
+	return 0;
+}
+
 static inline int regulator_set_current_limit(struct regulator *regulator,
 					     int min_uA, int max_uA)
 {
@@ -257,6 +497,34 @@ static inline int regulator_set_optimum_mode(struct regulator *regulator,
 	return REGULATOR_MODE_NORMAL;
 }
 
+static inline int regulator_get_headroom(struct regulator *regulator)
+{
+	return ~0U >> 1;	/* INT_MAX, there is no budget */
+}
+
+static inline unsigned long long
+regulator_get_energy(struct regulator *regulator)
+{
+	return 0;
+}
+
+static inline int regulator_apply_config(struct regulator *regulator,
+					 const struct regulator_config *config)
+{
+	return 0;
+}
+
+static inline void regulator_save_state(struct regulator *regulator,
+					struct regulator_snapshot *snap)
+{
+}
+
+static inline int regulator_restore_state(struct regulator *regulator,
+					  const struct regulator_snapshot *snap)
+{
+	return 0;
+}
+
 static inline int regulator_register_notifier(struct regulator *regulator,
 			      struct notifier_block *nb)
 {
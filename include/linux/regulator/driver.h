@@ -20,6 +20,8 @@
 
 struct regulator_dev;
 struct regulator_init_data;
+struct regulator_mode_table;
+struct regulator_state;
 
 /**
  * struct regulator_ops - regulator operations.
@@ -32,6 +34,19 @@ struct regulator_ops {
 	int (*set_voltage) (struct regulator_dev *, int min_uV, int max_uV);
 	int (*get_voltage) (struct regulator_dev *);
 
+	/* selector based voltage control, the core picks the selector from
+	 * the table described by list_voltage() when set_voltage is not
+	 * provided */
+	int (*list_voltage) (struct regulator_dev *, unsigned selector);
+	int (*set_voltage_sel) (struct regulator_dev *, unsigned selector);
+	int (*get_voltage_sel) (struct regulator_dev *);
+
+	/* optionally load a selector ahead of time without changing the
+	 * output, then switch to it with minimal latency.  The preloaded
+	 * selector must survive set_voltage_sel() and is used at most once */
+	int (*preload_voltage_sel) (struct regulator_dev *, unsigned selector);
+	int (*switch_voltage_sel) (struct regulator_dev *);
+
 	/* get/set regulator current  */
 	int (*set_current_limit) (struct regulator_dev *,
 				 int min_uA, int max_uA);
@@ -50,6 +65,12 @@ struct regulator_ops {
 	unsigned int (*get_optimum_mode) (struct regulator_dev *, int input_uV,
 					  int output_uV, int load_uA);
 
+	/* optionally apply several settings at once, each setting has
+	 * already been checked against the constraints and the voltage
+	 * range is that required by all consumers */
+	int (*set_config) (struct regulator_dev *,
+			   const struct regulator_config *config);
+
 	/* the operations below are for configuration of regulator state when
 	 * its parent PMIC enters a global STANDBY/HIBERNATE state */
 
@@ -62,6 +83,16 @@ struct regulator_ops {
 
 	/* set regulator suspend operating mode (defined in regulator.h) */
 	int (*set_suspend_mode) (struct regulator_dev *, unsigned int mode);
+
+	/* optionally set the whole suspend state of several regulators at
+	 * once instead of using the operations above, called with every
+	 * regulator sharing this operation and driver data */
+	int (*set_suspend_states) (struct regulator_dev **,
+				   struct regulator_state **, int n);
+
+	/* program a hardware power sequencer to power up in this step of
+	 * the machine power up sequence and down in the reverse order */
+	int (*set_sequence_step) (struct regulator_dev *, int step);
 };
 
 /*
@@ -72,9 +103,48 @@ enum regulator_type {
 	REGULATOR_CURRENT,
 };
 
+/**
+ * struct regulator_linear_range - linearly spaced block of voltage selectors
+ *
+ * @min_sel: First selector in the range.
+ * @max_sel: Last selector in the range.
+ * @min_uV:  Voltage in microvolts produced by @min_sel.
+ * @uV_step: Voltage increase in microvolts for each selector in the range.
+ */
+struct regulator_linear_range {
+	unsigned int min_sel;
+	unsigned int max_sel;
+	int min_uV;
+	unsigned int uV_step;
+};
+
 /**
  * struct regulator_desc - Regulator descriptor
  *
+ * @n_voltages:  Number of selectors understood by list_voltage().
+ * @min_uV:      Voltage of selector 0 for regulator_list_voltage_linear().
+ * @uV_step:     Voltage step between selectors for
+ *               regulator_list_voltage_linear().
+ * @linear_ranges: Selector ranges for regulator_list_voltage_linear_range().
+ * @n_linear_ranges: Number of entries in @linear_ranges.
+ * @enable_time: Time in microseconds taken for the output to become stable
+ *               after being enabled.
+ * @ramp_delay:  Rate in microvolts per microsecond at which the output
+ *               slews during a voltage change, 0 if not known.
+ * @mode_table:  Most efficient operating mode for each load, used when the
+ *               driver has no get_optimum_mode() operation.
+ * @n_mode_table: Number of entries in @mode_table.
+ * @efficiency:  Typical power conversion efficiency in percent, used to
+ *               convert the load on the output into the load placed on the
+ *               supply.  0 means the input current equals the output current,
+ *               as for a linear regulator.
+ * @min_dropout_uV: Lowest difference between the input and output voltages
+ *               at which the output stays in regulation.  If set the core
+ *               keeps the voltage of the supply no lower than the output
+ *               plus this, lowering it as far as that allows.
+ * @enable_volatile: The hardware can change the enable state without the
+ *               regulator core being involved, so is_enabled() must always
+ *               be called rather than using the state cached by the core.
  */
 struct regulator_desc {
 	const char *name;
@@ -83,6 +153,31 @@ struct regulator_desc {
 	int irq;
 	enum regulator_type type;
 	struct module *owner;
+
+	/* voltage table data used by the list_voltage() helpers */
+	unsigned int n_voltages;
+	int min_uV;
+	unsigned int uV_step;
+	const struct regulator_linear_range *linear_ranges;
+	int n_linear_ranges;
+
+	/* settling time data, may be overridden by machine constraints */
+	unsigned int enable_time;
+	unsigned int ramp_delay;
+
+	/* supply load estimation, may be overridden by machine constraints */
+	unsigned int efficiency;
+	const struct regulator_mode_table *mode_table;
+	int n_mode_table;
+
+	/* supply voltage tracking, may be overridden by machine constraints */
+	int min_dropout_uV;
+
+	/* output of a fixed, always on regulator which has no operations
+	 * of its own; the core answers everything for it */
+	int fixed_uV;
+
+	unsigned int enable_volatile:1;
 };
 
 struct regulator_dev *regulator_register(struct regulator_desc *regulator_desc,
@@ -91,6 +186,20 @@ void regulator_unregister(struct regulator_dev *rdev);
 
 int regulator_notifier_call_chain(struct regulator_dev *rdev,
 				  unsigned long event, void *data);
+int regulator_sync_state(struct regulator_dev *rdev);
+
+int regulator_request_fault_irq(struct regulator_dev *rdev, int irq,
+				unsigned long irqflags, unsigned long event);
+void regulator_free_fault_irq(struct regulator_dev *rdev, int irq);
+
+int regulator_list_voltage_linear(struct regulator_dev *rdev,
+				  unsigned int selector);
+int regulator_list_voltage_linear_range(struct regulator_dev *rdev,
+					unsigned int selector);
+
+unsigned int
+regulator_mode_table_lookup(const struct regulator_mode_table *table,
+			    int n_entries, int input_uV, int load_uA);
 
 void *rdev_get_drvdata(struct regulator_dev *rdev);
 struct device *rdev_get_dev(struct regulator_dev *rdev);
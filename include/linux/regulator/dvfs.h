@@ -0,0 +1,110 @@
+/*
+ * dvfs.h -- Load driven voltage and frequency scaling for devices
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#ifndef __LINUX_REGULATOR_DVFS_H_
+#define __LINUX_REGULATOR_DVFS_H_
+
+#include <linux/err.h>
+
+struct device;
+struct regulator_dvfs;
+
+/* most supplies one device can scale with its clock */
+#define REGULATOR_DVFS_MAX_SUPPLIES	4
+
+/**
+ * struct regulator_dvfs_opp - device operating point
+ *
+ * @rate: Clock rate in Hz.
+ * @min_uV: Lowest voltage of each supply at which @rate works, in the
+ *          order the supplies are given in the configuration.
+ * @max_uV: Highest voltage of each supply for @rate.
+ */
+struct regulator_dvfs_opp {
+	unsigned long rate;
+	int min_uV[REGULATOR_DVFS_MAX_SUPPLIES];
+	int max_uV[REGULATOR_DVFS_MAX_SUPPLIES];
+};
+
+/**
+ * struct regulator_dvfs_config - device voltage and frequency scaling setup
+ *
+ * @opp: Operating points of the device, in ascending order of rate.
+ * @num_opp: Number of entries in @opp.
+ * @clk_id: Clock of the device to scale, as passed to clk_get().
+ * @supplies: Supplies of the device to scale with the clock.
+ * @num_supplies: Number of entries in @supplies.
+ * @period_ms: Interval between load samples.
+ * @up_threshold: Load, in percent, above which the device is moved
+ *                straight to its fastest operating point.
+ * @down_differential: How far below @up_threshold the load must fall
+ *                     before the rate is reduced, so that the load
+ *                     at the new rate stays under @up_threshold.
+ * @get_load: Return the percentage of time the device was busy since
+ *            the last call, or a negative errno.  Called from process
+ *            context.
+ * @data: Passed to @get_load.
+ *
+ * The policy is that of the cpufreq ondemand governor.
+ */
+struct regulator_dvfs_config {
+	const struct regulator_dvfs_opp *opp;
+	int num_opp;
+	const char *clk_id;
+	const char *supplies[REGULATOR_DVFS_MAX_SUPPLIES];
+	int num_supplies;
+	unsigned int period_ms;
+	unsigned int up_threshold;
+	unsigned int down_differential;
+	int (*get_load)(void *data);
+	void *data;
+};
+
+#if defined(CONFIG_REGULATOR_DVFS) || defined(CONFIG_REGULATOR_DVFS_MODULE)
+
+struct regulator_dvfs *regulator_dvfs_register(struct device *dev,
+				const struct regulator_dvfs_config *config);
+void regulator_dvfs_unregister(struct regulator_dvfs *dvfs);
+int regulator_dvfs_set_limits(struct regulator_dvfs *dvfs,
+			      unsigned long min_rate, unsigned long max_rate);
+unsigned long regulator_dvfs_get_rate(struct regulator_dvfs *dvfs);
+
+#else
+
+/*
+ * Without DVFS devices should run at their fixed worst case operating
+ * point, which they are told by the registration failing.
+ */
+static inline struct regulator_dvfs *regulator_dvfs_register(
+	struct device *dev, const struct regulator_dvfs_config *config)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void regulator_dvfs_unregister(struct regulator_dvfs *dvfs)
+{
+}
+
+static inline int regulator_dvfs_set_limits(struct regulator_dvfs *dvfs,
+					    unsigned long min_rate,
+					    unsigned long max_rate)
+{
+	return -ENODEV;
+}
+
+static inline unsigned long regulator_dvfs_get_rate(struct regulator_dvfs *dvfs)
+{
+	return 0;
+}
+
+#endif
+
+#endif
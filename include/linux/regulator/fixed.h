@@ -14,9 +14,21 @@
 #ifndef __REGULATOR_FIXED_H
 #define __REGULATOR_FIXED_H
 
+/*
+ * Machine data for a "reg-fixed-voltage" device, passed as the
+ * driver_data of the regulator_init_data used as its platform_data.
+ *
+ * Rails behind a load switch can give the GPIO controlling it, or
+ * -EINVAL if the rail is always on.  startup_delay is the time in
+ * microseconds for the output to stabilise after the switch is closed.
+ */
 struct fixed_voltage_config {
 	const char *supply_name;
 	int microvolts;
+	int gpio;
+	unsigned startup_delay;
+	unsigned enable_high:1;		/* GPIO is active high */
+	unsigned enabled_at_boot:1;	/* leave the rail on at probe */
 };
 
 #endif
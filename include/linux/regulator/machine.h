@@ -44,11 +44,28 @@ struct regulator;
  * struct regulator_state - regulator state during low power syatem states
  *
  * This describes a regulators state during a system wide low power state.
+ * A regulator with none of these set for a state is left alone when the
+ * system enters it.
  */
 struct regulator_state {
 	int uV;	/* suspend voltage */
 	unsigned int mode; /* suspend regulator operating mode */
 	int enabled; /* is regulator enabled in this suspend state */
+	int disabled; /* is regulator disabled in this suspend state */
+};
+
+/**
+ * struct regulator_mode_table - operating mode for a range of loads
+ *
+ * Tables of these describe the most efficient operating mode of a
+ * regulator.  The first entry whose max_uA is at least the load and whose
+ * min_input_uV is no higher than the input voltage is used, loads beyond
+ * every entry use the mode of the last entry.
+ */
+struct regulator_mode_table {
+	int max_uA;		/* highest load for this mode */
+	int min_input_uV;	/* lowest input voltage, 0 for any */
+	unsigned int mode;
 };
 
 /**
@@ -77,6 +94,37 @@ struct regulation_constraints {
 	/* regulator input voltage - only if supply is another regulator */
 	int input_uV;
 
+	/* board specific settling times, override the regulator_desc */
+	unsigned int enable_time;	/* uS to stabilise after enable */
+	unsigned int ramp_delay;	/* uV/uS slew rate on voltage change */
+	unsigned int efficiency;	/* percent, overrides regulator_desc */
+	int min_dropout_uV;		/* overrides regulator_desc */
+
+	/* most load consumers and supplied regulators may request, 0 for
+	 * no limit, this also covers everything further down the tree */
+	int budget_uA;
+
+	/* DRMS damping, applied when moving to a less capable mode */
+	int drms_hysteresis_uA;		/* load must fall this far below */
+	unsigned int drms_dwell_ms;	/* minimum time between changes */
+
+	/* transient response of the less capable modes in uS, DRMS only
+	 * picks them while the pm_qos CPU/DMA latency allows, 0 if fine */
+	unsigned int idle_latency_us;
+	unsigned int standby_latency_us;
+
+	/* board specific DRMS mode table, overrides the regulator driver */
+	const struct regulator_mode_table *mode_table;
+	int n_mode_table;
+
+	/* coupled regulator, both must name each other with the same spread */
+	struct device *coupled_regulator_dev;	/* or NULL if not coupled */
+	int max_spread_uV;	/* largest difference between the outputs */
+
+	/* fault handling, only used with fault_shutdown set */
+	unsigned int fault_retry_ms;	/* first re-enable delay, 0 for none */
+	int fault_retries;		/* re-enables before giving up */
+
 	/* regulator suspend states for global PMIC STANDBY/HIBERNATE */
 	struct regulator_state state_disk;
 	struct regulator_state state_mem;
@@ -87,6 +135,7 @@ struct regulation_constraints {
 	unsigned always_on:1;	/* regulator never off when system is on */
 	unsigned boot_on:1;	/* bootloader/firmware enabled regulator */
 	unsigned apply_uV:1;	/* apply uV constraint iff min == max */
+	unsigned fault_shutdown:1; /* turn off on fault, see fault_retry_ms */
 };
 
 /**
@@ -99,6 +148,30 @@ struct regulator_consumer_supply {
 	const char *supply;	/* consumer supply - e.g. "vcc" */
 };
 
+/**
+ * struct regulator_sequence - position in the machine power sequence
+ *
+ * Regulators with the same step are powered up together by
+ * regulator_sequence_power_up(), after all lower steps, and down in the
+ * reverse order by regulator_sequence_power_down().
+ */
+struct regulator_sequence {
+	int step;		/* from 1 upwards, 0 if not sequenced */
+	unsigned int delay_ms;	/* minimum time before the next step */
+};
+
+/*
+ * Constraint profiles.  A board may give a regulator alternative
+ * constraints for any profile, used in place of its normal constraints
+ * while that profile is selected, e.g. less capable operating modes and
+ * more DRMS damping for non-critical rails when running from battery.
+ * The power supply class selects REGULATOR_PROFILE_BATTERY whenever no
+ * external supply is online.
+ */
+#define REGULATOR_PROFILE_DEFAULT	0
+#define REGULATOR_PROFILE_BATTERY	1
+#define REGULATOR_NUM_PROFILES		2
+
 /**
  * struct regulator_init_data - regulator platform initialisation data.
  *
@@ -109,6 +182,13 @@ struct regulator_init_data {
 
 	struct regulation_constraints constraints;
 
+	/* optional constraints for each profile, NULL to keep constraints;
+	 * the REGULATOR_PROFILE_DEFAULT entry is ignored */
+	struct regulation_constraints *profiles[REGULATOR_NUM_PROFILES];
+
+	/* optional power sequencing */
+	struct regulator_sequence sequence;
+
 	int num_consumer_supplies;
 	struct regulator_consumer_supply *consumer_supplies;
 
@@ -117,6 +197,25 @@ struct regulator_init_data {
 	void *driver_data;	/* core does not touch this */
 };
 
+int regulator_sequence_power_up(void);
+int regulator_sequence_power_down(void);
+
+#ifdef CONFIG_REGULATOR
 int regulator_suspend_prepare(suspend_state_t state);
+int regulator_set_profile(int profile);
+void regulator_defer_constraints(void);
+#else
+static inline int regulator_suspend_prepare(suspend_state_t state)
+{
+	return 0;
+}
+static inline int regulator_set_profile(int profile)
+{
+	return 0;
+}
+static inline void regulator_defer_constraints(void)
+{
+}
+#endif
 
 #endif
@@ -0,0 +1,61 @@
+/*
+ * mock.h
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#ifndef __REGULATOR_MOCK_H
+#define __REGULATOR_MOCK_H
+
+/* the operations of a "reg-mock" regulator, for latency and faults */
+enum mock_regulator_op {
+	MOCK_REGULATOR_ENABLE = 0,
+	MOCK_REGULATOR_DISABLE,
+	MOCK_REGULATOR_IS_ENABLED,
+	MOCK_REGULATOR_SET_VOLTAGE,
+	MOCK_REGULATOR_GET_VOLTAGE,
+	MOCK_REGULATOR_SET_MODE,
+	MOCK_REGULATOR_GET_MODE,
+	MOCK_REGULATOR_OP_NUM,
+};
+
+/*
+ * Machine data for a "reg-mock" device, passed as the driver_data of
+ * the regulator_init_data used as its platform_data.
+ *
+ * The voltages are given either as a table or as n_voltages linear
+ * steps of uV_step from min_uV; with neither the voltage is fixed at
+ * min_uV.  modes is a mask of the REGULATOR_MODE_ values the output
+ * supports, loads of up to idle_max_uA are best served by the idle
+ * mode.  Each operation takes latency_us[op] to complete, as if it
+ * went over a slow bus.
+ *
+ * One in fail_every of the operations in the fail_ops mask, a mask
+ * of (1 << enum mock_regulator_op), returns -EIO.  All of these can
+ * be changed at runtime through sysfs.
+ */
+struct mock_regulator_config {
+	const char *supply_name;
+
+	int min_uV;
+	unsigned int uV_step;
+	unsigned int n_voltages;
+	const int *voltage_table;
+
+	unsigned int modes;
+	int idle_max_uA;
+
+	unsigned int latency_us[MOCK_REGULATOR_OP_NUM];
+
+	unsigned int fail_ops;
+	unsigned int fail_every;
+
+	unsigned enabled_at_boot:1;
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Regulator backlight driver data - see drivers/video/backlight/regulator_bl.c
+ */
+#ifndef __LINUX_REGULATOR_BACKLIGHT_H
+#define __LINUX_REGULATOR_BACKLIGHT_H
+
+/**
+ * struct platform_regulator_backlight_data - regulator backlight setup
+ *
+ * @supply:         Name of the current sink supply driving the LEDs.
+ * @levels_uA:      LED current for each brightness level, ascending.  Level
+ *                  0 is off and its entry is ignored.  If NULL the current
+ *                  is scaled linearly from 0 to @max_uA.
+ * @max_brightness: Highest brightness level, one less than the number of
+ *                  entries in @levels_uA.
+ * @dft_brightness: Brightness at probe.
+ * @max_uA:         Current at @max_brightness when @levels_uA is NULL.
+ * @init:           Called at probe, for example to set the current sink's
+ *                  hardware ramp times with wm8350_isink_set_ramp().
+ * @exit:           Called at remove.
+ */
+struct platform_regulator_backlight_data {
+	const char *supply;
+	const unsigned int *levels_uA;
+	unsigned int max_brightness;
+	unsigned int dft_brightness;
+	unsigned int max_uA;
+	int (*init)(struct device *dev);
+	void (*exit)(struct device *dev);
+};
+
+#endif
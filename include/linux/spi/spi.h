@@ -633,6 +633,9 @@ extern int spi_write_then_read(struct spi_device *spi,
 		const u8 *txbuf, unsigned n_tx,
 		u8 *rxbuf, unsigned n_rx);
 
+extern int spi_write_regs(struct spi_device *spi, const void *txbuf,
+		unsigned len, unsigned count);
+
 /**
  * spi_w8r8 - SPI synchronous 8 bit write followed by 8 bit read
  * @spi: device with which data will be exchanged
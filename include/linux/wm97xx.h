@@ -15,6 +15,8 @@
 #include <linux/input.h>	/* Input device layer */
 #include <linux/platform_device.h>
 
+struct regulator;
+
 /*
  * WM97xx AC97 Touchscreen registers
  */
@@ -283,6 +285,8 @@ struct wm97xx {
 	unsigned pen_is_down:1;		/* Pen is down */
 	unsigned aux_waiting:1;		/* aux measurement waiting */
 	unsigned pen_probably_down:1;	/* used in polling mode */
+	unsigned vtouch_on:1;		/* vtouch enabled by us */
+	struct regulator *vtouch;	/* optional touch panel supply */
 	u16 suspend_mode;               /* PRP in suspend mode */
 };
 
@@ -307,6 +311,8 @@ void wm97xx_reg_write(struct wm97xx *wm, u16 reg, u16 val);
 
 /* aux adc readback */
 int wm97xx_read_aux_adc(struct wm97xx *wm, u16 adcsel);
+void wm97xx_read_aux_adcs(struct wm97xx *wm, const u16 *adcsel, int *vals,
+			  int num);
 
 /* machine ops */
 int wm97xx_register_mach_ops(struct wm97xx *, struct wm97xx_mach_ops *);
@@ -62,6 +62,8 @@ struct snd_kcontrol_volatile {
 
 struct snd_kcontrol {
 	struct list_head list;		/* list of controls */
+	struct hlist_node hash_node;	/* card->ctl_hash bucket */
+	u32 hash;			/* of the id less index and numid */
 	struct snd_ctl_elem_id id;
 	unsigned int count;		/* count of same elements */
 	snd_kcontrol_info_t *info;
@@ -102,6 +102,9 @@ struct snd_monitor_file {
 	struct list_head shutdown_list;
 };
 
+/* buckets for looking controls up by id */
+#define SNDRV_CTL_HASH_SIZE	64
+
 /* main structure for soundcard */
 
 struct snd_card {
@@ -128,6 +131,7 @@ struct snd_card {
 	int controls_count;		/* count of all controls */
 	int user_ctl_count;		/* count of all user controls */
 	struct list_head controls;	/* all controls for this card */
+	struct hlist_head ctl_hash[SNDRV_CTL_HASH_SIZE]; /* controls by id */
 	struct list_head ctl_files;	/* active control files */
 
 	struct snd_info_entry *proc_root;	/* root for soundcard specific files */
@@ -208,12 +208,14 @@ struct snd_soc_dai {
 	/* DAI capabilities */
 	struct snd_soc_pcm_stream capture;
 	struct snd_soc_pcm_stream playback;
+	unsigned int pmdown_time;	/* ms, 0 uses the codec's */
 
 	/* DAI runtime info */
 	struct snd_pcm_runtime *runtime;
 	struct snd_soc_codec *codec;
 	unsigned int active;
 	unsigned char pop_wait:1;
+	unsigned long pop_expires;	/* jiffies, when pop_wait */
 	void *dma_data;
 
 	/* DAI private data */
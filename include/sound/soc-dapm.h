@@ -137,6 +137,14 @@
 	.on_val = won_val, .off_val = woff_val, .event = dapm_reg_event, \
 	.event_flags = SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMD}
 
+/* supply widget wrapping a regulator, powered while anything it supplies
+ * is; the disable is deferred by wdelay ms to ride out bursty use */
+#define SND_SOC_DAPM_REGULATOR_SUPPLY(wname, wdelay) \
+{	.id = snd_soc_dapm_regulator_supply, .name = wname, .reg = -1, \
+	.kcontrols = NULL, .num_kcontrols = 0, .delay = wdelay, \
+	.event = dapm_regulator_event, \
+	.event_flags = SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMD}
+
 /* dapm kcontrol types */
 #define SOC_DAPM_SINGLE(xname, reg, shift, max, invert) \
 {	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = xname, \
@@ -201,9 +209,12 @@ enum snd_soc_dapm_type;
 struct snd_soc_dapm_path;
 struct snd_soc_dapm_pin;
 struct snd_soc_dapm_route;
+struct regulator;
 
 int dapm_reg_event(struct snd_soc_dapm_widget *w,
 		   struct snd_kcontrol *kcontrol, int event);
+int dapm_regulator_event(struct snd_soc_dapm_widget *w,
+			 struct snd_kcontrol *kcontrol, int event);
 
 /* dapm controls */
 int snd_soc_dapm_put_volsw(struct snd_kcontrol *kcontrol,
@@ -231,9 +242,13 @@ int snd_soc_dapm_stream_event(struct snd_soc_codec *codec, char *stream,
 	int event);
 int snd_soc_dapm_set_bias_level(struct snd_soc_device *socdev,
 	enum snd_soc_bias_level level);
+void snd_soc_dapm_begin(struct snd_soc_codec *codec);
+int snd_soc_dapm_end(struct snd_soc_codec *codec);
 
 /* dapm sys fs - used by the core */
 int snd_soc_dapm_sys_add(struct device *dev);
+int snd_soc_dapm_stats_show(struct snd_soc_codec *codec, char *buf,
+			    size_t size);
 
 /* dapm audio pin control and status */
 int snd_soc_dapm_enable_pin(struct snd_soc_codec *codec, char *pin);
@@ -260,6 +275,7 @@ enum snd_soc_dapm_type {
 	snd_soc_dapm_vmid,			/* codec bias/vmid - to minimise pops */
 	snd_soc_dapm_pre,			/* machine specific pre widget - exec first */
 	snd_soc_dapm_post,			/* machine specific post widget - exec last */
+	snd_soc_dapm_regulator_supply,	/* external regulator */
 };
 
 /*
@@ -309,6 +325,8 @@ struct snd_soc_dapm_widget {
 	unsigned int mask;			/* non-shifted mask */
 	unsigned int on_val;			/* on state value */
 	unsigned int off_val;			/* off state value */
+	struct regulator *regulator;		/* regulator supply */
+	int delay;				/* supply disable delay in ms */
 	unsigned char power:1;			/* block power status */
 	unsigned char invert:1;			/* invert the power bit */
 	unsigned char active:1;			/* active stream on DAC, ADC's */
@@ -318,6 +336,11 @@ struct snd_soc_dapm_widget {
 	unsigned char muted:1;			/* muted for pop reduction */
 	unsigned char suspend:1;		/* was active before suspend */
 	unsigned char pmdown:1;			/* waiting for timeout */
+	unsigned char dirty:1;			/* power needs re-evaluating */
+
+	/* cached endpoint counts, negative when they need recalculating */
+	int inputs;
+	int outputs;
 
 	/* external events */
 	unsigned short event_flags;		/* flags to specify event types */
@@ -330,6 +353,16 @@ struct snd_soc_dapm_widget {
 	/* widget input and outputs */
 	struct list_head sources;
 	struct list_head sinks;
+
+	/* codec name lookup */
+	struct hlist_node hash;
+
+	/* used during power updates */
+	struct list_head power_list;
+
+	/* power transitions, reported in debugfs */
+	unsigned int power_on_count;
+	unsigned int power_off_count;
 };
 
 #endif
@@ -148,6 +148,7 @@ struct snd_soc_pcm_stream;
 struct snd_soc_ops;
 struct snd_soc_dai_mode;
 struct snd_soc_pcm_runtime;
+struct snd_soc_cache;
 struct snd_soc_dai;
 struct snd_soc_platform;
 struct snd_soc_codec;
@@ -173,16 +174,54 @@ int snd_soc_init_card(struct snd_soc_device *socdev);
 int snd_soc_set_runtime_hwparams(struct snd_pcm_substream *substream,
 	const struct snd_pcm_hardware *hw);
 
+/* write combined DMA buffers, preallocated per substream (ARM only) */
+int snd_soc_dma_prealloc(struct snd_pcm *pcm, struct snd_soc_dai *dai,
+			 size_t size);
+void snd_soc_dma_free(struct snd_pcm *pcm);
+int snd_soc_dma_mmap(struct snd_pcm_substream *substream,
+		     struct vm_area_struct *vma);
+
 /* codec IO */
 #define snd_soc_read(codec, reg) codec->read(codec, reg)
 #define snd_soc_write(codec, reg, value) codec->write(codec, reg, value)
 
 /* codec register bit access */
+struct snd_soc_reg_update {
+	unsigned short reg;
+	unsigned short mask;
+	unsigned short value;
+};
+
 int snd_soc_update_bits(struct snd_soc_codec *codec, unsigned short reg,
 				unsigned short mask, unsigned short value);
+int snd_soc_update_bits_multi(struct snd_soc_codec *codec,
+			      const struct snd_soc_reg_update *upd, int num);
 int snd_soc_test_bits(struct snd_soc_codec *codec, unsigned short reg,
 				unsigned short mask, unsigned short value);
 
+/* codec register cache */
+enum snd_soc_cache_type {
+	SND_SOC_CACHE_FLAT,	/* array indexed by register */
+	SND_SOC_CACHE_SPARSE,	/* sorted list of registers */
+};
+
+struct snd_soc_reg_default {
+	unsigned short reg;
+	unsigned short def;	/* value after reset */
+};
+
+int snd_soc_cache_init_flat(struct snd_soc_codec *codec,
+			    const u16 *defaults, int num_regs);
+int snd_soc_cache_init_sparse(struct snd_soc_codec *codec,
+			      const struct snd_soc_reg_default *defaults,
+			      int num);
+void snd_soc_cache_exit(struct snd_soc_codec *codec);
+int snd_soc_cache_read(struct snd_soc_codec *codec, unsigned int reg,
+		       unsigned int *value);
+int snd_soc_cache_write(struct snd_soc_codec *codec, unsigned int reg,
+			unsigned int value);
+int snd_soc_cache_sync(struct snd_soc_codec *codec);
+
 int snd_soc_new_ac97_codec(struct snd_soc_codec *codec,
 	struct snd_ac97_bus_ops *ops, int num);
 void snd_soc_free_ac97_codec(struct snd_soc_codec *codec);
@@ -192,6 +231,8 @@ void snd_soc_free_ac97_codec(struct snd_soc_codec *codec);
  */
 struct snd_kcontrol *snd_soc_cnew(const struct snd_kcontrol_new *_template,
 	void *data, char *long_name);
+int snd_soc_add_controls(struct snd_soc_codec *codec,
+	const struct snd_kcontrol_new *controls, int num_controls);
 int snd_soc_info_enum_double(struct snd_kcontrol *kcontrol,
 	struct snd_ctl_elem_info *uinfo);
 int snd_soc_info_enum_ext(struct snd_kcontrol *kcontrol,
@@ -244,6 +285,24 @@ struct snd_soc_ops {
 	int (*trigger)(struct snd_pcm_substream *, int);
 };
 
+/*
+ * DAPM power update timings for one type of stream event. Time not
+ * spent on register I/O, pop waits or widget events is the graph walk.
+ */
+#define SND_SOC_DAPM_STATS_EVENTS	7
+
+/* buckets for looking up DAPM widgets by name */
+#define SND_SOC_DAPM_HASH_SIZE		32
+
+struct snd_soc_dapm_stats {
+	unsigned int runs;
+	u64 total_ns;
+	u64 max_ns;
+	u64 io_ns;
+	u64 wait_ns;
+	u64 event_ns;
+};
+
 /* SoC Audio Codec */
 struct snd_soc_codec {
 	char *name;
@@ -266,23 +325,41 @@ struct snd_soc_codec {
 
 	/* codec IO */
 	void *control_data; /* codec control (i2c/3wire) data */
+	struct mutex io_mutex;	/* read/modify/write cycles */
 	unsigned int (*read)(struct snd_soc_codec *, unsigned int);
 	int (*write)(struct snd_soc_codec *, unsigned int, unsigned int);
+	/* optional: cached value of a non volatile register */
+	unsigned int (*read_cache)(struct snd_soc_codec *, unsigned int);
+	int (*volatile_register)(struct snd_soc_codec *, unsigned int);
 	int (*display_register)(struct snd_soc_codec *, char *,
 				size_t, unsigned int);
+	/* optional: write a run of registers, used by snd_soc_cache_sync() */
+	int (*write_block)(struct snd_soc_codec *, unsigned int,
+			   const u16 *, int);
+	/* optional: read a run of registers, used by the register dump */
+	int (*read_block)(struct snd_soc_codec *, unsigned int, u16 *, int);
 	hw_write_t hw_write;
 	hw_read_t hw_read;
 	void *reg_cache;
 	short reg_cache_size;
 	short reg_cache_step;
+	struct snd_soc_cache *cache;	/* see soc-cache.c */
+	unsigned int cache_only:1;	/* hardware is off, only update cache */
 
 	/* dapm */
 	u32 pop_time;
+	unsigned int pmdown_time;	/* ms, 0 uses the pmdown_time param */
 	struct list_head dapm_widgets;
+	struct hlist_head dapm_hash[SND_SOC_DAPM_HASH_SIZE]; /* by name */
 	struct list_head dapm_paths;
 	enum snd_soc_bias_level bias_level;
 	enum snd_soc_bias_level suspend_bias_level;
 	struct delayed_work delayed_work;
+	int dapm_batch;			/* snd_soc_dapm_begin() nesting */
+	unsigned int dapm_batch_pending:1;	/* a power pass was held */
+	int dapm_batch_event;		/* stream event for the held pass */
+	unsigned int dapm_gen;		/* bumped on each graph change */
+	unsigned int dapm_gen_done;	/* dapm_gen at the last power pass */
 
 	/* codec DAI's */
 	struct snd_soc_dai *dai;
@@ -291,6 +368,9 @@ struct snd_soc_codec {
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_reg;
 	struct dentry *debugfs_pop_time;
+	struct dentry *debugfs_dapm_stats;
+	struct snd_soc_dapm_stats dapm_stats[SND_SOC_DAPM_STATS_EVENTS];
+	struct snd_soc_dapm_stats dapm_run;	/* power update in progress */
 #endif
 };
 
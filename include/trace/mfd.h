@@ -0,0 +1,33 @@
+#ifndef _TRACE_MFD_H
+#define _TRACE_MFD_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Register accesses by MFD core drivers.  @cached is set when the access
+ * was satisfied from (or, for writes, absorbed by) the register cache
+ * without bus traffic, and @ns is the time taken by the access it was
+ * part of.
+ */
+
+DECLARE_TRACE(mfd_reg_read,
+	TPPROTO(struct device *dev, unsigned int reg, unsigned int val,
+		int cached, s64 ns),
+		TPARGS(dev, reg, val, cached, ns));
+
+DECLARE_TRACE(mfd_reg_write,
+	TPPROTO(struct device *dev, unsigned int reg, unsigned int val,
+		int cached, s64 ns),
+		TPARGS(dev, reg, val, cached, ns));
+
+/* Lets drivers avoid timing accesses when nobody is listening */
+#ifdef CONFIG_TRACEPOINTS
+#define mfd_reg_trace_enabled()					\
+	unlikely(__tracepoint_mfd_reg_read.state ||		\
+		 __tracepoint_mfd_reg_write.state)
+#else
+#define mfd_reg_trace_enabled() 0
+#endif
+
+#endif
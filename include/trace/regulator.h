@@ -0,0 +1,44 @@
+#ifndef _TRACE_REGULATOR_H
+#define _TRACE_REGULATOR_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * Regulators are identified by name since struct regulator_dev is
+ * private to the regulator core.  The complete events for settings
+ * carry the value the regulator ended up at, 0 if it is not known.
+ */
+
+DECLARE_TRACE(regulator_enable,
+	TPPROTO(const char *name),
+		TPARGS(name));
+
+DECLARE_TRACE(regulator_enable_complete,
+	TPPROTO(const char *name, int ret),
+		TPARGS(name, ret));
+
+DECLARE_TRACE(regulator_disable,
+	TPPROTO(const char *name),
+		TPARGS(name));
+
+DECLARE_TRACE(regulator_disable_complete,
+	TPPROTO(const char *name, int ret),
+		TPARGS(name, ret));
+
+DECLARE_TRACE(regulator_set_voltage,
+	TPPROTO(const char *name, int min_uV, int max_uV),
+		TPARGS(name, min_uV, max_uV));
+
+DECLARE_TRACE(regulator_set_voltage_complete,
+	TPPROTO(const char *name, int uV, int ret),
+		TPARGS(name, uV, ret));
+
+DECLARE_TRACE(regulator_set_mode,
+	TPPROTO(const char *name, unsigned int mode),
+		TPARGS(name, mode));
+
+DECLARE_TRACE(regulator_set_mode_complete,
+	TPPROTO(const char *name, unsigned int mode, int ret),
+		TPARGS(name, mode, ret));
+
+#endif
@@ -13,9 +13,15 @@
 
 struct plat_lcd_data;
 struct fb_info;
+struct lcd_supply;
 
+/* Panels whose power is only supplies can give those instead of set_power,
+ * which is called after the supplies power up and before they power down.
+ */
 struct plat_lcd_data {
 	void	(*set_power)(struct plat_lcd_data *, unsigned int power);
 	int	(*match_fb)(struct plat_lcd_data *, struct fb_info *);
+	const struct lcd_supply *supplies;
+	int	num_supplies;
 };
 
@@ -10,6 +10,9 @@
 #include <linux/syscalls.h>
 #include <linux/freezer.h>
 
+atomic_t freezer_frozen_count = ATOMIC_INIT(0);
+DECLARE_WAIT_QUEUE_HEAD(freezer_wait);
+
 /*
  * freezing is complete, mark current process as frozen
  */
@@ -33,6 +36,9 @@ void refrigerator(void)
 	if (freezing(current)) {
 		frozen_process();
 		task_unlock(current);
+		/* let try_to_freeze_tasks() know without it polling */
+		atomic_inc(&freezer_frozen_count);
+		wake_up(&freezer_wait);
 	} else {
 		task_unlock(current);
 		return;
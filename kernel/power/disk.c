@@ -22,6 +22,7 @@
 #include <linux/console.h>
 #include <linux/cpu.h>
 #include <linux/freezer.h>
+#include <linux/regulator/machine.h>
 
 #include "power.h"
 
@@ -30,6 +31,7 @@ static int noresume = 0;
 static char resume_file[256] = CONFIG_PM_STD_PARTITION;
 dev_t swsusp_resume_device;
 sector_t swsusp_resume_block;
+int hibernate_nocompress;
 
 enum {
 	HIBERNATION_INVALID,
@@ -461,6 +463,13 @@ int hibernation_platform_enter(void)
 
 static void power_down(void)
 {
+	/* PMICs switch to their hibernate configuration as we power off */
+	if ((hibernation_mode == HIBERNATION_PLATFORM ||
+	     hibernation_mode == HIBERNATION_SHUTDOWN) &&
+	    regulator_suspend_prepare(PM_SUSPEND_MAX))
+		printk(KERN_WARNING "PM: Failed to set regulator hibernate "
+			"states\n");
+
 	switch (hibernation_mode) {
 	case HIBERNATION_TEST:
 	case HIBERNATION_TESTPROC:
@@ -889,6 +898,14 @@ static int __init noresume_setup(char *str)
 	return 1;
 }
 
+static int __init hibernate_setup(char *str)
+{
+	if (!strcmp(str, "nocompress"))
+		hibernate_nocompress = 1;
+	return 1;
+}
+
 __setup("noresume", noresume_setup);
 __setup("resume_offset=", resume_offset_setup);
 __setup("resume=", resume_setup);
+__setup("hibernate=", hibernate_setup);
@@ -22,6 +22,7 @@
 #include <linux/freezer.h>
 #include <linux/vmstat.h>
 #include <linux/syscalls.h>
+#include <linux/regulator/machine.h>
 
 #include "power.h"
 
@@ -326,6 +327,10 @@ int suspend_devices_and_enter(suspend_state_t state)
 		if (error)
 			goto Close;
 	}
+	/* while the busses the PMICs are on are still running */
+	if (regulator_suspend_prepare(state))
+		printk(KERN_WARNING "PM: Failed to set regulator suspend "
+			"states\n");
 	suspend_console();
 	suspend_test_start();
 	error = device_suspend(PMSG_SUSPEND);
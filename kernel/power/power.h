@@ -68,6 +68,7 @@ extern unsigned long image_size;
 extern int in_suspend;
 extern dev_t swsusp_resume_device;
 extern sector_t swsusp_resume_block;
+extern int hibernate_nocompress;
 
 extern asmlinkage int swsusp_arch_suspend(void);
 extern asmlinkage int swsusp_arch_resume(void);
@@ -146,6 +147,7 @@ extern int swsusp_swap_in_use(void);
  * the image header.
  */
 #define SF_PLATFORM_MODE	1
+#define SF_COMPRESS_MODE	2	/* image data is LZO compressed */
 
 /* kernel/power/disk.c */
 extern int swsusp_check(void);
@@ -19,6 +19,15 @@
  */
 #define TIMEOUT	(20 * HZ)
 
+/*
+ * Tasks which are stopped, traced or skipped don't enter the refrigerator
+ * and so never wake us, look at the task list again after this long.
+ */
+#define RECHECK_MS	10
+
+/* once freezing has taken this long name the tasks still to go */
+#define SLOW_MS		1000
+
 static inline int freezeable(struct task_struct * p)
 {
 	if ((p == current) ||
@@ -31,16 +40,23 @@ static inline int freezeable(struct task_struct * p)
 static int try_to_freeze_tasks(bool sig_only)
 {
 	struct task_struct *g, *p;
-	unsigned long end_time;
-	unsigned int todo;
+	unsigned long end_time, slow_time;
+	unsigned int todo, before;
 	struct timeval start, end;
 	u64 elapsed_csecs64;
 	unsigned int elapsed_csecs;
+	bool report, reported = false;
 
 	do_gettimeofday(&start);
 
 	end_time = jiffies + TIMEOUT;
-	do {
+	slow_time = jiffies + msecs_to_jiffies(SLOW_MS);
+	for (;;) {
+		before = atomic_read(&freezer_frozen_count);
+		report = !reported && time_after(jiffies, slow_time);
+		if (report)
+			printk(KERN_INFO "\nTasks slow to freeze:\n");
+
 		todo = 0;
 		read_lock(&tasklist_lock);
 		do_each_thread(g, p) {
@@ -57,14 +73,28 @@ static int try_to_freeze_tasks(bool sig_only)
 			 * up, it will immediately call try_to_freeze.
 			 */
 			if (!task_is_stopped_or_traced(p) &&
-			    !freezer_should_skip(p))
+			    !freezer_should_skip(p)) {
 				todo++;
+				if (report)
+					printk(KERN_INFO " %s (%d)\n",
+					       p->comm, p->pid);
+			}
 		} while_each_thread(g, p);
 		read_unlock(&tasklist_lock);
-		yield();			/* Yield is okay here */
-		if (time_after(jiffies, end_time))
+		reported |= report;
+
+		if (!todo || time_after(jiffies, end_time))
 			break;
-	} while (todo);
+
+		/*
+		 * Sleep until every task we are waiting for has entered the
+		 * refrigerator rather than walking the task list again each
+		 * time one does.
+		 */
+		wait_event_timeout(freezer_wait,
+			atomic_read(&freezer_frozen_count) - before >= todo,
+			msecs_to_jiffies(RECHECK_MS));
+	}
 
 	do_gettimeofday(&end);
 	elapsed_csecs64 = timeval_to_ns(&end) - timeval_to_ns(&start);
@@ -526,14 +526,30 @@ static int memory_bm_test_bit(struct memory_bitmap *bm, unsigned long pfn)
  *
  *	It is required to run memory_bm_position_reset() before the first call to
  *	this function.
+ *
+ *	The bitmaps of the image are mostly dense, so the rest of the word
+ *	holding the current position is checked first, before falling back
+ *	to find_next_bit() and walking the blocks.
  */
 
 static unsigned long memory_bm_next_pfn(struct memory_bitmap *bm)
 {
 	struct zone_bitmap *zone_bm;
 	struct bm_block *bb;
+	unsigned long word;
 	int bit;
 
+	bb = bm->cur.block;
+	bit = bm->cur.bit;
+	if (bit < bm_block_bits(bb)) {
+		word = bb->data[BIT_WORD(bit)] >> (bit % BITS_PER_LONG);
+		if (word) {
+			bit += __ffs(word);
+			if (bit < bm_block_bits(bb))
+				goto Return_pfn;
+		}
+	}
+
 	do {
 		bb = bm->cur.block;
 		do {
@@ -984,21 +1000,48 @@ static inline void copy_data_page(unsigned long dst_pfn, unsigned long src_pfn)
 }
 #endif /* CONFIG_HIGHMEM */
 
+/**
+ *	mark_saveable_pages - set the bits of the saveable pages in @bm
+ *
+ *	The zone bitmaps of @bm are in the same order as the populated zones
+ *	(see memory_bm_create()), so they are walked alongside the zones and
+ *	the bits are set in the blocks directly instead of looking each pfn
+ *	up with memory_bm_set_bit().  We run on one CPU with interrupts off,
+ *	so the non-atomic bitops are fine.
+ */
+
+static void mark_saveable_pages(struct memory_bitmap *bm)
+{
+	struct zone_bitmap *zone_bm = bm->zone_bm_list;
+	struct zone *zone;
+
+	for_each_zone(zone) {
+		struct bm_block *bb;
+
+		if (!populated_zone(zone))
+			continue;
+
+		for (bb = zone_bm->bm_blocks; bb; bb = bb->next) {
+			unsigned long pfn;
+
+			for (pfn = bb->start_pfn; pfn < bb->end_pfn; pfn++)
+				if (page_is_saveable(zone, pfn))
+					__set_bit(pfn - bb->start_pfn,
+						  bb->data);
+		}
+		zone_bm = zone_bm->next;
+	}
+}
+
 static void
 copy_data_pages(struct memory_bitmap *copy_bm, struct memory_bitmap *orig_bm)
 {
 	struct zone *zone;
 	unsigned long pfn;
 
-	for_each_zone(zone) {
-		unsigned long max_zone_pfn;
-
+	for_each_zone(zone)
 		mark_free_pages(zone);
-		max_zone_pfn = zone->zone_start_pfn + zone->spanned_pages;
-		for (pfn = zone->zone_start_pfn; pfn < max_zone_pfn; pfn++)
-			if (page_is_saveable(zone, pfn))
-				memory_bm_set_bit(orig_bm, pfn);
-	}
+	mark_saveable_pages(orig_bm);
 	memory_bm_position_reset(orig_bm);
 	memory_bm_position_reset(copy_bm);
 	for(;;) {
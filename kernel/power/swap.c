@@ -24,6 +24,9 @@
 #include <linux/swap.h>
 #include <linux/swapops.h>
 #include <linux/pm.h>
+#include <linux/kthread.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
 
 #include "power.h"
 
@@ -46,6 +49,80 @@ static struct swsusp_header *swsusp_header;
 static unsigned short root_swap = 0xffff;
 static struct block_device *resume_bdev;
 
+/*
+ * Image I/O
+ *
+ * Pages queued on a bio chain are gathered into one bio for as long as
+ * they are contiguous on the swap device, and the bio is only submitted
+ * once the next page does not fit in it or the chain is waited on.  At
+ * most HIB_MAX_INFLIGHT pages are under I/O at any time, so the device
+ * is kept busy without letting the queued pages pile up.
+ */
+
+#define HIB_MAX_INFLIGHT	1024	/* pages */
+
+static struct {
+	struct bio *bio;	/* being filled, not submitted yet */
+	struct bio **chain;	/* chain it is submitted on */
+	int rw;
+	pgoff_t next_off;	/* page offset which would extend it */
+} hib_io;
+
+static atomic_t hib_inflight = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(hib_io_wait);
+
+static void hib_end_io(struct bio *bio, int err)
+{
+	const int uptodate = test_bit(BIO_UPTODATE, &bio->bi_flags);
+	struct bio_vec *bvec;
+	int i;
+
+	if (!uptodate)
+		printk(KERN_ALERT "PM: I/O error on image device at %Lu\n",
+		       (unsigned long long)bio->bi_sector);
+
+	__bio_for_each_segment(bvec, bio, i, 0) {
+		struct page *page = bvec->bv_page;
+
+		if (uptodate) {
+			SetPageUptodate(page);
+		} else {
+			SetPageError(page);
+			ClearPageUptodate(page);
+		}
+		unlock_page(page);
+	}
+	atomic_sub(bio->bi_vcnt, &hib_inflight);
+	wake_up(&hib_io_wait);
+	bio_put(bio);
+}
+
+static void hib_submit_bio(int rw, struct bio *bio)
+{
+	wait_event(hib_io_wait,
+		   atomic_read(&hib_inflight) < HIB_MAX_INFLIGHT);
+	atomic_add(bio->bi_vcnt, &hib_inflight);
+	submit_bio(rw | (1 << BIO_RW_SYNC), bio);
+}
+
+/**
+ *	hib_io_flush - submit the bio being filled, if any, on its chain
+ */
+
+static void hib_io_flush(void)
+{
+	struct bio *bio = hib_io.bio;
+
+	if (!bio)
+		return;
+
+	hib_io.bio = NULL;
+	bio_get(bio);
+	bio->bi_private = *hib_io.chain;
+	*hib_io.chain = bio;
+	hib_submit_bio(hib_io.rw, bio);
+}
+
 /**
  *	submit - submit BIO request.
  *	@rw:	READ or WRITE.
@@ -56,18 +133,29 @@ static struct block_device *resume_bdev;
  *	Straight from the textbook - allocate and initialize the bio.
  *	If we're reading, make sure the page is marked as dirty.
  *	Then submit it and, if @bio_chain == NULL, wait.
+ *
+ *	If @bio_chain is given and @page follows the previous page queued
+ *	on it on the swap device, @page is added to the same bio instead.
  */
 static int submit(int rw, pgoff_t page_off, struct page *page,
 			struct bio **bio_chain)
 {
 	struct bio *bio;
 
-	bio = bio_alloc(__GFP_WAIT | __GFP_HIGH, 1);
+	if (bio_chain && hib_io.bio && hib_io.chain == bio_chain &&
+	    hib_io.rw == rw && hib_io.next_off == page_off &&
+	    bio_add_page(hib_io.bio, page, PAGE_SIZE, 0) == PAGE_SIZE)
+		goto queued;
+
+	hib_io_flush();
+
+	bio = bio_alloc(__GFP_WAIT | __GFP_HIGH, bio_chain ?
+			min(bio_get_nr_vecs(resume_bdev), BIO_MAX_PAGES) : 1);
 	if (!bio)
 		return -ENOMEM;
 	bio->bi_sector = page_off * (PAGE_SIZE >> 9);
 	bio->bi_bdev = resume_bdev;
-	bio->bi_end_io = end_swap_bio_read;
+	bio->bi_end_io = hib_end_io;
 
 	if (bio_add_page(bio, page, PAGE_SIZE, 0) < PAGE_SIZE) {
 		printk(KERN_ERR "PM: Adding page to bio failed at %ld\n",
@@ -76,22 +164,25 @@ static int submit(int rw, pgoff_t page_off, struct page *page,
 		return -EFAULT;
 	}
 
-	lock_page(page);
-	bio_get(bio);
-
 	if (bio_chain == NULL) {
-		submit_bio(rw | (1 << BIO_RW_SYNC), bio);
+		lock_page(page);
+		bio_get(bio);
+		hib_submit_bio(rw, bio);
 		wait_on_page_locked(page);
 		if (rw == READ)
 			bio_set_pages_dirty(bio);
 		bio_put(bio);
-	} else {
-		if (rw == READ)
-			get_page(page);	/* These pages are freed later */
-		bio->bi_private = *bio_chain;
-		*bio_chain = bio;
-		submit_bio(rw | (1 << BIO_RW_SYNC), bio);
+		return 0;
 	}
+
+	hib_io.bio = bio;
+	hib_io.chain = bio_chain;
+	hib_io.rw = rw;
+ queued:
+	lock_page(page);
+	if (rw == READ)
+		get_page(page);	/* These pages are freed later */
+	hib_io.next_off = page_off + 1;
 	return 0;
 }
 
@@ -105,6 +196,67 @@ static int bio_write_page(pgoff_t page_off, void *addr, struct bio **bio_chain)
 	return submit(WRITE, page_off, virt_to_page(addr), bio_chain);
 }
 
+/**
+ *	finish_bio - wait for the pages of a chained bio and drop the
+ *	references to them and to the bio taken when it was queued
+ */
+
+static int finish_bio(struct bio *bio)
+{
+	struct bio_vec *bvec;
+	int i, ret = 0;
+
+	__bio_for_each_segment(bvec, bio, i, 0) {
+		struct page *page = bvec->bv_page;
+
+		wait_on_page_locked(page);
+		if (!PageUptodate(page) || PageError(page))
+			ret = -EIO;
+		put_page(page);
+	}
+	bio_put(bio);
+	return ret;
+}
+
+static int bio_completed(struct bio *bio)
+{
+	struct bio_vec *bvec;
+	int i;
+
+	__bio_for_each_segment(bvec, bio, i, 0)
+		if (PageLocked(bvec->bv_page))
+			return 0;
+	return 1;
+}
+
+/**
+ *	reap_bio_chain - release the bios on @bio_chain that have completed,
+ *	leaving the others under I/O
+ */
+
+static int reap_bio_chain(struct bio **bio_chain)
+{
+	struct bio **p;
+	int ret = 0;
+
+	if (bio_chain == NULL)
+		return 0;
+
+	p = bio_chain;
+	while (*p) {
+		struct bio *bio = *p;
+
+		if (bio_completed(bio)) {
+			*p = bio->bi_private;
+			if (finish_bio(bio))
+				ret = -EIO;
+		} else {
+			p = (struct bio **)&bio->bi_private;
+		}
+	}
+	return ret;
+}
+
 static int wait_on_bio_chain(struct bio **bio_chain)
 {
 	struct bio *bio;
@@ -114,19 +266,16 @@ static int wait_on_bio_chain(struct bio **bio_chain)
 	if (bio_chain == NULL)
 		return 0;
 
+	if (hib_io.bio && hib_io.chain == bio_chain)
+		hib_io_flush();
+
 	bio = *bio_chain;
 	if (bio == NULL)
 		return 0;
 	while (bio) {
-		struct page *page;
-
 		next_bio = bio->bi_private;
-		page = bio->bi_io_vec[0].bv_page;
-		wait_on_page_locked(page);
-		if (!PageUptodate(page) || PageError(page))
+		if (finish_bio(bio))
 			ret = -EIO;
-		put_page(page);
-		bio_put(bio);
 		bio = next_bio;
 	}
 	*bio_chain = NULL;
@@ -280,7 +429,7 @@ static int swap_write_page(struct swap_map_handle *handle, void *buf,
 		return error;
 	handle->cur->entries[handle->k++] = offset;
 	if (handle->k >= MAP_PAGE_ENTRIES) {
-		error = wait_on_bio_chain(bio_chain);
+		error = reap_bio_chain(bio_chain);
 		if (error)
 			goto out;
 		offset = alloc_swapdev_block(root_swap);
@@ -353,19 +502,217 @@ static int save_image(struct swap_map_handle *handle,
 	return error;
 }
 
+/*
+ * Compressed image support.
+ *
+ * The image data pages are grouped into blocks of LZO_UNC_PAGES pages,
+ * each of which is compressed with LZO and written out as a stream of
+ * pages holding the length of the compressed block (LZO_HEADER bytes)
+ * followed by the compressed data.  The blocks are compressed and
+ * decompressed by up to LZO_THREADS kernel threads in parallel while the
+ * caller feeds them with image data and does the I/O, always in the same
+ * order, so the on-disk layout does not depend on the number of threads.
+ */
+
+#define LZO_HEADER	sizeof(size_t)
+#define LZO_UNC_PAGES	32
+#define LZO_UNC_SIZE	(LZO_UNC_PAGES * PAGE_SIZE)
+#define LZO_CMP_PAGES	DIV_ROUND_UP(lzo1x_worst_compress(LZO_UNC_SIZE) + \
+				     LZO_HEADER, PAGE_SIZE)
+#define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
+#define LZO_THREADS	8
+
+/**
+ *	lzo_nr_threads - number of compression threads to use, leaving
+ *	one CPU for the thread doing the I/O where there are enough of them
+ */
+
+static unsigned int lzo_nr_threads(void)
+{
+	unsigned int nr_threads = num_online_cpus() - 1;
+
+	return clamp_t(unsigned int, nr_threads, 1, LZO_THREADS);
+}
+
+struct cmp_data {
+	struct task_struct *thr;
+	atomic_t ready;			/* block handed to the thread */
+	atomic_t stop;			/* thread done with the block */
+	int ret;
+	wait_queue_head_t go;
+	wait_queue_head_t done;
+	size_t unc_len;
+	size_t cmp_len;
+	unsigned char unc[LZO_UNC_SIZE];
+	unsigned char cmp[LZO_CMP_SIZE];
+	unsigned char wrk[LZO1X_1_MEM_COMPRESS];
+};
+
+static int lzo_compress_threadfn(void *data)
+{
+	struct cmp_data *d = data;
+
+	for (;;) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (!atomic_read(&d->ready))
+			break;
+		atomic_set(&d->ready, 0);
+
+		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
+					  d->cmp + LZO_HEADER, &d->cmp_len,
+					  d->wrk);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+/**
+ *	save_image_lzo - save the suspend image data compressed with LZO
+ */
+
+static int save_image_lzo(struct swap_map_handle *handle,
+			  struct snapshot_handle *snapshot,
+			  unsigned int nr_to_write)
+{
+	unsigned int m, thr, run_threads, nr_threads;
+	int ret;
+	int error = 0;
+	int nr_pages;
+	int err2;
+	struct bio *bio;
+	struct timeval start;
+	struct timeval stop;
+	struct cmp_data *data;
+	size_t off;
+	void *page;
+
+	nr_threads = lzo_nr_threads();
+	page = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
+	if (!page) {
+		printk(KERN_ERR "PM: Failed to allocate LZO page\n");
+		return -ENOMEM;
+	}
+	data = vmalloc(sizeof(*data) * nr_threads);
+	if (!data) {
+		printk(KERN_ERR "PM: Failed to allocate LZO data\n");
+		error = -ENOMEM;
+		goto out_page;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		memset(&data[thr], 0, offsetof(struct cmp_data, unc));
+		init_waitqueue_head(&data[thr].go);
+		init_waitqueue_head(&data[thr].done);
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		data[thr].thr = kthread_run(lzo_compress_threadfn, &data[thr],
+					    "image_compress/%u", thr);
+		if (IS_ERR(data[thr].thr)) {
+			data[thr].thr = NULL;
+			printk(KERN_ERR "PM: Cannot start compression "
+			       "threads\n");
+			error = -ENOMEM;
+			goto out_threads;
+		}
+	}
+
+	printk(KERN_INFO "PM: Compressing and saving image data "
+	       "(%u pages, %u threads) ...     ", nr_to_write, nr_threads);
+	m = nr_to_write / 100;
+	if (!m)
+		m = 1;
+	nr_pages = 0;
+	bio = NULL;
+	do_gettimeofday(&start);
+	for (;;) {
+		for (thr = 0; thr < nr_threads; thr++) {
+			for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
+				ret = snapshot_read_next(snapshot, PAGE_SIZE);
+				if (ret < 0)
+					error = ret;
+				if (ret <= 0)
+					break;
+				memcpy(data[thr].unc + off,
+				       data_of(*snapshot), ret);
+				if (!(nr_pages % m))
+					printk("\b\b\b\b%3d%%", nr_pages / m);
+				nr_pages++;
+			}
+			if (!off || error)
+				break;
+			data[thr].unc_len = off;
+			atomic_set(&data[thr].ready, 1);
+			wake_up(&data[thr].go);
+		}
+		if (!thr)
+			break;
+
+		/* Write the blocks out in the order they were read */
+		for (run_threads = thr, thr = 0; thr < run_threads; thr++) {
+			struct cmp_data *d = &data[thr];
+
+			wait_event(d->done, atomic_read(&d->stop));
+			atomic_set(&d->stop, 0);
+			if (error)
+				continue;
+
+			if (d->ret != LZO_E_OK || !d->cmp_len ||
+			    d->cmp_len > lzo1x_worst_compress(d->unc_len)) {
+				printk(KERN_ERR "PM: LZO compression failed\n");
+				error = -EIO;
+				continue;
+			}
+			*(size_t *)d->cmp = d->cmp_len;
+			for (off = 0; off < LZO_HEADER + d->cmp_len;
+			     off += PAGE_SIZE) {
+				memcpy(page, d->cmp + off, PAGE_SIZE);
+				error = swap_write_page(handle, page, &bio);
+				if (error)
+					break;
+			}
+		}
+		if (error)
+			break;
+	}
+	err2 = wait_on_bio_chain(&bio);
+	do_gettimeofday(&stop);
+	if (!error)
+		error = err2;
+	if (!error)
+		printk("\b\b\b\bdone\n");
+	swsusp_show_speed(&start, &stop, nr_to_write, "Wrote");
+
+ out_threads:
+	for (thr = 0; thr < nr_threads; thr++)
+		if (data[thr].thr)
+			kthread_stop(data[thr].thr);
+	vfree(data);
+ out_page:
+	free_page((unsigned long)page);
+	return error;
+}
+
 /**
  *	enough_swap - Make sure we have enough swap to save the image.
  *
  *	Returns TRUE or FALSE after checking the total amount of swap
- *	space avaiable from the resume partition.
+ *	space avaiable from the resume partition, allowing for the image
+ *	growing slightly if it is to be compressed (as in @flags).
  */
 
-static int enough_swap(unsigned int nr_pages)
+static int enough_swap(unsigned int nr_pages, unsigned int flags)
 {
 	unsigned int free_swap = count_swap_pages(root_swap, 1);
+	unsigned int required = nr_pages;
+
+	/* Leave room for blocks LZO cannot compress */
+	if (flags & SF_COMPRESS_MODE)
+		required = DIV_ROUND_UP(nr_pages * LZO_CMP_PAGES,
+					LZO_UNC_PAGES);
 
 	pr_debug("PM: Free swap pages: %u\n", free_swap);
-	return free_swap > nr_pages + PAGES_FOR_IO;
+	return free_swap > required + PAGES_FOR_IO;
 }
 
 /**
@@ -400,7 +747,9 @@ int swsusp_write(unsigned int flags)
 		goto out;
 	}
 	header = (struct swsusp_info *)data_of(snapshot);
-	if (!enough_swap(header->pages)) {
+	if (!hibernate_nocompress)
+		flags |= SF_COMPRESS_MODE;
+	if (!enough_swap(header->pages, flags)) {
 		printk(KERN_ERR "PM: Not enough free swap\n");
 		error = -ENOSPC;
 		goto out;
@@ -410,9 +759,14 @@ int swsusp_write(unsigned int flags)
 		sector_t start = handle.cur_swap;
 
 		error = swap_write_page(&handle, header, NULL);
-		if (!error)
-			error = save_image(&handle, &snapshot,
-					header->pages - 1);
+		if (!error) {
+			if (flags & SF_COMPRESS_MODE)
+				error = save_image_lzo(&handle, &snapshot,
+						       header->pages - 1);
+			else
+				error = save_image(&handle, &snapshot,
+						   header->pages - 1);
+		}
 
 		if (!error) {
 			flush_swap_writer(&handle);
@@ -477,7 +831,7 @@ static int swap_read_page(struct swap_map_handle *handle, void *buf,
 	if (error)
 		return error;
 	if (++handle->k >= MAP_PAGE_ENTRIES) {
-		error = wait_on_bio_chain(bio_chain);
+		error = reap_bio_chain(bio_chain);
 		handle->k = 0;
 		offset = handle->cur->next_swap;
 		if (!offset)
@@ -518,11 +872,12 @@ static int load_image(struct swap_map_handle *handle,
 		error = snapshot_write_next(snapshot, PAGE_SIZE);
 		if (error <= 0)
 			break;
-		error = swap_read_page(handle, data_of(*snapshot), &bio);
-		if (error)
-			break;
-		if (snapshot->sync_read)
-			error = wait_on_bio_chain(&bio);
+		/*
+		 * Pages which have to be there before the next call are read
+		 * on their own so the read-ahead of the others carries on.
+		 */
+		error = swap_read_page(handle, data_of(*snapshot),
+				       snapshot->sync_read ? NULL : &bio);
 		if (error)
 			break;
 		if (!(nr_pages % m))
@@ -543,6 +898,214 @@ static int load_image(struct swap_map_handle *handle,
 	return error;
 }
 
+struct dec_data {
+	struct task_struct *thr;
+	atomic_t ready;			/* block handed to the thread */
+	atomic_t stop;			/* thread done with the block */
+	int ret;
+	wait_queue_head_t go;
+	wait_queue_head_t done;
+	size_t unc_len;
+	size_t cmp_len;
+	unsigned int nr_pages;		/* pages the block must expand to */
+	unsigned char unc[LZO_UNC_SIZE];
+	unsigned char cmp[LZO_CMP_SIZE];
+};
+
+static int lzo_decompress_threadfn(void *data)
+{
+	struct dec_data *d = data;
+
+	for (;;) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (!atomic_read(&d->ready))
+			break;
+		atomic_set(&d->ready, 0);
+
+		d->unc_len = LZO_UNC_SIZE;
+		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
+					       d->unc, &d->unc_len);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+/**
+ *	lzo_read_block - read one compressed block into @d
+ *	@pages: LZO_CMP_PAGES pages to read the block into
+ *
+ *	The first page is read synchronously to find the length of the
+ *	block, the rest of it is then read in one go.
+ */
+
+static int lzo_read_block(struct swap_map_handle *handle, void **pages,
+			  struct dec_data *d)
+{
+	struct bio *bio = NULL;
+	unsigned int i, nr;
+	int error, err2;
+
+	error = swap_read_page(handle, pages[0], NULL);
+	if (error)
+		return error;
+
+	d->cmp_len = *(size_t *)pages[0];
+	if (!d->cmp_len || d->cmp_len > lzo1x_worst_compress(LZO_UNC_SIZE)) {
+		printk(KERN_ERR "PM: Invalid LZO compressed length\n");
+		return -EINVAL;
+	}
+
+	nr = DIV_ROUND_UP(LZO_HEADER + d->cmp_len, PAGE_SIZE);
+	for (i = 1; i < nr; i++) {
+		error = swap_read_page(handle, pages[i], &bio);
+		if (error)
+			break;
+	}
+	err2 = wait_on_bio_chain(&bio);
+	if (!error)
+		error = err2;
+	if (error)
+		return error;
+
+	for (i = 0; i < nr; i++)
+		memcpy(d->cmp + i * PAGE_SIZE, pages[i], PAGE_SIZE);
+	return 0;
+}
+
+/**
+ *	load_image_lzo - load the LZO compressed image using the swap map
+ *	handle @handle and the snapshot handle @snapshot
+ *	(assume there are @nr_pages pages to load)
+ */
+
+static int load_image_lzo(struct swap_map_handle *handle,
+			  struct snapshot_handle *snapshot,
+			  unsigned int nr_to_read)
+{
+	unsigned int m, thr, run_threads, nr_threads, remaining, i;
+	int ret;
+	int error = 0;
+	struct timeval start;
+	struct timeval stop;
+	unsigned nr_pages;
+	struct dec_data *data;
+	void *pages[LZO_CMP_PAGES];
+	size_t off;
+
+	nr_threads = lzo_nr_threads();
+	memset(pages, 0, sizeof(pages));
+	for (i = 0; i < LZO_CMP_PAGES; i++) {
+		pages[i] = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
+		if (!pages[i]) {
+			printk(KERN_ERR "PM: Failed to allocate LZO pages\n");
+			error = -ENOMEM;
+			goto out_pages;
+		}
+	}
+	data = vmalloc(sizeof(*data) * nr_threads);
+	if (!data) {
+		printk(KERN_ERR "PM: Failed to allocate LZO data\n");
+		error = -ENOMEM;
+		goto out_pages;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		memset(&data[thr], 0, offsetof(struct dec_data, unc));
+		init_waitqueue_head(&data[thr].go);
+		init_waitqueue_head(&data[thr].done);
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		data[thr].thr = kthread_run(lzo_decompress_threadfn,
+					    &data[thr], "image_decompress/%u",
+					    thr);
+		if (IS_ERR(data[thr].thr)) {
+			data[thr].thr = NULL;
+			printk(KERN_ERR "PM: Cannot start decompression "
+			       "threads\n");
+			error = -ENOMEM;
+			goto out_threads;
+		}
+	}
+
+	printk(KERN_INFO "PM: Loading and decompressing image data "
+	       "(%u pages, %u threads) ...     ", nr_to_read, nr_threads);
+	m = nr_to_read / 100;
+	if (!m)
+		m = 1;
+	nr_pages = 0;
+	remaining = nr_to_read;
+	do_gettimeofday(&start);
+	for (;;) {
+		/*
+		 * Each thread starts decompressing as soon as its block has
+		 * been read, so the I/O overlaps with the decompression.
+		 */
+		for (thr = 0; remaining && thr < nr_threads; thr++) {
+			error = lzo_read_block(handle, pages, &data[thr]);
+			if (error)
+				break;
+			data[thr].nr_pages = min_t(unsigned int, remaining,
+						   LZO_UNC_PAGES);
+			remaining -= data[thr].nr_pages;
+			atomic_set(&data[thr].ready, 1);
+			wake_up(&data[thr].go);
+		}
+		if (!thr)
+			break;
+
+		for (run_threads = thr, thr = 0; thr < run_threads; thr++) {
+			struct dec_data *d = &data[thr];
+
+			wait_event(d->done, atomic_read(&d->stop));
+			atomic_set(&d->stop, 0);
+			if (error)
+				continue;
+
+			if (d->ret != LZO_E_OK ||
+			    d->unc_len != d->nr_pages * PAGE_SIZE) {
+				printk(KERN_ERR "PM: LZO decompression "
+				       "failed\n");
+				error = -EIO;
+				continue;
+			}
+			for (off = 0; off < d->unc_len; off += PAGE_SIZE) {
+				ret = snapshot_write_next(snapshot, PAGE_SIZE);
+				if (ret <= 0) {
+					error = ret ? ret : -ENODATA;
+					break;
+				}
+				memcpy(data_of(*snapshot), d->unc + off,
+				       PAGE_SIZE);
+				if (!(nr_pages % m))
+					printk("\b\b\b\b%3d%%", nr_pages / m);
+				nr_pages++;
+			}
+		}
+		if (error)
+			break;
+	}
+	do_gettimeofday(&stop);
+	if (!error) {
+		printk("\b\b\b\bdone\n");
+		snapshot_write_finalize(snapshot);
+		if (!snapshot_image_loaded(snapshot))
+			error = -ENODATA;
+	}
+	swsusp_show_speed(&start, &stop, nr_to_read, "Read");
+
+ out_threads:
+	for (thr = 0; thr < nr_threads; thr++)
+		if (data[thr].thr)
+			kthread_stop(data[thr].thr);
+	vfree(data);
+ out_pages:
+	for (i = 0; i < LZO_CMP_PAGES; i++)
+		if (pages[i])
+			free_page((unsigned long)pages[i]);
+	return error;
+}
+
 /**
  *	swsusp_read - read the hibernation image.
  *	@flags_p: flags passed by the "frozen" kernel in the image header should
@@ -570,8 +1133,14 @@ int swsusp_read(unsigned int *flags_p)
 	error = get_swap_reader(&handle, swsusp_header->image);
 	if (!error)
 		error = swap_read_page(&handle, header, NULL);
-	if (!error)
-		error = load_image(&handle, &snapshot, header->pages - 1);
+	if (!error) {
+		if (swsusp_header->flags & SF_COMPRESS_MODE)
+			error = load_image_lzo(&handle, &snapshot,
+					       header->pages - 1);
+		else
+			error = load_image(&handle, &snapshot,
+					   header->pages - 1);
+	}
 	release_swap_reader(&handle);
 
 	blkdev_put(resume_bdev, FMODE_READ);
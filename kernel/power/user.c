@@ -138,11 +138,18 @@ static int snapshot_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+/*
+ * The image is handed over one page at a time by snapshot_read_next() and
+ * snapshot_write_next(), but a single read() or write() may move as many
+ * pages as fit in the user buffer so that userspace doesn't pay a system
+ * call for every page.  A failure part way leaves the handle past data
+ * that was never transferred, so it fails the whole call.
+ */
 static ssize_t snapshot_read(struct file *filp, char __user *buf,
                              size_t count, loff_t *offp)
 {
 	struct snapshot_data *data;
-	ssize_t res;
+	ssize_t res = 0, done = 0;
 
 	mutex_lock(&pm_mutex);
 
@@ -151,12 +158,19 @@ static ssize_t snapshot_read(struct file *filp, char __user *buf,
 		res = -ENODATA;
 		goto Unlock;
 	}
-	res = snapshot_read_next(&data->handle, count);
-	if (res > 0) {
-		if (copy_to_user(buf, data_of(data->handle), res))
+	while (done < count) {
+		res = snapshot_read_next(&data->handle, count - done);
+		if (res <= 0)
+			break;
+		if (copy_to_user(buf + done, data_of(data->handle), res)) {
 			res = -EFAULT;
-		else
-			*offp = data->handle.offset;
+			break;
+		}
+		done += res;
+	}
+	if (res >= 0) {
+		res = done;
+		*offp = data->handle.offset;
 	}
 
  Unlock:
@@ -169,17 +183,24 @@ static ssize_t snapshot_write(struct file *filp, const char __user *buf,
                               size_t count, loff_t *offp)
 {
 	struct snapshot_data *data;
-	ssize_t res;
+	ssize_t res = 0, done = 0;
 
 	mutex_lock(&pm_mutex);
 
 	data = filp->private_data;
-	res = snapshot_write_next(&data->handle, count);
-	if (res > 0) {
-		if (copy_from_user(data_of(data->handle), buf, res))
+	while (done < count) {
+		res = snapshot_write_next(&data->handle, count - done);
+		if (res <= 0)
+			break;
+		if (copy_from_user(data_of(data->handle), buf + done, res)) {
 			res = -EFAULT;
-		else
-			*offp = data->handle.offset;
+			break;
+		}
+		done += res;
+	}
+	if (res >= 0) {
+		res = done;
+		*offp = data->handle.offset;
 	}
 
 	mutex_unlock(&pm_mutex);
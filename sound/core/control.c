@@ -24,6 +24,7 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/time.h>
+#include <linux/jhash.h>
 #include <sound/core.h>
 #include <sound/minors.h>
 #include <sound/info.h>
@@ -283,6 +284,27 @@ static unsigned int snd_ctl_hole_check(struct snd_card *card,
 	return card->last_numid;
 }
 
+/*
+ * Controls are hashed on everything in the id but the index, which a
+ * lookup may give anywhere in the range of a multi element control,
+ * and the numid, which is assigned by the card.
+ */
+static u32 snd_ctl_id_hash(const struct snd_ctl_elem_id *id)
+{
+	size_t len = strnlen((const char *)id->name, sizeof(id->name));
+
+	return jhash(id->name, len,
+		     (id->iface << 24) ^ (id->device << 16) ^ id->subdevice);
+}
+
+static void snd_ctl_hash_add(struct snd_card *card,
+			     struct snd_kcontrol *kctl)
+{
+	kctl->hash = snd_ctl_id_hash(&kctl->id);
+	hlist_add_head(&kctl->hash_node,
+		       &card->ctl_hash[kctl->hash % SNDRV_CTL_HASH_SIZE]);
+}
+
 static int snd_ctl_find_hole(struct snd_card *card, unsigned int count)
 {
 	unsigned int last_numid, iter = 100000;
@@ -341,6 +363,7 @@ int snd_ctl_add(struct snd_card *card, struct snd_kcontrol *kcontrol)
 		goto error;
 	}
 	list_add_tail(&kcontrol->list, &card->controls);
+	snd_ctl_hash_add(card, kcontrol);
 	card->controls_count += kcontrol->count;
 	kcontrol->id.numid = card->last_numid + 1;
 	card->last_numid += kcontrol->count;
@@ -375,6 +398,7 @@ int snd_ctl_remove(struct snd_card *card, struct snd_kcontrol *kcontrol)
 	if (snd_BUG_ON(!card || !kcontrol))
 		return -EINVAL;
 	list_del(&kcontrol->list);
+	hlist_del(&kcontrol->hash_node);
 	card->controls_count -= kcontrol->count;
 	id = kcontrol->id;
 	for (idx = 0; idx < kcontrol->count; idx++, id.index++, id.numid++)
@@ -468,7 +492,9 @@ int snd_ctl_rename_id(struct snd_card *card, struct snd_ctl_elem_id *src_id,
 		up_write(&card->controls_rwsem);
 		return -ENOENT;
 	}
+	hlist_del(&kctl->hash_node);
 	kctl->id = *dst_id;
+	snd_ctl_hash_add(card, kctl);
 	kctl->id.numid = card->last_numid + 1;
 	card->last_numid += kctl->count;
 	up_write(&card->controls_rwsem);
@@ -509,7 +535,10 @@ EXPORT_SYMBOL(snd_ctl_find_numid);
  * @card: the card instance
  * @id: the id to search
  *
- * Finds the control instance with the given id from the card.
+ * Finds the control instance with the given id from the card.  Lookups
+ * by name go through a hash of the ids rather than the whole list, as
+ * codecs with hundreds of controls made adding each one cost a walk of
+ * all those before it.
  *
  * Returns the pointer of the instance if found, or NULL if not.
  *
@@ -520,12 +549,19 @@ struct snd_kcontrol *snd_ctl_find_id(struct snd_card *card,
 				     struct snd_ctl_elem_id *id)
 {
 	struct snd_kcontrol *kctl;
+	struct hlist_node *node;
+	u32 hash;
 
 	if (snd_BUG_ON(!card || !id))
 		return NULL;
 	if (id->numid != 0)
 		return snd_ctl_find_numid(card, id->numid);
-	list_for_each_entry(kctl, &card->controls, list) {
+	hash = snd_ctl_id_hash(id);
+	hlist_for_each_entry(kctl, node,
+			     &card->ctl_hash[hash % SNDRV_CTL_HASH_SIZE],
+			     hash_node) {
+		if (kctl->hash != hash)
+			continue;
 		if (kctl->id.iface != id->iface)
 			continue;
 		if (kctl->id.device != id->device)
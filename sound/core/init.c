@@ -193,6 +193,8 @@ struct snd_card *snd_card_new(int idx, const char *xid,
 	init_rwsem(&card->controls_rwsem);
 	rwlock_init(&card->ctl_files_rwlock);
 	INIT_LIST_HEAD(&card->controls);
+	for (idx2 = 0; idx2 < SNDRV_CTL_HASH_SIZE; idx2++)
+		INIT_HLIST_HEAD(&card->ctl_hash[idx2]);
 	INIT_LIST_HEAD(&card->ctl_files);
 	spin_lock_init(&card->files_lock);
 	init_waitqueue_head(&card->shutdown_sleep);
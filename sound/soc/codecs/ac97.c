@@ -89,6 +89,7 @@ static int ac97_soc_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	codec = socdev->codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->name = "AC97";
 	codec->owner = THIS_MODULE;
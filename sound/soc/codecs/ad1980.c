@@ -205,6 +205,7 @@ static int ad1980_soc_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	codec = socdev->codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->reg_cache =
 		kzalloc(sizeof(u16) * ARRAY_SIZE(ad1980_reg), GFP_KERNEL);
@@ -49,6 +49,7 @@ static int ad73311_soc_probe(struct platform_device *pdev)
 	if (codec == NULL)
 		return -ENOMEM;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	codec->name = "AD73311";
 	codec->owner = THIS_MODULE;
 	codec->dai = &ad73311_dai;
@@ -638,6 +638,7 @@ static int ak4535_probe(struct platform_device *pdev)
 	codec->private_data = ak4535;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
@@ -678,6 +678,7 @@ static int cs4270_probe(struct platform_device *pdev)
 	}
 
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
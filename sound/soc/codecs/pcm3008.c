@@ -73,6 +73,7 @@ static int pcm3008_soc_probe(struct platform_device *pdev)
 
 	codec = socdev->codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->name = "PCM3008";
 	codec->owner = THIS_MODULE;
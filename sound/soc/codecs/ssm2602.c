@@ -749,6 +749,7 @@ static int ssm2602_probe(struct platform_device *pdev)
 	codec->private_data = ssm2602;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
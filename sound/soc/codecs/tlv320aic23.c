@@ -806,6 +806,7 @@ static int tlv320aic23_probe(struct platform_device *pdev)
 	codec = &aic23->codec;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
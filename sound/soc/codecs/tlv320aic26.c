@@ -451,6 +451,7 @@ static int aic26_spi_probe(struct spi_device *spi)
 	aic26->codec.write = aic26_reg_write;
 	aic26->master = 1;
 	mutex_init(&aic26->codec.mutex);
+	mutex_init(&aic26->codec.io_mutex);
 	INIT_LIST_HEAD(&aic26->codec.dapm_widgets);
 	INIT_LIST_HEAD(&aic26->codec.dapm_paths);
 	aic26->codec.reg_cache_size = AIC26_NUM_REGS;
@@ -1365,6 +1365,7 @@ static int aic3x_probe(struct platform_device *pdev)
 	codec->private_data = aic3x;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
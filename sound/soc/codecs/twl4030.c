@@ -117,6 +117,14 @@ static const u8 twl4030_reg[TWL4030_CACHEREGNUM] = {
 	0x00, /* REG_MISC_SET_2		(0x49)	*/
 };
 
+/* codec private data */
+struct twl4030_priv {
+	/* while powered down writes only go to the cache */
+	unsigned int cache_only:1;
+	/* cached registers not yet written to the chip */
+	DECLARE_BITMAP(dirty, TWL4030_CACHEREGNUM);
+};
+
 /*
  * read twl4030 register cache
  */
@@ -141,14 +149,123 @@ static inline void twl4030_write_reg_cache(struct snd_soc_codec *codec,
 	cache[reg] = value;
 }
 
+/*
+ * does a write of value to reg need to reach the chip
+ */
+static int twl4030_needs_write(struct snd_soc_codec *codec,
+			       unsigned int reg, unsigned int value)
+{
+	struct twl4030_priv *twl4030 = codec->private_data;
+
+	if (reg >= TWL4030_CACHEREGNUM)
+		return 1;
+
+	return twl4030_read_reg_cache(codec, reg) != value ||
+		test_bit(reg, twl4030->dirty);
+}
+
 /*
  * write to the twl4030 register space
+ *
+ * Writes which would not change the register are dropped.  While the
+ * codec is powered down only the cache is updated, other than for
+ * CODEC_MODE which controls the power, and the chip is brought up
+ * to date by twl4030_sync_cache() on power up.
  */
 static int twl4030_write(struct snd_soc_codec *codec,
 			unsigned int reg, unsigned int value)
 {
+	struct twl4030_priv *twl4030 = codec->private_data;
+	int ret;
+
+	if (!twl4030_needs_write(codec, reg, value))
+		return 0;
+
 	twl4030_write_reg_cache(codec, reg, value);
-	return twl4030_i2c_write_u8(TWL4030_MODULE_AUDIO_VOICE, value, reg);
+	if (reg >= TWL4030_CACHEREGNUM)
+		return twl4030_i2c_write_u8(TWL4030_MODULE_AUDIO_VOICE,
+					    value, reg);
+
+	if (twl4030->cache_only && reg != TWL4030_REG_CODEC_MODE) {
+		set_bit(reg, twl4030->dirty);
+		return 0;
+	}
+
+	ret = twl4030_i2c_write_u8(TWL4030_MODULE_AUDIO_VOICE, value, reg);
+	if (ret == 0)
+		clear_bit(reg, twl4030->dirty);
+	else
+		set_bit(reg, twl4030->dirty);
+
+	return ret;
+}
+
+/*
+ * write two adjacent registers, in either order, with one transfer
+ * if both need writing
+ */
+static int twl4030_write_pair(struct snd_soc_codec *codec,
+			      unsigned int reg, unsigned int value,
+			      unsigned int reg2, unsigned int value2)
+{
+	struct twl4030_priv *twl4030 = codec->private_data;
+	u8 buf[3];	/* twl4030_i2c_write() uses the first byte */
+	unsigned int tmp;
+	int ret;
+
+	if (reg > reg2) {
+		tmp = reg;
+		reg = reg2;
+		reg2 = tmp;
+		tmp = value;
+		value = value2;
+		value2 = tmp;
+	}
+
+	if (reg2 != reg + 1 || reg2 >= TWL4030_CACHEREGNUM ||
+	    twl4030->cache_only ||
+	    !twl4030_needs_write(codec, reg, value) ||
+	    !twl4030_needs_write(codec, reg2, value2)) {
+		ret = twl4030_write(codec, reg, value);
+		if (ret < 0)
+			return ret;
+		return twl4030_write(codec, reg2, value2);
+	}
+
+	twl4030_write_reg_cache(codec, reg, value);
+	twl4030_write_reg_cache(codec, reg2, value2);
+
+	buf[1] = value;
+	buf[2] = value2;
+	ret = twl4030_i2c_write(TWL4030_MODULE_AUDIO_VOICE, buf, reg, 2);
+	if (ret == 0) {
+		clear_bit(reg, twl4030->dirty);
+		clear_bit(reg2, twl4030->dirty);
+	} else {
+		set_bit(reg, twl4030->dirty);
+		set_bit(reg2, twl4030->dirty);
+	}
+
+	return ret;
+}
+
+/*
+ * write back the registers changed while the codec was powered down
+ */
+static void twl4030_sync_cache(struct snd_soc_codec *codec)
+{
+	struct twl4030_priv *twl4030 = codec->private_data;
+	int reg;
+
+	twl4030->cache_only = 0;
+
+	for (reg = TWL4030_REG_OPTION; reg < TWL4030_CACHEREGNUM; reg++) {
+		if (!test_bit(reg, twl4030->dirty))
+			continue;
+		if (twl4030_i2c_write_u8(TWL4030_MODULE_AUDIO_VOICE,
+				twl4030_read_reg_cache(codec, reg), reg) == 0)
+			clear_bit(reg, twl4030->dirty);
+	}
 }
 
 static void twl4030_clear_codecpdz(struct snd_soc_codec *codec)
@@ -480,6 +597,7 @@ static int snd_soc_put_volsw_r2_twl4030(struct snd_kcontrol *kcontrol,
 	unsigned int shift = mc->shift;
 	int max = mc->max;
 	int mask = (1 << fls(max)) - 1;
+	unsigned int old, old2, new, new2;
 	int err;
 	unsigned short val, val2, val_mask;
 
@@ -495,12 +613,20 @@ static int snd_soc_put_volsw_r2_twl4030(struct snd_kcontrol *kcontrol,
 	val = val << shift;
 	val2 = val2 << shift;
 
-	err = snd_soc_update_bits(codec, reg, val_mask, val);
+	mutex_lock(&codec->io_mutex);
+
+	old = snd_soc_read(codec, reg);
+	old2 = snd_soc_read(codec, reg2);
+	new = (old & ~val_mask) | val;
+	new2 = (old2 & ~val_mask) | val2;
+
+	err = twl4030_write_pair(codec, reg, new, reg2, new2);
+
+	mutex_unlock(&codec->io_mutex);
+
 	if (err < 0)
 		return err;
-
-	err = snd_soc_update_bits(codec, reg2, val_mask, val2);
-	return err;
+	return old != new || old2 != new2;
 }
 
 static int twl4030_get_left_input(struct snd_kcontrol *kcontrol,
@@ -915,6 +1041,9 @@ static void twl4030_power_up(struct snd_soc_codec *codec)
 	u8 anamicl, regmisc1, byte, popn;
 	int i = 0;
 
+	/* catch up with any changes made while powered down */
+	twl4030_sync_cache(codec);
+
 	/* set CODECPDZ to turn on codec */
 	twl4030_set_codecpdz(codec);
 
@@ -933,6 +1062,9 @@ static void twl4030_power_up(struct snd_soc_codec *codec)
 		 ((byte & TWL4030_CNCL_OFFSET_START) ==
 		  TWL4030_CNCL_OFFSET_START));
 
+	/* the start bit clears itself, don't let the cache say otherwise */
+	twl4030_write_reg_cache(codec, TWL4030_REG_ANAMICL, byte);
+
 	/* anti-pop when changing analog gain */
 	regmisc1 = twl4030_read_reg_cache(codec, TWL4030_REG_MISC_SET_1);
 	twl4030_write(codec, TWL4030_REG_MISC_SET_1,
@@ -957,6 +1089,7 @@ static void twl4030_power_up(struct snd_soc_codec *codec)
 
 static void twl4030_power_down(struct snd_soc_codec *codec)
 {
+	struct twl4030_priv *twl4030 = codec->private_data;
 	u8 popn;
 
 	/* disable anti-pop ramp */
@@ -970,6 +1103,8 @@ static void twl4030_power_down(struct snd_soc_codec *codec)
 
 	/* power down */
 	twl4030_clear_codecpdz(codec);
+
+	twl4030->cache_only = 1;
 }
 
 static int twl4030_set_bias_level(struct snd_soc_codec *codec,
@@ -1265,13 +1400,25 @@ static int twl4030_probe(struct platform_device *pdev)
 {
 	struct snd_soc_device *socdev = platform_get_drvdata(pdev);
 	struct snd_soc_codec *codec;
+	struct twl4030_priv *twl4030;
 
 	codec = kzalloc(sizeof(struct snd_soc_codec), GFP_KERNEL);
 	if (codec == NULL)
 		return -ENOMEM;
 
+	twl4030 = kzalloc(sizeof(struct twl4030_priv), GFP_KERNEL);
+	if (twl4030 == NULL) {
+		kfree(codec);
+		return -ENOMEM;
+	}
+
+	/* nothing is known to have reached the chip yet */
+	bitmap_fill(twl4030->dirty, TWL4030_CACHEREGNUM);
+
+	codec->private_data = twl4030;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
@@ -1287,6 +1434,7 @@ static int twl4030_remove(struct platform_device *pdev)
 	struct snd_soc_codec *codec = socdev->codec;
 
 	printk(KERN_INFO "TWL4030 Audio Codec remove\n");
+	kfree(codec->private_data);
 	kfree(codec);
 
 	return 0;
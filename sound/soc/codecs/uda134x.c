@@ -542,6 +542,7 @@ static int uda134x_soc_probe(struct platform_device *pdev)
 		goto reg_err;
 
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->reg_cache_size = sizeof(uda134x_reg);
 	codec->reg_cache_step = 1;
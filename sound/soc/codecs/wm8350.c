@@ -35,6 +35,9 @@
 #define WM8350_RAMP_UP		1
 #define WM8350_RAMP_DOWN	2
 
+/* down ramp steps done per run of the PGA work */
+#define WM8350_RAMP_BATCH	8
+
 /* We only include the analogue supplies here; the digital supplies
  * need to be available well before this driver can be probed.
  */
@@ -55,6 +58,7 @@ struct wm8350_data {
 	struct snd_soc_codec codec;
 	struct wm8350_output out1;
 	struct wm8350_output out2;
+	int ramp_step;
 	struct regulator_bulk_data supplies[ARRAY_SIZE(supply_names)];
 };
 
@@ -72,6 +76,19 @@ static unsigned int wm8350_codec_read(struct snd_soc_codec *codec,
 	return wm8350_reg_read(wm8350, reg);
 }
 
+static int wm8350_codec_read_block(struct snd_soc_codec *codec,
+				   unsigned int reg, u16 *dest, int count)
+{
+	struct wm8350 *wm8350 = codec->control_data;
+	return wm8350_block_read(wm8350, reg, count, dest);
+}
+
+static int wm8350_codec_volatile_register(struct snd_soc_codec *codec,
+					  unsigned int reg)
+{
+	return wm8350_reg_volatile(reg);
+}
+
 static int wm8350_codec_write(struct snd_soc_codec *codec, unsigned int reg,
 			      unsigned int value)
 {
@@ -80,132 +97,52 @@ static int wm8350_codec_write(struct snd_soc_codec *codec, unsigned int reg,
 }
 
 /*
- * Ramp OUT1 PGA volume to minimise pops at stream startup and shutdown.
+ * Move one channel's volume a step towards the ramp target, returning 1
+ * once the target is reached. OUT1 and OUT2 share a register layout.
  */
-static inline int wm8350_out1_ramp_step(struct snd_soc_codec *codec)
+static int wm8350_ramp_vol(u16 ramp, u16 *reg, u16 target)
 {
-	struct wm8350_data *wm8350_data = codec->private_data;
-	struct wm8350_output *out1 = &wm8350_data->out1;
-	struct wm8350 *wm8350 = codec->control_data;
-	int left_complete = 0, right_complete = 0;
-	u16 reg, val;
-
-	/* left channel */
-	reg = wm8350_reg_read(wm8350, WM8350_LOUT1_VOLUME);
-	val = (reg & WM8350_OUT1L_VOL_MASK) >> WM8350_OUT1L_VOL_SHIFT;
-
-	if (out1->ramp == WM8350_RAMP_UP) {
-		/* ramp step up */
-		if (val < out1->left_vol) {
-			val++;
-			reg &= ~WM8350_OUT1L_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_LOUT1_VOLUME,
-					 reg | (val << WM8350_OUT1L_VOL_SHIFT));
-		} else
-			left_complete = 1;
-	} else if (out1->ramp == WM8350_RAMP_DOWN) {
-		/* ramp step down */
-		if (val > 0) {
-			val--;
-			reg &= ~WM8350_OUT1L_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_LOUT1_VOLUME,
-					 reg | (val << WM8350_OUT1L_VOL_SHIFT));
-		} else
-			left_complete = 1;
+	u16 val = (*reg & WM8350_OUT1L_VOL_MASK) >> WM8350_OUT1L_VOL_SHIFT;
+
+	if (ramp == WM8350_RAMP_UP) {
+		if (val >= target)
+			return 1;
+		val++;
+	} else if (ramp == WM8350_RAMP_DOWN) {
+		if (val == 0)
+			return 1;
+		val--;
 	} else
 		return 1;
 
-	/* right channel */
-	reg = wm8350_reg_read(wm8350, WM8350_ROUT1_VOLUME);
-	val = (reg & WM8350_OUT1R_VOL_MASK) >> WM8350_OUT1R_VOL_SHIFT;
-	if (out1->ramp == WM8350_RAMP_UP) {
-		/* ramp step up */
-		if (val < out1->right_vol) {
-			val++;
-			reg &= ~WM8350_OUT1R_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_ROUT1_VOLUME,
-					 reg | (val << WM8350_OUT1R_VOL_SHIFT));
-		} else
-			right_complete = 1;
-	} else if (out1->ramp == WM8350_RAMP_DOWN) {
-		/* ramp step down */
-		if (val > 0) {
-			val--;
-			reg &= ~WM8350_OUT1R_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_ROUT1_VOLUME,
-					 reg | (val << WM8350_OUT1R_VOL_SHIFT));
-		} else
-			right_complete = 1;
-	}
-
-	/* only hit the update bit if either volume has changed this step */
-	if (!left_complete || !right_complete)
-		wm8350_set_bits(wm8350, WM8350_LOUT1_VOLUME, WM8350_OUT1_VU);
-
-	return left_complete & right_complete;
+	*reg &= ~WM8350_OUT1L_VOL_MASK;
+	*reg |= val << WM8350_OUT1L_VOL_SHIFT;
+	return 0;
 }
 
 /*
- * Ramp OUT2 PGA volume to minimise pops at stream startup and shutdown.
+ * Ramp an output PGA volume to minimise pops at stream startup and
+ * shutdown. The volume update bit is only set in the last write of the
+ * step, latching both channels at once.
  */
-static inline int wm8350_out2_ramp_step(struct snd_soc_codec *codec)
+static int wm8350_out_ramp_step(struct snd_soc_codec *codec,
+				struct wm8350_output *out, int lreg, int rreg)
 {
-	struct wm8350_data *wm8350_data = codec->private_data;
-	struct wm8350_output *out2 = &wm8350_data->out2;
 	struct wm8350 *wm8350 = codec->control_data;
-	int left_complete = 0, right_complete = 0;
-	u16 reg, val;
-
-	/* left channel */
-	reg = wm8350_reg_read(wm8350, WM8350_LOUT2_VOLUME);
-	val = (reg & WM8350_OUT2L_VOL_MASK) >> WM8350_OUT1L_VOL_SHIFT;
-	if (out2->ramp == WM8350_RAMP_UP) {
-		/* ramp step up */
-		if (val < out2->left_vol) {
-			val++;
-			reg &= ~WM8350_OUT2L_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_LOUT2_VOLUME,
-					 reg | (val << WM8350_OUT1L_VOL_SHIFT));
-		} else
-			left_complete = 1;
-	} else if (out2->ramp == WM8350_RAMP_DOWN) {
-		/* ramp step down */
-		if (val > 0) {
-			val--;
-			reg &= ~WM8350_OUT2L_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_LOUT2_VOLUME,
-					 reg | (val << WM8350_OUT1L_VOL_SHIFT));
-		} else
-			left_complete = 1;
-	} else
-		return 1;
+	int left_complete, right_complete;
+	u16 left, right;
 
-	/* right channel */
-	reg = wm8350_reg_read(wm8350, WM8350_ROUT2_VOLUME);
-	val = (reg & WM8350_OUT2R_VOL_MASK) >> WM8350_OUT1R_VOL_SHIFT;
-	if (out2->ramp == WM8350_RAMP_UP) {
-		/* ramp step up */
-		if (val < out2->right_vol) {
-			val++;
-			reg &= ~WM8350_OUT2R_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_ROUT2_VOLUME,
-					 reg | (val << WM8350_OUT1R_VOL_SHIFT));
-		} else
-			right_complete = 1;
-	} else if (out2->ramp == WM8350_RAMP_DOWN) {
-		/* ramp step down */
-		if (val > 0) {
-			val--;
-			reg &= ~WM8350_OUT2R_VOL_MASK;
-			wm8350_reg_write(wm8350, WM8350_ROUT2_VOLUME,
-					 reg | (val << WM8350_OUT1R_VOL_SHIFT));
-		} else
-			right_complete = 1;
-	}
+	left = wm8350_reg_read(wm8350, lreg);
+	right = wm8350_reg_read(wm8350, rreg);
+	left_complete = wm8350_ramp_vol(out->ramp, &left, out->left_vol);
+	right_complete = wm8350_ramp_vol(out->ramp, &right, out->right_vol);
 
-	/* only hit the update bit if either volume has changed this step */
-	if (!left_complete || !right_complete)
-		wm8350_set_bits(wm8350, WM8350_LOUT2_VOLUME, WM8350_OUT2_VU);
+	if (!right_complete) {
+		if (!left_complete)
+			wm8350_reg_write(wm8350, lreg, left & ~WM8350_OUT1_VU);
+		wm8350_reg_write(wm8350, rreg, right | WM8350_OUT1_VU);
+	} else if (!left_complete)
+		wm8350_reg_write(wm8350, lreg, left | WM8350_OUT1_VU);
 
 	return left_complete & right_complete;
 }
@@ -215,6 +152,9 @@ static inline int wm8350_out2_ramp_step(struct snd_soc_codec *codec)
  * minimise pop associated with DAPM power switching.
  * It's best to enable Zero Cross when ramping occurs to minimise any
  * zipper noises.
+ *
+ * Each run only does a few steps and then requeues itself rather than
+ * sleeping, so the ramp doesn't hold up the shared workqueue.
  */
 static void wm8350_pga_work(struct work_struct *work)
 {
@@ -224,39 +164,42 @@ static void wm8350_pga_work(struct work_struct *work)
 	struct wm8350_output *out1 = &wm8350_data->out1,
 	    *out2 = &wm8350_data->out2;
 	int i, out1_complete, out2_complete;
-
-	/* do we need to ramp at all ? */
-	if (out1->ramp == WM8350_RAMP_NONE && out2->ramp == WM8350_RAMP_NONE)
-		return;
-
-	/* PGA volumes have 6 bits of resolution to ramp */
-	for (i = 0; i <= 63; i++) {
-		out1_complete = 1, out2_complete = 1;
-		if (out1->ramp != WM8350_RAMP_NONE)
-			out1_complete = wm8350_out1_ramp_step(codec);
-		if (out2->ramp != WM8350_RAMP_NONE)
-			out2_complete = wm8350_out2_ramp_step(codec);
-
-		/* ramp finished ? */
-		if (out1_complete && out2_complete)
-			break;
+	unsigned long delay;
+
+	for (i = 0; i < WM8350_RAMP_BATCH; i++) {
+		out1_complete = wm8350_out_ramp_step(codec, out1,
+						     WM8350_LOUT1_VOLUME,
+						     WM8350_ROUT1_VOLUME);
+		out2_complete = wm8350_out_ramp_step(codec, out2,
+						     WM8350_LOUT2_VOLUME,
+						     WM8350_ROUT2_VOLUME);
+
+		/* ramp finished ? PGA volumes have 6 bits of resolution */
+		if ((out1_complete && out2_complete) ||
+		    ++wm8350_data->ramp_step > 63) {
+			out1->ramp = WM8350_RAMP_NONE;
+			out2->ramp = WM8350_RAMP_NONE;
+			return;
+		}
 
 		/* we need to delay longer on the up ramp */
 		if (out1->ramp == WM8350_RAMP_UP ||
-		    out2->ramp == WM8350_RAMP_UP) {
-			/* delay is longer over 0dB as increases are larger */
-			if (i >= WM8350_OUTn_0dB)
-				schedule_timeout_interruptible(msecs_to_jiffies
-							       (2));
-			else
-				schedule_timeout_interruptible(msecs_to_jiffies
-							       (1));
-		} else
-			udelay(50);	/* doesn't matter if we delay longer */
+		    out2->ramp == WM8350_RAMP_UP)
+			break;
+
+		udelay(50);	/* doesn't matter if we delay longer */
 	}
 
-	out1->ramp = WM8350_RAMP_NONE;
-	out2->ramp = WM8350_RAMP_NONE;
+	if (out1->ramp == WM8350_RAMP_UP || out2->ramp == WM8350_RAMP_UP) {
+		/* delay is longer over 0dB as increases are larger */
+		if (wm8350_data->ramp_step >= WM8350_OUTn_0dB)
+			delay = msecs_to_jiffies(2);
+		else
+			delay = msecs_to_jiffies(1);
+	} else
+		delay = 0;
+
+	schedule_delayed_work(&codec->delayed_work, delay);
 }
 
 /*
@@ -290,18 +233,18 @@ static int pga_event(struct snd_soc_dapm_widget *w,
 		out->ramp = WM8350_RAMP_UP;
 		out->active = 1;
 
-		if (!delayed_work_pending(&codec->delayed_work))
-			schedule_delayed_work(&codec->delayed_work,
-					      msecs_to_jiffies(1));
+		wm8350_data->ramp_step = 0;
+		schedule_delayed_work(&codec->delayed_work,
+				      msecs_to_jiffies(1));
 		break;
 
 	case SND_SOC_DAPM_PRE_PMD:
 		out->ramp = WM8350_RAMP_DOWN;
 		out->active = 0;
 
-		if (!delayed_work_pending(&codec->delayed_work))
-			schedule_delayed_work(&codec->delayed_work,
-					      msecs_to_jiffies(1));
+		wm8350_data->ramp_step = 0;
+		schedule_delayed_work(&codec->delayed_work,
+				      msecs_to_jiffies(1));
 		break;
 	}
 
@@ -775,21 +718,6 @@ static const struct snd_soc_dapm_route audio_map[] = {
 	{"Beep", NULL, "IN3R PGA"},
 };
 
-static int wm8350_add_controls(struct snd_soc_codec *codec)
-{
-	int err, i;
-
-	for (i = 0; i < ARRAY_SIZE(wm8350_snd_controls); i++) {
-		err = snd_ctl_add(codec->card,
-				  snd_soc_cnew(&wm8350_snd_controls[i],
-					       codec, NULL));
-		if (err < 0)
-			return err;
-	}
-
-	return 0;
-}
-
 static int wm8350_add_widgets(struct snd_soc_codec *codec)
 {
 	int ret;
@@ -817,7 +745,6 @@ static int wm8350_set_dai_sysclk(struct snd_soc_dai *codec_dai,
 {
 	struct snd_soc_codec *codec = codec_dai->codec;
 	struct wm8350 *wm8350 = codec->control_data;
-	u16 fll_4;
 
 	switch (clk_id) {
 	case WM8350_MCLK_SEL_MCLK:
@@ -830,9 +757,8 @@ static int wm8350_set_dai_sysclk(struct snd_soc_dai *codec_dai,
 	case WM8350_MCLK_SEL_PLL_32K:
 		wm8350_set_bits(wm8350, WM8350_CLOCK_CONTROL_1,
 				WM8350_MCLK_SEL);
-		fll_4 = wm8350_codec_read(codec, WM8350_FLL_CONTROL_4) &
-		    ~WM8350_FLL_CLK_SRC_MASK;
-		wm8350_codec_write(codec, WM8350_FLL_CONTROL_4, fll_4 | clk_id);
+		wm8350_reg_update_bits(wm8350, WM8350_FLL_CONTROL_4,
+				       WM8350_FLL_CLK_SRC_MASK, clk_id);
 		break;
 	}
 
@@ -850,49 +776,43 @@ static int wm8350_set_dai_sysclk(struct snd_soc_dai *codec_dai,
 static int wm8350_set_clkdiv(struct snd_soc_dai *codec_dai, int div_id, int div)
 {
 	struct snd_soc_codec *codec = codec_dai->codec;
-	u16 val;
+	struct wm8350 *wm8350 = codec->control_data;
+	int ret;
 
 	switch (div_id) {
 	case WM8350_ADC_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_ADC_DIVIDER) &
-		    ~WM8350_ADC_CLKDIV_MASK;
-		wm8350_codec_write(codec, WM8350_ADC_DIVIDER, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_ADC_DIVIDER,
+					     WM8350_ADC_CLKDIV_MASK, div);
 		break;
 	case WM8350_DAC_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_DAC_CLOCK_CONTROL) &
-		    ~WM8350_DAC_CLKDIV_MASK;
-		wm8350_codec_write(codec, WM8350_DAC_CLOCK_CONTROL, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_DAC_CLOCK_CONTROL,
+					     WM8350_DAC_CLKDIV_MASK, div);
 		break;
 	case WM8350_BCLK_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_CLOCK_CONTROL_1) &
-		    ~WM8350_BCLK_DIV_MASK;
-		wm8350_codec_write(codec, WM8350_CLOCK_CONTROL_1, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_CLOCK_CONTROL_1,
+					     WM8350_BCLK_DIV_MASK, div);
 		break;
 	case WM8350_OPCLK_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_CLOCK_CONTROL_1) &
-		    ~WM8350_OPCLK_DIV_MASK;
-		wm8350_codec_write(codec, WM8350_CLOCK_CONTROL_1, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_CLOCK_CONTROL_1,
+					     WM8350_OPCLK_DIV_MASK, div);
 		break;
 	case WM8350_SYS_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_CLOCK_CONTROL_1) &
-		    ~WM8350_MCLK_DIV_MASK;
-		wm8350_codec_write(codec, WM8350_CLOCK_CONTROL_1, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_CLOCK_CONTROL_1,
+					     WM8350_MCLK_DIV_MASK, div);
 		break;
 	case WM8350_DACLR_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_DAC_LR_RATE) &
-		    ~WM8350_DACLRC_RATE_MASK;
-		wm8350_codec_write(codec, WM8350_DAC_LR_RATE, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_DAC_LR_RATE,
+					     WM8350_DACLRC_RATE_MASK, div);
 		break;
 	case WM8350_ADCLR_CLKDIV:
-		val = wm8350_codec_read(codec, WM8350_ADC_LR_RATE) &
-		    ~WM8350_ADCLRC_RATE_MASK;
-		wm8350_codec_write(codec, WM8350_ADC_LR_RATE, val | div);
+		ret = wm8350_reg_update_bits(wm8350, WM8350_ADC_LR_RATE,
+					     WM8350_ADCLRC_RATE_MASK, div);
 		break;
 	default:
 		return -EINVAL;
 	}
 
-	return 0;
+	return ret;
 }
 
 static int wm8350_set_dai_fmt(struct snd_soc_dai *codec_dai, unsigned int fmt)
@@ -1103,7 +1023,6 @@ static int wm8350_set_fll(struct snd_soc_dai *codec_dai,
 	struct wm8350 *wm8350 = codec->control_data;
 	struct _fll_div fll_div;
 	int ret = 0;
-	u16 fll_1, fll_4;
 
 	/* power down FLL - we need to do this for reconfiguration */
 	wm8350_clear_bits(wm8350, WM8350_POWER_MGMT_4,
@@ -1121,19 +1040,19 @@ static int wm8350_set_fll(struct snd_soc_dai *codec_dai,
 		fll_div.ratio);
 
 	/* set up N.K & dividers */
-	fll_1 = wm8350_codec_read(codec, WM8350_FLL_CONTROL_1) &
-	    ~(WM8350_FLL_OUTDIV_MASK | WM8350_FLL_RSP_RATE_MASK | 0xc000);
-	wm8350_codec_write(codec, WM8350_FLL_CONTROL_1,
-			   fll_1 | (fll_div.div << 8) | 0x50);
+	wm8350_reg_update_bits(wm8350, WM8350_FLL_CONTROL_1,
+			       WM8350_FLL_OUTDIV_MASK |
+			       WM8350_FLL_RSP_RATE_MASK | 0xc000,
+			       (fll_div.div << 8) | 0x50);
 	wm8350_codec_write(codec, WM8350_FLL_CONTROL_2,
 			   (fll_div.ratio << 11) | (fll_div.
 						    n & WM8350_FLL_N_MASK));
 	wm8350_codec_write(codec, WM8350_FLL_CONTROL_3, fll_div.k);
-	fll_4 = wm8350_codec_read(codec, WM8350_FLL_CONTROL_4) &
-	    ~(WM8350_FLL_FRAC | WM8350_FLL_SLOW_LOCK_REF);
-	wm8350_codec_write(codec, WM8350_FLL_CONTROL_4,
-			   fll_4 | (fll_div.k ? WM8350_FLL_FRAC : 0) |
-			   (fll_div.ratio == 8 ? WM8350_FLL_SLOW_LOCK_REF : 0));
+	wm8350_reg_update_bits(wm8350, WM8350_FLL_CONTROL_4,
+			       WM8350_FLL_FRAC | WM8350_FLL_SLOW_LOCK_REF,
+			       (fll_div.k ? WM8350_FLL_FRAC : 0) |
+			       (fll_div.ratio == 8 ?
+				WM8350_FLL_SLOW_LOCK_REF : 0));
 
 	/* power FLL on */
 	wm8350_set_bits(wm8350, WM8350_POWER_MGMT_4, WM8350_FLL_OSC_ENA);
@@ -1154,22 +1073,24 @@ static int wm8350_set_bias_level(struct snd_soc_codec *codec,
 
 	switch (level) {
 	case SND_SOC_BIAS_ON:
-		pm1 = wm8350_reg_read(wm8350, WM8350_POWER_MGMT_1) &
-		    ~(WM8350_VMID_MASK | WM8350_CODEC_ISEL_MASK);
-		wm8350_reg_write(wm8350, WM8350_POWER_MGMT_1,
-				 pm1 | WM8350_VMID_50K |
-				 platform->codec_current_on << 14);
+		wm8350_reg_update_bits(wm8350, WM8350_POWER_MGMT_1,
+				       WM8350_VMID_MASK | WM8350_CODEC_ISEL_MASK,
+				       WM8350_VMID_50K |
+				       platform->codec_current_on << 14);
 		break;
 
 	case SND_SOC_BIAS_PREPARE:
-		pm1 = wm8350_reg_read(wm8350, WM8350_POWER_MGMT_1);
-		pm1 &= ~WM8350_VMID_MASK;
-		wm8350_reg_write(wm8350, WM8350_POWER_MGMT_1,
-				 pm1 | WM8350_VMID_50K);
+		wm8350_reg_update_bits(wm8350, WM8350_POWER_MGMT_1,
+				       WM8350_VMID_MASK, WM8350_VMID_50K);
 		break;
 
 	case SND_SOC_BIAS_STANDBY:
 		if (codec->bias_level == SND_SOC_BIAS_OFF) {
+			/* catch up with what changed while we were off */
+			ret = wm8350_audio_cache_sync(wm8350);
+			if (ret != 0)
+				return ret;
+
 			ret = regulator_bulk_enable(ARRAY_SIZE(priv->supplies),
 						    priv->supplies);
 			if (ret != 0)
@@ -1229,12 +1150,12 @@ static int wm8350_set_bias_level(struct snd_soc_codec *codec,
 
 		} else {
 			/* turn on vmid 300k and reduce current */
-			pm1 = wm8350_reg_read(wm8350, WM8350_POWER_MGMT_1) &
-			    ~(WM8350_VMID_MASK | WM8350_CODEC_ISEL_MASK);
-			wm8350_reg_write(wm8350, WM8350_POWER_MGMT_1,
-					 pm1 | WM8350_VMID_300K |
-					 (platform->
-					  codec_current_standby << 14));
+			wm8350_reg_update_bits(wm8350, WM8350_POWER_MGMT_1,
+					       WM8350_VMID_MASK |
+					       WM8350_CODEC_ISEL_MASK,
+					       WM8350_VMID_300K |
+					       (platform->
+						codec_current_standby << 14));
 
 		}
 		break;
@@ -1300,6 +1221,10 @@ static int wm8350_set_bias_level(struct snd_soc_codec *codec,
 
 		regulator_bulk_disable(ARRAY_SIZE(priv->supplies),
 				       priv->supplies);
+
+		/* the registers keep their values, but there's no point
+		 * writing them until we power up again */
+		wm8350_audio_cache_only(wm8350, 0);
 		break;
 	}
 	codec->bias_level = level;
@@ -1387,7 +1312,8 @@ static int wm8350_probe(struct platform_device *pdev)
 		return ret;
 	}
 
-	wm8350_add_controls(codec);
+	snd_soc_add_controls(codec, wm8350_snd_controls,
+			     ARRAY_SIZE(wm8350_snd_controls));
 	wm8350_add_widgets(codec);
 
 	wm8350_set_bias_level(codec, SND_SOC_BIAS_STANDBY);
@@ -1411,17 +1337,9 @@ static int wm8350_remove(struct platform_device *pdev)
 	struct snd_soc_device *socdev = platform_get_drvdata(pdev);
 	struct snd_soc_codec *codec = socdev->codec;
 	struct wm8350 *wm8350 = codec->control_data;
-	int ret;
-
-	/* cancel any work waiting to be queued. */
-	ret = cancel_delayed_work(&codec->delayed_work);
 
-	/* if there was any work waiting then we run it now and
-	 * wait for its completion */
-	if (ret) {
-		schedule_delayed_work(&codec->delayed_work, 0);
-		flush_scheduled_work();
-	}
+	/* stop any ramp in progress, the outputs are being powered off */
+	cancel_delayed_work_sync(&codec->delayed_work);
 
 	wm8350_set_bias_level(codec, SND_SOC_BIAS_OFF);
 
@@ -1502,6 +1420,7 @@ static int wm8350_codec_probe(struct platform_device *pdev)
 	wm8350_dai.dev = &pdev->dev;
 
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	codec->dev = &pdev->dev;
@@ -1509,6 +1428,9 @@ static int wm8350_codec_probe(struct platform_device *pdev)
 	codec->owner = THIS_MODULE;
 	codec->read = wm8350_codec_read;
 	codec->write = wm8350_codec_write;
+	codec->read_cache = wm8350_codec_cache_read;
+	codec->volatile_register = wm8350_codec_volatile_register;
+	codec->read_block = wm8350_codec_read_block;
 	codec->bias_level = SND_SOC_BIAS_OFF;
 	codec->set_bias_level = wm8350_set_bias_level;
 	codec->dai = &wm8350_dai;
@@ -1001,6 +1001,7 @@ static int wm8580_probe(struct platform_device *pdev)
 	codec->private_data = wm8580;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	wm8580_socdev = socdev;
@@ -56,24 +56,13 @@ static const u16 wm8731_reg[WM8731_CACHEREGNUM] = {
 static inline unsigned int wm8731_read_reg_cache(struct snd_soc_codec *codec,
 	unsigned int reg)
 {
-	u16 *cache = codec->reg_cache;
+	unsigned int value;
+
 	if (reg == WM8731_RESET)
 		return 0;
-	if (reg >= WM8731_CACHEREGNUM)
+	if (snd_soc_cache_read(codec, reg, &value) < 0)
 		return -1;
-	return cache[reg];
-}
-
-/*
- * write wm8731 register cache
- */
-static inline void wm8731_write_reg_cache(struct snd_soc_codec *codec,
-	u16 reg, unsigned int value)
-{
-	u16 *cache = codec->reg_cache;
-	if (reg >= WM8731_CACHEREGNUM)
-		return;
-	cache[reg] = value;
+	return value;
 }
 
 /*
@@ -84,6 +73,10 @@ static int wm8731_write(struct snd_soc_codec *codec, unsigned int reg,
 {
 	u8 data[2];
 
+	snd_soc_cache_write(codec, reg, value);
+	if (codec->cache_only)
+		return 0;
+
 	/* data is
 	 *   D15..D9 WM8731 register offset
 	 *   D8...D0 register data
@@ -91,7 +84,6 @@ static int wm8731_write(struct snd_soc_codec *codec, unsigned int reg,
 	data[0] = (reg << 1) | ((value >> 8) & 0x0001);
 	data[1] = value & 0x00ff;
 
-	wm8731_write_reg_cache(codec, reg, value);
 	if (codec->hw_write(codec->control_data, data, 2) == 2)
 		return 0;
 	else
@@ -478,6 +470,9 @@ static int wm8731_suspend(struct platform_device *pdev, pm_message_t state)
 
 	wm8731_write(codec, WM8731_ACTIVE, 0x0);
 	wm8731_set_bias_level(codec, SND_SOC_BIAS_OFF);
+
+	/* the supplies may be removed, hold writes until resume */
+	codec->cache_only = 1;
 	return 0;
 }
 
@@ -485,16 +480,9 @@ static int wm8731_resume(struct platform_device *pdev)
 {
 	struct snd_soc_device *socdev = platform_get_drvdata(pdev);
 	struct snd_soc_codec *codec = socdev->codec;
-	int i;
-	u8 data[2];
-	u16 *cache = codec->reg_cache;
 
 	/* Sync reg_cache with the hardware */
-	for (i = 0; i < ARRAY_SIZE(wm8731_reg); i++) {
-		data[0] = (i << 1) | ((cache[i] >> 8) & 0x0001);
-		data[1] = cache[i] & 0x00ff;
-		codec->hw_write(codec->control_data, data, 2);
-	}
+	snd_soc_cache_sync(codec);
 	wm8731_set_bias_level(codec, SND_SOC_BIAS_STANDBY);
 	wm8731_set_bias_level(codec, codec->suspend_bias_level);
 	return 0;
@@ -516,10 +504,10 @@ static int wm8731_init(struct snd_soc_device *socdev)
 	codec->set_bias_level = wm8731_set_bias_level;
 	codec->dai = &wm8731_dai;
 	codec->num_dai = 1;
-	codec->reg_cache_size = ARRAY_SIZE(wm8731_reg);
-	codec->reg_cache = kmemdup(wm8731_reg, sizeof(wm8731_reg), GFP_KERNEL);
-	if (codec->reg_cache == NULL)
-		return -ENOMEM;
+	ret = snd_soc_cache_init_flat(codec, wm8731_reg,
+				      ARRAY_SIZE(wm8731_reg));
+	if (ret < 0)
+		return ret;
 
 	wm8731_reset(codec);
 
@@ -557,7 +545,7 @@ card_err:
 	snd_soc_free_pcms(socdev);
 	snd_soc_dapm_free(socdev);
 pcm_err:
-	kfree(codec->reg_cache);
+	snd_soc_cache_exit(codec);
 	return ret;
 }
 
@@ -592,7 +580,7 @@ static int wm8731_i2c_probe(struct i2c_client *i2c,
 static int wm8731_i2c_remove(struct i2c_client *client)
 {
 	struct snd_soc_codec *codec = i2c_get_clientdata(client);
-	kfree(codec->reg_cache);
+	snd_soc_cache_exit(codec);
 	return 0;
 }
 
@@ -654,6 +642,29 @@ err_driver:
 #endif
 
 #if defined(CONFIG_SPI_MASTER)
+/* write back a run of the cache in one SPI message */
+static int wm8731_spi_write_block(struct snd_soc_codec *codec,
+				  unsigned int reg, const u16 *values,
+				  int count)
+{
+	u8 *data;
+	int i, ret;
+
+	data = kmalloc(count * 2, GFP_KERNEL);
+	if (data == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		data[i * 2] = ((reg + i) << 1) | ((values[i] >> 8) & 0x0001);
+		data[i * 2 + 1] = values[i] & 0x00ff;
+	}
+
+	ret = spi_write_regs(codec->control_data, data, 2, count);
+
+	kfree(data);
+	return ret;
+}
+
 static int __devinit wm8731_spi_probe(struct spi_device *spi)
 {
 	struct snd_soc_device *socdev = wm8731_socdev;
@@ -661,6 +672,7 @@ static int __devinit wm8731_spi_probe(struct spi_device *spi)
 	int ret;
 
 	codec->control_data = spi;
+	codec->write_block = wm8731_spi_write_block;
 
 	ret = wm8731_init(socdev);
 	if (ret < 0)
@@ -733,6 +745,7 @@ static int wm8731_probe(struct platform_device *pdev)
 	codec->private_data = wm8731;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
@@ -779,6 +792,7 @@ static int wm8731_remove(struct platform_device *pdev)
 #if defined(CONFIG_SPI_MASTER)
 	spi_unregister_driver(&wm8731_spi_driver);
 #endif
+	snd_soc_cache_exit(codec);
 	kfree(codec->private_data);
 	kfree(codec);
 
@@ -1005,6 +1005,7 @@ static int wm8750_probe(struct platform_device *pdev)
 	codec->private_data = wm8750;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	wm8750_socdev = socdev;
@@ -1458,6 +1458,7 @@ static void wm8753_set_dai_mode(struct snd_soc_codec *codec, unsigned int mode)
 {
 	if (mode < 4) {
 		int playback_active, capture_active, codec_active, pop_wait;
+		unsigned long pop_expires;
 		void *private_data;
 
 		playback_active = wm8753_dai[0].playback.active;
@@ -1465,24 +1466,28 @@ static void wm8753_set_dai_mode(struct snd_soc_codec *codec, unsigned int mode)
 		codec_active = wm8753_dai[0].active;
 		private_data = wm8753_dai[0].private_data;
 		pop_wait = wm8753_dai[0].pop_wait;
+		pop_expires = wm8753_dai[0].pop_expires;
 		wm8753_dai[0] = wm8753_all_dai[mode << 1];
 		wm8753_dai[0].playback.active = playback_active;
 		wm8753_dai[0].capture.active = capture_active;
 		wm8753_dai[0].active = codec_active;
 		wm8753_dai[0].private_data = private_data;
 		wm8753_dai[0].pop_wait = pop_wait;
+		wm8753_dai[0].pop_expires = pop_expires;
 
 		playback_active = wm8753_dai[1].playback.active;
 		capture_active = wm8753_dai[1].capture.active;
 		codec_active = wm8753_dai[1].active;
 		private_data = wm8753_dai[1].private_data;
 		pop_wait = wm8753_dai[1].pop_wait;
+		pop_expires = wm8753_dai[1].pop_expires;
 		wm8753_dai[1] = wm8753_all_dai[(mode << 1) + 1];
 		wm8753_dai[1].playback.active = playback_active;
 		wm8753_dai[1].capture.active = capture_active;
 		wm8753_dai[1].active = codec_active;
 		wm8753_dai[1].private_data = private_data;
 		wm8753_dai[1].pop_wait = pop_wait;
+		wm8753_dai[1].pop_expires = pop_expires;
 	}
 	wm8753_dai[0].codec = codec;
 	wm8753_dai[1].codec = codec;
@@ -1796,6 +1801,7 @@ static int wm8753_probe(struct platform_device *pdev)
 	codec->private_data = wm8753;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	wm8753_socdev = socdev;
@@ -1306,6 +1306,7 @@ static int wm8900_i2c_probe(struct i2c_client *i2c,
 	codec->reg_cache_size = WM8900_MAXREG;
 
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
@@ -13,13 +13,18 @@
  *  - TDM mode configuration.
  *  - Mic detect.
  *  - Digital microphone support.
- *  - Interrupt support (mic detect and sequencer).
+ *  - Mic detect interrupt.
  */
 
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/init.h>
 #include <linux/delay.h>
+#include <linux/completion.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 #include <linux/pm.h>
 #include <linux/i2c.h>
 #include <linux/platform_device.h>
@@ -218,12 +223,18 @@ struct wm8903_priv {
 
 	/* Reference counts */
 	int charge_pump_users;
+	ktime_t charge_pump_ready;	/* when the charge pump has settled */
 	int class_w_users;
 	int playback_active;
 	int capture_active;
 
 	struct snd_pcm_substream *master_substream;
 	struct snd_pcm_substream *slave_substream;
+
+	/* write sequencer completion, signalled by the IRQ if wired up */
+	int irq;
+	struct completion wseq;
+	struct work_struct irq_work;
 };
 
 
@@ -316,13 +327,56 @@ static int wm8903_write(struct snd_soc_codec *codec, unsigned int reg,
 		return -EIO;
 }
 
+/*
+ * The status register can only be read over I2C so the interrupt is
+ * handled from a workqueue with the line disabled meanwhile.  Reading
+ * the status acknowledges it.
+ */
+static void wm8903_irq_work(struct work_struct *work)
+{
+	struct wm8903_priv *wm8903 = container_of(work, struct wm8903_priv,
+						  irq_work);
+	struct snd_soc_codec *codec = &wm8903->codec;
+	int mask, val;
+
+	mask = ~wm8903_read(codec, WM8903_INTERRUPT_STATUS_1_MASK);
+	val = wm8903_read(codec, WM8903_INTERRUPT_STATUS_1) & mask;
+
+	if (val & WM8903_WSEQ_BUSY_EINT)
+		complete(&wm8903->wseq);
+
+	enable_irq(wm8903->irq);
+}
+
+static irqreturn_t wm8903_irq(int irq, void *data)
+{
+	struct wm8903_priv *wm8903 = data;
+
+	disable_irq_nosync(irq);
+	schedule_work(&wm8903->irq_work);
+
+	return IRQ_HANDLED;
+}
+
 static int wm8903_run_sequence(struct snd_soc_codec *codec, unsigned int start)
 {
 	u16 reg[5];
 	struct i2c_client *i2c = codec->control_data;
+	struct wm8903_priv *wm8903 = codec->private_data;
+	unsigned long timeout = 1;
 
 	BUG_ON(start > 48);
 
+	/* A reset masks the interrupt again */
+	if (wm8903->irq) {
+		reg[0] = wm8903_read(codec, WM8903_INTERRUPT_STATUS_1_MASK);
+		if (reg[0] & WM8903_IM_WSEQ_BUSY_EINT)
+			wm8903_write(codec, WM8903_INTERRUPT_STATUS_1_MASK,
+				     reg[0] & ~WM8903_IM_WSEQ_BUSY_EINT);
+	}
+
+	INIT_COMPLETION(wm8903->wseq);
+
 	/* Enable the sequencer */
 	reg[0] = wm8903_read(codec, WM8903_WRITE_SEQUENCER_0);
 	reg[0] |= WM8903_WSEQ_ENA;
@@ -333,12 +387,13 @@ static int wm8903_run_sequence(struct snd_soc_codec *codec, unsigned int start)
 	wm8903_write(codec, WM8903_WRITE_SEQUENCER_3,
 		     start | WM8903_WSEQ_START);
 
-	/* Wait for it to complete.  If we have the interrupt wired up then
-	 * we could block waiting for an interrupt, though polling may still
-	 * be desirable for diagnostic purposes.
+	/* Wait for it to complete.  With the interrupt wired up we are
+	 * woken as soon as it does, otherwise poll starting from a single
+	 * tick and backing off to 10ms since most sequences are short.
 	 */
 	do {
-		msleep(10);
+		wait_for_completion_timeout(&wm8903->wseq, timeout);
+		timeout = min(timeout * 2, msecs_to_jiffies(10));
 
 		reg[4] = wm8903_read(codec, WM8903_WRITE_SEQUENCER_4);
 	} while (reg[4] & WM8903_WSEQ_BUSY);
@@ -373,52 +428,92 @@ static void wm8903_reset(struct snd_soc_codec *codec)
 #define WM8903_OUTPUT_INT   0x2
 #define WM8903_OUTPUT_IN    0x1
 
-/*
- * Event for headphone and line out amplifier power changes.  Special
- * power up/down sequences are required in order to maximise pop/click
- * performance.
- */
-static int wm8903_output_event(struct snd_soc_dapm_widget *w,
-			       struct snd_kcontrol *kcontrol, int event)
+/* register holding the output stage bits for an output PGA widget */
+static int wm8903_output_reg(struct snd_soc_dapm_widget *w)
 {
-	struct snd_soc_codec *codec = w->codec;
-	struct wm8903_priv *wm8903 = codec->private_data;
-	struct i2c_client *i2c = codec->control_data;
-	u16 val;
-	u16 reg;
-	int shift;
-	u16 cp_reg = wm8903_read(codec, WM8903_CHARGE_PUMP_0);
-
 	switch (w->reg) {
 	case WM8903_POWER_MANAGEMENT_2:
-		reg = WM8903_ANALOGUE_HP_0;
-		break;
+		return WM8903_ANALOGUE_HP_0;
 	case WM8903_POWER_MANAGEMENT_3:
-		reg = WM8903_ANALOGUE_LINEOUT_0;
-		break;
+		return WM8903_ANALOGUE_LINEOUT_0;
 	default:
 		BUG();
 		return -EINVAL;  /* Spurious warning from some compilers */
 	}
+}
 
+/* the left output stage bits are above the right ones */
+static int wm8903_output_shift(struct snd_soc_dapm_widget *w)
+{
 	switch (w->shift) {
 	case 0:
-		shift = 0;
-		break;
+		return 0;
 	case 1:
-		shift = 4;
-		break;
+		return 4;
 	default:
 		BUG();
 		return -EINVAL;  /* Spurious warning from some compilers */
 	}
+}
 
-	if (event & SND_SOC_DAPM_PRE_PMU) {
-		val = wm8903_read(codec, reg);
+static int wm8903_output_event(struct snd_soc_dapm_widget *w,
+			       struct snd_kcontrol *kcontrol, int event);
 
-		/* Short the output */
-		val &= ~(WM8903_OUTPUT_SHORT << shift);
-		wm8903_write(codec, reg, val);
+/*
+ * The output stage bits for all the outputs sharing a register with w
+ * that are being powered the same way, so that left and right can be
+ * sequenced together.  All the PRE events of a power step run before
+ * any of the POST events so by the time of POST_PMU the siblings have
+ * been shorted and have their charge pump reference.
+ */
+static u16 wm8903_output_stages(struct snd_soc_dapm_widget *w, u16 stage)
+{
+	struct snd_soc_dapm_widget *o;
+	u16 val = 0;
+
+	list_for_each_entry(o, &w->codec->dapm_widgets, list)
+		if (o->event == wm8903_output_event && o->reg == w->reg &&
+		    o->power == w->power)
+			val |= stage << wm8903_output_shift(o);
+
+	return val;
+}
+
+/*
+ * Sleep until the charge pump enabled by the first output has settled.
+ * The wait is left until POST_PMU so the power register writes of the
+ * step happen while it settles.
+ */
+static void wm8903_charge_pump_wait(struct wm8903_priv *wm8903)
+{
+	ktime_t ready = wm8903->charge_pump_ready;
+
+	if (ktime_to_ns(ktime_sub(ready, ktime_get())) <= 0)
+		return;
+
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&ready, HRTIMER_MODE_ABS);
+}
+
+/*
+ * Event for headphone and line out amplifier power changes.  Special
+ * power up/down sequences are required in order to maximise pop/click
+ * performance.
+ */
+static int wm8903_output_event(struct snd_soc_dapm_widget *w,
+			       struct snd_kcontrol *kcontrol, int event)
+{
+	struct snd_soc_codec *codec = w->codec;
+	struct wm8903_priv *wm8903 = codec->private_data;
+	struct i2c_client *i2c = codec->control_data;
+	int reg = wm8903_output_reg(w);
+	int shift = wm8903_output_shift(w);
+	u16 val;
+
+	if (event & SND_SOC_DAPM_PRE_PMU) {
+		/* Short the output, only this one since a sibling may
+		 * already be running */
+		snd_soc_update_bits(codec, reg, WM8903_OUTPUT_SHORT << shift, 0);
 
 		wm8903->charge_pump_users++;
 
@@ -427,41 +522,44 @@ static int wm8903_output_event(struct snd_soc_dapm_widget *w,
 
 		if (wm8903->charge_pump_users == 1) {
 			dev_dbg(&i2c->dev, "Enabling charge pump\n");
-			wm8903_write(codec, WM8903_CHARGE_PUMP_0,
-				     cp_reg | WM8903_CP_ENA);
-			mdelay(4);
+			snd_soc_update_bits(codec, WM8903_CHARGE_PUMP_0,
+					    WM8903_CP_ENA, WM8903_CP_ENA);
+			wm8903->charge_pump_ready = ktime_add_us(ktime_get(),
+								 4000);
 		}
 	}
 
 	if (event & SND_SOC_DAPM_POST_PMU) {
-		val = wm8903_read(codec, reg);
+		wm8903_charge_pump_wait(wm8903);
 
-		val |= (WM8903_OUTPUT_IN << shift);
-		wm8903_write(codec, reg, val);
+		/* Bring up the input, intermediate and output stages in
+		 * turn then remove the short.  Siblings done here make
+		 * their own event a no-op. */
+		val = wm8903_output_stages(w, WM8903_OUTPUT_IN);
+		snd_soc_update_bits(codec, reg, val, val);
 
-		val |= (WM8903_OUTPUT_INT << shift);
-		wm8903_write(codec, reg, val);
+		val = wm8903_output_stages(w, WM8903_OUTPUT_INT);
+		snd_soc_update_bits(codec, reg, val, val);
 
 		/* Turn on the output ENA_OUTP */
-		val |= (WM8903_OUTPUT_OUT << shift);
-		wm8903_write(codec, reg, val);
+		val = wm8903_output_stages(w, WM8903_OUTPUT_OUT);
+		snd_soc_update_bits(codec, reg, val, val);
 
 		/* Remove the short */
-		val |= (WM8903_OUTPUT_SHORT << shift);
-		wm8903_write(codec, reg, val);
+		val = wm8903_output_stages(w, WM8903_OUTPUT_SHORT);
+		snd_soc_update_bits(codec, reg, val, val);
 	}
 
 	if (event & SND_SOC_DAPM_PRE_PMD) {
-		val = wm8903_read(codec, reg);
-
 		/* Short the output */
-		val &= ~(WM8903_OUTPUT_SHORT << shift);
-		wm8903_write(codec, reg, val);
+		val = wm8903_output_stages(w, WM8903_OUTPUT_SHORT);
+		snd_soc_update_bits(codec, reg, val, 0);
 
 		/* Then disable the intermediate and output stages */
-		val &= ~((WM8903_OUTPUT_OUT | WM8903_OUTPUT_INT |
-			  WM8903_OUTPUT_IN) << shift);
-		wm8903_write(codec, reg, val);
+		val = wm8903_output_stages(w, WM8903_OUTPUT_OUT |
+					   WM8903_OUTPUT_INT |
+					   WM8903_OUTPUT_IN);
+		snd_soc_update_bits(codec, reg, val, 0);
 	}
 
 	if (event & SND_SOC_DAPM_POST_PMD) {
@@ -472,8 +570,8 @@ static int wm8903_output_event(struct snd_soc_dapm_widget *w,
 
 		if (wm8903->charge_pump_users == 0) {
 			dev_dbg(&i2c->dev, "Disabling charge pump\n");
-			wm8903_write(codec, WM8903_CHARGE_PUMP_0,
-				     cp_reg & ~WM8903_CP_ENA);
+			snd_soc_update_bits(codec, WM8903_CHARGE_PUMP_0,
+					    WM8903_CP_ENA, 0);
 		}
 	}
 
@@ -1592,6 +1690,7 @@ static int wm8903_i2c_probe(struct i2c_client *i2c,
 	codec = &wm8903->codec;
 
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 
@@ -1609,6 +1708,9 @@ static int wm8903_i2c_probe(struct i2c_client *i2c,
 	codec->reg_cache = &wm8903->reg_cache[0];
 	codec->private_data = wm8903;
 
+	init_completion(&wm8903->wseq);
+	INIT_WORK(&wm8903->irq_work, wm8903_irq_work);
+
 	i2c_set_clientdata(i2c, codec);
 	codec->control_data = i2c;
 
@@ -1625,6 +1727,18 @@ static int wm8903_i2c_probe(struct i2c_client *i2c,
 
 	wm8903_reset(codec);
 
+	/* The IRQ output defaults to active high */
+	if (i2c->irq) {
+		ret = request_irq(i2c->irq, wm8903_irq, IRQF_TRIGGER_HIGH,
+				  "wm8903", wm8903);
+		if (ret == 0)
+			wm8903->irq = i2c->irq;
+		else
+			dev_warn(&i2c->dev, "Failed to request IRQ %d: %d, "
+				 "polling the write sequencer\n",
+				 i2c->irq, ret);
+	}
+
 	/* power on device */
 	wm8903_set_bias_level(codec, SND_SOC_BIAS_STANDBY);
 
@@ -1679,6 +1793,10 @@ static int wm8903_i2c_probe(struct i2c_client *i2c,
 err_codec:
 	snd_soc_unregister_codec(codec);
 err:
+	if (wm8903->irq) {
+		free_irq(wm8903->irq, wm8903);
+		cancel_work_sync(&wm8903->irq_work);
+	}
 	wm8903_codec = NULL;
 	kfree(wm8903);
 	return ret;
@@ -1687,12 +1805,18 @@ err:
 static int wm8903_i2c_remove(struct i2c_client *client)
 {
 	struct snd_soc_codec *codec = i2c_get_clientdata(client);
+	struct wm8903_priv *wm8903 = codec->private_data;
 
 	snd_soc_unregister_dai(&wm8903_dai);
 	snd_soc_unregister_codec(codec);
 
 	wm8903_set_bias_level(codec, SND_SOC_BIAS_OFF);
 
+	if (wm8903->irq) {
+		free_irq(wm8903->irq, wm8903);
+		cancel_work_sync(&wm8903->irq_work);
+	}
+
 	kfree(codec->private_data);
 
 	wm8903_codec = NULL;
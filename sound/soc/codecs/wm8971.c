@@ -875,6 +875,7 @@ static int wm8971_probe(struct platform_device *pdev)
 	codec->private_data = wm8971;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	wm8971_socdev = socdev;
@@ -1595,6 +1595,7 @@ static int wm8990_probe(struct platform_device *pdev)
 	codec->private_data = wm8990;
 	socdev->codec = codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 	INIT_LIST_HEAD(&codec->dapm_widgets);
 	INIT_LIST_HEAD(&codec->dapm_paths);
 	wm8990_socdev = socdev;
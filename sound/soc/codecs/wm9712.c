@@ -657,6 +657,7 @@ static int wm9712_soc_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	codec = socdev->codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->reg_cache = kmemdup(wm9712_reg, sizeof(wm9712_reg), GFP_KERNEL);
 
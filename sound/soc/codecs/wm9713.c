@@ -1196,6 +1196,7 @@ static int wm9713_soc_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	codec = socdev->codec;
 	mutex_init(&codec->mutex);
+	mutex_init(&codec->io_mutex);
 
 	codec->reg_cache = kmemdup(wm9713_reg, sizeof(wm9713_reg), GFP_KERNEL);
 	if (codec->reg_cache == NULL) {
@@ -0,0 +1,307 @@
+/*
+ * soc-cache.c  --  ALSA SoC register cache helpers
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ *  Most codecs can't be read back over their control bus, or are slow to
+ *  read, so they keep a copy of their registers.  These helpers provide
+ *  that copy along with the register defaults, allowing the cache to be
+ *  written back to the hardware with only the registers that need it
+ *  after the codec has been powered off.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/bitops.h>
+#include <sound/soc.h>
+
+struct snd_soc_cache {
+	enum snd_soc_cache_type type;
+	int num;			/* number of cached registers */
+	const void *defaults;		/* u16 or struct snd_soc_reg_default */
+	u16 *values;
+	unsigned long *dirty;		/* written while in cache only mode */
+};
+
+static int snd_soc_cache_alloc(struct snd_soc_codec *codec,
+			       enum snd_soc_cache_type type,
+			       const void *defaults, int num)
+{
+	struct snd_soc_cache *cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (cache == NULL)
+		return -ENOMEM;
+
+	cache->dirty = kzalloc(BITS_TO_LONGS(num) * sizeof(long), GFP_KERNEL);
+	if (cache->dirty == NULL) {
+		kfree(cache);
+		return -ENOMEM;
+	}
+
+	cache->type = type;
+	cache->num = num;
+	cache->defaults = defaults;
+	codec->cache = cache;
+
+	return 0;
+}
+
+/**
+ * snd_soc_cache_init_flat - set up a register cache for a dense map
+ * @codec: codec
+ * @defaults: register values after reset, indexed by register
+ * @num_regs: number of registers in @defaults
+ *
+ * The values are kept in codec->reg_cache as an array of u16 so drivers
+ * can continue to look at it directly.  @defaults must remain valid
+ * until snd_soc_cache_exit() is called.
+ */
+int snd_soc_cache_init_flat(struct snd_soc_codec *codec,
+			    const u16 *defaults, int num_regs)
+{
+	int ret;
+
+	ret = snd_soc_cache_alloc(codec, SND_SOC_CACHE_FLAT, defaults,
+				  num_regs);
+	if (ret != 0)
+		return ret;
+
+	codec->cache->values = kmemdup(defaults, num_regs * sizeof(u16),
+				       GFP_KERNEL);
+	if (codec->cache->values == NULL) {
+		snd_soc_cache_exit(codec);
+		return -ENOMEM;
+	}
+
+	codec->reg_cache = codec->cache->values;
+	if (!codec->reg_cache_size)
+		codec->reg_cache_size = num_regs;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_init_flat);
+
+/**
+ * snd_soc_cache_init_sparse - set up a register cache for a sparse map
+ * @codec: codec
+ * @defaults: registers to cache and their values after reset, sorted
+ *            by register
+ * @num: number of entries in @defaults
+ *
+ * Only the registers listed in @defaults are cached.  @defaults must
+ * remain valid until snd_soc_cache_exit() is called.
+ */
+int snd_soc_cache_init_sparse(struct snd_soc_codec *codec,
+			      const struct snd_soc_reg_default *defaults,
+			      int num)
+{
+	int i, ret;
+
+	ret = snd_soc_cache_alloc(codec, SND_SOC_CACHE_SPARSE, defaults, num);
+	if (ret != 0)
+		return ret;
+
+	codec->cache->values = kmalloc(num * sizeof(u16), GFP_KERNEL);
+	if (codec->cache->values == NULL) {
+		snd_soc_cache_exit(codec);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num; i++)
+		codec->cache->values[i] = defaults[i].def;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_init_sparse);
+
+/**
+ * snd_soc_cache_exit - free the codec register cache
+ * @codec: codec
+ */
+void snd_soc_cache_exit(struct snd_soc_codec *codec)
+{
+	struct snd_soc_cache *cache = codec->cache;
+
+	if (cache == NULL)
+		return;
+
+	if (codec->reg_cache == cache->values)
+		codec->reg_cache = NULL;
+
+	kfree(cache->values);
+	kfree(cache->dirty);
+	kfree(cache);
+	codec->cache = NULL;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_exit);
+
+static int snd_soc_cache_index(struct snd_soc_cache *cache, unsigned int reg)
+{
+	const struct snd_soc_reg_default *def = cache->defaults;
+	int min = 0, max = cache->num - 1, mid;
+
+	if (cache->type == SND_SOC_CACHE_FLAT)
+		return reg < cache->num ? reg : -1;
+
+	while (min <= max) {
+		mid = (min + max) / 2;
+		if (def[mid].reg == reg)
+			return mid;
+		if (def[mid].reg < reg)
+			min = mid + 1;
+		else
+			max = mid - 1;
+	}
+
+	return -1;
+}
+
+static unsigned int snd_soc_cache_reg(struct snd_soc_cache *cache, int idx)
+{
+	const struct snd_soc_reg_default *def = cache->defaults;
+
+	if (cache->type == SND_SOC_CACHE_FLAT)
+		return idx;
+	return def[idx].reg;
+}
+
+static u16 snd_soc_cache_default(struct snd_soc_cache *cache, int idx)
+{
+	const struct snd_soc_reg_default *def = cache->defaults;
+	const u16 *flat = cache->defaults;
+
+	if (cache->type == SND_SOC_CACHE_FLAT)
+		return flat[idx];
+	return def[idx].def;
+}
+
+/**
+ * snd_soc_cache_read - read a register from the cache
+ * @codec: codec
+ * @reg: register
+ * @value: the cached value
+ *
+ * Returns 0 on success or -ENOENT if the register is not cached.
+ */
+int snd_soc_cache_read(struct snd_soc_codec *codec, unsigned int reg,
+		       unsigned int *value)
+{
+	struct snd_soc_cache *cache = codec->cache;
+	int idx;
+
+	if (cache == NULL)
+		return -ENOENT;
+
+	idx = snd_soc_cache_index(cache, reg);
+	if (idx < 0)
+		return -ENOENT;
+
+	*value = cache->values[idx];
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_read);
+
+/**
+ * snd_soc_cache_write - update the cached value of a register
+ * @codec: codec
+ * @reg: register
+ * @value: new value
+ *
+ * Call from the codec write operation.  If the codec is in cache only
+ * mode (codec->cache_only) the write should go no further: the register
+ * is remembered and written by the next snd_soc_cache_sync().
+ *
+ * Returns 0 on success or -ENOENT if the register is not cached.
+ */
+int snd_soc_cache_write(struct snd_soc_codec *codec, unsigned int reg,
+			unsigned int value)
+{
+	struct snd_soc_cache *cache = codec->cache;
+	int idx;
+
+	if (cache == NULL)
+		return -ENOENT;
+
+	idx = snd_soc_cache_index(cache, reg);
+	if (idx < 0)
+		return -ENOENT;
+
+	cache->values[idx] = value;
+	if (codec->cache_only)
+		set_bit(idx, cache->dirty);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_write);
+
+/* does the register need writing back to hardware fresh out of reset */
+static int snd_soc_cache_needs_sync(struct snd_soc_cache *cache, int idx)
+{
+	return test_bit(idx, cache->dirty) ||
+		cache->values[idx] != snd_soc_cache_default(cache, idx);
+}
+
+/**
+ * snd_soc_cache_sync - write the register cache back to the hardware
+ * @codec: codec
+ *
+ * Takes the codec out of cache only mode and writes back every register
+ * holding something other than its default, plus any written while in
+ * cache only mode.  This restores a codec which has lost power or been
+ * reset.  Runs of adjacent registers are written with the codec's
+ * write_block() operation where it has one.
+ *
+ * Returns 0 on success, registers which failed to write will be written
+ * by the next sync.
+ */
+int snd_soc_cache_sync(struct snd_soc_codec *codec)
+{
+	struct snd_soc_cache *cache = codec->cache;
+	int i, start, ret;
+	unsigned int reg;
+
+	codec->cache_only = 0;
+
+	if (cache == NULL)
+		return 0;
+
+	i = 0;
+	while (i < cache->num) {
+		if (!snd_soc_cache_needs_sync(cache, i)) {
+			i++;
+			continue;
+		}
+
+		/* gather a run of adjacent registers for a block write */
+		start = i;
+		reg = snd_soc_cache_reg(cache, i);
+		for (i++; codec->write_block && i < cache->num; i++)
+			if (snd_soc_cache_reg(cache, i) != reg + i - start ||
+			    !snd_soc_cache_needs_sync(cache, i))
+				break;
+
+		if (codec->write_block)
+			ret = codec->write_block(codec, reg,
+						 &cache->values[start],
+						 i - start);
+		else
+			ret = snd_soc_write(codec, reg, cache->values[start]);
+		if (ret < 0) {
+			printk(KERN_ERR "asoc: %s: failed to sync register"
+			       " %x: %d\n", codec->name, reg, ret);
+			return ret;
+		}
+
+		for (; start < i; start++)
+			clear_bit(start, cache->dirty);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_cache_sync);
@@ -26,6 +26,7 @@
 #include <linux/delay.h>
 #include <linux/pm.h>
 #include <linux/bitops.h>
+#include <linux/math64.h>
 #include <linux/debugfs.h>
 #include <linux/platform_device.h>
 #include <sound/core.h>
@@ -36,9 +37,13 @@
 #include <sound/initval.h>
 
 static DEFINE_MUTEX(pcm_mutex);
-static DEFINE_MUTEX(io_mutex);
 static DECLARE_WAIT_QUEUE_HEAD(soc_pm_waitq);
 
+#ifdef CONFIG_PM
+/* cards resume here rather than holding up the shared workqueue */
+static struct workqueue_struct *soc_resume_wq;
+#endif
+
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *debugfs_root;
 #endif
@@ -61,25 +66,6 @@ static int pmdown_time = 5000;
 module_param(pmdown_time, int, 0);
 MODULE_PARM_DESC(pmdown_time, "DAPM stream powerdown time (msecs)");
 
-/*
- * This function forces any delayed work to be queued and run.
- */
-static int run_delayed_work(struct delayed_work *dwork)
-{
-	int ret;
-
-	/* cancel any work waiting to be queued. */
-	ret = cancel_delayed_work(dwork);
-
-	/* if there was any work waiting then we run it now and
-	 * wait for it's completion */
-	if (ret) {
-		schedule_delayed_work(dwork, 0);
-		flush_scheduled_work();
-	}
-	return ret;
-}
-
 #ifdef CONFIG_SND_SOC_AC97_BUS
 /* unregister ac97 codec */
 static int soc_ac97_dev_unregister(struct snd_soc_codec *codec)
@@ -113,6 +99,22 @@ static int soc_ac97_dev_register(struct snd_soc_codec *codec)
 }
 #endif
 
+/*
+ * Resume runs in the background after the system has woken (see
+ * soc_resume()), wait for it before touching the hardware.
+ */
+static int soc_wait_resume(struct snd_soc_device *socdev)
+{
+	struct snd_card *card = socdev->codec->card;
+	int ret;
+
+	snd_power_lock(card);
+	ret = snd_power_wait(card, SNDRV_CTL_POWER_D0);
+	snd_power_unlock(card);
+
+	return ret;
+}
+
 /*
  * Called by ALSA when a PCM substream is opened, the runtime->hw record is
  * then initialized and any private data can be allocated. This also calls
@@ -130,6 +132,10 @@ static int soc_pcm_open(struct snd_pcm_substream *substream)
 	struct snd_soc_dai *codec_dai = machine->codec_dai;
 	int ret = 0;
 
+	ret = soc_wait_resume(socdev);
+	if (ret < 0)
+		return ret;
+
 	mutex_lock(&pcm_mutex);
 
 	/* startup the audio subsystem */
@@ -255,20 +261,63 @@ out:
 }
 
 /*
- * Power down the audio subsystem pmdown_time msecs after close is called.
- * This is to ensure there are no pops or clicks in between any music tracks
- * due to DAPM power cycling.
+ * Time to wait after close before powering down a playback stream. A
+ * DAI's own pmdown_time overrides the codec's, which overrides the
+ * module parameter.
  */
-static void close_delayed_work(struct work_struct *work)
+static unsigned int soc_pmdown_time(struct snd_soc_codec *codec,
+				    struct snd_soc_dai *codec_dai)
+{
+	if (codec_dai->pmdown_time)
+		return codec_dai->pmdown_time;
+	if (codec->pmdown_time)
+		return codec->pmdown_time;
+	return pmdown_time;
+}
+
+/*
+ * (Re)arm the power down work for the first stream due to time out.
+ * Called with pcm_mutex held.
+ */
+static void soc_schedule_pmdown(struct snd_soc_card *card)
+{
+	struct snd_soc_codec *codec = card->socdev->codec;
+	unsigned long expires = 0;
+	int i, waiting = 0;
+
+	for (i = 0; i < codec->num_dai; i++) {
+		struct snd_soc_dai *codec_dai = &codec->dai[i];
+
+		if (!codec_dai->pop_wait)
+			continue;
+		if (!waiting || time_before(codec_dai->pop_expires, expires))
+			expires = codec_dai->pop_expires;
+		waiting = 1;
+	}
+
+	cancel_delayed_work(&card->delayed_work);
+	if (!waiting)
+		return;
+
+	if (time_after(expires, jiffies))
+		schedule_delayed_work(&card->delayed_work, expires - jiffies);
+	else
+		schedule_delayed_work(&card->delayed_work, 0);
+}
+
+/*
+ * Power down the playback streams whose pmdown_time has expired since
+ * they were closed, or all waiting streams if force is set. This is to
+ * ensure there are no pops or clicks in between any music tracks due to
+ * DAPM power cycling. Called with pcm_mutex held.
+ */
+static void soc_pmdown(struct snd_soc_card *card, int force)
 {
-	struct snd_soc_card *card = container_of(work, struct snd_soc_card,
-						 delayed_work.work);
 	struct snd_soc_device *socdev = card->socdev;
 	struct snd_soc_codec *codec = socdev->codec;
 	struct snd_soc_dai *codec_dai;
 	int i;
 
-	mutex_lock(&pcm_mutex);
 	for (i = 0; i < codec->num_dai; i++) {
 		codec_dai = &codec->dai[i];
 
@@ -278,7 +327,8 @@ static void close_delayed_work(struct work_struct *work)
 			 codec_dai->pop_wait ? "yes" : "no");
 
 		/* are we waiting on this codec DAI stream */
-		if (codec_dai->pop_wait == 1) {
+		if (codec_dai->pop_wait == 1 &&
+		    (force || !time_before(jiffies, codec_dai->pop_expires))) {
 
 			/* Reduce power if no longer active */
 			if (codec->active == 0) {
@@ -302,6 +352,28 @@ static void close_delayed_work(struct work_struct *work)
 			}
 		}
 	}
+}
+
+static void close_delayed_work(struct work_struct *work)
+{
+	struct snd_soc_card *card = container_of(work, struct snd_soc_card,
+						 delayed_work.work);
+
+	mutex_lock(&pcm_mutex);
+	soc_pmdown(card, 0);
+	soc_schedule_pmdown(card);
+	mutex_unlock(&pcm_mutex);
+}
+
+/*
+ * Power down any streams still waiting for their timeout immediately.
+ */
+static void soc_flush_pmdown(struct snd_soc_card *card)
+{
+	cancel_delayed_work_sync(&card->delayed_work);
+
+	mutex_lock(&pcm_mutex);
+	soc_pmdown(card, 1);
 	mutex_unlock(&pcm_mutex);
 }
 
@@ -356,8 +428,9 @@ static int soc_codec_close(struct snd_pcm_substream *substream)
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		/* start delayed pop wq here for playback streams */
 		codec_dai->pop_wait = 1;
-		schedule_delayed_work(&card->delayed_work,
-			msecs_to_jiffies(pmdown_time));
+		codec_dai->pop_expires = jiffies +
+			msecs_to_jiffies(soc_pmdown_time(codec, codec_dai));
+		soc_schedule_pmdown(card);
 	} else {
 		/* capture streams can be powered down now */
 		snd_soc_dapm_stream_event(codec,
@@ -428,7 +501,14 @@ static int soc_pcm_prepare(struct snd_pcm_substream *substream)
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 	    codec_dai->pop_wait) {
 		codec_dai->pop_wait = 0;
-		cancel_delayed_work(&card->delayed_work);
+		soc_schedule_pmdown(card);
+
+		/* reopened within the timeout, the path is still powered
+		 * so there is nothing for DAPM to do */
+		if (codec->bias_level == SND_SOC_BIAS_ON) {
+			snd_soc_dai_digital_mute(codec_dai, 0);
+			goto out;
+		}
 	}
 
 	/* do we need to power up codec */
@@ -484,6 +564,10 @@ static int soc_pcm_hw_params(struct snd_pcm_substream *substream,
 	struct snd_soc_dai *codec_dai = machine->codec_dai;
 	int ret = 0;
 
+	ret = soc_wait_resume(socdev);
+	if (ret < 0)
+		return ret;
+
 	mutex_lock(&pcm_mutex);
 
 	if (machine->ops && machine->ops->hw_params) {
@@ -665,9 +749,10 @@ static int soc_suspend(struct platform_device *pdev, pm_message_t state)
 	}
 
 	/* close any waiting streams and save state */
-	run_delayed_work(&card->delayed_work);
+	soc_flush_pmdown(card);
 	codec->suspend_bias_level = codec->bias_level;
 
+	snd_soc_dapm_begin(codec);
 	for (i = 0; i < codec->num_dai; i++) {
 		char *stream = codec->dai[i].playback.stream_name;
 		if (stream != NULL)
@@ -678,6 +763,7 @@ static int soc_suspend(struct platform_device *pdev, pm_message_t state)
 			snd_soc_dapm_stream_event(codec, stream,
 				SND_SOC_DAPM_STREAM_SUSPEND);
 	}
+	snd_soc_dapm_end(codec);
 
 	if (codec_dev->suspend)
 		codec_dev->suspend(pdev, state);
@@ -727,6 +813,7 @@ static void soc_resume_deferred(struct work_struct *work)
 	if (codec_dev->resume)
 		codec_dev->resume(pdev);
 
+	snd_soc_dapm_begin(codec);
 	for (i = 0; i < codec->num_dai; i++) {
 		char *stream = codec->dai[i].playback.stream_name;
 		if (stream != NULL)
@@ -737,6 +824,7 @@ static void soc_resume_deferred(struct work_struct *work)
 			snd_soc_dapm_stream_event(codec, stream,
 				SND_SOC_DAPM_STREAM_RESUME);
 	}
+	snd_soc_dapm_end(codec);
 
 	/* unmute any active DACs */
 	for (i = 0; i < card->num_links; i++) {
@@ -770,7 +858,11 @@ static int soc_resume(struct platform_device *pdev)
 
 	dev_dbg(socdev->dev, "scheduling resume work\n");
 
-	if (!schedule_work(&card->deferred_resume_work))
+	/* Restoring the codec can take hundreds of milliseconds over I2C
+	 * with the bias ramps, so let the rest of the system carry on
+	 * resuming. Userspace is held off until we're back in D0.
+	 */
+	if (!queue_work(soc_resume_wq, &card->deferred_resume_work))
 		dev_err(socdev->dev, "resume work item may be lost\n");
 
 	return 0;
@@ -944,7 +1036,11 @@ static int soc_remove(struct platform_device *pdev)
 	struct snd_soc_platform *platform = card->platform;
 	struct snd_soc_codec_device *codec_dev = socdev->codec_dev;
 
-	run_delayed_work(&card->delayed_work);
+#ifdef CONFIG_PM
+	/* let any resume in progress complete */
+	flush_workqueue(soc_resume_wq);
+#endif
+	soc_flush_pmdown(card);
 
 	if (platform->remove)
 		platform->remove(pdev);
@@ -1047,45 +1143,183 @@ static int soc_new_pcm(struct snd_soc_device *socdev,
 	return ret;
 }
 
-/* codec register dump */
-static ssize_t soc_codec_reg_show(struct snd_soc_device *devdata, char *buf)
+/*
+ * Codec register dump.  Each register gets a line of the same length, so
+ * the line for any file offset is found without formatting the ones
+ * before it, and only the registers actually read are fetched from the
+ * codec: from its cache where possible, and with the codec's read_block()
+ * operation for runs of volatile registers.  Monitoring tools can sample
+ * a few registers, and lengthy register maps are dumped a page at a time.
+ */
+
+/* registers fetched from the codec at once */
+#define SOC_CODEC_REG_CHUNK	32
+
+/* width of the value field given to display_register() */
+#define SOC_CODEC_REG_DISPLAY_WIDTH	16
+
+static int soc_codec_reg_step(struct snd_soc_codec *codec)
+{
+	return codec->reg_cache_step ? codec->reg_cache_step : 1;
+}
+
+static int soc_codec_reg_header_len(struct snd_soc_codec *codec)
+{
+	return strlen(codec->name) + sizeof(" registers\n") - 1;
+}
+
+static int soc_codec_reg_width(struct snd_soc_codec *codec)
+{
+	int width = 2;
+
+	while (codec->reg_cache_size - 1 >= 1 << (width * 4))
+		width++;
+
+	return width;
+}
+
+static int soc_codec_reg_value_width(struct snd_soc_codec *codec)
+{
+	return codec->display_register ? SOC_CODEC_REG_DISPLAY_WIDTH : 4;
+}
+
+/* "reg: value\n" */
+static int soc_codec_reg_line_len(struct snd_soc_codec *codec)
 {
-	struct snd_soc_codec *codec = devdata->codec;
-	int i, step = 1, count = 0;
+	return soc_codec_reg_width(codec) + 2 +
+		soc_codec_reg_value_width(codec) + 1;
+}
 
-	if (!codec->reg_cache_size)
+/* the cached value of reg, if it may be used */
+static int soc_codec_reg_cached(struct snd_soc_codec *codec, unsigned int reg,
+				unsigned int *value)
+{
+	if (codec->volatile_register && codec->volatile_register(codec, reg))
+		return -EINVAL;
+
+	if (codec->read_cache) {
+		*value = codec->read_cache(codec, reg);
 		return 0;
+	}
 
-	if (codec->reg_cache_step)
-		step = codec->reg_cache_step;
+	return snd_soc_cache_read(codec, reg, value);
+}
 
-	count += sprintf(buf, "%s registers\n", codec->name);
-	for (i = 0; i < codec->reg_cache_size; i += step) {
-		count += sprintf(buf + count, "%2x: ", i);
-		if (count >= PAGE_SIZE - 1)
-			break;
+/* read num registers from first, gathering uncached runs for read_block() */
+static void soc_codec_reg_fetch(struct snd_soc_codec *codec, int first,
+				int num, unsigned int *values)
+{
+	u16 block[SOC_CODEC_REG_CHUNK];
+	int step = soc_codec_reg_step(codec);
+	int i, j, k;
 
-		if (codec->display_register)
-			count += codec->display_register(codec, buf + count,
-							 PAGE_SIZE - count, i);
-		else
-			count += snprintf(buf + count, PAGE_SIZE - count,
-					  "%4x", codec->read(codec, i));
+	i = 0;
+	while (i < num) {
+		if (soc_codec_reg_cached(codec, first + i * step,
+					 &values[i]) == 0) {
+			i++;
+			continue;
+		}
 
-		if (count >= PAGE_SIZE - 1)
-			break;
+		/* the run of registers the cache can't answer */
+		for (j = i + 1; j < num; j++)
+			if (soc_codec_reg_cached(codec, first + j * step,
+						 &values[j]) == 0)
+				break;
 
-		count += snprintf(buf + count, PAGE_SIZE - count, "\n");
-		if (count >= PAGE_SIZE - 1)
-			break;
+		if (codec->read_block && step == 1 &&
+		    codec->read_block(codec, first + i, block, j - i) == 0) {
+			for (k = i; k < j; k++)
+				values[k] = block[k - i];
+		} else {
+			for (k = i; k < j; k++)
+				values[k] = codec->read(codec,
+							first + k * step);
+		}
+
+		/* values[j] already holds its cached value */
+		i = j + 1;
+	}
+}
+
+static void soc_codec_reg_format(struct snd_soc_codec *codec, char *line,
+				 unsigned int reg, unsigned int value)
+{
+	int reg_width = soc_codec_reg_width(codec);
+	int val_width = soc_codec_reg_value_width(codec);
+	char *val = line + reg_width + 2;
+	int len;
+
+	snprintf(line, reg_width + 3, "%*x: ", reg_width, reg);
+
+	if (codec->display_register) {
+		len = codec->display_register(codec, val, val_width + 1, reg);
+		len = clamp(len, 0, val_width);
+		memset(val + len, ' ', val_width - len);
+	} else {
+		snprintf(val, val_width + 1, "%*x", val_width, value & 0xffff);
+	}
+
+	val[val_width] = '\n';
+}
+
+/*
+ * Format the bytes from pos of the register dump into buf, returning the
+ * number written, which is short only at the end of the dump.
+ */
+static ssize_t soc_codec_reg_dump(struct snd_soc_codec *codec, char *buf,
+				  size_t count, loff_t pos)
+{
+	unsigned int values[SOC_CODEC_REG_CHUNK];
+	char line[8 + 2 + SOC_CODEC_REG_DISPLAY_WIDTH + 1 + 1];
+	int step = soc_codec_reg_step(codec);
+	int header = soc_codec_reg_header_len(codec);
+	int line_len = soc_codec_reg_line_len(codec);
+	int num_regs = DIV_ROUND_UP(codec->reg_cache_size, step);
+	int idx, n, i, len;
+	size_t written = 0;
+	u32 off;
+
+	if (pos < header) {
+		char *title = kasprintf(GFP_KERNEL, "%s registers\n",
+					codec->name);
+		if (!title)
+			return -ENOMEM;
+
+		written = min_t(size_t, header - pos, count);
+		memcpy(buf, title + pos, written);
+		pos += written;
+		kfree(title);
 	}
 
-	/* Truncate count; min() would cause a warning */
-	if (count >= PAGE_SIZE)
-		count = PAGE_SIZE - 1;
+	if (pos >= header + num_regs * line_len)
+		return written;
+
+	idx = div_u64_rem(pos - header, line_len, &off);
+
+	while (written < count && idx < num_regs) {
+		n = min(num_regs - idx, SOC_CODEC_REG_CHUNK);
+		soc_codec_reg_fetch(codec, idx * step, n, values);
 
-	return count;
+		for (i = 0; i < n && written < count; i++, idx++) {
+			soc_codec_reg_format(codec, line, idx * step,
+					     values[i]);
+			len = min_t(size_t, line_len - off, count - written);
+			memcpy(buf + written, line + off, len);
+			written += len;
+			off = 0;
+		}
+	}
+
+	return written;
+}
+
+static ssize_t soc_codec_reg_show(struct snd_soc_device *devdata, char *buf)
+{
+	/* sysfs is limited to a page, debugfs has the whole dump */
+	return soc_codec_reg_dump(devdata->codec, buf, PAGE_SIZE - 1, 0);
 }
+
 static ssize_t codec_reg_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
@@ -1107,14 +1341,25 @@ static ssize_t codec_reg_read_file(struct file *file, char __user *user_buf,
 {
 	ssize_t ret;
 	struct snd_soc_codec *codec = file->private_data;
-	struct device *card_dev = codec->card->dev;
-	struct snd_soc_device *devdata = card_dev->driver_data;
-	char *buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	char *buf;
+
+	if (*ppos < 0)
+		return -EINVAL;
+
+	/* a page of the dump at a time, starting wherever the reader is */
+	count = min_t(size_t, count, PAGE_SIZE);
+	buf = kmalloc(count, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
-	ret = soc_codec_reg_show(devdata, buf);
-	if (ret >= 0)
-		ret = simple_read_from_buffer(user_buf, count, ppos, buf, ret);
+
+	ret = soc_codec_reg_dump(codec, buf, count, *ppos);
+	if (ret > 0) {
+		if (copy_to_user(user_buf, buf, ret)) {
+			ret = -EFAULT;
+		} else {
+			*ppos += ret;
+		}
+	}
 	kfree(buf);
 	return ret;
 }
@@ -1156,6 +1401,26 @@ static const struct file_operations codec_reg_fops = {
 	.write = codec_reg_write_file,
 };
 
+static ssize_t dapm_stats_read_file(struct file *file, char __user *user_buf,
+				    size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+	struct snd_soc_codec *codec = file->private_data;
+	char *buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	ret = snd_soc_dapm_stats_show(codec, buf, PAGE_SIZE);
+	if (ret >= 0)
+		ret = simple_read_from_buffer(user_buf, count, ppos, buf, ret);
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations dapm_stats_fops = {
+	.open = codec_reg_open_file,
+	.read = dapm_stats_read_file,
+};
+
 static void soc_init_codec_debugfs(struct snd_soc_codec *codec)
 {
 	codec->debugfs_reg = debugfs_create_file("codec_reg", 0644,
@@ -1171,10 +1436,18 @@ static void soc_init_codec_debugfs(struct snd_soc_codec *codec)
 	if (!codec->debugfs_pop_time)
 		printk(KERN_WARNING
 		       "Failed to create pop time debugfs file\n");
+
+	codec->debugfs_dapm_stats = debugfs_create_file("dapm_stats", 0444,
+							debugfs_root, codec,
+							&dapm_stats_fops);
+	if (!codec->debugfs_dapm_stats)
+		printk(KERN_WARNING
+		       "Failed to create DAPM stats debugfs file\n");
 }
 
 static void soc_cleanup_codec_debugfs(struct snd_soc_codec *codec)
 {
+	debugfs_remove(codec->debugfs_dapm_stats);
 	debugfs_remove(codec->debugfs_pop_time);
 	debugfs_remove(codec->debugfs_reg);
 }
@@ -1240,6 +1513,37 @@ void snd_soc_free_ac97_codec(struct snd_soc_codec *codec)
 }
 EXPORT_SYMBOL_GPL(snd_soc_free_ac97_codec);
 
+/*
+ * Read a register for a read/modify/write cycle, from the codec's cache
+ * if it has one and the register isn't volatile.
+ */
+static unsigned int snd_soc_read_rmw(struct snd_soc_codec *codec,
+				     unsigned short reg)
+{
+	if (codec->read_cache &&
+	    !(codec->volatile_register &&
+	      codec->volatile_register(codec, reg)))
+		return codec->read_cache(codec, reg);
+
+	return snd_soc_read(codec, reg);
+}
+
+static int __snd_soc_update_bits(struct snd_soc_codec *codec,
+				 unsigned short reg, unsigned short mask,
+				 unsigned short value)
+{
+	int change;
+	unsigned short old, new;
+
+	old = snd_soc_read_rmw(codec, reg);
+	new = (old & ~mask) | value;
+	change = old != new;
+	if (change)
+		snd_soc_write(codec, reg, new);
+
+	return change;
+}
+
 /**
  * snd_soc_update_bits - update codec register bits
  * @codec: audio codec
@@ -1247,7 +1551,8 @@ EXPORT_SYMBOL_GPL(snd_soc_free_ac97_codec);
  * @mask: register mask
  * @value: new value
  *
- * Writes new register value.
+ * Writes new register value.  Nothing is written if the register
+ * already holds the value.
  *
  * Returns 1 for change else 0.
  */
@@ -1255,20 +1560,41 @@ int snd_soc_update_bits(struct snd_soc_codec *codec, unsigned short reg,
 				unsigned short mask, unsigned short value)
 {
 	int change;
-	unsigned short old, new;
 
-	mutex_lock(&io_mutex);
-	old = snd_soc_read(codec, reg);
-	new = (old & ~mask) | value;
-	change = old != new;
-	if (change)
-		snd_soc_write(codec, reg, new);
+	mutex_lock(&codec->io_mutex);
+	change = __snd_soc_update_bits(codec, reg, mask, value);
+	mutex_unlock(&codec->io_mutex);
 
-	mutex_unlock(&io_mutex);
 	return change;
 }
 EXPORT_SYMBOL_GPL(snd_soc_update_bits);
 
+/**
+ * snd_soc_update_bits_multi - update bits in several codec registers
+ * @codec: audio codec
+ * @upd: register updates to apply, in order
+ * @num: number of updates
+ *
+ * Applies each update as snd_soc_update_bits() would, with no other
+ * read/modify/write cycle on the codec coming in between them.
+ *
+ * Returns 1 if any register changed else 0.
+ */
+int snd_soc_update_bits_multi(struct snd_soc_codec *codec,
+			      const struct snd_soc_reg_update *upd, int num)
+{
+	int i, change = 0;
+
+	mutex_lock(&codec->io_mutex);
+	for (i = 0; i < num; i++)
+		change |= __snd_soc_update_bits(codec, upd[i].reg,
+						upd[i].mask, upd[i].value);
+	mutex_unlock(&codec->io_mutex);
+
+	return change;
+}
+EXPORT_SYMBOL_GPL(snd_soc_update_bits_multi);
+
 /**
  * snd_soc_test_bits - test register for change
  * @codec: audio codec
@@ -1287,11 +1613,11 @@ int snd_soc_test_bits(struct snd_soc_codec *codec, unsigned short reg,
 	int change;
 	unsigned short old, new;
 
-	mutex_lock(&io_mutex);
-	old = snd_soc_read(codec, reg);
+	mutex_lock(&codec->io_mutex);
+	old = snd_soc_read_rmw(codec, reg);
 	new = (old & ~mask) | value;
 	change = old != new;
-	mutex_unlock(&io_mutex);
+	mutex_unlock(&codec->io_mutex);
 
 	return change;
 }
@@ -1492,6 +1818,37 @@ struct snd_kcontrol *snd_soc_cnew(const struct snd_kcontrol_new *_template,
 }
 EXPORT_SYMBOL_GPL(snd_soc_cnew);
 
+/**
+ * snd_soc_add_controls - add an array of controls to a codec
+ * @codec: codec to add the controls to
+ * @controls: array of control templates
+ * @num_controls: number of controls in @controls
+ *
+ * Each control is created with the codec as its private data and added
+ * to the card, lookups by id going through the hash of the card's
+ * controls.
+ *
+ * Returns 0 for success, else error.
+ */
+int snd_soc_add_controls(struct snd_soc_codec *codec,
+	const struct snd_kcontrol_new *controls, int num_controls)
+{
+	int err, i;
+
+	for (i = 0; i < num_controls; i++) {
+		err = snd_ctl_add(codec->card,
+				  snd_soc_cnew(&controls[i], codec, NULL));
+		if (err < 0) {
+			printk(KERN_ERR "asoc: %s: failed to add %s: %d\n",
+			       codec->name, controls[i].name, err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_add_controls);
+
 /**
  * snd_soc_info_enum_double - enumerated double mixer info callback
  * @kcontrol: mixer control
@@ -1830,7 +2187,7 @@ int snd_soc_put_volsw_2r(struct snd_kcontrol *kcontrol,
 	int max = mc->max;
 	unsigned int mask = (1 << fls(max)) - 1;
 	unsigned int invert = mc->invert;
-	int err;
+	struct snd_soc_reg_update upd[2];
 	unsigned short val, val2, val_mask;
 
 	val_mask = mask << shift;
@@ -1842,15 +2199,14 @@ int snd_soc_put_volsw_2r(struct snd_kcontrol *kcontrol,
 		val2 = max - val2;
 	}
 
-	val = val << shift;
-	val2 = val2 << shift;
+	upd[0].reg = reg;
+	upd[0].mask = val_mask;
+	upd[0].value = val << shift;
+	upd[1].reg = reg2;
+	upd[1].mask = val_mask;
+	upd[1].value = val2 << shift;
 
-	err = snd_soc_update_bits(codec, reg, val_mask, val);
-	if (err < 0)
-		return err;
-
-	err = snd_soc_update_bits(codec, reg2, val_mask, val2);
-	return err;
+	return snd_soc_update_bits_multi(codec, upd, ARRAY_SIZE(upd));
 }
 EXPORT_SYMBOL_GPL(snd_soc_put_volsw_2r);
 
@@ -2269,6 +2625,8 @@ EXPORT_SYMBOL_GPL(snd_soc_unregister_codec);
 
 static int __init snd_soc_init(void)
 {
+	int ret;
+
 #ifdef CONFIG_DEBUG_FS
 	debugfs_root = debugfs_create_dir("asoc", NULL);
 	if (IS_ERR(debugfs_root) || !debugfs_root) {
@@ -2277,8 +2635,18 @@ static int __init snd_soc_init(void)
 		debugfs_root = NULL;
 	}
 #endif
+#ifdef CONFIG_PM
+	soc_resume_wq = create_singlethread_workqueue("soc-resume");
+	if (soc_resume_wq == NULL)
+		return -ENOMEM;
+#endif
 
-	return platform_driver_register(&soc_driver);
+	ret = platform_driver_register(&soc_driver);
+#ifdef CONFIG_PM
+	if (ret != 0)
+		destroy_workqueue(soc_resume_wq);
+#endif
+	return ret;
 }
 
 static void __exit snd_soc_exit(void)
@@ -2287,6 +2655,9 @@ static void __exit snd_soc_exit(void)
 	debugfs_remove_recursive(debugfs_root);
 #endif
 	platform_driver_unregister(&soc_driver);
+#ifdef CONFIG_PM
+	destroy_workqueue(soc_resume_wq);
+#endif
 }
 
 module_init(snd_soc_init);
@@ -37,6 +37,11 @@
 #include <linux/bitops.h>
 #include <linux/platform_device.h>
 #include <linux/jiffies.h>
+#include <linux/err.h>
+#include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/jhash.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -66,26 +71,132 @@ static int dapm_status = 1;
 module_param(dapm_status, int, 0);
 MODULE_PARM_DESC(dapm_status, "enable DPM sysfs entries");
 
-static void pop_wait(u32 pop_time)
+#ifdef CONFIG_DEBUG_FS
+static inline s64 dapm_time(void)
 {
-	if (pop_time)
-		schedule_timeout_uninterruptible(msecs_to_jiffies(pop_time));
+	return ktime_to_ns(ktime_get());
 }
 
-static void pop_dbg(u32 pop_time, const char *fmt, ...)
+/* charge the time since start to one part of the power update */
+#define dapm_stat(codec, field, start) \
+	((codec)->dapm_run.field += dapm_time() - (start))
+
+static void dapm_stats_begin(struct snd_soc_codec *codec)
+{
+	memset(&codec->dapm_run, 0, sizeof(codec->dapm_run));
+}
+
+static void dapm_stats_end(struct snd_soc_codec *codec, int event, s64 start)
+{
+	struct snd_soc_dapm_stats *stats;
+	u64 ns = dapm_time() - start;
+	int i = fls(event);
+
+	if (i >= SND_SOC_DAPM_STATS_EVENTS)
+		return;
+	stats = &codec->dapm_stats[i];
+
+	stats->runs++;
+	stats->total_ns += ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	stats->io_ns += codec->dapm_run.io_ns;
+	stats->wait_ns += codec->dapm_run.wait_ns;
+	stats->event_ns += codec->dapm_run.event_ns;
+}
+#else
+static inline s64 dapm_time(void)
+{
+	return 0;
+}
+
+#define dapm_stat(codec, field, start) do { (void)(start); } while (0)
+
+static inline void dapm_stats_begin(struct snd_soc_codec *codec)
+{
+}
+
+static inline void dapm_stats_end(struct snd_soc_codec *codec, int event,
+				  s64 start)
+{
+}
+#endif
+
+static void pop_wait(struct snd_soc_codec *codec)
+{
+	s64 start;
+
+	if (codec->pop_time) {
+		start = dapm_time();
+		schedule_timeout_uninterruptible(
+			msecs_to_jiffies(codec->pop_time));
+		dapm_stat(codec, wait_ns, start);
+	}
+}
+
+static void pop_dbg(struct snd_soc_codec *codec, const char *fmt, ...)
 {
 	va_list args;
 
 	va_start(args, fmt);
 
-	if (pop_time) {
+	if (codec->pop_time) {
 		vprintk(fmt, args);
-		pop_wait(pop_time);
+		pop_wait(codec);
 	}
 
 	va_end(args);
 }
 
+/* call a widget event handler, accounting the time it takes */
+static int dapm_widget_event(struct snd_soc_dapm_widget *w, int event)
+{
+	s64 start = dapm_time();
+	int ret;
+
+	ret = w->event(w, NULL, event);
+	dapm_stat(w->codec, event_ns, start);
+
+	return ret;
+}
+
+/* record a change of widget power state */
+static void dapm_set_power(struct snd_soc_dapm_widget *w, int power)
+{
+	if (w->power != power) {
+		if (power)
+			w->power_on_count++;
+		else
+			w->power_off_count++;
+	}
+	w->power = power;
+}
+
+static struct hlist_head *dapm_hash_bucket(struct snd_soc_codec *codec,
+					   const char *name)
+{
+	u32 hash = jhash(name, strlen(name), 0);
+
+	return &codec->dapm_hash[hash % SND_SOC_DAPM_HASH_SIZE];
+}
+
+/*
+ * Find a widget by name. Route tables refer to every widget several
+ * times so this is hashed rather than walking the widget list.
+ */
+static struct snd_soc_dapm_widget *dapm_find_widget(
+	struct snd_soc_codec *codec, const char *name)
+{
+	struct snd_soc_dapm_widget *w;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(w, node, dapm_hash_bucket(codec, name), hash)
+		if (!strcmp(w->name, name))
+			return w;
+
+	return NULL;
+}
+
 /* create a new dapm widget */
 static inline struct snd_soc_dapm_widget *dapm_cnew_widget(
 	const struct snd_soc_dapm_widget *_widget)
@@ -142,6 +253,7 @@ static void dapm_set_path_status(struct snd_soc_dapm_widget *w,
 	case snd_soc_dapm_dac:
 	case snd_soc_dapm_micbias:
 	case snd_soc_dapm_vmid:
+	case snd_soc_dapm_regulator_supply:
 		p->connect = 1;
 	break;
 	/* does effect routing - dynamically connected */
@@ -200,14 +312,9 @@ static int dapm_connect_mixer(struct snd_soc_codec *codec,
 	return -ENODEV;
 }
 
-/* update dapm codec register bits */
-static int dapm_update_bits(struct snd_soc_dapm_widget *widget)
+/* does the widget have a power bit for dapm to manage */
+static int dapm_widget_has_reg(struct snd_soc_dapm_widget *widget)
 {
-	int change, power;
-	unsigned short old, new;
-	struct snd_soc_codec *codec = widget->codec;
-
-	/* check for valid widgets */
 	if (widget->reg < 0 || widget->id == snd_soc_dapm_input ||
 		widget->id == snd_soc_dapm_output ||
 		widget->id == snd_soc_dapm_hp ||
@@ -216,24 +323,71 @@ static int dapm_update_bits(struct snd_soc_dapm_widget *widget)
 		widget->id == snd_soc_dapm_spk)
 		return 0;
 
-	power = widget->power;
-	if (widget->invert)
-		power = (power ? 0:1);
+	return 1;
+}
+
+/*
+ * Update the power bits of a list of widgets, doing a single read,
+ * modify, write (and pop wait) for all the widgets sharing a register.
+ */
+static void dapm_update_bits(struct snd_soc_codec *codec,
+			     struct list_head *list)
+{
+	struct snd_soc_dapm_widget *w, *n;
+	LIST_HEAD(pending);
+	LIST_HEAD(done);
+	unsigned short old, new, mask, value;
+	int reg, power;
+	s64 start;
+
+	list_splice_init(list, &pending);
+
+	while (!list_empty(&pending)) {
+		w = list_first_entry(&pending, struct snd_soc_dapm_widget,
+				     power_list);
+		if (!dapm_widget_has_reg(w)) {
+			list_move_tail(&w->power_list, &done);
+			continue;
+		}
+
+		reg = w->reg;
+		mask = 0;
+		value = 0;
+		list_for_each_entry_safe(w, n, &pending, power_list) {
+			if (!dapm_widget_has_reg(w) || w->reg != reg)
+				continue;
+
+			power = w->power;
+			if (w->invert)
+				power = (power ? 0:1);
 
-	old = snd_soc_read(codec, widget->reg);
-	new = (old & ~(0x1 << widget->shift)) | (power << widget->shift);
+			mask |= 0x1 << w->shift;
+			value |= power << w->shift;
+			list_move_tail(&w->power_list, &done);
 
-	change = old != new;
-	if (change) {
-		pop_dbg(codec->pop_time, "pop test %s : %s in %d ms\n",
-			widget->name, widget->power ? "on" : "off",
-			codec->pop_time);
-		snd_soc_write(codec, widget->reg, new);
-		pop_wait(codec->pop_time);
+			if (codec->pop_time)
+				printk(KERN_DEBUG "pop test %s : %s\n",
+				       w->name, w->power ? "on" : "off");
+		}
+
+		start = dapm_time();
+		old = snd_soc_read(codec, reg);
+		dapm_stat(codec, io_ns, start);
+		new = (old & ~mask) | value;
+
+		if (old != new) {
+			pop_dbg(codec, "pop test : reg %x %x in %d ms\n",
+				reg, new, codec->pop_time);
+			start = dapm_time();
+			snd_soc_write(codec, reg, new);
+			dapm_stat(codec, io_ns, start);
+			pop_wait(codec);
+		}
+		pr_debug("reg %x old %x new %x change %d\n", reg,
+			 old, new, old != new);
 	}
-	pr_debug("reg %x old %x new %x change %d\n", widget->reg,
-		 old, new, change);
-	return change;
+
+	list_splice(&done, list);
 }
 
 /* ramps the volume up or down to minimise pops before or after a
@@ -461,6 +615,125 @@ static int is_connected_input_ep(struct snd_soc_dapm_widget *widget)
 	return con;
 }
 
+/* reset the 'walked' bit on the paths walked from widget towards sinks */
+static void dapm_clear_walk_sinks(struct snd_soc_dapm_widget *widget)
+{
+	struct snd_soc_dapm_path *path;
+
+	list_for_each_entry(path, &widget->sinks, list_source) {
+		if (!path->walked)
+			continue;
+		path->walked = 0;
+		dapm_clear_walk_sinks(path->sink);
+	}
+}
+
+/* reset the 'walked' bit on the paths walked from widget towards sources */
+static void dapm_clear_walk_sources(struct snd_soc_dapm_widget *widget)
+{
+	struct snd_soc_dapm_path *path;
+
+	list_for_each_entry(path, &widget->sources, list_sink) {
+		if (!path->walked)
+			continue;
+		path->walked = 0;
+		dapm_clear_walk_sources(path->source);
+	}
+}
+
+/*
+ * Endpoint counts are cached between power updates.  Only their being
+ * non zero matters to the power decisions so the cache holds whatever
+ * a walk from the widget itself returned.
+ */
+static int dapm_widget_inputs(struct snd_soc_dapm_widget *widget)
+{
+	if (widget->inputs < 0) {
+		widget->inputs = is_connected_input_ep(widget);
+		dapm_clear_walk_sources(widget);
+	}
+
+	return widget->inputs;
+}
+
+static int dapm_widget_outputs(struct snd_soc_dapm_widget *widget)
+{
+	if (widget->outputs < 0) {
+		widget->outputs = is_connected_output_ep(widget);
+		dapm_clear_walk_sinks(widget);
+	}
+
+	return widget->outputs;
+}
+
+/* anything downstream of widget may have gained or lost an input */
+static void dapm_invalidate_sinks(struct snd_soc_dapm_widget *widget)
+{
+	struct snd_soc_dapm_path *path;
+
+	widget->inputs = -1;
+	widget->dirty = 1;
+
+	list_for_each_entry(path, &widget->sinks, list_source) {
+		if (path->walked || !path->connect)
+			continue;
+		path->walked = 1;
+		dapm_invalidate_sinks(path->sink);
+	}
+}
+
+/* anything upstream of widget may have gained or lost an output */
+static void dapm_invalidate_sources(struct snd_soc_dapm_widget *widget)
+{
+	struct snd_soc_dapm_path *path;
+
+	widget->outputs = -1;
+	widget->dirty = 1;
+
+	list_for_each_entry(path, &widget->sources, list_sink) {
+		if (path->walked || !path->connect)
+			continue;
+		path->walked = 1;
+		dapm_invalidate_sources(path->source);
+	}
+}
+
+/*
+ * Mark the widgets whose power may be affected by a change for
+ * re-evaluation by the next dapm_power_widgets().  The walks follow the
+ * connections as they are after the change; anything which lost its
+ * route is still reached from the endpoint of the path that broke it.
+ */
+static void dapm_path_changed(struct snd_soc_dapm_path *path)
+{
+	path->sink->codec->dapm_gen++;
+	dapm_invalidate_sinks(path->sink);
+	dapm_clear_walk_sinks(path->sink);
+	dapm_invalidate_sources(path->source);
+	dapm_clear_walk_sources(path->source);
+}
+
+static void dapm_widget_changed(struct snd_soc_dapm_widget *widget)
+{
+	widget->codec->dapm_gen++;
+	dapm_invalidate_sinks(widget);
+	dapm_clear_walk_sinks(widget);
+	dapm_invalidate_sources(widget);
+	dapm_clear_walk_sources(widget);
+}
+
+static void dapm_invalidate_all(struct snd_soc_codec *codec)
+{
+	struct snd_soc_dapm_widget *w;
+
+	codec->dapm_gen++;
+	list_for_each_entry(w, &codec->dapm_widgets, list) {
+		w->inputs = -1;
+		w->outputs = -1;
+		w->dirty = 1;
+	}
+}
+
 /*
  * Handler for generic register modifier widget.
  */
@@ -481,6 +754,149 @@ int dapm_reg_event(struct snd_soc_dapm_widget *w,
 }
 EXPORT_SYMBOL_GPL(dapm_reg_event);
 
+/*
+ * Handler for regulator supply widget.
+ */
+int dapm_regulator_event(struct snd_soc_dapm_widget *w,
+			 struct snd_kcontrol *kcontrol, int event)
+{
+	if (SND_SOC_DAPM_EVENT_ON(event))
+		return regulator_enable(w->regulator);
+	else
+		return regulator_disable_deferred(w->regulator, w->delay);
+}
+EXPORT_SYMBOL_GPL(dapm_regulator_event);
+
+/* widgets powered with their stream, without power events */
+static inline int dapm_widget_streaming(struct snd_soc_dapm_widget *w)
+{
+	return (w->id == snd_soc_dapm_adc || w->id == snd_soc_dapm_dac) &&
+		w->active;
+}
+
+/*
+ * Apply the power changes for one step of the power sequence.  Each
+ * phase is run for every widget before the next so the register
+ * writes of the whole step can be combined.
+ */
+static int dapm_seq_run(struct snd_soc_codec *codec, struct list_head *list)
+{
+	struct snd_soc_dapm_widget *w;
+	s64 start;
+	int ret;
+
+	list_for_each_entry(w, list, power_list) {
+		if (dapm_widget_streaming(w) || !w->event)
+			continue;
+
+		/* call any power change event handlers */
+		pr_debug("power %s event for %s flags %x\n",
+			 w->power ? "on" : "off",
+			 w->name, w->event_flags);
+
+		/* power up pre event */
+		if (w->power && (w->event_flags & SND_SOC_DAPM_PRE_PMU)) {
+			ret = dapm_widget_event(w, SND_SOC_DAPM_PRE_PMU);
+			if (ret < 0)
+				return ret;
+		}
+
+		/* power down pre event */
+		if (!w->power && (w->event_flags & SND_SOC_DAPM_PRE_PMD)) {
+			ret = dapm_widget_event(w, SND_SOC_DAPM_PRE_PMD);
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	/* Lower PGA volume to reduce pops */
+	start = dapm_time();
+	list_for_each_entry(w, list, power_list)
+		if (w->id == snd_soc_dapm_pga && !w->power)
+			dapm_set_pga(w, w->power);
+	dapm_stat(codec, io_ns, start);
+
+	dapm_update_bits(codec, list);
+
+	/* Raise PGA volume to reduce pops */
+	start = dapm_time();
+	list_for_each_entry(w, list, power_list)
+		if (w->id == snd_soc_dapm_pga && w->power)
+			dapm_set_pga(w, w->power);
+	dapm_stat(codec, io_ns, start);
+
+	list_for_each_entry(w, list, power_list) {
+		if (dapm_widget_streaming(w) || !w->event)
+			continue;
+
+		/* power up post event */
+		if (w->power && (w->event_flags & SND_SOC_DAPM_POST_PMU)) {
+			ret = dapm_widget_event(w, SND_SOC_DAPM_POST_PMU);
+			if (ret < 0)
+				return ret;
+		}
+
+		/* power down post event */
+		if (!w->power && (w->event_flags & SND_SOC_DAPM_POST_PMD)) {
+			ret = dapm_widget_event(w, SND_SOC_DAPM_POST_PMD);
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* a supply is needed while any widget it supplies is powered */
+static int dapm_supply_needed(struct snd_soc_dapm_widget *supply)
+{
+	struct snd_soc_dapm_path *path;
+
+	list_for_each_entry(path, &supply->sinks, list_source)
+		if (path->connect && path->sink->power)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Switch on the supplies needed by widgets about to be powered up, or
+ * off those no longer needed once everything has been powered down.
+ * A supply is only marked powered once its regulator has been enabled,
+ * so a failure neither unbalances the regulator nor stops a retry.
+ */
+static int dapm_supplies_update(struct snd_soc_codec *codec, int power)
+{
+	struct snd_soc_dapm_widget *w;
+	int event = power ? SND_SOC_DAPM_PRE_PMU : SND_SOC_DAPM_POST_PMD;
+	int ret;
+
+	list_for_each_entry(w, &codec->dapm_widgets, list) {
+		if (w->id != snd_soc_dapm_regulator_supply || w->power == power)
+			continue;
+
+		if (dapm_supply_needed(w) != power)
+			continue;
+
+		pr_debug("power %s event for %s flags %x\n",
+			 power ? "on" : "off", w->name, w->event_flags);
+
+		if (w->event && (w->event_flags & event)) {
+			ret = dapm_widget_event(w, event);
+			if (ret < 0) {
+				printk(KERN_ERR "asoc: failed to power %s "
+				       "supply %s: %d\n", power ? "up" : "down",
+				       w->name, ret);
+				return ret;
+			}
+		}
+
+		dapm_set_power(w, power);
+	}
+
+	return 0;
+}
+
 /*
  * Scan each dapm widget for complete audio path.
  * A complete path is a route that has valid endpoints i.e.:-
@@ -489,11 +905,16 @@ EXPORT_SYMBOL_GPL(dapm_reg_event);
  *  o Input Pin to ADC.
  *  o Input pin to Output pin (bypass, sidetone)
  *  o DAC to ADC (loopback).
+ *
+ * Only widgets marked dirty by a change to the graph are re-evaluated.
+ * Supplies are powered up ahead of the widgets using them and powered
+ * down once the whole sequence is done.
  */
-static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
+static int dapm_power_sequence(struct snd_soc_codec *codec, int event)
 {
 	struct snd_soc_dapm_widget *w;
-	int in, out, i, c = 1, *seq = NULL, ret = 0, power_change, power;
+	int in, out, i, c = 1, *seq = NULL, ret = 0, power;
+	LIST_HEAD(changed);
 
 	/* do we have a sequenced stream event */
 	if (event == SND_SOC_DAPM_STREAM_START) {
@@ -511,25 +932,30 @@ static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
 			if (seq && seq[i] && w->id != seq[i])
 				continue;
 
-			/* vmid - no action */
-			if (w->id == snd_soc_dapm_vmid)
+			/* vmid - no action, supplies are done separately */
+			if (w->id == snd_soc_dapm_vmid ||
+			    w->id == snd_soc_dapm_regulator_supply)
 				continue;
 
 			/* active ADC */
 			if (w->id == snd_soc_dapm_adc && w->active) {
-				in = is_connected_input_ep(w);
-				dapm_clear_walk(w->codec);
-				w->power = (in != 0) ? 1 : 0;
-				dapm_update_bits(w);
+				if (!w->dirty)
+					continue;
+				w->dirty = 0;
+				in = dapm_widget_inputs(w);
+				dapm_set_power(w, in != 0);
+				list_add_tail(&w->power_list, &changed);
 				continue;
 			}
 
 			/* active DAC */
 			if (w->id == snd_soc_dapm_dac && w->active) {
-				out = is_connected_output_ep(w);
-				dapm_clear_walk(w->codec);
-				w->power = (out != 0) ? 1 : 0;
-				dapm_update_bits(w);
+				if (!w->dirty)
+					continue;
+				w->dirty = 0;
+				out = dapm_widget_outputs(w);
+				dapm_set_power(w, out != 0);
+				list_add_tail(&w->power_list, &changed);
 				continue;
 			}
 
@@ -539,13 +965,13 @@ static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
 					continue;
 
 				if (event == SND_SOC_DAPM_STREAM_START) {
-					ret = w->event(w,
-						NULL, SND_SOC_DAPM_PRE_PMU);
+					ret = dapm_widget_event(w,
+						SND_SOC_DAPM_PRE_PMU);
 					if (ret < 0)
 						return ret;
 				} else if (event == SND_SOC_DAPM_STREAM_STOP) {
-					ret = w->event(w,
-						NULL, SND_SOC_DAPM_PRE_PMD);
+					ret = dapm_widget_event(w,
+						SND_SOC_DAPM_PRE_PMD);
 					if (ret < 0)
 						return ret;
 				}
@@ -556,13 +982,13 @@ static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
 					continue;
 
 				if (event == SND_SOC_DAPM_STREAM_START) {
-					ret = w->event(w,
-						NULL, SND_SOC_DAPM_POST_PMU);
+					ret = dapm_widget_event(w,
+						SND_SOC_DAPM_POST_PMU);
 					if (ret < 0)
 						return ret;
 				} else if (event == SND_SOC_DAPM_STREAM_STOP) {
-					ret = w->event(w,
-						NULL, SND_SOC_DAPM_POST_PMD);
+					ret = dapm_widget_event(w,
+						SND_SOC_DAPM_POST_PMD);
 					if (ret < 0)
 						return ret;
 				}
@@ -570,67 +996,67 @@ static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
 			}
 
 			/* all other widgets */
-			in = is_connected_input_ep(w);
-			dapm_clear_walk(w->codec);
-			out = is_connected_output_ep(w);
-			dapm_clear_walk(w->codec);
+			if (!w->dirty)
+				continue;
+			w->dirty = 0;
+			in = dapm_widget_inputs(w);
+			out = dapm_widget_outputs(w);
 			power = (out != 0 && in != 0) ? 1 : 0;
-			power_change = (w->power == power) ? 0: 1;
-			w->power = power;
 
-			if (!power_change)
+			if (w->power == power)
 				continue;
 
-			/* call any power change event handlers */
-			if (w->event)
-				pr_debug("power %s event for %s flags %x\n",
-					 w->power ? "on" : "off",
-					 w->name, w->event_flags);
-
-			/* power up pre event */
-			if (power && w->event &&
-			    (w->event_flags & SND_SOC_DAPM_PRE_PMU)) {
-				ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMU);
-				if (ret < 0)
-					return ret;
-			}
+			dapm_set_power(w, power);
+			list_add_tail(&w->power_list, &changed);
+		}
 
-			/* power down pre event */
-			if (!power && w->event &&
-			    (w->event_flags & SND_SOC_DAPM_PRE_PMD)) {
-				ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMD);
-				if (ret < 0)
-					return ret;
-			}
+		ret = dapm_supplies_update(codec, 1);
+		if (ret == 0)
+			ret = dapm_seq_run(codec, &changed);
+		INIT_LIST_HEAD(&changed);
+		if (ret < 0)
+			return ret;
+	}
 
-			/* Lower PGA volume to reduce pops */
-			if (w->id == snd_soc_dapm_pga && !power)
-				dapm_set_pga(w, power);
+	return dapm_supplies_update(codec, 0);
+}
 
-			dapm_update_bits(w);
+/*
+ * Inside snd_soc_dapm_begin() and snd_soc_dapm_end() the power pass is
+ * only noted, the widgets changed meanwhile stay dirty and are all
+ * evaluated by a single pass when the batch ends.  If the events held
+ * differ there is no one order to sequence them in so the combined
+ * pass is unsequenced.
+ *
+ * A pass with no stream event over a graph unchanged since the last
+ * one, such as after a volume change, has nothing to do and returns
+ * without looking at the widgets.
+ */
+static int dapm_power_widgets(struct snd_soc_codec *codec, int event)
+{
+	unsigned int gen = codec->dapm_gen;
+	s64 start;
+	int ret;
 
-			/* Raise PGA volume to reduce pops */
-			if (w->id == snd_soc_dapm_pga && power)
-				dapm_set_pga(w, power);
+	if (codec->dapm_batch) {
+		if (!codec->dapm_batch_pending)
+			codec->dapm_batch_event = event;
+		else if (codec->dapm_batch_event != event)
+			codec->dapm_batch_event = SND_SOC_DAPM_STREAM_NOP;
+		codec->dapm_batch_pending = 1;
+		return 0;
+	}
 
-			/* power up post event */
-			if (power && w->event &&
-			    (w->event_flags & SND_SOC_DAPM_POST_PMU)) {
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_POST_PMU);
-				if (ret < 0)
-					return ret;
-			}
+	if (event == SND_SOC_DAPM_STREAM_NOP && gen == codec->dapm_gen_done)
+		return 0;
 
-			/* power down post event */
-			if (!power && w->event &&
-			    (w->event_flags & SND_SOC_DAPM_POST_PMD)) {
-				ret = w->event(w, NULL, SND_SOC_DAPM_POST_PMD);
-				if (ret < 0)
-					return ret;
-			}
-		}
-	}
+	start = dapm_time();
+	dapm_stats_begin(codec);
+	ret = dapm_power_sequence(codec, event);
+	dapm_stats_end(codec, event, start);
+
+	if (ret == 0)
+		codec->dapm_gen_done = gen;
 
 	return ret;
 }
@@ -696,7 +1122,7 @@ static int dapm_mux_update_power(struct snd_soc_dapm_widget *widget,
 				 int mux, int val, struct soc_enum *e)
 {
 	struct snd_soc_dapm_path *path;
-	int found = 0;
+	int found = 0, connect;
 
 	if (widget->id != snd_soc_dapm_mux)
 		return -ENODEV;
@@ -714,10 +1140,12 @@ static int dapm_mux_update_power(struct snd_soc_dapm_widget *widget,
 
 		found = 1;
 		/* we now need to match the string in the enum to the path */
-		if (!(strcmp(path->name, e->texts[mux])))
-			path->connect = 1; /* new connection */
-		else
-			path->connect = 0; /* old connection must be powered down */
+		connect = !strcmp(path->name, e->texts[mux]);
+		if (path->connect != connect) {
+			/* new connection or old one to be powered down */
+			path->connect = connect;
+			dapm_path_changed(path);
+		}
 	}
 
 	if (found) {
@@ -734,7 +1162,7 @@ static int dapm_mixer_update_power(struct snd_soc_dapm_widget *widget,
 				   int val_mask, int val, int invert)
 {
 	struct snd_soc_dapm_path *path;
-	int found = 0;
+	int found = 0, connect;
 
 	if (widget->id != snd_soc_dapm_mixer &&
 	    widget->id != snd_soc_dapm_switch)
@@ -752,10 +1180,16 @@ static int dapm_mixer_update_power(struct snd_soc_dapm_widget *widget,
 		found = 1;
 		if (val)
 			/* new connection */
-			path->connect = invert ? 0:1;
+			connect = invert ? 0:1;
 		else
 			/* old connection must be powered down */
-			path->connect = invert ? 1:0;
+			connect = invert ? 1:0;
+
+		/* a volume change leaves the route as it was */
+		if (path->connect != connect) {
+			path->connect = connect;
+			dapm_path_changed(path);
+		}
 		break;
 	}
 
@@ -790,6 +1224,7 @@ static ssize_t dapm_widget_show(struct device *dev,
 		case snd_soc_dapm_adc:
 		case snd_soc_dapm_pga:
 		case snd_soc_dapm_mixer:
+		case snd_soc_dapm_regulator_supply:
 			if (w->name)
 				count += sprintf(buf + count, "%s: %s\n",
 					w->name, w->power ? "On":"Off");
@@ -834,6 +1269,70 @@ static void snd_soc_dapm_sys_remove(struct device *dev)
 	}
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char *dapm_stats_event[SND_SOC_DAPM_STATS_EVENTS] = {
+	"nop", "start", "stop", "suspend", "resume", "pause push",
+	"pause release",
+};
+
+/* ns to us for display */
+static unsigned long dapm_us(u64 ns)
+{
+	return (unsigned long)div_u64(ns, NSEC_PER_USEC);
+}
+
+/*
+ * Show the time spent in DAPM power updates for each type of stream
+ * event and the number of power transitions of each widget. Used for
+ * the codec's dapm_stats debugfs file.
+ */
+int snd_soc_dapm_stats_show(struct snd_soc_codec *codec, char *buf,
+			    size_t size)
+{
+	struct snd_soc_dapm_stats *stats;
+	struct snd_soc_dapm_widget *w;
+	u64 walk;
+	int i, count;
+
+	count = snprintf(buf, size, "%-14s %6s %10s %8s %10s %10s %10s %10s\n",
+			 "event", "runs", "total_us", "max_us", "walk_us",
+			 "io_us", "wait_us", "event_us");
+
+	for (i = 0; i < SND_SOC_DAPM_STATS_EVENTS && count < size; i++) {
+		stats = &codec->dapm_stats[i];
+		if (!stats->runs)
+			continue;
+
+		walk = stats->total_ns - stats->io_ns - stats->wait_ns -
+			stats->event_ns;
+		count += snprintf(buf + count, size - count,
+				  "%-14s %6u %10lu %8lu %10lu %10lu %10lu %10lu\n",
+				  dapm_stats_event[i], stats->runs,
+				  dapm_us(stats->total_ns),
+				  dapm_us(stats->max_ns), dapm_us(walk),
+				  dapm_us(stats->io_ns),
+				  dapm_us(stats->wait_ns),
+				  dapm_us(stats->event_ns));
+	}
+
+	if (count < size)
+		count += snprintf(buf + count, size - count,
+				  "\n%-32s %6s %6s\n", "widget", "on", "off");
+
+	list_for_each_entry(w, &codec->dapm_widgets, list) {
+		if (count >= size)
+			break;
+		if (!w->name)
+			continue;
+		count += snprintf(buf + count, size - count, "%-32s %6u %6u\n",
+				  w->name, w->power_on_count,
+				  w->power_off_count);
+	}
+
+	return min_t(int, count, size - 1);
+}
+#endif
+
 /* free all dapm widgets and resources */
 static void dapm_free_widgets(struct snd_soc_codec *codec)
 {
@@ -842,6 +1341,13 @@ static void dapm_free_widgets(struct snd_soc_codec *codec)
 
 	list_for_each_entry_safe(w, next_w, &codec->dapm_widgets, list) {
 		list_del(&w->list);
+		if (!hlist_unhashed(&w->hash))
+			hlist_del(&w->hash);
+		if (w->regulator) {
+			if (w->power)
+				regulator_disable(w->regulator);
+			regulator_put(w->regulator);
+		}
 		kfree(w);
 	}
 
@@ -857,12 +1363,14 @@ static int snd_soc_dapm_set_pin(struct snd_soc_codec *codec,
 {
 	struct snd_soc_dapm_widget *w;
 
-	list_for_each_entry(w, &codec->dapm_widgets, list) {
-		if (!strcmp(w->name, pin)) {
-			pr_debug("dapm: %s: pin %s\n", codec->name, pin);
+	w = dapm_find_widget(codec, pin);
+	if (w) {
+		pr_debug("dapm: %s: pin %s\n", codec->name, pin);
+		if (w->connected != status) {
 			w->connected = status;
-			return 0;
+			dapm_widget_changed(w);
 		}
+		return 0;
 	}
 
 	pr_err("dapm: %s: configuring unknown pin %s\n", codec->name, pin);
@@ -874,13 +1382,17 @@ static int snd_soc_dapm_set_pin(struct snd_soc_codec *codec,
  * @codec: audio codec
  *
  * Walks all dapm audio paths and powers widgets according to their
- * stream or path usage.
+ * stream or path usage.  Every widget is re-evaluated so drivers which
+ * change paths directly can use this to bring DAPM up to date.
  *
  * Returns 0 for success.
  */
 int snd_soc_dapm_sync(struct snd_soc_codec *codec)
 {
-	int ret = dapm_power_widgets(codec, SND_SOC_DAPM_STREAM_NOP);
+	int ret;
+
+	dapm_invalidate_all(codec);
+	ret = dapm_power_widgets(codec, SND_SOC_DAPM_STREAM_NOP);
 	dump_dapm(codec, "sync");
 	return ret;
 }
@@ -890,20 +1402,12 @@ static int snd_soc_dapm_add_route(struct snd_soc_codec *codec,
 	const char *sink, const char *control, const char *source)
 {
 	struct snd_soc_dapm_path *path;
-	struct snd_soc_dapm_widget *wsource = NULL, *wsink = NULL, *w;
+	struct snd_soc_dapm_widget *wsource, *wsink;
 	int ret = 0;
 
 	/* find src and dest widgets */
-	list_for_each_entry(w, &codec->dapm_widgets, list) {
-
-		if (!wsink && !(strcmp(w->name, sink))) {
-			wsink = w;
-			continue;
-		}
-		if (!wsource && !(strcmp(w->name, source))) {
-			wsource = w;
-		}
-	}
+	wsink = dapm_find_widget(codec, sink);
+	wsource = dapm_find_widget(codec, source);
 
 	if (wsource == NULL || wsink == NULL)
 		return -ENODEV;
@@ -954,6 +1458,7 @@ static int snd_soc_dapm_add_route(struct snd_soc_codec *codec,
 	case snd_soc_dapm_vmid:
 	case snd_soc_dapm_pre:
 	case snd_soc_dapm_post:
+	case snd_soc_dapm_regulator_supply:
 		list_add(&path->list, &codec->dapm_paths);
 		list_add(&path->list_sink, &wsink->sources);
 		list_add(&path->list_source, &wsource->sinks);
@@ -1020,6 +1525,8 @@ int snd_soc_dapm_add_routes(struct snd_soc_codec *codec,
 		route++;
 	}
 
+	dapm_invalidate_all(codec);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(snd_soc_dapm_add_routes);
@@ -1064,6 +1571,7 @@ int snd_soc_dapm_new_widgets(struct snd_soc_codec *codec)
 		case snd_soc_dapm_vmid:
 		case snd_soc_dapm_pre:
 		case snd_soc_dapm_post:
+		case snd_soc_dapm_regulator_supply:
 			break;
 		}
 		w->new = 1;
@@ -1290,14 +1798,33 @@ int snd_soc_dapm_new_control(struct snd_soc_codec *codec,
 	if ((w = dapm_cnew_widget(widget)) == NULL)
 		return -ENOMEM;
 
+	if (w->id == snd_soc_dapm_regulator_supply) {
+		w->regulator = regulator_get(codec->dev, w->name);
+		if (IS_ERR(w->regulator)) {
+			int ret = PTR_ERR(w->regulator);
+
+			printk(KERN_ERR "asoc: failed to get supply %s: %d\n",
+			       w->name, ret);
+			kfree(w);
+			return ret;
+		}
+	}
+
 	w->codec = codec;
 	INIT_LIST_HEAD(&w->sources);
 	INIT_LIST_HEAD(&w->sinks);
 	INIT_LIST_HEAD(&w->list);
 	list_add(&w->list, &codec->dapm_widgets);
+	INIT_HLIST_NODE(&w->hash);
+	if (w->name)
+		hlist_add_head(&w->hash, dapm_hash_bucket(codec, w->name));
 
 	/* machine layer set ups unconnected pins and insertions */
 	w->connected = 1;
+	w->inputs = -1;
+	w->outputs = -1;
+	w->dirty = 1;
+	codec->dapm_gen++;
 	return 0;
 }
 EXPORT_SYMBOL_GPL(snd_soc_dapm_new_control);
@@ -1348,6 +1875,7 @@ int snd_soc_dapm_stream_event(struct snd_soc_codec *codec,
 	char *stream, int event)
 {
 	struct snd_soc_dapm_widget *w;
+	int active;
 
 	if (stream == NULL)
 		return 0;
@@ -1360,6 +1888,7 @@ int snd_soc_dapm_stream_event(struct snd_soc_codec *codec,
 		pr_debug("widget %s\n %s stream %s event %d\n",
 			 w->name, w->sname, stream, event);
 		if (strstr(w->sname, stream)) {
+			active = w->active;
 			switch(event) {
 			case SND_SOC_DAPM_STREAM_START:
 				w->active = 1;
@@ -1383,6 +1912,8 @@ int snd_soc_dapm_stream_event(struct snd_soc_codec *codec,
 			case SND_SOC_DAPM_STREAM_PAUSE_RELEASE:
 				break;
 			}
+			if (w->active != active)
+				dapm_widget_changed(w);
 		}
 	}
 	mutex_unlock(&codec->mutex);
@@ -1417,6 +1948,53 @@ int snd_soc_dapm_set_bias_level(struct snd_soc_device *socdev,
 	return ret;
 }
 
+/**
+ * snd_soc_dapm_begin - start batching DAPM power changes
+ * @codec: audio codec
+ *
+ * Until the matching snd_soc_dapm_end() stream events, syncs and
+ * control changes only update the DAPM graph.  The power sequencing
+ * they would each have done, with its register writes and pop waits,
+ * is done once for all of them when the batch ends.  Batches nest.
+ */
+void snd_soc_dapm_begin(struct snd_soc_codec *codec)
+{
+	mutex_lock(&codec->mutex);
+	codec->dapm_batch++;
+	mutex_unlock(&codec->mutex);
+}
+EXPORT_SYMBOL_GPL(snd_soc_dapm_begin);
+
+/**
+ * snd_soc_dapm_end - end a batch of DAPM power changes
+ * @codec: audio codec
+ *
+ * Ending the outermost batch runs the power pass held back by it, if
+ * there was anything to do.
+ *
+ * Returns 0 for success else error.
+ */
+int snd_soc_dapm_end(struct snd_soc_codec *codec)
+{
+	int run = 0, event = 0;
+	int ret = 0;
+
+	mutex_lock(&codec->mutex);
+	if (--codec->dapm_batch == 0 && codec->dapm_batch_pending) {
+		codec->dapm_batch_pending = 0;
+		event = codec->dapm_batch_event;
+		run = 1;
+	}
+	mutex_unlock(&codec->mutex);
+
+	if (run) {
+		ret = dapm_power_widgets(codec, event);
+		dump_dapm(codec, __func__);
+	}
+	return ret;
+}
+EXPORT_SYMBOL_GPL(snd_soc_dapm_end);
+
 /**
  * snd_soc_dapm_enable_pin - enable pin.
  * @snd_soc_codec: SoC codec
@@ -1481,10 +2059,9 @@ int snd_soc_dapm_get_pin_status(struct snd_soc_codec *codec, char *pin)
 {
 	struct snd_soc_dapm_widget *w;
 
-	list_for_each_entry(w, &codec->dapm_widgets, list) {
-		if (!strcmp(w->name, pin))
-			return w->connected;
-	}
+	w = dapm_find_widget(codec, pin);
+	if (w)
+		return w->connected;
 
 	return 0;
 }
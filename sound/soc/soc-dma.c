@@ -0,0 +1,123 @@
+/*
+ * soc-dma.c  --  ALSA SoC DMA buffer helpers
+ *
+ * Copyright 2009 Wolfson Microelectronics PLC.
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ *  Platform drivers whose DMA controllers read straight from write
+ *  combined memory all preallocate their buffers the same way.  The
+ *  buffer for each substream is allocated when the PCM is created and
+ *  kept until it is freed, so opening and starting a stream never
+ *  allocates, and the same memory is mapped into userspace.
+ */
+
+#include <linux/kernel.h>
+#include <linux/dma-mapping.h>
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/soc.h>
+
+static int snd_soc_dma_alloc(struct snd_pcm *pcm, int stream, size_t size)
+{
+	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
+	struct snd_dma_buffer *buf = &substream->dma_buffer;
+
+	buf->dev.type = SNDRV_DMA_TYPE_DEV;
+	buf->dev.dev = pcm->card->dev;
+	buf->private_data = NULL;
+	buf->area = dma_alloc_writecombine(pcm->card->dev, size,
+					   &buf->addr, GFP_KERNEL);
+	if (!buf->area)
+		return -ENOMEM;
+
+	buf->bytes = size;
+	return 0;
+}
+
+/**
+ * snd_soc_dma_prealloc - preallocate the DMA buffers of a PCM
+ * @pcm: PCM being created
+ * @dai: DAI the PCM is for, only the directions it supports get buffers
+ * @size: bytes to allocate per substream, normally the buffer_bytes_max
+ *        of the platform's hardware description
+ *
+ * For use from the pcm_new() callback of a platform, with
+ * snd_soc_dma_free() as its pcm_free() and snd_soc_dma_mmap() as the
+ * mmap() PCM operation.  hw_params() then only needs to point the
+ * runtime at substream->dma_buffer.
+ *
+ * Returns 0 for success, else error.
+ */
+int snd_soc_dma_prealloc(struct snd_pcm *pcm, struct snd_soc_dai *dai,
+			 size_t size)
+{
+	int ret;
+
+	if (dai->playback.channels_min) {
+		ret = snd_soc_dma_alloc(pcm, SNDRV_PCM_STREAM_PLAYBACK, size);
+		if (ret)
+			goto err;
+	}
+
+	if (dai->capture.channels_min) {
+		ret = snd_soc_dma_alloc(pcm, SNDRV_PCM_STREAM_CAPTURE, size);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	snd_soc_dma_free(pcm);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(snd_soc_dma_prealloc);
+
+/**
+ * snd_soc_dma_free - free the buffers from snd_soc_dma_prealloc()
+ * @pcm: PCM being freed
+ */
+void snd_soc_dma_free(struct snd_pcm *pcm)
+{
+	struct snd_pcm_substream *substream;
+	struct snd_dma_buffer *buf;
+	int stream;
+
+	for (stream = 0; stream < 2; stream++) {
+		substream = pcm->streams[stream].substream;
+		if (!substream)
+			continue;
+
+		buf = &substream->dma_buffer;
+		if (!buf->area)
+			continue;
+
+		dma_free_writecombine(pcm->card->dev, buf->bytes,
+				      buf->area, buf->addr);
+		buf->area = NULL;
+	}
+}
+EXPORT_SYMBOL_GPL(snd_soc_dma_free);
+
+/**
+ * snd_soc_dma_mmap - map a preallocated DMA buffer into userspace
+ * @substream: substream being mapped
+ * @vma: userspace mapping
+ *
+ * Returns 0 for success, else error.
+ */
+int snd_soc_dma_mmap(struct snd_pcm_substream *substream,
+		     struct vm_area_struct *vma)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	return dma_mmap_writecombine(substream->pcm->card->dev, vma,
+				     runtime->dma_area,
+				     runtime->dma_addr,
+				     runtime->dma_bytes);
+}
+EXPORT_SYMBOL_GPL(snd_soc_dma_mmap);